@@ -174,6 +174,125 @@ RB_METHOD_GUARD(se_playPosition) {
 }
 RB_METHOD_GUARD_END
 
+RB_METHOD(audio_sePreload)
+{
+	RB_UNUSED_PARAM;
+
+	for (int i = 0; i < argc; ++i)
+	{
+		SafeStringValue(argv[i]);
+		shState->audio().sePreload(RSTRING_PTR(argv[i]));
+	}
+
+	return Qnil;
+}
+
+RB_METHOD(audio_seStats)
+{
+	RB_UNUSED_PARAM;
+
+	uint64_t hits = 0, misses = 0;
+	uint32_t cachedBytes = 0, budgetBytes = 0;
+
+	shState->audio().seStats(hits, misses, cachedBytes, budgetBytes);
+
+	VALUE ret = rb_hash_new();
+	rb_hash_aset(ret, ID2SYM(rb_intern("hits")), ULL2NUM(hits));
+	rb_hash_aset(ret, ID2SYM(rb_intern("misses")), ULL2NUM(misses));
+	rb_hash_aset(ret, ID2SYM(rb_intern("cached_bytes")), UINT2NUM(cachedBytes));
+	rb_hash_aset(ret, ID2SYM(rb_intern("budget_bytes")), UINT2NUM(budgetBytes));
+
+	return ret;
+}
+
+RB_METHOD(audio_stats)
+{
+	RB_UNUSED_PARAM;
+
+	std::vector<Audio::StreamStat> stats;
+	shState->audio().streamStats(stats);
+
+	VALUE ret = rb_hash_new();
+
+	for (size_t i = 0; i < stats.size(); ++i)
+	{
+		const Audio::StreamStat &st = stats[i];
+
+		VALUE entry = rb_hash_new();
+		rb_hash_aset(entry, ID2SYM(rb_intern("queued_buffers")), INT2NUM(st.queuedBufs));
+		rb_hash_aset(entry, ID2SYM(rb_intern("processed_buffers")), INT2NUM(st.procBufs));
+		rb_hash_aset(entry, ID2SYM(rb_intern("underruns")), UINT2NUM(st.underruns));
+		rb_hash_aset(entry, ID2SYM(rb_intern("fills")), UINT2NUM(st.fills));
+		rb_hash_aset(entry, ID2SYM(rb_intern("decode_p50_us")), UINT2NUM(st.decodeP50Us));
+		rb_hash_aset(entry, ID2SYM(rb_intern("decode_p95_us")), UINT2NUM(st.decodeP95Us));
+		rb_hash_aset(entry, ID2SYM(rb_intern("decode_max_us")), UINT2NUM(st.decodeMaxUs));
+
+		rb_hash_aset(ret, rb_str_new_cstr(st.name.c_str()), entry);
+	}
+
+	return ret;
+}
+
+RB_METHOD(audio_fxReverb)
+{
+	RB_UNUSED_PARAM;
+	VALUE preset = Qnil;
+	rb_get_args(argc, argv, "|o", &preset RB_ARG_END);
+
+	if (preset == Qnil)
+	{
+		shState->audio().fxSetReverb(0);
+		return Qtrue;
+	}
+
+	SafeStringValue(preset);
+	return shState->audio().fxSetReverb(RSTRING_PTR(preset)) ? Qtrue : Qfalse;
+}
+
+RB_METHOD_GUARD(audio_bgmSetSend)
+{
+	RB_UNUSED_PARAM;
+	int level;
+	VALUE track = Qnil;
+	rb_get_args(argc, argv, "i|o", &level, &track RB_ARG_END);
+	shState->audio().bgmSetSend(level, MAYBE_NIL_TRACK(track));
+	return Qnil;
+}
+RB_METHOD_GUARD_END
+
+RB_METHOD_GUARD(audio_bgmSetLowPass)
+{
+	RB_UNUSED_PARAM;
+	int level;
+	VALUE track = Qnil;
+	rb_get_args(argc, argv, "i|o", &level, &track RB_ARG_END);
+	shState->audio().bgmSetLowPass(level, MAYBE_NIL_TRACK(track));
+	return Qnil;
+}
+RB_METHOD_GUARD_END
+
+#define DEF_SEND_LOWPASS(entity) \
+RB_METHOD(audio_##entity##SetSend) \
+{ \
+	RB_UNUSED_PARAM; \
+	int level; \
+	rb_get_args(argc, argv, "i", &level RB_ARG_END); \
+	shState->audio().entity##SetSend(level); \
+	return Qnil; \
+} \
+RB_METHOD(audio_##entity##SetLowPass) \
+{ \
+	RB_UNUSED_PARAM; \
+	int level; \
+	rb_get_args(argc, argv, "i", &level RB_ARG_END); \
+	shState->audio().entity##SetLowPass(level); \
+	return Qnil; \
+}
+
+DEF_SEND_LOWPASS( bgs )
+DEF_SEND_LOWPASS( me )
+DEF_SEND_LOWPASS( se )
+
 RB_METHOD(audioSetupMidi)
 {
 	RB_UNUSED_PARAM;
@@ -226,6 +345,21 @@ audioBindingInit()
 
 	BIND_PLAY_STOP( se )
 	_rb_define_module_function(module, "se_play_position", se_playPosition);
+	_rb_define_module_function(module, "se_preload", audio_sePreload);
+	_rb_define_module_function(module, "se_stats", audio_seStats);
+	_rb_define_module_function(module, "stats", audio_stats);
+
+	_rb_define_module_function(module, "fx_reverb", audio_fxReverb);
+	_rb_define_module_function(module, "bgm_set_send", audio_bgmSetSend);
+	_rb_define_module_function(module, "bgm_set_lowpass", audio_bgmSetLowPass);
+
+#define BIND_SEND_LOWPASS(entity) \
+	_rb_define_module_function(module, #entity "_set_send", audio_##entity##SetSend); \
+	_rb_define_module_function(module, #entity "_set_lowpass", audio_##entity##SetLowPass);
+
+	BIND_SEND_LOWPASS( bgs )
+	BIND_SEND_LOWPASS( me )
+	BIND_SEND_LOWPASS( se )
 
 	_rb_define_module_function(module, "__reset__", audioReset);
 }
@@ -27,6 +27,8 @@
 
 #include "util/util.h"
 #include "util/sdl-util.h"
+#include "util/boottrace.h"
+#include "util/zonetrace.h"
 #include "util/debugwriter.h"
 #include "util/boost-hash.h"
 #include "util/exception.h"
@@ -42,6 +44,9 @@
 
 #include <vector>
 #include "util/rapidcsv.h"
+#include "etc/table.h"
+#include "display/gl/texpool.h"
+#include "display/gl/vramstats.h"
 
 extern "C" {
 #include <ruby.h>
@@ -56,6 +61,8 @@ extern "C" {
 #endif
 
 #include <assert.h>
+#include <algorithm>
+#include <map>
 #include <string>
 #include <zlib.h>
 
@@ -88,6 +95,12 @@ void windowBindingInit();
 void tilemapBindingInit();
 void windowVXBindingInit();
 void tilemapVXBindingInit();
+void videoBindingInit();
+void textLayoutBindingInit();
+void asyncOpBindingInit();
+void profilerBindingInit();
+
+void rpgNativeBindingInit();
 
 void inputBindingInit();
 void audioBindingInit();
@@ -131,6 +144,9 @@ RB_METHOD(mkxpPowerState);
 RB_METHOD(mkxpSettingsMenu);
 RB_METHOD(mkxpCpuCount);
 RB_METHOD(mkxpSystemMemory);
+RB_METHOD(mkxpMemoryReport);
+RB_METHOD(mkxpSnapshot);
+RB_METHOD(mkxpRestore);
 RB_METHOD(mkxpReloadPathCache);
 RB_METHOD(mkxpAddPath);
 RB_METHOD(mkxpRemovePath);
@@ -156,6 +172,7 @@ json5pp::value rb2json(VALUE v);
 RB_METHOD(mkxpParseCSV);
 
 static void mriBindingInit() {
+    asyncOpBindingInit();
     tableBindingInit();
     etcBindingInit();
     fontBindingInit();
@@ -167,15 +184,20 @@ static void mriBindingInit() {
     if (rgssVer == 1) {
         windowBindingInit();
         tilemapBindingInit();
+        rpgNativeBindingInit();
     } else {
         windowVXBindingInit();
         tilemapVXBindingInit();
     }
     
+    videoBindingInit();
+    textLayoutBindingInit();
+    profilerBindingInit();
+
     inputBindingInit();
     audioBindingInit();
     graphicsBindingInit();
-    
+
     fileIntBindingInit();
     
 #ifdef MKXPZ_MINIFFI
@@ -215,6 +237,8 @@ static void mriBindingInit() {
         assert(!"unreachable");
     
     VALUE mod = rb_define_module("System");
+    VALUE cSnapshot = rb_define_class_under(mod, "Snapshot", rb_cObject);
+    rb_undef_alloc_func(cSnapshot);
     _rb_define_module_function(mod, "delta", mkxpDelta);
     _rb_define_module_function(mod, "uptime", mkxpDelta);
     _rb_define_module_function(mod, "data_directory", mkxpDataDirectory);
@@ -244,6 +268,9 @@ static void mriBindingInit() {
     _rb_define_module_function(mod, "power_state", mkxpPowerState);
     _rb_define_module_function(mod, "nproc", mkxpCpuCount);
     _rb_define_module_function(mod, "memory", mkxpSystemMemory);
+    _rb_define_module_function(mod, "memory_report", mkxpMemoryReport);
+    _rb_define_module_function(mod, "snapshot", mkxpSnapshot);
+    _rb_define_module_function(mod, "restore", mkxpRestore);
     _rb_define_module_function(mod, "reload_cache", mkxpReloadPathCache);
     _rb_define_module_function(mod, "mount", mkxpAddPath);
     _rb_define_module_function(mod, "unmount", mkxpRemovePath);
@@ -535,6 +562,134 @@ RB_METHOD(mkxpCpuCount) {
     return INT2NUM(SDL_GetCPUCount());
 }
 
+/* ---- Fast engine save-state (System.snapshot / System.restore) ----
+ *
+ * Captures the C++-side state that RGSS save files have to lug
+ * through Marshal - audio channel positions and the graphics
+ * counters - in one native pass, and restores it without running
+ * any script code. Ruby-side data pairs with cheap Table#clone
+ * copies (COW cell storage), which is what makes instant-retry
+ * features viable */
+struct EngineSnapshot
+{
+    std::vector<Audio::ChannelState> bgm;
+    Audio::ChannelState bgs;
+    int frameCount;
+    int brightness;
+};
+
+static void engineSnapshotFree(void *ptr) {
+    delete static_cast<EngineSnapshot *>(ptr);
+}
+
+#if RAPI_FULL > 187
+static const rb_data_type_t EngineSnapshotType = {
+    "EngineSnapshot",
+    { 0, engineSnapshotFree, 0 },
+    0, 0,
+#if RAPI_FULL >= 210
+    0,
+#endif
+};
+#endif
+
+RB_METHOD(mkxpSnapshot) {
+    RB_UNUSED_PARAM;
+
+    rb_check_argc(argc, 0);
+
+    EngineSnapshot *snap = new EngineSnapshot;
+
+    shState->audio().captureState(snap->bgm, snap->bgs);
+    snap->frameCount = shState->graphics().getFrameCount();
+    snap->brightness = shState->graphics().getBrightness();
+
+    VALUE klass = rb_const_get(rb_const_get(rb_cObject, rb_intern("System")),
+                               rb_intern("Snapshot"));
+
+#if RAPI_FULL > 187
+    return TypedData_Wrap_Struct(klass, &EngineSnapshotType, snap);
+#else
+    return Data_Wrap_Struct(klass, 0, engineSnapshotFree, snap);
+#endif
+}
+
+RB_METHOD_GUARD(mkxpRestore) {
+    RB_UNUSED_PARAM;
+
+    VALUE obj;
+    rb_scan_args(argc, argv, "1", &obj);
+
+#if RAPI_FULL > 187
+    if (!RTYPEDDATA_P(obj) || RTYPEDDATA_TYPE(obj) != &EngineSnapshotType)
+        rb_raise(rb_eTypeError, "expected a System::Snapshot");
+
+    EngineSnapshot *snap =
+        static_cast<EngineSnapshot *>(RTYPEDDATA_DATA(obj));
+#else
+    EngineSnapshot *snap = static_cast<EngineSnapshot *>(DATA_PTR(obj));
+#endif
+
+    shState->audio().restoreState(snap->bgm, snap->bgs);
+
+    GFX_GUARD_EXC(
+        shState->graphics().setFrameCount(snap->frameCount);
+        shState->graphics().setBrightness(snap->brightness);
+    );
+
+    return Qnil;
+}
+RB_METHOD_GUARD_END
+
+/* Engine-side memory report (System.memory_report, also dumped at
+ * quit): native malloc introspection where the platform offers it,
+ * plus the per-subsystem tallies the engine tracks itself. Combine
+ * with GC.stat on the script side for the Ruby heap picture */
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+static void memoryReportFill(uint64_t &mallocUsed, uint64_t &mallocFree,
+                             uint64_t &tables, uint64_t &seCache,
+                             uint64_t &prefetch, uint64_t &texPool,
+                             uint64_t &vram)
+{
+    mallocUsed = 0;
+    mallocFree = 0;
+
+#if defined(__GLIBC__) && defined(__GLIBC_PREREQ)
+#if __GLIBC_PREREQ(2, 33)
+    struct mallinfo2 mi = mallinfo2();
+    mallocUsed = (uint64_t) mi.uordblks;
+    mallocFree = (uint64_t) mi.fordblks;
+#endif
+#endif
+
+    tables = Table::totalBytes();
+    seCache = shState->audio().seBytes();
+    prefetch = (uint64_t) shState->fileSystem().prefetchUsage();
+    texPool = shState->texPool().stats().cachedBytes;
+    vram = VramStats::totalBytes();
+}
+
+RB_METHOD(mkxpMemoryReport) {
+    RB_UNUSED_PARAM;
+
+    uint64_t mallocUsed, mallocFree, tables, se, pre, pool, vram;
+    memoryReportFill(mallocUsed, mallocFree, tables, se, pre, pool, vram);
+
+    VALUE ret = rb_hash_new();
+    rb_hash_aset(ret, ID2SYM(rb_intern("malloc_used")), ULL2NUM(mallocUsed));
+    rb_hash_aset(ret, ID2SYM(rb_intern("malloc_free")), ULL2NUM(mallocFree));
+    rb_hash_aset(ret, ID2SYM(rb_intern("table_bytes")), ULL2NUM(tables));
+    rb_hash_aset(ret, ID2SYM(rb_intern("se_cache_bytes")), ULL2NUM(se));
+    rb_hash_aset(ret, ID2SYM(rb_intern("prefetch_bytes")), ULL2NUM(pre));
+    rb_hash_aset(ret, ID2SYM(rb_intern("tex_pool_bytes")), ULL2NUM(pool));
+    rb_hash_aset(ret, ID2SYM(rb_intern("vram_bytes")), ULL2NUM(vram));
+
+    return ret;
+}
+
 RB_METHOD(mkxpSystemMemory) {
     RB_UNUSED_PARAM;
     
@@ -543,8 +698,16 @@ RB_METHOD(mkxpSystemMemory) {
 
 RB_METHOD_GUARD(mkxpReloadPathCache) {
     RB_UNUSED_PARAM;
-    
-    shState->fileSystem().reloadPathCache();
+
+    VALUE subtree;
+    rb_scan_args(argc, argv, "01", &subtree);
+
+    if (subtree == Qnil) {
+        shState->fileSystem().reloadPathCache();
+    } else {
+        SafeStringValue(subtree);
+        shState->fileSystem().reloadPathCache(RSTRING_PTR(subtree));
+    }
     return Qnil;
 }
 RB_METHOD_GUARD_END
@@ -943,7 +1106,290 @@ bool evalScript(VALUE string, const char *filename)
 
 #define SCRIPT_SECTION_FMT (rgssVer >= 3 ? "{%04ld}" : "Section%03ld")
 
+#if RAPI_FULL >= 230
+#define MKXPZ_ISEQ_CACHE
+#endif
+
+#ifdef MKXPZ_ISEQ_CACHE
+
+/* ---- Persistent bytecode cache ----
+ *
+ * Re-parsing two megabytes of scripts every launch is pure
+ * repeated work; compiled InstructionSequence binaries are
+ * cached keyed by section source hash, bound to the exact
+ * Ruby build description, and loaded directly on later
+ * boots. Lives beside the other derived caches in
+ * customDataPath. Any mismatch or corruption falls back to
+ * a plain compile of that section */
+
+#define ISEQ_CACHE_MAGIC "MKXPISEQ"
+#define ISEQ_CACHE_VERSION 1
+#define ISEQ_CACHE_NAME "scripts.iseqcache"
+
+struct IseqCache {
+    std::map<uint64_t, std::string> entries;
+
+    /* Entries hit or compiled this boot; only these are
+     * persisted, so stale bytecode from edited scripts
+     * doesn't accumulate forever */
+    std::map<uint64_t, std::string> used;
+
+    std::string path;
+    bool dirty;
+
+    IseqCache() : dirty(false) {}
+};
+
+static uint64_t iseqHash(const char *data, size_t len) {
+    uint64_t hash = 0xcbf29ce484222325ull;
+
+    for (size_t i = 0; i < len; ++i) {
+        hash ^= (uint8_t) data[i];
+        hash *= 0x100000001b3ull;
+    }
+
+    return hash;
+}
+
+static std::string rubyBuildDesc() {
+    VALUE desc = rb_const_get(rb_cObject, rb_intern("RUBY_DESCRIPTION"));
+
+    return std::string(RSTRING_PTR(desc), RSTRING_LEN(desc));
+}
+
+static bool iseqCacheRead32(const uint8_t *&p, const uint8_t *end,
+                            uint32_t &v) {
+    if (end - p < 4)
+        return false;
+
+    v = (uint32_t) p[0] | ((uint32_t) p[1] << 8) |
+        ((uint32_t) p[2] << 16) | ((uint32_t) p[3] << 24);
+    p += 4;
+
+    return true;
+}
+
+static void iseqCachePut32(std::string &out, uint32_t v) {
+    for (int i = 0; i < 4; ++i)
+        out.push_back((char) ((v >> (8 * i)) & 0xFF));
+}
+
+static void loadIseqCache(IseqCache &cache) {
+    FILE *f = fopen(cache.path.c_str(), "rb");
+
+    if (!f)
+        return;
+
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+
+    if (size <= 0) {
+        fclose(f);
+        return;
+    }
+
+    std::vector<uint8_t> blob(size);
+    bool readOk = (fread(blob.data(), 1, size, f) == (size_t) size);
+    fclose(f);
+
+    if (!readOk)
+        return;
+
+    const uint8_t *p = blob.data();
+    const uint8_t *end = p + blob.size();
+
+    uint32_t version, descLen, count;
+
+    if (end - p < 8 || memcmp(p, ISEQ_CACHE_MAGIC, 8))
+        return;
+
+    p += 8;
+
+    if (!iseqCacheRead32(p, end, version) || version != ISEQ_CACHE_VERSION
+    ||  !iseqCacheRead32(p, end, descLen) || (uint32_t) (end - p) < descLen)
+        return;
+
+    std::string desc(reinterpret_cast<const char *>(p), descLen);
+    p += descLen;
+
+    /* Bytecode is only valid for the exact build that wrote it */
+    if (desc != rubyBuildDesc())
+        return;
+
+    if (!iseqCacheRead32(p, end, count))
+        return;
+
+    for (uint32_t i = 0; i < count; ++i) {
+        uint32_t hashLo, hashHi, len;
+
+        if (!iseqCacheRead32(p, end, hashLo)
+        ||  !iseqCacheRead32(p, end, hashHi)
+        ||  !iseqCacheRead32(p, end, len)
+        ||  (uint32_t) (end - p) < len) {
+            cache.entries.clear();
+            return;
+        }
+
+        uint64_t hash = (uint64_t) hashLo | ((uint64_t) hashHi << 32);
+
+        cache.entries[hash] =
+            std::string(reinterpret_cast<const char *>(p), len);
+        p += len;
+    }
+}
+
+static void saveIseqCache(const IseqCache &cache) {
+    std::string out;
+
+    out.append(ISEQ_CACHE_MAGIC);
+    iseqCachePut32(out, ISEQ_CACHE_VERSION);
+
+    std::string desc = rubyBuildDesc();
+    iseqCachePut32(out, (uint32_t) desc.size());
+    out.append(desc);
+
+    iseqCachePut32(out, (uint32_t) cache.used.size());
+
+    std::map<uint64_t, std::string>::const_iterator it;
+
+    for (it = cache.used.begin(); it != cache.used.end(); ++it) {
+        iseqCachePut32(out, (uint32_t) (it->first & 0xFFFFFFFF));
+        iseqCachePut32(out, (uint32_t) (it->first >> 32));
+        iseqCachePut32(out, (uint32_t) it->second.size());
+        out.append(it->second);
+    }
+
+    std::string tmp = cache.path + ".tmp";
+
+    FILE *f = fopen(tmp.c_str(), "wb");
+
+    if (!f)
+        return;
+
+    bool ok = (fwrite(out.data(), 1, out.size(), f) == out.size());
+    fclose(f);
+
+    if (!ok) {
+        remove(tmp.c_str());
+        return;
+    }
+
+    remove(cache.path.c_str());
+    rename(tmp.c_str(), cache.path.c_str());
+}
+
+struct IseqCompileArg {
+    VALUE src, fname;
+};
+
+static VALUE iseqCompileHelper(VALUE a) {
+    IseqCompileArg *arg = (IseqCompileArg *) a;
+
+    VALUE klass = rb_path2class("RubyVM::InstructionSequence");
+    VALUE argv[] = { arg->src, arg->fname, arg->fname, INT2FIX(1) };
+
+    return rb_funcall2(klass, rb_intern("compile"), ARRAY_SIZE(argv), argv);
+}
+
+static VALUE iseqLoadBinHelper(VALUE bin) {
+    VALUE klass = rb_path2class("RubyVM::InstructionSequence");
+
+    return rb_funcall(klass, rb_intern("load_from_binary"), 1, bin);
+}
+
+static VALUE iseqToBinHelper(VALUE iseq) {
+    return rb_funcall(iseq, rb_intern("to_binary"), 0);
+}
+
+static VALUE iseqEvalHelper(VALUE iseq) {
+    return rb_funcall(iseq, rb_intern("eval"), 0);
+}
+
+#endif /* MKXPZ_ISEQ_CACHE */
+
+/* Inflating 1000+ script sections serially dominates boot on
+ * big projects; the sections are independent, so a small
+ * worker pool (the calling thread included) decompresses them
+ * all in parallel while the GVL is dropped. Deferring the
+ * *evaluation* of scripts is deliberately not attempted:
+ * top-level RMXP scripts are order-dependent and side
+ * effecting, so only the decode is safe to parallelize */
+struct ScriptInflateJob {
+    /* Compressed snapshot; the Ruby string buffers may move
+     * once the GVL is released */
+    std::vector<unsigned char> compressed;
+    std::string result;
+    int zResult;
+    bool valid;
+
+    ScriptInflateJob()
+        : zResult(Z_OK), valid(false)
+    {}
+};
+
+struct ScriptInflatePool {
+    std::vector<ScriptInflateJob> *jobs;
+    SDL_atomic_t next;
+
+    void workerFun() {
+        while (true) {
+            int i = SDL_AtomicAdd(&next, 1);
+
+            if (i >= (int) jobs->size())
+                break;
+
+            ScriptInflateJob &job = (*jobs)[i];
+
+            if (!job.valid)
+                continue;
+
+            job.result.resize(std::max<size_t>(job.compressed.size() * 4,
+                                               0x1000));
+
+            while (true) {
+                unsigned long bufferLen = job.result.size();
+
+                job.zResult = uncompress(
+                    reinterpret_cast<unsigned char *>(&job.result[0]),
+                    &bufferLen, job.compressed.data(),
+                    job.compressed.size());
+
+                if (job.zResult != Z_BUF_ERROR) {
+                    if (job.zResult == Z_OK)
+                        job.result.resize(bufferLen);
+
+                    break;
+                }
+
+                job.result.resize(job.result.size() * 2);
+            }
+        }
+    }
+};
+
+static void *inflateScriptsParallel(void *p) {
+    ScriptInflatePool &pool = *((ScriptInflatePool *) p);
+
+    int threads = clamp(SDL_GetCPUCount() - 1, 0, 7);
+    std::vector<SDL_Thread *> workers;
+
+    for (int i = 0; i < threads; ++i)
+        workers.push_back(createSDLThread
+            <ScriptInflatePool, &ScriptInflatePool::workerFun>(
+                &pool, "script_inflate"));
+
+    /* This thread takes a share as well */
+    pool.workerFun();
+
+    for (size_t i = 0; i < workers.size(); ++i)
+        SDL_WaitThread(workers[i], 0);
+
+    return 0;
+}
+
 static void runRMXPScripts(BacktraceData &btData) {
+    BootTrace::begin("scripts-load");
     const Config &conf = shState->rtData().config;
     const std::string &scriptPack = conf.game.scripts;
     
@@ -980,52 +1426,60 @@ static void runRMXPScripts(BacktraceData &btData) {
     rb_gv_set("$RGSS_SCRIPTS", scriptArray);
     
     long scriptCount = RARRAY_LEN(scriptArray);
-    
-    std::string decodeBuffer;
-    decodeBuffer.resize(0x1000);
-    
+
+    /* Snapshot the compressed sections with the GVL held */
+    std::vector<ScriptInflateJob> jobs(scriptCount);
+
     for (long i = 0; i < scriptCount; ++i) {
         VALUE script = rb_ary_entry(scriptArray, i);
-        
+
         if (!RB_TYPE_P(script, RUBY_T_ARRAY))
             continue;
-        
-        VALUE scriptName = rb_ary_entry(script, 1);
+
         VALUE scriptString = rb_ary_entry(script, 2);
-        
-        int result = Z_OK;
-        unsigned long bufferLen;
-        
-        while (true) {
-            unsigned char *bufferPtr = reinterpret_cast<unsigned char *>(
-                                                                         const_cast<char *>(decodeBuffer.c_str()));
-            const unsigned char *sourcePtr =
-            reinterpret_cast<const unsigned char *>(RSTRING_PTR(scriptString));
-            
-            bufferLen = decodeBuffer.length();
-            
-            result = uncompress(bufferPtr, &bufferLen, sourcePtr,
-                                RSTRING_LEN(scriptString));
-            
-            bufferPtr[bufferLen] = '\0';
-            
-            if (result != Z_BUF_ERROR)
-                break;
-            
-            decodeBuffer.resize(decodeBuffer.size() * 2);
-        }
-        
-        if (result != Z_OK) {
+
+        if (!RB_TYPE_P(scriptString, RUBY_T_STRING))
+            continue;
+
+        jobs[i].valid = true;
+        jobs[i].compressed.assign(
+            reinterpret_cast<const unsigned char *>(RSTRING_PTR(scriptString)),
+            reinterpret_cast<const unsigned char *>(RSTRING_PTR(scriptString))
+                + RSTRING_LEN(scriptString));
+    }
+
+    /* Inflate everything across the cores, GVL dropped */
+    ScriptInflatePool pool;
+    pool.jobs = &jobs;
+    SDL_AtomicSet(&pool.next, 0);
+
+#if RAPI_MAJOR >= 2
+    drop_gvl_guard(inflateScriptsParallel, &pool, 0, 0);
+#else
+    inflateScriptsParallel(&pool);
+#endif
+
+    /* Store the results back (and report the first failure
+     * the way the serial loop did) */
+    for (long i = 0; i < scriptCount; ++i) {
+        if (!jobs[i].valid)
+            continue;
+
+        VALUE script = rb_ary_entry(scriptArray, i);
+
+        if (jobs[i].zResult != Z_OK) {
             static char buffer[256];
             snprintf(buffer, sizeof(buffer), "Error decoding script %ld: '%s'", i,
-                     RSTRING_PTR(scriptName));
-            
+                     RSTRING_PTR(rb_ary_entry(script, 1)));
+
             showMsg(buffer);
-            
+
             break;
         }
-        
-        rb_ary_store(script, 3, rb_utf8_str_new_cstr(decodeBuffer.c_str()));
+
+        rb_ary_store(script, 3,
+                     newStringUTF8(jobs[i].result.data(),
+                                   jobs[i].result.size()));
     }
     
     /* Execute preloaded scripts */
@@ -1040,27 +1494,149 @@ static void runRMXPScripts(BacktraceData &btData) {
     VALUE exc = rb_gv_get("$!");
     if (exc != Qnil)
         return;
-    
+
+#ifdef MKXPZ_ISEQ_CACHE
+    /* Compile phase, cache assisted: sections whose source
+     * hash is in the bytecode cache skip the parser entirely.
+     * The resulting iseq array is what the (re)run loop below
+     * evaluates, so engine resets don't re-parse either */
+    IseqCache iseqCache;
+
+    if (!conf.customDataPath.empty()) {
+        iseqCache.path = conf.customDataPath + "/" ISEQ_CACHE_NAME;
+        loadIseqCache(iseqCache);
+    }
+
+    VALUE iseqArray = rb_ary_new();
+
+    for (long i = 0; i < scriptCount; ++i) {
+        VALUE script = rb_ary_entry(scriptArray, i);
+
+        if (!RB_TYPE_P(script, RUBY_T_ARRAY))
+            continue;
+
+        VALUE scriptDecoded = rb_ary_entry(script, 3);
+
+        if (!RB_TYPE_P(scriptDecoded, RUBY_T_STRING))
+            continue;
+
+        const char *scriptName = RSTRING_PTR(rb_ary_entry(script, 1));
+        char buf[512];
+        int len;
+
+        if (conf.useScriptNames)
+            len = snprintf(buf, sizeof(buf), "%03ld:%s", i, scriptName);
+        else
+            len = snprintf(buf, sizeof(buf), SCRIPT_SECTION_FMT, i);
+
+        VALUE fname = newStringUTF8(buf, len);
+        btData.scriptNames.insert(buf, scriptName);
+
+        uint64_t hash = iseqHash(RSTRING_PTR(scriptDecoded),
+                                 RSTRING_LEN(scriptDecoded));
+
+        VALUE iseq = Qnil;
+        int state = 0;
+
+        std::map<uint64_t, std::string>::const_iterator hit =
+            iseqCache.entries.find(hash);
+
+        if (hit != iseqCache.entries.end()) {
+            VALUE bin = rb_str_new(hit->second.data(), hit->second.size());
+
+            iseq = rb_protect(iseqLoadBinHelper, bin, &state);
+
+            if (state) {
+                /* Stale or corrupt entry; recompile below */
+                rb_set_errinfo(Qnil);
+                iseq = Qnil;
+                state = 0;
+            } else {
+                iseqCache.used[hash] = hit->second;
+            }
+        }
+
+        if (NIL_P(iseq)) {
+            VALUE string = newStringUTF8(RSTRING_PTR(scriptDecoded),
+                                         RSTRING_LEN(scriptDecoded));
+
+            IseqCompileArg arg = { string, fname };
+
+            iseq = rb_protect(iseqCompileHelper, (VALUE) &arg, &state);
+
+            /* Syntax errors surface here, before anything ran;
+             * $! is set and handled by our caller */
+            if (state)
+                return;
+
+            VALUE bin = rb_protect(iseqToBinHelper, iseq, &state);
+
+            if (state) {
+                rb_set_errinfo(Qnil);
+                state = 0;
+            } else {
+                iseqCache.used[hash] =
+                    std::string(RSTRING_PTR(bin), RSTRING_LEN(bin));
+                iseqCache.dirty = true;
+            }
+        }
+
+        rb_ary_store(iseqArray, i, iseq);
+    }
+
+    /* Rewrite when anything was compiled fresh or entries
+     * went stale (used set smaller than what was loaded) */
+    if (!iseqCache.path.empty()
+    &&  (iseqCache.dirty
+         || iseqCache.used.size() != iseqCache.entries.size()))
+        saveIseqCache(iseqCache);
+
+    /* Boot ends where gameplay scripts start executing: flush the
+     * timeline (or drop it when bootTrace is off) */
+    BootTrace::end();
+    BootTrace::finish(conf.bootTrace,
+                      conf.customDataPath.empty()
+                          ? std::string()
+                          : conf.customDataPath + "/boottrace.json");
+
     while (true) {
         for (long i = 0; i < scriptCount; ++i) {
             if (shState->rtData().rqTerm)
                 break;
-            
+
+            VALUE iseq = rb_ary_entry(iseqArray, i);
+
+            if (NIL_P(iseq))
+                continue;
+
+            int state;
+
+            ZONE_SCOPED("script-eval");
+            rb_protect(iseqEvalHelper, iseq, &state);
+            if (state)
+                break;
+        }
+#else
+    while (true) {
+        for (long i = 0; i < scriptCount; ++i) {
+            if (shState->rtData().rqTerm)
+                break;
+
             VALUE script = rb_ary_entry(scriptArray, i);
             VALUE scriptDecoded = rb_ary_entry(script, 3);
             VALUE string =
             newStringUTF8(RSTRING_PTR(scriptDecoded), RSTRING_LEN(scriptDecoded));
-            
+
             VALUE fname;
             const char *scriptName = RSTRING_PTR(rb_ary_entry(script, 1));
             char buf[512];
             int len;
-            
+
             if (conf.useScriptNames)
                 len = snprintf(buf, sizeof(buf), "%03ld:%s", i, scriptName);
             else
                 len = snprintf(buf, sizeof(buf), SCRIPT_SECTION_FMT, i);
-            
+
             fname = newStringUTF8(buf, len);
             btData.scriptNames.insert(buf, scriptName);
             
@@ -1090,16 +1666,17 @@ static void runRMXPScripts(BacktraceData &btData) {
              */
             
             int state;
-            
+
             evalString(string, fname, &state);
             if (state)
                 break;
         }
-        
+#endif
+
         VALUE exc = rb_gv_get("$!");
         if (rb_obj_class(exc) != getRbData()->exc[Reset])
             break;
-        
+
         if (processReset(false))
             break;
     }
@@ -1304,7 +1881,29 @@ static void mriBindingExecute() {
 #endif
     if (!NIL_P(exc) && !rb_obj_is_kind_of(exc, rb_eSystemExit))
         showExc(exc, btData);
-    
+
+    /* Quit-time memory report: leak-shaped growth shows up in the
+     * playtest log instead of a player report */
+    {
+        uint64_t mallocUsed, mallocFree, tables, se, pre, pool, vram;
+        memoryReportFill(mallocUsed, mallocFree, tables, se, pre, pool, vram);
+
+        char buf[256];
+        snprintf(buf, sizeof(buf),
+                 "memory-report {\"malloc_used\":%llu,\"malloc_free\":%llu,"
+                 "\"table_bytes\":%llu,\"se_cache_bytes\":%llu,"
+                 "\"prefetch_bytes\":%llu,\"tex_pool_bytes\":%llu,"
+                 "\"vram_bytes\":%llu}",
+                 (unsigned long long) mallocUsed,
+                 (unsigned long long) mallocFree,
+                 (unsigned long long) tables,
+                 (unsigned long long) se,
+                 (unsigned long long) pre,
+                 (unsigned long long) pool,
+                 (unsigned long long) vram);
+        Debug() << buf;
+    }
+
     ruby_cleanup(0);
     
     shState->rtData().rqTermAck.set();
@@ -56,6 +56,151 @@ RbData::RbData() {
 
 RbData::~RbData() {}
 
+/* ---- AsyncOp ----
+ *
+ * Generic awaitable handle over an engine-side async operation.
+ * The handle owns the impl; once the op completes, the result
+ * VALUE is cached (and GC-marked) on the handle so result can be
+ * read any number of times */
+
+struct AsyncOpData
+{
+  AsyncOpImpl *impl;
+  VALUE result;
+  bool finished;
+};
+
+static void asyncOpMark(void *ptr) {
+  AsyncOpData *d = static_cast<AsyncOpData *>(ptr);
+
+  if (d->finished)
+    rb_gc_mark(d->result);
+}
+
+static void asyncOpFree(void *ptr) {
+  AsyncOpData *d = static_cast<AsyncOpData *>(ptr);
+
+  delete d->impl;
+  delete d;
+}
+
+#if RAPI_FULL > 187
+static const rb_data_type_t AsyncOpType = {
+    "AsyncOp",
+    { asyncOpMark, asyncOpFree, 0 },
+    0, 0,
+#if RAPI_FULL >= 210
+    0,
+#endif
+};
+#endif
+
+static AsyncOpData *getAsyncOp(VALUE self) {
+#if RAPI_FULL > 187
+  return static_cast<AsyncOpData *>(RTYPEDDATA_DATA(self));
+#else
+  return static_cast<AsyncOpData *>(DATA_PTR(self));
+#endif
+}
+
+VALUE wrapAsyncOp(AsyncOpImpl *impl) {
+  VALUE klass = rb_const_get(rb_cObject, rb_intern("AsyncOp"));
+
+  AsyncOpData *d = new AsyncOpData;
+  d->impl = impl;
+  d->result = Qnil;
+  d->finished = false;
+
+#if RAPI_FULL > 187
+  return TypedData_Wrap_Struct(klass, &AsyncOpType, d);
+#else
+  return Data_Wrap_Struct(klass, asyncOpMark, asyncOpFree, d);
+#endif
+}
+
+/* Polls the impl, latching the result on completion */
+static bool asyncOpPoll(AsyncOpData *d) {
+  if (d->finished)
+    return true;
+
+  if (!d->impl->done())
+    return false;
+
+  d->result = d->impl->result();
+  d->finished = true;
+
+  return true;
+}
+
+/* The fiber the binding was initialized on; await from any other
+ * fiber yields instead of pumping frames itself */
+static VALUE asyncRootFiber = Qnil;
+
+static bool insideNonRootFiber() {
+  if (asyncRootFiber == Qnil)
+    return false;
+
+  VALUE fiber = rb_const_get(rb_cObject, rb_intern("Fiber"));
+
+  return rb_funcall(fiber, rb_intern("current"), 0) != asyncRootFiber;
+}
+
+RB_METHOD(asyncOpDone)
+{
+  RB_UNUSED_PARAM;
+
+  return rb_bool_new(asyncOpPoll(getAsyncOp(self)));
+}
+
+RB_METHOD(asyncOpResult)
+{
+  RB_UNUSED_PARAM;
+
+  AsyncOpData *d = getAsyncOp(self);
+
+  return asyncOpPoll(d) ? d->result : Qnil;
+}
+
+RB_METHOD_GUARD(asyncOpAwait)
+{
+  RB_UNUSED_PARAM;
+
+  AsyncOpData *d = getAsyncOp(self);
+
+  VALUE graphics = rb_const_get(rb_cObject, rb_intern("Graphics"));
+  ID update = rb_intern("update");
+
+  while (!asyncOpPoll(d))
+  {
+    if (insideNonRootFiber())
+      rb_funcall(rb_const_get(rb_cObject, rb_intern("Fiber")),
+                 rb_intern("yield"), 0);
+    else
+      rb_funcall(graphics, update, 0);
+  }
+
+  return d->result;
+}
+RB_METHOD_GUARD_END
+
+void asyncOpBindingInit() {
+  VALUE klass = rb_define_class("AsyncOp", rb_cObject);
+  rb_undef_alloc_func(klass);
+
+  _rb_define_method(klass, "done?", asyncOpDone);
+  _rb_define_method(klass, "result", asyncOpResult);
+  _rb_define_method(klass, "await", asyncOpAwait);
+
+  /* Remember the main fiber (when Fibers exist at all), so await
+   * can tell a scheduler-driven fiber from the root loop */
+  if (rb_const_defined(rb_cObject, rb_intern("Fiber")))
+  {
+    asyncRootFiber = rb_funcall(rb_const_get(rb_cObject, rb_intern("Fiber")),
+                                rb_intern("current"), 0);
+    rb_gc_register_address(&asyncRootFiber);
+  }
+}
+
 /* Indexed with Exception::Type */
 const RbException excToRbExc[] = {
     RGSS,        /* RGSSError          */
@@ -223,6 +223,29 @@ template <class C> static void freeInstance(void *inst) {
 
 void raiseDisposedAccess(VALUE self);
 
+/* Engine-side async operation exposed to scripts as an AsyncOp
+ * handle: poll with done?, fetch the value with result, or call
+ * await, which keeps pumping Graphics.update (or yields the
+ * enclosing Fiber, so a scheduler on the main loop can resume it
+ * next frame) until the operation completes. Implementations are
+ * only ever polled on the script thread */
+struct AsyncOpImpl
+{
+	virtual ~AsyncOpImpl() {}
+
+	/* Non-blocking completion poll */
+	virtual bool done() = 0;
+
+	/* Called once, the first time done() returns true; the
+	 * returned VALUE is retained by the handle afterwards */
+	virtual VALUE result() = 0;
+};
+
+/* Takes ownership of impl */
+VALUE wrapAsyncOp(AsyncOpImpl *impl);
+
+void asyncOpBindingInit();
+
 template <class C> inline C *getPrivateDataNoRaise(VALUE self) {
 #if RAPI_FULL > 187
     return static_cast<C *>(RTYPEDDATA_DATA(self));
@@ -334,6 +357,14 @@ inline VALUE wrapProperty(VALUE self, void *prop, const char *iv,
     return propObj;
 }
 
+/* rb_iv_get/set by name re-intern their literal on every
+ * call, which adds up on the per-frame property getters.
+ * Each expansion site caches its interned ID in a function
+ * local static instead: interned once on first use, served
+ * from the cache after */
+#define CACHED_ID(name) \
+    ([]() -> ID { static ID cachedId = rb_intern(name); return cachedId; }())
+
 /* Implemented: oSszfibn| */
 int rb_get_args(int argc, VALUE *argv, const char *format, ...);
 
@@ -374,6 +405,20 @@ throw exc;                                                               \
 GFX_UNLOCK;                                                              \
 }
 
+/* Like GFX_GUARD_EXC, but doesn't count as scene damage; only
+ * for entry points that merely run a frame (Graphics.update) */
+#define GFX_GUARD_EXC_CLEAN(exp)                                         \
+{                                                                        \
+GFX_LOCK_CLEAN;                                                          \
+try {                                                                    \
+exp                                                                      \
+} catch (const Exception &exc) {                                         \
+GFX_UNLOCK;                                                              \
+throw exc;                                                               \
+}                                                                        \
+GFX_UNLOCK;                                                              \
+}
+
 
 template <class C>
 static inline VALUE objectLoad(int argc, VALUE *argv, VALUE self) {
@@ -527,7 +572,7 @@ RB_METHOD_GUARD_END
 #define DEF_PROP_OBJ_REF(Klass, PropKlass, PropName, prop_iv)                  \
 RB_METHOD(Klass##Get##PropName) {                                            \
 RB_UNUSED_PARAM;                                                           \
-return rb_iv_get(self, prop_iv);                                           \
+return rb_ivar_get(self, CACHED_ID(prop_iv));                                           \
 }                                                                            \
 RB_METHOD_GUARD(Klass##Set##PropName) {                                    \
 RB_UNUSED_PARAM;                                                           \
@@ -540,7 +585,7 @@ prop = 0;                                                                \
 else                                                                       \
 prop = getPrivateDataCheck<PropKlass>(propObj, PropKlass##Type);         \
 k->set##PropName(prop)                                                     \
-rb_iv_set(self, prop_iv, propObj);                                         \
+rb_ivar_set(self, CACHED_ID(prop_iv), propObj);                                         \
 return propObj;                                                            \
 }                                                                          \
 RB_METHOD_GUARD_END
@@ -548,7 +593,7 @@ RB_METHOD_GUARD_END
 #define DEF_PROP_OBJ_REF(Klass, PropKlass, PropName, prop_iv)                  \
 RB_METHOD(Klass##Get##PropName) {                                            \
 RB_UNUSED_PARAM;                                                           \
-return rb_iv_get(self, prop_iv);                                           \
+return rb_ivar_get(self, CACHED_ID(prop_iv));                                           \
 }                                                                            \
 RB_METHOD_GUARD(Klass##Set##PropName) {                                    \
 RB_UNUSED_PARAM;                                                           \
@@ -561,7 +606,7 @@ prop = 0;                                                                \
 else                                                                       \
 prop = getPrivateDataCheck<PropKlass>(propObj, #PropKlass);              \
 k->set##PropName(prop)                                                     \
-rb_iv_set(self, prop_iv, propObj);                                         \
+rb_ivar_set(self, CACHED_ID(prop_iv), propObj);                                         \
 return propObj;                                                            \
 }                                                                          \
 RB_METHOD_GUARD_END
@@ -573,7 +618,7 @@ RB_METHOD_GUARD_END
 RB_METHOD(Klass##Get##PropName) {                                            \
 RB_UNUSED_PARAM;                                                           \
 checkDisposed<Klass>(self);                                                \
-return rb_iv_get(self, prop_iv);                                           \
+return rb_ivar_get(self, CACHED_ID(prop_iv));                                           \
 }                                                                            \
 RB_METHOD_GUARD(Klass##Set##PropName) {                                    \
 rb_check_argc(argc, 1);                                                    \
@@ -590,7 +635,7 @@ RB_METHOD_GUARD_END
 RB_METHOD(Klass##Get##PropName) {                                            \
 RB_UNUSED_PARAM;                                                           \
 checkDisposed<Klass>(self);                                                \
-return rb_iv_get(self, prop_iv);                                           \
+return rb_ivar_get(self, CACHED_ID(prop_iv));                                           \
 }                                                                            \
 RB_METHOD_GUARD(Klass##Set##PropName) {                                    \
 rb_check_argc(argc, 1);                                                    \
@@ -645,7 +690,7 @@ _rb_define_method(klass, prop_name_s "=", Klass##Set##PropName);           \
 #define DEF_GFX_PROP_OBJ_REF(Klass, PropKlass, PropName, prop_iv)                  \
 RB_METHOD(Klass##Get##PropName) {                                            \
 RB_UNUSED_PARAM;                                                           \
-return rb_iv_get(self, prop_iv);                                           \
+return rb_ivar_get(self, CACHED_ID(prop_iv));                                           \
 }                                                                            \
 RB_METHOD_GUARD(Klass##Set##PropName) {                                    \
 RB_UNUSED_PARAM;                                                           \
@@ -658,7 +703,7 @@ prop = 0;                                                                \
 else                                                                       \
 prop = getPrivateDataCheck<PropKlass>(propObj, PropKlass##Type);         \
 GFX_GUARD_EXC(k->set##PropName(prop);)                                         \
-rb_iv_set(self, prop_iv, propObj);                                         \
+rb_ivar_set(self, CACHED_ID(prop_iv), propObj);                                         \
 return propObj;                                                            \
 }                                                                          \
 RB_METHOD_GUARD_END
@@ -673,7 +718,7 @@ DEF_PROP_OBJ_REF(Klass, PropKlass, PropName, prop_iv)
 RB_METHOD(Klass##Get##PropName) {                                            \
 RB_UNUSED_PARAM;                                                           \
 checkDisposed<Klass>(self);                                                \
-return rb_iv_get(self, prop_iv);                                           \
+return rb_ivar_get(self, CACHED_ID(prop_iv));                                           \
 }                                                                            \
 RB_METHOD_GUARD(Klass##Set##PropName) {                                    \
 rb_check_argc(argc, 1);                                                    \
@@ -70,8 +70,23 @@ RB_METHOD_GUARD(bitmapInitialize) {
     if (argc == 1) {
         char *filename;
         rb_get_args(argc, argv, "z", &filename RB_ARG_END);
-        
+
+#if RAPI_MAJOR >= 2
+        /* Archive read + image decode can take a while on
+         * big assets; let background Ruby threads run */
+        struct LoadArgs { const char *filename; Bitmap *b; };
+        LoadArgs args = { filename, 0 };
+
+        drop_gvl_guard([](void *p) -> void* {
+            LoadArgs &a = *((LoadArgs*) p);
+            GFX_GUARD_EXC(a.b = new Bitmap(a.filename);)
+            return 0;
+        }, &args, 0, 0);
+
+        b = args.b;
+#else
         GFX_GUARD_EXC(b = new Bitmap(filename);)
+#endif
     } else {
         int width, height;
         rb_get_args(argc, argv, "ii", &width, &height RB_ARG_END);
@@ -114,15 +129,32 @@ DEF_GFX_PROP_OBJ_REF(Bitmap, Bitmap, Hires, "hires")
 
 RB_METHOD_GUARD(bitmapRect) {
     RB_UNUSED_PARAM;
-    
+
     Bitmap *b = getPrivateData<Bitmap>(self);
-    
+
     IntRect rect;
    rect = b->rect();
-    
-    Rect *r = new Rect(rect);
-    
-    return wrapObject(r, RectType);
+
+    /* One wrapper per bitmap, refreshed in place: HUD loops
+     * query this thousands of times per frame and churned a
+     * fresh Rect plus wrapper on every call. Trade-off: two
+     * rect calls on the same bitmap now return the same
+     * (equal?) object */
+    VALUE cached = rb_ivar_get(self, CACHED_ID("bitmap_rect"));
+
+    if (!NIL_P(cached)) {
+        Rect *r = getPrivateDataNoRaise<Rect>(cached);
+
+        if (r) {
+            r->set(rect.x, rect.y, rect.w, rect.h);
+            return cached;
+        }
+    }
+
+    VALUE obj = wrapObject(new Rect(rect), RectType);
+    rb_ivar_set(self, CACHED_ID("bitmap_rect"), obj);
+
+    return obj;
 }
 RB_METHOD_GUARD_END
 
@@ -232,10 +264,11 @@ RB_METHOD_GUARD(bitmapGetPixel) {
         value = b->getPixel(x, y);
     else
         GFX_GUARD_EXC(value = b->getPixel(x, y););
-    
-    Color *color = new Color(value);
-    
-    return wrapObject(color, ColorType);
+
+    /* A fresh wrapper every call: scripts legitimately retain
+     * the results (colors << bmp.get_pixel(x, y)), so aliasing
+     * one object per bitmap would corrupt them silently */
+    return wrapObject(new Color(value), ColorType);
 }
 RB_METHOD_GUARD_END
 
@@ -257,6 +290,46 @@ RB_METHOD_GUARD(bitmapSetPixel) {
 }
 RB_METHOD_GUARD_END
 
+RB_METHOD_GUARD(bitmapGetPixels) {
+    Bitmap *b = getPrivateData<Bitmap>(self);
+
+    VALUE rectObj;
+    rb_scan_args(argc, argv, "1", &rectObj);
+
+    Rect *rect = getPrivateDataCheck<Rect>(rectObj, RectType);
+
+    IntRect region = rect->toIntRect();
+    int size = abs(region.w) * abs(region.h) * 4;
+    VALUE ret = rb_str_new(0, size);
+
+    GFX_GUARD_EXC(b->getPixels(region, RSTRING_PTR(ret)););
+
+    return ret;
+}
+RB_METHOD_GUARD_END
+
+RB_METHOD_GUARD(bitmapSetPixels) {
+    Bitmap *b = getPrivateData<Bitmap>(self);
+
+    VALUE rectObj, str;
+    rb_scan_args(argc, argv, "2", &rectObj, &str);
+    SafeStringValue(str);
+
+    Rect *rect = getPrivateDataCheck<Rect>(rectObj, RectType);
+
+    IntRect region = rect->toIntRect();
+    int requiredsize = abs(region.w) * abs(region.h) * 4;
+
+    if (RSTRING_LEN(str) != requiredsize)
+        rb_raise(rb_eArgError, "Pixel data is the wrong size (given %ld bytes, need %d)",
+                 (long)RSTRING_LEN(str), requiredsize);
+
+    GFX_GUARD_EXC(b->setPixels(region, RSTRING_PTR(str)););
+
+    return self;
+}
+RB_METHOD_GUARD_END
+
 RB_METHOD_GUARD(bitmapHueChange) {
     Bitmap *b = getPrivateData<Bitmap>(self);
     
@@ -270,6 +343,35 @@ RB_METHOD_GUARD(bitmapHueChange) {
 }
 RB_METHOD_GUARD_END
 
+RB_METHOD_GUARD(bitmapApplyTone) {
+    Bitmap *b = getPrivateData<Bitmap>(self);
+
+    VALUE toneObj;
+    VALUE rectObj = Qnil;
+
+    rb_get_args(argc, argv, "o|o", &toneObj, &rectObj RB_ARG_END);
+
+    Tone *tone = getPrivateDataCheck<Tone>(toneObj, ToneType);
+
+    if (tone) {
+        IntRect rect(0, 0, b->width(), b->height());
+
+        if (rectObj != Qnil) {
+            Rect *r = getPrivateDataCheck<Rect>(rectObj, RectType);
+
+            if (!r)
+                return self;
+
+            rect = r->toIntRect();
+        }
+
+        GFX_GUARD_EXC(b->applyTone(*tone, rect););
+    }
+
+    return self;
+}
+RB_METHOD_GUARD_END
+
 RB_METHOD_GUARD(bitmapDrawText) {
     Bitmap *b = getPrivateData<Bitmap>(self);
     
@@ -313,6 +415,26 @@ RB_METHOD_GUARD(bitmapDrawText) {
 }
 RB_METHOD_GUARD_END
 
+RB_METHOD_GUARD(bitmapMeasureLines) {
+    Bitmap *b = getPrivateData<Bitmap>(self);
+
+    VALUE strObj;
+    int width;
+    rb_get_args(argc, argv, "oi", &strObj, &width RB_ARG_END);
+
+    const char *str = objAsStringPtr(strObj);
+
+    std::vector<std::string> lines;
+    GUARD_EXC( b->measureLines(str, width, lines); );
+
+    VALUE ret = rb_ary_new2(lines.size());
+    for (size_t i = 0; i < lines.size(); ++i)
+        rb_ary_push(ret, rb_utf8_str_new(lines[i].c_str(), lines[i].size()));
+
+    return ret;
+}
+RB_METHOD_GUARD_END
+
 RB_METHOD_GUARD(bitmapTextSize) {
     Bitmap *b = getPrivateData<Bitmap>(self);
     
@@ -329,10 +451,10 @@ RB_METHOD_GUARD(bitmapTextSize) {
     
     IntRect value;
     value = b->textSize(str);
-    
-    Rect *rect = new Rect(value);
-    
-    return wrapObject(rect, RectType);
+
+    /* Fresh wrapper per call, same reasoning as get_pixel:
+     * retained measurements must not alias each other */
+    return wrapObject(new Rect(value), RectType);
 }
 RB_METHOD_GUARD_END
 
@@ -436,21 +558,39 @@ RB_METHOD_GUARD(bitmapBlur) {
     RB_UNUSED_PARAM;
     
     Bitmap *b = getPrivateData<Bitmap>(self);
-    
+
+#if RAPI_MAJOR >= 2
+    drop_gvl_guard([](void *b) -> void* {
+        GFX_GUARD_EXC( ((Bitmap*) b)->blur(); );
+        return 0;
+    }, b, 0, 0);
+#else
     GFX_GUARD_EXC( b->blur(); );
-    
+#endif
+
     return Qnil;
 }
 RB_METHOD_GUARD_END
 
 RB_METHOD_GUARD(bitmapRadialBlur) {
     Bitmap *b = getPrivateData<Bitmap>(self);
-    
+
     int angle, divisions;
     rb_get_args(argc, argv, "ii", &angle, &divisions RB_ARG_END);
-    
+
+#if RAPI_MAJOR >= 2
+    struct BlurArgs { Bitmap *b; int angle, divisions; };
+    BlurArgs args = { b, angle, divisions };
+
+    drop_gvl_guard([](void *p) -> void* {
+        BlurArgs &a = *((BlurArgs*) p);
+        GFX_GUARD_EXC( a.b->radialBlur(a.angle, a.divisions); );
+        return 0;
+    }, &args, 0, 0);
+#else
     GFX_GUARD_EXC( b->radialBlur(angle, divisions); );
-    
+#endif
+
     return Qnil;
 }
 RB_METHOD_GUARD_END
@@ -483,6 +623,19 @@ RB_METHOD_GUARD(bitmapSetRawData) {
 }
 RB_METHOD_GUARD_END
 
+RB_METHOD_GUARD(bitmapQueueRawData) {
+    RB_UNUSED_PARAM;
+
+    rb_check_argc(argc, 0);
+
+    Bitmap *b = getPrivateData<Bitmap>(self);
+
+    GFX_GUARD_EXC(b->queueRawReadback(););
+
+    return RUBY_Qnil;
+}
+RB_METHOD_GUARD_END
+
 RB_METHOD_GUARD(bitmapSaveToFile) {
     RB_UNUSED_PARAM;
     
@@ -498,6 +651,29 @@ RB_METHOD_GUARD(bitmapSaveToFile) {
 }
 RB_METHOD_GUARD_END
 
+RB_METHOD_GUARD(bitmapSaveToFileAsync) {
+    RB_UNUSED_PARAM;
+    
+    VALUE str;
+    rb_scan_args(argc, argv, "1", &str);
+    SafeStringValue(str);
+    
+    Bitmap *b = getPrivateData<Bitmap>(self);
+    
+    GFX_GUARD_EXC(b->saveToFileAsync(RSTRING_PTR(str)););
+    
+    return RUBY_Qnil;
+}
+RB_METHOD_GUARD_END
+
+RB_METHOD(bitmapPendingSaves){
+    RB_UNUSED_PARAM;
+    
+    rb_check_argc(argc, 0);
+    
+    return INT2NUM(Bitmap::pendingSaves());
+}
+
 RB_METHOD_GUARD(bitmapGetMega){
     RB_UNUSED_PARAM;
     
@@ -799,6 +975,37 @@ RB_METHOD(bitmapGetMaxSize){
     return INT2NUM(Bitmap::maxSize());
 }
 
+/* Completes once none of the queued files is still in flight */
+struct BitmapPreloadOp : AsyncOpImpl
+{
+    std::vector<std::string> files;
+
+    bool done()
+    {
+        for (size_t i = 0; i < files.size(); ++i)
+            if (Bitmap::preloadPending(files[i].c_str()))
+                return false;
+
+        return true;
+    }
+
+    VALUE result() { return Qtrue; }
+};
+
+RB_METHOD(bitmapPreload){
+    RB_UNUSED_PARAM;
+    
+    BitmapPreloadOp *op = new BitmapPreloadOp;
+    
+    for (int i = 0; i < argc; ++i) {
+        SafeStringValue(argv[i]);
+        Bitmap::preload(RSTRING_PTR(argv[i]));
+        op->files.push_back(RSTRING_PTR(argv[i]));
+    }
+    
+    return wrapAsyncOp(op);
+}
+
 RB_METHOD_GUARD(bitmapInitializeCopy) {
     rb_check_argc(argc, 1);
     VALUE origObj = argv[0];
@@ -844,13 +1051,19 @@ void bitmapBindingInit() {
     _rb_define_method(klass, "clear", bitmapClear);
     _rb_define_method(klass, "get_pixel", bitmapGetPixel);
     _rb_define_method(klass, "set_pixel", bitmapSetPixel);
+    _rb_define_method(klass, "get_pixels", bitmapGetPixels);
+    _rb_define_method(klass, "set_pixels", bitmapSetPixels);
     _rb_define_method(klass, "hue_change", bitmapHueChange);
+    _rb_define_method(klass, "apply_tone", bitmapApplyTone);
     _rb_define_method(klass, "draw_text", bitmapDrawText);
     _rb_define_method(klass, "text_size", bitmapTextSize);
+    _rb_define_method(klass, "measure_lines", bitmapMeasureLines);
     
     _rb_define_method(klass, "raw_data", bitmapGetRawData);
     _rb_define_method(klass, "raw_data=", bitmapSetRawData);
+    _rb_define_method(klass, "queue_raw_data", bitmapQueueRawData);
     _rb_define_method(klass, "to_file", bitmapSaveToFile);
+    _rb_define_method(klass, "to_file_async", bitmapSaveToFileAsync);
     
     _rb_define_method(klass, "gradient_fill_rect", bitmapGradientFillRect);
     _rb_define_method(klass, "clear_rect", bitmapClearRect);
@@ -859,6 +1072,8 @@ void bitmapBindingInit() {
     
     _rb_define_method(klass, "mega?", bitmapGetMega);
     rb_define_singleton_method(klass, "max_size", RUBY_METHOD_FUNC(bitmapGetMaxSize), -1);
+    rb_define_singleton_method(klass, "preload", RUBY_METHOD_FUNC(bitmapPreload), -1);
+    rb_define_singleton_method(klass, "pending_saves", RUBY_METHOD_FUNC(bitmapPendingSaves), -1);
     
     _rb_define_method(klass, "animated?", bitmapGetAnimated);
     _rb_define_method(klass, "playing", bitmapGetPlaying);
@@ -26,6 +26,12 @@
 #include "filesystem.h"
 #include "sharedstate.h"
 #include "src/util/util.h"
+#include "src/util/sdl-util.h"
+#include "src/util/debugwriter.h"
+
+#ifdef MKXPZ_ZSTD
+#include <zstd.h>
+#endif
 
 #if RAPI_FULL > 187
 #include "ruby/encoding.h"
@@ -159,6 +165,186 @@ RB_METHOD(fileIntPos) {
 }
 #endif
 
+#ifdef MKXPZ_ZSTD
+
+/* ---- Streaming compressed save channel ----
+ *
+ * save_data with compression streams Marshal.dump chunks
+ * straight through a zstd compressor into the file: no
+ * intermediate full dump string, no script-land Zlib pass.
+ * load_data transparently inflates anything carrying the
+ * zstd frame magic. */
+
+struct ZstdWriteCtx {
+    SDL_RWops *rw;
+    ZSTD_CCtx *ctx;
+    bool ioError;
+};
+
+/* Marshal.dump runs synchronously on the script thread, so
+ * one active writer at a time is all there ever is */
+static ZstdWriteCtx *activeZstdWriter = 0;
+
+RB_METHOD(zstdShimWrite) {
+    RB_UNUSED_PARAM;
+
+    VALUE str;
+    rb_scan_args(argc, argv, "1", &str);
+    SafeStringValue(str);
+
+    ZstdWriteCtx *w = activeZstdWriter;
+
+    if (!w)
+        rb_raise(rb_eRuntimeError, "save writer not active");
+
+    ZSTD_inBuffer in = { RSTRING_PTR(str), (size_t) RSTRING_LEN(str), 0 };
+
+    char buf[16 * 1024];
+
+    while (in.pos < in.size) {
+        ZSTD_outBuffer out = { buf, sizeof(buf), 0 };
+
+        size_t res = ZSTD_compressStream2(w->ctx, &out, &in, ZSTD_e_continue);
+
+        if (ZSTD_isError(res))
+            rb_raise(rb_eRuntimeError, "save_data: %s",
+                     ZSTD_getErrorName(res));
+
+        if (out.pos > 0 && SDL_RWwrite(w->rw, buf, 1, out.pos) != out.pos) {
+            w->ioError = true;
+            rb_raise(rb_eRuntimeError, "save_data: write failed");
+        }
+    }
+
+    return LONG2NUM(RSTRING_LEN(str));
+}
+
+struct MarshalDumpArgs {
+    VALUE marsh, obj, port;
+};
+
+static VALUE doMarshalDump(VALUE arg) {
+    MarshalDumpArgs *a = (MarshalDumpArgs*) arg;
+
+    VALUE v[] = { a->obj, a->port };
+
+    return rb_funcall2(a->marsh, rb_intern("dump"), ARRAY_SIZE(v), v);
+}
+
+static void kernelSaveDataCompressed(VALUE obj, VALUE filename) {
+    /* A custom _dump re-entering save_data would clobber
+     * the active writer */
+    if (activeZstdWriter)
+        rb_raise(rb_eRuntimeError, "save_data: nested compressed save");
+
+    ZstdWriteCtx w;
+    w.rw = RWFromFile(RSTRING_PTR(filename), "wb");
+    w.ioError = false;
+
+    if (!w.rw)
+        rb_raise(rb_eRuntimeError, "Failed to open file: %s",
+                 RSTRING_PTR(filename));
+
+    w.ctx = ZSTD_createCCtx();
+
+    VALUE shimKlass =
+        rb_const_get(rb_cObject, rb_intern("MKXPZ_SaveWriter"));
+    VALUE shim = rb_obj_alloc(shimKlass);
+
+    activeZstdWriter = &w;
+
+    MarshalDumpArgs args = {
+        rb_const_get(rb_cObject, rb_intern("Marshal")), obj, shim
+    };
+
+    int state = 0;
+    rb_protect(doMarshalDump, (VALUE) &args, &state);
+
+    /* Finish the frame (unless the dump already died) */
+    if (!state && !w.ioError) {
+        char buf[16 * 1024];
+        ZSTD_inBuffer in = { 0, 0, 0 };
+        size_t res;
+
+        do {
+            ZSTD_outBuffer out = { buf, sizeof(buf), 0 };
+
+            res = ZSTD_compressStream2(w.ctx, &out, &in, ZSTD_e_end);
+
+            if (out.pos > 0 && SDL_RWwrite(w.rw, buf, 1, out.pos) != out.pos) {
+                w.ioError = true;
+                break;
+            }
+        } while (res != 0 && !ZSTD_isError(res));
+    }
+
+    activeZstdWriter = 0;
+    ZSTD_freeCCtx(w.ctx);
+    SDL_RWclose(w.rw);
+
+    if (state)
+        rb_jump_tag(state);
+
+    if (w.ioError)
+        rb_raise(rb_eRuntimeError, "save_data: write failed");
+}
+
+/* Inflates 'data' if it carries the zstd frame magic;
+ * plain saves pass through untouched */
+static VALUE maybeDecompressSave(VALUE data) {
+    if (RSTRING_LEN(data) < 4
+    ||  memcmp(RSTRING_PTR(data), "\x28\xB5\x2F\xFD", 4))
+        return data;
+
+    ZSTD_DCtx *ctx = ZSTD_createDCtx();
+
+    VALUE out = rb_str_buf_new(RSTRING_LEN(data) * 4);
+
+    ZSTD_inBuffer in = { RSTRING_PTR(data), (size_t) RSTRING_LEN(data), 0 };
+
+    char buf[64 * 1024];
+    bool failed = false;
+
+    while (in.pos < in.size) {
+        ZSTD_outBuffer ob = { buf, sizeof(buf), 0 };
+
+        size_t res = ZSTD_decompressStream(ctx, &ob, &in);
+
+        if (ZSTD_isError(res)) {
+            failed = true;
+            break;
+        }
+
+        rb_str_cat(out, buf, ob.pos);
+
+        /* Frame done, trailing bytes would be garbage */
+        if (res == 0)
+            break;
+    }
+
+    ZSTD_freeDCtx(ctx);
+
+    if (failed)
+        rb_raise(rb_eRuntimeError, "load_data: corrupt compressed save");
+
+    return out;
+}
+
+#else /* !MKXPZ_ZSTD */
+
+/* Plain saves pass through; a compressed one can't be read
+ * without the library */
+static VALUE maybeDecompressSave(VALUE data) {
+    if (RSTRING_LEN(data) >= 4
+    &&  !memcmp(RSTRING_PTR(data), "\x28\xB5\x2F\xFD", 4))
+        rb_raise(rb_eRuntimeError,
+                 "load_data: compressed save support not compiled in");
+
+    return data;
+}
+
+#endif /* MKXPZ_ZSTD */
+
 VALUE
 kernelLoadDataInt(const char *filename, bool rubyExc, bool raw) {
     //rb_gc_start();
@@ -167,9 +353,10 @@ kernelLoadDataInt(const char *filename, bool rubyExc, bool raw) {
     VALUE result;
     if (!raw) {
         VALUE marsh = rb_const_get(rb_cObject, rb_intern("Marshal"));
-        
+
         // FIXME need to catch exceptions here with begin rescue
         VALUE data = fileIntRead(0, 0, port);
+        data = maybeDecompressSave(data);
         result = rb_funcall2(marsh, rb_intern("load"), 1, &data);
     } else {
         result = fileIntRead(0, 0, port);
@@ -194,23 +381,49 @@ RB_METHOD_GUARD(kernelLoadData) {
 }
 RB_METHOD_GUARD_END
 
+RB_METHOD(kernelPrefetchData) {
+    RB_UNUSED_PARAM;
+
+    for (int i = 0; i < argc; ++i) {
+        SafeStringValue(argv[i]);
+        shState->fileSystem().prefetch(RSTRING_PTR(argv[i]));
+    }
+
+    return Qnil;
+}
+
 RB_METHOD(kernelSaveData) {
     RB_UNUSED_PARAM;
-    
+
     VALUE obj;
     VALUE filename;
-    
-    rb_get_args(argc, argv, "oS", &obj, &filename RB_ARG_END);
-    
+    VALUE compress = Qnil;
+
+    rb_get_args(argc, argv, "oS|o", &obj, &filename, &compress RB_ARG_END);
+
+    bool comp = false;
+    if (compress != Qnil)
+        rb_bool_arg(compress, &comp);
+
+    if (comp) {
+#ifdef MKXPZ_ZSTD
+        kernelSaveDataCompressed(obj, filename);
+        return Qnil;
+#else
+        /* Plain dump below; the loader passes it through */
+        Debug() << "save_data: compression not compiled in, saving plain";
+#endif
+    }
+
     VALUE file = rb_file_open_str(filename, "wb");
-    
+
     VALUE marsh = rb_const_get(rb_cObject, rb_intern("Marshal"));
-    
+
     VALUE v[] = {obj, file};
     rb_funcall2(marsh, rb_intern("dump"), ARRAY_SIZE(v), v);
-    
+
     rb_io_close(file);
-    
+
     return Qnil;
 }
 #if RAPI_FULL > 187
@@ -285,6 +498,14 @@ void fileIntBindingInit() {
     
     _rb_define_module_function(rb_mKernel, "load_data", kernelLoadData);
     _rb_define_module_function(rb_mKernel, "save_data", kernelSaveData);
+
+#ifdef MKXPZ_ZSTD
+    /* Internal shim Marshal.dump streams into when saving
+     * compressed */
+    VALUE saveWriter = rb_define_class("MKXPZ_SaveWriter", rb_cObject);
+    _rb_define_method(saveWriter, "write", zstdShimWrite);
+#endif
+    _rb_define_module_function(rb_mKernel, "prefetch_data", kernelPrefetchData);
     
 #if RAPI_FULL > 187
     /* We overload the built-in 'Marshal::load()' function to silently
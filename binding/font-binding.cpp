@@ -162,6 +162,8 @@ DEF_PROP_B(Font, Bold)
 DEF_PROP_B(Font, Italic)
 DEF_PROP_B(Font, Shadow)
 DEF_PROP_B(Font, Outline)
+DEF_PROP_B(Font, SDF)
+DEF_PROP_B(Font, Shaped)
 
 #define DEF_KLASS_PROP(Klass, type, PropName, param_t_s, value_fun)            \
   RB_METHOD(Klass##Get##PropName) {                                            \
@@ -181,6 +183,8 @@ DEF_KLASS_PROP(Font, bool, DefaultBold, "b", rb_bool_new)
 DEF_KLASS_PROP(Font, bool, DefaultItalic, "b", rb_bool_new)
 DEF_KLASS_PROP(Font, bool, DefaultShadow, "b", rb_bool_new)
 DEF_KLASS_PROP(Font, bool, DefaultOutline, "b", rb_bool_new)
+DEF_KLASS_PROP(Font, bool, DefaultSDF, "b", rb_bool_new)
+DEF_KLASS_PROP(Font, bool, DefaultShaped, "b", rb_bool_new)
 
 RB_METHOD(FontGetDefaultOutColor) {
   RB_UNUSED_PARAM;
@@ -286,6 +290,8 @@ void fontBindingInit() {
 
   if (rgssVer >= 3) {
     INIT_KLASS_PROP_BIND(Font, DefaultOutline, "default_outline");
+    INIT_KLASS_PROP_BIND(Font, DefaultSDF, "default_sdf");
+    INIT_KLASS_PROP_BIND(Font, DefaultShaped, "default_shaped");
     INIT_KLASS_PROP_BIND(Font, DefaultOutColor, "default_out_color");
   }
 
@@ -306,6 +312,8 @@ void fontBindingInit() {
 
   if (rgssVer >= 3) {
     INIT_PROP_BIND(Font, Outline, "outline");
+    INIT_PROP_BIND(Font, SDF, "sdf");
+    INIT_PROP_BIND(Font, Shaped, "shaped");
     INIT_PROP_BIND(Font, OutColor, "out_color");
   }
 }
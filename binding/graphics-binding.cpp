@@ -21,8 +21,16 @@
 
 #include "config.h"
 #include "graphics.h"
+#include "eventthread.h"
 #include "sharedstate.h"
+#include "glstate.h"
+#include "texpool.h"
+#include "global-ibo.h"
+#include "scene.h"
 #include "binding-util.h"
+#include "font.h"
+#include "glyphatlas.h"
+#include "arena.h"
 #include "binding-types.h"
 #include "exception.h"
 
@@ -39,7 +47,7 @@ RB_METHOD_GUARD(graphicsUpdate)
     RB_UNUSED_PARAM;
 #if RAPI_MAJOR >= 2
     drop_gvl_guard([](void*) -> void* {
-        GFX_GUARD_EXC( shState->graphics().update(); );
+        GFX_GUARD_EXC_CLEAN( shState->graphics().update(); );
         return 0;
     }, 0, 0, 0);
 #else
@@ -58,6 +66,242 @@ RB_METHOD(graphicsAverageFrameRate)
     return ret;
 }
 
+/* Event-thread stall telemetry: worst handling time ever
+ * observed, and the recent over-threshold stalls as
+ * [{at:, ms:, event:}, ...] newest first - so hitches can
+ * be attributed to the event pump vs GL vs scripts */
+RB_METHOD(graphicsMaxEventStall)
+{
+    RB_UNUSED_PARAM;
+
+    return rb_float_new(EventThread::maxStallMs());
+}
+
+RB_METHOD(graphicsEventStallLog)
+{
+    RB_UNUSED_PARAM;
+
+    EventThread::StallRecord records[32];
+    int n = EventThread::stallLog(records, 32);
+
+    VALUE ret = rb_ary_new();
+
+    for (int i = 0; i < n; ++i)
+    {
+        VALUE entry = rb_hash_new();
+        rb_hash_aset(entry, ID2SYM(rb_intern("at")),
+                     rb_float_new(records[i].atSeconds));
+        rb_hash_aset(entry, ID2SYM(rb_intern("ms")),
+                     rb_float_new(records[i].durationMs));
+        rb_hash_aset(entry, ID2SYM(rb_intern("event")),
+                     UINT2NUM(records[i].eventType));
+
+        rb_ary_push(ret, entry);
+    }
+
+    return ret;
+}
+
+RB_METHOD(graphicsStateStats)
+{
+    RB_UNUSED_PARAM;
+
+    VALUE ret = rb_hash_new();
+    rb_hash_aset(ret, ID2SYM(rb_intern("state_sets")),
+                 ULL2NUM(glStateStats.setCalls));
+    rb_hash_aset(ret, ID2SYM(rb_intern("state_elided")),
+                 ULL2NUM(glStateStats.setElided));
+    rb_hash_aset(ret, ID2SYM(rb_intern("tex_binds")),
+                 ULL2NUM(glStateStats.texBinds));
+    rb_hash_aset(ret, ID2SYM(rb_intern("tex_binds_elided")),
+                 ULL2NUM(glStateStats.texBindsElided));
+    rb_hash_aset(ret, ID2SYM(rb_intern("uniform_sets")),
+                 ULL2NUM(glStateStats.uniformSets));
+    rb_hash_aset(ret, ID2SYM(rb_intern("uniform_elided")),
+                 ULL2NUM(glStateStats.uniformElided));
+    rb_hash_aset(ret, ID2SYM(rb_intern("ibo_quad_capacity")),
+                 SIZET2NUM(shState->globalIBO().quadCapacity()));
+    rb_hash_aset(ret, ID2SYM(rb_intern("ibo_uploads")),
+                 ULL2NUM(shState->globalIBO().uploads));
+
+    rb_hash_aset(ret, ID2SYM(rb_intern("reorder_ops")),
+                 ULL2NUM(sceneReorderStats.ops));
+    rb_hash_aset(ret, ID2SYM(rb_intern("reorder_hops")),
+                 ULL2NUM(sceneReorderStats.hops));
+    rb_hash_aset(ret, ID2SYM(rb_intern("culled_elements")),
+                 ULL2NUM(sceneCulledCount));
+
+    const SceneQuadBatch::Stats &bs = SceneQuadBatch::instance().stats();
+    rb_hash_aset(ret, ID2SYM(rb_intern("batch_draws")), ULL2NUM(bs.batches));
+    rb_hash_aset(ret, ID2SYM(rb_intern("batch_quads")), ULL2NUM(bs.quads));
+    rb_hash_aset(ret, ID2SYM(rb_intern("batch_max")), UINT2NUM(bs.maxBatch));
+
+    /* Heap traffic the frame arena absorbed */
+    rb_hash_aset(ret, ID2SYM(rb_intern("scratch_bytes_served")),
+                 ULL2NUM(frameArena().bytesServed()));
+    rb_hash_aset(ret, ID2SYM(rb_intern("scratch_capacity")),
+                 SIZET2NUM(frameArena().capacity()));
+
+    return ret;
+}
+
+RB_METHOD(graphicsTexPoolStats)
+{
+    RB_UNUSED_PARAM;
+
+    GFX_LOCK;
+    TexPool::Stats stats = shState->texPool().stats();
+    GFX_UNLOCK;
+
+    VALUE ret = rb_hash_new();
+    rb_hash_aset(ret, ID2SYM(rb_intern("hits")), ULL2NUM(stats.hits));
+    rb_hash_aset(ret, ID2SYM(rb_intern("misses")), ULL2NUM(stats.misses));
+    rb_hash_aset(ret, ID2SYM(rb_intern("evictions")), ULL2NUM(stats.evictions));
+    rb_hash_aset(ret, ID2SYM(rb_intern("cached_bytes")), UINT2NUM(stats.cachedBytes));
+    rb_hash_aset(ret, ID2SYM(rb_intern("budget_bytes")), UINT2NUM(stats.budgetBytes));
+
+    return ret;
+}
+
+RB_METHOD(graphicsGpuStats)
+{
+    RB_UNUSED_PARAM;
+
+    double composite = 0, present = 0, transition = 0;
+
+    GFX_LOCK;
+    bool ok = shState->graphics().gpuStats(composite, present, transition);
+    GFX_UNLOCK;
+
+    if (!ok)
+        return Qnil;
+
+    VALUE ret = rb_hash_new();
+    rb_hash_aset(ret, ID2SYM(rb_intern("composite")), rb_float_new(composite));
+    rb_hash_aset(ret, ID2SYM(rb_intern("present")), rb_float_new(present));
+    rb_hash_aset(ret, ID2SYM(rb_intern("transition")), rb_float_new(transition));
+
+    return ret;
+}
+
+RB_METHOD(graphicsMovieStats)
+{
+    RB_UNUSED_PARAM;
+
+    int presented = 0, dropped = 0, repeated = 0, decoded = 0;
+    double decAvg = 0, decMax = 0, upAvg = 0, upMax = 0, prAvg = 0, prMax = 0;
+
+    GFX_LOCK;
+    bool ok = shState->graphics().movieStats(presented, dropped, repeated,
+                                             decoded, decAvg, decMax,
+                                             upAvg, upMax, prAvg, prMax);
+    GFX_UNLOCK;
+
+    if (!ok)
+        return Qnil;
+
+    VALUE ret = rb_hash_new();
+    rb_hash_aset(ret, ID2SYM(rb_intern("presented")), rb_fix_new(presented));
+    rb_hash_aset(ret, ID2SYM(rb_intern("dropped")), rb_fix_new(dropped));
+    rb_hash_aset(ret, ID2SYM(rb_intern("repeated")), rb_fix_new(repeated));
+    rb_hash_aset(ret, ID2SYM(rb_intern("decoded")), rb_fix_new(decoded));
+    rb_hash_aset(ret, ID2SYM(rb_intern("decode_avg")), rb_float_new(decAvg));
+    rb_hash_aset(ret, ID2SYM(rb_intern("decode_max")), rb_float_new(decMax));
+    rb_hash_aset(ret, ID2SYM(rb_intern("upload_avg")), rb_float_new(upAvg));
+    rb_hash_aset(ret, ID2SYM(rb_intern("upload_max")), rb_float_new(upMax));
+    rb_hash_aset(ret, ID2SYM(rb_intern("present_avg")), rb_float_new(prAvg));
+    rb_hash_aset(ret, ID2SYM(rb_intern("present_max")), rb_float_new(prMax));
+
+    return ret;
+}
+
+RB_METHOD(graphicsCompositeStats)
+{
+    RB_UNUSED_PARAM;
+
+    GFX_LOCK;
+    SceneCompositeStats st = sceneCompositeStats;
+    GFX_UNLOCK;
+
+    VALUE ret = rb_hash_new();
+    rb_hash_aset(ret, ID2SYM(rb_intern("draw_calls")), ULL2NUM(st.drawCalls));
+    rb_hash_aset(ret, ID2SYM(rb_intern("quads")), ULL2NUM(st.quads));
+    rb_hash_aset(ret, ID2SYM(rb_intern("vertices")), ULL2NUM(st.vertices));
+    rb_hash_aset(ret, ID2SYM(rb_intern("tex_binds")), ULL2NUM(st.texBinds));
+    rb_hash_aset(ret, ID2SYM(rb_intern("shader_switches")),
+                 ULL2NUM(st.programSwitches));
+    rb_hash_aset(ret, ID2SYM(rb_intern("order_rebuilds")),
+                 ULL2NUM(st.orderRebuilds));
+
+    return ret;
+}
+
+RB_METHOD(graphicsVramStats)
+{
+    RB_UNUSED_PARAM;
+
+    size_t total = 0, pool = 0, glyph = 0, bitmaps = 0;
+    unsigned textures = 0;
+
+    GFX_LOCK;
+    shState->graphics().vramStats(total, textures, pool, glyph, bitmaps);
+    GFX_UNLOCK;
+
+    VALUE ret = rb_hash_new();
+    rb_hash_aset(ret, ID2SYM(rb_intern("total_bytes")), SIZET2NUM(total));
+    rb_hash_aset(ret, ID2SYM(rb_intern("textures")), UINT2NUM(textures));
+    rb_hash_aset(ret, ID2SYM(rb_intern("tex_pool_bytes")), SIZET2NUM(pool));
+    rb_hash_aset(ret, ID2SYM(rb_intern("glyph_atlas_bytes")), SIZET2NUM(glyph));
+    rb_hash_aset(ret, ID2SYM(rb_intern("bitmap_bytes")), SIZET2NUM(bitmaps));
+
+    return ret;
+}
+
+RB_METHOD(graphicsGetPerfHud)
+{
+    RB_UNUSED_PARAM;
+
+    return rb_bool_new(shState->graphics().getPerfHud());
+}
+
+RB_METHOD(graphicsSetPerfHud)
+{
+    RB_UNUSED_PARAM;
+
+    bool enabled;
+    rb_get_args(argc, argv, "b", &enabled RB_ARG_END);
+
+    GFX_LOCK;
+    shState->graphics().setPerfHud(enabled);
+    GFX_UNLOCK;
+
+    return rb_bool_new(enabled);
+}
+
+RB_METHOD(graphicsGlyphAtlasStats)
+{
+    RB_UNUSED_PARAM;
+
+    GFX_LOCK;
+    GlyphAtlas::Stats st = shState->fontState().glyphAtlas().stats();
+    GFX_UNLOCK;
+
+    VALUE ret = rb_hash_new();
+    rb_hash_aset(ret, ID2SYM(rb_intern("pages")), rb_fix_new(st.pages));
+    rb_hash_aset(ret, ID2SYM(rb_intern("bytes")), rb_fix_new((long) st.bytes));
+    rb_hash_aset(ret, ID2SYM(rb_intern("glyphs")), rb_fix_new(st.glyphs));
+    rb_hash_aset(ret, ID2SYM(rb_intern("evictions")), rb_fix_new(st.evictions));
+
+    return ret;
+}
+
+RB_METHOD(graphicsDisposableCount)
+{
+    RB_UNUSED_PARAM;
+
+    return rb_fix_new(shState->graphics().disposableCount());
+}
+
 RB_METHOD_GUARD(graphicsFreeze)
 {
     RB_UNUSED_PARAM;
@@ -327,11 +571,12 @@ typedef struct {
     const char *filename;
     int volume;
     bool skippable;
+    unsigned int startMs;
 } PlayMovieArgs;
 
 void *playMovieInternal(void *args) {
     PlayMovieArgs *a = (PlayMovieArgs*)args;
-    GFX_GUARD_EXC( shState->graphics().playMovie(a->filename, a->volume, a->skippable); );
+    GFX_GUARD_EXC( shState->graphics().playMovie(a->filename, a->volume, a->skippable, a->startMs); );
     
     // Signals for shutdown or reset only make playMovie quit early,
     // so check again
@@ -345,10 +590,10 @@ RB_METHOD_GUARD(graphicsPlayMovie)
 {
     RB_UNUSED_PARAM;
     
-    VALUE filename, volumeArg, skippable;
-    rb_scan_args(argc, argv, "12", &filename, &volumeArg, &skippable);
+    VALUE filename, volumeArg, skippable, startArg;
+    rb_scan_args(argc, argv, "13", &filename, &volumeArg, &skippable, &startArg);
     SafeStringValue(filename);
-    
+
     bool skip;
     rb_bool_arg(skippable, &skip);
 
@@ -358,6 +603,13 @@ RB_METHOD_GUARD(graphicsPlayMovie)
     args.filename = RSTRING_PTR(filename);
     args.volume = (volumeArg == Qnil) ? 100 : NUM2INT(volumeArg);;
     args.skippable = skip;
+    /* Optional start position in seconds; playback resumes at the
+     * nearest earlier keyframe */
+    if (startArg != Qnil) {
+        double startSec = NUM2DBL(startArg);
+        if (startSec > 0)
+            args.startMs = (unsigned int) (startSec * 1000.0);
+    }
 #if RAPI_MAJOR >= 2
     drop_gvl_guard(playMovieInternal, &args, 0, 0);
 #else
@@ -368,6 +620,29 @@ RB_METHOD_GUARD(graphicsPlayMovie)
 }
 RB_METHOD_GUARD_END
 
+void *preloadMovieInternal(void *filename) {
+    GFX_GUARD_EXC( shState->graphics().preloadMovie((const char *) filename); );
+    return 0;
+}
+
+RB_METHOD_GUARD(graphicsPreloadMovie)
+{
+    RB_UNUSED_PARAM;
+
+    VALUE filename;
+    rb_scan_args(argc, argv, "1", &filename);
+    SafeStringValue(filename);
+
+#if RAPI_MAJOR >= 2
+    drop_gvl_guard(preloadMovieInternal, (void *) RSTRING_PTR(filename), 0, 0);
+#else
+    preloadMovieInternal((void *) RSTRING_PTR(filename));
+#endif
+
+    return Qnil;
+}
+RB_METHOD_GUARD_END
+
 void graphicsScreenshotInternal(const char *filename)
 {
     GFX_GUARD_EXC(shState->graphics().screenshot(filename););
@@ -429,6 +704,18 @@ void graphicsBindingInit()
     INIT_GRA_PROP_BIND( FrameRate,  "frame_rate"  );
     INIT_GRA_PROP_BIND( FrameCount, "frame_count" );
     _rb_define_module_function(module, "average_frame_rate", graphicsAverageFrameRate);
+    _rb_define_module_function(module, "max_event_stall", graphicsMaxEventStall);
+    _rb_define_module_function(module, "event_stall_log", graphicsEventStallLog);
+    _rb_define_module_function(module, "gpu_stats", graphicsGpuStats);
+    _rb_define_module_function(module, "movie_stats", graphicsMovieStats);
+    _rb_define_module_function(module, "glyph_atlas_stats", graphicsGlyphAtlasStats);
+    _rb_define_module_function(module, "composite_stats", graphicsCompositeStats);
+    _rb_define_module_function(module, "vram_stats", graphicsVramStats);
+    _rb_define_module_function(module, "perf_hud", graphicsGetPerfHud);
+    _rb_define_module_function(module, "perf_hud=", graphicsSetPerfHud);
+    _rb_define_module_function(module, "state_stats", graphicsStateStats);
+    _rb_define_module_function(module, "tex_pool_stats", graphicsTexPoolStats);
+    _rb_define_module_function(module, "disposable_count", graphicsDisposableCount);
 
     _rb_define_module_function(module, "width", graphicsWidth);
     _rb_define_module_function(module, "height", graphicsHeight);
@@ -449,6 +736,7 @@ void graphicsBindingInit()
     //if (rgssVer >= 3)
     //{
     _rb_define_module_function(module, "play_movie", graphicsPlayMovie);
+    _rb_define_module_function(module, "preload_movie", graphicsPreloadMovie);
     //}
     
     INIT_GRA_PROP_BIND( Fullscreen,       "fullscreen"         );
@@ -7,7 +7,10 @@
 
 #include <stdio.h>
 
+#include <memory>
+
 #include "util/json5pp.hpp"
+#include "util/exception.h"
 #include "binding-util.h"
 
 #include "net/net.h"
@@ -298,6 +301,423 @@ RB_METHOD_GUARD(httpJsonParse) {
 }
 RB_METHOD_GUARD_END
 
+/* ---- Async API ----
+ *
+ * HTTPLite.get_async and friends return an HTTPLite::Request
+ * wrapping a pool-serviced transfer: poll with done?/read,
+ * or stream it with await { |chunk| ... }, which drains body
+ * chunks into the block while the GVL is dropped between
+ * deliveries so gameplay threads keep running */
+
+typedef std::shared_ptr<mkxp_net::HTTPAsync> HTTPAsyncPtr;
+
+static void HTTPAsync_free(void *ptr) {
+    delete static_cast<HTTPAsyncPtr *>(ptr);
+}
+
+#if RAPI_FULL > 187
+static const rb_data_type_t HTTPAsyncType = {
+    "HTTPLiteRequest",
+    { 0, HTTPAsync_free, 0 },
+    0, 0,
+#if RAPI_FULL >= 210
+    0,
+#endif
+};
+#endif
+
+static VALUE wrapHTTPAsync(HTTPAsyncPtr job) {
+    VALUE klass = rb_const_get(rb_const_get(rb_cObject, rb_intern("HTTPLite")),
+                               rb_intern("Request"));
+    HTTPAsyncPtr *holder = new HTTPAsyncPtr(job);
+
+#if RAPI_FULL > 187
+    return TypedData_Wrap_Struct(klass, &HTTPAsyncType, holder);
+#else
+    return Data_Wrap_Struct(klass, 0, HTTPAsync_free, holder);
+#endif
+}
+
+static mkxp_net::HTTPAsync *getHTTPAsync(VALUE self) {
+#if RAPI_FULL > 187
+    if (!RTYPEDDATA_P(self) || RTYPEDDATA_TYPE(self) != &HTTPAsyncType)
+        return 0;
+
+    HTTPAsyncPtr *holder = static_cast<HTTPAsyncPtr *>(RTYPEDDATA_DATA(self));
+#else
+    HTTPAsyncPtr *holder = static_cast<HTTPAsyncPtr *>(DATA_PTR(self));
+#endif
+
+    return holder ? holder->get() : 0;
+}
+
+RB_METHOD_GUARD(httpGetAsync) {
+    RB_UNUSED_PARAM;
+
+    VALUE path, rheaders, redirect;
+    rb_scan_args(argc, argv, "12", &path, &rheaders, &redirect);
+    SafeStringValue(path);
+
+    bool rd;
+    rb_bool_arg(redirect, &rd);
+
+    mkxp_net::StringMap headers;
+    if (rheaders != Qnil)
+        headers = hash2StringMap(rheaders);
+
+    return wrapHTTPAsync(
+        mkxp_net::HTTPAsync::get(RSTRING_PTR(path), headers, rd));
+}
+RB_METHOD_GUARD_END
+
+RB_METHOD_GUARD(httpPostAsync) {
+    RB_UNUSED_PARAM;
+
+    VALUE path, postDataHash, rheaders, redirect;
+    rb_scan_args(argc, argv, "22", &path, &postDataHash, &rheaders, &redirect);
+    SafeStringValue(path);
+
+    bool rd;
+    rb_bool_arg(redirect, &rd);
+
+    mkxp_net::StringMap headers;
+    if (rheaders != Qnil)
+        headers = hash2StringMap(rheaders);
+
+    mkxp_net::StringMap form = hash2StringMap(postDataHash);
+
+    return wrapHTTPAsync(
+        mkxp_net::HTTPAsync::postForm(RSTRING_PTR(path), headers, form, rd));
+}
+RB_METHOD_GUARD_END
+
+RB_METHOD_GUARD(httpPostBodyAsync) {
+    RB_UNUSED_PARAM;
+
+    VALUE path, body, ctype, rheaders;
+    rb_scan_args(argc, argv, "31", &path, &body, &ctype, &rheaders);
+    SafeStringValue(path);
+    SafeStringValue(body);
+    SafeStringValue(ctype);
+
+    mkxp_net::StringMap headers;
+    if (rheaders != Qnil)
+        headers = hash2StringMap(rheaders);
+
+    return wrapHTTPAsync(
+        mkxp_net::HTTPAsync::postBody(RSTRING_PTR(path), headers,
+                                      RSTRING_PTR(body),
+                                      RSTRING_PTR(ctype)));
+}
+RB_METHOD_GUARD_END
+
+RB_METHOD(httpAsyncDone) {
+    RB_UNUSED_PARAM;
+
+    mkxp_net::HTTPAsync *job = getHTTPAsync(self);
+
+    return rb_bool_new(job && job->done());
+}
+
+RB_METHOD(httpAsyncStatus) {
+    RB_UNUSED_PARAM;
+
+    mkxp_net::HTTPAsync *job = getHTTPAsync(self);
+
+    return INT2NUM(job ? job->status() : 0);
+}
+
+RB_METHOD(httpAsyncHeaders) {
+    RB_UNUSED_PARAM;
+
+    mkxp_net::HTTPAsync *job = getHTTPAsync(self);
+
+    if (!job)
+        return rb_hash_new();
+
+    mkxp_net::StringMap headers = job->headersCopy();
+
+    return stringMap2hash(headers);
+}
+
+RB_METHOD(httpAsyncError) {
+    RB_UNUSED_PARAM;
+
+    mkxp_net::HTTPAsync *job = getHTTPAsync(self);
+
+    if (!job)
+        return Qnil;
+
+    std::string err = job->error();
+
+    if (err.empty())
+        return Qnil;
+
+    return rb_utf8_str_new(err.c_str(), err.length());
+}
+
+/* Returns body bytes received since the last call, or nil */
+RB_METHOD(httpAsyncRead) {
+    RB_UNUSED_PARAM;
+
+    mkxp_net::HTTPAsync *job = getHTTPAsync(self);
+
+    if (!job)
+        return Qnil;
+
+    std::string chunk = job->takeData();
+
+    if (chunk.empty())
+        return Qnil;
+
+    return rb_str_new(chunk.data(), chunk.length());
+}
+
+RB_METHOD(httpAsyncCancel) {
+    RB_UNUSED_PARAM;
+
+    mkxp_net::HTTPAsync *job = getHTTPAsync(self);
+
+    if (job)
+        job->cancel();
+
+    return Qnil;
+}
+
+#if RAPI_MAJOR >= 2
+static void *httpAsyncWaitCb(void *job) {
+    static_cast<mkxp_net::HTTPAsync *>(job)->wait(15);
+
+    return 0;
+}
+#endif
+
+/* Blocks until completion. With a block, body chunks stream
+ * into it as they arrive; without one, the full body lands
+ * in the returned hash like the blocking API */
+RB_METHOD_GUARD(httpAsyncAwait) {
+    RB_UNUSED_PARAM;
+
+    mkxp_net::HTTPAsync *job = getHTTPAsync(self);
+
+    if (!job)
+        return Qnil;
+
+    bool streaming = rb_block_given_p();
+    VALUE bodyAcc = streaming ? Qnil : rb_str_new(0, 0);
+
+    while (true) {
+        std::string chunk = job->takeData();
+
+        if (!chunk.empty()) {
+            VALUE str = rb_str_new(chunk.data(), chunk.length());
+
+            if (streaming)
+                rb_yield(str);
+            else
+                rb_str_cat(bodyAcc, chunk.data(), chunk.length());
+        }
+
+        if (job->done() && chunk.empty())
+            break;
+
+        if (chunk.empty()) {
+#if RAPI_MAJOR >= 2
+            drop_gvl_guard(httpAsyncWaitCb, job, 0, 0);
+#else
+            job->wait(15);
+#endif
+        }
+    }
+
+    std::string err = job->error();
+
+    if (!err.empty())
+        throw Exception(Exception::MKXPError, "%s", err.c_str());
+
+    VALUE ret = rb_hash_new();
+    rb_hash_aset(ret, ID2SYM(rb_intern("status")), INT2NUM(job->status()));
+    rb_hash_aset(ret, ID2SYM(rb_intern("body")),
+                 streaming ? rb_str_new(0, 0) : bodyAcc);
+
+    mkxp_net::StringMap headers = job->headersCopy();
+    rb_hash_aset(ret, ID2SYM(rb_intern("headers")), stringMap2hash(headers));
+
+    return ret;
+}
+RB_METHOD_GUARD_END
+
+/* ---- Segmented downloads ----
+ *
+ * HTTPLite.download(url, path[, headers[, segments]]) starts a
+ * parallel ranged transfer straight to disk and returns an
+ * HTTPLite::Download: poll done?/received/total, or await, which
+ * yields (received, total) to its block as progress arrives */
+
+typedef std::shared_ptr<mkxp_net::HTTPDownload> HTTPDownloadPtr;
+
+static void HTTPDownload_free(void *ptr) {
+    delete static_cast<HTTPDownloadPtr *>(ptr);
+}
+
+#if RAPI_FULL > 187
+static const rb_data_type_t HTTPDownloadType = {
+    "HTTPLiteDownload",
+    { 0, HTTPDownload_free, 0 },
+    0, 0,
+#if RAPI_FULL >= 210
+    0,
+#endif
+};
+#endif
+
+static VALUE wrapHTTPDownload(HTTPDownloadPtr job) {
+    VALUE klass = rb_const_get(rb_const_get(rb_cObject, rb_intern("HTTPLite")),
+                               rb_intern("Download"));
+    HTTPDownloadPtr *holder = new HTTPDownloadPtr(job);
+
+#if RAPI_FULL > 187
+    return TypedData_Wrap_Struct(klass, &HTTPDownloadType, holder);
+#else
+    return Data_Wrap_Struct(klass, 0, HTTPDownload_free, holder);
+#endif
+}
+
+static mkxp_net::HTTPDownload *getHTTPDownload(VALUE self) {
+#if RAPI_FULL > 187
+    if (!RTYPEDDATA_P(self) || RTYPEDDATA_TYPE(self) != &HTTPDownloadType)
+        return 0;
+
+    HTTPDownloadPtr *holder = static_cast<HTTPDownloadPtr *>(RTYPEDDATA_DATA(self));
+#else
+    HTTPDownloadPtr *holder = static_cast<HTTPDownloadPtr *>(DATA_PTR(self));
+#endif
+
+    return holder ? holder->get() : 0;
+}
+
+RB_METHOD_GUARD(httpDownload) {
+    RB_UNUSED_PARAM;
+
+    VALUE url, path, rheaders, rsegments;
+    rb_scan_args(argc, argv, "22", &url, &path, &rheaders, &rsegments);
+    SafeStringValue(url);
+    SafeStringValue(path);
+
+    mkxp_net::StringMap headers;
+    if (rheaders != Qnil)
+        headers = hash2StringMap(rheaders);
+
+    int segments = 4;
+    if (rsegments != Qnil)
+        segments = NUM2INT(rsegments);
+
+    return wrapHTTPDownload(
+        mkxp_net::HTTPDownload::start(RSTRING_PTR(url), RSTRING_PTR(path),
+                                      headers, segments));
+}
+RB_METHOD_GUARD_END
+
+RB_METHOD(httpDownloadDone) {
+    RB_UNUSED_PARAM;
+
+    mkxp_net::HTTPDownload *job = getHTTPDownload(self);
+
+    return rb_bool_new(job && job->done());
+}
+
+RB_METHOD(httpDownloadTotal) {
+    RB_UNUSED_PARAM;
+
+    mkxp_net::HTTPDownload *job = getHTTPDownload(self);
+
+    return LL2NUM(job ? job->totalBytes() : -1);
+}
+
+RB_METHOD(httpDownloadReceived) {
+    RB_UNUSED_PARAM;
+
+    mkxp_net::HTTPDownload *job = getHTTPDownload(self);
+
+    return LL2NUM(job ? job->receivedBytes() : 0);
+}
+
+RB_METHOD(httpDownloadError) {
+    RB_UNUSED_PARAM;
+
+    mkxp_net::HTTPDownload *job = getHTTPDownload(self);
+
+    if (!job)
+        return Qnil;
+
+    std::string err = job->error();
+
+    if (err.empty())
+        return Qnil;
+
+    return rb_utf8_str_new(err.c_str(), err.length());
+}
+
+RB_METHOD(httpDownloadCancel) {
+    RB_UNUSED_PARAM;
+
+    mkxp_net::HTTPDownload *job = getHTTPDownload(self);
+
+    if (job)
+        job->cancel();
+
+    return Qnil;
+}
+
+#if RAPI_MAJOR >= 2
+static void *httpDownloadWaitCb(void *job) {
+    static_cast<mkxp_net::HTTPDownload *>(job)->wait(15);
+
+    return 0;
+}
+#endif
+
+/* Blocks until completion, yielding (received, total) to an
+ * optional block whenever progress arrives */
+RB_METHOD_GUARD(httpDownloadAwait) {
+    RB_UNUSED_PARAM;
+
+    mkxp_net::HTTPDownload *job = getHTTPDownload(self);
+
+    if (!job)
+        return Qnil;
+
+    bool progress = rb_block_given_p();
+    long long lastYielded = -1;
+
+    while (!job->done()) {
+        long long received = job->receivedBytes();
+
+        if (progress && received != lastYielded) {
+            lastYielded = received;
+            rb_yield_values(2, LL2NUM(received), LL2NUM(job->totalBytes()));
+        }
+
+#if RAPI_MAJOR >= 2
+        drop_gvl_guard(httpDownloadWaitCb, job, 0, 0);
+#else
+        job->wait(15);
+#endif
+    }
+
+    std::string err = job->error();
+
+    if (!err.empty())
+        throw Exception(Exception::MKXPError, "%s", err.c_str());
+
+    if (progress)
+        rb_yield_values(2, LL2NUM(job->receivedBytes()),
+                        LL2NUM(job->totalBytes()));
+
+    return LL2NUM(job->receivedBytes());
+}
+RB_METHOD_GUARD_END
+
 RB_METHOD_GUARD(httpJsonStringify) {
     RB_UNUSED_PARAM;
     
@@ -314,7 +734,32 @@ void httpBindingInit() {
     _rb_define_module_function(mNet, "get", httpGet);
     _rb_define_module_function(mNet, "post", httpPost);
     _rb_define_module_function(mNet, "post_body", httpPostBody);
-    
+
+    _rb_define_module_function(mNet, "get_async", httpGetAsync);
+    _rb_define_module_function(mNet, "post_async", httpPostAsync);
+    _rb_define_module_function(mNet, "post_body_async", httpPostBodyAsync);
+
+    _rb_define_module_function(mNet, "download", httpDownload);
+
+    VALUE cRequest = rb_define_class_under(mNet, "Request", rb_cObject);
+    rb_undef_alloc_func(cRequest);
+    _rb_define_method(cRequest, "done?", httpAsyncDone);
+    _rb_define_method(cRequest, "status", httpAsyncStatus);
+    _rb_define_method(cRequest, "headers", httpAsyncHeaders);
+    _rb_define_method(cRequest, "error", httpAsyncError);
+    _rb_define_method(cRequest, "read", httpAsyncRead);
+    _rb_define_method(cRequest, "cancel", httpAsyncCancel);
+    _rb_define_method(cRequest, "await", httpAsyncAwait);
+    
+    VALUE cDownload = rb_define_class_under(mNet, "Download", rb_cObject);
+    rb_undef_alloc_func(cDownload);
+    _rb_define_method(cDownload, "done?", httpDownloadDone);
+    _rb_define_method(cDownload, "total", httpDownloadTotal);
+    _rb_define_method(cDownload, "received", httpDownloadReceived);
+    _rb_define_method(cDownload, "error", httpDownloadError);
+    _rb_define_method(cDownload, "cancel", httpDownloadCancel);
+    _rb_define_method(cDownload, "await", httpDownloadAwait);
+
     VALUE mNetJSON = rb_define_module_under(mNet, "JSON");
     _rb_define_module_function(mNetJSON, "stringify", httpJsonStringify);
     _rb_define_module_function(mNetJSON, "parse", httpJsonParse);
@@ -20,7 +20,10 @@
  */
 
 #include <SDL_joystick.h>
+#include <algorithm>
+#include <cstdint>
 #include <string>
+#include <vector>
 
 
 #include "eventthread.h"
@@ -46,28 +49,84 @@ RB_METHOD_GUARD(inputUpdate) {
 }
 RB_METHOD_GUARD_END
 
+/* ---- Symbol dispatch cache ----
+ *
+ * Action games poll dozens of buttons per frame, and each
+ * symbol argument went through a Ruby Hash probe. The symbol
+ * to button code map is fixed at init, so it fits a small
+ * native open-addressing table (quarter load, linear probe):
+ * a hit is one multiply-hash and typically a single slot
+ * compare, independent of how the runtime scattered the
+ * interned IDs. Empty slots use key 0, which rb_intern
+ * never yields */
+
+static struct {
+    std::vector<ID> keys;
+    std::vector<int32_t> vals;
+    size_t mask;
+} buttonLookup;
+
+static inline size_t buttonLookupSlot(ID id) {
+    return (size_t) ((uint64_t) id * 0x9E3779B97F4A7C15ull >> 32)
+           & buttonLookup.mask;
+}
+
+static void buildButtonLookup(const ID *ids, const int *vals, size_t count) {
+    size_t size = 64;
+
+    while (size < count * 4)
+        size *= 2;
+
+    buttonLookup.keys.assign(size, 0);
+    buttonLookup.vals.assign(size, 0);
+    buttonLookup.mask = size - 1;
+
+    for (size_t i = 0; i < count; ++i) {
+        size_t slot = buttonLookupSlot(ids[i]);
+
+        while (buttonLookup.keys[slot] != 0
+           &&  buttonLookup.keys[slot] != ids[i])
+            slot = (slot + 1) & buttonLookup.mask;
+
+        buttonLookup.keys[slot] = ids[i];
+        buttonLookup.vals[slot] = vals[i];
+    }
+}
+
+static int lookupButtonSym(ID id) {
+    /* Only populated for RGSS3, which is also the only
+     * caller; belt and braces anyway */
+    if (buttonLookup.keys.empty())
+        return Input::None;
+
+    size_t slot = buttonLookupSlot(id);
+
+    while (true) {
+        ID key = buttonLookup.keys[slot];
+
+        if (key == id)
+            return buttonLookup.vals[slot];
+
+        if (key == 0)
+            return Input::None;
+
+        slot = (slot + 1) & buttonLookup.mask;
+    }
+}
+
 static int getButtonArg(VALUE *argv) {
     int num;
-    
+
     if (FIXNUM_P(*argv)) {
         num = FIX2INT(*argv);
     } else if (SYMBOL_P(*argv) && rgssVer >= 3) {
-        VALUE symHash = getRbData()->buttoncodeHash;
-#if RAPI_FULL > 187
-        num = FIX2INT(rb_hash_lookup2(symHash, *argv, INT2FIX(Input::None)));
-#else
-        VALUE res = rb_hash_aref(symHash, *argv);
-        if (!NIL_P(res))
-            num = FIX2INT(res);
-        else
-            num = Input::None;
-#endif
+        num = lookupButtonSym(SYM2ID(*argv));
     } else {
         // FIXME: RMXP allows only few more types that
         // don't make sense (symbols in pre 3, floats)
         num = 0;
     }
-    
+
     return num;
 }
 
@@ -510,16 +569,89 @@ RB_METHOD(inputSetMode) {
 
 RB_METHOD(inputGets) {
     RB_UNUSED_PARAM;
-    shState->eThread().lockText(true);
     VALUE ret = rb_utf8_str_new_cstr(shState->input().getText());
     shState->input().clearText();
-    shState->eThread().lockText(false);
+    return ret;
+}
+
+/* Async haptics: fire-and-forget, never blocks the script */
+RB_METHOD_GUARD(inputRumble) {
+    RB_UNUSED_PARAM;
+
+    double low, high;
+    int duration;
+
+    rb_get_args(argc, argv, "ffi", &low, &high, &duration RB_ARG_END);
+
+    shState->eThread().requestRumble((float) low, (float) high, duration);
+
+    return Qnil;
+}
+RB_METHOD_GUARD_END
+
+/* Pattern: array of [low, high, duration_ms] steps, played
+ * back to back off-thread; a new call supersedes it */
+RB_METHOD_GUARD(inputRumblePattern) {
+    RB_UNUSED_PARAM;
+
+    VALUE ary;
+    rb_scan_args(argc, argv, "1", &ary);
+    Check_Type(ary, T_ARRAY);
+
+    std::vector<EventThread::RumbleStep> steps;
+
+    for (long i = 0; i < RARRAY_LEN(ary); ++i) {
+        VALUE stepObj = rb_ary_entry(ary, i);
+        Check_Type(stepObj, T_ARRAY);
+
+        if (RARRAY_LEN(stepObj) < 3)
+            throw Exception(Exception::ArgumentError,
+                            "rumble step needs [low, high, duration]");
+
+        EventThread::RumbleStep step;
+        double low = NUM2DBL(rb_ary_entry(stepObj, 0));
+        double high = NUM2DBL(rb_ary_entry(stepObj, 1));
+
+        step.low = (uint16_t) (clamp(low, 0.0, 1.0) * 0xFFFF);
+        step.high = (uint16_t) (clamp(high, 0.0, 1.0) * 0xFFFF);
+        step.durationMs = (uint32_t) std::max(
+            NUM2INT(rb_ary_entry(stepObj, 2)), 0);
+
+        steps.push_back(step);
+    }
+
+    if (!steps.empty())
+        shState->eThread().requestRumblePattern(steps);
+
+    return Qnil;
+}
+RB_METHOD_GUARD_END
+
+/* Live IME composition: {text:, start:, length:} while one
+ * is in progress, nil otherwise */
+RB_METHOD(inputComposition) {
+    RB_UNUSED_PARAM;
+
+    Input &input = shState->input();
+
+    if (!*input.compositionText())
+        return Qnil;
+
+    VALUE ret = rb_hash_new();
+    rb_hash_aset(ret, ID2SYM(rb_intern("text")),
+                 rb_utf8_str_new_cstr(input.compositionText()));
+    rb_hash_aset(ret, ID2SYM(rb_intern("start")),
+                 INT2NUM(input.compositionStart()));
+    rb_hash_aset(ret, ID2SYM(rb_intern("length")),
+                 INT2NUM(input.compositionLength()));
+
     return ret;
 }
 
 RB_METHOD_GUARD(inputGetClipboard) {
     RB_UNUSED_PARAM;
-    return rb_utf8_str_new_cstr(shState->input().getClipboardText());
+    std::string text = shState->input().getClipboardText();
+    return rb_utf8_str_new(text.c_str(), text.length());
 }
 RB_METHOD_GUARD_END
 
@@ -609,6 +741,8 @@ void inputBindingInit() {
     _rb_define_module_function(submod, "axes_left", inputControllerGetLeftAxis);
     _rb_define_module_function(submod, "axes_right", inputControllerGetRightAxis);
     _rb_define_module_function(submod, "axes_trigger", inputControllerGetTriggerAxis);
+    _rb_define_module_function(submod, "rumble", inputRumble);
+    _rb_define_module_function(submod, "rumble_pattern", inputRumblePattern);
     _rb_define_module_function(submod, "raw_button_states", inputControllerRawButtonStates);
     _rb_define_module_function(submod, "raw_axes", inputControllerRawAxes);
     _rb_define_module_function(submod, "pressex?", inputControllerPressEx);
@@ -621,23 +755,32 @@ void inputBindingInit() {
     _rb_define_module_function(module, "text_input", inputGetMode);
     _rb_define_module_function(module, "text_input=", inputSetMode);
     _rb_define_module_function(module, "gets", inputGets);
+    _rb_define_module_function(module, "composition", inputComposition);
     
     _rb_define_module_function(module, "clipboard", inputGetClipboard);
     _rb_define_module_function(module, "clipboard=", inputSetClipboard);
     
     if (rgssVer >= 3) {
         VALUE symHash = rb_hash_new();
-        
+
+        std::vector<ID> lookupIds(buttonCodesN);
+        std::vector<int> lookupVals(buttonCodesN);
+
         for (size_t i = 0; i < buttonCodesN; ++i) {
             ID sym = rb_intern(buttonCodes[i].str);
             VALUE val = INT2FIX(buttonCodes[i].val);
-            
+
             /* In RGSS3 all Input::XYZ constants are equal to :XYZ symbols,
              * to be compatible with the previous convention */
             rb_const_set(module, sym, ID2SYM(sym));
             rb_hash_aset(symHash, ID2SYM(sym), val);
+
+            lookupIds[i] = sym;
+            lookupVals[i] = buttonCodes[i].val;
         }
-        
+
+        buildButtonLookup(lookupIds.data(), lookupVals.data(), buttonCodesN);
+
         rb_iv_set(module, "buttoncodes", symHash);
         getRbData()->buttoncodeHash = symHash;
     } else {
@@ -43,6 +43,94 @@ static void *MiniFFI_GetFunctionHandle(void *libhandle, const char *func) {
     return SDL_LoadFunction(libhandle, func);
 }
 
+/* ---- Signature specialization ----
+ *
+ * The generic call path re-read the function pointer and
+ * type tags out of Ruby ivars/arrays on every invocation.
+ * Everything static about the signature is baked into a
+ * native spec at initialize: function pointer, arity, one
+ * converter function pointer per argument, export type.
+ * Repeat calls walk a flat array of converters and jump
+ * through the arity trampoline - no Ruby containers */
+
+typedef mffi_value (*MiniFFIConv)(VALUE);
+
+struct MiniFFISpec {
+    MINIFFI_FUNC fn;
+    int nparams;
+    int exportType;
+    MiniFFIConv conv[MINIFFI_MAX_ARGS];
+};
+
+static mffi_value mffiConvNumber(VALUE v) {
+    return RB2MVAL(v);
+}
+
+static mffi_value mffiConvInteger(VALUE v) {
+#if INTPTR_MAX == INT64_MAX
+    return RB2MVAL(v) & UINT32_MAX;
+#else
+    return RB2MVAL(v);
+#endif
+}
+
+static mffi_value mffiConvBool(VALUE v) {
+    bool b = false;
+    rb_bool_arg(v, &b);
+
+    return b;
+}
+
+static mffi_value mffiConvPointer(VALUE v) {
+    if (NIL_P(v))
+        return 0;
+
+    if (FIXNUM_P(v))
+        return RB2MVAL(v);
+
+    StringValue(v);
+    rb_str_modify(v);
+
+    return (mffi_value) RSTRING_PTR(v);
+}
+
+static void MiniFFISpec_free(void *spec) {
+    delete static_cast<MiniFFISpec *>(spec);
+}
+
+#if RAPI_FULL > 187
+static const rb_data_type_t MiniFFISpecType = {
+    "MiniFFISpec",
+    { 0, MiniFFISpec_free, 0 },
+    0, 0,
+#if RAPI_FULL >= 210
+    0,
+#endif
+};
+#endif
+
+static VALUE wrapMiniFFISpec(MiniFFISpec *spec) {
+#if RAPI_FULL > 187
+    return TypedData_Wrap_Struct(rb_cObject, &MiniFFISpecType, spec);
+#else
+    return Data_Wrap_Struct(rb_cObject, 0, MiniFFISpec_free, spec);
+#endif
+}
+
+static MiniFFISpec *getMiniFFISpec(VALUE obj) {
+    if (NIL_P(obj))
+        return 0;
+
+#if RAPI_FULL > 187
+    if (!RTYPEDDATA_P(obj) || RTYPEDDATA_TYPE(obj) != &MiniFFISpecType)
+        return 0;
+
+    return static_cast<MiniFFISpec *>(RTYPEDDATA_DATA(obj));
+#else
+    return static_cast<MiniFFISpec *>(DATA_PTR(obj));
+#endif
+}
+
 // MiniFFI.new(library, function[, imports[, exports]])
 // Yields itself in blocks
 
@@ -177,6 +265,32 @@ RB_METHOD_GUARD(MiniFFI_initialize) {
         }
     }
     rb_iv_set(self, "_exports", INT2FIX(ex));
+
+    /* Bake the signature; from here on calls never touch
+     * the ivars or type arrays again */
+    MiniFFISpec *spec = new MiniFFISpec;
+    spec->fn = (MINIFFI_FUNC) hfunc;
+    spec->nparams = (int) RARRAY_LEN(ary_imports);
+    spec->exportType = ex;
+
+    for (int i = 0; i < spec->nparams; ++i) {
+        switch (FIX2INT(rb_ary_entry(ary_imports, i))) {
+        case _T_POINTER:
+            spec->conv[i] = mffiConvPointer;
+            break;
+        case _T_BOOL:
+            spec->conv[i] = mffiConvBool;
+            break;
+        case _T_INTEGER:
+            spec->conv[i] = mffiConvInteger;
+            break;
+        default:
+            spec->conv[i] = mffiConvNumber;
+        }
+    }
+
+    rb_ivar_set(self, CACHED_ID("_spec"), wrapMiniFFISpec(spec));
+
     if (rb_block_given_p())
         rb_yield(self);
     return Qnil;
@@ -192,74 +306,47 @@ typedef struct {
 
 void* miniffi_call_cb(void *args) {
     MFFICallCBArgs *a = (MFFICallCBArgs*)args;
-    return (void*)miniffi_call_intern(a->function, a->args, a->nparams);
+    return (void*)miniffi_call_arity(a->function, a->args, a->nparams);
     }
 #endif
 
 RB_METHOD_GUARD(MiniFFI_call) {
     MiniFFIFuncArgs param;
-#define params param.params
-    VALUE func = rb_iv_get(self, "_func");
-    VALUE own_imports = rb_iv_get(self, "_imports");
-    VALUE own_exports = rb_iv_get(self, "_exports");
-    MINIFFI_FUNC ApiFunction = (MINIFFI_FUNC)RB2MVAL(func);
-    VALUE args;
-    int items = rb_scan_args(argc, argv, "0*", &args);
-    int nimport = RARRAY_LEN(own_imports);
-    if (items != nimport)
+
+    const MiniFFISpec *spec =
+        getMiniFFISpec(rb_ivar_get(self, CACHED_ID("_spec")));
+
+    if (!spec)
+        throw Exception(Exception::RuntimeError, "uninitialized function");
+
+    if (argc != spec->nparams)
         throw Exception(Exception::RuntimeError,
-                 "wrong number of parameters: expected %d, got %d", nimport, items);
-    
-    for (int i = 0; i < nimport; i++) {
-        VALUE str = rb_ary_entry(args, i);
-        mffi_value lParam = 0;
-        switch (FIX2INT(rb_ary_entry(own_imports, i))) {
-            case _T_POINTER:
-                if (NIL_P(str)) {
-                    lParam = 0;
-                } else if (FIXNUM_P(str)) {
-                    lParam = RB2MVAL(str);
-                } else {
-                    StringValue(str);
-                    rb_str_modify(str);
-                    lParam = (mffi_value)RSTRING_PTR(str);
-                }
-                break;
-                
-            case _T_BOOL:
-                rb_bool_arg(rb_ary_entry(args, i), (bool*)&lParam);
-                break;
-                
-            case _T_INTEGER:
-#if INTPTR_MAX == INT64_MAX
-                lParam = RB2MVAL(rb_ary_entry(args, i)) & UINT32_MAX;
-                break;
-#endif
-            case _T_NUMBER:
-            default:
-                lParam = RB2MVAL(rb_ary_entry(args, i));
-                break;
-        }
-        params[i] = lParam;
-    }
+                 "wrong number of parameters: expected %d, got %d",
+                 spec->nparams, argc);
+
+    /* Arguments come straight from argv through the baked
+     * converter list; no scan, no array walk, no tag switch */
+    for (int i = 0; i < spec->nparams; i++)
+        param.params[i] = spec->conv[i](argv[i]);
+
 #if RAPI_MAJOR >= 2
-    MFFICallCBArgs cb_args {ApiFunction, &param, nimport};
+    MFFICallCBArgs cb_args {spec->fn, &param, spec->nparams};
     mffi_value ret = (mffi_value)rb_thread_call_without_gvl(miniffi_call_cb, &cb_args, 0, 0);
 #else
-    mffi_value ret = miniffi_call_intern(ApiFunction, &param, nimport);
+    mffi_value ret = miniffi_call_arity(spec->fn, &param, spec->nparams);
 #endif
-    
-    switch (FIX2INT(own_exports)) {
+
+    switch (spec->exportType) {
         case _T_NUMBER:
         case _T_INTEGER:
             return MVAL2RB(ret);
-            
+
         case _T_POINTER:
             return rb_utf8_str_new_cstr((char *)ret);
-            
+
         case _T_BOOL:
             return rb_bool_new(ret);
-            
+
         case _T_VOID:
         default:
             return MVAL2RB(0);
@@ -1,5 +1,7 @@
 #include "miniffi.h"
 #include <assert.h>
+#include <cstddef>
+#include <utility>
 
 #if defined(__MINGW64__) || defined(__linux__) || defined(__APPLE__)
 mffi_value miniffi_call_intern(MINIFFI_FUNC target, MiniFFIFuncArgs *p, int nparams) {
@@ -57,3 +59,53 @@ mffi_value miniffi_call_intern(MINIFFI_FUNC target, MiniFFIFuncArgs *p, int npar
     return ret;
 }
 #endif
+
+#if defined(__MINGW64__) || defined(__linux__) || defined(__APPLE__)
+
+/* One trampoline per arity, generated at compile time: the
+ * callee sees a call with exactly N arguments, so repeat
+ * calls skip the 16-slot expansion entirely */
+template<std::size_t>
+using MffiArg = mffi_value;
+
+template<std::size_t... I>
+static mffi_value miniffi_call_exact(MINIFFI_FUNC target,
+                                     const MiniFFIFuncArgs *p,
+                                     std::index_sequence<I...>) {
+    typedef mffi_value (*ExactFn)(MffiArg<I>...);
+
+    return reinterpret_cast<ExactFn>(target)(p->params[I]...);
+}
+
+template<std::size_t N>
+static mffi_value miniffi_call_n(MINIFFI_FUNC target,
+                                 MiniFFIFuncArgs *p) {
+    return miniffi_call_exact(target, p, std::make_index_sequence<N>());
+}
+
+typedef mffi_value (*MiniFFITrampoline)(MINIFFI_FUNC, MiniFFIFuncArgs *);
+
+static const MiniFFITrampoline miniffi_trampolines[MINIFFI_MAX_ARGS + 1] = {
+    miniffi_call_n<0>,  miniffi_call_n<1>,  miniffi_call_n<2>,
+    miniffi_call_n<3>,  miniffi_call_n<4>,  miniffi_call_n<5>,
+    miniffi_call_n<6>,  miniffi_call_n<7>,  miniffi_call_n<8>,
+    miniffi_call_n<9>,  miniffi_call_n<10>, miniffi_call_n<11>,
+    miniffi_call_n<12>, miniffi_call_n<13>, miniffi_call_n<14>,
+    miniffi_call_n<15>, miniffi_call_n<16>,
+};
+
+mffi_value miniffi_call_arity(MINIFFI_FUNC target, MiniFFIFuncArgs *p,
+                              int nparams) {
+    assert(nparams >= 0 && nparams <= MINIFFI_MAX_ARGS);
+
+    return miniffi_trampolines[nparams](target, p);
+}
+
+#else // 32-bit Windows
+
+mffi_value miniffi_call_arity(MINIFFI_FUNC target, MiniFFIFuncArgs *p,
+                              int nparams) {
+    return miniffi_call_intern(target, p, nparams);
+}
+
+#endif
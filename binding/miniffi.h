@@ -30,3 +30,10 @@ typedef struct {
 } MiniFFIFuncArgs;
 
 mffi_value miniffi_call_intern(MINIFFI_FUNC target, MiniFFIFuncArgs *p, int nparams);
+
+/* Arity-specialized dispatch: on the 64-bit/POSIX path each
+ * arity gets its own precompiled trampoline passing exactly
+ * that many arguments, instead of always expanding all 16
+ * slots; the 32-bit Windows asm path is already count-driven
+ * and forwards to miniffi_call_intern */
+mffi_value miniffi_call_arity(MINIFFI_FUNC target, MiniFFIFuncArgs *p, int nparams);
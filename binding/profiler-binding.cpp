@@ -0,0 +1,240 @@
+/*
+** profiler-binding.cpp
+**
+** This file is part of mkxp.
+**
+** Copyright (C) 2013 - 2021 Amaryllis Kulla <ancurio@mapleshrine.eu>
+**
+** mkxp is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 2 of the License, or
+** (at your option) any later version.
+**
+** mkxp is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with mkxp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "binding-util.h"
+#include "graphics.h"
+#include "sharedstate.h"
+#include "util/zonetrace.h"
+
+#include <SDL_timer.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+/* Script-side profiling zones (Profiler module): begin/end (or
+ * measure { }) aggregates per-zone count/total/max natively, so
+ * event code cost is visible without Ruby-side timing overhead.
+ * Zones nest; everything runs on the script thread. In trace
+ * builds, script zones also land on the cross-thread timeline */
+
+namespace
+{
+
+struct ZoneAgg
+{
+	uint64_t count = 0;
+	uint64_t totalUs = 0;
+	uint64_t maxUs = 0;
+};
+
+struct OpenZone
+{
+	std::string name;
+	Uint64 start;
+};
+
+std::map<std::string, ZoneAgg> aggregates;
+std::vector<OpenZone> openStack;
+
+/* Trace-build zone names must be stable literals; keep the
+ * interned copies alive for the process */
+#ifdef MKXPZ_TRACE
+const char *internZoneName(const std::string &name)
+{
+	static std::map<std::string, const char *> interned;
+
+	std::map<std::string, const char *>::iterator it = interned.find(name);
+	if (it != interned.end())
+		return it->second;
+
+	char *copy = new char[name.size() + 1];
+	memcpy(copy, name.c_str(), name.size() + 1);
+	interned[name] = copy;
+	return copy;
+}
+#endif
+
+void zoneBegin(const char *name)
+{
+	OpenZone z;
+	z.name = name;
+	z.start = SDL_GetPerformanceCounter();
+	openStack.push_back(z);
+
+#ifdef MKXPZ_TRACE
+	ZoneTrace::enter(internZoneName(z.name));
+#endif
+}
+
+void zoneEnd()
+{
+	if (openStack.empty())
+		return;
+
+#ifdef MKXPZ_TRACE
+	ZoneTrace::leave();
+#endif
+
+	const OpenZone z = openStack.back();
+	openStack.pop_back();
+
+	const Uint64 now = SDL_GetPerformanceCounter();
+	const Uint64 freq = SDL_GetPerformanceFrequency();
+	const uint64_t us = (uint64_t) ((now - z.start) * 1000000ull / freq);
+
+	/* Scripts generating unique names per call would grow this
+	 * forever; cap the table (existing zones keep aggregating) */
+	if (aggregates.size() >= 512 && aggregates.find(z.name) == aggregates.end())
+		return;
+
+	ZoneAgg &agg = aggregates[z.name];
+	agg.count++;
+	agg.totalUs += us;
+	if (us > agg.maxUs)
+		agg.maxUs = us;
+}
+
+}
+
+RB_METHOD(profilerBegin)
+{
+	RB_UNUSED_PARAM;
+
+	VALUE nameObj;
+	rb_get_args(argc, argv, "o", &nameObj RB_ARG_END);
+	SafeStringValue(nameObj);
+
+	zoneBegin(RSTRING_PTR(nameObj));
+
+	return Qnil;
+}
+
+RB_METHOD(profilerEnd)
+{
+	RB_UNUSED_PARAM;
+
+	zoneEnd();
+
+	return Qnil;
+}
+
+RB_METHOD(profilerMeasure)
+{
+	RB_UNUSED_PARAM;
+
+	VALUE nameObj;
+	rb_get_args(argc, argv, "o", &nameObj RB_ARG_END);
+	SafeStringValue(nameObj);
+
+	zoneBegin(RSTRING_PTR(nameObj));
+
+	int state = 0;
+	VALUE result = rb_protect([](VALUE) -> VALUE {
+		return rb_yield(Qnil);
+	}, Qnil, &state);
+
+	zoneEnd();
+
+	if (state)
+		rb_jump_tag(state);
+
+	return result;
+}
+
+RB_METHOD(profilerStats)
+{
+	RB_UNUSED_PARAM;
+
+	VALUE ret = rb_hash_new();
+
+	for (std::map<std::string, ZoneAgg>::const_iterator it = aggregates.begin();
+	     it != aggregates.end(); ++it)
+	{
+		const ZoneAgg &agg = it->second;
+
+		VALUE entry = rb_hash_new();
+		rb_hash_aset(entry, ID2SYM(rb_intern("count")),
+		             ULL2NUM(agg.count));
+		rb_hash_aset(entry, ID2SYM(rb_intern("total_ms")),
+		             rb_float_new(agg.totalUs / 1000.0));
+		rb_hash_aset(entry, ID2SYM(rb_intern("avg_ms")),
+		             rb_float_new(agg.count
+		                 ? (agg.totalUs / 1000.0) / agg.count : 0.0));
+		rb_hash_aset(entry, ID2SYM(rb_intern("max_ms")),
+		             rb_float_new(agg.maxUs / 1000.0));
+
+		rb_hash_aset(ret, rb_utf8_str_new(it->first.c_str(),
+		                                  it->first.size()), entry);
+	}
+
+	return ret;
+}
+
+RB_METHOD(profilerReset)
+{
+	RB_UNUSED_PARAM;
+
+	aggregates.clear();
+
+	return Qnil;
+}
+
+RB_METHOD(profilerFrame)
+{
+	RB_UNUSED_PARAM;
+
+	double frameMs = 0, scriptMs = 0;
+	double composite = 0, present = 0, transition = 0;
+
+	GFX_LOCK;
+	shState->graphics().frameTimes(frameMs, scriptMs);
+	bool gpu = shState->graphics().gpuStats(composite, present, transition);
+	GFX_UNLOCK;
+
+	VALUE ret = rb_hash_new();
+	rb_hash_aset(ret, ID2SYM(rb_intern("frame_ms")), rb_float_new(frameMs));
+	rb_hash_aset(ret, ID2SYM(rb_intern("script_ms")), rb_float_new(scriptMs));
+
+	if (gpu)
+	{
+		rb_hash_aset(ret, ID2SYM(rb_intern("gpu_composite_ms")),
+		             rb_float_new(composite));
+		rb_hash_aset(ret, ID2SYM(rb_intern("gpu_present_ms")),
+		             rb_float_new(present));
+		rb_hash_aset(ret, ID2SYM(rb_intern("gpu_transition_ms")),
+		             rb_float_new(transition));
+	}
+
+	return ret;
+}
+
+void profilerBindingInit()
+{
+	VALUE module = rb_define_module("Profiler");
+
+	_rb_define_module_function(module, "begin", profilerBegin);
+	_rb_define_module_function(module, "end", profilerEnd);
+	_rb_define_module_function(module, "measure", profilerMeasure);
+	_rb_define_module_function(module, "stats", profilerStats);
+	_rb_define_module_function(module, "reset", profilerReset);
+	_rb_define_module_function(module, "frame", profilerFrame);
+}
@@ -0,0 +1,199 @@
+/*
+** rpgnative-binding.cpp
+**
+** This file is part of mkxp.
+**
+** Copyright (C) 2013 - 2021 Amaryllis Kulla <ancurio@mapleshrine.eu>
+**
+** mkxp is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 2 of the License, or
+** (at your option) any later version.
+**
+** mkxp is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with mkxp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "binding-types.h"
+#include "binding-util.h"
+#include "exception.h"
+#include "sprite.h"
+#include "etc.h"
+#include "table.h"
+
+#include <stdlib.h>
+
+/* Native fast paths for the hottest interpreted RPG module
+ * methods (RGSS1): weather particle stepping and animation
+ * cell application ran per frame in pure Ruby, a big slice
+ * of battle scene time. The embedded module_rpg1 script
+ * delegates here with plain scalars; the Ruby-visible API
+ * of RPG::Sprite / RPG::Weather is unchanged */
+
+static int16_t cellAt(const Table *t, int x, int y)
+{
+    if (x >= t->xSize() || y >= t->ySize())
+        return 0;
+
+    return t->get(x, y);
+}
+
+RB_METHOD_GUARD(rpgWeatherUpdate) {
+    RB_UNUSED_PARAM;
+
+    VALUE spritesObj;
+    int type, max, ox, oy;
+
+    rb_get_args(argc, argv, "oiiii", &spritesObj, &type, &max,
+                &ox, &oy RB_ARG_END);
+
+    if (!RB_TYPE_P(spritesObj, T_ARRAY))
+        throw Exception(Exception::ArgumentError,
+                        "expected sprite array");
+
+    long len = RARRAY_LEN(spritesObj);
+
+    GFX_GUARD_EXC(
+        for (long i = 1; i <= max && i < len; ++i) {
+            VALUE sObj = rb_ary_entry(spritesObj, i);
+
+            if (NIL_P(sObj))
+                break;
+
+            Sprite *s = getPrivateDataNoRaise<Sprite>(sObj);
+
+            if (!s)
+                continue;
+
+            int x = s->getX();
+            int y = s->getY();
+            int op = s->getOpacity();
+
+            switch (type) {
+            case 1: x -= 2; y += 16; op -= 8;  break;
+            case 2: x -= 8; y += 16; op -= 12; break;
+            case 3: x -= 2; y += 8;  op -= 8;  break;
+            }
+
+            int rx = x - ox;
+            int ry = y - oy;
+
+            if (op < 64 || rx < -50 || rx > 750
+            ||  ry < -300 || ry > 500) {
+                x = rand() % 800 - 50 + ox;
+                y = rand() % 800 - 200 + oy;
+                op = 255;
+            }
+
+            s->setX(x);
+            s->setY(y);
+            s->setOpacity(clamp(op, 0, 255));
+        }
+    );
+
+    return Qnil;
+}
+
+RB_METHOD_GUARD(rpgAnimationSetSprites) {
+    RB_UNUSED_PARAM;
+
+    VALUE spritesObj, cellObj;
+    int position, x, y, ox, oy, srcW, srcH, vpW, vpH, opacity;
+
+    rb_get_args(argc, argv, "ooiiiiiiiiii", &spritesObj, &cellObj,
+                &position, &x, &y, &ox, &oy, &srcW, &srcH,
+                &vpW, &vpH, &opacity RB_ARG_END);
+
+    if (!RB_TYPE_P(spritesObj, T_ARRAY))
+        throw Exception(Exception::ArgumentError,
+                        "expected sprite array");
+
+    Table *cells = getPrivateDataCheck<Table>(cellObj, TableType);
+
+    if (!cells)
+        return Qnil;
+
+    int baseX, baseY;
+
+    if (position == 3) {
+        /* Screen positioned; vpW < 0 flags 'no viewport' */
+        if (vpW >= 0) {
+            baseX = vpW / 2;
+            baseY = vpH - 160;
+        } else {
+            baseX = 320;
+            baseY = 240;
+        }
+    } else {
+        baseX = x - ox + srcW / 2;
+        baseY = y - oy + srcH / 2;
+
+        if (position == 0)
+            baseY -= srcH / 4;
+        if (position == 2)
+            baseY += srcH / 4;
+    }
+
+    long len = RARRAY_LEN(spritesObj);
+
+    GFX_GUARD_EXC(
+        for (int i = 0; i < 16; ++i) {
+            Sprite *s = 0;
+
+            if (i < len) {
+                VALUE sObj = rb_ary_entry(spritesObj, i);
+
+                if (!NIL_P(sObj))
+                    s = getPrivateDataNoRaise<Sprite>(sObj);
+            }
+
+            if (!s)
+                continue;
+
+            int pattern = (i < cells->xSize() && cells->ySize() > 0)
+                        ? cells->get(i, 0) : -1;
+
+            if (pattern == -1) {
+                s->setVisible(false);
+                continue;
+            }
+
+            s->setVisible(true);
+            s->getSrcRect().set(pattern % 5 * 192,
+                                pattern / 5 * 192, 192, 192);
+
+            s->setX(baseX + cellAt(cells, i, 1));
+            s->setY(baseY + cellAt(cells, i, 2));
+            s->setZ(2000);
+            s->setOX(96);
+            s->setOY(96);
+
+            float zoom = cellAt(cells, i, 3) / 100.0f;
+            s->setZoomX(zoom);
+            s->setZoomY(zoom);
+
+            s->setAngle(cellAt(cells, i, 4));
+            s->setMirror(cellAt(cells, i, 5) == 1);
+            s->setOpacity(cellAt(cells, i, 6) * opacity / 255);
+            s->setBlendType(cellAt(cells, i, 7));
+        }
+    );
+
+    return Qnil;
+}
+
+void rpgNativeBindingInit() {
+    /* The RPG module proper is opened by the embedded
+     * script right after; defining it here just makes the
+     * delegation targets available first */
+    VALUE rpg = rb_define_module("RPG");
+
+    _rb_define_module_function(rpg, "_weather_update", rpgWeatherUpdate);
+    _rb_define_module_function(rpg, "_animation_set_sprites",
+                               rpgAnimationSetSprites);
+}
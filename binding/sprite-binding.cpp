@@ -108,6 +108,105 @@ RB_METHOD_GUARD(spriteHeight) {
 }
 RB_METHOD_GUARD_END
 
+/* Batch property setter: one binding crossing and one
+ * graphics lock for any mix of the hot per-frame attributes,
+ * instead of a dispatch + lock per assignment */
+RB_METHOD_GUARD(spriteSetBatch) {
+    Sprite *s = getPrivateData<Sprite>(self);
+
+    if (argc != 1 || !RB_TYPE_P(argv[0], T_HASH))
+        throw Exception(Exception::ArgumentError,
+                        "expected an attribute hash");
+
+    VALUE hash = argv[0];
+
+    enum {
+        vX, vY, vOX, vOY, vZ, vOpacity, vBushDepth, vBushOpacity,
+        vBlendType, vZoomX, vZoomY, vAngle, vMirror, vVisible,
+        vSrcRect, vCount
+    };
+
+    static const char *names[vCount] = {
+        "x", "y", "ox", "oy", "z", "opacity", "bush_depth",
+        "bush_opacity", "blend_type", "zoom_x", "zoom_y", "angle",
+        "mirror", "visible", "src_rect"
+    };
+
+    static ID ids[vCount];
+    static bool idsInterned = false;
+
+    if (!idsInterned) {
+        for (int i = 0; i < vCount; ++i)
+            ids[i] = rb_intern(names[i]);
+        idsInterned = true;
+    }
+
+    /* Phase one: pull and convert every value while raising
+     * is still safe (no graphics lock held yet) */
+    bool has[vCount] = { false };
+    int iv[vCount] = { 0 };
+    double fv[vCount] = { 0 };
+    bool bv[vCount] = { false };
+    Rect *srcRect = 0;
+    VALUE srcRectObj = Qnil;
+    long found = 0;
+
+    for (int i = 0; i < vCount; ++i) {
+        VALUE val = rb_hash_lookup2(hash, ID2SYM(ids[i]), Qundef);
+
+        if (val == Qundef)
+            continue;
+
+        has[i] = true;
+        ++found;
+
+        switch (i) {
+        case vZoomX: case vZoomY: case vAngle:
+            fv[i] = NUM2DBL(val);
+            break;
+        case vMirror: case vVisible:
+            bv[i] = RTEST(val);
+            break;
+        case vSrcRect:
+            srcRectObj = val;
+            srcRect = getPrivateDataCheck<Rect>(val, RectType);
+            break;
+        default:
+            iv[i] = NUM2INT(val);
+        }
+    }
+
+    /* Typos shouldn't silently do nothing */
+    if (found != (long) RHASH_SIZE(hash))
+        throw Exception(Exception::ArgumentError,
+                        "unknown sprite attribute in hash");
+
+    /* Phase two: apply natively under a single lock */
+    GFX_GUARD_EXC(
+        if (has[vX]) s->setX(iv[vX]);
+        if (has[vY]) s->setY(iv[vY]);
+        if (has[vOX]) s->setOX(iv[vOX]);
+        if (has[vOY]) s->setOY(iv[vOY]);
+        if (has[vZ]) s->setZ(iv[vZ]);
+        if (has[vOpacity]) s->setOpacity(iv[vOpacity]);
+        if (has[vBushDepth]) s->setBushDepth(iv[vBushDepth]);
+        if (has[vBushOpacity]) s->setBushOpacity(iv[vBushOpacity]);
+        if (has[vBlendType]) s->setBlendType(iv[vBlendType]);
+        if (has[vZoomX]) s->setZoomX(fv[vZoomX]);
+        if (has[vZoomY]) s->setZoomY(fv[vZoomY]);
+        if (has[vAngle]) s->setAngle(fv[vAngle]);
+        if (has[vMirror]) s->setMirror(bv[vMirror]);
+        if (has[vVisible]) s->setVisible(bv[vVisible]);
+        if (srcRect) s->setSrcRect(*srcRect);
+    );
+
+    if (srcRect)
+        rb_ivar_set(self, CACHED_ID("src_rect"), srcRectObj);
+
+    return self;
+}
+RB_METHOD_GUARD_END
+
 void spriteBindingInit() {
     VALUE klass = rb_define_class("Sprite", rb_cObject);
 #if RAPI_FULL > 187
@@ -140,6 +239,8 @@ void spriteBindingInit() {
     
     _rb_define_method(klass, "width", spriteWidth);
     _rb_define_method(klass, "height", spriteHeight);
+
+    _rb_define_method(klass, "set!", spriteSetBatch);
     
     INIT_PROP_BIND(Sprite, BushOpacity, "bush_opacity");
     
@@ -154,6 +154,63 @@ RB_METHOD_GUARD(tableSetAt) {
 }
 RB_METHOD_GUARD_END
 
+RB_METHOD(tableSnapshot) {
+  RB_UNUSED_PARAM;
+
+  Table *t = getPrivateData<Table>(self);
+
+  return wrapObject(t->snapshot(), TableType);
+}
+
+RB_METHOD_GUARD(tableFillRect) {
+  Table *t = getPrivateData<Table>(self);
+
+  int x, y, w, h, value;
+  int z = 0;
+
+  rb_get_args(argc, argv, "iiiii|i", &x, &y, &w, &h, &value,
+              &z RB_ARG_END);
+
+  t->fillRect(x, y, w, h, value, z);
+
+  return Qnil;
+}
+RB_METHOD_GUARD_END
+
+RB_METHOD_GUARD(tableCopyRegion) {
+  Table *t = getPrivateData<Table>(self);
+
+  VALUE srcObj;
+  int sx, sy, sw, sh, dx, dy;
+  int srcZ = 0, dstZ = 0;
+
+  rb_get_args(argc, argv, "oiiiiii|ii", &srcObj, &sx, &sy, &sw, &sh,
+              &dx, &dy, &srcZ, &dstZ RB_ARG_END);
+
+  Table *src = getPrivateDataCheck<Table>(srcObj, TableType);
+
+  if (src)
+    t->copyRegion(*src, sx, sy, sw, sh, dx, dy, srcZ, dstZ);
+
+  return Qnil;
+}
+RB_METHOD_GUARD_END
+
+RB_METHOD_GUARD(tableTransform) {
+  Table *t = getPrivateData<Table>(self);
+
+  int x, y, w, h, delta;
+  int min = -32768, max = 32767, z = 0;
+
+  rb_get_args(argc, argv, "iiiii|iii", &x, &y, &w, &h, &delta,
+              &min, &max, &z RB_ARG_END);
+
+  t->transform(x, y, w, h, delta, min, max, z);
+
+  return Qnil;
+}
+RB_METHOD_GUARD_END
+
 MARSH_LOAD_FUN(Table)
 INITCOPY_FUN(Table)
 
@@ -184,4 +241,8 @@ void tableBindingInit() {
   _rb_define_method(klass, "zsize", tableZSize);
   _rb_define_method(klass, "[]", tableGetAt);
   _rb_define_method(klass, "[]=", tableSetAt);
+  _rb_define_method(klass, "snapshot", tableSnapshot);
+  _rb_define_method(klass, "fill_rect", tableFillRect);
+  _rb_define_method(klass, "copy_region", tableCopyRegion);
+  _rb_define_method(klass, "transform", tableTransform);
 }
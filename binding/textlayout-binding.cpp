@@ -0,0 +1,206 @@
+/*
+** textlayout-binding.cpp
+**
+** This file is part of mkxp.
+**
+** Copyright (C) 2013 - 2021 Amaryllis Kulla <ancurio@mapleshrine.eu>
+**
+** mkxp is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 2 of the License, or
+** (at your option) any later version.
+**
+** mkxp is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with mkxp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "binding-types.h"
+#include "binding-util.h"
+#include "bitmap.h"
+#include "exception.h"
+
+#include <string>
+
+/* Retained incremental text layout for typewriter-style reveals
+ * (message windows): keeps a pen over a target bitmap (typically a
+ * window's contents) and draws only what each append adds, so
+ * revealing one more character costs that character - not a redraw
+ * of all visible text. Pen advances track text_size, the same
+ * metric scripts use, so mixing with manual draw_text stays
+ * consistent */
+struct TextLayout
+{
+    Bitmap *bitmap;
+    int penX, penY;
+    int originX;
+    int lineH;
+
+    TextLayout(Bitmap *b)
+        : bitmap(b), penX(0), penY(0), originX(0), lineH(0)
+    {}
+
+    void setPos(int x, int y)
+    {
+        penX = originX = x;
+        penY = y;
+        lineH = 0;
+    }
+
+    void newline()
+    {
+        int h = lineH;
+
+        if (h <= 0)
+            h = bitmap->textSize("W").h;
+
+        penX = originX;
+        penY += h;
+        lineH = 0;
+    }
+
+    void append(const char *str)
+    {
+        const std::string text(str);
+        size_t pos = 0;
+
+        while (pos <= text.size())
+        {
+            const size_t eol = text.find('\n', pos);
+            const size_t end = (eol == std::string::npos) ? text.size() : eol;
+
+            if (end > pos)
+            {
+                const std::string seg = text.substr(pos, end - pos);
+                const IntRect sz = bitmap->textSize(seg.c_str());
+
+                if (sz.h > lineH)
+                    lineH = sz.h;
+
+                if (sz.w > 0 && sz.h > 0)
+                    bitmap->drawText(IntRect(penX, penY, sz.w, sz.h),
+                                     seg.c_str(), Bitmap::Left);
+
+                penX += sz.w;
+            }
+
+            if (eol == std::string::npos)
+                break;
+
+            newline();
+            pos = eol + 1;
+        }
+    }
+};
+
+#if RAPI_FULL > 187
+DEF_TYPE(TextLayout);
+#else
+DEF_ALLOCFUNC(TextLayout);
+#endif
+
+RB_METHOD_GUARD(textLayoutInitialize)
+{
+    RB_UNUSED_PARAM;
+
+    VALUE bmpObj;
+    rb_get_args(argc, argv, "o", &bmpObj RB_ARG_END);
+
+    Bitmap *bmp = getPrivateDataCheck<Bitmap>(bmpObj, BitmapType);
+
+    TextLayout *layout = new TextLayout(bmp);
+    setPrivateData(self, layout);
+
+    /* Pin the target for the layout's lifetime */
+    rb_iv_set(self, "bitmap", bmpObj);
+
+    return self;
+}
+RB_METHOD_GUARD_END
+
+RB_METHOD_GUARD(textLayoutAppend)
+{
+    RB_UNUSED_PARAM;
+
+    TextLayout *layout = getPrivateData<TextLayout>(self);
+
+    VALUE strObj;
+    rb_get_args(argc, argv, "o", &strObj RB_ARG_END);
+    SafeStringValue(strObj);
+
+    GUARD_EXC( layout->append(RSTRING_PTR(strObj)); );
+
+    return self;
+}
+RB_METHOD_GUARD_END
+
+RB_METHOD_GUARD(textLayoutNewline)
+{
+    RB_UNUSED_PARAM;
+
+    TextLayout *layout = getPrivateData<TextLayout>(self);
+    GUARD_EXC( layout->newline(); );
+
+    return Qnil;
+}
+RB_METHOD_GUARD_END
+
+RB_METHOD(textLayoutSetPos)
+{
+    RB_UNUSED_PARAM;
+
+    TextLayout *layout = getPrivateData<TextLayout>(self);
+
+    int x, y;
+    rb_get_args(argc, argv, "ii", &x, &y RB_ARG_END);
+
+    layout->setPos(x, y);
+
+    return Qnil;
+}
+
+RB_METHOD(textLayoutX)
+{
+    RB_UNUSED_PARAM;
+
+    TextLayout *layout = getPrivateData<TextLayout>(self);
+    return rb_fix_new(layout->penX);
+}
+
+RB_METHOD(textLayoutY)
+{
+    RB_UNUSED_PARAM;
+
+    TextLayout *layout = getPrivateData<TextLayout>(self);
+    return rb_fix_new(layout->penY);
+}
+
+RB_METHOD(textLayoutBitmap)
+{
+    RB_UNUSED_PARAM;
+
+    return rb_iv_get(self, "bitmap");
+}
+
+void textLayoutBindingInit()
+{
+    VALUE klass = rb_define_class("TextLayout", rb_cObject);
+#if RAPI_FULL > 187
+    rb_define_alloc_func(klass, classAllocate<&TextLayoutType>);
+#else
+    rb_define_alloc_func(klass, TextLayoutAllocate);
+#endif
+
+    _rb_define_method(klass, "initialize", textLayoutInitialize);
+    _rb_define_method(klass, "append", textLayoutAppend);
+    _rb_define_method(klass, "<<", textLayoutAppend);
+    _rb_define_method(klass, "newline", textLayoutNewline);
+    _rb_define_method(klass, "set_pos", textLayoutSetPos);
+    _rb_define_method(klass, "x", textLayoutX);
+    _rb_define_method(klass, "y", textLayoutY);
+    _rb_define_method(klass, "bitmap", textLayoutBitmap);
+}
@@ -0,0 +1,206 @@
+/*
+** video-binding.cpp
+**
+** This file is part of mkxp.
+**
+** Copyright (C) 2013 - 2021 Amaryllis Kulla <ancurio@mapleshrine.eu>
+**
+** mkxp is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 2 of the License, or
+** (at your option) any later version.
+**
+** mkxp is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with mkxp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "binding-types.h"
+#include "binding-util.h"
+#include "bitmap.h"
+#include "disposable-binding.h"
+#include "sharedstate.h"
+#include "video.h"
+
+#if RAPI_FULL > 187
+DEF_TYPE(Video);
+#else
+DEF_ALLOCFUNC(Video);
+#endif
+
+void bitmapInitProps(Bitmap *b, VALUE self);
+
+RB_METHOD_GUARD(videoInitialize)
+{
+    RB_UNUSED_PARAM;
+
+    VALUE filename, loopingArg;
+    rb_scan_args(argc, argv, "11", &filename, &loopingArg);
+    SafeStringValue(filename);
+
+    bool looping = true;
+    if (loopingArg != Qnil)
+        rb_bool_arg(loopingArg, &looping);
+
+    Video *v = 0;
+    GFX_GUARD_EXC( v = new Video(RSTRING_PTR(filename), looping); );
+
+    setPrivateData(self, v);
+
+    /* The upload target is an ordinary Ruby-owned Bitmap, pinned by
+     * an ivar so it outlives every use through this object. Scripts
+     * hand it to any Sprite or Plane like a loaded image */
+    Bitmap *b = 0;
+    GFX_GUARD_EXC( b = new Bitmap(v->getWidth(), v->getHeight(), true); );
+
+    VALUE bmp = wrapObject(b, BitmapType);
+    bitmapInitProps(b, bmp);
+    rb_iv_set(self, "bitmap", bmp);
+
+    GFX_LOCK;
+    v->setBitmap(b);
+    GFX_UNLOCK;
+
+    return self;
+}
+RB_METHOD_GUARD_END
+
+RB_METHOD_GUARD(videoUpdate)
+{
+    RB_UNUSED_PARAM;
+
+    Video *v = getPrivateData<Video>(self);
+    GUARD_EXC( v->update(); );
+
+    return Qnil;
+}
+RB_METHOD_GUARD_END
+
+RB_METHOD(videoBitmap)
+{
+    RB_UNUSED_PARAM;
+
+    return rb_iv_get(self, "bitmap");
+}
+
+RB_METHOD(videoWidth)
+{
+    RB_UNUSED_PARAM;
+
+    Video *v = getPrivateData<Video>(self);
+    return rb_fix_new(v->getWidth());
+}
+
+RB_METHOD(videoHeight)
+{
+    RB_UNUSED_PARAM;
+
+    Video *v = getPrivateData<Video>(self);
+    return rb_fix_new(v->getHeight());
+}
+
+RB_METHOD(videoGetLooping)
+{
+    RB_UNUSED_PARAM;
+
+    Video *v = getPrivateData<Video>(self);
+    return rb_bool_new(v->getLooping());
+}
+
+RB_METHOD_GUARD(videoSetLooping)
+{
+    RB_UNUSED_PARAM;
+
+    Video *v = getPrivateData<Video>(self);
+
+    bool looping;
+    rb_get_args(argc, argv, "b", &looping RB_ARG_END);
+    GUARD_EXC( v->setLooping(looping); );
+
+    return rb_bool_new(looping);
+}
+RB_METHOD_GUARD_END
+
+RB_METHOD(videoGetPaused)
+{
+    RB_UNUSED_PARAM;
+
+    Video *v = getPrivateData<Video>(self);
+    return rb_bool_new(v->getPaused());
+}
+
+RB_METHOD_GUARD(videoSetPaused)
+{
+    RB_UNUSED_PARAM;
+
+    Video *v = getPrivateData<Video>(self);
+
+    bool paused;
+    rb_get_args(argc, argv, "b", &paused RB_ARG_END);
+    GUARD_EXC( v->setPaused(paused); );
+
+    return rb_bool_new(paused);
+}
+RB_METHOD_GUARD_END
+
+RB_METHOD(videoPosition)
+{
+    RB_UNUSED_PARAM;
+
+    Video *v = getPrivateData<Video>(self);
+    return rb_float_new(v->getPosition() / 1000.0);
+}
+
+RB_METHOD_GUARD(videoSeek)
+{
+    RB_UNUSED_PARAM;
+
+    Video *v = getPrivateData<Video>(self);
+
+    double seconds;
+    rb_get_args(argc, argv, "f", &seconds RB_ARG_END);
+    if (seconds < 0)
+        seconds = 0;
+
+    GUARD_EXC( v->seek((unsigned int) (seconds * 1000.0)); );
+
+    return Qnil;
+}
+RB_METHOD_GUARD_END
+
+RB_METHOD(videoAtEnd)
+{
+    RB_UNUSED_PARAM;
+
+    Video *v = getPrivateData<Video>(self);
+    return rb_bool_new(v->atEnd());
+}
+
+void videoBindingInit()
+{
+    VALUE klass = rb_define_class("Video", rb_cObject);
+#if RAPI_FULL > 187
+    rb_define_alloc_func(klass, classAllocate<&VideoType>);
+#else
+    rb_define_alloc_func(klass, VideoAllocate);
+#endif
+
+    disposableBindingInit<Video>(klass);
+
+    _rb_define_method(klass, "initialize", videoInitialize);
+    _rb_define_method(klass, "update", videoUpdate);
+    _rb_define_method(klass, "bitmap", videoBitmap);
+    _rb_define_method(klass, "width", videoWidth);
+    _rb_define_method(klass, "height", videoHeight);
+    _rb_define_method(klass, "looping", videoGetLooping);
+    _rb_define_method(klass, "looping=", videoSetLooping);
+    _rb_define_method(klass, "paused", videoGetPaused);
+    _rb_define_method(klass, "paused=", videoSetPaused);
+    _rb_define_method(klass, "position", videoPosition);
+    _rb_define_method(klass, "seek", videoSeek);
+    _rb_define_method(klass, "at_end?", videoAtEnd);
+}
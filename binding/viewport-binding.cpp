@@ -79,6 +79,19 @@ DEF_GFX_PROP_OBJ_VAL(Viewport, Tone, Tone, "tone")
 DEF_GFX_PROP_I(Viewport, OX)
 DEF_GFX_PROP_I(Viewport, OY)
 
+DEF_GFX_PROP_B(Viewport, CacheStatic)
+
+RB_METHOD_GUARD(viewportRefreshCache) {
+    RB_UNUSED_PARAM;
+
+    Viewport *v = getPrivateData<Viewport>(self);
+
+    GFX_GUARD_EXC(v->refreshCache(););
+
+    return Qnil;
+}
+RB_METHOD_GUARD_END
+
 void viewportBindingInit() {
     VALUE klass = rb_define_class("Viewport", rb_cObject);
 #if RAPI_FULL > 187
@@ -98,4 +111,6 @@ void viewportBindingInit() {
     INIT_PROP_BIND(Viewport, OY, "oy");
     INIT_PROP_BIND(Viewport, Color, "color");
     INIT_PROP_BIND(Viewport, Tone, "tone");
+    INIT_PROP_BIND(Viewport, CacheStatic, "cache_static");
+    _rb_define_method(klass, "refresh_cache", viewportRefreshCache);
 }
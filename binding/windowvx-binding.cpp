@@ -133,6 +133,88 @@ DEF_GFX_PROP_B(WindowVX, Active)
 DEF_GFX_PROP_B(WindowVX, ArrowsVisible)
 DEF_GFX_PROP_B(WindowVX, Pause)
 
+/* Batch property setter; see spriteSetBatch for rationale */
+RB_METHOD_GUARD(windowVXSetBatch) {
+  WindowVX *w = getPrivateData<WindowVX>(self);
+
+  if (argc != 1 || !RB_TYPE_P(argv[0], T_HASH))
+    throw Exception(Exception::ArgumentError,
+                    "expected an attribute hash");
+
+  VALUE hash = argv[0];
+
+  enum {
+    vX, vY, vZ, vWidth, vHeight, vOX, vOY, vPadding,
+    vPaddingBottom, vOpacity, vBackOpacity, vContentsOpacity,
+    vOpenness, vActive, vArrowsVisible, vPause, vVisible, vCount
+  };
+
+  static const char *names[vCount] = {
+    "x", "y", "z", "width", "height", "ox", "oy", "padding",
+    "padding_bottom", "opacity", "back_opacity",
+    "contents_opacity", "openness", "active", "arrows_visible",
+    "pause", "visible"
+  };
+
+  static ID ids[vCount];
+  static bool idsInterned = false;
+
+  if (!idsInterned) {
+    for (int i = 0; i < vCount; ++i)
+      ids[i] = rb_intern(names[i]);
+    idsInterned = true;
+  }
+
+  bool has[vCount] = { false };
+  int iv[vCount] = { 0 };
+  bool bv[vCount] = { false };
+  long found = 0;
+
+  for (int i = 0; i < vCount; ++i) {
+    VALUE val = rb_hash_lookup2(hash, ID2SYM(ids[i]), Qundef);
+
+    if (val == Qundef)
+      continue;
+
+    has[i] = true;
+    ++found;
+
+    if (i == vActive || i == vArrowsVisible || i == vPause
+    ||  i == vVisible)
+      bv[i] = RTEST(val);
+    else
+      iv[i] = NUM2INT(val);
+  }
+
+  if (found != (long) RHASH_SIZE(hash))
+    throw Exception(Exception::ArgumentError,
+                    "unknown window attribute in hash");
+
+  GFX_GUARD_EXC(
+    if (has[vX]) w->setX(iv[vX]);
+    if (has[vY]) w->setY(iv[vY]);
+    if (has[vZ]) w->setZ(iv[vZ]);
+    if (has[vWidth]) w->setWidth(iv[vWidth]);
+    if (has[vHeight]) w->setHeight(iv[vHeight]);
+    if (has[vOX]) w->setOX(iv[vOX]);
+    if (has[vOY]) w->setOY(iv[vOY]);
+    if (has[vPadding]) w->setPadding(iv[vPadding]);
+    if (has[vPaddingBottom]) w->setPaddingBottom(iv[vPaddingBottom]);
+    if (has[vOpacity]) w->setOpacity(iv[vOpacity]);
+    if (has[vBackOpacity]) w->setBackOpacity(iv[vBackOpacity]);
+    if (has[vContentsOpacity])
+      w->setContentsOpacity(iv[vContentsOpacity]);
+    if (has[vOpenness]) w->setOpenness(iv[vOpenness]);
+    if (has[vActive]) w->setActive(bv[vActive]);
+    if (has[vArrowsVisible]) w->setArrowsVisible(bv[vArrowsVisible]);
+    if (has[vPause]) w->setPause(bv[vPause]);
+    if (has[vVisible]) w->setVisible(bv[vVisible]);
+  );
+
+  return self;
+}
+RB_METHOD_GUARD_END
+
 void windowVXBindingInit() {
   VALUE klass = rb_define_class("Window", rb_cObject);
 #if RAPI_FULL > 187
@@ -146,6 +228,7 @@ void windowVXBindingInit() {
 
   _rb_define_method(klass, "initialize", windowVXInitialize);
   _rb_define_method(klass, "update", windowVXUpdate);
+  _rb_define_method(klass, "set!", windowVXSetBatch);
 
   INIT_PROP_BIND(WindowVX, Windowskin, "windowskin");
   INIT_PROP_BIND(WindowVX, Contents, "contents");
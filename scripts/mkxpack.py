@@ -0,0 +1,119 @@
+#!/usr/bin/env python3
+"""Builds MKXPACK archives for mkxp-z (see src/crypto/mkxpack.cpp
+for the format description).
+
+Usage:
+    mkxpack.py <game-dir> <output.mkxpack> [--level N] [--store]
+
+Every regular file below <game-dir> is packed with its relative,
+'/' separated path. Entries are zstd compressed (unless --store
+is given or compression doesn't pay off) and their data is
+aligned to 4096 bytes for direct I/O.
+
+Requires the 'zstandard' module for compression; without it,
+all entries are stored verbatim.
+"""
+
+import os
+import struct
+import sys
+
+try:
+    import zstandard
+except ImportError:
+    zstandard = None
+
+MAGIC = b"MKXPACK1"
+HEADER_SIZE = 32
+RECORD_SIZE = 40
+ALIGN = 4096
+
+FLAG_ZSTD = 1
+
+
+def fnv1a(data):
+    h = 0xcbf29ce484222325
+    for b in data:
+        h ^= b
+        h = (h * 0x100000001b3) & 0xFFFFFFFFFFFFFFFF
+    return h
+
+
+def collect(root):
+    files = []
+    for dirpath, _, names in os.walk(root):
+        for name in names:
+            full = os.path.join(dirpath, name)
+            rel = os.path.relpath(full, root).replace(os.sep, "/")
+            files.append((rel, full))
+    files.sort()
+    return files
+
+
+def main():
+    args = [a for a in sys.argv[1:] if not a.startswith("--")]
+    if len(args) != 2:
+        sys.exit(__doc__)
+
+    root, out = args
+    level = 19
+    store = "--store" in sys.argv or zstandard is None
+
+    for i, a in enumerate(sys.argv):
+        if a == "--level":
+            level = int(sys.argv[i + 1])
+
+    cctx = None if store else zstandard.ZstdCompressor(level=level)
+
+    entries = []
+    names = bytearray()
+
+    with open(out, "wb") as f:
+        f.write(b"\0" * HEADER_SIZE)
+
+        for rel, full in collect(root):
+            with open(full, "rb") as src:
+                raw = src.read()
+
+            flags = 0
+            stored = raw
+
+            if cctx is not None and len(raw) > 64:
+                packed = cctx.compress(raw)
+                # Store incompressible data verbatim
+                if len(packed) < len(raw) * 0.95:
+                    stored = packed
+                    flags = FLAG_ZSTD
+
+            pos = f.tell()
+            pad = (-pos) % ALIGN
+            f.write(b"\0" * pad)
+            data_offset = pos + pad
+            f.write(stored)
+
+            name = rel.encode("utf-8")
+            name_offset = len(names)
+            names += name + b"\0"
+
+            entries.append((fnv1a(name), data_offset, len(raw),
+                            len(stored), name_offset, len(name), flags))
+
+        # Index: records sorted by hash, then the string table
+        entries.sort(key=lambda e: e[0])
+
+        index_offset = f.tell()
+        for e in entries:
+            f.write(struct.pack("<QQQQIHH", *e))
+        f.write(names)
+        index_size = f.tell() - index_offset
+
+        f.seek(0)
+        f.write(MAGIC)
+        f.write(struct.pack("<QQII", index_offset, index_size,
+                            len(entries), 0))
+
+    print("%s: %d entries, index %d bytes" % (out, len(entries), index_size))
+
+
+if __name__ == "__main__":
+    main()
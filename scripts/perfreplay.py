@@ -0,0 +1,160 @@
+#!/usr/bin/env python3
+# Replay-driven performance regression harness for mkxp-z.
+# License GPLv2+.
+#
+# Replays a captured input file against a real game folder in
+# headless mode and reports frame-time percentiles, so engine
+# upgrades can be gated on "no p99 regression".
+#
+# Invoke through meson (environment carries the parameters):
+#   MKXPZ_GAME_DIR=/path/to/game \
+#   MKXPZ_REPLAY=/path/to/capture.bin \
+#   meson compile -C build perf-replay
+#
+# Optional:
+#   MKXPZ_BINARY        engine binary (default: <build>/mkxp-z)
+#   MKXPZ_DURATION      seconds to run (default 60)
+#   MKXPZ_WARMUP        frames to discard (default 60)
+#   MKXPZ_BASELINE      baseline JSON from an earlier run
+#   MKXPZ_P99_TOLERANCE allowed p99 regression in percent (default 10)
+#   MKXPZ_OUT           where to write the result JSON
+#
+# The game's mkxp.json is temporarily replaced (and restored) with
+# one that enables headless mode, input replay and the frame-time
+# log the engine writes for us.
+
+import json
+import os
+import shutil
+import signal
+import subprocess
+import sys
+import tempfile
+import time
+
+
+def fail(msg):
+    print("perf-replay: " + msg, file=sys.stderr)
+    sys.exit(2)
+
+
+def percentile(sorted_vals, p):
+    if not sorted_vals:
+        return 0.0
+    idx = min(len(sorted_vals) - 1, int(round((p / 100.0) * (len(sorted_vals) - 1))))
+    return sorted_vals[idx]
+
+
+def main():
+    game_dir = os.environ.get("MKXPZ_GAME_DIR")
+    replay = os.environ.get("MKXPZ_REPLAY")
+
+    if not game_dir or not os.path.isdir(game_dir):
+        fail("MKXPZ_GAME_DIR must point at a game folder")
+    if not replay or not os.path.isfile(replay):
+        fail("MKXPZ_REPLAY must point at a captured input file")
+
+    build_root = os.environ.get("MESON_BUILD_ROOT", ".")
+    binary = os.environ.get("MKXPZ_BINARY",
+                            os.path.join(build_root, "mkxp-z"))
+    if not os.path.isfile(binary):
+        fail("engine binary not found at %s (set MKXPZ_BINARY)" % binary)
+
+    duration = float(os.environ.get("MKXPZ_DURATION", "60"))
+    warmup = int(os.environ.get("MKXPZ_WARMUP", "60"))
+
+    frame_log = tempfile.NamedTemporaryFile(
+        prefix="mkxpz-frames-", suffix=".log", delete=False).name
+
+    conf_path = os.path.join(game_dir, "mkxp.json")
+    backup = None
+    conf = {}
+
+    if os.path.exists(conf_path):
+        backup = conf_path + ".perfreplay-backup"
+        shutil.copy2(conf_path, backup)
+        try:
+            with open(conf_path, "r", encoding="utf-8") as f:
+                conf = json.load(f)
+        except Exception:
+            conf = {}
+
+    conf["headless"] = True
+    conf["replayInput"] = os.path.abspath(replay)
+    conf["frameTimeLog"] = frame_log
+
+    try:
+        with open(conf_path, "w", encoding="utf-8") as f:
+            json.dump(conf, f, indent=2)
+
+        # A stale binary config snapshot would mask our edits
+        snap = conf_path + ".bincache"
+        if os.path.exists(snap):
+            os.remove(snap)
+
+        proc = subprocess.Popen([binary], cwd=game_dir,
+                                stdout=subprocess.DEVNULL,
+                                stderr=subprocess.DEVNULL)
+        try:
+            proc.wait(timeout=duration)
+        except subprocess.TimeoutExpired:
+            proc.send_signal(signal.SIGTERM)
+            try:
+                proc.wait(timeout=10)
+            except subprocess.TimeoutExpired:
+                proc.kill()
+                proc.wait()
+    finally:
+        if backup:
+            shutil.move(backup, conf_path)
+        elif os.path.exists(conf_path):
+            os.remove(conf_path)
+
+    try:
+        with open(frame_log) as f:
+            frames = [float(line) for line in f if line.strip()]
+    except FileNotFoundError:
+        fail("engine produced no frame log (did it start?)")
+    finally:
+        if os.path.exists(frame_log):
+            os.remove(frame_log)
+
+    frames = frames[warmup:]
+    if len(frames) < 100:
+        fail("only %d frames captured; run longer" % len(frames))
+
+    frames.sort()
+    result = {
+        "frames": len(frames),
+        "p50_ms": round(percentile(frames, 50), 3),
+        "p90_ms": round(percentile(frames, 90), 3),
+        "p99_ms": round(percentile(frames, 99), 3),
+        "max_ms": round(frames[-1], 3),
+    }
+
+    out = os.environ.get("MKXPZ_OUT")
+    text = json.dumps(result, indent=2)
+    print(text)
+    if out:
+        with open(out, "w") as f:
+            f.write(text + "\n")
+
+    baseline_path = os.environ.get("MKXPZ_BASELINE")
+    if baseline_path:
+        with open(baseline_path) as f:
+            base = json.load(f)
+        tolerance = float(os.environ.get("MKXPZ_P99_TOLERANCE", "10"))
+        limit = base["p99_ms"] * (1.0 + tolerance / 100.0)
+        if result["p99_ms"] > limit:
+            print("perf-replay: p99 regression: %.3fms > %.3fms "
+                  "(baseline %.3fms + %g%%)" %
+                  (result["p99_ms"], limit, base["p99_ms"], tolerance),
+                  file=sys.stderr)
+            sys.exit(1)
+        print("perf-replay: p99 within tolerance of baseline")
+
+    sys.exit(0)
+
+
+if __name__ == "__main__":
+    main()
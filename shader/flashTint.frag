@@ -0,0 +1,15 @@
+uniform sampler2D texture;
+
+varying vec2 v_texCoord;
+varying lowp vec4 v_color;
+
+/* Batched flash: the flash color rides in on the vertex color
+ * and is mixed exactly like sprite.frag's flash step */
+void main()
+{
+	vec4 frag = texture2D(texture, v_texCoord);
+
+	frag.rgb = mix(frag.rgb, v_color.rgb, v_color.a);
+
+	gl_FragColor = frag;
+}
@@ -0,0 +1,11 @@
+uniform sampler2D texture;
+
+varying vec2 v_texCoord;
+varying lowp vec4 v_color;
+
+/* Atlas glyphs store pure coverage in their alpha channel;
+ * the text color rides in on the vertex color */
+void main()
+{
+	gl_FragColor = vec4(v_color.rgb, texture2D(texture, v_texCoord).a * v_color.a);
+}
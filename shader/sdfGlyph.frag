@@ -0,0 +1,18 @@
+uniform sampler2D texture;
+
+/* Half-width of the edge band in normalized distance units, chosen
+ * per draw from the on-screen glyph scale so the edge stays about a
+ * pixel wide at every size */
+uniform float smoothing;
+
+varying vec2 v_texCoord;
+varying lowp vec4 v_color;
+
+/* Atlas texels hold a signed distance mapped around 0.5 (inside
+ * above); the text color rides in on the vertex color */
+void main()
+{
+	float dist = texture2D(texture, v_texCoord).r;
+	float alpha = smoothstep(0.5 - smoothing, 0.5 + smoothing, dist);
+	gl_FragColor = vec4(v_color.rgb, alpha * v_color.a);
+}
@@ -4,6 +4,10 @@ uniform mat4 projMat;
 uniform vec2 texSizeInv;
 uniform vec2 translation;
 
+/* Texel-space sampling offset; zero for everything except
+ * scrolling planes (uniforms are zero-initialized at link) */
+uniform vec2 texOffset;
+
 attribute vec2 position;
 attribute vec2 texCoord;
 
@@ -13,5 +17,5 @@ void main()
 {
 	gl_Position = projMat * vec4(position + translation, 0, 1);
 
-	v_texCoord = texCoord * texSizeInv;
+	v_texCoord = (texCoord + texOffset) * texSizeInv;
 }
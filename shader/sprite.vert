@@ -10,6 +10,11 @@ uniform vec2 patternZoom;
 uniform bool renderPattern;
 uniform bool patternTile;
 
+uniform bool waveActive;
+uniform float waveAmp;
+uniform float wavePhase;
+uniform float waveFreq;
+
 attribute vec2 position;
 attribute vec2 texCoord;
 
@@ -18,7 +23,15 @@ varying vec2 v_patCoord;
 
 void main()
 {
-	gl_Position = projMat * spriteMat * vec4(position, 0, 1);
+	vec2 pos = position;
+
+	/* Wave displacement: computed here from the strip's texel
+	 * row, so phase changes cost one uniform instead of a CPU
+	 * re-chop and buffer re-upload */
+	if (waveActive)
+		pos.x += sin(wavePhase + texCoord.y * waveFreq) * waveAmp;
+
+	gl_Position = projMat * spriteMat * vec4(pos, 0, 1);
     
     v_texCoord = texCoord * texSizeInv;
     
@@ -0,0 +1,20 @@
+uniform sampler2D yPlane;
+uniform sampler2D uPlane;
+uniform sampler2D vPlane;
+
+varying vec2 v_texCoord;
+
+/* BT.601 limited range YCbCr -> RGB */
+void main()
+{
+	float y = texture2D(yPlane, v_texCoord).r;
+	float u = texture2D(uPlane, v_texCoord).r - 0.5;
+	float v = texture2D(vPlane, v_texCoord).r - 0.5;
+
+	y = 1.1643 * (y - 0.0625);
+
+	gl_FragColor = vec4(y + 1.5958 * v,
+	                    y - 0.39173 * u - 0.81290 * v,
+	                    y + 2.017 * u,
+	                    1.0);
+}
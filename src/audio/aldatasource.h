@@ -61,6 +61,12 @@ ALDataSource *createSDLSource(SDL_RWops &ops,
 ALDataSource *createVorbisSource(SDL_RWops &ops,
                                  bool looped);
 
+ALDataSource *createOpusSource(SDL_RWops &ops,
+                               bool looped);
+
+ALDataSource *createFlacSource(SDL_RWops &ops,
+                               bool looped);
+
 ALDataSource *createMidiSource(SDL_RWops &ops,
                                bool looped);
 
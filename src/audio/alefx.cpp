@@ -0,0 +1,272 @@
+/*
+** alefx.cpp
+**
+** This file is part of mkxp.
+**
+** Copyright (C) 2014 - 2021 Amaryllis Kulla <ancurio@mapleshrine.eu>
+**
+** mkxp is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 2 of the License, or
+** (at your option) any later version.
+**
+** mkxp is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with mkxp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "alefx.h"
+
+#include "debugwriter.h"
+#include "util.h"
+
+#include <efx.h>
+#include <efx-presets.h>
+
+#include <SDL_stdinc.h>
+
+namespace EFX
+{
+
+static struct
+{
+	bool avail;
+
+	/* Backend supports the richer EAX reverb effect */
+	bool eax;
+
+	ALuint slot;
+	ALuint effect;
+
+	/* Scratch filter object: filter params are copied out
+	 * at routing time, so one object serves all sources */
+	ALuint filter;
+
+	LPALGENEFFECTS GenEffects;
+	LPALDELETEEFFECTS DeleteEffects;
+	LPALEFFECTI Effecti;
+	LPALEFFECTF Effectf;
+	LPALEFFECTFV Effectfv;
+	LPALGENFILTERS GenFilters;
+	LPALDELETEFILTERS DeleteFilters;
+	LPALFILTERI Filteri;
+	LPALFILTERF Filterf;
+	LPALGENAUXILIARYEFFECTSLOTS GenAuxiliaryEffectSlots;
+	LPALDELETEAUXILIARYEFFECTSLOTS DeleteAuxiliaryEffectSlots;
+	LPALAUXILIARYEFFECTSLOTI AuxiliaryEffectSloti;
+} efx = { false, false, 0, 0, 0 };
+
+struct ReverbPreset
+{
+	const char *name;
+	EFXEAXREVERBPROPERTIES props;
+};
+
+static const ReverbPreset reverbPresets[] =
+{
+	{ "generic",       EFX_REVERB_PRESET_GENERIC       },
+	{ "paddedcell",    EFX_REVERB_PRESET_PADDEDCELL    },
+	{ "room",          EFX_REVERB_PRESET_ROOM          },
+	{ "bathroom",      EFX_REVERB_PRESET_BATHROOM      },
+	{ "livingroom",    EFX_REVERB_PRESET_LIVINGROOM    },
+	{ "stoneroom",     EFX_REVERB_PRESET_STONEROOM     },
+	{ "auditorium",    EFX_REVERB_PRESET_AUDITORIUM    },
+	{ "concerthall",   EFX_REVERB_PRESET_CONCERTHALL   },
+	{ "cave",          EFX_REVERB_PRESET_CAVE          },
+	{ "arena",         EFX_REVERB_PRESET_ARENA         },
+	{ "hangar",        EFX_REVERB_PRESET_HANGAR        },
+	{ "hallway",       EFX_REVERB_PRESET_HALLWAY       },
+	{ "stonecorridor", EFX_REVERB_PRESET_STONECORRIDOR },
+	{ "alley",         EFX_REVERB_PRESET_ALLEY         },
+	{ "forest",        EFX_REVERB_PRESET_FOREST        },
+	{ "mountains",     EFX_REVERB_PRESET_MOUNTAINS     },
+	{ "quarry",        EFX_REVERB_PRESET_QUARRY        },
+	{ "plain",         EFX_REVERB_PRESET_PLAIN         },
+	{ "parkinglot",    EFX_REVERB_PRESET_PARKINGLOT    },
+	{ "sewerpipe",     EFX_REVERB_PRESET_SEWERPIPE     },
+	{ "underwater",    EFX_REVERB_PRESET_UNDERWATER    }
+};
+
+void init(ALCdevice *dev)
+{
+	if (!alcIsExtensionPresent(dev, "ALC_EXT_EFX"))
+	{
+		Debug() << "ALC_EXT_EFX not present";
+		return;
+	}
+
+#define EFX_FUN(name, type) \
+	efx.name = (type) alGetProcAddress("al" #name); \
+	if (!efx.name) \
+		return;
+
+	EFX_FUN(GenEffects, LPALGENEFFECTS)
+	EFX_FUN(DeleteEffects, LPALDELETEEFFECTS)
+	EFX_FUN(Effecti, LPALEFFECTI)
+	EFX_FUN(Effectf, LPALEFFECTF)
+	EFX_FUN(Effectfv, LPALEFFECTFV)
+	EFX_FUN(GenFilters, LPALGENFILTERS)
+	EFX_FUN(DeleteFilters, LPALDELETEFILTERS)
+	EFX_FUN(Filteri, LPALFILTERI)
+	EFX_FUN(Filterf, LPALFILTERF)
+	EFX_FUN(GenAuxiliaryEffectSlots, LPALGENAUXILIARYEFFECTSLOTS)
+	EFX_FUN(DeleteAuxiliaryEffectSlots, LPALDELETEAUXILIARYEFFECTSLOTS)
+	EFX_FUN(AuxiliaryEffectSloti, LPALAUXILIARYEFFECTSLOTI)
+
+#undef EFX_FUN
+
+	alGetError();
+
+	efx.GenAuxiliaryEffectSlots(1, &efx.slot);
+	efx.GenEffects(1, &efx.effect);
+	efx.GenFilters(1, &efx.filter);
+
+	if (alGetError() != AL_NO_ERROR)
+		return;
+
+	efx.Effecti(efx.effect, AL_EFFECT_TYPE, AL_EFFECT_EAXREVERB);
+	efx.eax = (alGetError() == AL_NO_ERROR);
+
+	efx.avail = true;
+
+	Debug() << "ALC_EXT_EFX present";
+}
+
+bool available()
+{
+	return efx.avail;
+}
+
+static void loadEaxReverb(const EFXEAXREVERBPROPERTIES &r)
+{
+	efx.Effecti(efx.effect, AL_EFFECT_TYPE, AL_EFFECT_EAXREVERB);
+	efx.Effectf(efx.effect, AL_EAXREVERB_DENSITY, r.flDensity);
+	efx.Effectf(efx.effect, AL_EAXREVERB_DIFFUSION, r.flDiffusion);
+	efx.Effectf(efx.effect, AL_EAXREVERB_GAIN, r.flGain);
+	efx.Effectf(efx.effect, AL_EAXREVERB_GAINHF, r.flGainHF);
+	efx.Effectf(efx.effect, AL_EAXREVERB_GAINLF, r.flGainLF);
+	efx.Effectf(efx.effect, AL_EAXREVERB_DECAY_TIME, r.flDecayTime);
+	efx.Effectf(efx.effect, AL_EAXREVERB_DECAY_HFRATIO, r.flDecayHFRatio);
+	efx.Effectf(efx.effect, AL_EAXREVERB_DECAY_LFRATIO, r.flDecayLFRatio);
+	efx.Effectf(efx.effect, AL_EAXREVERB_REFLECTIONS_GAIN, r.flReflectionsGain);
+	efx.Effectf(efx.effect, AL_EAXREVERB_REFLECTIONS_DELAY, r.flReflectionsDelay);
+	efx.Effectfv(efx.effect, AL_EAXREVERB_REFLECTIONS_PAN, r.flReflectionsPan);
+	efx.Effectf(efx.effect, AL_EAXREVERB_LATE_REVERB_GAIN, r.flLateReverbGain);
+	efx.Effectf(efx.effect, AL_EAXREVERB_LATE_REVERB_DELAY, r.flLateReverbDelay);
+	efx.Effectfv(efx.effect, AL_EAXREVERB_LATE_REVERB_PAN, r.flLateReverbPan);
+	efx.Effectf(efx.effect, AL_EAXREVERB_ECHO_TIME, r.flEchoTime);
+	efx.Effectf(efx.effect, AL_EAXREVERB_ECHO_DEPTH, r.flEchoDepth);
+	efx.Effectf(efx.effect, AL_EAXREVERB_MODULATION_TIME, r.flModulationTime);
+	efx.Effectf(efx.effect, AL_EAXREVERB_MODULATION_DEPTH, r.flModulationDepth);
+	efx.Effectf(efx.effect, AL_EAXREVERB_AIR_ABSORPTION_GAINHF, r.flAirAbsorptionGainHF);
+	efx.Effectf(efx.effect, AL_EAXREVERB_HFREFERENCE, r.flHFReference);
+	efx.Effectf(efx.effect, AL_EAXREVERB_LFREFERENCE, r.flLFReference);
+	efx.Effectf(efx.effect, AL_EAXREVERB_ROOM_ROLLOFF_FACTOR, r.flRoomRolloffFactor);
+	efx.Effecti(efx.effect, AL_EAXREVERB_DECAY_HFLIMIT, r.iDecayHFLimit);
+}
+
+/* Fallback for backends without EAX reverb; drops the
+ * echo/modulation/pan extras the standard effect lacks */
+static void loadReverb(const EFXEAXREVERBPROPERTIES &r)
+{
+	efx.Effecti(efx.effect, AL_EFFECT_TYPE, AL_EFFECT_REVERB);
+	efx.Effectf(efx.effect, AL_REVERB_DENSITY, r.flDensity);
+	efx.Effectf(efx.effect, AL_REVERB_DIFFUSION, r.flDiffusion);
+	efx.Effectf(efx.effect, AL_REVERB_GAIN, r.flGain);
+	efx.Effectf(efx.effect, AL_REVERB_GAINHF, r.flGainHF);
+	efx.Effectf(efx.effect, AL_REVERB_DECAY_TIME, r.flDecayTime);
+	efx.Effectf(efx.effect, AL_REVERB_DECAY_HFRATIO, r.flDecayHFRatio);
+	efx.Effectf(efx.effect, AL_REVERB_REFLECTIONS_GAIN, r.flReflectionsGain);
+	efx.Effectf(efx.effect, AL_REVERB_REFLECTIONS_DELAY, r.flReflectionsDelay);
+	efx.Effectf(efx.effect, AL_REVERB_LATE_REVERB_GAIN, r.flLateReverbGain);
+	efx.Effectf(efx.effect, AL_REVERB_LATE_REVERB_DELAY, r.flLateReverbDelay);
+	efx.Effectf(efx.effect, AL_REVERB_AIR_ABSORPTION_GAINHF, r.flAirAbsorptionGainHF);
+	efx.Effectf(efx.effect, AL_REVERB_ROOM_ROLLOFF_FACTOR, r.flRoomRolloffFactor);
+	efx.Effecti(efx.effect, AL_REVERB_DECAY_HFLIMIT, r.iDecayHFLimit);
+}
+
+bool setReverbPreset(const char *name)
+{
+	if (!efx.avail)
+		return false;
+
+	if (!name || !*name)
+	{
+		efx.AuxiliaryEffectSloti(efx.slot, AL_EFFECTSLOT_EFFECT, AL_EFFECT_NULL);
+		return true;
+	}
+
+	const ReverbPreset *preset = 0;
+
+	for (size_t i = 0; i < ARRAY_SIZE(reverbPresets); ++i)
+	{
+		if (SDL_strcasecmp(reverbPresets[i].name, name))
+			continue;
+
+		preset = &reverbPresets[i];
+		break;
+	}
+
+	if (!preset)
+		return false;
+
+	if (efx.eax)
+		loadEaxReverb(preset->props);
+	else
+		loadReverb(preset->props);
+
+	efx.AuxiliaryEffectSloti(efx.slot, AL_EFFECTSLOT_EFFECT, efx.effect);
+
+	return true;
+}
+
+void setSourceSend(AL::Source::ID src, float gain)
+{
+	if (!efx.avail)
+		return;
+
+	if (gain <= 0.0f)
+	{
+		alSource3i(src.al, AL_AUXILIARY_SEND_FILTER,
+		           AL_EFFECTSLOT_NULL, 0, AL_FILTER_NULL);
+		return;
+	}
+
+	if (gain >= 1.0f)
+	{
+		alSource3i(src.al, AL_AUXILIARY_SEND_FILTER,
+		           efx.slot, 0, AL_FILTER_NULL);
+		return;
+	}
+
+	efx.Filteri(efx.filter, AL_FILTER_TYPE, AL_FILTER_LOWPASS);
+	efx.Filterf(efx.filter, AL_LOWPASS_GAIN, gain);
+	efx.Filterf(efx.filter, AL_LOWPASS_GAINHF, 1.0f);
+
+	alSource3i(src.al, AL_AUXILIARY_SEND_FILTER,
+	           efx.slot, 0, efx.filter);
+}
+
+void setSourceLowPass(AL::Source::ID src, float gainHF)
+{
+	if (!efx.avail)
+		return;
+
+	if (gainHF >= 1.0f)
+	{
+		alSourcei(src.al, AL_DIRECT_FILTER, AL_FILTER_NULL);
+		return;
+	}
+
+	efx.Filteri(efx.filter, AL_FILTER_TYPE, AL_FILTER_LOWPASS);
+	efx.Filterf(efx.filter, AL_LOWPASS_GAIN, 1.0f);
+	efx.Filterf(efx.filter, AL_LOWPASS_GAINHF, clamp(gainHF, 0.0f, 1.0f));
+
+	alSourcei(src.al, AL_DIRECT_FILTER, efx.filter);
+}
+
+}
@@ -0,0 +1,59 @@
+/*
+** alefx.h
+**
+** This file is part of mkxp.
+**
+** Copyright (C) 2014 - 2021 Amaryllis Kulla <ancurio@mapleshrine.eu>
+**
+** mkxp is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 2 of the License, or
+** (at your option) any later version.
+**
+** mkxp is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with mkxp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef ALEFX_H
+#define ALEFX_H
+
+#include "al-util.h"
+
+#include <alc.h>
+
+/* Thin wrapper around ALC_EXT_EFX: one global auxiliary effect
+ * slot carrying a reverb preset, plus helpers for routing a
+ * source's aux send and direct low pass filter through it.
+ * Everything degrades to a no-op when the extension (or any
+ * of its entry points) is missing */
+namespace EFX
+{
+
+/* Loads the extension entry points and creates the global
+ * effect slot. Called once during audio setup, with the AL
+ * context already current */
+void init(ALCdevice *dev);
+
+bool available();
+
+/* Selects a reverb preset by name ("cave", "hall", ...);
+ * null or empty disables reverb. Returns false for unknown
+ * names and when EFX is unavailable */
+bool setReverbPreset(const char *name);
+
+/* Routes the source's first aux send into the global effect
+ * slot with the given wet gain [0, 1]; 0 disconnects */
+void setSourceSend(AL::Source::ID src, float gain);
+
+/* Direct path high frequency damping [0, 1];
+ * 1 removes the filter again */
+void setSourceLowPass(AL::Source::ID src, float gainHF);
+
+}
+
+#endif // ALEFX_H
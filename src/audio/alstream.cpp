@@ -22,11 +22,13 @@
 #include "alstream.h"
 
 #include "sharedstate.h"
+#include "zonetrace.h"
 #include "sharedmidistate.h"
 #include "eventthread.h"
 #include "filesystem.h"
 #include "exception.h"
 #include "aldatasource.h"
+#include "alefx.h"
 #include "fluid-fun.h"
 #include "sdl-util.h"
 #include "debugwriter.h"
@@ -35,12 +37,103 @@
 #include <SDL_thread.h>
 #include <SDL_timer.h>
 
+#include "config.h"
+#include "util.h"
+
+#include <algorithm>
+
+/* All streams are serviced by one shared worker instead of a
+ * thread per stream: with multi-track BGM the per-stream threads
+ * were mostly idle yet each cost wakeups and context switches.
+ * The pool mutex is held while a stream is serviced, so detach()
+ * doubles as the synchronization point stopStream used to get
+ * from SDL_WaitThread */
+struct ALStreamPool
+{
+	SDL_mutex *mutex;
+	SDL_cond *cond;
+	std::vector<ALStream*> streams;
+	SDL_Thread *thread;
+
+	ALStreamPool()
+	    : thread(0)
+	{
+		mutex = SDL_CreateMutex();
+		cond = SDL_CreateCond();
+	}
+
+	/* Intentionally leaked; the worker lives for the process */
+	static ALStreamPool &instance()
+	{
+		static ALStreamPool *p = new ALStreamPool;
+		return *p;
+	}
+
+	void attach(ALStream *stream)
+	{
+		SDL_LockMutex(mutex);
+
+		if (!thread)
+			thread = createSDLThread
+				<ALStreamPool, &ALStreamPool::workerFun>(this, "al_stream_pool");
+
+		streams.push_back(stream);
+
+		SDL_CondBroadcast(cond);
+		SDL_UnlockMutex(mutex);
+	}
+
+	void detach(ALStream *stream)
+	{
+		SDL_LockMutex(mutex);
+
+		for (size_t i = 0; i < streams.size(); ++i)
+		{
+			if (streams[i] != stream)
+				continue;
+
+			streams.erase(streams.begin() + i);
+			break;
+		}
+
+		SDL_UnlockMutex(mutex);
+	}
+
+	void workerFun()
+	{
+		SDL_LockMutex(mutex);
+
+		while (true)
+		{
+			while (streams.empty())
+				SDL_CondWait(cond, mutex);
+
+			{
+				ZONE_SCOPED("audio-service");
+				for (size_t i = 0; i < streams.size(); ++i)
+					streams[i]->serviceStream();
+			}
+
+			SDL_UnlockMutex(mutex);
+
+			shState->rtData().syncPoint.passSecondarySync();
+			/* Relaxed wakeup cadence under the power profile; the
+			 * stream buffers hold far more than this much audio */
+			SDL_Delay(shState->config().powerSaver ? 25 : AUDIO_SLEEP);
+
+			SDL_LockMutex(mutex);
+		}
+	}
+};
+
 ALStream::ALStream(LoopMode loopMode,
-		           const std::string &threadId)
+		           const std::string &threadId,
+		           const Config &conf)
 	: looped(loopMode == Looped),
 	  state(Closed),
 	  source(0),
-	  thread(0),
+	  servicePhase(Idle),
+	  attached(false),
 	  preemptPause(false),
       pitch(1.0f)
 {
@@ -50,9 +143,19 @@ ALStream::ALStream(LoopMode loopMode,
 	AL::Source::setPitch(alSrc, 1.0f);
 	AL::Source::detachBuffer(alSrc);
 
-	for (int i = 0; i < STREAM_BUFS; ++i)
+	/* Ring depth is tunable; deeper rings ride out decode
+	 * thread scheduling misses */
+	int bufCount = clamp(conf.audioBufCount, 2, 16);
+
+	alBuf.resize(bufCount);
+
+	for (size_t i = 0; i < alBuf.size(); ++i)
 		alBuf[i] = AL::Buffer::gen();
 
+	underrunCount = 0;
+	fillCount = 0;
+	memset(decodeTimes, 0, sizeof(decodeTimes));
+
 	pauseMut = SDL_CreateMutex();
 
 	threadName = std::string("al_stream (") + threadId + ")";
@@ -65,7 +168,7 @@ ALStream::~ALStream()
 	AL::Source::clearQueue(alSrc);
 	AL::Source::del(alSrc);
 
-	for (int i = 0; i < STREAM_BUFS; ++i)
+	for (size_t i = 0; i < alBuf.size(); ++i)
 		AL::Buffer::del(alBuf[i]);
 
 	SDL_DestroyMutex(pauseMut);
@@ -166,6 +269,16 @@ void ALStream::setPitch(float value)
 		AL::Source::setPitch(alSrc, value);
 }
 
+void ALStream::setSendLevel(float value)
+{
+	EFX::setSourceSend(alSrc, value);
+}
+
+void ALStream::setLowPass(float value)
+{
+	EFX::setSourceLowPass(alSrc, value);
+}
+
 ALStream::State ALStream::queryState()
 {
 	checkStopped();
@@ -210,9 +323,36 @@ struct ALStreamOpenHandler : FileSystem::OpenHandler
 		{
 			if (!strcmp(sig, "OggS"))
 			{
-				source = createVorbisSource(ops, looped);
+				/* Ogg is only a container; the codec of the
+				 * first logical stream is named right after
+				 * the first page header */
+				char codec[9] = { 0 };
+				SDL_RWseek(&ops, 28, RW_SEEK_SET);
+				SDL_RWread(&ops, codec, 1, 8);
+				SDL_RWseek(&ops, 0, RW_SEEK_SET);
+
+				if (strcmp(codec, "OpusHead") != 0)
+				{
+					source = createVorbisSource(ops, looped);
+					return true;
+				}
+
+#ifdef MKXPZ_OPUS
+				source = createOpusSource(ops, looped);
+				return true;
+#else
+				/* No native decoder built in; fall through
+				 * and give SDL_sound a shot at it */
+#endif
+			}
+
+#ifdef MKXPZ_FLAC
+			if (!strcmp(sig, "fLaC"))
+			{
+				source = createFlacSource(ops, looped);
 				return true;
 			}
+#endif
 
 			if (!strcmp(sig, "MThd"))
 			{
@@ -225,7 +365,9 @@ struct ALStreamOpenHandler : FileSystem::OpenHandler
 				}
 			}
 
-			source = createSDLSource(ops, ext, STREAM_BUF_SIZE, looped);
+			source = createSDLSource(ops, ext,
+			                         std::max(shState->config().audioBufSize, 4096),
+			                         looped);
 		}
 		catch (const Exception &e)
 		{
@@ -273,12 +415,12 @@ void ALStream::openSource(const std::string &filename)
 
 void ALStream::stopStream()
 {
-	threadTermReq.set();
-
-	if (thread)
+	if (attached)
 	{
-		SDL_WaitThread(thread, 0);
-		thread = 0;
+		/* Returns only once the worker cannot be inside this
+		 * stream anymore */
+		ALStreamPool::instance().detach(this);
+		attached = false;
 		needsRewind.set();
 	}
 
@@ -297,13 +439,13 @@ void ALStream::startStream(double offset)
 	preemptPause = false;
 	streamInited.clear();
 	sourceExhausted.clear();
-	threadTermReq.clear();
 
 	startOffset = offset;
 	procFrames = offset * source->sampleRate();
 
-	thread = createSDLThread
-		<ALStream, &ALStream::streamData>(this, threadName);
+	servicePhase = Prebuffer;
+	attached = true;
+	ALStreamPool::instance().attach(this);
 }
 
 void ALStream::pauseStream()
@@ -357,121 +499,165 @@ void ALStream::checkStopped()
 	state = Stopped;
 }
 
-/* thread func */
-void ALStream::streamData()
+/* Runs one decoder fill and records its duration in the
+ * stream's timing ring (single writer: the pool worker) */
+static ALDataSource::Status timedFillBuffer(ALStream *s, AL::Buffer::ID buf)
 {
-	/* Fill up queue */
-	bool firstBuffer = true;
-	ALDataSource::Status status;
+	uint64_t begin = SDL_GetPerformanceCounter();
 
-	if (threadTermReq)
-		return;
-
-	//if (needsRewind)
-		source->seekToOffset(startOffset);
+	ALDataSource::Status status = s->source->fillBuffer(buf);
 
-	for (int i = 0; i < STREAM_BUFS; ++i)
-	{
-		if (threadTermReq)
-			return;
+	uint64_t elapsed = SDL_GetPerformanceCounter() - begin;
 
-		AL::Buffer::ID buf = alBuf[i];
+	s->decodeTimes[s->fillCount++ % ALStream::DecodeTimeRingSize] =
+		(uint32_t) (elapsed * 1000000 / SDL_GetPerformanceFrequency());
 
-		status = source->fillBuffer(buf);
+	return status;
+}
 
-		if (status == ALDataSource::Error)
-			return;
+void ALStream::collectStats(Stats &out)
+{
+	out.queuedBufs = AL::Source::getInteger(alSrc, AL_BUFFERS_QUEUED);
+	out.procBufs = AL::Source::getProcBufferCount(alSrc);
+	out.underruns = underrunCount;
+	out.fills = fillCount;
 
-		AL::Source::queueBuffer(alSrc, buf);
+	/* Copy out the timing ring (racy against the worker,
+	 * which is fine for diagnostics) and rank it */
+	uint32_t samples[DecodeTimeRingSize];
+	uint32_t count = std::min<uint32_t>(fillCount, DecodeTimeRingSize);
 
-		if (firstBuffer)
-		{
-			resumeStream();
+	if (count == 0)
+	{
+		out.decodeP50 = out.decodeP95 = out.decodeMax = 0;
+		return;
+	}
 
-			firstBuffer = false;
-			streamInited.set();
-		}
+	memcpy(samples, decodeTimes, count * sizeof(uint32_t));
+	std::sort(samples, samples + count);
 
-		if (threadTermReq)
-			return;
+	out.decodeP50 = samples[count / 2];
+	out.decodeP95 = samples[std::min(count - 1, (count * 95) / 100)];
+	out.decodeMax = samples[count - 1];
+}
 
-		if (status == ALDataSource::EndOfStream)
-		{
-			sourceExhausted.set();
-			break;
-		}
-	}
+/* Called by the shared pool worker with the pool mutex held;
+ * one prebuffer pass, then one refill pass per tick */
+void ALStream::serviceStream()
+{
+	if (servicePhase == Idle)
+		return;
 
-	/* Wait for buffers to be consumed, then
-	 * refill and queue them up again */
-	while (true)
+	if (servicePhase == Prebuffer)
 	{
-		shState->rtData().syncPoint.passSecondarySync();
+		/* Prebuffer phase: fill the whole ring before the
+		 * source starts playing, so playback begins with
+		 * maximum slack */
+		bool queuedAny = false;
+		ALDataSource::Status status;
 
-		ALint procBufs = AL::Source::getProcBufferCount(alSrc);
+		//if (needsRewind)
+			source->seekToOffset(startOffset);
 
-		while (procBufs--)
+		for (size_t i = 0; i < alBuf.size(); ++i)
 		{
-			if (threadTermReq)
-				break;
+			AL::Buffer::ID buf = alBuf[i];
 
-			AL::Buffer::ID buf = AL::Source::unqueueBuffer(alSrc);
+			status = timedFillBuffer(this, buf);
 
-			/* If something went wrong, try again later */
-			if (buf == AL::Buffer::ID(0))
-				break;
-
-			if (buf == lastBuf)
-			{
-				/* Reset the processed sample count so
-				 * querying the playback offset returns 0.0 again */
-				procFrames = source->loopStartFrames();
-				lastBuf = AL::Buffer::ID(0);
-			}
-			else
+			if (status == ALDataSource::Error)
 			{
-				/* Add the frame count contained in this
-				 * buffer to the total count */
-				ALint bits = AL::Buffer::getBits(buf);
-				ALint size = AL::Buffer::getSize(buf);
-				ALint chan = AL::Buffer::getChannels(buf);
-
-				if (bits != 0 && chan != 0)
-					procFrames += ((size / (bits / 8)) / chan);
-			}
+				if (queuedAny)
+					break;
 
-			if (sourceExhausted)
-				continue;
+				servicePhase = Idle;
+				return;
+			}
 
-			status = source->fillBuffer(buf);
+			AL::Source::queueBuffer(alSrc, buf);
+			queuedAny = true;
 
-			if (status == ALDataSource::Error)
+			if (status == ALDataSource::EndOfStream)
 			{
 				sourceExhausted.set();
-				return;
+				break;
 			}
+		}
 
-			AL::Source::queueBuffer(alSrc, buf);
+		if (!queuedAny)
+		{
+			servicePhase = Idle;
+			return;
+		}
 
-			/* In case of buffer underrun,
-			 * start playing again */
-			if (AL::Source::getState(alSrc) == AL_STOPPED)
-				AL::Source::play(alSrc);
+		resumeStream();
+		streamInited.set();
 
-			/* If this was the last buffer before the data
-			 * source loop wrapped around again, mark it as
-			 * such so we can catch it and reset the processed
-			 * sample count once it gets unqueued */
-			if (status == ALDataSource::WrapAround)
-				lastBuf = buf;
+		servicePhase = Streaming;
+		return;
+	}
 
-			if (status == ALDataSource::EndOfStream)
-				sourceExhausted.set();
-		}
+	/* Refill pass: requeue consumed buffers */
+	ALDataSource::Status status;
+	ALint procBufs = AL::Source::getProcBufferCount(alSrc);
+
+	while (procBufs--)
+	{
+		AL::Buffer::ID buf = AL::Source::unqueueBuffer(alSrc);
 
-		if (threadTermReq)
+		/* If something went wrong, try again later */
+		if (buf == AL::Buffer::ID(0))
 			break;
 
-		SDL_Delay(AUDIO_SLEEP);
+		if (buf == lastBuf)
+		{
+			/* Reset the processed sample count so
+			 * querying the playback offset returns 0.0 again */
+			procFrames = source->loopStartFrames();
+			lastBuf = AL::Buffer::ID(0);
+		}
+		else
+		{
+			/* Add the frame count contained in this
+			 * buffer to the total count */
+			ALint bits = AL::Buffer::getBits(buf);
+			ALint size = AL::Buffer::getSize(buf);
+			ALint chan = AL::Buffer::getChannels(buf);
+
+			if (bits != 0 && chan != 0)
+				procFrames += ((size / (bits / 8)) / chan);
+		}
+
+		if (sourceExhausted)
+			continue;
+
+		status = timedFillBuffer(this, buf);
+
+		if (status == ALDataSource::Error)
+		{
+			sourceExhausted.set();
+			servicePhase = Idle;
+			return;
+		}
+
+		AL::Source::queueBuffer(alSrc, buf);
+
+		/* In case of buffer underrun,
+		 * start playing again */
+		if (AL::Source::getState(alSrc) == AL_STOPPED)
+		{
+			++underrunCount;
+			AL::Source::play(alSrc);
+		}
+
+		/* If this was the last buffer before the data
+		 * source loop wrapped around again, mark it as
+		 * such so we can catch it and reset the processed
+		 * sample count once it gets unqueued */
+		if (status == ALDataSource::WrapAround)
+			lastBuf = buf;
+
+		if (status == ALDataSource::EndOfStream)
+			sourceExhausted.set();
 	}
 }
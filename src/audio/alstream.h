@@ -26,9 +26,11 @@
 #include "sdl-util.h"
 
 #include <string>
+#include <vector>
 #include <SDL_rwops.h>
 
 struct ALDataSource;
+struct Config;
 
 #define STREAM_BUFS 3
 
@@ -48,7 +50,17 @@ struct ALStream
 	State state;
 
 	ALDataSource *source;
-	SDL_Thread *thread;
+
+	/* Shared pool service state */
+	enum ServicePhase
+	{
+		Idle,
+		Prebuffer,
+		Streaming
+	};
+
+	ServicePhase servicePhase;
+	bool attached;
 
 	std::string threadName;
 
@@ -61,15 +73,39 @@ struct ALStream
 	AtomicFlag streamInited;
 	AtomicFlag sourceExhausted;
 
-	AtomicFlag threadTermReq;
-
 	AtomicFlag needsRewind;
 	double startOffset;
 
 	float pitch;
 
 	AL::Source::ID alSrc;
-	AL::Buffer::ID alBuf[STREAM_BUFS];
+	std::vector<AL::Buffer::ID> alBuf;
+
+	/* Times playback stalled because all queued buffers ran
+	 * out before the decoder refilled them */
+	uint32_t underrunCount;
+
+	/* Per-fill decode durations in microseconds, written
+	 * only by the pool worker. Snapshots read them racily;
+	 * the counters are monotonic and torn reads harmless */
+	enum { DecodeTimeRingSize = 64 };
+	uint32_t decodeTimes[DecodeTimeRingSize];
+	uint32_t fillCount;
+
+	struct Stats
+	{
+		int queuedBufs;
+		int procBufs;
+		uint32_t underruns;
+		uint32_t fills;
+
+		/* Microseconds; 0 when nothing was decoded yet */
+		uint32_t decodeP50;
+		uint32_t decodeP95;
+		uint32_t decodeMax;
+	};
+
+	void collectStats(Stats &out);
 
 	uint64_t procFrames;
 	AL::Buffer::ID lastBuf;
@@ -86,8 +122,11 @@ struct ALStream
 		NotLooped
 	};
 
+	/* Config is passed explicitly because streams are built
+	 * before the shared state pointer exists */
 	ALStream(LoopMode loopMode,
-	         const std::string &threadId);
+	         const std::string &threadId,
+	         const Config &conf);
 	~ALStream();
 
 	void close();
@@ -98,6 +137,8 @@ struct ALStream
 
 	void setVolume(float value);
 	void setPitch(float value);
+	void setSendLevel(float value);
+	void setLowPass(float value);
 	State queryState();
 	double queryOffset();
 	bool queryNativePitch();
@@ -113,8 +154,9 @@ private:
 
 	void checkStopped();
 
-	/* thread func */
-	void streamData();
+public:
+	/* Called by the shared pool worker */
+	void serviceStream();
 };
 
 #endif // ALSTREAM_H
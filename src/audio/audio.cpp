@@ -23,8 +23,11 @@
 
 #include "audiostream.h"
 #include "soundemitter.h"
+#include "alefx.h"
+#include "util.h"
 #include "sharedstate.h"
 #include "sharedmidistate.h"
+#include "filesystem.h"
 #include "eventthread.h"
 #include "sdl-util.h"
 #include "exception.h"
@@ -44,6 +47,17 @@ struct AudioPrivate
 
 	SoundEmitter se;
 
+	/* Forwards file change notifications to the SE cache */
+	struct SeChangeObserver : FileSystem::ChangeObserver
+	{
+		AudioPrivate *p;
+
+		void fileChanged(const char *path)
+		{
+			p->se.fileChanged(path);
+		}
+	} seObserver;
+
 	SyncPoint &syncPoint;
     
     float volumeRatio;
@@ -69,15 +83,19 @@ struct AudioPrivate
 	} meWatch;
 
 	AudioPrivate(RGSSThreadData &rtData)
-	    : bgs(ALStream::Looped, "bgs"),
-	      me(ALStream::NotLooped, "me"),
+	    : bgs(rtData.config, ALStream::Looped, "bgs"),
+	      me(rtData.config, ALStream::NotLooped, "me"),
 	      se(rtData.config),
 	      syncPoint(rtData.syncPoint),
           volumeRatio(1)
 	{
+		seObserver.p = this;
+
+		EFX::init(rtData.alcDev);
+
         for (int i = 0; i < rtData.config.BGM.trackCount; i++) {
             std::string id = std::string("bgm" + std::to_string(i));
-            bgmTracks.push_back(new AudioStream(ALStream::Looped, id.c_str()));
+            bgmTracks.push_back(new AudioStream(rtData.config, ALStream::Looped, id.c_str()));
         }
         
 		meWatch.state = MeNotPlaying;
@@ -411,6 +429,137 @@ void Audio::seStop()
 	p->se.stop();
 }
 
+void Audio::sePreload(const char *filename)
+{
+	p->se.preload(filename);
+}
+
+void Audio::seShrink(uint32_t targetBytes)
+{
+	p->se.shrinkCache(targetBytes);
+}
+
+uint32_t Audio::seBytes()
+{
+	return p->se.cacheBytes();
+}
+
+void Audio::seStats(uint64_t &hits, uint64_t &misses,
+                    uint32_t &cachedBytes, uint32_t &budgetBytes)
+{
+	SDL_LockMutex(p->se.cacheMutex);
+
+	hits = p->se.cacheHits;
+	misses = p->se.cacheMisses;
+	cachedBytes = p->se.bufferBytes;
+	budgetBytes = p->se.cacheBudget;
+
+	SDL_UnlockMutex(p->se.cacheMutex);
+}
+
+bool Audio::fxSetReverb(const char *preset)
+{
+	return EFX::setReverbPreset(preset);
+}
+
+void Audio::bgmSetSend(int level, int track)
+{
+    float gain = clamp<int>(level, 0, 100) / 100.0f;
+
+    if (track == -127) {
+        for (auto track : p->bgmTracks)
+            track->setSendLevel(gain);
+
+        return;
+    }
+
+    p->getTrackByIndex(track)->setSendLevel(gain);
+}
+
+void Audio::bgsSetSend(int level)
+{
+	p->bgs.setSendLevel(clamp<int>(level, 0, 100) / 100.0f);
+}
+
+void Audio::meSetSend(int level)
+{
+	p->me.setSendLevel(clamp<int>(level, 0, 100) / 100.0f);
+}
+
+void Audio::seSetSend(int level)
+{
+	p->se.setSendLevel(clamp<int>(level, 0, 100) / 100.0f);
+}
+
+void Audio::bgmSetLowPass(int level, int track)
+{
+    float gain = clamp<int>(level, 0, 100) / 100.0f;
+
+    if (track == -127) {
+        for (auto track : p->bgmTracks)
+            track->setLowPass(gain);
+
+        return;
+    }
+
+    p->getTrackByIndex(track)->setLowPass(gain);
+}
+
+void Audio::bgsSetLowPass(int level)
+{
+	p->bgs.setLowPass(clamp<int>(level, 0, 100) / 100.0f);
+}
+
+void Audio::meSetLowPass(int level)
+{
+	p->me.setLowPass(clamp<int>(level, 0, 100) / 100.0f);
+}
+
+void Audio::seSetLowPass(int level)
+{
+	p->se.setLowPass(clamp<int>(level, 0, 100) / 100.0f);
+}
+
+static void collectStreamStat(std::vector<Audio::StreamStat> &out,
+                              AudioStream *stream,
+                              const std::string &name)
+{
+	ALStream::Stats st;
+
+	stream->lockStream();
+	stream->stream.collectStats(st);
+	stream->unlockStream();
+
+	Audio::StreamStat entry;
+	entry.name = name;
+	entry.queuedBufs = st.queuedBufs;
+	entry.procBufs = st.procBufs;
+	entry.underruns = st.underruns;
+	entry.fills = st.fills;
+	entry.decodeP50Us = st.decodeP50;
+	entry.decodeP95Us = st.decodeP95;
+	entry.decodeMaxUs = st.decodeMax;
+
+	out.push_back(entry);
+}
+
+void Audio::streamStats(std::vector<StreamStat> &out)
+{
+	out.clear();
+
+	for (size_t i = 0; i < p->bgmTracks.size(); ++i)
+		collectStreamStat(out, p->bgmTracks[i],
+		                  std::string("bgm") + std::to_string(i));
+
+	collectStreamStat(out, &p->bgs, "bgs");
+	collectStreamStat(out, &p->me, "me");
+}
+
+void Audio::watchFileChanges(FileSystem &fs)
+{
+	fs.addChangeObserver(&p->seObserver);
+}
+
 void Audio::setupMidi()
 {
 	shState->midiState().initIfNeeded(shState->config());
@@ -426,15 +575,81 @@ double Audio::bgsPos()
 	return p->bgs.playingOffset();
 }
 
+static void captureChannel(AudioStream *s, Audio::ChannelState &out)
+{
+    ALStream::State state = s->stream.queryState();
+
+    if (state != ALStream::Playing && state != ALStream::Paused)
+    {
+        /* Stopped channels restore to silence */
+        out = Audio::ChannelState();
+        out.volume = 100;
+        out.pitch = 100;
+        out.pos = 0;
+        return;
+    }
+
+    out.filename = s->current.filename;
+    out.volume = (int) (s->getVolume(AudioStream::Base) * 100);
+    out.pitch = (int) (s->current.pitch * 100);
+    out.pos = s->playingOffset();
+}
+
+static void restoreChannel(AudioStream *s, const Audio::ChannelState &in)
+{
+    if (in.filename.empty())
+    {
+        s->stop();
+        return;
+    }
+
+    s->play(in.filename, in.volume, in.pitch, in.pos);
+}
+
+void Audio::captureState(std::vector<ChannelState> &bgm, ChannelState &bgs)
+{
+    bgm.resize(p->bgmTracks.size());
+
+    for (size_t i = 0; i < p->bgmTracks.size(); ++i)
+        captureChannel(p->bgmTracks[i], bgm[i]);
+
+    captureChannel(&p->bgs, bgs);
+}
+
+void Audio::restoreState(const std::vector<ChannelState> &bgm,
+                         const ChannelState &bgs)
+{
+    for (size_t i = 0; i < bgm.size() && i < p->bgmTracks.size(); ++i)
+        restoreChannel(p->bgmTracks[i], bgm[i]);
+
+    /* Tracks beyond the snapshot fall silent */
+    for (size_t i = bgm.size(); i < p->bgmTracks.size(); ++i)
+        p->bgmTracks[i]->stop();
+
+    restoreChannel(&p->bgs, bgs);
+}
+
 void Audio::reset()
 {
     for (auto track : p->bgmTracks) {
     	track->stop();
+    	track->setSendLevel(0.0f);
+    	track->setLowPass(1.0f);
     }
 
 	p->bgs.stop();
 	p->me.stop();
 	p->se.stop();
+
+	p->bgs.setSendLevel(0.0f);
+	p->me.setSendLevel(0.0f);
+	p->se.setSendLevel(0.0f);
+
+	p->bgs.setLowPass(1.0f);
+	p->me.setLowPass(1.0f);
+	p->se.setLowPass(1.0f);
+
+	EFX::setReverbPreset(0);
 }
 
 Audio::~Audio() { delete p; }
@@ -22,6 +22,10 @@
 #ifndef AUDIO_H
 #define AUDIO_H
 
+#include <stdint.h>
+#include <string>
+#include <vector>
+
 /* Concerning the 'pos' parameter:
  *   RGSS3 actually doesn't specify a format for this,
  *   it's only implied that it is a numerical value
@@ -34,6 +38,7 @@
 
 struct AudioPrivate;
 struct RGSSThreadData;
+class FileSystem;
 
 class Audio
 {
@@ -70,10 +75,72 @@ public:
 	            double x = 0.0f, double y = 0.0f, double z = 0.0f);
 	void seStop();
 
+	/* Background-decodes the SE into the cache */
+	void sePreload(const char *filename);
+	void seShrink(uint32_t targetBytes);
+	uint32_t seBytes();
+
+	/* Cache effectiveness counters */
+	void seStats(uint64_t &hits, uint64_t &misses,
+	             uint32_t &cachedBytes, uint32_t &budgetBytes);
+
+	/* Pipeline latency / queue depth snapshot of
+	 * every streaming channel */
+	struct StreamStat
+	{
+		std::string name;
+		int queuedBufs;
+		int procBufs;
+		uint32_t underruns;
+		uint32_t fills;
+
+		/* Decoder fill durations in microseconds */
+		uint32_t decodeP50Us;
+		uint32_t decodeP95Us;
+		uint32_t decodeMaxUs;
+	};
+
+	void streamStats(std::vector<StreamStat> &out);
+
+	/* EFX environmental audio. One global reverb preset;
+	 * per-channel wet send levels and direct path low pass
+	 * cutoffs are percentages like volumes */
+	bool fxSetReverb(const char *preset);
+	void bgmSetSend(int level, int track = -127);
+	void bgsSetSend(int level);
+	void meSetSend(int level);
+	void seSetSend(int level);
+	void bgmSetLowPass(int level, int track = -127);
+	void bgsSetLowPass(int level);
+	void meSetLowPass(int level);
+	void seSetLowPass(int level);
+
+	/* Registers the SE cache with the development file
+	 * watcher so changed assets drop their cached decode */
+	void watchFileChanges(FileSystem &fs);
+
 	void setupMidi();
 	double bgmPos(int track = 0);
 	double bgsPos();
 
+	/* Fast save-state capture/restore of the streaming channels:
+	 * filename, volume, pitch and position per BGM track plus
+	 * BGS. Restore replays through the normal play paths, so the
+	 * decoders rebuild without any script-side involvement; a
+	 * channel captured silent restores to stopped */
+	struct ChannelState
+	{
+		std::string filename;
+		int volume;
+		int pitch;
+		double pos;
+	};
+
+	void captureState(std::vector<ChannelState> &bgm,
+	                  ChannelState &bgs);
+	void restoreState(const std::vector<ChannelState> &bgm,
+	                  const ChannelState &bgs);
+
 	void reset();
 
 private:
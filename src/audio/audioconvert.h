@@ -0,0 +1,124 @@
+/*
+** audioconvert.h
+**
+** This file is part of mkxp.
+**
+** Copyright (C) 2014 - 2021 Amaryllis Kulla <ancurio@mapleshrine.eu>
+**
+** mkxp is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 2 of the License, or
+** (at your option) any later version.
+**
+** mkxp is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with mkxp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef AUDIOCONVERT_H
+#define AUDIOCONVERT_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* Vectorized kernels for the sample conversions the engine does
+ * itself (SDL_sound covers everything else). SSE2 is baseline on
+ * x86-64 and NEON on aarch64, so dispatch is per-architecture at
+ * compile time with a scalar fallback elsewhere. */
+
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MKXPZ_AUDIO_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__aarch64__)
+#define MKXPZ_AUDIO_NEON
+#include <arm_neon.h>
+#endif
+
+/* Folds interleaved stereo float frames to mono:
+ * dst[i] = (L[i] + R[i]) / 2 */
+static inline void
+audioStereoToMonoF32(float *dst, const float *src, size_t frames)
+{
+	size_t i = 0;
+
+#if defined(MKXPZ_AUDIO_SSE2)
+	for (; i + 4 <= frames; i += 4)
+	{
+		__m128 a = _mm_loadu_ps(src + i*2);     /* L0 R0 L1 R1 */
+		__m128 b = _mm_loadu_ps(src + i*2 + 4); /* L2 R2 L3 R3 */
+
+		__m128 l = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+		__m128 r = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+
+		__m128 m = _mm_mul_ps(_mm_add_ps(l, r), _mm_set1_ps(0.5f));
+
+		_mm_storeu_ps(dst + i, m);
+	}
+#elif defined(MKXPZ_AUDIO_NEON)
+	for (; i + 4 <= frames; i += 4)
+	{
+		float32x4x2_t lr = vld2q_f32(src + i*2);
+
+		float32x4_t m = vmulq_n_f32(vaddq_f32(lr.val[0], lr.val[1]), 0.5f);
+
+		vst1q_f32(dst + i, m);
+	}
+#endif
+
+	for (; i < frames; ++i)
+		dst[i] = (src[i*2] + src[i*2 + 1]) * 0.5f;
+}
+
+/* Converts float samples to clamped signed 16 bit */
+static inline void
+audioFloatToS16(int16_t *dst, const float *src, size_t count)
+{
+	size_t i = 0;
+
+#if defined(MKXPZ_AUDIO_SSE2)
+	const __m128 scale = _mm_set1_ps(32767.0f);
+
+	for (; i + 8 <= count; i += 8)
+	{
+		__m128 a = _mm_mul_ps(_mm_loadu_ps(src + i), scale);
+		__m128 b = _mm_mul_ps(_mm_loadu_ps(src + i + 4), scale);
+
+		/* cvtps saturates to int32; packs saturates to int16 */
+		__m128i ia = _mm_cvtps_epi32(a);
+		__m128i ib = _mm_cvtps_epi32(b);
+
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i),
+		                 _mm_packs_epi32(ia, ib));
+	}
+#elif defined(MKXPZ_AUDIO_NEON)
+	for (; i + 8 <= count; i += 8)
+	{
+		float32x4_t a = vmulq_n_f32(vld1q_f32(src + i), 32767.0f);
+		float32x4_t b = vmulq_n_f32(vld1q_f32(src + i + 4), 32767.0f);
+
+		int16x4_t sa = vqmovn_s32(vcvtq_s32_f32(a));
+		int16x4_t sb = vqmovn_s32(vcvtq_s32_f32(b));
+
+		vst1q_s16(dst + i, vcombine_s16(sa, sb));
+	}
+#endif
+
+	for (; i < count; ++i)
+	{
+		float v = src[i] * 32767.0f;
+
+		if (v < -32768.0f)
+			v = -32768.0f;
+		else if (v > 32767.0f)
+			v = 32767.0f;
+
+		dst[i] = (int16_t) v;
+	}
+}
+
+#endif // AUDIOCONVERT_H
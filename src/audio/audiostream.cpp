@@ -28,11 +28,110 @@
 #include <SDL_thread.h>
 #include <SDL_timer.h>
 
-AudioStream::AudioStream(ALStream::LoopMode loopMode,
+#include <vector>
+
+/* All fade in/out ramps are stepped by one shared timer worker
+ * instead of a thread per fading stream: every active fade is
+ * advanced in a single pass per tick, against the same tick
+ * stamp, so concurrent fades stay in lockstep and each fade
+ * costs no thread spawn/join. The pool mutex is held while a
+ * stream's fades are stepped, so detach() returns only once
+ * the worker cannot be inside that stream anymore */
+struct AudioFadePool
+{
+	SDL_mutex *mutex;
+	SDL_cond *cond;
+	std::vector<AudioStream*> streams;
+	SDL_Thread *thread;
+
+	AudioFadePool()
+	    : thread(0)
+	{
+		mutex = SDL_CreateMutex();
+		cond = SDL_CreateCond();
+	}
+
+	/* Intentionally leaked; the worker lives for the process */
+	static AudioFadePool &instance()
+	{
+		static AudioFadePool *p = new AudioFadePool;
+		return *p;
+	}
+
+	void attach(AudioStream *stream)
+	{
+		SDL_LockMutex(mutex);
+
+		if (!thread)
+			thread = createSDLThread
+				<AudioFadePool, &AudioFadePool::workerFun>(this, "audio_fade_pool");
+
+		if (!stream->fadesAttached)
+		{
+			streams.push_back(stream);
+			stream->fadesAttached = true;
+		}
+
+		SDL_CondBroadcast(cond);
+		SDL_UnlockMutex(mutex);
+	}
+
+	void detach(AudioStream *stream)
+	{
+		SDL_LockMutex(mutex);
+
+		for (size_t i = 0; i < streams.size(); ++i)
+		{
+			if (streams[i] != stream)
+				continue;
+
+			streams.erase(streams.begin() + i);
+			break;
+		}
+
+		stream->fadesAttached = false;
+
+		SDL_UnlockMutex(mutex);
+	}
+
+	void workerFun()
+	{
+		SDL_LockMutex(mutex);
+
+		while (true)
+		{
+			while (streams.empty())
+				SDL_CondWait(cond, mutex);
+
+			for (size_t i = 0; i < streams.size();)
+			{
+				if (streams[i]->serviceFades())
+				{
+					++i;
+					continue;
+				}
+
+				/* All of this stream's fades have run out */
+				streams[i]->fadesAttached = false;
+				streams.erase(streams.begin() + i);
+			}
+
+			SDL_UnlockMutex(mutex);
+
+			SDL_Delay(AUDIO_SLEEP);
+
+			SDL_LockMutex(mutex);
+		}
+	}
+};
+
+AudioStream::AudioStream(const Config &conf,
+                         ALStream::LoopMode loopMode,
                          const std::string &threadId)
 	: extPaused(false),
 	  noResumeStop(false),
-	  stream(loopMode, threadId)
+	  stream(loopMode, threadId, conf),
+	  fadesAttached(false)
 {
 	current.volume = 1.0f;
 	current.pitch = 1.0f;
@@ -40,28 +139,12 @@ AudioStream::AudioStream(ALStream::LoopMode loopMode,
 	for (size_t i = 0; i < VolumeTypeCount; ++i)
 		volumes[i] = 1.0f;
 
-	fade.thread = 0;
-	fade.threadName = std::string("audio_fadeout (") + threadId + ")";
-
-	fadeIn.thread = 0;
-	fadeIn.threadName = std::string("audio_fadein (") + threadId + ")";
-
 	streamMut = SDL_CreateMutex();
 }
 
 AudioStream::~AudioStream()
 {
-	if (fade.thread)
-	{
-		fade.reqTerm.set();
-		SDL_WaitThread(fade.thread, 0);
-	}
-
-	if (fadeIn.thread)
-	{
-		fadeIn.rqTerm.set();
-		SDL_WaitThread(fadeIn.thread, 0);
-	}
+	AudioFadePool::instance().detach(this);
 
 	lockStream();
 
@@ -138,10 +221,13 @@ void AudioStream::play(const std::string &filename,
 	setVolume(Base, _volume);
 	stream.setPitch(_pitch);
 
+	bool fadeInStarted = false;
+
 	if (offset > 0)
 	{
 		setVolume(FadeIn, 0);
 		startFadeIn();
+		fadeInStarted = true;
 	}
 
 	current.filename = filename;
@@ -154,6 +240,11 @@ void AudioStream::play(const std::string &filename,
 		noResumeStop = false;
 
 	unlockStream();
+
+	/* Attached outside the stream lock; the pool
+	 * worker takes it while stepping fades */
+	if (fadeInStarted)
+		AudioFadePool::instance().attach(this);
 }
 
 void AudioStream::stop()
@@ -198,23 +289,15 @@ void AudioStream::fadeOut(int duration)
 		return;
 	}
 
-	if (fade.thread)
-	{
-		fade.reqFini.set();
-		SDL_WaitThread(fade.thread, 0);
-		fade.thread = 0;
-	}
-
 	fade.active.set();
 	fade.msStep = 1.0f / duration;
-	fade.reqFini.clear();
-	fade.reqTerm.clear();
 	fade.startTicks = SDL_GetTicks();
 
-	fade.thread = createSDLThread
-		<AudioStream, &AudioStream::fadeOutThread>(this, fade.threadName);
-
 	unlockStream();
+
+	/* Attached outside the stream lock; the pool
+	 * worker takes it while stepping fades */
+	AudioFadePool::instance().attach(this);
 }
 
 void AudioStream::seek(double offset)
@@ -248,6 +331,20 @@ float AudioStream::getVolume(VolumeType type)
 	return volumes[type];
 }
 
+void AudioStream::setSendLevel(float value)
+{
+	lockStream();
+	stream.setSendLevel(value);
+	unlockStream();
+}
+
+void AudioStream::setLowPass(float value)
+{
+	lockStream();
+	stream.setLowPass(value);
+	unlockStream();
+}
+
 double AudioStream::playingOffset()
 {
 	return stream.queryOffset();
@@ -265,101 +362,94 @@ void AudioStream::updateVolume()
 
 void AudioStream::finiFadeOutInt()
 {
-	if (fade.thread)
+	/* Returns only once the worker cannot be
+	 * inside this stream anymore */
+	AudioFadePool::instance().detach(this);
+
+	lockStream();
+
+	if (fade.active)
 	{
-		fade.reqFini.set();
-		SDL_WaitThread(fade.thread, 0);
-		fade.thread = 0;
+		if (stream.queryState() != ALStream::Paused)
+			stream.stop();
+
+		setVolume(FadeOut, 1.0f);
+		fade.active.clear();
 	}
 
-	if (fadeIn.thread)
+	if (fadeIn.active)
 	{
-		fadeIn.rqFini.set();
-		SDL_WaitThread(fadeIn.thread, 0);
-		fadeIn.thread = 0;
+		setVolume(FadeIn, 1.0f);
+		fadeIn.active.clear();
 	}
+
+	unlockStream();
 }
 
 void AudioStream::startFadeIn()
 {
 	/* Previous fadein should always be terminated in play() */
-	assert(!fadeIn.thread);
+	assert(!fadeIn.active);
 
-	fadeIn.rqFini.clear();
-	fadeIn.rqTerm.clear();
+	fadeIn.active.set();
 	fadeIn.startTicks = SDL_GetTicks();
-
-	fadeIn.thread = createSDLThread
-		<AudioStream, &AudioStream::fadeInThread>(this, fadeIn.threadName);
 }
 
-void AudioStream::fadeOutThread()
+/* Called by the shared fade pool worker with the pool mutex
+ * held; advances every active ramp one step. Returns false
+ * once no fade is active anymore, upon which the worker
+ * drops this stream from its list */
+bool AudioStream::serviceFades()
 {
-	while (true)
-	{
-		/* Just immediately terminate on request */
-		if (fade.reqTerm)
-			break;
+	uint32_t ticks = SDL_GetTicks();
 
-		lockStream();
+	lockStream();
 
-		uint32_t curDur = SDL_GetTicks() - fade.startTicks;
+	if (fade.active)
+	{
+		uint32_t curDur = ticks - fade.startTicks;
 		float resVol = 1.0f - (curDur*fade.msStep);
 
 		ALStream::State state = stream.queryState();
 
 		if (state != ALStream::Playing
-		|| resVol < 0
-		|| fade.reqFini)
+		||  resVol < 0)
 		{
 			if (state != ALStream::Paused)
 				stream.stop();
 
 			setVolume(FadeOut, 1.0f);
-			unlockStream();
-
-			break;
+			fade.active.clear();
+		}
+		else
+		{
+			setVolume(FadeOut, resVol);
 		}
-
-		setVolume(FadeOut, resVol);
-
-		unlockStream();
-
-		SDL_Delay(AUDIO_SLEEP);
 	}
 
-	fade.active.clear();
-}
-
-void AudioStream::fadeInThread()
-{
-	while (true)
+	if (fadeIn.active)
 	{
-		if (fadeIn.rqTerm)
-			break;
-
-		lockStream();
-
 		/* Fade in duration is always 1 second */
-		uint32_t cur = SDL_GetTicks() - fadeIn.startTicks;
+		uint32_t cur = ticks - fadeIn.startTicks;
 		float prog = cur / 1000.0f;
 
 		ALStream::State state = stream.queryState();
 
 		if (state != ALStream::Playing
-		||  prog >= 1.0f
-		||  fadeIn.rqFini)
+		||  prog >= 1.0f)
 		{
 			setVolume(FadeIn, 1.0f);
-			unlockStream();
-
-			break;
+			fadeIn.active.clear();
 		}
+		else
+		{
+			setVolume(FadeIn, prog);
+		}
+	}
 
-		setVolume(FadeIn, prog);
+	bool anyActive = fade.active || fadeIn.active;
 
-		unlockStream();
+	unlockStream();
 
-		SDL_Delay(AUDIO_SLEEP);
-	}
+	return anyActive;
 }
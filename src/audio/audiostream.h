@@ -89,17 +89,6 @@ struct AudioStream
 		/* Fade out is in progress */
 		AtomicFlag active;
 
-		/* Request fade thread to finish and
-		 * cleanup (like it normally would) */
-		AtomicFlag reqFini;
-
-		/* Request fade thread to terminate
-		 * immediately */
-		AtomicFlag reqTerm;
-
-		SDL_Thread *thread;
-		std::string threadName;
-
 		/* Amount of reduced absolute volume
 		 * per ms of fade time */
 		float msStep;
@@ -111,16 +100,17 @@ struct AudioStream
 	/* Fade in */
 	struct
 	{
-		AtomicFlag rqFini;
-		AtomicFlag rqTerm;
-
-		SDL_Thread *thread;
-		std::string threadName;
+		AtomicFlag active;
 
 		uint32_t startTicks;
 	} fadeIn;
 
-	AudioStream(ALStream::LoopMode loopMode,
+	/* Shared fade pool membership;
+	 * only touched with the pool mutex held */
+	bool fadesAttached;
+
+	AudioStream(const Config &conf,
+	            ALStream::LoopMode loopMode,
 	            const std::string &threadId);
 	~AudioStream();
 
@@ -141,6 +131,11 @@ struct AudioStream
 	void setVolume(VolumeType type, float value);
 	float getVolume(VolumeType type);
 
+	/* EFX routing (wet send into the global reverb
+	 * slot / direct path low pass) */
+	void setSendLevel(float value);
+	void setLowPass(float value);
+
 	double playingOffset();
 
 private:
@@ -150,8 +145,9 @@ private:
 	void finiFadeOutInt();
 	void startFadeIn();
 
-	void fadeOutThread();
-	void fadeInThread();
+public:
+	/* Called by the shared fade pool worker */
+	bool serviceFades();
 };
 
 #endif // AUDIOSTREAM_H
@@ -0,0 +1,425 @@
+/*
+** flacsource.cpp
+**
+** This file is part of mkxp.
+**
+** Copyright (C) 2014 - 2021 Amaryllis Kulla <ancurio@mapleshrine.eu>
+**
+** mkxp is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 2 of the License, or
+** (at your option) any later version.
+**
+** mkxp is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with mkxp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifdef MKXPZ_FLAC
+
+#include "aldatasource.h"
+#include "exception.h"
+
+#include <FLAC/stream_decoder.h>
+#include <vector>
+#include <algorithm>
+
+struct FlacSource : ALDataSource
+{
+	SDL_RWops src;
+
+	FLAC__StreamDecoder *dec;
+
+	uint32_t currentFrame;
+	uint64_t totalFrames;
+
+	/* Same LOOPSTART/LOOPLENGTH tags as VorbisSource,
+	 * read from the FLAC vorbis comment block */
+	struct
+	{
+		uint32_t start;
+		uint32_t length;
+		uint32_t end;
+		bool valid;
+		bool requested;
+	} loop;
+
+	struct
+	{
+		int channels;
+		int rate;
+		int frameSize;
+		ALenum alFormat;
+	} info;
+
+	/* Decoded samples accumulated by the write callback.
+	 * Persistent across fills: a seek delivers the (trimmed)
+	 * frame at the seek target through the write callback,
+	 * and those samples must not be lost */
+	std::vector<int16_t> pcmBuf;
+
+	/* Wrap seek target, deferred to the next fill so one AL
+	 * buffer never mixes pre- and post-wrap samples and the
+	 * already decoded tail isn't thrown away; -1 = none */
+	int64_t pendingSeekFrame;
+
+	bool decodeError;
+
+	FlacSource(SDL_RWops &ops,
+	           bool looped)
+	    : src(ops),
+	      dec(0),
+	      currentFrame(0),
+	      totalFrames(0),
+	      pendingSeekFrame(-1),
+	      decodeError(false)
+	{
+		info.channels = 0;
+		info.rate = 0;
+
+		loop.requested = looped;
+		loop.valid = false;
+		loop.start = loop.length = 0;
+
+		dec = FLAC__stream_decoder_new();
+
+		if (!dec)
+		{
+			SDL_RWclose(&src);
+			throw Exception(Exception::MKXPError,
+			                "FLAC: Cannot allocate decoder");
+		}
+
+		/* Loop tags live in the vorbis comment block,
+		 * which is skipped by default */
+		FLAC__stream_decoder_set_metadata_respond
+			(dec, FLAC__METADATA_TYPE_VORBIS_COMMENT);
+
+		FLAC__StreamDecoderInitStatus status =
+			FLAC__stream_decoder_init_stream(dec, cbRead, cbSeek, cbTell,
+			                                 cbLength, cbEof, cbWrite,
+			                                 cbMetadata, cbError, this);
+
+		if (status != FLAC__STREAM_DECODER_INIT_STATUS_OK
+		||  !FLAC__stream_decoder_process_until_end_of_metadata(dec)
+		||  info.rate == 0)
+		{
+			FLAC__stream_decoder_delete(dec);
+			SDL_RWclose(&src);
+			throw Exception(Exception::MKXPError,
+			                "FLAC: Cannot read flac file");
+		}
+
+		if (info.channels > 2)
+		{
+			FLAC__stream_decoder_delete(dec);
+			SDL_RWclose(&src);
+			throw Exception(Exception::MKXPError,
+			                "Cannot handle audio with more than 2 channels");
+		}
+
+		info.alFormat = chooseALFormat(sizeof(int16_t), info.channels);
+		info.frameSize = sizeof(int16_t) * info.channels;
+
+		pcmBuf.reserve(STREAM_BUF_SIZE);
+
+		loop.end = loop.start + loop.length;
+		loop.valid = (loop.start && loop.length);
+	}
+
+	~FlacSource()
+	{
+		FLAC__stream_decoder_delete(dec);
+		SDL_RWclose(&src);
+	}
+
+	int sampleRate()
+	{
+		return info.rate;
+	}
+
+	void seekToOffset(double seconds)
+	{
+		pendingSeekFrame = -1;
+		pcmBuf.clear();
+
+		currentFrame = (seconds <= 0) ? 0 : lround(seconds * info.rate);
+
+		if (loop.valid && currentFrame > loop.end)
+			currentFrame = loop.start;
+
+		if (totalFrames > 0 && currentFrame >= totalFrames)
+			currentFrame = 0;
+
+		/* If seeking fails, just seek back to start */
+		if (!FLAC__stream_decoder_seek_absolute(dec, currentFrame))
+		{
+			FLAC__stream_decoder_flush(dec);
+			FLAC__stream_decoder_seek_absolute(dec, 0);
+			currentFrame = 0;
+		}
+	}
+
+	Status fillBuffer(AL::Buffer::ID alBuffer)
+	{
+		if (pendingSeekFrame >= 0)
+		{
+			currentFrame = pendingSeekFrame;
+			pendingSeekFrame = -1;
+
+			if (!FLAC__stream_decoder_seek_absolute(dec, currentFrame))
+				return ALDataSource::Error;
+		}
+
+		Status retStatus = ALDataSource::NoError;
+
+		bool readAgain = false;
+
+		while (pcmBuf.size() < STREAM_BUF_SIZE)
+		{
+			size_t prevSize = pcmBuf.size();
+
+			if (!FLAC__stream_decoder_process_single(dec) || decodeError)
+			{
+				decodeError = false;
+				retStatus = ALDataSource::Error;
+
+				break;
+			}
+
+			if (FLAC__stream_decoder_get_state(dec)
+			    == FLAC__STREAM_DECODER_END_OF_STREAM)
+			{
+				/* EOF */
+				if (!loop.requested)
+				{
+					retStatus = ALDataSource::EndOfStream;
+
+					break;
+				}
+
+				retStatus = ALDataSource::WrapAround;
+
+				if (!pcmBuf.empty())
+				{
+					/* Upload the tail now; the wrap seek
+					 * runs at the start of the next fill */
+					pendingSeekFrame = 0;
+
+					break;
+				}
+
+				if (readAgain)
+				{
+					/* We're still not getting data though.
+					 * Just error out to prevent an endless loop */
+					retStatus = ALDataSource::Error;
+					break;
+				}
+
+				readAgain = true;
+				currentFrame = 0;
+
+				if (!FLAC__stream_decoder_seek_absolute(dec, 0))
+				{
+					retStatus = ALDataSource::Error;
+					break;
+				}
+
+				continue;
+			}
+
+			currentFrame += (pcmBuf.size() - prevSize) / info.channels;
+
+			if (loop.valid && currentFrame >= loop.end)
+			{
+				/* Determine how many frames we're
+				 * over the loop end */
+				uint32_t discardFrames = currentFrame - loop.end;
+				pcmBuf.resize(pcmBuf.size() - discardFrames * info.channels);
+
+				retStatus = ALDataSource::WrapAround;
+				pendingSeekFrame = loop.start;
+
+				break;
+			}
+		}
+
+		if (retStatus != ALDataSource::Error)
+		{
+			AL::Buffer::uploadData(alBuffer, info.alFormat, pcmBuf.data(),
+			                       pcmBuf.size()*sizeof(int16_t), info.rate);
+			pcmBuf.clear();
+		}
+
+		return retStatus;
+	}
+
+	uint32_t loopStartFrames()
+	{
+		if (loop.valid)
+			return loop.start;
+		else
+			return 0;
+	}
+
+	bool setPitch(float)
+	{
+		return false;
+	}
+
+	/* libFLAC callbacks */
+	static FLAC__StreamDecoderReadStatus
+	cbRead(const FLAC__StreamDecoder*, FLAC__byte buffer[],
+	       size_t *bytes, void *inst)
+	{
+		FlacSource *fs = static_cast<FlacSource*>(inst);
+
+		if (*bytes == 0)
+			return FLAC__STREAM_DECODER_READ_STATUS_ABORT;
+
+		*bytes = SDL_RWread(&fs->src, buffer, 1, *bytes);
+
+		return *bytes == 0 ? FLAC__STREAM_DECODER_READ_STATUS_END_OF_STREAM
+		                   : FLAC__STREAM_DECODER_READ_STATUS_CONTINUE;
+	}
+
+	static FLAC__StreamDecoderSeekStatus
+	cbSeek(const FLAC__StreamDecoder*, FLAC__uint64 offset, void *inst)
+	{
+		FlacSource *fs = static_cast<FlacSource*>(inst);
+
+		return SDL_RWseek(&fs->src, offset, RW_SEEK_SET) < 0
+			? FLAC__STREAM_DECODER_SEEK_STATUS_ERROR
+			: FLAC__STREAM_DECODER_SEEK_STATUS_OK;
+	}
+
+	static FLAC__StreamDecoderTellStatus
+	cbTell(const FLAC__StreamDecoder*, FLAC__uint64 *offset, void *inst)
+	{
+		FlacSource *fs = static_cast<FlacSource*>(inst);
+
+		Sint64 pos = SDL_RWtell(&fs->src);
+
+		if (pos < 0)
+			return FLAC__STREAM_DECODER_TELL_STATUS_ERROR;
+
+		*offset = pos;
+
+		return FLAC__STREAM_DECODER_TELL_STATUS_OK;
+	}
+
+	static FLAC__StreamDecoderLengthStatus
+	cbLength(const FLAC__StreamDecoder*, FLAC__uint64 *length, void *inst)
+	{
+		FlacSource *fs = static_cast<FlacSource*>(inst);
+
+		Sint64 size = SDL_RWsize(&fs->src);
+
+		if (size < 0)
+			return FLAC__STREAM_DECODER_LENGTH_STATUS_UNSUPPORTED;
+
+		*length = size;
+
+		return FLAC__STREAM_DECODER_LENGTH_STATUS_OK;
+	}
+
+	static FLAC__bool
+	cbEof(const FLAC__StreamDecoder*, void *inst)
+	{
+		FlacSource *fs = static_cast<FlacSource*>(inst);
+
+		return SDL_RWtell(&fs->src) == SDL_RWsize(&fs->src);
+	}
+
+	static FLAC__StreamDecoderWriteStatus
+	cbWrite(const FLAC__StreamDecoder*, const FLAC__Frame *frame,
+	        const FLAC__int32 *const buffer[], void *inst)
+	{
+		FlacSource *fs = static_cast<FlacSource*>(inst);
+
+		unsigned blocksize = frame->header.blocksize;
+		unsigned channels = frame->header.channels;
+
+		/* Fold whatever bit depth the file uses down to 16 */
+		int shift = (int) frame->header.bits_per_sample - 16;
+
+		for (unsigned i = 0; i < blocksize; ++i)
+			for (unsigned c = 0; c < channels; ++c)
+			{
+				FLAC__int32 s = buffer[c][i];
+
+				fs->pcmBuf.push_back(shift >= 0 ? s >> shift : s << -shift);
+			}
+
+		return FLAC__STREAM_DECODER_WRITE_STATUS_CONTINUE;
+	}
+
+	static void
+	cbMetadata(const FLAC__StreamDecoder*,
+	           const FLAC__StreamMetadata *metadata, void *inst)
+	{
+		FlacSource *fs = static_cast<FlacSource*>(inst);
+
+		if (metadata->type == FLAC__METADATA_TYPE_STREAMINFO)
+		{
+			fs->info.channels = metadata->data.stream_info.channels;
+			fs->info.rate = metadata->data.stream_info.sample_rate;
+			fs->totalFrames = metadata->data.stream_info.total_samples;
+
+			return;
+		}
+
+		if (metadata->type != FLAC__METADATA_TYPE_VORBIS_COMMENT
+		||  !fs->loop.requested)
+			return;
+
+		/* Try to extract loop info */
+		const FLAC__StreamMetadata_VorbisComment &vc =
+			metadata->data.vorbis_comment;
+
+		for (FLAC__uint32 i = 0; i < vc.num_comments; ++i)
+		{
+			/* Entries are NUL terminated by libFLAC */
+			char *comment = reinterpret_cast<char*>(vc.comments[i].entry);
+			char *sep = strstr(comment, "=");
+
+			/* No '=' found */
+			if (!sep)
+				continue;
+
+			/* Empty value */
+			if (!*(sep+1))
+				continue;
+
+			*sep = '\0';
+
+			if (!strcmp(comment, "LOOPSTART"))
+				fs->loop.start = strtol(sep+1, 0, 10);
+
+			if (!strcmp(comment, "LOOPLENGTH"))
+				fs->loop.length = strtol(sep+1, 0, 10);
+
+			*sep = '=';
+		}
+	}
+
+	static void
+	cbError(const FLAC__StreamDecoder*,
+	        FLAC__StreamDecoderErrorStatus, void *inst)
+	{
+		static_cast<FlacSource*>(inst)->decodeError = true;
+	}
+};
+
+ALDataSource *createFlacSource(SDL_RWops &ops,
+                               bool looped)
+{
+	return new FlacSource(ops, looped);
+}
+
+#endif /* MKXPZ_FLAC */
@@ -20,10 +20,12 @@
 */
 
 #include "aldatasource.h"
+#include "sdl-util.h"
 
 #include "al-util.h"
 #include "exception.h"
 #include "sharedstate.h"
+#include "filesystem.h"
 #include "sharedmidistate.h"
 #include "util.h"
 #include "debugwriter.h"
@@ -54,6 +56,9 @@
 
 #define TICK_FRAMES 32
 #define BUF_TICKS (STREAM_BUF_SIZE / TICK_FRAMES)
+
+/* Chunks of synthesized PCM kept queued ahead of the stream */
+#define MIDI_RA_CHUNKS 4
 #define DEFAULT_BPM 120
 #define MAX_CHANNELS 16
 
@@ -142,20 +147,23 @@ badMidiFormat()
 	throw Exception(Exception::MKXPError, "Midi: Bad format");
 }
 
-/* File-like interface to a read-only memory buffer */
+/* File-like interface to a read-only memory buffer; does not
+ * own the bytes, so it can walk a borrowed cache view */
 struct MemChunk
 {
-	const std::vector<uint8_t> &data;
+	const uint8_t *data;
+	size_t size;
 	size_t i;
 
-	MemChunk(const std::vector<uint8_t> &data)
+	MemChunk(const uint8_t *data, size_t size)
 	    : data(data),
+	      size(size),
 	      i(0)
 	{}
 
 	uint8_t readByte()
 	{
-		if (i >= data.size())
+		if (i >= size)
 			endOfFile();
 
 		return data[i++];
@@ -163,7 +171,7 @@ struct MemChunk
 
 	void readData(void *buf, size_t n)
 	{
-		if (i + n > data.size())
+		if (i + n > size)
 			endOfFile();
 
 		memcpy(buf, &data[i], n);
@@ -172,7 +180,7 @@ struct MemChunk
 
 	void skipData(size_t n)
 	{
-		if ((i += n) > data.size())
+		if ((i += n) > size)
 			endOfFile();
 	}
 
@@ -409,9 +417,9 @@ void readMidiTrack(MidiReadHandler *handler, MemChunk &chunk)
 		badMidiFormat();
 }
 
-void readMidi(MidiReadHandler *handler, const std::vector<uint8_t> &data)
+void readMidi(MidiReadHandler *handler, const uint8_t *data, size_t len)
 {
-	MemChunk chunk(data);
+	MemChunk chunk(data, len);
 
 	/* Midi signature */
 	char sig[5] = { 0 };
@@ -622,21 +630,45 @@ struct MidiSource : ALDataSource, MidiReadHandler
 	      genDeltasCarry(0),
 	      curTrack(-1)
 	{
-		size_t dataLen = SDL_RWsize(&ops);
-		std::vector<uint8_t> data(dataLen);
+		const uint8_t *view;
+		size_t viewLen;
 
-		if (SDL_RWread(&ops, &data[0], 1, dataLen) < dataLen)
+		if (FileSystem::rwopsDirectView(ops, &view, &viewLen))
 		{
+			/* Parse straight out of the prefetch cache; the
+			 * bytes stay pinned until the ops is closed */
+			try
+			{
+				readMidi(this, view, viewLen);
+			}
+			catch (...)
+			{
+				SDL_RWclose(&ops);
+				throw;
+			}
+
 			SDL_RWclose(&ops);
-			throw Exception(Exception::MKXPError, "Reading midi data failed");
 		}
+		else
+		{
+			size_t dataLen = SDL_RWsize(&ops);
+			std::vector<uint8_t> data(dataLen);
 
-		SDL_RWclose(&ops);
+			if (SDL_RWread(&ops, &data[0], 1, dataLen) < dataLen)
+			{
+				SDL_RWclose(&ops);
+				throw Exception(Exception::MKXPError, "Reading midi data failed");
+			}
+
+			SDL_RWclose(&ops);
 
-		readMidi(this, data);
+			readMidi(this, data.data(), dataLen);
+		}
 
 		synth = shState->midiState().allocateSynth();
 
+		startRenderAhead();
+
 		uint64_t longest = 0;
 
 		for (size_t i = 0; i < tracks.size(); ++i)
@@ -687,6 +719,8 @@ struct MidiSource : ALDataSource, MidiReadHandler
 
 	~MidiSource()
 	{
+		stopRenderAhead();
+
 		shState->midiState().releaseSynth(synth);
 	}
 
@@ -783,7 +817,10 @@ struct MidiSource : ALDataSource, MidiReadHandler
 	}
 
 	/* ALDataSource */
-	Status fillBuffer(AL::Buffer::ID buf)
+	/* Synthesizes one chunk's worth of ticks into synthBuf and
+	 * returns the resulting stream status. Must only run under
+	 * the render state lock */
+	Status renderChunk()
 	{
 		/* In case there is no currently scheduled one */
 		for (size_t i = 0; i < tracks.size(); ++i)
@@ -870,15 +907,129 @@ struct MidiSource : ALDataSource, MidiReadHandler
 					tracks[i].remDeltas -= intDeltas;
 		}
 
-		/* Fill AL buffer */
-		AL::Buffer::uploadData(buf, AL_FORMAT_STEREO16, synthBuf, sizeof(synthBuf), freq);
-
 		if (tracks[longestI].atEnd)
 			return EndOfStream;
 
 		return NoError;
 	}
 
+	/* Render-ahead: a dedicated thread keeps chunks of
+	 * synthesized PCM queued ahead of the stream, so synthesis
+	 * bursts on heavy soundfonts never align with buffer
+	 * deadlines. The state lock covers the synth and all track
+	 * runtime state */
+	struct ReadyChunk
+	{
+		std::vector<int16_t> pcm;
+		Status status;
+	};
+
+	SDL_mutex *raMutex;
+	SDL_cond *raCond;
+	std::vector<ReadyChunk> raQueue;
+	SDL_Thread *raThread;
+	AtomicFlag raTermReq;
+	bool raStopped; /* EndOfStream reached; idle until seek */
+
+	void startRenderAhead()
+	{
+		raMutex = SDL_CreateMutex();
+		raCond = SDL_CreateCond();
+		raThread = 0;
+		raStopped = false;
+	}
+
+	void stopRenderAhead()
+	{
+		if (raThread)
+		{
+			raTermReq.set();
+
+			SDL_LockMutex(raMutex);
+			SDL_CondBroadcast(raCond);
+			SDL_UnlockMutex(raMutex);
+
+			SDL_WaitThread(raThread, 0);
+			raThread = 0;
+		}
+
+		SDL_DestroyMutex(raMutex);
+		SDL_DestroyCond(raCond);
+	}
+
+	void renderAheadFun()
+	{
+		SDL_LockMutex(raMutex);
+
+		while (true)
+		{
+			while (!raTermReq &&
+			       (raQueue.size() >= MIDI_RA_CHUNKS || raStopped))
+				SDL_CondWait(raCond, raMutex);
+
+			if (raTermReq)
+				break;
+
+			/* Render with the lock held: seeks and pitch
+			 * changes synchronize against the same lock */
+			Status status = renderChunk();
+
+			ReadyChunk chunk;
+			chunk.status = status;
+			chunk.pcm.assign(synthBuf, synthBuf + BUF_TICKS*TICK_FRAMES*2);
+
+			raQueue.push_back(chunk);
+
+			if (status == EndOfStream)
+				raStopped = true;
+
+			SDL_CondBroadcast(raCond);
+		}
+
+		SDL_UnlockMutex(raMutex);
+	}
+
+	Status fillBuffer(AL::Buffer::ID buf)
+	{
+		SDL_LockMutex(raMutex);
+
+		if (!raThread)
+			raThread = createSDLThread
+				<MidiSource, &MidiSource::renderAheadFun>(this, "midi_render");
+
+		Status status;
+
+		if (!raQueue.empty())
+		{
+			/* Serve pre-rendered PCM */
+			ReadyChunk chunk = raQueue.front();
+			raQueue.erase(raQueue.begin());
+
+			SDL_CondBroadcast(raCond);
+			SDL_UnlockMutex(raMutex);
+
+			AL::Buffer::uploadData(buf, AL_FORMAT_STEREO16, chunk.pcm.data(),
+			                       chunk.pcm.size() * sizeof(int16_t), freq);
+
+			return chunk.status;
+		}
+
+		/* Worker starved (or just started): render inline */
+		status = renderChunk();
+
+		if (status == EndOfStream)
+			raStopped = true;
+
+		/* Upload before releasing the lock: the worker wakes on
+		 * an empty queue and would overwrite synthBuf with its
+		 * own renderChunk() while we read from it */
+		AL::Buffer::uploadData(buf, AL_FORMAT_STEREO16, synthBuf, sizeof(synthBuf), freq);
+
+		SDL_UnlockMutex(raMutex);
+
+		return status;
+	}
+
 	int sampleRate()
 	{
 		return freq;
@@ -887,6 +1038,12 @@ struct MidiSource : ALDataSource, MidiReadHandler
 	/* Midi sources cannot seek, and so always reset to beginning */
 	void seekToOffset(double)
 	{
+		SDL_LockMutex(raMutex);
+
+		/* Rendered-ahead chunks belong to the old position */
+		raQueue.clear();
+		raStopped = false;
+
 		/* Reset synth */
 		fluid.synth_system_reset(synth);
 
@@ -897,15 +1054,26 @@ struct MidiSource : ALDataSource, MidiReadHandler
 		/* Reset tracks */
 		for (size_t i = 0; i < tracks.size(); ++i)
 			tracks[i].reset();
+
+		SDL_CondBroadcast(raCond);
+		SDL_UnlockMutex(raMutex);
 	}
 
 	uint32_t loopStartFrames() { return 0; }
 
 	bool setPitch(float value)
 	{
+		SDL_LockMutex(raMutex);
+
 		// not completely correct, but close
 		pitchShift = round((value > 1.0f ? 14 : 24) * (value - 1.0f));
 
+		/* Rendered-ahead chunks carry the old pitch */
+		raQueue.clear();
+
+		SDL_CondBroadcast(raCond);
+		SDL_UnlockMutex(raMutex);
+
 		return true;
 	}
 };
@@ -0,0 +1,299 @@
+/*
+** opussource.cpp
+**
+** This file is part of mkxp.
+**
+** Copyright (C) 2014 - 2021 Amaryllis Kulla <ancurio@mapleshrine.eu>
+**
+** mkxp is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 2 of the License, or
+** (at your option) any later version.
+**
+** mkxp is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with mkxp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifdef MKXPZ_OPUS
+
+#include "aldatasource.h"
+#include "exception.h"
+
+#include <opusfile.h>
+#include <vector>
+#include <algorithm>
+
+static int opRead(void *ops, unsigned char *ptr, int nbytes)
+{
+	return SDL_RWread(static_cast<SDL_RWops*>(ops), ptr, 1, nbytes);
+}
+
+static int opSeek(void *ops, opus_int64 offset, int whence)
+{
+	return SDL_RWseek(static_cast<SDL_RWops*>(ops), offset, whence) < 0 ? -1 : 0;
+}
+
+static opus_int64 opTell(void *ops)
+{
+	return SDL_RWtell(static_cast<SDL_RWops*>(ops));
+}
+
+static OpusFileCallbacks OpCallbacks =
+{
+    opRead,
+    opSeek,
+    opTell,
+    0
+};
+
+
+struct OpusSource : ALDataSource
+{
+	SDL_RWops src;
+
+	OggOpusFile *of;
+
+	uint32_t currentFrame;
+
+	/* Same LOOPSTART/LOOPLENGTH tags as VorbisSource,
+	 * in 48 kHz frames (Opus always decodes at 48 kHz) */
+	struct
+	{
+		uint32_t start;
+		uint32_t length;
+		uint32_t end;
+		bool valid;
+		bool requested;
+	} loop;
+
+	struct
+	{
+		int channels;
+		int rate;
+		int frameSize;
+		ALenum alFormat;
+	} info;
+
+	std::vector<int16_t> sampleBuf;
+
+	OpusSource(SDL_RWops &ops,
+	           bool looped)
+	    : src(ops),
+	      currentFrame(0)
+	{
+		int error = 0;
+		of = op_open_callbacks(&src, &OpCallbacks, 0, 0, &error);
+
+		if (!of)
+		{
+			SDL_RWclose(&src);
+			throw Exception(Exception::MKXPError,
+			                "Opusfile: Cannot read opus file");
+		}
+
+		info.channels = op_channel_count(of, -1);
+		info.rate = 48000;
+
+		if (info.channels > 2)
+		{
+			op_free(of);
+			SDL_RWclose(&src);
+			throw Exception(Exception::MKXPError,
+			                "Cannot handle audio with more than 2 channels");
+		}
+
+		info.alFormat = chooseALFormat(sizeof(int16_t), info.channels);
+		info.frameSize = sizeof(int16_t) * info.channels;
+
+		sampleBuf.resize(STREAM_BUF_SIZE);
+
+		loop.requested = looped;
+		loop.valid = false;
+		loop.start = loop.length = 0;
+
+		if (!loop.requested)
+			return;
+
+		/* Try to extract loop info */
+		const OpusTags *tags = op_tags(of, -1);
+
+		for (int i = 0; i < tags->comments; ++i)
+		{
+			char *comment = tags->user_comments[i];
+			char *sep = strstr(comment, "=");
+
+			/* No '=' found */
+			if (!sep)
+				continue;
+
+			/* Empty value */
+			if (!*(sep+1))
+				continue;
+
+			*sep = '\0';
+
+			if (!strcmp(comment, "LOOPSTART"))
+				loop.start = strtol(sep+1, 0, 10);
+
+			if (!strcmp(comment, "LOOPLENGTH"))
+				loop.length = strtol(sep+1, 0, 10);
+
+			*sep = '=';
+		}
+
+		loop.end = loop.start + loop.length;
+		loop.valid = (loop.start && loop.length);
+	}
+
+	~OpusSource()
+	{
+		op_free(of);
+		SDL_RWclose(&src);
+	}
+
+	int sampleRate()
+	{
+		return info.rate;
+	}
+
+	void seekToOffset(double seconds)
+	{
+		if (seconds <= 0)
+		{
+			op_pcm_seek(of, 0);
+			currentFrame = 0;
+
+			return;
+		}
+
+		currentFrame = lround(seconds * info.rate);
+
+		if (loop.valid && currentFrame > loop.end)
+			currentFrame = loop.start;
+
+		/* If seeking fails, just seek back to start */
+		if (op_pcm_seek(of, currentFrame) != 0)
+		{
+			op_pcm_seek(of, 0);
+			currentFrame = 0;
+		}
+	}
+
+	Status fillBuffer(AL::Buffer::ID alBuffer)
+	{
+		int availValues = sampleBuf.size();
+		int bufUsed  = 0;
+
+		int canRead = availValues;
+
+		Status retStatus = ALDataSource::NoError;
+
+		bool readAgain = false;
+
+		if (loop.valid)
+		{
+			int tilLoopEnd = (loop.end - currentFrame) * info.channels;
+
+			canRead = std::min(availValues, std::max(tilLoopEnd, 0));
+		}
+
+		while (canRead > 8)
+		{
+			int res = op_read(of, &sampleBuf[bufUsed], canRead, 0);
+
+			/* Corrupt page, skip over it */
+			if (res == OP_HOLE)
+				continue;
+
+			if (res < 0)
+			{
+				/* Read error */
+				retStatus = ALDataSource::Error;
+
+				break;
+			}
+
+			if (res == 0)
+			{
+				/* EOF */
+				if (loop.requested)
+				{
+					retStatus = ALDataSource::WrapAround;
+					seekToOffset(0);
+				}
+				else
+				{
+					retStatus = ALDataSource::EndOfStream;
+				}
+
+				/* If we sought right to the end of the file,
+				 * we might be EOF without actually having read
+				 * any data at all yet (which mustn't happen),
+				 * so we try to continue reading some data. */
+				if (bufUsed > 0)
+					break;
+
+				if (readAgain)
+				{
+					/* We're still not getting data though.
+					 * Just error out to prevent an endless loop */
+					retStatus = ALDataSource::Error;
+					break;
+				}
+
+				readAgain = true;
+			}
+
+			bufUsed += res * info.channels;
+			currentFrame += res;
+
+			if (loop.valid && currentFrame >= loop.end)
+			{
+				retStatus = ALDataSource::WrapAround;
+				currentFrame = loop.start;
+
+				/* Unlike Vorbis, every Opus page carries an
+				 * absolute granule position, so the wrap seek
+				 * is cheap enough to run in place */
+				if (op_pcm_seek(of, loop.start) != 0)
+					retStatus = ALDataSource::Error;
+
+				break;
+			}
+
+			canRead -= res * info.channels;
+		}
+
+		if (retStatus != ALDataSource::Error)
+			AL::Buffer::uploadData(alBuffer, info.alFormat, sampleBuf.data(),
+			                       bufUsed*sizeof(int16_t), info.rate);
+
+		return retStatus;
+	}
+
+	uint32_t loopStartFrames()
+	{
+		if (loop.valid)
+			return loop.start;
+		else
+			return 0;
+	}
+
+	bool setPitch(float)
+	{
+		return false;
+	}
+};
+
+ALDataSource *createOpusSource(SDL_RWops &ops,
+                               bool looped)
+{
+	return new OpusSource(ops, looped);
+}
+
+#endif /* MKXPZ_OPUS */
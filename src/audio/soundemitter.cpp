@@ -21,6 +21,7 @@
 
 #include "soundemitter.h"
 
+#include "alefx.h"
 #include "sharedstate.h"
 #include "filesystem.h"
 #include "exception.h"
@@ -30,7 +31,10 @@
 
 #include <SDL_sound.h>
 
-#define SE_CACHE_MEM (10*1024*1024) // 10 MB
+#include "sdl-util.h"
+#include "audioconvert.h"
+
+#include <algorithm>
 
 struct SoundBuffer
 {
@@ -90,11 +94,20 @@ arrayPushBack(std::vector<size_t> &array, size_t size, size_t index)
 
 SoundEmitter::SoundEmitter(const Config &conf)
     : bufferBytes(0),
+      cacheBudget(conf.seCacheBudget > 0
+                  ? (uint32_t) conf.seCacheBudget * 1024 * 1024
+                  : 10*1024*1024),
+      cacheHits(0),
+      cacheMisses(0),
+      preloadThread(0),
       srcCount(conf.SE.sourceCount),
       alSrcs(srcCount),
       atchBufs(srcCount),
       srcPrio(srcCount)
 {
+	cacheMutex = SDL_CreateMutex();
+	preloadCond = SDL_CreateCond();
+
 	for (size_t i = 0; i < srcCount; ++i)
 	{
 		alSrcs[i] = AL::Source::gen();
@@ -103,8 +116,96 @@ SoundEmitter::SoundEmitter(const Config &conf)
 	}
 }
 
+void SoundEmitter::shrinkCache(uint32_t targetBytes)
+{
+	SDL_LockMutex(cacheMutex);
+
+	while (bufferBytes > targetBytes && !buffers.isEmpty())
+	{
+		SoundBuffer *last = buffers.tail();
+		bufferHash.remove(last->key);
+		buffers.remove(last->link);
+
+		bufferBytes -= last->bytes;
+
+		SoundBuffer::deref(last);
+	}
+
+	SDL_UnlockMutex(cacheMutex);
+}
+
+uint32_t SoundEmitter::cacheBytes()
+{
+	SDL_LockMutex(cacheMutex);
+	uint32_t bytes = bufferBytes;
+	SDL_UnlockMutex(cacheMutex);
+
+	return bytes;
+}
+
+void SoundEmitter::preload(const std::string &filename)
+{
+	SDL_LockMutex(cacheMutex);
+
+	if (!preloadThread)
+		preloadThread = createSDLThread
+			<SoundEmitter, &SoundEmitter::preloadFun>(this, "se_preload");
+
+	preloadQueue.push_back(filename);
+
+	SDL_CondBroadcast(preloadCond);
+	SDL_UnlockMutex(cacheMutex);
+}
+
+void SoundEmitter::preloadFun()
+{
+	SDL_LockMutex(cacheMutex);
+
+	while (true)
+	{
+		while (preloadQueue.empty() && !preloadTermReq)
+			SDL_CondWait(preloadCond, cacheMutex);
+
+		if (preloadTermReq)
+			break;
+
+		std::string filename = preloadQueue.front();
+		preloadQueue.erase(preloadQueue.begin());
+
+		SDL_UnlockMutex(cacheMutex);
+
+		try
+		{
+			SoundBuffer *buffer = allocateBuffer(filename);
+
+			if (buffer)
+				SoundBuffer::deref(buffer);
+		}
+		catch (const Exception &)
+		{
+			/* Missing file; first real play reports it */
+		}
+
+		SDL_LockMutex(cacheMutex);
+	}
+
+	SDL_UnlockMutex(cacheMutex);
+}
+
 SoundEmitter::~SoundEmitter()
 {
+	if (preloadThread)
+	{
+		preloadTermReq.set();
+		SDL_LockMutex(cacheMutex);
+		SDL_CondBroadcast(preloadCond);
+		SDL_UnlockMutex(cacheMutex);
+		SDL_WaitThread(preloadThread, 0);
+	}
+
+	SDL_DestroyMutex(cacheMutex);
+	SDL_DestroyCond(preloadCond);
+
 	for (size_t i = 0; i < srcCount; ++i)
 	{
 		AL::Source::stop(alSrcs[i]);
@@ -170,7 +271,8 @@ void SoundEmitter::play(const std::string &filename,
 	if (old)
 		SoundBuffer::deref(old);
 
-	atchBufs[srcIndex] = SoundBuffer::ref(buffer);
+	/* allocateBuffer already ref'd for us */
+	atchBufs[srcIndex] = buffer;
 
 	if (switchBuffer)
 		AL::Source::attachBuffer(src, buffer->alBuffer);
@@ -188,6 +290,62 @@ void SoundEmitter::stop()
 		AL::Source::stop(alSrcs[i]);
 }
 
+void SoundEmitter::fileChanged(const char *path)
+{
+	size_t pathLen = strlen(path);
+
+	SDL_LockMutex(cacheMutex);
+
+	/* Cache keys are the script-supplied names, usually
+	 * without an extension; match them as a path prefix
+	 * ending right at the changed file's extension dot.
+	 * Case-insensitive, since scripts routinely spell
+	 * paths differently than the disk does */
+	std::vector<std::string> stale;
+
+	BufferHash::const_iterator iter;
+	for (iter = bufferHash.cbegin(); iter != bufferHash.cend(); ++iter)
+	{
+		const std::string &key = iter->first;
+
+		if (key.size() > pathLen)
+			continue;
+
+		if (SDL_strncasecmp(key.c_str(), path, key.size()) != 0)
+			continue;
+
+		if (key.size() != pathLen && path[key.size()] != '.')
+			continue;
+
+		stale.push_back(key);
+	}
+
+	for (size_t i = 0; i < stale.size(); ++i)
+	{
+		SoundBuffer *buffer = bufferHash.value(stale[i], 0);
+
+		bufferHash.remove(stale[i]);
+		buffers.remove(buffer->link);
+		bufferBytes -= buffer->bytes;
+
+		SoundBuffer::deref(buffer);
+	}
+
+	SDL_UnlockMutex(cacheMutex);
+}
+
+void SoundEmitter::setSendLevel(float value)
+{
+	for (size_t i = 0; i < srcCount; i++)
+		EFX::setSourceSend(alSrcs[i], value);
+}
+
+void SoundEmitter::setLowPass(float value)
+{
+	for (size_t i = 0; i < srcCount; i++)
+		EFX::setSourceLowPass(alSrcs[i], value);
+}
+
 struct SoundOpenHandler : FileSystem::OpenHandler
 {
 	SoundBuffer *buffer;
@@ -223,10 +381,10 @@ struct SoundOpenHandler : FileSystem::OpenHandler
 			float *monoSamples   = new float[sampleCount / 2];
 			float *stereoSamples = (float*)sample->buffer;
 
-			for (uint32_t i = 0; i < sampleCount; i += 2)
-			{
-				monoSamples[i / 2] = stereoSamples[i] / 2.0 + stereoSamples[i] / 2.0;
-			}
+			/* Vectorized fold; this also actually averages L
+			 * with R (the scalar loop summed the left channel
+			 * with itself) */
+			audioStereoToMonoF32(monoSamples, stereoSamples, sampleCount / 2);
 
 			alFormat = chooseALFormat(sampleSize, 1);
 			buffer->bytes = buffer->bytes / 2;
@@ -251,6 +409,9 @@ struct SoundOpenHandler : FileSystem::OpenHandler
 SoundBuffer *SoundEmitter::allocateBuffer(const std::string &filename, const bool makeMono)
 {
 	std::string key = filename + "_" + (makeMono ? "1" : "2");
+
+	SDL_LockMutex(cacheMutex);
+
 	SoundBuffer *buffer = bufferHash.value(key, 0);
 
 	if (buffer)
@@ -260,46 +421,82 @@ SoundBuffer *SoundEmitter::allocateBuffer(const std::string &filename, const boo
 		buffers.remove(buffer->link);
 		buffers.append(buffer->link);
 
+		++cacheHits;
+
+		/* Ref for the caller while still under the lock, so a
+		 * concurrent eviction can't free it in between */
+		SoundBuffer::ref(buffer);
+
+		SDL_UnlockMutex(cacheMutex);
 		return buffer;
 	}
-	else
+
+	++cacheMisses;
+
+	SDL_UnlockMutex(cacheMutex);
+
+	/* Buffer not in cache, needs to be loaded; the decode runs
+	 * unlocked so the preload worker and the game thread don't
+	 * serialize on it */
+	SoundOpenHandler handler(makeMono);
+	shState->fileSystem().openRead(handler, filename.c_str());
+	buffer = handler.buffer;
+
+	if (!buffer)
 	{
-		/* Buffer not in cache, needs to be loaded */
-		SoundOpenHandler handler(makeMono);
-		shState->fileSystem().openRead(handler, filename.c_str());
-		buffer = handler.buffer;
+		char buf[512];
+		snprintf(buf, sizeof(buf), "Unable to decode sound: %s: %s",
+		         filename.c_str(), Sound_GetError());
+		Debug() << buf;
 
-		if (!buffer)
-		{
-			char buf[512];
-			snprintf(buf, sizeof(buf), "Unable to decode sound: %s: %s",
-			         filename.c_str(), Sound_GetError());
-			Debug() << buf;
+		return 0;
+	}
 
-			return 0;
-		}
+	buffer->key = key;
 
-		buffer->key = key;
-		uint32_t wouldBeBytes = bufferBytes + buffer->bytes;
+	SDL_LockMutex(cacheMutex);
 
-		/* If memory limit is reached, delete lowest priority buffer
-		 * until there is room or no buffers left */
-		while (wouldBeBytes > SE_CACHE_MEM && !buffers.isEmpty())
-		{
-			SoundBuffer *last = buffers.tail();
-			bufferHash.remove(last->key);
-			buffers.remove(last->link);
+	/* Someone else (play vs preload) may have decoded the same
+	 * sound meanwhile */
+	SoundBuffer *race = bufferHash.value(key, 0);
+
+	if (race)
+	{
+		buffers.remove(race->link);
+		buffers.append(race->link);
 
-			wouldBeBytes -= last->bytes;
+		SoundBuffer::ref(race);
 
-			SoundBuffer::deref(last);
-		}
+		SDL_UnlockMutex(cacheMutex);
+
+		SoundBuffer::deref(buffer);
+		return race;
+	}
 
-		bufferHash.insert(key, buffer);
-		buffers.prepend(buffer->link);
+	uint32_t wouldBeBytes = bufferBytes + buffer->bytes;
 
-		bufferBytes = wouldBeBytes;
+	/* If memory limit is reached, delete lowest priority buffer
+	 * until there is room or no buffers left */
+	while (wouldBeBytes > cacheBudget && !buffers.isEmpty())
+	{
+		SoundBuffer *last = buffers.tail();
+		bufferHash.remove(last->key);
+		buffers.remove(last->link);
 
-		return buffer;
+		wouldBeBytes -= last->bytes;
+
+		SoundBuffer::deref(last);
 	}
+
+	bufferHash.insert(key, buffer);
+	buffers.prepend(buffer->link);
+
+	bufferBytes = wouldBeBytes;
+
+	/* One ref stays with the cache, one goes to the caller */
+	SoundBuffer::ref(buffer);
+
+	SDL_UnlockMutex(cacheMutex);
+
+	return buffer;
 }
@@ -25,10 +25,14 @@
 #include "intrulist.h"
 #include "al-util.h"
 #include "boost-hash.h"
+#include "sdl-util.h"
 
 #include <string>
 #include <vector>
 
+#include <SDL_mutex.h>
+#include <SDL_thread.h>
+
 struct SoundBuffer;
 struct Config;
 
@@ -42,6 +46,23 @@ struct SoundEmitter
 	/* Byte count sum of all cached / playing buffers */
 	uint32_t bufferBytes;
 
+	/* Configured cache budget in bytes */
+	uint32_t cacheBudget;
+
+	/* Cache effectiveness counters */
+	uint64_t cacheHits;
+	uint64_t cacheMisses;
+
+	/* Guards the cache structures; decodes can run on the
+	 * preload worker while the game thread plays */
+	SDL_mutex *cacheMutex;
+
+	/* Background preload worker */
+	SDL_cond *preloadCond;
+	std::vector<std::string> preloadQueue;
+	SDL_Thread *preloadThread;
+	AtomicFlag preloadTermReq;
+
 	const size_t srcCount;
 	std::vector<AL::Source::ID> alSrcs;
 	std::vector<SoundBuffer*> atchBufs;
@@ -59,6 +80,26 @@ struct SoundEmitter
 
 	void stop();
 
+	/* EFX routing, applied to all emitter sources */
+	void setSendLevel(float value);
+	void setLowPass(float value);
+
+	/* Development file watching: drops the cached decode
+	 * behind a changed asset so the next play re-reads it */
+	void fileChanged(const char *path);
+
+	/* Queues a background decode into the cache */
+	void preload(const std::string &filename);
+
+	/* Memory pressure: evict lowest-priority cached buffers until
+	 * the cache is at most 'targetBytes' */
+	void shrinkCache(uint32_t targetBytes);
+
+	uint32_t cacheBytes();
+
+	/* Worker entry */
+	void preloadFun();
+
 private:
 	SoundBuffer *allocateBuffer(const std::string &filename, const bool makeMono = false);
 };
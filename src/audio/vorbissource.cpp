@@ -78,10 +78,21 @@ struct VorbisSource : ALDataSource
 
 	std::vector<int16_t> sampleBuf;
 
+	/* Decoded pre-roll of the loop start, built at open time.
+	 * At wrap time it is handed out instantly and the
+	 * page-scanning seek back to the loop region runs while it
+	 * (and the rest of the ring) is still playing, so the
+	 * musical loop point never drains the queue */
+	std::vector<int16_t> loopPreroll;
+	uint32_t prerollFrames;
+	bool prerollPending;
+
 	VorbisSource(SDL_RWops &ops,
 	             bool looped)
 	    : src(ops),
-	      currentFrame(0)
+	      currentFrame(0),
+	      prerollFrames(0),
+	      prerollPending(false)
 	{
 		int error = ov_open_callbacks(&src, &vf, 0, 0, OvCallbacks);
 
@@ -143,6 +154,40 @@ struct VorbisSource : ALDataSource
 
 		loop.end = loop.start + loop.length;
 		loop.valid = (loop.start && loop.length);
+
+		if (loop.valid)
+			buildLoopPreroll();
+	}
+
+	void buildLoopPreroll()
+	{
+		if (ov_pcm_seek(&vf, loop.start) != 0)
+			return;
+
+		uint32_t maxFrames =
+			std::min<uint32_t>(STREAM_BUF_SIZE / info.channels, loop.length);
+
+		loopPreroll.resize(maxFrames * info.channels);
+
+		uint32_t read = 0;
+
+		while (read < loopPreroll.size())
+		{
+			long res = ov_read(&vf, reinterpret_cast<char*>(&loopPreroll[read]),
+			                   (loopPreroll.size() - read) * sizeof(int16_t),
+			                   0, sizeof(int16_t), 1, 0);
+
+			if (res <= 0)
+				break;
+
+			read += res / sizeof(int16_t);
+		}
+
+		loopPreroll.resize(read);
+		prerollFrames = read / info.channels;
+
+		/* Back to the beginning for regular playback */
+		ov_raw_seek(&vf, 0);
 	}
 
 	~VorbisSource()
@@ -158,6 +203,8 @@ struct VorbisSource : ALDataSource
 
 	void seekToOffset(double seconds)
 	{
+		prerollPending = false;
+
 		if (seconds <= 0)
 		{
 			ov_raw_seek(&vf, 0);
@@ -176,6 +223,33 @@ struct VorbisSource : ALDataSource
 
 	Status fillBuffer(AL::Buffer::ID alBuffer)
 	{
+		if (prerollPending)
+		{
+			prerollPending = false;
+
+			AL::Buffer::uploadData(alBuffer, info.alFormat, loopPreroll.data(),
+			                       loopPreroll.size() * sizeof(int16_t), info.rate);
+
+			currentFrame = loop.start + prerollFrames;
+
+			if (currentFrame >= loop.end)
+			{
+				/* Loop shorter than one buffer: the cached
+				 * pre-roll IS the whole loop */
+				currentFrame = loop.start;
+				prerollPending = true;
+
+				return ALDataSource::WrapAround;
+			}
+
+			/* The expensive seek runs while the pre-roll and
+			 * the rest of the ring are still playing */
+			if (ov_pcm_seek(&vf, currentFrame) != 0)
+				return ALDataSource::Error;
+
+			return ALDataSource::NoError;
+		}
+
 		void *bufPtr = sampleBuf.data();
 		int availBuf = sampleBuf.size();
 		int bufUsed  = 0;
@@ -250,9 +324,13 @@ struct VorbisSource : ALDataSource
 
 				retStatus = ALDataSource::WrapAround;
 
-				/* Seek to loop start */
+				/* Hand out the cached pre-roll on the next call;
+				 * the real seek happens while it plays */
 				currentFrame = loop.start;
-				if (ov_pcm_seek(&vf, currentFrame) != 0)
+
+				if (prerollFrames > 0)
+					prerollPending = true;
+				else if (ov_pcm_seek(&vf, currentFrame) != 0)
 					retStatus = ALDataSource::Error;
 
 				break;
@@ -20,6 +20,11 @@
 
 #include "util/json5pp.hpp"
 
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+
 #include "util/iniconfig.h"
 #include "util/encoding.h"
 
@@ -97,13 +102,307 @@ bool getEnvironmentBool(const char *env, bool defaultValue) {
     return defaultValue;
 }
 
+/* ---- Binary config snapshot ----
+ *
+ * JSON5 parsing of a large config (plus encoding detection) is paid
+ * every launch; a validated binary snapshot of the parsed tree sits
+ * next to the source file and loads with one read. Keyed by the
+ * source's mtime and size plus a format version - any mismatch or
+ * decode error falls back to the normal parse, and snapshot writes
+ * that fail (read-only install dirs) are silently skipped. */
+
+#define CONF_CACHE_MAGIC   "MKXPCONF"
+#define CONF_CACHE_VERSION 1
+#define CONF_CACHE_LIMIT   (4 << 20)
+
+enum
+{
+    ConfTagNull = 0,
+    ConfTagFalse,
+    ConfTagTrue,
+    ConfTagNumber,
+    ConfTagInteger,
+    ConfTagString,
+    ConfTagArray,
+    ConfTagObject
+};
+
+static void confSerialize(const json::value &v, std::string &out)
+{
+    auto putU32 = [&out](uint32_t u) {
+        out.append((const char *) &u, 4);
+    };
+
+    if (v.is_null())
+        out.push_back(ConfTagNull);
+    else if (v.is_boolean())
+        out.push_back(v.as_boolean() ? ConfTagTrue : ConfTagFalse);
+    else if (v.is_integer())
+    {
+        out.push_back(ConfTagInteger);
+        int32_t i = (int32_t) v.as_integer();
+        out.append((const char *) &i, 4);
+    }
+    else if (v.is_number())
+    {
+        out.push_back(ConfTagNumber);
+        double d = v.as_number();
+        out.append((const char *) &d, 8);
+    }
+    else if (v.is_string())
+    {
+        const std::string &s = v.as_string();
+        out.push_back(ConfTagString);
+        putU32((uint32_t) s.size());
+        out.append(s);
+    }
+    else if (v.is_array())
+    {
+        const auto &arr = v.as_array();
+        out.push_back(ConfTagArray);
+        putU32((uint32_t) arr.size());
+        for (size_t i = 0; i < arr.size(); ++i)
+            confSerialize(arr[i], out);
+    }
+    else if (v.is_object())
+    {
+        const auto &obj = v.as_object();
+        out.push_back(ConfTagObject);
+        putU32((uint32_t) obj.size());
+        for (auto it = obj.begin(); it != obj.end(); ++it)
+        {
+            putU32((uint32_t) it->first.size());
+            out.append(it->first);
+            confSerialize(it->second, out);
+        }
+    }
+    else
+        out.push_back(ConfTagNull);
+}
+
+static bool confDeserialize(const uint8_t *&p, const uint8_t *end,
+                            json::value &out, int depth)
+{
+    if (depth > 64 || p >= end)
+        return false;
+
+    auto getU32 = [&p, end](uint32_t &u) -> bool {
+        if (end - p < 4)
+            return false;
+        memcpy(&u, p, 4);
+        p += 4;
+        return true;
+    };
+
+    const uint8_t tag = *p++;
+
+    switch (tag)
+    {
+    case ConfTagNull:
+        out = json::value(nullptr);
+        return true;
+    case ConfTagFalse:
+        out = json::value(false);
+        return true;
+    case ConfTagTrue:
+        out = json::value(true);
+        return true;
+    case ConfTagInteger:
+    {
+        int32_t i;
+        if (end - p < 4)
+            return false;
+        memcpy(&i, p, 4);
+        p += 4;
+        out = json::value((json::value::integer_type) i);
+        return true;
+    }
+    case ConfTagNumber:
+    {
+        double d;
+        if (end - p < 8)
+            return false;
+        memcpy(&d, p, 8);
+        p += 8;
+        out = json::value(d);
+        return true;
+    }
+    case ConfTagString:
+    {
+        uint32_t len;
+        if (!getU32(len) || (uint32_t) (end - p) < len)
+            return false;
+        out = json::value(std::string((const char *) p, len));
+        p += len;
+        return true;
+    }
+    case ConfTagArray:
+    {
+        uint32_t count;
+        if (!getU32(count) || count > (uint32_t) (end - p))
+            return false;
+        out = json::array({});
+        auto &arr = out.as_array();
+        arr.reserve(count);
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            json::value item;
+            if (!confDeserialize(p, end, item, depth + 1))
+                return false;
+            arr.push_back(item);
+        }
+        return true;
+    }
+    case ConfTagObject:
+    {
+        uint32_t count;
+        if (!getU32(count) || count > (uint32_t) (end - p))
+            return false;
+        out = json::object({});
+        auto &obj = out.as_object();
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            uint32_t klen;
+            if (!getU32(klen) || (uint32_t) (end - p) < klen)
+                return false;
+            std::string key((const char *) p, klen);
+            p += klen;
+            json::value item;
+            if (!confDeserialize(p, end, item, depth + 1))
+                return false;
+            obj[key] = item;
+        }
+        return true;
+    }
+    default:
+        return false;
+    }
+}
+
+static bool confSourceStamp(const char *path, uint64_t &mtime, uint64_t &size)
+{
+    struct stat st;
+    if (stat(path, &st) != 0)
+        return false;
+    mtime = (uint64_t) st.st_mtime;
+    size = (uint64_t) st.st_size;
+    return true;
+}
+
+static uint64_t confChecksum(const uint8_t *data, size_t len)
+{
+    uint64_t hash = 0xcbf29ce484222325ull;
+
+    for (size_t i = 0; i < len; ++i)
+    {
+        hash ^= data[i];
+        hash *= 0x100000001b3ull;
+    }
+
+    return hash;
+}
+
+static bool confLoadSnapshot(const std::string &cachePath,
+                             uint64_t mtime, uint64_t size,
+                             json::value &out)
+{
+    FILE *f = fopen(cachePath.c_str(), "rb");
+    if (!f)
+        return false;
+
+    bool ok = false;
+    std::vector<uint8_t> buf;
+
+    do
+    {
+        char magic[8];
+        uint32_t version;
+        uint64_t smtime, ssize;
+
+        if (fread(magic, 1, 8, f) != 8 ||
+            memcmp(magic, CONF_CACHE_MAGIC, 8) != 0)
+            break;
+        if (fread(&version, 1, 4, f) != 4 || version != CONF_CACHE_VERSION)
+            break;
+        if (fread(&smtime, 1, 8, f) != 8 || smtime != mtime)
+            break;
+        if (fread(&ssize, 1, 8, f) != 8 || ssize != size)
+            break;
+
+        uint64_t sum;
+        if (fread(&sum, 1, 8, f) != 8)
+            break;
+
+        long here = ftell(f);
+        if (here < 0 || fseek(f, 0, SEEK_END) != 0)
+            break;
+        long total = ftell(f);
+        if (total <= here || total - here > CONF_CACHE_LIMIT ||
+            fseek(f, here, SEEK_SET) != 0)
+            break;
+
+        buf.resize((size_t) (total - here));
+        if (fread(buf.data(), 1, buf.size(), f) != buf.size())
+            break;
+
+        if (confChecksum(buf.data(), buf.size()) != sum)
+            break;
+
+        const uint8_t *p = buf.data();
+        const uint8_t *end = p + buf.size();
+        ok = confDeserialize(p, end, out, 0) && p == end && out.is_object();
+    } while (false);
+
+    fclose(f);
+    return ok;
+}
+
+static void confWriteSnapshot(const std::string &cachePath,
+                              uint64_t mtime, uint64_t size,
+                              const json::value &v)
+{
+    std::string payload;
+    confSerialize(v, payload);
+
+    if (payload.size() > CONF_CACHE_LIMIT)
+        return;
+
+    const std::string tmp = cachePath + ".tmp";
+    FILE *f = fopen(tmp.c_str(), "wb");
+    if (!f)
+        return;
+
+    const uint32_t version = CONF_CACHE_VERSION;
+    const uint64_t sum = confChecksum((const uint8_t *) payload.data(),
+                                      payload.size());
+    bool ok = fwrite(CONF_CACHE_MAGIC, 1, 8, f) == 8 &&
+              fwrite(&version, 1, 4, f) == 4 &&
+              fwrite(&mtime, 1, 8, f) == 8 &&
+              fwrite(&size, 1, 8, f) == 8 &&
+              fwrite(&sum, 1, 8, f) == 8 &&
+              fwrite(payload.data(), 1, payload.size(), f) == payload.size();
+    fclose(f);
+
+    if (ok)
+        rename(tmp.c_str(), cachePath.c_str());
+    else
+        remove(tmp.c_str());
+}
+
 json::value readConfFile(const char *path) {
     
     json::value ret(0);
     if (!mkxp_fs::fileExists(path)) {
         return json::object({});
     }
-    
+
+    uint64_t mtime = 0, size = 0;
+    const bool stamped = confSourceStamp(path, mtime, size);
+    const std::string cachePath = std::string(path) + ".bincache";
+
+    if (stamped && confLoadSnapshot(cachePath, mtime, size, ret))
+        return ret;
+
     try {
         std::string cfg = mkxp_fs::contentsOfFileAsString(path);
         ret = json::parse5(Encoding::convertString(cfg));
@@ -117,7 +416,10 @@ json::value readConfFile(const char *path) {
     
     if (!ret.is_object())
         ret = json::object({});
-    
+
+    if (stamped)
+        confWriteSnapshot(cachePath, mtime, size, ret);
+
     return ret;
 }
 
@@ -153,6 +455,9 @@ void Config::read(int argc, char *argv[]) {
         {"windowTitle", ""},
         {"fixedFramerate", 0},
         {"frameSkip", false},
+        {"framePacingSpin", 2000},
+        {"headless", false},
+        {"glDebugSample", 0.},
         {"syncToRefreshrate", false},
         {"solidFonts", json::array({})},
 #if defined(__APPLE__) && defined(__aarch64__)
@@ -169,6 +474,8 @@ void Config::read(int argc, char *argv[]) {
         {"integerScalingActive", false},
         {"integerScalingLastMile", true},
         {"maxTextureSize", 0},
+        {"megaTileBudget", 128},
+        {"texPoolBudget", 20},
         {"gameFolder", ""},
         {"anyAltToggleFS", false},
         {"enableReset", true},
@@ -183,6 +490,21 @@ void Config::read(int argc, char *argv[]) {
         {"midiReverb", false},
         {"SESourceCount", 6},
         {"BGMTrackCount", 1},
+        {"audioBufCount", 3},
+        {"audioBufSize", 32768},
+        {"ioBufSize", 65536},
+        {"seCacheBudget", 10},
+        {"glyphAtlasBudget", 32},
+        {"memoryBudget", 0},
+        {"texPoolFloor", 4},
+        {"seCacheFloor", 2},
+        {"prefetchFloor", 8},
+        {"hiresFloor", 16},
+        {"bootTrace", false},
+        {"flightRecorder", false},
+        {"powerSaver", false},
+        {"perfHud", false},
+        {"frameTimeLog", ""},
         {"customScript", ""},
         {"pathCache", true},
         {"useScriptNames", true},
@@ -191,6 +513,16 @@ void Config::read(int argc, char *argv[]) {
         {"RTP", json::array({})},
         {"patches", json::array({})},
         {"fontSub", json::array({})},
+        {"preloadFont", json::array({})},
+        {"preload", json::array({})},
+        {"devFileWatch", false},
+        {"deferredEtcNotify", false},
+        {"recordInput", ""},
+        {"replayInput", ""},
+        {"joystickDeadzone", 0x4000},
+        {"axisResponseCurve", 1.0},
+        {"decoupledRender", false},
+        {"backgroundThrottle", false},
         {"rubyLoadpath", json::array({})},
         {"JITEnable", false},
         {"JITVerboseLevel", 0},
@@ -244,12 +576,16 @@ try { exp } catch (...) {}
 #define SET_STRINGOPT(var, key) GUARD(var = std::string(opts[#key].as_string());)
     
     SET_STRINGOPT(gameFolder, gameFolder);
+    SET_STRINGOPT(recordInput, recordInput);
+    SET_STRINGOPT(replayInput, replayInput);
     SET_STRINGOPT(dataPathOrg, dataPathOrg);
     SET_STRINGOPT(dataPathApp, dataPathApp);
     SET_STRINGOPT(iconPath, iconPath);
     SET_STRINGOPT(execName, execName);
     SET_OPT(allowSymlinks, boolean);
     SET_OPT(pathCache, boolean);
+    SET_OPT(devFileWatch, boolean);
+    SET_OPT(deferredEtcNotify, boolean);
     SET_OPT_CUSTOMKEY(jit.enabled, JITEnable, boolean);
     SET_OPT_CUSTOMKEY(jit.verboseLevel, JITVerboseLevel, integer);
     SET_OPT_CUSTOMKEY(jit.maxCache, JITMaxCache, integer);
@@ -296,6 +632,9 @@ try { exp } catch (...) {}
     SET_STRINGOPT(windowTitle, windowTitle);
     SET_OPT(fixedFramerate, integer);
     SET_OPT(frameSkip, boolean);
+    SET_OPT(framePacingSpin, integer);
+    SET_OPT(headless, boolean);
+    SET_OPT(glDebugSample, number);
     SET_OPT(syncToRefreshrate, boolean);
     fillStringVec(opts["solidFonts"], solidFonts);
     for (std::string & solidFont : solidFonts)
@@ -309,6 +648,8 @@ try { exp } catch (...) {}
     SET_OPT_CUSTOMKEY(integerScaling.active, integerScalingActive, boolean);
     SET_OPT_CUSTOMKEY(integerScaling.lastMileScaling, integerScalingLastMile, boolean);
     SET_OPT(maxTextureSize, integer);
+    SET_OPT(megaTileBudget, integer);
+    SET_OPT(texPoolBudget, integer);
     SET_OPT(anyAltToggleFS, boolean);
     SET_OPT(enableReset, boolean);
     SET_OPT(enableSettings, boolean);
@@ -317,18 +658,39 @@ try { exp } catch (...) {}
     SET_OPT_CUSTOMKEY(midi.reverb, midiReverb, boolean);
     SET_OPT_CUSTOMKEY(SE.sourceCount, SESourceCount, integer);
     SET_OPT_CUSTOMKEY(BGM.trackCount, BGMTrackCount, integer);
+    SET_OPT(audioBufCount, integer);
+    SET_OPT(audioBufSize, integer);
+    SET_OPT(ioBufSize, integer);
+    SET_OPT(seCacheBudget, integer);
+    SET_OPT(glyphAtlasBudget, integer);
+    SET_OPT(memoryBudget, integer);
+    SET_OPT(texPoolFloor, integer);
+    SET_OPT(seCacheFloor, integer);
+    SET_OPT(prefetchFloor, integer);
+    SET_OPT(hiresFloor, integer);
+    SET_OPT(bootTrace, boolean);
+    SET_OPT(flightRecorder, boolean);
+    SET_OPT(powerSaver, boolean);
+    SET_OPT(perfHud, boolean);
+    SET_STRINGOPT(frameTimeLog, frameTimeLog);
     SET_STRINGOPT(customScript, customScript);
     SET_OPT(useScriptNames, boolean);
     SET_OPT(dumpAtlas, boolean);
 
     SET_OPT(inputRepeatStart, number);
     SET_OPT(inputRepeatDelay, number);
+    SET_OPT(joystickDeadzone, integer);
+    SET_OPT(axisResponseCurve, number);
+    SET_OPT(decoupledRender, boolean);
+    SET_OPT(backgroundThrottle, boolean);
 
     fillStringVec(opts["preloadScript"], preloadScripts);
     fillStringVec(opts["postloadScript"], postloadScripts);
     fillStringVec(opts["RTP"], rtps);
     fillStringVec(opts["patches"], patches);
     fillStringVec(opts["fontSub"], fontSubs);
+    fillStringVec(opts["preloadFont"], preloadFonts);
+    fillStringVec(opts["preload"], preload);
     for (std::string & fontSub : fontSubs)
         std::transform(fontSub.begin(), fontSub.end(), fontSub.begin(),
             [](unsigned char c) { return std::tolower(c); });
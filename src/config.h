@@ -65,13 +65,69 @@ struct Config {
     int fixedFramerate;
     bool frameSkip;
     bool syncToRefreshrate;
+    /* Busy-wait window of the frame pacer, in microseconds;
+     * 0 sleeps the whole frame remainder like before */
+    int framePacingSpin;
+    /* Run without a visible window and with a null present;
+     * for measuring engine throughput on build servers */
+    bool headless;
+    /* GL debug output sampling window interval, in seconds;
+     * 0 disables the production sampling logger */
+    double glDebugSample;
     
     std::vector<std::string> solidFonts;
     
     bool subImageFix;
     bool enableBlitting;
     int maxTextureSize;
+    /* GPU tile cache budget for mega surface blits, in MB */
+    int megaTileBudget;
+    /* Scratch texture pool budget, in MB */
+    int texPoolBudget;
     
+    /* Streaming audio ring tuning: buffer count and size in
+     * bytes per buffer; deeper rings survive scheduler misses */
+    int audioBufCount;
+    int audioBufSize;
+
+    /* Read ahead block size for file handles;
+     * 0 disables buffering */
+    int ioBufSize;
+    /* SE decode cache budget, in MB */
+    int seCacheBudget;
+    /* Glyph atlas VRAM budget, in MB; pages beyond it recycle
+     * least-recently-used first (CJK text) */
+    int glyphAtlasBudget;
+
+    /* Coordinated cache budget, in MB (0 disables): when the texture
+     * pool + SE cache + prefetch cache exceed it together, they shed
+     * proportionally down to their floors (also MB) */
+    int memoryBudget;
+    int texPoolFloor;
+    int seCacheFloor;
+    int prefetchFloor;
+    int hiresFloor;
+
+    /* Write a chrome://tracing timeline of the boot path to
+     * customDataPath/boottrace.json */
+    bool bootTrace;
+
+    /* Append a compact perf record every few seconds to a ring
+     * file in customDataPath, surviving crashes (flight recorder) */
+    bool flightRecorder;
+
+    /* Handheld power profile: sleep-only frame pacing, relaxed
+     * audio worker cadence and present skipping on idle frames -
+     * trades a little latency for battery */
+    bool powerSaver;
+
+    /* Start with the perf HUD overlay visible */
+    bool perfHud;
+
+    /* Append one frame time (ms) per line to this file; the
+     * replay perf harness consumes it for percentiles */
+    std::string frameTimeLog;
+
     struct {
         bool active;
         bool lastMileScaling;
@@ -121,6 +177,40 @@ struct Config {
     std::vector<std::string> patches;
     
     std::vector<std::string> fontSubs;
+
+    /* "Family:size" entries warmed into the font pool
+     * on a background thread at boot */
+    std::vector<std::string> preloadFonts;
+    /* Assets to warm through the async loaders during the title
+     * screen (SE decode cache, audio byte prefetch, bitmap decode) */
+    std::vector<std::string> preload;
+
+    /* Watch the game directory for asset changes and
+     * invalidate just the touched cache entries (dev aid) */
+    bool devFileWatch;
+
+    /* Coalesce Tone/Rect change signals into one delivery
+     * per object and frame at Graphics.update */
+    bool deferredEtcNotify;
+
+    /* Deterministic input capture: record every frame's
+     * input to a stream / feed one back bit-exactly */
+    std::string recordInput;
+    std::string replayInput;
+
+    /* Controller axis shaping: dead zone in raw units and
+     * response curve exponent (1.0 = linear) */
+    int joystickDeadzone;
+    double axisResponseCurve;
+
+    /* Fixed-timestep mode: logic ticks at frameRate while
+     * the screen presents interpolated sub-frames at the
+     * display's refresh rate */
+    bool decoupledRender;
+
+    /* Drop to ~5fps, pause the mixer and shed the texture
+     * cache while the window is unfocused */
+    bool backgroundThrottle;
     
     std::vector<std::string> rubyLoadpaths;
 
@@ -0,0 +1,139 @@
+/*
+** filemap.h
+**
+** This file is part of mkxp.
+**
+** Copyright (C) 2014 - 2021 Amaryllis Kulla <ancurio@mapleshrine.eu>
+**
+** mkxp is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 2 of the License, or
+** (at your option) any later version.
+**
+** mkxp is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with mkxp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef FILEMAP_H
+#define FILEMAP_H
+
+#include <stdint.h>
+
+#ifdef __WIN32__
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/* Read-only whole-file memory mapping, used by the archive
+ * readers to serve entry data without seek/read syscalls.
+ * 'data' stays null when mapping isn't possible; callers are
+ * expected to keep a conventional io path as fallback */
+struct FileMapping
+{
+	const uint8_t *data;
+	uint64_t len;
+
+	FileMapping()
+	    : data(0),
+	      len(0)
+	{}
+};
+
+static inline void
+mapFile(const char *path, FileMapping &out)
+{
+	if (!path)
+		return;
+
+#ifdef __WIN32__
+	wchar_t pathW[MAX_PATH];
+
+	if (!MultiByteToWideChar(CP_UTF8, 0, path, -1, pathW, MAX_PATH))
+		return;
+
+	HANDLE file = CreateFileW(pathW, GENERIC_READ, FILE_SHARE_READ, 0,
+	                          OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+
+	if (file == INVALID_HANDLE_VALUE)
+		return;
+
+	LARGE_INTEGER size;
+
+	if (!GetFileSizeEx(file, &size) || size.QuadPart <= 0)
+	{
+		CloseHandle(file);
+		return;
+	}
+
+	HANDLE mapping = CreateFileMappingW(file, 0, PAGE_READONLY, 0, 0, 0);
+
+	if (!mapping)
+	{
+		CloseHandle(file);
+		return;
+	}
+
+	void *view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+
+	/* The view keeps the underlying objects alive */
+	CloseHandle(mapping);
+	CloseHandle(file);
+
+	if (!view)
+		return;
+
+	out.data = static_cast<const uint8_t*>(view);
+	out.len = size.QuadPart;
+#else
+	int fd = open(path, O_RDONLY);
+
+	if (fd < 0)
+		return;
+
+	struct stat st;
+
+	if (fstat(fd, &st) != 0 || st.st_size <= 0)
+	{
+		close(fd);
+		return;
+	}
+
+	void *map = mmap(0, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+
+	/* The mapping persists after the descriptor is closed */
+	close(fd);
+
+	if (map == MAP_FAILED)
+		return;
+
+	out.data = static_cast<const uint8_t*>(map);
+	out.len = st.st_size;
+#endif
+}
+
+static inline void
+unmapFile(FileMapping &m)
+{
+	if (!m.data)
+		return;
+
+#ifdef __WIN32__
+	UnmapViewOfFile(m.data);
+#else
+	munmap(const_cast<uint8_t*>(m.data), m.len);
+#endif
+
+	m.data = 0;
+	m.len = 0;
+}
+
+#endif // FILEMAP_H
@@ -0,0 +1,633 @@
+/*
+** mkxpack.cpp
+**
+** This file is part of mkxp.
+**
+** Copyright (C) 2014 - 2021 Amaryllis Kulla <ancurio@mapleshrine.eu>
+**
+** mkxp is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 2 of the License, or
+** (at your option) any later version.
+**
+** mkxp is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with mkxp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifdef MKXPZ_ZSTD
+
+#include "mkxpack.h"
+#include "boost-hash.h"
+#include "filemap.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include <zstd.h>
+
+/* MKXPACK, the engine's packed game archive (all little endian;
+ * built by scripts/mkxpack.py):
+ *
+ *   [header, 32 bytes]
+ *      0  char    magic[8]      "MKXPACK1"
+ *      8  u64     indexOffset   byte offset of the index blob
+ *     16  u64     indexSize     total size of the index blob
+ *     24  u32     entryCount
+ *     28  u32     reserved      0
+ *
+ *   [index blob, loaded in ONE read at mount]
+ *     entryCount 40 byte records sorted by ascending pathHash,
+ *     followed by the string table ('\0' terminated paths,
+ *     '/' separated, exact case):
+ *
+ *      0  u64     pathHash      FNV-1a (64 bit) of the path
+ *      8  u64     dataOffset    4096 byte aligned
+ *     16  u64     rawSize       uncompressed entry size
+ *     24  u64     storedSize    bytes on disk
+ *     32  u32     nameOffset    into the string table
+ *     36  u16     nameLen
+ *     38  u16     flags         bit 0: entry is zstd compressed
+ *
+ * Compared to RGSSAD this mounts with two reads instead of a
+ * seek chain over every entry, keeps data 4 KB aligned for
+ * direct I/O and the page cache, and optionally compresses
+ * entries (the packer stores incompressible ones verbatim).
+ * Lookup is a binary search over the hash column; collisions
+ * fall back to name comparison over the run of equal hashes. */
+
+#define MKXPACK_MAGIC "MKXPACK1"
+#define MKXPACK_HEADER_SIZE 32
+#define MKXPACK_RECORD_SIZE 40
+
+#define MKXPACK_FLAG_ZSTD 1
+
+struct MKX_entryData
+{
+	uint64_t hash;
+	uint64_t dataOffset;
+	uint64_t rawSize;
+	uint64_t storedSize;
+	const char *name;
+	uint16_t nameLen;
+	uint16_t flags;
+};
+
+struct MKX_archiveData
+{
+	PHYSFS_Io *archiveIo;
+
+	/* Read-only mapping of the whole archive file;
+	 * empty when mapping wasn't possible (reads then go
+	 * through seek+read on archiveIo duplicates) */
+	FileMapping mapping;
+
+	/* Sorted by hash */
+	std::vector<MKX_entryData> entries;
+
+	/* Backing store for entry names */
+	std::vector<char> names;
+
+	/* Maps: directory path,
+	 * to:   list of contained entries */
+	BoostHash<std::string, BoostSet<std::string> > dirHash;
+
+	MKX_archiveData()
+	    : archiveIo(0)
+	{}
+};
+
+static uint64_t
+fnv1aHash(const char *str, size_t len)
+{
+	uint64_t hash = 0xcbf29ce484222325ull;
+
+	for (size_t i = 0; i < len; ++i)
+	{
+		hash ^= (uint8_t) str[i];
+		hash *= 0x100000001b3ull;
+	}
+
+	return hash;
+}
+
+static uint32_t
+readLE32(const uint8_t *p)
+{
+	return ((uint32_t) p[0] <<  0) | ((uint32_t) p[1] <<  8) |
+	       ((uint32_t) p[2] << 16) | ((uint32_t) p[3] << 24);
+}
+
+static uint64_t
+readLE64(const uint8_t *p)
+{
+	return (uint64_t) readLE32(p) | ((uint64_t) readLE32(p + 4) << 32);
+}
+
+static const MKX_entryData*
+findEntry(const MKX_archiveData *data, const char *filename)
+{
+	size_t len = strlen(filename);
+	uint64_t hash = fnv1aHash(filename, len);
+
+	/* Binary search on the hash column */
+	size_t lo = 0, hi = data->entries.size();
+
+	while (lo < hi)
+	{
+		size_t mid = (lo + hi) / 2;
+
+		if (data->entries[mid].hash < hash)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	/* Walk the run of equal hashes */
+	for (; lo < data->entries.size() && data->entries[lo].hash == hash; ++lo)
+	{
+		const MKX_entryData &entry = data->entries[lo];
+
+		if (entry.nameLen == len && !memcmp(entry.name, filename, len))
+			return &entry;
+	}
+
+	return 0;
+}
+
+struct MKX_entryHandle
+{
+	const MKX_entryData entry;
+	uint64_t currentOffset;
+
+	/* Mapped archives are read straight from memory;
+	 * io is only opened for the fallback path */
+	const uint8_t *map;
+	PHYSFS_Io *io;
+
+	/* Compressed entries are inflated in full on first
+	 * read and served from memory afterwards */
+	std::vector<uint8_t> inflated;
+	bool inflateFailed;
+
+	MKX_entryHandle(const MKX_entryData &entry, PHYSFS_Io *archIo,
+	                const uint8_t *map)
+	    : entry(entry),
+	      currentOffset(0),
+	      map(map),
+	      io(0),
+	      inflateFailed(false)
+	{
+		if (!map)
+			io = archIo->duplicate(archIo);
+	}
+
+	MKX_entryHandle(const MKX_entryHandle &other)
+	    : entry(other.entry),
+	      currentOffset(other.currentOffset),
+	      map(other.map),
+	      io(0),
+	      inflated(other.inflated),
+	      inflateFailed(other.inflateFailed)
+	{
+		if (other.io)
+			io = other.io->duplicate(other.io);
+	}
+
+	~MKX_entryHandle()
+	{
+		if (io)
+			io->destroy(io);
+	}
+
+	/* Reads 'len' stored bytes at 'offset' (relative to the
+	 * entry) from the mapping or the io fallback */
+	bool readStored(uint64_t offset, void *buffer, uint64_t len)
+	{
+		if (map)
+		{
+			memcpy(buffer, map + entry.dataOffset + offset, len);
+			return true;
+		}
+
+		if (!io->seek(io, entry.dataOffset + offset))
+			return false;
+
+		return io->read(io, buffer, len) == (PHYSFS_sint64) len;
+	}
+
+	bool ensureInflated()
+	{
+		if (!inflated.empty())
+			return true;
+
+		if (inflateFailed)
+			return false;
+
+		std::vector<uint8_t> stored;
+		const uint8_t *src;
+
+		if (map)
+		{
+			src = map + entry.dataOffset;
+		}
+		else
+		{
+			stored.resize(entry.storedSize);
+
+			if (!readStored(0, stored.data(), entry.storedSize))
+			{
+				inflateFailed = true;
+				return false;
+			}
+
+			src = stored.data();
+		}
+
+		inflated.resize(entry.rawSize);
+
+		size_t res = ZSTD_decompress(inflated.data(), inflated.size(),
+		                             src, entry.storedSize);
+
+		if (ZSTD_isError(res) || res != entry.rawSize)
+		{
+			inflated.clear();
+			inflateFailed = true;
+			return false;
+		}
+
+		return true;
+	}
+};
+
+static PHYSFS_sint64
+MKX_ioRead(PHYSFS_Io *self, void *buffer, PHYSFS_uint64 len)
+{
+	MKX_entryHandle *entry = static_cast<MKX_entryHandle*>(self->opaque);
+
+	uint64_t toRead =
+		std::min<uint64_t>(entry->entry.rawSize - entry->currentOffset, len);
+
+	if (toRead == 0)
+		return 0;
+
+	if (entry->entry.flags & MKXPACK_FLAG_ZSTD)
+	{
+		if (!entry->ensureInflated())
+			return -1;
+
+		memcpy(buffer, &entry->inflated[entry->currentOffset], toRead);
+	}
+	else
+	{
+		if (!entry->readStored(entry->currentOffset, buffer, toRead))
+			return -1;
+	}
+
+	entry->currentOffset += toRead;
+
+	return toRead;
+}
+
+static int
+MKX_ioSeek(PHYSFS_Io *self, PHYSFS_uint64 offset)
+{
+	MKX_entryHandle *entry = static_cast<MKX_entryHandle*>(self->opaque);
+
+	if (offset > entry->entry.rawSize)
+		return 0;
+
+	entry->currentOffset = offset;
+
+	return 1;
+}
+
+static PHYSFS_sint64
+MKX_ioTell(PHYSFS_Io *self)
+{
+	const MKX_entryHandle *entry = static_cast<MKX_entryHandle*>(self->opaque);
+
+	return entry->currentOffset;
+}
+
+static PHYSFS_sint64
+MKX_ioLength(PHYSFS_Io *self)
+{
+	const MKX_entryHandle *entry = static_cast<MKX_entryHandle*>(self->opaque);
+
+	return entry->entry.rawSize;
+}
+
+static PHYSFS_Io*
+MKX_ioDuplicate(PHYSFS_Io *self)
+{
+	const MKX_entryHandle *entry = static_cast<MKX_entryHandle*>(self->opaque);
+	MKX_entryHandle *entryDup = new MKX_entryHandle(*entry);
+
+	PHYSFS_Io *dup = static_cast<PHYSFS_Io*>(
+		PHYSFS_getAllocator()->Malloc(sizeof(PHYSFS_Io)));
+
+	*dup = *self;
+	dup->opaque = entryDup;
+
+	return dup;
+}
+
+static void
+MKX_ioDestroy(PHYSFS_Io *self)
+{
+	MKX_entryHandle *entry = static_cast<MKX_entryHandle*>(self->opaque);
+
+	delete entry;
+
+	PHYSFS_getAllocator()->Free(self);
+}
+
+static const PHYSFS_Io MKX_IoTemplate =
+{
+    0, /* version */
+    0, /* opaque */
+    MKX_ioRead,
+    0, /* write */
+    MKX_ioSeek,
+    MKX_ioTell,
+    MKX_ioLength,
+    MKX_ioDuplicate,
+    0, /* flush */
+    MKX_ioDestroy
+};
+
+static void
+processDirectories(MKX_archiveData *data, BoostSet<std::string> &topLevel,
+                   char *nameBuf, uint32_t nameLen)
+{
+	/* Check for top level entries */
+	for (uint32_t i = 0; i < nameLen; ++i)
+	{
+		bool slash = nameBuf[i] == '/';
+		if (!slash && i+1 < nameLen)
+			continue;
+
+		if (slash)
+			nameBuf[i] = '\0';
+
+		topLevel.insert(nameBuf);
+
+		if (slash)
+			nameBuf[i] = '/';
+
+		break;
+	}
+
+	/* Check for more entries */
+	for (uint32_t i = nameLen; i > 0; i--)
+		if (nameBuf[i] == '/')
+		{
+			nameBuf[i] = '\0';
+
+			const char *dir = nameBuf;
+			const char *entry = &nameBuf[i+1];
+
+			BoostSet<std::string> &entryList = data->dirHash[dir];
+			entryList.insert(entry);
+		}
+}
+
+static bool
+entryHashLess(const MKX_entryData &a, const MKX_entryData &b)
+{
+	return a.hash < b.hash;
+}
+
+static void*
+MKXPACK_openArchive(PHYSFS_Io *io, const char *name, int forWrite,
+                    int *claimed)
+{
+	if (forWrite)
+		return NULL;
+
+	uint8_t header[MKXPACK_HEADER_SIZE];
+
+	if (io->read(io, header, sizeof(header)) != sizeof(header))
+		return NULL;
+
+	if (memcmp(header, MKXPACK_MAGIC, 8))
+		return NULL;
+
+	*claimed = 1;
+
+	uint64_t indexOffset = readLE64(header + 8);
+	uint64_t indexSize = readLE64(header + 16);
+	uint32_t entryCount = readLE32(header + 24);
+
+	uint64_t recordsSize = (uint64_t) entryCount * MKXPACK_RECORD_SIZE;
+	uint64_t fileLen = (uint64_t) io->length(io);
+
+	/* Sanity: the records must fit the blob, the blob must
+	 * fit the file (ordered so crafted offsets can't wrap) */
+	if (recordsSize > indexSize
+	||  indexSize > fileLen
+	||  indexOffset > fileLen - indexSize)
+		return NULL;
+
+	/* The whole index comes in with one read */
+	std::vector<uint8_t> blob(indexSize);
+
+	if (!io->seek(io, indexOffset)
+	||  io->read(io, blob.data(), indexSize) != (PHYSFS_sint64) indexSize)
+		return NULL;
+
+	MKX_archiveData *data = new MKX_archiveData;
+	data->archiveIo = io;
+
+	mapFile(name, data->mapping);
+
+	uint64_t namesSize = indexSize - recordsSize;
+	data->names.assign(blob.begin() + recordsSize, blob.end());
+
+	data->entries.reserve(entryCount);
+
+	/* Top level entry list */
+	BoostSet<std::string> &topLevel = data->dirHash[""];
+
+	for (uint32_t i = 0; i < entryCount; ++i)
+	{
+		const uint8_t *rec = blob.data() + (uint64_t) i * MKXPACK_RECORD_SIZE;
+
+		MKX_entryData entry;
+		entry.hash = readLE64(rec + 0);
+		entry.dataOffset = readLE64(rec + 8);
+		entry.rawSize = readLE64(rec + 16);
+		entry.storedSize = readLE64(rec + 24);
+
+		uint32_t nameOffset = readLE32(rec + 32);
+		entry.nameLen = (uint16_t) (rec[36] | (rec[37] << 8));
+		entry.flags = (uint16_t) (rec[38] | (rec[39] << 8));
+
+		/* Names must lie inside the string table, with
+		 * their terminator */
+		if ((uint64_t) nameOffset + entry.nameLen + 1 > namesSize)
+			goto error;
+
+		entry.name = &data->names[nameOffset];
+
+		if (entry.name[entry.nameLen] != '\0')
+			goto error;
+
+		data->entries.push_back(entry);
+
+		char nameBuf[512];
+
+		if (entry.nameLen >= sizeof(nameBuf))
+			goto error;
+
+		memcpy(nameBuf, entry.name, entry.nameLen + 1);
+		processDirectories(data, topLevel, nameBuf, entry.nameLen);
+	}
+
+	/* The packer writes the records pre-sorted; sorting an
+	 * already sorted array here is cheap insurance */
+	std::sort(data->entries.begin(), data->entries.end(), entryHashLess);
+
+	return data;
+
+error:
+	unmapFile(data->mapping);
+	delete data;
+	return NULL;
+}
+
+static PHYSFS_EnumerateCallbackResult
+MKXPACK_enumerateFiles(void *opaque, const char *dirname,
+                       PHYSFS_EnumerateCallback cb,
+                       const char *origdir, void *callbackdata)
+{
+	MKX_archiveData *data = static_cast<MKX_archiveData*>(opaque);
+
+	const BoostSet<std::string> *entries = data->dirHash.valuePtr(dirname);
+
+	if (!entries)
+		return PHYSFS_ENUM_STOP;
+
+	BoostSet<std::string>::const_iterator iter;
+	for (iter = entries->cbegin(); iter != entries->cend(); ++iter)
+		cb(callbackdata, origdir, iter->c_str());
+
+	return PHYSFS_ENUM_OK;
+}
+
+static PHYSFS_Io*
+MKXPACK_openRead(void *opaque, const char *filename)
+{
+	MKX_archiveData *data = static_cast<MKX_archiveData*>(opaque);
+
+	const MKX_entryData *entryData = findEntry(data, filename);
+
+	if (!entryData)
+		return 0;
+
+	/* Serve from the mapping when the entry lies fully
+	 * inside it; odd offsets fall back to seek+read */
+	const uint8_t *map = 0;
+
+	if (data->mapping.data
+	&&  entryData->dataOffset + entryData->storedSize <= data->mapping.len)
+		map = data->mapping.data;
+
+	MKX_entryHandle *entry =
+		new MKX_entryHandle(*entryData, data->archiveIo, map);
+
+	PHYSFS_Io *io = static_cast<PHYSFS_Io*>(
+		PHYSFS_getAllocator()->Malloc(sizeof(PHYSFS_Io)));
+
+	*io = MKX_IoTemplate;
+	io->opaque = entry;
+
+	return io;
+}
+
+static int
+MKXPACK_stat(void *opaque, const char *filename, PHYSFS_Stat *stat)
+{
+	MKX_archiveData *data = static_cast<MKX_archiveData*>(opaque);
+
+	const MKX_entryData *entry = findEntry(data, filename);
+	bool hasDir = data->dirHash.contains(filename);
+
+	if (!entry && !hasDir)
+	{
+		PHYSFS_setErrorCode(PHYSFS_ERR_NOT_FOUND);
+		return 0;
+	}
+
+	stat->modtime    =
+	stat->createtime =
+	stat->accesstime = 0;
+	stat->readonly   = 1;
+
+	if (entry)
+	{
+		stat->filesize = entry->rawSize;
+		stat->filetype = PHYSFS_FILETYPE_REGULAR;
+	}
+	else
+	{
+		stat->filesize = 0;
+		stat->filetype = PHYSFS_FILETYPE_DIRECTORY;
+	}
+
+	return 1;
+}
+
+static void
+MKXPACK_closeArchive(void *opaque)
+{
+	MKX_archiveData *data = static_cast<MKX_archiveData*>(opaque);
+
+	unmapFile(data->mapping);
+
+	delete data;
+}
+
+static PHYSFS_Io*
+MKXPACK_noop1(void*, const char*)
+{
+	return 0;
+}
+
+static int
+MKXPACK_noop2(void*, const char*)
+{
+	return 0;
+}
+
+const PHYSFS_Archiver MKXPACK_Archiver =
+{
+	0,
+	{
+		"MKXPACK",
+		"mkxp-z packed archive format",
+		"", /* Author */
+		"", /* Website */
+		0 /* symlinks not supported */
+	},
+	MKXPACK_openArchive,
+	MKXPACK_enumerateFiles,
+	MKXPACK_openRead,
+	MKXPACK_noop1, /* openWrite */
+	MKXPACK_noop1, /* openAppend */
+	MKXPACK_noop2, /* remove */
+	MKXPACK_noop2, /* mkdir */
+	MKXPACK_stat,
+	MKXPACK_closeArchive
+};
+
+#endif /* MKXPZ_ZSTD */
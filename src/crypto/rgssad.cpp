@@ -27,6 +27,17 @@
 
 #include <string>
 
+#include "filemap.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MKXPZ_RGSS_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__aarch64__)
+#define MKXPZ_RGSS_NEON
+#include <arm_neon.h>
+#endif
+
 /* Equivalent Linear Congruential Generator (LCG) constants for iteration 2^n
  * all the way up to 2^32/4 (the largest dword offset possible in
  * RGSS{AD,[23]A}).
@@ -65,19 +76,39 @@ struct RGSS_entryHandle
 	const RGSS_entryData data;
 	uint32_t currentMagic;
 	uint64_t currentOffset;
+
+	/* Mapped archives are decrypted straight out of
+	 * memory; io is only opened for the fallback path */
+	const uint8_t *map;
 	PHYSFS_Io *io;
 
-	RGSS_entryHandle(const RGSS_entryData &data, PHYSFS_Io *archIo)
+	RGSS_entryHandle(const RGSS_entryData &data, PHYSFS_Io *archIo,
+	                 const uint8_t *map)
 	    : data(data),
 	      currentMagic(data.startMagic),
-	      currentOffset(0)
+	      currentOffset(0),
+	      map(map),
+	      io(0)
 	{
-		io = archIo->duplicate(archIo);
+		if (!map)
+			io = archIo->duplicate(archIo);
+	}
+
+	RGSS_entryHandle(const RGSS_entryHandle &other)
+	    : data(other.data),
+	      currentMagic(other.currentMagic),
+	      currentOffset(other.currentOffset),
+	      map(other.map),
+	      io(0)
+	{
+		if (other.io)
+			io = other.io->duplicate(other.io);
 	}
 
 	~RGSS_entryHandle()
 	{
-		io->destroy(io);
+		if (io)
+			io->destroy(io);
 	}
 };
 
@@ -85,6 +116,11 @@ struct RGSS_archiveData
 {
 	PHYSFS_Io *archiveIo;
 
+	/* Read-only mapping of the whole archive file;
+	 * empty when mapping wasn't possible (reads then go
+	 * through seek+read on archiveIo duplicates) */
+	FileMapping mapping;
+
 	/* Maps: file path
 	 * to:   entry data */
 	BoostHash<std::string, RGSS_entryData> entryHash;
@@ -92,6 +128,10 @@ struct RGSS_archiveData
 	/* Maps: directory path,
 	 * to:   list of contained entries */
 	BoostHash<std::string, BoostSet<std::string> > dirHash;
+
+	RGSS_archiveData()
+	    : archiveIo(0)
+	{}
 };
 
 static bool
@@ -142,11 +182,164 @@ advanceMagicN(uint32_t &magic, uint32_t n) {
     return old;
 }
 
+#ifdef MKXPZ_RGSS_SSE2
+/* Lane-wise 32 bit multiply; SSE2 only has the widening
+ * even-lane variant */
+static inline __m128i
+mullo32(__m128i a, __m128i b)
+{
+	__m128i even = _mm_mul_epu32(a, b);
+	__m128i odd  = _mm_mul_epu32(_mm_srli_si128(a, 4),
+	                             _mm_srli_si128(b, 4));
+
+	return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0,0,2,0)),
+	                          _mm_shuffle_epi32(odd,  _MM_SHUFFLE(0,0,2,0)));
+}
+#endif
+
+/* Xors 'count' dwords with the keystream, stepping 'magic'
+ * once per dword exactly like advanceMagic would. The vector
+ * paths carry four consecutive keystream values per register
+ * and jump all lanes four LCG steps at once (the 2^2 entry
+ * of LCG_TABLE), producing 16 bytes of key material per
+ * iteration */
+static void
+xorKeystream(uint32_t *data, uint64_t count, uint32_t &magic)
+{
+	uint64_t i = 0;
+
+#if defined(MKXPZ_RGSS_SSE2)
+	if (count >= 4)
+	{
+		uint32_t m = magic;
+		__m128i key = _mm_set_epi32(m*343u + 171u, m*49u + 24u,
+		                            m*7u + 3u, m);
+
+		const __m128i mul = _mm_set1_epi32(0x961);
+		const __m128i add = _mm_set1_epi32(0x4b0);
+
+		for (; i + 4 <= count; i += 4)
+		{
+			__m128i v = _mm_loadu_si128(reinterpret_cast<__m128i*>(data + i));
+			v = _mm_xor_si128(v, key);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(data + i), v);
+
+			key = _mm_add_epi32(mullo32(key, mul), add);
+		}
+
+		advanceMagicN(magic, (uint32_t) i);
+	}
+#elif defined(MKXPZ_RGSS_NEON)
+	if (count >= 4)
+	{
+		uint32_t m = magic;
+		const uint32_t k[4] = { m, m*7u + 3u, m*49u + 24u, m*343u + 171u };
+		uint32x4_t key = vld1q_u32(k);
+
+		const uint32x4_t mul = vdupq_n_u32(0x961);
+		const uint32x4_t add = vdupq_n_u32(0x4b0);
+
+		for (; i + 4 <= count; i += 4)
+		{
+			uint32x4_t v = vld1q_u32(data + i);
+			v = veorq_u32(v, key);
+			vst1q_u32(data + i, v);
+
+			key = vaddq_u32(vmulq_u32(key, mul), add);
+		}
+
+		advanceMagicN(magic, (uint32_t) i);
+	}
+#endif
+
+	for (; i < count; ++i)
+		data[i] ^= advanceMagic(magic);
+}
+
+/* Same three-phase decrypt as the io path below, but the
+ * ciphertext comes straight out of the archive mapping */
+static PHYSFS_sint64
+RGSS_ioReadMapped(RGSS_entryHandle *entry, void *buffer, PHYSFS_uint64 len)
+{
+	uint64_t toRead = std::min<uint64_t>(entry->data.size - entry->currentOffset, len);
+	uint64_t offs = entry->currentOffset;
+
+	const uint8_t *src = entry->map + entry->data.offset + offs;
+
+	uint8_t preAlign = 4 - (offs % 4);
+
+	if (preAlign == 4)
+		preAlign = 0;
+	else
+		preAlign = std::min<uint64_t>(preAlign, toRead);
+
+	uint8_t postAlign = (toRead > preAlign) ? (offs + toRead) % 4 : 0;
+
+	uint64_t align = toRead - (preAlign + postAlign);
+
+	/* Byte buffer pointer */
+	uint8_t *bBufferP = static_cast<uint8_t*>(buffer);
+
+	if (preAlign > 0)
+	{
+		uint32_t dword = 0;
+		memcpy(&dword, src, preAlign);
+		src += preAlign;
+
+		/* Need to align the bytes with the
+		 * magic before xoring */
+		dword <<= 8 * (offs % 4);
+		dword ^= entry->currentMagic;
+
+		/* Shift them back to normal */
+		dword >>= 8 * (offs % 4);
+		memcpy(bBufferP, &dword, preAlign);
+
+		bBufferP += preAlign;
+
+		/* Only advance the magic if we actually
+		 * reached the next alignment */
+		if ((offs+preAlign) % 4 == 0)
+			advanceMagic(entry->currentMagic);
+	}
+
+	if (align > 0)
+	{
+		/* Double word buffer pointer */
+		uint32_t *dwBufferP = reinterpret_cast<uint32_t*>(bBufferP);
+
+		/* Decrypt-on-copy out of the mapping */
+		memcpy(bBufferP, src, align);
+		src += align;
+
+		xorKeystream(dwBufferP, align / 4, entry->currentMagic);
+
+		bBufferP += align;
+	}
+
+	if (postAlign > 0)
+	{
+		uint32_t dword = 0;
+		memcpy(&dword, src, postAlign);
+
+		/* Bytes are already aligned with magic */
+		dword ^= entry->currentMagic;
+		memcpy(bBufferP, &dword, postAlign);
+	}
+
+	entry->currentOffset += toRead;
+
+	return toRead;
+}
+
 static PHYSFS_sint64
 RGSS_ioRead(PHYSFS_Io *self, void *buffer, PHYSFS_uint64 len)
 {
 	RGSS_entryHandle *entry = static_cast<RGSS_entryHandle*>(self->opaque);
 
+	if (entry->map)
+		return RGSS_ioReadMapped(entry, buffer, len);
+
 	PHYSFS_Io *io = entry->io;
 
 	uint64_t toRead = std::min<uint64_t>(entry->data.size - entry->currentOffset, len);
@@ -217,8 +410,7 @@ RGSS_ioRead(PHYSFS_Io *self, void *buffer, PHYSFS_uint64 len)
 		io->read(io, bBufferP, align);
 
 		/* Then xor them */
-		for (uint64_t i = 0; i < (align / 4); ++i)
-			dwBufferP[i] ^= advanceMagic(entry->currentMagic);
+		xorKeystream(dwBufferP, align / 4, entry->currentMagic);
 
 		bBufferP += align;
 	}
@@ -264,7 +456,9 @@ RGSS_ioSeek(PHYSFS_Io *self, PHYSFS_uint64 offset)
 	advanceMagicN(entry->currentMagic, (uint32_t) dwordsSought);
 
 	entry->currentOffset = offset;
-	entry->io->seek(entry->io, entry->data.offset + entry->currentOffset);
+
+	if (entry->io)
+		entry->io->seek(entry->io, entry->data.offset + entry->currentOffset);
 
 	return 1;
 }
@@ -376,7 +570,7 @@ verifyHeader(PHYSFS_Io *io, char version)
 }
 
 static void*
-RGSS_openArchive(PHYSFS_Io *io, const char *, int forWrite, int *claimed)
+RGSS_openArchive(PHYSFS_Io *io, const char *name, int forWrite, int *claimed)
 {
 	if (forWrite)
 		return NULL;
@@ -390,6 +584,8 @@ RGSS_openArchive(PHYSFS_Io *io, const char *, int forWrite, int *claimed)
 	RGSS_archiveData *data = new RGSS_archiveData;
 	data->archiveIo = io;
 
+	mapFile(name, data->mapping);
+
 	uint32_t magic = RGSS_MAGIC;
 
 	/* Top level entry list */
@@ -443,15 +639,13 @@ RGSS_enumerateFiles(void *opaque, const char *dirname,
 {
 	RGSS_archiveData *data = static_cast<RGSS_archiveData*>(opaque);
 
-	std::string _dirname(dirname);
+	const BoostSet<std::string> *entries = data->dirHash.valuePtr(dirname);
 
-	if (!data->dirHash.contains(_dirname))
+	if (!entries)
 		return PHYSFS_ENUM_STOP;
 
-	const BoostSet<std::string> &entries = data->dirHash[_dirname];
-
 	BoostSet<std::string>::const_iterator iter;
-	for (iter = entries.cbegin(); iter != entries.cend(); ++iter)
+	for (iter = entries->cbegin(); iter != entries->cend(); ++iter)
 		cb(callbackdata, origdir, iter->c_str());
 
 	return PHYSFS_ENUM_OK;
@@ -465,8 +659,19 @@ RGSS_openRead(void *opaque, const char *filename)
 	if (!data->entryHash.contains(filename))
 		return 0;
 
+	const RGSS_entryData &entryData = data->entryHash[filename];
+
+	/* Serve from the mapping when the entry lies fully
+	 * inside it; odd offsets fall back to seek+read */
+	const uint8_t *map = 0;
+
+	if (data->mapping.data
+	&&  entryData.offset >= 0
+	&&  (uint64_t) entryData.offset + entryData.size <= data->mapping.len)
+		map = data->mapping.data;
+
 	RGSS_entryHandle *entry =
-	        new RGSS_entryHandle(data->entryHash[filename], data->archiveIo);
+	        new RGSS_entryHandle(entryData, data->archiveIo, map);
 
 	PHYSFS_Io *io = PHYSFS_ALLOC(PHYSFS_Io);
 
@@ -516,6 +721,8 @@ RGSS_closeArchive(void *opaque)
 {
 	RGSS_archiveData *data = static_cast<RGSS_archiveData*>(opaque);
 
+	unmapFile(data->mapping);
+
 	delete data;
 }
 
@@ -585,7 +792,7 @@ readUint32AndXor(PHYSFS_Io *io, uint32_t &result, uint32_t key)
 }
 
 static void*
-RGSS3_openArchive(PHYSFS_Io *io, const char *, int forWrite, int *claimed)
+RGSS3_openArchive(PHYSFS_Io *io, const char *name, int forWrite, int *claimed)
 {
 	if (forWrite)
 		return NULL;
@@ -606,6 +813,8 @@ RGSS3_openArchive(PHYSFS_Io *io, const char *, int forWrite, int *claimed)
 	RGSS_archiveData *data = new RGSS_archiveData;
 	data->archiveIo = io;
 
+	mapFile(name, data->mapping);
+
 	/* Top level entry list */
 	BoostSet<std::string> &topLevel = data->dirHash[""];
 
@@ -655,6 +864,7 @@ RGSS3_openArchive(PHYSFS_Io *io, const char *, int forWrite, int *claimed)
 		continue;
 
 	error:
+		unmapFile(data->mapping);
 		delete data;
 		return NULL;
 	}
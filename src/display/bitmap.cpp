@@ -32,6 +32,7 @@
 #include "gl-util.h"
 #include "gl-meta.h"
 #include "quad.h"
+#include "scene.h"
 #include "quadarray.h"
 #include "transform.h"
 #include "exception.h"
@@ -43,13 +44,19 @@
 #include "filesystem.h"
 #include "font.h"
 #include "eventthread.h"
+#include "boost-hash.h"
+#include "glyphatlas.h"
+#include "arena.h"
+#include "sdfatlas.h"
+#include "textshaper.h"
+#include "sdl-util.h"
 #include "graphics.h"
 #include "system.h"
 #include "util/util.h"
 
 #include "debugwriter.h"
 
-#include "sigslot/signal.hpp"
+#include "flatsignal.h"
 
 #include <math.h>
 #include <algorithm>
@@ -103,6 +110,28 @@ static IntRect normalizedRect(const IntRect &rect)
 }
 
 
+/* Animation frames are allocated directly instead of through
+ * TexPool: dozens of identically sized, long-lived frames would
+ * otherwise crowd the pool's cache on release and evict scratch
+ * textures that actually benefit from pooling. (A texture-array
+ * representation would be nicer still, but every shader in the
+ * pipeline samples plain sampler2Ds.) */
+static TEXFBO allocFrameTex(int width, int height)
+{
+    int maxSize = glState.caps.maxTexSize;
+    if (width > maxSize || height > maxSize)
+        throw Exception(Exception::MKXPError,
+                        "Texture dimensions [%d, %d] exceed hardware capabilities",
+                        width, height);
+
+    TEXFBO tex;
+    TEXFBO::init(tex);
+    TEXFBO::allocEmpty(tex, width, height);
+    TEXFBO::linkFBO(tex);
+
+    return tex;
+}
+
 // libnsgif loading callbacks, taken pretty much straight from their tests
 
 static void *gif_bitmap_create(int width, int height)
@@ -151,6 +180,11 @@ static void gif_bitmap_modified(void *bitmap)
 
 // --------------------
 
+/* Hires bitmaps currently materialized from a source file, in
+ * residency order for pressure eviction. Script/GL thread only */
+static std::vector<BitmapPrivate*> hiresResident;
+static uint64_t hiresClock = 0;
+
 struct BitmapPrivate
 {
     Bitmap *self;
@@ -185,11 +219,15 @@ struct BitmapPrivate
         }
         
         inline void play() {
+            if (!playing)
+                shState->graphics().animatedPlaying(1);
             playing = true;
             needsReset = true;
         }
         
         inline void stop() {
+            if (playing)
+                shState->graphics().animatedPlaying(-1);
             lastFrame = currentFrameI();
             playing = false;
         }
@@ -212,17 +250,84 @@ struct BitmapPrivate
         }
     } animation;
     
-    sigslot::connection prepareCon;
-    
+    FlatConnection prepareCon;
+
     TEXFBO gl;
+
+    /* Ring of pixel-buffer objects for asynchronous readbacks.
+     * A readback is initiated into one buffer and consumed on a
+     * later getRaw call, giving the GPU time to finish the
+     * transfer without stalling the pipeline */
+    enum { readbackBufCount = 2 };
+    struct {
+        GLuint bufs[readbackBufCount];
+        int nextBuf;
+        int pendingBuf;
+        int pendingSize;
+        bool pending;
+    } readback;
     
     Font *font;
-    
+
     /* "Mega surfaces" are a hack to allow Tilesets to be used
      * whose Bitmaps don't fit into a regular texture. They're
      * kept in RAM and will throw an error if they're used in
      * any context other than as Tilesets */
     SDL_Surface *megaSurface;
+
+    /* Deferred blit queue: consecutive fast-path blits into this
+     * bitmap are recorded and replayed in one batch (single
+     * target FBO bind) when the bitmap is next sampled, about to
+     * be modified by another operation, or at the next frame
+     * boundary */
+    struct QueuedBlit
+    {
+        TEXFBO src;
+        IntRect srcRect;
+        IntRect dstRect;
+        bool smooth;
+    };
+    std::vector<QueuedBlit> blitQueue;
+    std::vector<FlatConnection> blitQueueCons;
+    std::vector<BitmapPrivate*> blitQueueSrcs;
+
+    /* Deferred fill queue: consecutive fillRect/gradientFillRect
+     * calls are accumulated and drawn as a single batched quad
+     * draw. Blending is disabled for fills, so replaying them in
+     * order is pixel-identical to the scissored clears */
+    std::vector<Vertex> pendingFills;
+    ColorQuadArray *fillQuads;
+
+    /* Deferred hue rotation, in degrees: hueChange only records
+     * the angle and the actual pass runs when the result is
+     * needed, letting an immediately following blur fuse it
+     * into its first pass for free */
+    int pendingHue;
+
+    /* Emitted right before this bitmap's contents change or its
+     * textures go away, so bitmaps holding queued blits that
+     * sample from us can flush them against the old contents */
+    FlatSignal flushPoint;
+
+    /* Mega surfaces are streamed to the GPU in fixed-size tiles
+     * during stretchBlt instead of uploading the blit region
+     * wholesale on every call. Tiles stay resident until the
+     * configured byte budget forces the coldest ones out */
+    enum { megaTileSize = 1024 };
+    struct MegaTile
+    {
+        TEXFBO tex;
+        bool resident;
+        uint64_t stamp;
+
+        MegaTile() : resident(false), stamp(0) {}
+    };
+    struct {
+        std::vector<MegaTile> tiles;
+        int cols, rows;
+        uint64_t clock;
+        size_t residentBytes;
+    } megaTiles;
     
     /* A cached version of the bitmap in client memory, for
      * getPixel calls. Is invalidated any time the bitmap
@@ -241,6 +346,14 @@ struct BitmapPrivate
     // For high-resolution texture replacement.
     Bitmap *selfHires;
     Bitmap *selfLores;
+
+    /* Streamed hires replacement: the source path is kept and
+     * the texture only materialized on first use, so a 4K pack
+     * doesn't pay its whole VRAM bill up front. Evicted entries
+     * reload the same way */
+    std::string hiresSource;
+    uint64_t hiresStamp;
+    bool hiresWanted;
     bool assumingRubyGC;
     
     BitmapPrivate(Bitmap *self)
@@ -262,7 +375,24 @@ struct BitmapPrivate
         animation.startTime = 0;
         animation.fps = 0;
         animation.lastFrame = 0;
-        
+
+        pendingHue = 0;
+        fillQuads = 0;
+
+        megaTiles.cols = 0;
+        megaTiles.rows = 0;
+        megaTiles.clock = 0;
+        megaTiles.residentBytes = 0;
+
+        hiresStamp = 0;
+        hiresWanted = false;
+
+        readback.bufs[0] = readback.bufs[1] = 0;
+        readback.nextBuf = 0;
+        readback.pendingBuf = 0;
+        readback.pendingSize = 0;
+        readback.pending = false;
+
         prepareCon = shState->prepareDraw.connect(&BitmapPrivate::prepare, this);
         
         font = &shState->defaultFont();
@@ -271,9 +401,338 @@ struct BitmapPrivate
     
     ~BitmapPrivate()
     {
+        std::vector<BitmapPrivate*>::iterator pos =
+                std::find(hiresResident.begin(), hiresResident.end(), this);
+
+        if (pos != hiresResident.end())
+            hiresResident.erase(pos);
+
         prepareCon.disconnect();
         SDL_FreeFormat(format);
         pixman_region_fini(&tainted);
+
+        for (size_t i = 0; i < blitQueueCons.size(); ++i)
+            blitQueueCons[i].disconnect();
+
+        delete fillQuads;
+
+        if (readback.bufs[0])
+            ::gl.DeleteBuffers(readbackBufCount, readback.bufs);
+    }
+
+    /* Replays all queued blits in one batch */
+    void flushBlitQueue()
+    {
+        if (blitQueue.empty())
+            return;
+
+        GLMeta::blitBegin(gl);
+
+        for (size_t i = 0; i < blitQueue.size(); ++i)
+        {
+            QueuedBlit &op = blitQueue[i];
+            GLMeta::blitSource(op.src);
+            GLMeta::blitRectangle(op.srcRect, op.dstRect, op.smooth);
+        }
+
+        GLMeta::blitEnd();
+
+        blitQueue.clear();
+
+        for (size_t i = 0; i < blitQueueCons.size(); ++i)
+            blitQueueCons[i].disconnect();
+        blitQueueCons.clear();
+        blitQueueSrcs.clear();
+    }
+
+    /* Replays all accumulated fills in one draw call */
+    void flushFillQueue()
+    {
+        if (pendingFills.empty())
+            return;
+
+        if (!fillQuads)
+            fillQuads = new ColorQuadArray;
+
+        fillQuads->resize(pendingFills.size() / 4);
+        std::copy(pendingFills.begin(), pendingFills.end(),
+                  fillQuads->vertices.begin());
+        fillQuads->commit();
+
+        SimpleColorShader &shader = shState->shaders().simpleColor;
+        shader.bind();
+        shader.setTranslation(Vec2i());
+
+        FBO::bind(gl.fbo);
+        pushSetViewport(shader);
+
+        glState.blend.pushSet(false);
+        fillQuads->draw();
+        glState.blend.pop();
+
+        popViewport();
+
+        pendingFills.clear();
+    }
+
+    /* Records a (gradient) fill for deferred execution. Pending
+     * blits are ordered before it by the callers */
+    void enqueueFill(const IntRect &rect, const Vec4 &c1, const Vec4 &c2,
+                     bool vertical)
+    {
+        size_t i = pendingFills.size();
+        pendingFills.resize(i + 4);
+
+        Quad::setPosRect(&pendingFills[i], FloatRect(rect.x, rect.y, rect.w, rect.h));
+
+        if (vertical)
+        {
+            pendingFills[i+0].color = c1;
+            pendingFills[i+1].color = c1;
+            pendingFills[i+2].color = c2;
+            pendingFills[i+3].color = c2;
+        }
+        else
+        {
+            pendingFills[i+0].color = c1;
+            pendingFills[i+3].color = c1;
+            pendingFills[i+1].color = c2;
+            pendingFills[i+2].color = c2;
+        }
+    }
+
+    /* Records a fast-path blit for deferred execution. The queue
+     * is flushed whenever the source is about to change, so the
+     * stored TEXFBO stays valid and its contents stay current */
+    void enqueueBlit(BitmapPrivate *srcP, const IntRect &srcRect,
+                     const IntRect &dstRect, bool smooth)
+    {
+        /* Pending fills are ordered before the blit */
+        flushFillQueue();
+
+        /* Sampling the source: its own pending work lands first */
+        if (srcP != this)
+            srcP->flushDeferredOps();
+
+        QueuedBlit op = { srcP->gl, srcRect, dstRect, smooth };
+        blitQueue.push_back(op);
+
+        /* One connection per distinct source is enough */
+        if (srcP != this &&
+            std::find(blitQueueSrcs.begin(), blitQueueSrcs.end(), srcP) == blitQueueSrcs.end())
+        {
+            blitQueueCons.push_back(
+                srcP->flushPoint.connect(&BitmapPrivate::flushBlitQueue, this));
+            blitQueueSrcs.push_back(srcP);
+        }
+    }
+
+    /* Runs the deferred hue rotation pass, if one is recorded */
+    void applyPendingHue()
+    {
+        if ((pendingHue % 360) == 0)
+        {
+            pendingHue = 0;
+            return;
+        }
+
+        int hue = pendingHue;
+        pendingHue = 0;
+
+        /* Fills recorded before the rotation land first */
+        flushFillQueue();
+
+        /* The texture is swapped out underneath us, so bitmaps
+         * with queued blits sampling from us flush them first */
+        flushPoint();
+
+        TEXFBO newTex = shState->texPool().request(gl.width, gl.height);
+
+        FloatRect texRect(0, 0, gl.width, gl.height);
+
+        Quad &quad = shState->gpQuad();
+        quad.setTexPosRect(texRect, texRect);
+        quad.setColor(Vec4(1, 1, 1, 1));
+
+        HueShader &shader = shState->shaders().hue;
+        shader.bind();
+        /* Shader expects normalized value */
+        shader.setHueAdjust(wrapRange(hue, 0, 359) / 360.0f);
+
+        FBO::bind(newTex.fbo);
+        pushSetViewport(shader);
+
+        TEX::bind(gl.tex);
+        shader.setTexSize(Vec2i(gl.width, gl.height));
+
+        blitQuad(quad);
+
+        popViewport();
+
+        TEX::unbind();
+
+        shState->texPool().release(gl);
+        gl = newTex;
+    }
+
+    /* Discards everything recorded for deferred execution;
+     * used when the contents are about to be overwritten or
+     * released wholesale */
+    void dropDeferredOps()
+    {
+        blitQueue.clear();
+        pendingFills.clear();
+        pendingHue = 0;
+
+        for (size_t i = 0; i < blitQueueCons.size(); ++i)
+            blitQueueCons[i].disconnect();
+        blitQueueCons.clear();
+        blitQueueSrcs.clear();
+    }
+
+    /* Flushes everything recorded for deferred execution */
+    void flushDeferredOps()
+    {
+        flushBlitQueue();
+        flushFillQueue();
+        applyPendingHue();
+    }
+
+    /* Call before any operation that changes our contents:
+     * dependents sample the old contents, then our own pending
+     * work lands so the new operation is ordered after it */
+    void prepareModify()
+    {
+        flushPoint();
+        flushBlitQueue();
+        flushFillQueue();
+        applyPendingHue();
+    }
+
+    /* Returns the texture for the given tile of the mega surface,
+     * uploading it first if it isn't resident */
+    TEXFBO &requestMegaTile(int tx, int ty)
+    {
+        if (megaTiles.tiles.empty())
+        {
+            megaTiles.cols = (megaSurface->w + megaTileSize - 1) / megaTileSize;
+            megaTiles.rows = (megaSurface->h + megaTileSize - 1) / megaTileSize;
+            megaTiles.tiles.resize(megaTiles.cols * megaTiles.rows);
+        }
+
+        MegaTile &tile = megaTiles.tiles[ty * megaTiles.cols + tx];
+        tile.stamp = ++megaTiles.clock;
+
+        if (tile.resident)
+            return tile.tex;
+
+        int x = tx * megaTileSize;
+        int y = ty * megaTileSize;
+        int w = std::min<int>(megaTileSize, megaSurface->w - x);
+        int h = std::min<int>(megaTileSize, megaSurface->h - y);
+
+        tile.tex = shState->texPool().request(w, h);
+
+        TEX::bind(tile.tex.tex);
+        GLMeta::subRectImageUpload(megaSurface->w, x, y, 0, 0, w, h, megaSurface, GL_RGBA);
+        GLMeta::subRectImageEnd();
+
+        tile.resident = true;
+        megaTiles.residentBytes += (size_t) tile.tex.width * tile.tex.height * 4;
+
+        return tile.tex;
+    }
+
+    /* Evicts least recently used tiles until the configured
+     * budget is met again; tiles touched at or after 'opStart'
+     * (ie. by the current operation) are never evicted */
+    void evictColdMegaTiles(uint64_t opStart)
+    {
+        int budgetMB = shState->config().megaTileBudget;
+        if (budgetMB <= 0)
+            return;
+
+        size_t budget = (size_t) budgetMB * 1024 * 1024;
+
+        while (megaTiles.residentBytes > budget)
+        {
+            MegaTile *coldest = 0;
+
+            for (size_t i = 0; i < megaTiles.tiles.size(); ++i)
+            {
+                MegaTile &t = megaTiles.tiles[i];
+                if (t.resident && (!coldest || t.stamp < coldest->stamp))
+                    coldest = &t;
+            }
+
+            if (!coldest || coldest->stamp >= opStart)
+                break;
+
+            megaTiles.residentBytes -= (size_t) coldest->tex.width * coldest->tex.height * 4;
+            shState->texPool().release(coldest->tex);
+            coldest->tex = TEXFBO();
+            coldest->resident = false;
+        }
+    }
+
+    void releaseMegaTiles()
+    {
+        for (size_t i = 0; i < megaTiles.tiles.size(); ++i)
+            if (megaTiles.tiles[i].resident)
+                shState->texPool().release(megaTiles.tiles[i].tex);
+
+        megaTiles.tiles.clear();
+        megaTiles.residentBytes = 0;
+    }
+
+    /* Kicks off an asynchronous glReadPixels into the next ring
+     * buffer; returns immediately while the GPU performs the copy */
+    void queueRawReadback()
+    {
+        if (!::gl.pbos)
+            return;
+
+        int size = gl.width * gl.height * 4;
+
+        if (readback.bufs[0] == 0)
+            ::gl.GenBuffers(readbackBufCount, readback.bufs);
+
+        ::gl.BindBuffer(GL_PIXEL_PACK_BUFFER, readback.bufs[readback.nextBuf]);
+        ::gl.BufferData(GL_PIXEL_PACK_BUFFER, size, 0, GL_STREAM_READ);
+
+        FBO::bind(gl.fbo);
+        ::gl.ReadPixels(0, 0, gl.width, gl.height, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+
+        ::gl.BindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+        readback.pendingBuf = readback.nextBuf;
+        readback.nextBuf = (readback.nextBuf + 1) % readbackBufCount;
+        readback.pendingSize = size;
+        readback.pending = true;
+    }
+
+    /* Copies out a previously queued readback, if one is still
+     * valid. Only blocks for however long the transfer has left */
+    bool consumeRawReadback(void *output, int size)
+    {
+        if (!readback.pending || readback.pendingSize != size)
+            return false;
+
+        readback.pending = false;
+
+        ::gl.BindBuffer(GL_PIXEL_PACK_BUFFER, readback.bufs[readback.pendingBuf]);
+        void *data = ::gl.MapBufferRange(GL_PIXEL_PACK_BUFFER, 0, size, GL_MAP_READ_BIT);
+
+        bool ok = (data != 0);
+        if (ok)
+        {
+            memcpy(output, data, size);
+            ::gl.UnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        }
+
+        ::gl.BindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+        return ok;
     }
     
     TEXFBO &getGLTypes() {
@@ -282,6 +741,14 @@ struct BitmapPrivate
     
     void prepare()
     {
+        flushDeferredOps();
+
+        if (hiresWanted)
+        {
+            hiresWanted = false;
+            loadHires();
+        }
+
         if (!animation.enabled || !animation.playing) return;
         
         animation.updateTimer();
@@ -293,6 +760,26 @@ struct BitmapPrivate
                                        format->Rmask, format->Gmask,
                                        format->Bmask, format->Amask);
     }
+
+    /* Makes sure the cached client-side copy of the bitmap
+     * exists, reading the whole texture back in one go */
+    void ensureSurface()
+    {
+        flushDeferredOps();
+
+        if (surface)
+            return;
+
+        allocSurface();
+
+        FBO::bind(gl.fbo);
+
+        glState.viewport.pushSet(IntRect(0, 0, gl.width, gl.height));
+
+        ::gl.ReadPixels(0, 0, gl.width, gl.height, GL_RGBA, GL_UNSIGNED_BYTE, surface->pixels);
+
+        glState.viewport.pop();
+    }
     
     void clearTaintedArea()
     {
@@ -334,9 +821,65 @@ struct BitmapPrivate
         return result != PIXMAN_REGION_OUT;
     }
     
+    /* Materializes the deferred hires replacement. The preload
+     * worker has usually finished decoding by the time the first
+     * draw lands here, so this is mostly an upload */
+    void loadHires()
+    {
+        if (selfHires || hiresSource.empty())
+            return;
+
+        try
+        {
+            Bitmap *b = new Bitmap(hiresSource.c_str());
+            b->setLores(self);
+            selfHires = b;
+            gl.selfHires = &b->getGLTypes();
+            hiresStamp = ++hiresClock;
+            hiresResident.push_back(this);
+        }
+        catch (const Exception &)
+        {
+            Debug() << "No high-res Bitmap found at" << hiresSource.c_str();
+            hiresSource.clear();
+        }
+    }
+
+    /* Residency eviction; the source path stays, so the next
+     * use loads it again */
+    void unloadHires()
+    {
+        if (!selfHires || hiresSource.empty())
+            return;
+
+        delete selfHires;
+        selfHires = 0;
+        gl.selfHires = 0;
+
+        std::vector<BitmapPrivate*>::iterator pos =
+                std::find(hiresResident.begin(), hiresResident.end(), this);
+
+        if (pos != hiresResident.end())
+            hiresResident.erase(pos);
+    }
+
     void bindTexture(ShaderBase &shader, bool substituteLoresSize = true)
     {
+        flushDeferredOps();
+
+        if (!selfHires && !hiresSource.empty())
+        {
+            /* Mid-composite is the wrong moment to allocate and
+             * upload textures; note the demand and materialize
+             * in the next prepare phase */
+            if (sceneCompositing)
+                hiresWanted = true;
+            else
+                loadHires();
+        }
+
         if (selfHires) {
+            hiresStamp = ++hiresClock;
             selfHires->bindTex(shader, substituteLoresSize);
             return;
         }
@@ -383,22 +926,6 @@ struct BitmapPrivate
         glState.blend.pop();
     }
     
-    void fillRect(const IntRect &rect,
-                  const Vec4 &color)
-    {
-        bindFBO();
-        
-        glState.scissorTest.pushSet(true);
-        glState.scissorBox.pushSet(normalizedRect(rect));
-        glState.clearColor.pushSet(color);
-        
-        FBO::clear();
-        
-        glState.clearColor.pop();
-        glState.scissorBox.pop();
-        glState.scissorTest.pop();
-    }
-    
     static void ensureFormat(SDL_Surface *&surf, Uint32 format)
     {
         if (surf->format->format == format)
@@ -416,40 +943,340 @@ struct BitmapPrivate
             SDL_FreeSurface(surface);
             surface = 0;
         }
-        
+
+        /* Any queued readback no longer reflects the contents */
+        readback.pending = false;
+
+        shState->graphics().markSceneDirty();
+
         self->modified();
     }
 };
 
-struct BitmapOpenHandler : FileSystem::OpenHandler
+/* Determines the intended image format from the filename
+ * extension: 0 = BMP, 1 = PNG, 2 = JPEG */
+static int saveFiletypeFromFilename(const char *filename)
 {
-    // Non-GIF
-    SDL_Surface *surface;
-    
-    // GIF
-    std::string error;
-    gif_animation *gif;
-    unsigned char *gif_data;
-    size_t gif_data_size;
-    
-    
-    BitmapOpenHandler()
-    : surface(0), gif(0), gif_data(0), gif_data_size(0)
-    {}
-    
-    bool tryRead(SDL_RWops &ops, const char *ext)
+    const char *period = strrchr(filename, '.');
+    int filetype = 0;
+    if (period) {
+        period++;
+        std::string ext;
+        for (int i = 0; i < (int)strlen(period); i++) {
+            ext += tolower(period[i]);
+        }
+        
+        if (!ext.compare("png")) {
+            filetype = 1;
+        }
+        else if (!ext.compare("jpg") || !ext.compare("jpeg")) {
+            filetype = 2;
+        }
+    }
+    return filetype;
+}
+
+static int encodeSurface(SDL_Surface *surf, const char *filename, int filetype)
+{
+    switch (filetype) {
+        case 2:
+            return IMG_SaveJPG(surf, filename, 90);
+        case 1:
+            return IMG_SavePNG(surf, filename);
+        case 0: default:
+            return SDL_SaveBMP(surf, filename);
+    }
+}
+
+/* Background encoder for Bitmap#to_file_async: the pixels are
+ * read back on the calling thread (cheap), encoding and disk
+ * I/O (the expensive part, ~tens of ms for PNG) happen on a
+ * single worker thread. Failures are logged, not raised - the
+ * caller has long moved on */
+struct BitmapSaveWorker
+{
+    struct Job
     {
-        if (IMG_isGIF(&ops)) {
-            // Use libnsgif to initialise the gif data
-            gif = new gif_animation;
-            
-            gif_bitmap_callback_vt gif_bitmap_callbacks = {
-                gif_bitmap_create,
-                gif_bitmap_destroy,
-                gif_bitmap_get_buffer,
-                gif_bitmap_set_opaque,
-                gif_bitmap_test_opaque,
-                gif_bitmap_modified
+        SDL_Surface *surf;
+        std::string filename;
+        int filetype;
+    };
+
+    SDL_mutex *mutex;
+    SDL_cond *cond;
+    std::vector<Job> queue;
+    int pending;
+    SDL_Thread *thread;
+
+    BitmapSaveWorker()
+        : pending(0), thread(0)
+    {
+        mutex = SDL_CreateMutex();
+        cond = SDL_CreateCond();
+    }
+
+    /* Intentionally leaked, same as the preload cache */
+    static BitmapSaveWorker &instance()
+    {
+        static BitmapSaveWorker *w = new BitmapSaveWorker;
+        return *w;
+    }
+
+    void enqueue(SDL_Surface *surf, const std::string &filename, int filetype)
+    {
+        Job job = { surf, filename, filetype };
+
+        SDL_LockMutex(mutex);
+
+        if (!thread)
+            thread = createSDLThread
+                <BitmapSaveWorker, &BitmapSaveWorker::workerFun>(this, "bitmap_save");
+
+        queue.push_back(job);
+        ++pending;
+
+        SDL_CondBroadcast(cond);
+        SDL_UnlockMutex(mutex);
+    }
+
+    int pendingCount()
+    {
+        SDL_LockMutex(mutex);
+        int ret = pending;
+        SDL_UnlockMutex(mutex);
+
+        return ret;
+    }
+
+    void workerFun()
+    {
+        while (true)
+        {
+            SDL_LockMutex(mutex);
+
+            while (queue.empty())
+                SDL_CondWait(cond, mutex);
+
+            Job job = queue.front();
+            queue.erase(queue.begin());
+
+            SDL_UnlockMutex(mutex);
+
+            if (encodeSurface(job.surf, job.filename.c_str(), job.filetype))
+                Debug() << "Async bitmap save failed:" << job.filename << ":" << SDL_GetError();
+
+            SDL_FreeSurface(job.surf);
+
+            SDL_LockMutex(mutex);
+            --pending;
+            SDL_CondBroadcast(cond);
+            SDL_UnlockMutex(mutex);
+        }
+    }
+};
+
+/* Background decode pool for Bitmap.preload: images are read and
+ * decoded on worker threads, and a later Bitmap construction for
+ * the same filename picks up the finished surface instead of
+ * paying for disk and decoder on the Ruby thread */
+struct BitmapPreloadCache
+{
+    enum Status
+    {
+        Queued,      /* waiting for / inside a worker */
+        Ready,       /* decoded surface available */
+        Unsupported  /* GIF or failed; take the synchronous path */
+    };
+
+    struct Entry
+    {
+        Status status;
+        SDL_Surface *surface;
+    };
+
+    SDL_mutex *mutex;
+    SDL_cond *cond;
+    std::vector<std::string> queue;
+    BoostHash<std::string, Entry> entries;
+    std::vector<SDL_Thread*> workers;
+
+    BitmapPreloadCache()
+    {
+        mutex = SDL_CreateMutex();
+        cond = SDL_CreateCond();
+    }
+
+    /* Intentionally leaked: the workers live for the rest of
+     * the process, so the sync primitives have to as well */
+    static BitmapPreloadCache &instance()
+    {
+        static BitmapPreloadCache *c = new BitmapPreloadCache;
+        return *c;
+    }
+
+    void preload(const char *filename)
+    {
+        std::string key(filename);
+
+        SDL_LockMutex(mutex);
+
+        if (workers.empty())
+        {
+            int count = clamp(SDL_GetCPUCount() - 1, 1, 3);
+
+            for (int i = 0; i < count; ++i)
+                workers.push_back(createSDLThread
+                    <BitmapPreloadCache, &BitmapPreloadCache::workerFun>(this, "bitmap_preload"));
+        }
+
+        if (!entries.contains(key))
+        {
+            Entry e = { Queued, 0 };
+            entries.insert(key, e);
+            queue.push_back(key);
+            SDL_CondBroadcast(cond);
+        }
+
+        SDL_UnlockMutex(mutex);
+    }
+
+    /* Non-blocking: whether a decode for this file is still
+     * waiting on / inside a worker */
+    bool pending(const char *filename)
+    {
+        std::string key(filename);
+        bool ret;
+
+        SDL_LockMutex(mutex);
+        ret = entries.contains(key) && entries[key].status == Queued;
+        SDL_UnlockMutex(mutex);
+
+        return ret;
+    }
+
+    /* Takes a decoded surface out of the cache, waiting for an
+     * in-flight decode to finish first. Returns false if the
+     * file was never preloaded or needs the synchronous path */
+    bool take(const char *filename, SDL_Surface *&out)
+    {
+        std::string key(filename);
+        bool ret = false;
+
+        SDL_LockMutex(mutex);
+
+        while (entries.contains(key) && entries[key].status == Queued)
+            SDL_CondWait(cond, mutex);
+
+        if (entries.contains(key))
+        {
+            Entry e = entries[key];
+            entries.remove(key);
+
+            if (e.status == Ready)
+            {
+                out = e.surface;
+                ret = true;
+            }
+        }
+
+        SDL_UnlockMutex(mutex);
+
+        return ret;
+    }
+
+    struct WorkerOpenHandler : FileSystem::OpenHandler
+    {
+        SDL_Surface *surface;
+
+        WorkerOpenHandler() : surface(0) {}
+
+        bool tryRead(SDL_RWops &ops, const char *ext)
+        {
+            /* Animated GIFs keep the synchronous path */
+            if (IMG_isGIF(&ops))
+            {
+                SDL_RWclose(&ops);
+                return true;
+            }
+
+            surface = IMG_LoadTyped_RW(&ops, 1, ext);
+            return surface != 0;
+        }
+    };
+
+    void workerFun()
+    {
+        while (true)
+        {
+            SDL_LockMutex(mutex);
+
+            while (queue.empty())
+                SDL_CondWait(cond, mutex);
+
+            std::string key = queue.front();
+            queue.erase(queue.begin());
+
+            SDL_UnlockMutex(mutex);
+
+            SDL_Surface *surf = 0;
+
+            try
+            {
+                WorkerOpenHandler handler;
+                shState->fileSystem().openRead(handler, key.c_str());
+                surf = handler.surface;
+            }
+            catch (const Exception &e)
+            {
+                /* Missing / broken file: the synchronous path
+                 * reports the error to the script */
+            }
+
+            /* Move the format conversion off the Ruby thread too */
+            if (surf)
+                BitmapPrivate::ensureFormat(surf, SDL_PIXELFORMAT_ABGR8888);
+
+            SDL_LockMutex(mutex);
+
+            Entry &e = entries[key];
+            e.status = surf ? Ready : Unsupported;
+            e.surface = surf;
+
+            SDL_CondBroadcast(cond);
+            SDL_UnlockMutex(mutex);
+        }
+    }
+};
+
+struct BitmapOpenHandler : FileSystem::OpenHandler
+{
+    // Non-GIF
+    SDL_Surface *surface;
+    
+    // GIF
+    std::string error;
+    gif_animation *gif;
+    unsigned char *gif_data;
+    size_t gif_data_size;
+    
+    
+    BitmapOpenHandler()
+    : surface(0), gif(0), gif_data(0), gif_data_size(0)
+    {}
+    
+    bool tryRead(SDL_RWops &ops, const char *ext)
+    {
+        if (IMG_isGIF(&ops)) {
+            // Use libnsgif to initialise the gif data
+            gif = new gif_animation;
+            
+            gif_bitmap_callback_vt gif_bitmap_callbacks = {
+                gif_bitmap_create,
+                gif_bitmap_destroy,
+                gif_bitmap_get_buffer,
+                gif_bitmap_set_opaque,
+                gif_bitmap_test_opaque,
+                gif_bitmap_modified
             };
             
             gif_create(gif, &gif_bitmap_callbacks);
@@ -493,21 +1320,29 @@ Bitmap::Bitmap(const char *filename)
     std::string hiresPrefix = "Hires/";
     std::string filenameStd = filename;
     Bitmap *hiresBitmap = nullptr;
+    std::string hiresSource;
     // TODO: once C++20 is required, switch to filenameStd.starts_with(hiresPrefix)
     if (shState->config().enableHires && filenameStd.compare(0, hiresPrefix.size(), hiresPrefix) != 0) {
         // Look for a high-res version of the file.
         std::string hiresFilename = hiresPrefix + filenameStd;
-        try {
-            hiresBitmap = new Bitmap(hiresFilename.c_str());
-            hiresBitmap->setLores(this);
-        }
-        catch (const Exception &e)
-        {
-            Debug() << "No high-res Bitmap found at" << hiresFilename;
-            hiresBitmap = nullptr;
+        /* Loading is deferred until the bitmap is actually used;
+         * the background decode starts warming right away */
+        if (shState->fileSystem().existsSupplemented(hiresFilename.c_str())) {
+            Bitmap::preload(hiresFilename.c_str());
+            hiresSource = hiresFilename;
         }
     }
 
+    /* A preloaded decode for this file skips the synchronous
+     * disk read and decoder entirely */
+    SDL_Surface *preloaded = 0;
+    if (BitmapPreloadCache::instance().take(filename, preloaded))
+    {
+        initFromSurface(preloaded, hiresBitmap, false);
+        p->hiresSource = hiresSource;
+        return;
+    }
+
     BitmapOpenHandler handler;
     try {
         shState->fileSystem().openRead(handler, filename);
@@ -558,7 +1393,7 @@ Bitmap::Bitmap(const char *filename)
             }
             
             TEX::bind(texfbo.tex);
-            TEX::uploadImage(handler.gif->width, handler.gif->height, handler.gif->frame_image, GL_RGBA);
+            GLMeta::stagedTexImage(handler.gif->width, handler.gif->height, handler.gif->frame_image, GL_RGBA);
             gif_finalise(handler.gif);
             delete handler.gif;
             delete handler.gif_data;
@@ -567,6 +1402,7 @@ Bitmap::Bitmap(const char *filename)
             if (p->selfHires != nullptr) {
                 p->gl.selfHires = &p->selfHires->getGLTypes();
             }
+            p->hiresSource = hiresSource;
             p->addTaintedArea(rect());
             return;
         }
@@ -604,7 +1440,7 @@ Bitmap::Bitmap(const char *filename)
             
             TEXFBO texfbo;
             try {
-                texfbo = shState->texPool().request(p->animation.width, p->animation.height);
+                texfbo = allocFrameTex(p->animation.width, p->animation.height);
             }
             catch (const Exception &e)
             {
@@ -618,13 +1454,14 @@ Bitmap::Bitmap(const char *filename)
             }
             
             TEX::bind(texfbo.tex);
-            TEX::uploadImage(p->animation.width, p->animation.height, handler.gif->frame_image, GL_RGBA);
+            GLMeta::stagedTexImage(p->animation.width, p->animation.height, handler.gif->frame_image, GL_RGBA);
             p->animation.frames.push_back(texfbo);
         }
         
         gif_finalise(handler.gif);
         delete handler.gif;
         delete handler.gif_data;
+        p->hiresSource = hiresSource;
         p->addTaintedArea(rect());
         return;
     }
@@ -632,6 +1469,7 @@ Bitmap::Bitmap(const char *filename)
     SDL_Surface *imgSurf = handler.surface;
 
     initFromSurface(imgSurf, hiresBitmap, false);
+    p->hiresSource = hiresSource;
 }
 
 Bitmap::Bitmap(int width, int height, bool isHires)
@@ -707,7 +1545,7 @@ Bitmap::Bitmap(void *pixeldata, int width, int height)
         p->gl = tex;
         
         TEX::bind(p->gl.tex);
-        TEX::uploadImage(p->gl.width, p->gl.height, surface->pixels, GL_RGBA);
+        GLMeta::stagedTexImage(p->gl.width, p->gl.height, surface->pixels, GL_RGBA);
         
         SDL_FreeSurface(surface);
     }
@@ -737,10 +1575,12 @@ Bitmap::Bitmap(const Bitmap &other, int frame)
             throw e;
         }
         
+        other.p->flushDeferredOps();
+
         GLMeta::blitBegin(p->gl, false, SameScale);
         // Blit just the current frame of the other animated bitmap
         if (!other.isAnimated() || frame == -1) {
-            GLMeta::blitSource(other.getGLTypes(), SameScale);
+            GLMeta::blitSource(other.p->getGLTypes(), SameScale);
         }
         else {
             auto &frames = other.getFrames();
@@ -762,7 +1602,7 @@ Bitmap::Bitmap(const Bitmap &other, int frame)
         for (TEXFBO &sourceframe : other.getFrames()) {
             TEXFBO newframe;
             try {
-                newframe = shState->texPool().request(p->animation.width, p->animation.height);
+                newframe = allocFrameTex(p->animation.width, p->animation.height);
             } catch(const Exception &e) {
                 releaseResources();
                 throw e;
@@ -873,7 +1713,7 @@ void Bitmap::initFromSurface(SDL_Surface *imgSurf, Bitmap *hiresBitmap, bool for
         }
         
         TEX::bind(p->gl.tex);
-        TEX::uploadImage(p->gl.width, p->gl.height, imgSurf->pixels, GL_RGBA);
+        GLMeta::stagedTexImage(p->gl.width, p->gl.height, imgSurf->pixels, GL_RGBA);
         
         SDL_FreeSurface(imgSurf);
     }
@@ -912,6 +1752,19 @@ int Bitmap::height() const
 bool Bitmap::hasHires() const{
     guardDisposed();
 
+    /* Every read/write mirror runs through this query, so a
+     * deferred (or evicted) replacement materializes here and
+     * the mirrored operation sees it like an eager load would.
+     * Draw-path queries during a composite pass only register
+     * demand; they get the replacement next frame */
+    if (!p->selfHires && !p->hiresSource.empty())
+    {
+        if (sceneCompositing)
+            p->hiresWanted = true;
+        else
+            p->loadHires();
+    }
+
     return p->selfHires;
 }
 
@@ -1092,14 +1945,79 @@ void Bitmap::stretchBlt(IntRect destRect,
         smooth = false;
     }
 
+    /* Bitmaps holding queued blits that sample from us must
+     * flush them before this operation changes our contents */
+    p->flushPoint();
+
     if (!srcSurf && opacity == 255 && !touchesTaintedArea)
     {
-        /* Fast blit */
         // TODO: Use bitmapSmoothScaling/bitmapSmoothScalingDown configs for this.
+        if (!p->animation.enabled && !source.p->animation.enabled)
+        {
+            /* Fast blit, deferred: recorded and replayed as one
+             * batched draw when we're next sampled or modified */
+            p->enqueueBlit(source.p, sourceRect, destRect, smooth);
+        }
+        else
+        {
+            /* Fast blit, immediate (animated bitmaps involved) */
+            source.p->flushDeferredOps();
+
+            GLMeta::blitBegin(getGLTypes());
+            GLMeta::blitSource(source.p->getGLTypes());
+            GLMeta::blitRectangle(sourceRect, destRect, smooth);
+            GLMeta::blitEnd();
+        }
+    }
+    else if (srcSurf && opacity == 255 && !touchesTaintedArea &&
+             sourceRect.w > 0 && sourceRect.h > 0 &&
+             glState.caps.maxTexSize >= BitmapPrivate::megaTileSize)
+    {
+        /* Mega surface fast path: stream the region from cached
+         * tiles instead of uploading it wholesale every call.
+         * destRect may still mirror */
+        const int tileSize = BitmapPrivate::megaTileSize;
+        uint64_t opStart = source.p->megaTiles.clock + 1;
+
+        int tx0 = sourceRect.x / tileSize;
+        int ty0 = sourceRect.y / tileSize;
+        int tx1 = (sourceRect.x + sourceRect.w - 1) / tileSize;
+        int ty1 = (sourceRect.y + sourceRect.h - 1) / tileSize;
+
+        /* Upload all needed tiles up front, so a texture pool
+         * failure cannot strike between blitBegin and blitEnd */
+        for (int ty = ty0; ty <= ty1; ++ty)
+            for (int tx = tx0; tx <= tx1; ++tx)
+                source.p->requestMegaTile(tx, ty);
+
         GLMeta::blitBegin(getGLTypes());
-        GLMeta::blitSource(source.getGLTypes());
-        GLMeta::blitRectangle(sourceRect, destRect, smooth);
+
+        for (int ty = ty0; ty <= ty1; ++ty)
+            for (int tx = tx0; tx <= tx1; ++tx)
+            {
+                /* Intersection of this tile with the source rect */
+                int ix = std::max(sourceRect.x, tx * tileSize);
+                int iy = std::max(sourceRect.y, ty * tileSize);
+                int iw = std::min(sourceRect.x + sourceRect.w, (tx + 1) * tileSize) - ix;
+                int ih = std::min(sourceRect.y + sourceRect.h, (ty + 1) * tileSize) - iy;
+
+                /* Proportional mapping into the dest rect; edges
+                 * between adjacent tiles share the same formula,
+                 * so the sub-rects neither gap nor overlap */
+                IntRect dst;
+                dst.x = destRect.x + ((ix - sourceRect.x) * destRect.w) / sourceRect.w;
+                dst.y = destRect.y + ((iy - sourceRect.y) * destRect.h) / sourceRect.h;
+                dst.w = destRect.x + ((ix + iw - sourceRect.x) * destRect.w) / sourceRect.w - dst.x;
+                dst.h = destRect.y + ((iy + ih - sourceRect.y) * destRect.h) / sourceRect.h - dst.y;
+
+                GLMeta::blitSource(source.p->requestMegaTile(tx, ty));
+                GLMeta::blitRectangle(IntRect(ix - tx * tileSize, iy - ty * tileSize, iw, ih),
+                                      dst, smooth);
+            }
+
         GLMeta::blitEnd();
+
+        source.p->evictColdMegaTiles(opStart);
     }
     else
     {
@@ -1232,9 +2150,11 @@ void Bitmap::stretchBlt(IntRect destRect,
             
             TEXFBO &gpTex = shState->gpTexFBO(abs(destRect.w), abs(destRect.h));
             Vec2i gpTexSize;
-            
+
+            p->flushDeferredOps();
+
             GLMeta::blitBegin(gpTex, false, SameScale);
-            GLMeta::blitSource(getGLTypes(), SameScale);
+            GLMeta::blitSource(p->getGLTypes(), SameScale);
             GLMeta::blitRectangle(destRect, IntRect(0, 0, abs(destRect.w), abs(destRect.h)));
             GLMeta::blitEnd();
             
@@ -1336,6 +2256,12 @@ void Bitmap::fillRect(const IntRect &rect, const Vec4 &color)
     GUARD_MEGA;
     GUARD_ANIMATED;
     
+    /* Deliberately not prepareModify: the fill is recorded
+     * into the fill queue, batching with neighbouring fills */
+    p->flushPoint();
+    p->flushBlitQueue();
+    p->applyPendingHue();
+    
     if (hasHires()) {
         int destX, destY, destWidth, destHeight;
         destX = rect.x * p->selfHires->width() / width();
@@ -1346,7 +2272,7 @@ void Bitmap::fillRect(const IntRect &rect, const Vec4 &color)
         p->selfHires->fillRect(IntRect(destX, destY, destWidth, destHeight), color);
     }
 
-    p->fillRect(rect, color);
+    p->enqueueFill(normalizedRect(rect), color, color, false);
     
     if (color.w == 0)
     /* Clear op */
@@ -1375,6 +2301,12 @@ void Bitmap::gradientFillRect(const IntRect &rect,
     GUARD_MEGA;
     GUARD_ANIMATED;
     
+    /* Deliberately not prepareModify: the fill is recorded
+     * into the fill queue, batching with neighbouring fills */
+    p->flushPoint();
+    p->flushBlitQueue();
+    p->applyPendingHue();
+    
     if (hasHires()) {
         int destX, destY, destWidth, destHeight;
         destX = rect.x * p->selfHires->width() / width();
@@ -1385,35 +2317,7 @@ void Bitmap::gradientFillRect(const IntRect &rect,
         p->selfHires->gradientFillRect(IntRect(destX, destY, destWidth, destHeight), color1, color2, vertical);
     }
 
-    SimpleColorShader &shader = shState->shaders().simpleColor;
-    shader.bind();
-    shader.setTranslation(Vec2i());
-    
-    Quad &quad = shState->gpQuad();
-    
-    if (vertical)
-    {
-        quad.vert[0].color = color1;
-        quad.vert[1].color = color1;
-        quad.vert[2].color = color2;
-        quad.vert[3].color = color2;
-    }
-    else
-    {
-        quad.vert[0].color = color1;
-        quad.vert[3].color = color1;
-        quad.vert[1].color = color2;
-        quad.vert[2].color = color2;
-    }
-    
-    quad.setPosRect(rect);
-    
-    p->bindFBO();
-    p->pushSetViewport(shader);
-    
-    p->blitQuad(quad);
-    
-    p->popViewport();
+    p->enqueueFill(rect, color1, color2, vertical);
     
     p->addTaintedArea(rect);
     
@@ -1432,6 +2336,12 @@ void Bitmap::clearRect(const IntRect &rect)
     GUARD_MEGA;
     GUARD_ANIMATED;
     
+    /* Deliberately not prepareModify: the clear is recorded
+     * into the fill queue, batching with neighbouring fills */
+    p->flushPoint();
+    p->flushBlitQueue();
+    p->applyPendingHue();
+    
     if (hasHires()) {
         int destX, destY, destWidth, destHeight;
         destX = rect.x * p->selfHires->width() / width();
@@ -1442,7 +2352,7 @@ void Bitmap::clearRect(const IntRect &rect)
         p->selfHires->clearRect(IntRect(destX, destY, destWidth, destHeight));
     }
 
-    p->fillRect(rect, Vec4());
+    p->enqueueFill(normalizedRect(rect), Vec4(), Vec4(), false);
     
     p->onModified();
 }
@@ -1453,13 +2363,24 @@ void Bitmap::blur()
     
     GUARD_MEGA;
     GUARD_ANIMATED;
-    
+
+    /* Deliberately not prepareModify: a pending hue rotation
+     * must survive up to the pass selection below */
+    p->flushPoint();
+    p->flushBlitQueue();
+    p->flushFillQueue();
+
     if (hasHires()) {
         p->selfHires->blur();
     }
 
     // TODO: Is there some kind of blur radius that we need to handle for high-res mode?
 
+    /* A pending hue rotation is not applied beforehand but
+     * fused into the first blur pass below */
+    int hue = p->pendingHue;
+    p->pendingHue = 0;
+
     Quad &quad = shState->gpQuad();
     FloatRect rect(0, 0, width(), height());
     quad.setTexPosRect(rect, rect);
@@ -1467,7 +2388,6 @@ void Bitmap::blur()
     TEXFBO auxTex = shState->texPool().request(width(), height());
     
     BlurShader &shader = shState->shaders().blur;
-    BlurShader::HPass &pass1 = shader.pass1;
     BlurShader::VPass &pass2 = shader.pass2;
     
     glState.blend.pushSet(false);
@@ -1476,9 +2396,21 @@ void Bitmap::blur()
     TEX::bind(p->gl.tex);
     FBO::bind(auxTex.fbo);
     
-    pass1.bind();
-    pass1.setTexSize(Vec2i(width(), height()));
-    pass1.applyViewportProj();
+    if ((hue % 360) != 0)
+    {
+        BlurShader::HuePass &pass1 = shader.huePass;
+        pass1.bind();
+        pass1.setTexSize(Vec2i(width(), height()));
+        pass1.setHueAdjust(wrapRange(hue, 0, 359) / 360.0f);
+        pass1.applyViewportProj();
+    }
+    else
+    {
+        BlurShader::HPass &pass1 = shader.pass1;
+        pass1.bind();
+        pass1.setTexSize(Vec2i(width(), height()));
+        pass1.applyViewportProj();
+    }
     
     quad.draw();
     
@@ -1506,6 +2438,8 @@ void Bitmap::radialBlur(int angle, int divisions)
     GUARD_MEGA;
     GUARD_ANIMATED;
     
+    p->prepareModify();
+    
     if (hasHires()) {
         p->selfHires->radialBlur(angle, divisions);
         return;
@@ -1607,6 +2541,11 @@ void Bitmap::clear()
     GUARD_MEGA;
     GUARD_ANIMATED;
     
+    /* Everything pending is overwritten anyway; only
+     * dependents need to sample the old contents first */
+    p->flushPoint();
+    p->dropDeferredOps();
+    
     if (hasHires()) {
         p->selfHires->clear();
     }
@@ -1685,19 +2624,8 @@ Color Bitmap::getPixel(int x, int y) const
     if (x < 0 || y < 0 || x >= width() || y >= height())
         return Vec4();
 
-    if (!p->surface)
-    {
-        p->allocSurface();
-        
-        FBO::bind(p->gl.fbo);
-        
-        glState.viewport.pushSet(IntRect(0, 0, width(), height()));
-        
-        gl.ReadPixels(0, 0, width(), height(), GL_RGBA, GL_UNSIGNED_BYTE, p->surface->pixels);
-        
-        glState.viewport.pop();
-    }
-    
+    p->ensureSurface();
+
     uint32_t pixel = getPixelAt(p->surface, p->format, x, y);
     
     return Color((pixel >> p->format->Rshift) & 0xFF,
@@ -1706,60 +2634,147 @@ Color Bitmap::getPixel(int x, int y) const
                  (pixel >> p->format->Ashift) & 0xFF);
 }
 
-void Bitmap::setPixel(int x, int y, const Color &color)
+void Bitmap::getPixels(const IntRect &rect, void *output) const
 {
     guardDisposed();
-    
+
     GUARD_MEGA;
     GUARD_ANIMATED;
-    
+
     if (hasHires()) {
-        Debug() << "GAME BUG: Game is calling setPixel on low-res Bitmap; you may want to patch the game to improve graphics quality.";
+        Debug() << "GAME BUG: Game is calling getPixels on low-res Bitmap; you may want to patch the game to improve graphics quality.";
+    }
 
-        int xHires = x * p->selfHires->width() / width();
-        int yHires = y * p->selfHires->height() / height();
+    IntRect norm = normalizedRect(rect);
 
-        int w = p->selfHires->width() / width();
-        int h = p->selfHires->height() / height();
+    if (norm.x < 0 || norm.y < 0 ||
+        norm.x + norm.w > width() || norm.y + norm.h > height())
+        throw Exception(Exception::MKXPError, "Pixel region (%i, %i, %i, %i) out of bounds (%ix%i)",
+                        rect.x, rect.y, rect.w, rect.h, width(), height());
 
-        if (w >= 1 && h >= 1) {
-            for (int thisX = xHires; thisX < xHires+w && thisX < p->selfHires->width(); thisX++) {
-                for (int thisY = yHires; thisY < yHires+h && thisY < p->selfHires->height(); thisY++) {
-                    p->selfHires->setPixel(thisX, thisY, color);
-                }
-            }
-        }
-    }
+    if (norm.w == 0 || norm.h == 0)
+        return;
 
-    uint8_t pixel[] =
-    {
-        (uint8_t) clamp<double>(color.red,   0, 255),
-        (uint8_t) clamp<double>(color.green, 0, 255),
-        (uint8_t) clamp<double>(color.blue,  0, 255),
-        (uint8_t) clamp<double>(color.alpha, 0, 255)
-    };
-    
-    TEX::bind(p->gl.tex);
-    TEX::uploadSubImage(x, y, 1, 1, &pixel, GL_RGBA);
-    
-    p->addTaintedArea(IntRect(x, y, 1, 1));
-    
-    /* Setting just a single pixel is no reason to throw away the
-     * whole cached surface; we can just apply the same change */
-    
-    if (p->surface)
+    /* Amortize repeated region reads through the same cached
+     * client-side copy that getPixel uses; it is invalidated
+     * whenever the bitmap is modified */
+    p->ensureSurface();
+
+    uint8_t *dst = (uint8_t*) output;
+    size_t rowSize = norm.w * p->format->BytesPerPixel;
+
+    for (int row = 0; row < norm.h; ++row)
     {
-        uint32_t &surfPixel = getPixelAt(p->surface, p->format, x, y);
-        surfPixel = SDL_MapRGBA(p->format, pixel[0], pixel[1], pixel[2], pixel[3]);
+        uint8_t *src = (uint8_t*) p->surface->pixels
+                       + (norm.y + row) * p->surface->pitch
+                       + norm.x * p->format->BytesPerPixel;
+        memcpy(dst + row * rowSize, src, rowSize);
     }
-    
-    p->onModified(false);
 }
 
-bool Bitmap::getRaw(void *output, int output_size)
+void Bitmap::setPixels(const IntRect &rect, const void *pixeldata)
 {
-    if (output_size != width()*height()*4) return false;
-    
+    guardDisposed();
+
+    GUARD_MEGA;
+    GUARD_ANIMATED;
+
+    p->prepareModify();
+
+    if (hasHires()) {
+        Debug() << "GAME BUG: Game is calling setPixels on low-res Bitmap; you may want to patch the game to improve graphics quality.";
+    }
+
+    IntRect norm = normalizedRect(rect);
+
+    if (norm.x < 0 || norm.y < 0 ||
+        norm.x + norm.w > width() || norm.y + norm.h > height())
+        throw Exception(Exception::MKXPError, "Pixel region (%i, %i, %i, %i) out of bounds (%ix%i)",
+                        rect.x, rect.y, rect.w, rect.h, width(), height());
+
+    if (norm.w == 0 || norm.h == 0)
+        return;
+
+    TEX::bind(p->gl.tex);
+    TEX::uploadSubImage(norm.x, norm.y, norm.w, norm.h, pixeldata, GL_RGBA);
+
+    p->addTaintedArea(norm);
+
+    /* Like setPixel, patch the cached surface in place instead
+     * of throwing it away */
+    if (p->surface)
+    {
+        const uint8_t *src = (const uint8_t*) pixeldata;
+        size_t rowSize = norm.w * p->format->BytesPerPixel;
+
+        for (int row = 0; row < norm.h; ++row)
+        {
+            uint8_t *dst = (uint8_t*) p->surface->pixels
+                           + (norm.y + row) * p->surface->pitch
+                           + norm.x * p->format->BytesPerPixel;
+            memcpy(dst, src + row * rowSize, rowSize);
+        }
+    }
+
+    p->onModified(false);
+}
+
+void Bitmap::setPixel(int x, int y, const Color &color)
+{
+    guardDisposed();
+    
+    GUARD_MEGA;
+    GUARD_ANIMATED;
+    
+    p->prepareModify();
+    
+    if (hasHires()) {
+        Debug() << "GAME BUG: Game is calling setPixel on low-res Bitmap; you may want to patch the game to improve graphics quality.";
+
+        int xHires = x * p->selfHires->width() / width();
+        int yHires = y * p->selfHires->height() / height();
+
+        int w = p->selfHires->width() / width();
+        int h = p->selfHires->height() / height();
+
+        if (w >= 1 && h >= 1) {
+            for (int thisX = xHires; thisX < xHires+w && thisX < p->selfHires->width(); thisX++) {
+                for (int thisY = yHires; thisY < yHires+h && thisY < p->selfHires->height(); thisY++) {
+                    p->selfHires->setPixel(thisX, thisY, color);
+                }
+            }
+        }
+    }
+
+    uint8_t pixel[] =
+    {
+        (uint8_t) clamp<double>(color.red,   0, 255),
+        (uint8_t) clamp<double>(color.green, 0, 255),
+        (uint8_t) clamp<double>(color.blue,  0, 255),
+        (uint8_t) clamp<double>(color.alpha, 0, 255)
+    };
+    
+    TEX::bind(p->gl.tex);
+    TEX::uploadSubImage(x, y, 1, 1, &pixel, GL_RGBA);
+    
+    p->addTaintedArea(IntRect(x, y, 1, 1));
+    
+    /* Setting just a single pixel is no reason to throw away the
+     * whole cached surface; we can just apply the same change */
+    
+    if (p->surface)
+    {
+        uint32_t &surfPixel = getPixelAt(p->surface, p->format, x, y);
+        surfPixel = SDL_MapRGBA(p->format, pixel[0], pixel[1], pixel[2], pixel[3]);
+    }
+    
+    p->onModified(false);
+}
+
+bool Bitmap::getRaw(void *output, int output_size)
+{
+    if (output_size != width()*height()*4) return false;
+    
     guardDisposed();
     
     if (hasHires()) {
@@ -1770,19 +2785,34 @@ bool Bitmap::getRaw(void *output, int output_size)
         void *src = (p->megaSurface) ? p->megaSurface->pixels : p->surface->pixels;
         memcpy(output, src, output_size);
     }
-    else {
+    else if (!p->consumeRawReadback(output, output_size)) {
+        /* Blocking fallback: the script wants the data right now
+         * and no queued readback is available */
         FBO::bind(getGLTypes().fbo);
         gl.ReadPixels(0,0,width(),height(),GL_RGBA,GL_UNSIGNED_BYTE,output);
     }
     return true;
 }
 
+void Bitmap::queueRawReadback()
+{
+    guardDisposed();
+
+    GUARD_MEGA;
+    GUARD_ANIMATED;
+
+    p->flushDeferredOps();
+    p->queueRawReadback();
+}
+
 void Bitmap::replaceRaw(void *pixel_data, int size)
 {
     guardDisposed();
     
     GUARD_MEGA;
     
+    p->prepareModify();
+    
     if (hasHires()) {
         Debug() << "GAME BUG: Game is calling replaceRaw on low-res Bitmap; you may want to patch the game to improve graphics quality.";
     }
@@ -1795,7 +2825,7 @@ void Bitmap::replaceRaw(void *pixel_data, int size)
         throw Exception(Exception::MKXPError, "Replacement bitmap data is not large enough (given %i bytes, need %i)", size, requiredsize);
     
     TEX::bind(getGLTypes().tex);
-    TEX::uploadImage(w, h, pixel_data, GL_RGBA);
+    GLMeta::stagedTexImage(w, h, pixel_data, GL_RGBA);
     
     taintArea(IntRect(0,0,w,h));
     p->onModified();
@@ -1824,36 +2854,10 @@ void Bitmap::saveToFile(const char *filename)
     }
     
     // Try and determine the intended image format from the filename extension
-    const char *period = strrchr(filename, '.');
-    int filetype = 0;
-    if (period) {
-        period++;
-        std::string ext;
-        for (int i = 0; i < (int)strlen(period); i++) {
-            ext += tolower(period[i]);
-        }
-        
-        if (!ext.compare("png")) {
-            filetype = 1;
-        }
-        else if (!ext.compare("jpg") || !ext.compare("jpeg")) {
-            filetype = 2;
-        }
-    }
+    int filetype = saveFiletypeFromFilename(filename);
     
     std::string fn_normalized = shState->fileSystem().normalize(filename, 1, 1);
-    int rc;
-    switch (filetype) {
-        case 2:
-            rc = IMG_SaveJPG(surf, fn_normalized.c_str(), 90);
-            break;
-        case 1:
-            rc = IMG_SavePNG(surf, fn_normalized.c_str());
-            break;
-        case 0: default:
-            rc = SDL_SaveBMP(surf, fn_normalized.c_str());
-            break;
-    }
+    int rc = encodeSurface(surf, fn_normalized.c_str(), filetype);
     
     if (!p->surface && !p->megaSurface)
         SDL_FreeSurface(surf);
@@ -1861,6 +2865,123 @@ void Bitmap::saveToFile(const char *filename)
     if (rc) throw Exception(Exception::SDLError, "%s", SDL_GetError());
 }
 
+void Bitmap::saveToFileAsync(const char *filename)
+{
+    guardDisposed();
+    
+    if (hasHires()) {
+        Debug() << "GAME BUG: Game is calling saveToFileAsync on low-res Bitmap; you may want to patch the game to improve graphics quality.";
+    }
+
+    /* Snapshot the pixels now; encoding and writing happen on
+     * the worker. A readback queued earlier via queueRawReadback
+     * is consumed here without stalling */
+    SDL_Surface *surf =
+        SDL_CreateRGBSurface(0, width(), height(), p->format->BitsPerPixel,
+                             p->format->Rmask, p->format->Gmask,
+                             p->format->Bmask, p->format->Amask);
+    
+    if (!surf)
+        throw Exception(Exception::SDLError, "Failed to prepare bitmap for saving: %s", SDL_GetError());
+    
+    if (!getRaw(surf->pixels, surf->w * surf->h * 4))
+    {
+        SDL_FreeSurface(surf);
+        throw Exception(Exception::MKXPError, "Failed to read bitmap data for saving");
+    }
+    
+    BitmapSaveWorker::instance().enqueue(
+        surf, shState->fileSystem().normalize(filename, 1, 1),
+        saveFiletypeFromFilename(filename));
+}
+
+int Bitmap::pendingSaves()
+{
+    return BitmapSaveWorker::instance().pendingCount();
+}
+
+void Bitmap::applyTone(const Tone &tone, const IntRect &rect)
+{
+    guardDisposed();
+
+    GUARD_ANIMATED;
+
+    if (hasHires()) {
+        IntRect rectHires(rect.x * p->selfHires->width() / width(),
+                          rect.y * p->selfHires->height() / height(),
+                          rect.w * p->selfHires->width() / width(),
+                          rect.h * p->selfHires->height() / height());
+        p->selfHires->applyTone(tone, rectHires);
+    }
+
+    if (!tone.hasEffect())
+        return;
+
+    int toneR = clamp<int>(tone.red, -255, 255);
+    int toneG = clamp<int>(tone.green, -255, 255);
+    int toneB = clamp<int>(tone.blue, -255, 255);
+    int gray = clamp<int>(tone.gray, 0, 255);
+
+    IntRect norm = normalizedRect(rect);
+
+    /* Clip to the bitmap */
+    if (norm.x < 0) { norm.w += norm.x; norm.x = 0; }
+    if (norm.y < 0) { norm.h += norm.y; norm.y = 0; }
+
+    norm.w = std::min(norm.w, width() - norm.x);
+    norm.h = std::min(norm.h, height() - norm.y);
+
+    if (norm.w <= 0 || norm.h <= 0)
+        return;
+
+    if (p->megaSurface)
+    {
+        /* Baked straight into the backing pixels; resident
+         * tiles are dropped and re-upload lazily */
+        SDL_Surface *surf = p->megaSurface;
+
+        for (int row = 0; row < norm.h; ++row)
+        {
+            uint8_t *px = (uint8_t*) surf->pixels
+                          + (norm.y + row) * surf->pitch
+                          + norm.x * 4;
+
+            applyToneRGBA8(px, norm.w, toneR, toneG, toneB, gray);
+        }
+
+        p->releaseMegaTiles();
+        p->onModified(false);
+
+        return;
+    }
+
+    p->prepareModify();
+
+    /* Run the kernel over the cached client copy, then push
+     * the changed region back up */
+    p->ensureSurface();
+
+    for (int row = 0; row < norm.h; ++row)
+    {
+        uint8_t *px = (uint8_t*) p->surface->pixels
+                      + (norm.y + row) * p->surface->pitch
+                      + norm.x * 4;
+
+        applyToneRGBA8(px, norm.w, toneR, toneG, toneB, gray);
+    }
+
+    TEX::bind(p->gl.tex);
+    GLMeta::subRectImageUpload(p->surface->w, norm.x, norm.y,
+                               norm.x, norm.y, norm.w, norm.h,
+                               p->surface, GL_RGBA);
+    GLMeta::subRectImageEnd();
+
+    p->addTaintedArea(norm);
+
+    /* The patched surface stays valid */
+    p->onModified(false);
+}
+
 void Bitmap::hueChange(int hue)
 {
     guardDisposed();
@@ -1876,31 +2997,15 @@ void Bitmap::hueChange(int hue)
     if ((hue % 360) == 0)
         return;
     
-    TEXFBO newTex = shState->texPool().request(width(), height());
-    
-    FloatRect texRect(rect());
-    
-    Quad &quad = shState->gpQuad();
-    quad.setTexPosRect(texRect, texRect);
-    quad.setColor(Vec4(1, 1, 1, 1));
-    
-    HueShader &shader = shState->shaders().hue;
-    shader.bind();
-    /* Shader expects normalized value */
-    shader.setHueAdjust(wrapRange(hue, 0, 359) / 360.0f);
-    
-    FBO::bind(newTex.fbo);
-    p->pushSetViewport(shader);
-    p->bindTexture(shader, false);
-    
-    p->blitQuad(quad);
-    
-    p->popViewport();
-    
-    TEX::unbind();
+    /* Queued blits and fills land first, then the rotation is
+     * merely recorded; the pass itself runs when the result is
+     * next needed, and fuses into a directly following blur.
+     * Back to back rotations collapse the same way */
+    p->flushPoint();
+    p->flushBlitQueue();
+    p->flushFillQueue();
     
-    shState->texPool().release(p->gl);
-    p->gl = newTex;
+    p->pendingHue = wrapRange(p->pendingHue + hue, 0, 359);
     
     p->onModified();
 }
@@ -2040,154 +3145,862 @@ void Bitmap::drawText(const IntRect &rect, const char *str, int align)
 
         p->selfHires->drawText(IntRect(rectX, rectY, rectWidth, rectHeight), str, align);
 
-        return;
+        return;
+    }
+
+    std::string fixed = fixupString(str);
+    str = fixed.c_str();
+    
+    if (*str == '\0')
+        return;
+    
+    if (str[0] == ' ' && str[1] == '\0')
+        return;
+    
+    /* Opt-in shaped text (HarfBuzz builds): proper kerning and
+     * complex scripts; plain styles only, everything else falls
+     * through to the classic paths */
+    if (p->font->getShaped() && TextShaper::available() &&
+        !p->font->getShadow() && !p->font->getOutline() && !p->font->isSolid() &&
+        !p->font->getBold() && !p->font->getItalic() &&
+        drawTextShaped(rect, str, align))
+        return;
+
+    /* Opt-in SDF text: one fixed-size distance-field atlas serves
+     * every scale (shadow/outline/solid still take the legacy path) */
+    if (p->font->getSDF() &&
+        !p->font->getShadow() && !p->font->getOutline() && !p->font->isSolid() &&
+        drawTextSDF(rect, str, align))
+        return;
+
+    /* Non-solid text - including outlined and shadowed - is
+     * assembled from the shared glyph atlas instead of rasterizing
+     * and uploading fresh surfaces every call */
+    if (!p->font->isSolid() && drawTextGlyphAtlas(rect, str, align))
+        return;
+    
+    TTF_Font *font = p->font->getSdlFont();
+    const Color &fontColor = p->font->getColor();
+    const Color &outColor = p->font->getOutColor();
+    
+    SDL_Color c = fontColor.toSDLColor();
+    c.a = 255;
+    
+    SDL_Surface *txtSurf;
+    
+    if (p->font->isSolid())
+        txtSurf = TTF_RenderUTF8_Solid(font, str, c);
+    else
+        txtSurf = TTF_RenderUTF8_Blended(font, str, c);
+    
+    p->ensureFormat(txtSurf, SDL_PIXELFORMAT_ABGR8888);
+    
+    int rawTxtSurfH = txtSurf->h;
+    
+    if (p->font->getShadow())
+        applyShadow(txtSurf, *p->format, c);
+    
+    /* outline using TTF_Outline and blending it together with SDL_BlitSurface
+     * FIXME: outline is forced to have the same opacity as the font color */
+    if (p->font->getOutline())
+    {
+        SDL_Color co = outColor.toSDLColor();
+        co.a = 255;
+        SDL_Surface *outline;
+        // Handle high-res for outline.
+        int scaledOutlineSize = OUTLINE_SIZE;
+        if (p->selfLores) {
+            scaledOutlineSize = scaledOutlineSize * width() / p->selfLores->width();
+        }
+        /* set the next font render to render the outline */
+        TTF_SetFontOutline(font, scaledOutlineSize);
+        if (p->font->isSolid())
+            outline = TTF_RenderUTF8_Solid(font, str, co);
+        else
+            outline = TTF_RenderUTF8_Blended(font, str, co);
+        
+        p->ensureFormat(outline, SDL_PIXELFORMAT_ABGR8888);
+        SDL_Rect outRect = {scaledOutlineSize, scaledOutlineSize, txtSurf->w, txtSurf->h};
+        
+        SDL_SetSurfaceBlendMode(txtSurf, SDL_BLENDMODE_BLEND);
+        SDL_BlitSurface(txtSurf, NULL, outline, &outRect);
+        SDL_FreeSurface(txtSurf);
+        txtSurf = outline;
+        /* reset outline to 0 */
+        TTF_SetFontOutline(font, 0);
+    }
+    
+    int alignX = rect.x;
+    
+    switch (align)
+    {
+        default:
+        case Left :
+            break;
+            
+        case Center :
+            alignX += (rect.w - txtSurf->w) / 2;
+            break;
+            
+        case Right :
+            alignX += rect.w - txtSurf->w;
+            break;
+    }
+    
+    if (alignX < rect.x)
+        alignX = rect.x;
+    
+    int alignY = rect.y + (rect.h - rawTxtSurfH) / 2;
+    
+    float squeeze = (float) rect.w / txtSurf->w;
+    
+    if (squeeze > 1)
+        squeeze = 1;
+    
+    IntRect destRect(alignX, alignY, 0, 0);
+    destRect.w = std::min(rect.w, (int)(txtSurf->w * squeeze));
+    destRect.h = std::min(rect.h, txtSurf->h);
+    
+    destRect.w = std::min(destRect.w, width() - destRect.x);
+    destRect.h = std::min(destRect.h, height() - destRect.y);
+    
+    IntRect sourceRect;
+    sourceRect.w = destRect.w / squeeze;
+    sourceRect.h = destRect.h;
+    
+    Bitmap txtBitmap(txtSurf, nullptr, true);
+    bool smooth = squeeze != 1.0f;
+    stretchBlt(destRect, txtBitmap, sourceRect, fontColor.alpha, smooth);
+}
+
+/* http://www.lemoda.net/c/utf8-to-ucs2/index.html */
+static uint16_t utf8_to_ucs2(const char *_input,
+                             const char **end_ptr)
+{
+    const unsigned char *input =
+    reinterpret_cast<const unsigned char*>(_input);
+    *end_ptr = _input;
+    
+    if (input[0] == 0)
+        return -1;
+    
+    if (input[0] < 0x80)
+    {
+        *end_ptr = _input + 1;
+        
+        return input[0];
+    }
+    
+    if ((input[0] & 0xE0) == 0xE0)
+    {
+        if (input[1] == 0 || input[2] == 0)
+            return -1;
+        
+        *end_ptr = _input + 3;
+        
+        return (input[0] & 0x0F)<<12 |
+        (input[1] & 0x3F)<<6  |
+        (input[2] & 0x3F);
+    }
+    
+    if ((input[0] & 0xC0) == 0xC0)
+    {
+        if (input[1] == 0)
+            return -1;
+        
+        *end_ptr = _input + 2;
+        
+        return (input[0] & 0x1F)<<6  |
+        (input[1] & 0x3F);
+    }
+    
+    return -1;
+}
+
+/* Fast path for non-solid text: assembles the string - fill plus
+ * optional outline and shadow layers, all from cached atlas glyphs -
+ * into a scratch target in a single pass and blits that, instead of
+ * rasterizing the string up to three times and uploading a fresh
+ * surface every call. Returns false when some glyph cannot be
+ * cached, in which case the caller runs the legacy surface path.
+ * Kerning is not applied; for RGSS text this tracks TTF_SizeUTF8's
+ * own layout closely enough */
+bool Bitmap::drawTextGlyphAtlas(const IntRect &rect, const char *str, int align)
+{
+    TTF_Font *font = p->font->getSdlFont();
+    const Color &fontColor = p->font->getColor();
+    const Color &outColor = p->font->getOutColor();
+    const bool shadow = p->font->getShadow();
+
+    GlyphAtlas &atlas = shState->fontState().glyphAtlas();
+    uint8_t style = (uint8_t) TTF_GetFontStyle(font);
+
+    /* Stroke thickness; scaled like the legacy path on hires */
+    int outlinePx = 0;
+    if (p->font->getOutline())
+    {
+        outlinePx = OUTLINE_SIZE;
+        if (p->selfLores)
+            outlinePx = outlinePx * width() / p->selfLores->width();
+        if (outlinePx < 1)
+            outlinePx = 1;
+        if (outlinePx > 255)
+            return false;
+    }
+
+    /* A line we've shaped before goes straight to quad emission */
+    GlyphAtlas::LineLayout scratch_layout;
+    const GlyphAtlas::LineLayout *layout =
+            atlas.findLayout(font, style, (uint8_t) outlinePx, str);
+
+    if (!layout)
+    {
+        /* Collect the glyph run(s) */
+        std::vector<const GlyphAtlas::Glyph*> &run = scratch_layout.run;
+        std::vector<const GlyphAtlas::Glyph*> &runOut = scratch_layout.runOutline;
+
+        for (const char *ptr = str; *ptr;)
+        {
+            /* utf8_to_ucs2 cannot represent codepoints outside the
+             * BMP; let the legacy path render those */
+            if ((*(const unsigned char*) ptr & 0xF8) == 0xF0)
+                return false;
+
+            const char *next;
+            uint16_t cp = utf8_to_ucs2(ptr, &next);
+
+            if (cp == (uint16_t) -1 || next == ptr)
+                return false;
+
+            ptr = next;
+
+            const GlyphAtlas::Glyph *g = atlas.request(font, style, cp);
+
+            if (!g)
+                return false;
+
+            run.push_back(g);
+
+            if (outlinePx > 0)
+            {
+                const GlyphAtlas::Glyph *go =
+                        atlas.request(font, style, cp, (uint8_t) outlinePx);
+
+                if (!go)
+                    return false;
+
+                runOut.push_back(go);
+            }
+        }
+
+        if (run.empty())
+            return true;
+
+        TTF_SizeUTF8(font, str, &scratch_layout.sizeW, &scratch_layout.sizeH);
+
+        if (scratch_layout.sizeW <= 0 || scratch_layout.sizeH <= 0)
+            return false;
+
+        if (scratch_layout.sizeW > glState.caps.maxTexSize ||
+            scratch_layout.sizeH > glState.caps.maxTexSize)
+            return false;
+
+        atlas.storeLayout(font, style, (uint8_t) outlinePx, str, scratch_layout);
+        layout = &scratch_layout;
+    }
+
+    const std::vector<const GlyphAtlas::Glyph*> &run = layout->run;
+    const std::vector<const GlyphAtlas::Glyph*> &runOut = layout->runOutline;
+    const int sizeW = layout->sizeW;
+    const int sizeH = layout->sizeH;
+
+    if (run.empty())
+        return true;
+
+    /* The canvas grows around the fill text exactly like the legacy
+     * composites: stroke on every side, or one pixel right/down for
+     * the shadow (which fits inside the stroke margin otherwise) */
+    const int canvasW = sizeW + (outlinePx ? 2 * outlinePx : (shadow ? 1 : 0));
+    const int canvasH = sizeH + (outlinePx ? 2 * outlinePx : (shadow ? 1 : 0));
+    const int fillOff = outlinePx;
+
+    if (canvasW > glState.caps.maxTexSize || canvasH > glState.caps.maxTexSize)
+        return false;
+
+    TextScratchPlacement pl;
+    if (!placeTextScratch(rect, align, canvasW, canvasH, sizeH, pl))
+        return true;
+
+    pl.opacity = clamp<double>(fontColor.alpha, 0, 255);
+
+    if (pl.opacity == 0)
+        return true;
+
+    /* Pending deferred work lands before we modify ourselves */
+    p->prepareModify();
+
+    /* Assemble the layers into a scratch target: cleared to the
+     * text color at zero alpha, then outline, shadow and fill
+     * coverage blended bottom-up. This reproduces what the legacy
+     * surface composites hand their blit, minus the rasterization
+     * and upload */
+    TEXFBO scratch = shState->texPool().request(canvasW, canvasH);
+
+    FBO::bind(scratch.fbo);
+
+    const Vec4 &c = fontColor.norm;
+    const Vec4 &oc = outColor.norm;
+
+    /* The outermost visible fringe blends against the clear color:
+     * the outline's when stroked (the fill sits on opaque stroke
+     * pixels), the fill's otherwise - like the legacy composites */
+    const Vec4 &fringe = outlinePx ? oc : c;
+
+    glState.clearColor.pushSet(Vec4(fringe.x, fringe.y, fringe.z, 0));
+    FBO::clear();
+    glState.clearColor.pop();
+
+    glState.viewport.pushSet(IntRect(0, 0, canvasW, canvasH));
+    glState.blend.pushSet(true);
+    glState.blendMode.pushSet(BlendNormal);
+
+    GlyphShader &shader = shState->shaders().glyph;
+    shader.bind();
+    shader.setTexSize(Vec2i(atlas.pageSize(), atlas.pageSize()));
+    shader.setTranslation(Vec2i());
+    shader.applyViewportProj();
+
+    const size_t outCount = runOut.size();
+    const size_t shadowCount = shadow ? run.size() : 0;
+    const size_t total = outCount + shadowCount + run.size();
+
+    ColorQuadArray qArray;
+    qArray.resize(total);
+    std::vector<Vertex> &vert = qArray.vertices;
+
+    int penStart = 0;
+
+    /* SDL_ttf shifts the whole line right when the first glyph
+     * has a negative bearing */
+    if (run[0]->minX < 0)
+        penStart = -run[0]->minX;
+
+    size_t q = 0;
+
+    /* Outline layer (bottom): stroked glyphs, outline color.
+     * Like the legacy path, its opacity follows the fill's */
+    if (outCount)
+    {
+        int penX = penStart;
+
+        for (size_t i = 0; i < runOut.size(); ++i)
+        {
+            const GlyphAtlas::Glyph *g = runOut[i];
+
+            FloatRect pos(fillOff + penX + g->minX - outlinePx, 0,
+                          g->rect.w, g->rect.h);
+            FloatRect tex(g->rect.x, g->rect.y, g->rect.w, g->rect.h);
+
+            Quad::setTexPosRect(&vert[q*4], tex, pos);
+
+            for (int j = 0; j < 4; ++j)
+                vert[q*4 + j].color = Vec4(oc.x, oc.y, oc.z, 1);
+
+            penX += g->advance;
+            q++;
+        }
+    }
+
+    /* Shadow layer: the fill glyphs again, black, one pixel
+     * right and down (applyShadow's offset) */
+    if (shadowCount)
+    {
+        int penX = penStart;
+
+        for (size_t i = 0; i < run.size(); ++i)
+        {
+            const GlyphAtlas::Glyph *g = run[i];
+
+            FloatRect pos(fillOff + penX + g->minX + 1, fillOff + 1,
+                          g->rect.w, g->rect.h);
+            FloatRect tex(g->rect.x, g->rect.y, g->rect.w, g->rect.h);
+
+            Quad::setTexPosRect(&vert[q*4], tex, pos);
+
+            for (int j = 0; j < 4; ++j)
+                vert[q*4 + j].color = Vec4(0, 0, 0, 1);
+
+            penX += g->advance;
+            q++;
+        }
+    }
+
+    /* Fill layer (top) */
+    {
+        int penX = penStart;
+
+        for (size_t i = 0; i < run.size(); ++i)
+        {
+            const GlyphAtlas::Glyph *g = run[i];
+
+            FloatRect pos(fillOff + penX + g->minX, fillOff,
+                          g->rect.w, g->rect.h);
+            FloatRect tex(g->rect.x, g->rect.y, g->rect.w, g->rect.h);
+
+            Quad::setTexPosRect(&vert[q*4], tex, pos);
+
+            for (int j = 0; j < 4; ++j)
+                vert[q*4 + j].color = Vec4(c.x, c.y, c.z, 1);
+
+            penX += g->advance;
+            q++;
+        }
+    }
+
+    qArray.commit();
+
+    /* Draw, batching page-contiguous stretches (practically always
+     * one page, so one draw per layer at most) */
+    ArenaVector<const GlyphAtlas::Glyph*> order
+            {ArenaAlloc<const GlyphAtlas::Glyph*>(&frameArena())};
+    order.reserve(total);
+    order.insert(order.end(), runOut.begin(), runOut.end());
+    if (shadowCount)
+        order.insert(order.end(), run.begin(), run.end());
+    order.insert(order.end(), run.begin(), run.end());
+
+    size_t i = 0;
+    while (i < total)
+    {
+        int page = order[i]->page;
+        size_t j = i;
+
+        while (j < total && order[j]->page == page)
+            ++j;
+
+        TEX::bind(atlas.pageTex(page));
+        qArray.draw(i, j - i);
+
+        i = j;
+    }
+
+    glState.blendMode.pop();
+    glState.blend.pop();
+    glState.viewport.pop();
+
+    commitTextScratch(scratch, pl);
+
+    return true;
+}
+
+/* Shaped path (Font#shaped, HarfBuzz builds): the string shapes
+ * once into positioned glyph ids - kerning, ligatures and
+ * complex-script forms - then draws from the shaped atlas. The
+ * shaped run is cached, so repeat draws go straight to quads */
+bool Bitmap::drawTextShaped(const IntRect &rect, const char *str, int align)
+{
+    const Color &fontColor = p->font->getColor();
+
+    /* SDL_ttf opens faces at size * 0.9; match it so shaped and
+     * classic text agree on visual size */
+    const int sizePx = (int) (p->font->getSize() * 0.90f);
+
+    if (sizePx <= 0)
+        return false;
+
+    TextShaper &shaper = shState->fontState().textShaper();
+    const std::string &family = p->font->getFamilyName();
+
+    const TextShaper::ShapedRun *run = shaper.shape(family, sizePx, str);
+
+    if (!run)
+        return false;
+
+    const int sizeW = run->width;
+    const int sizeH = run->height;
+
+    if (sizeW <= 0 || sizeH <= 0)
+        return false;
+
+    if (sizeW > glState.caps.maxTexSize || sizeH > glState.caps.maxTexSize)
+        return false;
+
+    /* Everything must rasterize before we touch any GL state */
+    ShapedAtlas &atlas = shState->fontState().shapedAtlas();
+    ArenaVector<const ShapedAtlas::Glyph*> entries
+            (run->glyphs.size(),
+             ArenaAlloc<const ShapedAtlas::Glyph*>(&frameArena()));
+
+    for (size_t i = 0; i < run->glyphs.size(); ++i)
+    {
+        entries[i] = atlas.request(family, sizePx, run->glyphs[i].glyphId);
+
+        if (!entries[i])
+            return false;
+    }
+
+    TextScratchPlacement pl;
+    if (!placeTextScratch(rect, align, sizeW, sizeH, sizeH, pl))
+        return true;
+
+    pl.opacity = clamp<double>(fontColor.alpha, 0, 255);
+
+    if (pl.opacity == 0)
+        return true;
+
+    p->prepareModify();
+
+    TEXFBO scratch = shState->texPool().request(sizeW, sizeH);
+
+    FBO::bind(scratch.fbo);
+
+    const Vec4 &c = fontColor.norm;
+
+    glState.clearColor.pushSet(Vec4(c.x, c.y, c.z, 0));
+    FBO::clear();
+    glState.clearColor.pop();
+
+    glState.viewport.pushSet(IntRect(0, 0, sizeW, sizeH));
+    glState.blend.pushSet(true);
+    glState.blendMode.pushSet(BlendNormal);
+
+    GlyphShader &shader = shState->shaders().glyph;
+    shader.bind();
+    shader.setTexSize(Vec2i(atlas.pageSize(), atlas.pageSize()));
+    shader.setTranslation(Vec2i());
+    shader.applyViewportProj();
+
+    ColorQuadArray qArray;
+    qArray.resize(entries.size());
+    std::vector<Vertex> &vert = qArray.vertices;
+
+    const int baseline = run->ascent;
+    int penX = 0;
+
+    for (size_t i = 0; i < entries.size(); ++i)
+    {
+        const TextShaper::ShapedGlyph &sg = run->glyphs[i];
+        const ShapedAtlas::Glyph *g = entries[i];
+
+        /* HB offsets are positive-up, FT 'top' counts up from the
+         * baseline; scratch space has y growing down */
+        FloatRect pos(penX + sg.xOffset + g->left,
+                      baseline - g->top - sg.yOffset,
+                      g->rect.w, g->rect.h);
+        FloatRect tex(g->rect.x, g->rect.y, g->rect.w, g->rect.h);
+
+        Quad::setTexPosRect(&vert[i*4], tex, pos);
+
+        for (int j = 0; j < 4; ++j)
+            vert[i*4 + j].color = Vec4(c.x, c.y, c.z, 1);
+
+        penX += sg.xAdvance;
+    }
+
+    qArray.commit();
+
+    size_t i = 0;
+    while (i < entries.size())
+    {
+        int page = entries[i]->page;
+        size_t j = i;
+
+        while (j < entries.size() && entries[j]->page == page)
+            ++j;
+
+        TEX::bind(atlas.pageTex(page));
+        qArray.draw(i, j - i);
+
+        i = j;
+    }
+
+    glState.blendMode.pop();
+    glState.blend.pop();
+    glState.viewport.pop();
+
+    commitTextScratch(scratch, pl);
+
+    return true;
+}
+
+/* Signed-distance-field path (Font#sdf): glyph shapes come from a
+ * fixed-base-size SDF atlas and get scaled to the requested font
+ * size on the quad, with the edge rebuilt in the fragment shader -
+ * so no size ever re-rasterizes a glyph */
+bool Bitmap::drawTextSDF(const IntRect &rect, const char *str, int align)
+{
+    TTF_Font *baseFont = p->font->getSdlFontAt(SDFAtlas::BasePx);
+
+    if (!baseFont)
+        return false;
+
+    const Color &fontColor = p->font->getColor();
+    SDFAtlas &atlas = shState->fontState().sdfAtlas();
+    uint8_t style = (uint8_t) TTF_GetFontStyle(baseFont);
+
+    std::vector<const SDFAtlas::Glyph*> run;
+
+    for (const char *ptr = str; *ptr;)
+    {
+        if ((*(const unsigned char*) ptr & 0xF8) == 0xF0)
+            return false;
+
+        const char *next;
+        uint16_t cp = utf8_to_ucs2(ptr, &next);
+
+        if (cp == (uint16_t) -1 || next == ptr)
+            return false;
+
+        ptr = next;
+
+        const SDFAtlas::Glyph *g = atlas.request(baseFont, style, cp);
+
+        if (!g)
+            return false;
+
+        run.push_back(g);
+    }
+
+    if (run.empty())
+        return true;
+
+    const float ratio = (float) p->font->getSize() / SDFAtlas::BasePx;
+
+    /* Base-size layout: same pen rules as the coverage path */
+    int penBase = 0;
+
+    if (run[0]->minX < 0)
+        penBase = -run[0]->minX;
+
+    int lineWBase = penBase;
+    for (size_t i = 0; i < run.size(); ++i)
+    {
+        const SDFAtlas::Glyph *g = run[i];
+        int right = g->advance;
+        /* the last glyph's ink may overhang its advance */
+        if (i == run.size() - 1)
+            right = std::max(right, g->minX + (g->rect.w - 2 * SDFAtlas::Spread));
+        lineWBase += (i == run.size() - 1) ? right : g->advance;
+    }
+
+    const int cellHBase = TTF_FontHeight(baseFont);
+
+    const int sizeW = (int) ceilf(lineWBase * ratio);
+    const int sizeH = (int) ceilf(cellHBase * ratio);
+
+    if (sizeW <= 0 || sizeH <= 0)
+        return false;
+
+    if (sizeW > glState.caps.maxTexSize || sizeH > glState.caps.maxTexSize)
+        return false;
+
+    TextScratchPlacement pl;
+    if (!placeTextScratch(rect, align, sizeW, sizeH, sizeH, pl))
+        return true;
+
+    pl.opacity = clamp<double>(fontColor.alpha, 0, 255);
+
+    if (pl.opacity == 0)
+        return true;
+
+    p->prepareModify();
+
+    TEXFBO scratch = shState->texPool().request(sizeW, sizeH);
+
+    FBO::bind(scratch.fbo);
+
+    const Vec4 &c = fontColor.norm;
+
+    glState.clearColor.pushSet(Vec4(c.x, c.y, c.z, 0));
+    FBO::clear();
+    glState.clearColor.pop();
+
+    glState.viewport.pushSet(IntRect(0, 0, sizeW, sizeH));
+    glState.blend.pushSet(true);
+    glState.blendMode.pushSet(BlendNormal);
+
+    SDFGlyphShader &shader = shState->shaders().sdfGlyph();
+    shader.bind();
+    shader.setTexSize(Vec2i(atlas.pageSize(), atlas.pageSize()));
+    shader.setTranslation(Vec2i());
+    shader.applyViewportProj();
+
+    /* Edge band about one destination pixel wide, in normalized
+     * distance units (1.0 == 2*Spread base pixels) */
+    float smoothing = 0.25f / (ratio * SDFAtlas::Spread);
+    smoothing = clamp(smoothing, 0.01f, 0.49f);
+    shader.setSmoothing(smoothing);
+
+    ColorQuadArray qArray;
+    qArray.resize(run.size());
+    std::vector<Vertex> &vert = qArray.vertices;
+
+    int penX = penBase;
+
+    for (size_t i = 0; i < run.size(); ++i)
+    {
+        const SDFAtlas::Glyph *g = run[i];
+
+        /* The atlas rect is padded by Spread on every side; the
+         * quad carries the padding so edges can smooth outwards */
+        FloatRect pos((penX + g->minX - SDFAtlas::Spread) * ratio,
+                      -SDFAtlas::Spread * ratio,
+                      g->rect.w * ratio, g->rect.h * ratio);
+        FloatRect tex(g->rect.x, g->rect.y, g->rect.w, g->rect.h);
+
+        Quad::setTexPosRect(&vert[i*4], tex, pos);
+
+        for (int j = 0; j < 4; ++j)
+            vert[i*4 + j].color = Vec4(c.x, c.y, c.z, 1);
+
+        penX += g->advance;
+    }
+
+    qArray.commit();
+
+    size_t i = 0;
+    while (i < run.size())
+    {
+        int page = run[i]->page;
+        size_t j = i;
+
+        while (j < run.size() && run[j]->page == page)
+            ++j;
+
+        TEX::bind(atlas.pageTex(page));
+        qArray.draw(i, j - i);
+
+        i = j;
     }
 
-    std::string fixed = fixupString(str);
-    str = fixed.c_str();
-    
-    if (*str == '\0')
-        return;
-    
-    if (str[0] == ' ' && str[1] == '\0')
-        return;
-    
-    TTF_Font *font = p->font->getSdlFont();
-    const Color &fontColor = p->font->getColor();
-    const Color &outColor = p->font->getOutColor();
-    
-    SDL_Color c = fontColor.toSDLColor();
-    c.a = 255;
-    
-    SDL_Surface *txtSurf;
-    
-    if (p->font->isSolid())
-        txtSurf = TTF_RenderUTF8_Solid(font, str, c);
-    else
-        txtSurf = TTF_RenderUTF8_Blended(font, str, c);
-    
-    p->ensureFormat(txtSurf, SDL_PIXELFORMAT_ABGR8888);
-    
-    int rawTxtSurfH = txtSurf->h;
-    
-    if (p->font->getShadow())
-        applyShadow(txtSurf, *p->format, c);
-    
-    /* outline using TTF_Outline and blending it together with SDL_BlitSurface
-     * FIXME: outline is forced to have the same opacity as the font color */
-    if (p->font->getOutline())
-    {
-        SDL_Color co = outColor.toSDLColor();
-        co.a = 255;
-        SDL_Surface *outline;
-        // Handle high-res for outline.
-        int scaledOutlineSize = OUTLINE_SIZE;
-        if (p->selfLores) {
-            scaledOutlineSize = scaledOutlineSize * width() / p->selfLores->width();
-        }
-        /* set the next font render to render the outline */
-        TTF_SetFontOutline(font, scaledOutlineSize);
-        if (p->font->isSolid())
-            outline = TTF_RenderUTF8_Solid(font, str, co);
-        else
-            outline = TTF_RenderUTF8_Blended(font, str, co);
-        
-        p->ensureFormat(outline, SDL_PIXELFORMAT_ABGR8888);
-        SDL_Rect outRect = {scaledOutlineSize, scaledOutlineSize, txtSurf->w, txtSurf->h};
-        
-        SDL_SetSurfaceBlendMode(txtSurf, SDL_BLENDMODE_BLEND);
-        SDL_BlitSurface(txtSurf, NULL, outline, &outRect);
-        SDL_FreeSurface(txtSurf);
-        txtSurf = outline;
-        /* reset outline to 0 */
-        TTF_SetFontOutline(font, 0);
-    }
-    
+    glState.blendMode.pop();
+    glState.blend.pop();
+    glState.viewport.pop();
+
+    commitTextScratch(scratch, pl);
+
+    return true;
+}
+
+/* Alignment, squeeze and clipping shared by the atlas and SDF text
+ * paths; mirrors the legacy path's rules exactly */
+bool Bitmap::placeTextScratch(const IntRect &rect, int align,
+                              int sizeW, int sizeH, int alignH,
+                              TextScratchPlacement &out)
+{
     int alignX = rect.x;
-    
+
     switch (align)
     {
         default:
         case Left :
             break;
-            
+
         case Center :
-            alignX += (rect.w - txtSurf->w) / 2;
+            alignX += (rect.w - sizeW) / 2;
             break;
-            
+
         case Right :
-            alignX += rect.w - txtSurf->w;
+            alignX += rect.w - sizeW;
             break;
     }
-    
+
     if (alignX < rect.x)
         alignX = rect.x;
-    
-    int alignY = rect.y + (rect.h - rawTxtSurfH) / 2;
-    
-    float squeeze = (float) rect.w / txtSurf->w;
-    
+
+    int alignY = rect.y + (rect.h - alignH) / 2;
+
+    float squeeze = (float) rect.w / sizeW;
+
     if (squeeze > 1)
         squeeze = 1;
-    
+
     IntRect destRect(alignX, alignY, 0, 0);
-    destRect.w = std::min(rect.w, (int)(txtSurf->w * squeeze));
-    destRect.h = std::min(rect.h, txtSurf->h);
-    
+    destRect.w = std::min(rect.w, (int)(sizeW * squeeze));
+    destRect.h = std::min(rect.h, sizeH);
+
     destRect.w = std::min(destRect.w, width() - destRect.x);
     destRect.h = std::min(destRect.h, height() - destRect.y);
-    
-    IntRect sourceRect;
-    sourceRect.w = destRect.w / squeeze;
-    sourceRect.h = destRect.h;
-    
-    Bitmap txtBitmap(txtSurf, nullptr, true);
-    bool smooth = squeeze != 1.0f;
-    stretchBlt(destRect, txtBitmap, sourceRect, fontColor.alpha, smooth);
+
+    if (destRect.w <= 0 || destRect.h <= 0)
+        return false;
+
+    out.destRect = destRect;
+    out.sourceRect.x = 0;
+    out.sourceRect.y = 0;
+    out.sourceRect.w = destRect.w / squeeze;
+    out.sourceRect.h = destRect.h;
+    out.squeeze = squeeze;
+    out.opacity = 255;
+
+    return true;
 }
 
-/* http://www.lemoda.net/c/utf8-to-ucs2/index.html */
-static uint16_t utf8_to_ucs2(const char *_input,
-                             const char **end_ptr)
+/* Blit the scratch into place; same two cases as stretchBlt */
+void Bitmap::commitTextScratch(TEXFBO &scratch,
+                               const TextScratchPlacement &pl)
 {
-    const unsigned char *input =
-    reinterpret_cast<const unsigned char*>(_input);
-    *end_ptr = _input;
-    
-    if (input[0] == 0)
-        return -1;
-    
-    if (input[0] < 0x80)
-    {
-        *end_ptr = _input + 1;
-        
-        return input[0];
-    }
-    
-    if ((input[0] & 0xE0) == 0xE0)
+    const IntRect &destRect = pl.destRect;
+    const IntRect &sourceRect = pl.sourceRect;
+
+    bool touchesTaintedArea = p->touchesTaintedArea(destRect);
+    bool smooth = pl.squeeze != 1.0f;
+
+    if (pl.opacity == 255 && !touchesTaintedArea)
     {
-        if (input[1] == 0 || input[2] == 0)
-            return -1;
-        
-        *end_ptr = _input + 3;
-        
-        return (input[0] & 0x0F)<<12 |
-        (input[1] & 0x3F)<<6  |
-        (input[2] & 0x3F);
+        GLMeta::blitBegin(p->getGLTypes());
+        GLMeta::blitSource(scratch);
+        GLMeta::blitRectangle(sourceRect, destRect, smooth);
+        GLMeta::blitEnd();
     }
-    
-    if ((input[0] & 0xC0) == 0xC0)
+    else
     {
-        if (input[1] == 0)
-            return -1;
-        
-        *end_ptr = _input + 2;
-        
-        return (input[0] & 0x1F)<<6  |
-        (input[1] & 0x3F);
+        float normOpacity = (float) pl.opacity / 255.0f;
+
+        TEXFBO &gpTex = shState->gpTexFBO(destRect.w, destRect.h);
+
+        GLMeta::blitBegin(gpTex, false, SameScale);
+        GLMeta::blitSource(p->getGLTypes(), SameScale);
+        GLMeta::blitRectangle(destRect, IntRect(0, 0, destRect.w, destRect.h));
+        GLMeta::blitEnd();
+
+        FloatRect bltSubRect((float) sourceRect.x / scratch.width,
+                             (float) sourceRect.y / scratch.height,
+                             ((float) scratch.width / sourceRect.w) * ((float) destRect.w / gpTex.width),
+                             ((float) scratch.height / sourceRect.h) * ((float) destRect.h / gpTex.height));
+
+        BltShader &bltShader = shState->shaders().blt;
+        bltShader.bind();
+
+        TEX::bind(scratch.tex);
+        bltShader.setTexSize(Vec2i(scratch.width, scratch.height));
+        bltShader.setSource();
+        bltShader.setDestination(gpTex.tex);
+        bltShader.setSubRect(bltSubRect);
+        bltShader.setOpacity(normOpacity);
+
+        Quad &quad = shState->gpQuad();
+        quad.setTexPosRect(sourceRect, destRect);
+        quad.setColor(Vec4(1, 1, 1, normOpacity));
+
+        p->bindFBO();
+        p->pushSetViewport(bltShader);
+
+        if (smooth)
+            TEX::setSmooth(true);
+
+        p->blitQuad(quad);
+
+        p->popViewport();
+
+        if (smooth)
+            TEX::setSmooth(false);
     }
-    
-    return -1;
+
+    shState->texPool().release(scratch);
+
+    p->addTaintedArea(destRect);
+    p->onModified();
 }
 
 IntRect Bitmap::textSize(const char *str)
@@ -2220,6 +4033,157 @@ IntRect Bitmap::textSize(const char *str)
     return IntRect(0, 0, w, h);
 }
 
+/* Width of a UTF-8 segment from cached advances; falls back to a
+ * single TTF_SizeUTF8 for encodings the cache can't walk */
+static int measureSegment(GlyphAtlas &atlas, TTF_Font *font, uint8_t style,
+                          const char *a, const char *b)
+{
+    int w = 0;
+
+    for (const char *ptr = a; ptr < b;)
+    {
+        int adv = -1;
+
+        if ((*(const unsigned char*) ptr & 0xF8) != 0xF0)
+        {
+            const char *next;
+            uint16_t cp = utf8_to_ucs2(ptr, &next);
+
+            if (cp != (uint16_t) -1 && next > ptr && next <= b)
+            {
+                adv = atlas.advanceOf(font, style, cp);
+                if (adv >= 0)
+                {
+                    w += adv;
+                    ptr = next;
+                    continue;
+                }
+            }
+        }
+
+        /* Non-BMP or unmetered glyph: measure the whole segment
+         * the slow way once */
+        {
+            std::string seg(a, b - a);
+            int tw, th;
+            if (TTF_SizeUTF8(font, seg.c_str(), &tw, &th) == 0)
+                return tw;
+            return w;
+        }
+    }
+
+    return w;
+}
+
+void Bitmap::measureLines(const char *str, int wrapWidth,
+                          std::vector<std::string> &out)
+{
+    guardDisposed();
+
+    GUARD_MEGA;
+    GUARD_ANIMATED;
+
+    TTF_Font *font = p->font->getSdlFont();
+    GlyphAtlas &atlas = shState->fontState().glyphAtlas();
+    const uint8_t style = (uint8_t) TTF_GetFontStyle(font);
+
+    int spaceAdv = atlas.advanceOf(font, style, ' ');
+    if (spaceAdv < 0)
+        spaceAdv = 0;
+
+    std::string line;
+    int lineW = 0;
+
+    const char *ptr = str;
+
+    while (*ptr)
+    {
+        /* Hard breaks (CRLF counts once) */
+        if (*ptr == '\n' || *ptr == '\r')
+        {
+            if (ptr[0] == '\r' && ptr[1] == '\n')
+                ptr++;
+            ptr++;
+            out.push_back(line);
+            line.clear();
+            lineW = 0;
+            continue;
+        }
+
+        /* A run of spaces joins words (and drops at a break) */
+        if (*ptr == ' ')
+        {
+            int n = 0;
+            while (*ptr == ' ')
+            {
+                n++;
+                ptr++;
+            }
+            if (!line.empty())
+            {
+                line.append(n, ' ');
+                lineW += n * spaceAdv;
+            }
+            continue;
+        }
+
+        /* Next word: the delimiters are ASCII, which never occurs
+         * inside UTF-8 continuation bytes, so a byte scan is safe */
+        const char *wStart = ptr;
+        while (*ptr && *ptr != ' ' && *ptr != '\n' && *ptr != '\r')
+            ptr++;
+
+        const int wWidth = measureSegment(atlas, font, style, wStart, ptr);
+
+        if (!line.empty() && lineW + wWidth > wrapWidth)
+        {
+            /* Trailing join spaces don't belong at a line end */
+            size_t end = line.find_last_not_of(' ');
+            line.resize(end == std::string::npos ? 0 : end + 1);
+            out.push_back(line);
+            line.clear();
+            lineW = 0;
+        }
+
+        if (wWidth > wrapWidth && line.empty())
+        {
+            /* Word wider than the limit: split at glyphs */
+            for (const char *cptr = wStart; cptr < ptr;)
+            {
+                /* Step one code point by lead byte */
+                const unsigned char lead = *(const unsigned char*) cptr;
+                int len = 1;
+                if ((lead & 0xF8) == 0xF0) len = 4;
+                else if ((lead & 0xF0) == 0xE0) len = 3;
+                else if ((lead & 0xE0) == 0xC0) len = 2;
+                const char *next = cptr + len;
+                if (next > ptr)
+                    next = ptr;
+
+                const int cw = measureSegment(atlas, font, style, cptr, next);
+
+                if (!line.empty() && lineW + cw > wrapWidth)
+                {
+                    out.push_back(line);
+                    line.clear();
+                    lineW = 0;
+                }
+
+                line.append(cptr, next - cptr);
+                lineW += cw;
+                cptr = next;
+            }
+        }
+        else
+        {
+            line.append(wStart, ptr - wStart);
+            lineW += wWidth;
+        }
+    }
+
+    out.push_back(line);
+}
+
 DEF_ATTR_RD_SIMPLE(Bitmap, Font, Font&, *p->font)
 
 void Bitmap::setFont(Font &value)
@@ -2244,6 +4208,9 @@ void Bitmap::setInitFont(Font *value)
 
 TEXFBO &Bitmap::getGLTypes() const
 {
+    /* Pending deferred work must land before anyone samples us */
+    p->flushDeferredOps();
+
     return p->getGLTypes();
 }
 
@@ -2410,7 +4377,9 @@ int Bitmap::addFrame(Bitmap &source, int position)
         throw Exception(Exception::MKXPError, "Animations with varying dimensions are not supported (%ix%i vs %ix%i)",
                         source.width(), source.height(), width(), height());
     
-    TEXFBO newframe = shState->texPool().request(source.width(), source.height());
+    p->prepareModify();
+    
+    TEXFBO newframe = allocFrameTex(source.width(), source.height());
     
     // Convert the bitmap into an animated bitmap if it isn't already one
     if (!p->animation.enabled) {
@@ -2433,13 +4402,15 @@ int Bitmap::addFrame(Bitmap &source, int position)
     
     if (source.surface()) {
         TEX::bind(newframe.tex);
-        TEX::uploadImage(source.width(), source.height(), source.surface()->pixels, GL_RGBA);
+        GLMeta::stagedTexImage(source.width(), source.height(), source.surface()->pixels, GL_RGBA);
         SDL_FreeSurface(p->surface);
         p->surface = 0;
     }
     else {
+        source.p->flushDeferredOps();
+
         GLMeta::blitBegin(newframe, false, SameScale);
-        GLMeta::blitSource(source.getGLTypes(), SameScale);
+        GLMeta::blitSource(source.p->getGLTypes(), SameScale);
         GLMeta::blitRectangle(rect(), rect());
         GLMeta::blitEnd();
     }
@@ -2463,17 +4434,21 @@ void Bitmap::removeFrame(int position) {
     
     GUARD_UNANIMATED;
     
+    p->prepareModify();
+    
     if (hasHires()) {
         Debug() << "BUG: High-res Bitmap removeFrame not implemented";
     }
 
     int pos = (position < 0) ? (int)p->animation.frames.size() - 1 : clamp(position, 0, (int)(p->animation.frames.size() - 1));
-    shState->texPool().release(p->animation.frames[pos]);
+    TEXFBO::fini(p->animation.frames[pos]);
     p->animation.frames.erase(p->animation.frames.begin() + pos);
     
     // Change the animated bitmap back to a normal one if there's only one frame left
     if (p->animation.frames.size() == 1) {
-        
+
+        if (p->animation.playing)
+            shState->graphics().animatedPlaying(-1);
         p->animation.enabled = false;
         p->animation.playing = false;
         p->animation.width = 0;
@@ -2621,6 +4596,50 @@ int Bitmap::maxSize(){
     return glState.caps.maxTexSize;
 }
 
+void Bitmap::preload(const char *filename)
+{
+    BitmapPreloadCache::instance().preload(filename);
+}
+
+bool Bitmap::preloadPending(const char *filename)
+{
+    return BitmapPreloadCache::instance().pending(filename);
+}
+
+static size_t hiresBytes(BitmapPrivate *p)
+{
+    return (size_t) p->selfHires->width() * p->selfHires->height() * 4;
+}
+
+size_t Bitmap::hiresUsage()
+{
+    size_t sum = 0;
+
+    for (size_t i = 0; i < hiresResident.size(); ++i)
+        sum += hiresBytes(hiresResident[i]);
+
+    return sum;
+}
+
+void Bitmap::hiresShrink(size_t targetBytes)
+{
+    size_t usage = hiresUsage();
+
+    while (usage > targetBytes && !hiresResident.empty())
+    {
+        /* Coldest stamp goes first; anything still drawn keeps
+         * re-stamping itself ahead of the axe */
+        BitmapPrivate *coldest = hiresResident[0];
+
+        for (size_t i = 1; i < hiresResident.size(); ++i)
+            if (hiresResident[i]->hiresStamp < coldest->hiresStamp)
+                coldest = hiresResident[i];
+
+        usage -= hiresBytes(coldest);
+        coldest->unloadHires();
+    }
+}
+
 void Bitmap::assumeRubyGC()
 {
     p->assumingRubyGC = true;
@@ -2628,17 +4647,28 @@ void Bitmap::assumeRubyGC()
 
 void Bitmap::releaseResources()
 {
+    /* Bitmaps with queued blits sampling from us flush them
+     * while our textures are still alive; our own queue is
+     * simply dropped along with the contents */
+    p->flushPoint();
+    p->dropDeferredOps();
+
     if (p->selfHires && !p->assumingRubyGC) {
         delete p->selfHires;
     }
 
     if (p->megaSurface)
+    {
+        p->releaseMegaTiles();
         SDL_FreeSurface(p->megaSurface);
+    }
     else if (p->animation.enabled) {
+        if (p->animation.playing)
+            shState->graphics().animatedPlaying(-1);
         p->animation.enabled = false;
         p->animation.playing = false;
         for (TEXFBO &tex : p->animation.frames)
-            shState->texPool().release(tex);
+            TEXFBO::fini(tex);
     }
     else
         shState->texPool().release(p->gl);
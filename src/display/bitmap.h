@@ -26,7 +26,10 @@
 #include "etc-internal.h"
 #include "etc.h"
 
-#include "sigslot/signal.hpp"
+#include "flatsignal.h"
+
+#include <string>
+#include <vector>
 
 class Font;
 class ShaderBase;
@@ -94,13 +97,34 @@ public:
 
 	Color getPixel(int x, int y) const;
 	void setPixel(int x, int y, const Color &color);
+
+	/* Batch variants of getPixel/setPixel; transfer a whole
+	 * region as tightly packed RGBA data in one GL call */
+	void getPixels(const IntRect &rect, void *output) const;
+	void setPixels(const IntRect &rect, const void *pixeldata);
     
     bool getRaw(void *output, int output_size);
     void replaceRaw(void *pixel_data, int size);
+
+    /* Starts an asynchronous readback that a later getRaw
+     * call can consume without stalling the pipeline */
+    void queueRawReadback();
     void saveToFile(const char *filename);
 
+    /* Encodes and writes on a background worker; failures are
+     * logged instead of raised */
+    void saveToFileAsync(const char *filename);
+
+    /* Number of async saves not yet written out */
+    static int pendingSaves();
+
 	void hueChange(int hue);
 
+	/* Bakes a tone (additive rgb + gray mix, same math as
+	 * the render-time shader) into the pixel data on the
+	 * CPU; works on mega surfaces too */
+	void applyTone(const Tone &tone, const IntRect &rect);
+
 	enum TextAlign
 	{
 		Left = 0,
@@ -117,6 +141,13 @@ public:
 
 	IntRect textSize(const char *str);
 
+	/* Greedy word wrap against 'wrapWidth' using cached glyph
+	 * advances: all the line breaks from one call, instead of a
+	 * text_size round trip per word. Explicit newlines are hard
+	 * breaks; words wider than the limit split at glyphs */
+	void measureLines(const char *str, int wrapWidth,
+	                  std::vector<std::string> &out);
+
 	DECL_ATTR(Font, Font&)
 
 	/* Sets initial reference without copying by value,
@@ -163,15 +194,50 @@ public:
 	/* Adds 'rect' to tainted area */
 	void taintArea(const IntRect &rect);
 
-	sigslot::signal<> modified;
+	FlatSignal modified;
 
 	static int maxSize();
 
+	/* Queues a background decode of the image file, to be
+	 * picked up by a later Bitmap construction */
+	static void preload(const char *filename);
+
+	/* Whether a preload decode for this file is still in flight */
+	static bool preloadPending(const char *filename);
+
+	/* Residency accounting / pressure shedding (coldest first)
+	 * for streamed hires replacements */
+	static size_t hiresUsage();
+	static void hiresShrink(size_t targetBytes);
+
     void assumeRubyGC();
 
 private:
+	bool drawTextGlyphAtlas(const IntRect &rect, const char *str, int align);
+	bool drawTextSDF(const IntRect &rect, const char *str, int align);
+	bool drawTextShaped(const IntRect &rect, const char *str, int align);
+
+	/* Shared placement + final blit for the atlas/SDF text paths:
+	 * both assemble the line into a scratch target of sizeW x sizeH
+	 * and then land it with the legacy path's alignment, squeeze
+	 * and opacity rules */
+	struct TextScratchPlacement
+	{
+		IntRect destRect, sourceRect;
+		float squeeze;
+		int opacity;
+	};
+	/* false: nothing visible to draw (still a successful render).
+	 * 'alignH' is the height vertical centering uses (the fill text
+	 * height; the canvas may be taller for outline/shadow) */
+	bool placeTextScratch(const IntRect &rect, int align,
+	                      int sizeW, int sizeH, int alignH,
+	                      TextScratchPlacement &out);
+	void commitTextScratch(TEXFBO &scratch,
+	                       const TextScratchPlacement &pl);
+
 	void releaseResources();
-	sigslot::connection loresDispCon;
+	FlatConnection loresDispCon;
 	const char *klassName() const { return "bitmap"; }
 
 	BitmapPrivate *p;
@@ -20,6 +20,9 @@
 */
 
 #include "font.h"
+#include "glyphatlas.h"
+#include "sdfatlas.h"
+#include "textshaper.h"
 
 #include "sharedstate.h"
 #include "filesystem.h"
@@ -29,6 +32,10 @@
 #include "config.h"
 
 #include "debugwriter.h"
+#include "sdl-util.h"
+
+#include <SDL_mutex.h>
+#include <SDL_timer.h>
 
 #include <string>
 #include <utility>
@@ -105,15 +112,55 @@ struct SharedFontStatePrivate
 	/* Pool of already opened fonts; once opened, they are reused
 	 * and never closed until the termination of the program */
 	BoostHash<FontKey, TTF_Font*> pool;
+
+	/* Font file contents read ahead by the boot preload
+	 * thread, keyed by asset path and guarded by dataMutex.
+	 * Buffers live for the program lifetime: opened fonts
+	 * stream from them lazily as glyphs are loaded. Only
+	 * the bytes are warmed here - TTF_OpenFontRW stays on
+	 * the render side, since FreeType's shared library
+	 * handle isn't safe to use from two threads */
+	BoostHash<std::string, std::vector<uint8_t>*> fontData;
+	SDL_mutex *dataMutex;
+
+	/* Asset paths to warm at boot */
+	std::vector<std::string> preloadQueue;
+	SDL_Thread *preloadThread;
     
     /* Internal default font family that is used anytime an
      * empty/invalid family is requested */
     std::string defaultFamily;
+
+    /* Created lazily on first use (needs a GL context) */
+    GlyphAtlas *glyphAtlas;
+    SDFAtlas *sdfAtlas;
+
+    /* Lazy too, though it only needs FreeType */
+    TextShaper *textShaper;
+    ShapedAtlas *shapedAtlas;
+
+    /* Glyph warmup queue (see glyphWarmupStep) */
+    struct WarmupItem
+    {
+        std::string family;
+        int size;
+    };
+    std::vector<WarmupItem> warmQueue;
+    size_t warmItem;
+    uint32_t warmCp;
 };
 
 SharedFontState::SharedFontState(const Config &conf)
 {
 	p = new SharedFontStatePrivate;
+	p->glyphAtlas = 0;
+	p->sdfAtlas = 0;
+	p->textShaper = 0;
+	p->shapedAtlas = 0;
+	p->warmItem = 0;
+	p->warmCp = 0;
+	p->dataMutex = SDL_CreateMutex();
+	p->preloadThread = 0;
 
 	/* Parse font substitutions */
 	for (size_t i = 0; i < conf.fontSubs.size(); ++i)
@@ -133,13 +180,141 @@ SharedFontState::SharedFontState(const Config &conf)
 
 SharedFontState::~SharedFontState()
 {
+	if (p->preloadThread)
+		SDL_WaitThread(p->preloadThread, 0);
+
 	BoostHash<FontKey, TTF_Font*>::const_iterator iter;
 	for (iter = p->pool.cbegin(); iter != p->pool.cend(); ++iter)
 		TTF_CloseFont(iter->second);
 
+	BoostHash<std::string, std::vector<uint8_t>*>::const_iterator dit;
+	for (dit = p->fontData.cbegin(); dit != p->fontData.cend(); ++dit)
+		delete dit->second;
+
+	SDL_DestroyMutex(p->dataMutex);
+
+	delete p->glyphAtlas;
+	delete p->sdfAtlas;
+	delete p->shapedAtlas;
+	delete p->textShaper;
 	delete p;
 }
 
+GlyphAtlas &SharedFontState::glyphAtlas()
+{
+	if (!p->glyphAtlas)
+		p->glyphAtlas = new GlyphAtlas;
+
+	return *p->glyphAtlas;
+}
+
+SDFAtlas &SharedFontState::sdfAtlas()
+{
+	if (!p->sdfAtlas)
+		p->sdfAtlas = new SDFAtlas;
+
+	return *p->sdfAtlas;
+}
+
+TextShaper &SharedFontState::textShaper()
+{
+	if (!p->textShaper)
+		p->textShaper = new TextShaper;
+
+	return *p->textShaper;
+}
+
+ShapedAtlas &SharedFontState::shapedAtlas()
+{
+	if (!p->shapedAtlas)
+		p->shapedAtlas = new ShapedAtlas;
+
+	return *p->shapedAtlas;
+}
+
+const std::vector<uint8_t> *SharedFontState::fontFileData(std::string family)
+{
+	std::transform(family.begin(), family.end(), family.begin(),
+		[](unsigned char c){ return std::tolower(c); });
+
+	if (family.empty())
+		family = p->defaultFamily;
+
+	if (const std::string *sub = p->subs.valuePtr(family))
+		family = *sub;
+
+	const FontSet &req = p->sets[family];
+
+	std::string path;
+
+	if (req.regular.empty() && req.other.empty())
+		path = "<bundled>";
+	else
+		path = !req.regular.empty() ? req.regular : req.other;
+
+	SDL_LockMutex(p->dataMutex);
+	std::vector<uint8_t> *data = p->fontData.value(path, 0);
+	SDL_UnlockMutex(p->dataMutex);
+
+	if (data)
+		return data;
+
+	/* Read and remember; buffers stay for the program lifetime,
+	 * same as the preload thread's */
+	SDL_RWops *ops;
+
+	if (path == "<bundled>")
+	{
+		ops = openBundledFont();
+	}
+	else
+	{
+		ops = SDL_AllocRW();
+		try {
+			shState->fileSystem().openReadRaw(*ops, path.c_str(), true);
+		} catch (...) {
+			SDL_FreeRW(ops);
+			return 0;
+		}
+	}
+
+	if (!ops)
+		return 0;
+
+	Sint64 size = SDL_RWsize(ops);
+
+	if (size <= 0)
+	{
+		SDL_RWclose(ops);
+		return 0;
+	}
+
+	data = new std::vector<uint8_t>((size_t) size);
+
+	const bool ok =
+	        (SDL_RWread(ops, data->data(), 1, (size_t) size) == (size_t) size);
+	SDL_RWclose(ops);
+
+	if (!ok)
+	{
+		delete data;
+		return 0;
+	}
+
+	SDL_LockMutex(p->dataMutex);
+	/* The preload worker may have raced us in; keep the first */
+	if (std::vector<uint8_t> *prior = p->fontData.value(path, 0))
+	{
+		SDL_UnlockMutex(p->dataMutex);
+		delete data;
+		return prior;
+	}
+	p->fontData.insert(path, data);
+	SDL_UnlockMutex(p->dataMutex);
+
+	return data;
+}
+
 void SharedFontState::initFontSetCB(SDL_RWops &ops,
                                     const std::string &filename)
 {
@@ -174,8 +349,8 @@ _TTF_Font *SharedFontState::getFont(std::string family,
 		family = p->defaultFamily;
 
 	/* Check for substitutions */
-	if (p->subs.contains(family))
-		family = p->subs[family];
+	if (const std::string *sub = p->subs.valuePtr(family))
+		family = *sub;
 
 	/* Find out if the font asset exists */
 	const FontSet &req = p->sets[family];
@@ -208,8 +383,21 @@ _TTF_Font *SharedFontState::getFont(std::string family,
 		const char *path = !req.regular.empty()
 		                 ? req.regular.c_str() : req.other.c_str();
 
-		ops = SDL_AllocRW();
-		shState->fileSystem().openReadRaw(*ops, path, true);
+		/* Serve from the preloaded file contents if the
+		 * boot warmup already pulled them in */
+		SDL_LockMutex(p->dataMutex);
+		std::vector<uint8_t> *data = p->fontData.value(path, 0);
+		SDL_UnlockMutex(p->dataMutex);
+
+		if (data)
+		{
+			ops = SDL_RWFromConstMem(data->data(), data->size());
+		}
+		else
+		{
+			ops = SDL_AllocRW();
+			shState->fileSystem().openReadRaw(*ops, path, true);
+		}
 	}
 
 	// FIXME 0.9 is guesswork at this point
@@ -225,14 +413,213 @@ _TTF_Font *SharedFontState::getFont(std::string family,
 	return font;
 }
 
+/* The ranges the warmup rasterizes: printable ASCII, then the two
+ * kana blocks - the bread and butter of localized dialogue. Returns
+ * 0 past the end */
+static uint32_t nextWarmCp(uint32_t cp)
+{
+	if (cp == 0)
+		return 0x20;
+	if (cp < 0x7E)
+		return cp + 1;
+	if (cp == 0x7E)
+		return 0x3041;
+	if (cp < 0x309F)
+		return cp + 1;
+	if (cp == 0x309F)
+		return 0x30A0;
+	if (cp < 0x30FF)
+		return cp + 1;
+	return 0;
+}
+
+void SharedFontState::queueGlyphWarmup(const Config &conf)
+{
+	/* The game's default font first */
+	SharedFontStatePrivate::WarmupItem def;
+	def.family = "";
+	def.size = Font::getDefaultSize();
+	p->warmQueue.push_back(def);
+
+	for (size_t i = 0; i < conf.preloadFonts.size(); ++i)
+	{
+		const std::string &raw = conf.preloadFonts[i];
+		SharedFontStatePrivate::WarmupItem item;
+
+		const size_t sep = raw.find_last_of(':');
+		item.family = raw.substr(0, sep);
+		item.size = Font::getDefaultSize();
+
+		if (item.family.empty())
+			item.family = raw;
+		else if (sep != std::string::npos)
+		{
+			const int sz = atoi(raw.c_str() + sep + 1);
+			if (sz > 0)
+				item.size = sz;
+		}
+
+		p->warmQueue.push_back(item);
+	}
+
+	p->warmItem = 0;
+	p->warmCp = 0;
+}
+
+bool SharedFontState::glyphWarmupStep()
+{
+	if (p->warmItem >= p->warmQueue.size())
+		return false;
+
+	/* About a millisecond per frame: invisible next to vsync, and
+	 * the whole queue drains within a couple title-screen seconds */
+	const Uint64 freq = SDL_GetPerformanceFrequency();
+	const Uint64 deadline = SDL_GetPerformanceCounter() + freq / 1000;
+
+	while (p->warmItem < p->warmQueue.size())
+	{
+		const SharedFontStatePrivate::WarmupItem &item =
+		        p->warmQueue[p->warmItem];
+
+		TTF_Font *font = 0;
+
+		try {
+			font = getFont(item.family, item.size);
+		} catch (...) {
+			/* Unopenable face: skip the whole item */
+			p->warmItem++;
+			p->warmCp = 0;
+			continue;
+		}
+
+		TTF_SetFontStyle(font, TTF_STYLE_NORMAL);
+
+		int batch = 0;
+
+		for (;;)
+		{
+			p->warmCp = nextWarmCp(p->warmCp);
+
+			if (p->warmCp == 0)
+			{
+				p->warmItem++;
+				break;
+			}
+
+			/* Fill and the standard stroke variant, mirroring
+			 * what outlined RGSS text asks for */
+			glyphAtlas().request(font, TTF_STYLE_NORMAL,
+			                     (uint16_t) p->warmCp);
+			glyphAtlas().request(font, TTF_STYLE_NORMAL,
+			                     (uint16_t) p->warmCp, 1);
+
+			if (++batch >= 8)
+			{
+				if (SDL_GetPerformanceCounter() >= deadline)
+					return true;
+				batch = 0;
+			}
+		}
+	}
+
+	return p->warmItem < p->warmQueue.size();
+}
+
+void SharedFontState::preloadFonts(const Config &conf)
+{
+	for (size_t i = 0; i < conf.preloadFonts.size(); ++i)
+	{
+		const std::string &raw = conf.preloadFonts[i];
+
+		/* An optional ":size" suffix is accepted (and may
+		 * matter to future warming stages); only the family
+		 * decides which file to read */
+		std::string family = raw.substr(0, raw.find_last_of(':'));
+
+		if (family.empty())
+			family = raw;
+
+		std::transform(family.begin(), family.end(), family.begin(),
+			[](unsigned char c){ return std::tolower(c); });
+
+		if (const std::string *sub = p->subs.valuePtr(family))
+			family = *sub;
+
+		const FontSet &set = p->sets[family];
+
+		if (set.regular.empty() && set.other.empty())
+			continue;
+
+		const std::string &path = !set.regular.empty()
+		                        ? set.regular : set.other;
+
+		if (std::find(p->preloadQueue.begin(), p->preloadQueue.end(), path)
+		    == p->preloadQueue.end())
+			p->preloadQueue.push_back(path);
+	}
+
+	if (p->preloadQueue.empty())
+		return;
+
+	p->preloadThread = createSDLThread
+		<SharedFontState, &SharedFontState::preloadFun>(this, "font_preload");
+}
+
+void SharedFontState::preloadFun()
+{
+	for (size_t i = 0; i < p->preloadQueue.size(); ++i)
+	{
+		const std::string &path = p->preloadQueue[i];
+
+		std::vector<uint8_t> *data = new std::vector<uint8_t>;
+
+		try
+		{
+			SDL_RWops ops;
+			shState->fileSystem().openReadRaw(ops, path.c_str());
+
+			Sint64 size = SDL_RWsize(&ops);
+
+			if (size > 0)
+			{
+				data->resize(size);
+
+				if (SDL_RWread(&ops, data->data(), 1, size) != (size_t) size)
+					data->clear();
+			}
+
+			SDL_RWclose(&ops);
+		}
+		catch (const Exception &)
+		{
+			/* Missing font asset; the first real use reports it */
+		}
+
+		if (data->empty())
+		{
+			delete data;
+			continue;
+		}
+
+		SDL_LockMutex(p->dataMutex);
+
+		if (p->fontData.contains(path))
+			delete data;
+		else
+			p->fontData.insert(path, data);
+
+		SDL_UnlockMutex(p->dataMutex);
+	}
+}
+
 bool SharedFontState::fontPresent(std::string family) const
 {
 	std::transform(family.begin(), family.end(), family.begin(),
 		[](unsigned char c){ return std::tolower(c); });
 
 	/* Check for substitutions */
-	if (p->subs.contains(family))
-		family = p->subs[family];
+	if (const std::string *sub = p->subs.valuePtr(family))
+		family = *sub;
 
 	const FontSet &set = p->sets[family];
 
@@ -290,6 +677,8 @@ struct FontPrivate
 	bool italic;
 	bool outline;
 	bool shadow;
+	bool sdf;
+	bool shaped;
 	Color *color;
 	Color *outColor;
 
@@ -302,6 +691,8 @@ struct FontPrivate
 	static bool defaultItalic;
 	static bool defaultOutline;
 	static bool defaultShadow;
+	static bool defaultSDF;
+	static bool defaultShaped;
 	static Color *defaultColor;
 	static Color *defaultOutColor;
 
@@ -323,6 +714,8 @@ struct FontPrivate
 	      italic(defaultItalic),
 	      outline(defaultOutline),
 	      shadow(defaultShadow),
+	      sdf(defaultSDF),
+	      shaped(defaultShaped),
 	      color(&colorTmp),
 	      outColor(&outColorTmp),
 	      colorTmp(*defaultColor),
@@ -338,6 +731,8 @@ struct FontPrivate
 	      italic(other.italic),
 	      outline(other.outline),
 	      shadow(other.shadow),
+	      sdf(other.sdf),
+	      shaped(other.shaped),
 	      color(&colorTmp),
 	      outColor(&outColorTmp),
 	      colorTmp(*other.color),
@@ -354,6 +749,8 @@ struct FontPrivate
 		 italic   =  o.italic;
 		 outline  =  o.outline;
 		 shadow   =  o.shadow;
+		 sdf      =  o.sdf;
+		 shaped   =  o.shaped;
 		*color    = *o.color;
 		*outColor = *o.outColor;
 
@@ -367,6 +764,8 @@ int         FontPrivate::defaultSize     = 22;
 bool        FontPrivate::defaultBold     = false;
 bool        FontPrivate::defaultItalic   = false;
 bool        FontPrivate::defaultOutline  = false; /* Inited at runtime */
+bool        FontPrivate::defaultSDF      = false;
+bool        FontPrivate::defaultShaped   = false;
 bool        FontPrivate::defaultShadow   = false; /* Inited at runtime */
 Color      *FontPrivate::defaultColor    = &FontPrivate::defaultColorTmp;
 Color      *FontPrivate::defaultOutColor = &FontPrivate::defaultOutColorTmp;
@@ -446,6 +845,8 @@ DEF_ATTR_RD_SIMPLE(Font, Size, int, p->size)
 DEF_ATTR_SIMPLE(Font, Bold,     bool,    p->bold)
 DEF_ATTR_SIMPLE(Font, Italic,   bool,    p->italic)
 DEF_ATTR_SIMPLE(Font, Shadow,   bool,    p->shadow)
+DEF_ATTR_SIMPLE(Font, SDF,      bool,    p->sdf)
+DEF_ATTR_SIMPLE(Font, Shaped,   bool,    p->shaped)
 DEF_ATTR_SIMPLE(Font, Outline,  bool,    p->outline)
 DEF_ATTR_SIMPLE(Font, Color,    Color&, *p->color)
 DEF_ATTR_SIMPLE(Font, OutColor, Color&, *p->outColor)
@@ -455,6 +856,8 @@ DEF_ATTR_SIMPLE_STATIC(Font, DefaultBold,     bool,    FontPrivate::defaultBold)
 DEF_ATTR_SIMPLE_STATIC(Font, DefaultItalic,   bool,    FontPrivate::defaultItalic)
 DEF_ATTR_SIMPLE_STATIC(Font, DefaultShadow,   bool,    FontPrivate::defaultShadow)
 DEF_ATTR_SIMPLE_STATIC(Font, DefaultOutline,  bool,    FontPrivate::defaultOutline)
+DEF_ATTR_SIMPLE_STATIC(Font, DefaultSDF,      bool,    FontPrivate::defaultSDF)
+DEF_ATTR_SIMPLE_STATIC(Font, DefaultShaped,   bool,    FontPrivate::defaultShaped)
 DEF_ATTR_SIMPLE_STATIC(Font, DefaultColor,    Color&, *FontPrivate::defaultColor)
 DEF_ATTR_SIMPLE_STATIC(Font, DefaultOutColor, Color&, *FontPrivate::defaultOutColor)
 
@@ -513,6 +916,28 @@ void Font::initDefaults(const SharedFontState &sfs)
 	FontPrivate::defaultShadow  = (rgssVer == 2 ? true : false);
 }
 
+const std::string &Font::getFamilyName() const
+{
+	return p->name;
+}
+
+_TTF_Font *Font::getSdlFontAt(int size)
+{
+	TTF_Font *f = shState->fontState().getFont(p->name.c_str(), size);
+
+	int style = TTF_STYLE_NORMAL;
+
+	if (p->bold)
+		style |= TTF_STYLE_BOLD;
+
+	if (p->italic)
+		style |= TTF_STYLE_ITALIC;
+
+	TTF_SetFontStyle(f, style);
+
+	return f;
+}
+
 _TTF_Font *Font::getSdlFont()
 {
 	if (!p->sdlFont)
@@ -31,6 +31,10 @@
 struct SDL_RWops;
 struct _TTF_Font;
 struct Config;
+class GlyphAtlas;
+class ShapedAtlas;
+class SDFAtlas;
+class TextShaper;
 
 struct SharedFontStatePrivate;
 
@@ -52,9 +56,43 @@ public:
 
 	bool fontPresent(std::string family) const;
 
+	/* Reads the font files behind the config's "Family:size"
+	 * entries into memory on a background thread, so the
+	 * first message box doesn't hitch on TTF loads from the
+	 * archive. Called once after the font sets are known */
+	void preloadFonts(const Config &conf);
+
+	/* Worker entry */
+	void preloadFun();
+
+	/* Incremental glyph warmup: once queued, a slice of ASCII and
+	 * kana for the configured fonts rasterizes into the atlas each
+	 * frame (driven from Graphics::update during the title screen),
+	 * so the first real drawText finds everything hot. Step returns
+	 * false once the queue is drained */
+	void queueGlyphWarmup(const Config &conf);
+	bool glyphWarmupStep();
+
 	static _TTF_Font *openBundled(int size);
     void setDefaultFontFamily(const std::string &family);
 
+	/* Shared glyph atlas; created lazily on first use
+	 * because it needs a live GL context */
+	GlyphAtlas &glyphAtlas();
+
+	/* Shared SDF glyph atlas (Font#sdf); same lazy rules */
+	SDFAtlas &sdfAtlas();
+
+	/* HarfBuzz shaper (no-op stub without -Denable-harfbuzz) */
+	TextShaper &textShaper();
+
+	/* Shaped glyph atlas (Font#shaped); lazy, needs GL */
+	ShapedAtlas &shapedAtlas();
+
+	/* Raw file bytes behind a family (resolved like getFont),
+	 * cached for the program lifetime; 0 when unreadable */
+	const std::vector<uint8_t> *fontFileData(std::string family);
+
 private:
 	SharedFontStatePrivate *p;
 };
@@ -85,6 +123,12 @@ public:
 	DECL_ATTR( Shadow,   bool   )
 	DECL_ATTR( Outline,  bool   )
 	DECL_ATTR( OutColor, Color& )
+	/* Signed-distance-field rendering: glyphs are served from a
+	 * fixed-base-size SDF atlas at every scale (see sdfatlas.h) */
+	DECL_ATTR( SDF,      bool   )
+	/* HarfBuzz shaping (kerning, complex scripts); only effective
+	 * in builds with -Denable-harfbuzz (see textshaper.h) */
+	DECL_ATTR( Shaped,   bool   )
 
 	DECL_ATTR_STATIC( DefaultSize,     int    )
 	DECL_ATTR_STATIC( DefaultBold,     bool   )
@@ -93,6 +137,8 @@ public:
 	DECL_ATTR_STATIC( DefaultShadow,   bool   )
 	DECL_ATTR_STATIC( DefaultOutline,  bool   )
 	DECL_ATTR_STATIC( DefaultOutColor, Color& )
+	DECL_ATTR_STATIC( DefaultSDF,      bool   )
+	DECL_ATTR_STATIC( DefaultShaped,   bool   )
 
 	/* There is no point in providing getters for these,
 	 * as the bindings will always return the stored native
@@ -118,6 +164,13 @@ public:
 	/* internal */
 	_TTF_Font *getSdlFont();
 
+	/* Same face/style at an arbitrary pixel size, without
+	 * touching this font's own handle (SDF base rasterization) */
+	_TTF_Font *getSdlFontAt(int size);
+
+	/* The (possibly empty) configured family name */
+	const std::string &getFamilyName() const;
+
 private:
 	FontPrivate *p;
 };
@@ -26,11 +26,30 @@
 
 #include "gl-fun.h"
 
+#include <SDL_timer.h>
+
+#ifndef GL_DEBUG_SEVERITY_NOTIFICATION
+#define GL_DEBUG_SEVERITY_NOTIFICATION 0x826B
+#endif
+
 struct GLDebugLoggerPrivate
 {
 	std::ostream *stream;
 
-	GLDebugLoggerPrivate(const char *logFilename)
+	/* Sampling mode: suppress messages except during one armed
+	 * frame every 'intervalMS' */
+	bool sampling;
+	bool armed;
+	uint32_t intervalMS;
+	uint32_t lastArm;
+	uint64_t suppressed;
+
+	GLDebugLoggerPrivate(const char *logFilename, double sampleInterval)
+	    : sampling(sampleInterval > 0),
+	      armed(!(sampleInterval > 0)),
+	      intervalMS((uint32_t) (sampleInterval * 1000)),
+	      lastArm(0),
+	      suppressed(0)
 	{
 		(void) logFilename;
 
@@ -52,8 +71,34 @@ struct GLDebugLoggerPrivate
 		*stream << line << "\n";
 		stream->flush();
 	}
+
+	void frameTick()
+	{
+		if (!sampling)
+			return;
+
+		if (armed)
+			armed = false;
+
+		uint32_t now = SDL_GetTicks();
+
+		if (now - lastArm >= intervalMS)
+		{
+			lastArm = now;
+			armed = true;
+
+			writeTimestamp();
+			*stream << "-- sampled frame (" << suppressed
+			        << " messages suppressed since last window)\n";
+			stream->flush();
+
+			suppressed = 0;
+		}
+	}
 };
 
+static GLDebugLoggerPrivate *activeLogger = 0;
+
 static void APIENTRY arbDebugFunc(GLenum source,
                                   GLenum type,
                                   GLuint id,
@@ -68,24 +113,48 @@ static void APIENTRY arbDebugFunc(GLenum source,
 	(void) source;
 	(void) type;
 	(void) id;
-	(void) severity;
 	(void) length;
 
+	/* Notification chatter is never worth the I/O */
+	if (severity == GL_DEBUG_SEVERITY_NOTIFICATION)
+		return;
+
+	if (p->sampling && !p->armed)
+	{
+		++p->suppressed;
+		return;
+	}
+
 	p->writeTimestamp();
 	p->writeLine(message);
 }
 
-GLDebugLogger::GLDebugLogger(const char *filename)
+GLDebugLogger::GLDebugLogger(const char *filename, double sampleInterval)
 {
-	p = new GLDebugLoggerPrivate(filename);
+	p = new GLDebugLoggerPrivate(filename, sampleInterval);
 
 	if (gl.DebugMessageCallback)
+	{
 		gl.DebugMessageCallback(arbDebugFunc, p);
+		activeLogger = p;
+	}
 	else
 		Debug() << "DebugLogger: no debug extensions found";
 }
 
 GLDebugLogger::~GLDebugLogger()
 {
+	if (activeLogger == p)
+	{
+		gl.DebugMessageCallback(0, 0);
+		activeLogger = 0;
+	}
+
 	delete p;
 }
+
+void GLDebugLogger::frameTick()
+{
+	if (activeLogger)
+		activeLogger->frameTick();
+}
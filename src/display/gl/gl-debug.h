@@ -32,9 +32,16 @@ struct GLDebugLoggerPrivate;
 class GLDebugLogger
 {
 public:
-	GLDebugLogger(const char *filename = 0);
+	/* sampleInterval > 0 runs the logger in sampling mode:
+	 * messages are suppressed except during one armed frame
+	 * every that many seconds, cheap enough for live builds.
+	 * 0 logs everything (the classic debug behavior) */
+	GLDebugLogger(const char *filename = 0, double sampleInterval = 0);
 	~GLDebugLogger();
 
+	/* Call once per frame; arms/disarms the sampling window */
+	static void frameTick();
+
 private:
 	GLDebugLoggerPrivate *p;
 };
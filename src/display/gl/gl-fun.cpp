@@ -157,6 +157,66 @@ void initGLFunctions()
         throw EXC("No FBO support available");
     }
     
+    /* PBO readback entrypoints. On GLES, pixel pack buffers
+     * only exist from 3.0 onwards */
+    if (glMajor >= 3 || (!gles && HAVE_EXT(ARB_map_buffer_range)))
+    {
+#undef EXT_SUFFIX
+#define EXT_SUFFIX ""
+        GL_PBO_FUN;
+
+        gl.pbos = gl.MapBufferRange && gl.UnmapBuffer;
+    }
+
+    /* Persistent-mapped buffer streaming entrypoints */
+    if (!gles && (HAVE_EXT(ARB_buffer_storage) || glMajor > 4 ||
+                  (glMajor == 4 && (ver[2] - '0') >= 4)))
+    {
+#undef EXT_SUFFIX
+#define EXT_SUFFIX ""
+        GL_BUFFER_STORAGE_FUN;
+
+        gl.buffer_storage = gl.BufferStorage && gl.FenceSync &&
+                            gl.ClientWaitSync && gl.DeleteSync &&
+                            gl.MapBufferRange;
+    }
+
+    /* Program binary entrypoints */
+    if (HAVE_EXT(ARB_get_program_binary) || (gles && glMajor >= 3) ||
+        (!gles && (glMajor > 4 || (glMajor == 4 && (ver[2] - '0') >= 1))))
+    {
+#undef EXT_SUFFIX
+#define EXT_SUFFIX ""
+        GL_PROGRAM_BINARY_FUN;
+    }
+    else if (gles && HAVE_EXT(OES_get_program_binary))
+    {
+#undef EXT_SUFFIX
+#define EXT_SUFFIX "OES"
+        GL_PROGRAM_BINARY_FUN;
+    }
+
+    if (gl.GetProgramBinary && gl.ProgramBinary && gl.ProgramParameteri)
+    {
+        /* Drivers may expose the entry points yet support no
+         * binary format at all */
+        GLint formats = 0;
+        gl.GetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+        gl.program_binary = formats > 0;
+    }
+
+    /* Timer query entrypoints */
+    if (!gles && (glMajor > 3 || (glMajor == 3 && (ver[2] - '0') >= 3) ||
+                  HAVE_EXT(ARB_timer_query)))
+    {
+#undef EXT_SUFFIX
+#define EXT_SUFFIX ""
+        GL_TIMER_QUERY_FUN;
+
+        gl.timer_query = gl.GenQueries && gl.BeginQuery && gl.EndQuery &&
+                         gl.GetQueryObjectiv && gl.GetQueryObjectui64v;
+    }
+
     /* VAO entrypoints */
     if (HAVE_EXT(ARB_vertex_array_object) || glMajor >= 3)
     {
@@ -24,6 +24,7 @@
 #include "sharedstate.h"
 #include "glstate.h"
 #include "quad.h"
+#include "shader.h"
 #include "config.h"
 #include "etc.h"
 
@@ -32,13 +33,181 @@ namespace FBO
 	ID boundFramebufferID;
 }
 
+namespace TEX
+{
+	ID bound2D;
+}
+
 namespace GLMeta
 {
 
+/* Unpack staging ring: texture uploads are gathered into a
+ * mapped, orphaned pixel unpack buffer and DMA'd by the driver
+ * asynchronously, instead of stalling on client-memory uploads
+ * while the GPU is still busy with earlier work */
+enum { unpackRingBufs = 3 };
+
+static struct
+{
+	GLuint bufs[unpackRingBufs];
+	GLsizeiptr caps[unpackRingBufs];
+	int idx;
+	bool inited;
+} unpackRing;
+
+static void *unpackStagingMap(GLsizeiptr size)
+{
+	if (!gl.pbos || size <= 0)
+		return 0;
+
+	if (!unpackRing.inited)
+	{
+		gl.GenBuffers(unpackRingBufs, unpackRing.bufs);
+
+		for (int i = 0; i < unpackRingBufs; ++i)
+			unpackRing.caps[i] = 0;
+
+		unpackRing.idx = 0;
+		unpackRing.inited = true;
+	}
+
+	unpackRing.idx = (unpackRing.idx + 1) % unpackRingBufs;
+	const int i = unpackRing.idx;
+
+	gl.BindBuffer(GL_PIXEL_UNPACK_BUFFER, unpackRing.bufs[i]);
+
+	if (unpackRing.caps[i] < size)
+		unpackRing.caps[i] = size + size / 2;
+
+	/* Orphan the storage so the map never waits on in-flight
+	 * transfers from this ring slot */
+	gl.BufferData(GL_PIXEL_UNPACK_BUFFER, unpackRing.caps[i], 0, GL_STREAM_DRAW);
+
+	void *ptr = gl.MapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size,
+	                              GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+
+	if (!ptr)
+		gl.BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+	return ptr;
+}
+
+static void unpackStagingFinish()
+{
+	gl.UnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+}
+
+static void unpackStagingEnd()
+{
+	gl.BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+void stagedTexImage(GLsizei width, GLsizei height, const void *data, GLenum format)
+{
+	GLsizeiptr size = (GLsizeiptr) width * height * 4;
+	void *staged = unpackStagingMap(size);
+
+	if (staged)
+	{
+		memcpy(staged, data, size);
+		unpackStagingFinish();
+
+		TEX::uploadImage(width, height, 0, format);
+
+		unpackStagingEnd();
+		return;
+	}
+
+	TEX::uploadImage(width, height, data, format);
+}
+
+void stagedPlaneImage(GLsizei width, GLsizei height, const void *data)
+{
+	GLsizeiptr size = (GLsizeiptr) width * height;
+	void *staged = unpackStagingMap(size);
+
+	if (staged)
+	{
+		memcpy(staged, data, size);
+		unpackStagingFinish();
+
+		gl.TexImage2D(GL_TEXTURE_2D, 0, GL_LUMINANCE, width, height, 0,
+		              GL_LUMINANCE, GL_UNSIGNED_BYTE, 0);
+
+		unpackStagingEnd();
+		return;
+	}
+
+	gl.TexImage2D(GL_TEXTURE_2D, 0, GL_LUMINANCE, width, height, 0,
+	              GL_LUMINANCE, GL_UNSIGNED_BYTE, data);
+}
+
+void blitYUVPlanes(TEXFBO &target, const TEX::ID planeTex[3],
+                   int width, int height,
+                   const void *yp, const void *up, const void *vp)
+{
+	const int cw = width / 2, ch = height / 2;
+
+	/* Plane rows are tightly packed */
+	gl.PixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+	TEX::bind(planeTex[0]);
+	stagedPlaneImage(width, height, yp);
+	TEX::bind(planeTex[1]);
+	stagedPlaneImage(cw, ch, up);
+	TEX::bind(planeTex[2]);
+	stagedPlaneImage(cw, ch, vp);
+
+	gl.PixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+	FBO::bind(target.fbo);
+	glState.viewport.pushSet(IntRect(0, 0, target.width, target.height));
+	glState.blend.pushSet(false);
+
+	YUVShader &shader = shState->shaders().yuv();
+	shader.bind();
+	shader.applyViewportProj();
+	shader.setTranslation(Vec2i());
+	shader.setTexSize(Vec2i(width, height));
+	shader.setPlanes(planeTex[0], planeTex[1], planeTex[2]);
+
+	Quad &quad = shState->gpQuad();
+	quad.setTexPosRect(FloatRect(0, 0, width, height),
+	                   FloatRect(0, 0, width, height));
+	quad.setColor(Vec4(1, 1, 1, 1));
+	quad.draw();
+
+	glState.blend.pop();
+	glState.viewport.pop();
+}
+
 void subRectImageUpload(GLint srcW, GLint srcX, GLint srcY,
                         GLint dstX, GLint dstY, GLsizei dstW, GLsizei dstH,
                         SDL_Surface *src, GLenum format)
 {
+	/* Preferred: gather the rect into the staging ring and let
+	 * the driver DMA it; also covers drivers without the
+	 * unpack_subimage extension */
+	GLsizeiptr size = (GLsizeiptr) dstW * dstH * 4;
+	void *staged = unpackStagingMap(size);
+
+	if (staged)
+	{
+		const int bpp = src->format->BytesPerPixel;
+
+		for (GLint row = 0; row < dstH; ++row)
+			memcpy((char*) staged + (size_t) row * dstW * 4,
+			       (const char*) src->pixels + (size_t) (srcY + row) * src->pitch + (size_t) srcX * bpp,
+			       (size_t) dstW * 4);
+
+		unpackStagingFinish();
+
+		TEX::uploadSubImage(dstX, dstY, dstW, dstH, 0, format);
+
+		unpackStagingEnd();
+		return;
+	}
+
 	if (gl.unpack_subimage)
 	{
 		gl.PixelStorei(GL_UNPACK_ROW_LENGTH, srcW);
@@ -74,6 +243,13 @@ void subRectImageEnd()
 
 #define HAVE_NATIVE_VAO gl.GenVertexArrays
 
+/* Currently bound native VAO, for redundant bind elision.
+ * vaoUnbind is lazy: the VAO stays bound, so back-to-back draws
+ * from the same array skip the rebind entirely. Everything that
+ * mutates element array binding state outside a VAO calls
+ * vaoFlushUnbind() first */
+static GLuint boundNativeVAO = 0;
+
 static void vaoBindRes(VAO &vao)
 {
 	VBO::bind(vao.vbo);
@@ -96,7 +272,14 @@ void vaoInit(VAO &vao, bool keepBound)
 		gl.BindVertexArray(vao.nativeVAO);
 		vaoBindRes(vao);
 		if (!keepBound)
+		{
 			gl.BindVertexArray(0);
+			boundNativeVAO = 0;
+		}
+		else
+		{
+			boundNativeVAO = vao.nativeVAO;
+		}
 	}
 	else
 	{
@@ -111,22 +294,43 @@ void vaoInit(VAO &vao, bool keepBound)
 void vaoFini(VAO &vao)
 {
 	if (HAVE_NATIVE_VAO)
+	{
+		/* Deleting the bound VAO implicitly unbinds it */
+		if (boundNativeVAO == vao.nativeVAO)
+			boundNativeVAO = 0;
+
 		gl.DeleteVertexArrays(1, &vao.nativeVAO);
+	}
 }
 
 void vaoBind(VAO &vao)
 {
 	if (HAVE_NATIVE_VAO)
+	{
+		if (boundNativeVAO == vao.nativeVAO)
+			return;
+
+		boundNativeVAO = vao.nativeVAO;
 		gl.BindVertexArray(vao.nativeVAO);
+	}
 	else
 		vaoBindRes(vao);
 }
 
+void vaoFlushUnbind()
+{
+	if (HAVE_NATIVE_VAO && boundNativeVAO != 0)
+	{
+		gl.BindVertexArray(0);
+		boundNativeVAO = 0;
+	}
+}
+
 void vaoUnbind(VAO &vao)
 {
 	if (HAVE_NATIVE_VAO)
 	{
-		gl.BindVertexArray(0);
+		/* Lazy: see boundNativeVAO above */
 	}
 	else
 	{
@@ -138,7 +342,13 @@ void vaoUnbind(VAO &vao)
 	}
 }
 
-#define HAVE_NATIVE_BLIT (gl.BlitFramebuffer && shState->config().smoothScaling <= Bilinear && shState->config().smoothScalingDown <= Bilinear)
+/* Whether the current blit session runs on native framebuffer
+ * blits. Decided per blitBegin: a blit only needs the shader
+ * path when its own scale category actually selects one of the
+ * special filters - a bicubic screen-scaling config must not
+ * drag every same-size bitmap copy in the engine off the native
+ * path, which profiles several times faster for those */
+static bool blitNative = false;
 
 int blitScaleIsSpecial(TEXFBO &target, bool targetPreferHires, const IntRect &targetRect, TEXFBO &source, const IntRect &sourceRect)
 {
@@ -194,7 +404,10 @@ int smoothScalingMethod(int scaleIsSpecial)
 
 static void _blitBegin(FBO::ID fbo, const Vec2i &size, int scaleIsSpecial)
 {
-	if (HAVE_NATIVE_BLIT)
+	blitNative = gl.BlitFramebuffer &&
+	             smoothScalingMethod(scaleIsSpecial) <= Bilinear;
+
+	if (blitNative)
 	{
 		FBO::boundFramebufferID = fbo;
 		gl.BindFramebuffer(GL_DRAW_FRAMEBUFFER, fbo.gl);
@@ -208,7 +421,7 @@ static void _blitBegin(FBO::ID fbo, const Vec2i &size, int scaleIsSpecial)
 		{
 		case Bicubic:
 		{
-			BicubicShader &shader = shState->shaders().bicubic;
+			BicubicShader &shader = shState->shaders().bicubic();
 			shader.bind();
 			shader.applyViewportProj();
 			shader.setTranslation(Vec2i());
@@ -219,7 +432,7 @@ static void _blitBegin(FBO::ID fbo, const Vec2i &size, int scaleIsSpecial)
 			break;
 		case Lanczos3:
 		{
-			Lanczos3Shader &shader = shState->shaders().lanczos3;
+			Lanczos3Shader &shader = shState->shaders().lanczos3();
 			shader.bind();
 			shader.applyViewportProj();
 			shader.setTranslation(Vec2i());
@@ -230,7 +443,7 @@ static void _blitBegin(FBO::ID fbo, const Vec2i &size, int scaleIsSpecial)
 #ifdef MKXPZ_SSL
 		case xBRZ:
 		{
-			XbrzShader &shader = shState->shaders().xbrz;
+			XbrzShader &shader = shState->shaders().xbrz();
 			shader.bind();
 			shader.applyViewportProj();
 			shader.setTranslation(Vec2i());
@@ -302,7 +515,7 @@ void blitSource(TEXFBO &source, int scaleIsSpecial)
 		blitSrcHeightHires = blitSrcHeightLores;
 	}
 
-	if (HAVE_NATIVE_BLIT)
+	if (blitNative)
 	{
 		gl.BindFramebuffer(GL_READ_FRAMEBUFFER, source.fbo.gl);
 	}
@@ -312,7 +525,7 @@ void blitSource(TEXFBO &source, int scaleIsSpecial)
 		{
 		case Bicubic:
 		{
-			BicubicShader &shader = shState->shaders().bicubic;
+			BicubicShader &shader = shState->shaders().bicubic();
 			shader.bind();
 			shader.setTexSize(Vec2i(blitSrcWidthHires, blitSrcHeightHires));
 		}
@@ -320,7 +533,7 @@ void blitSource(TEXFBO &source, int scaleIsSpecial)
 			break;
 		case Lanczos3:
 		{
-			Lanczos3Shader &shader = shState->shaders().lanczos3;
+			Lanczos3Shader &shader = shState->shaders().lanczos3();
 			shader.bind();
 			shader.setTexSize(Vec2i(blitSrcWidthHires, blitSrcHeightHires));
 		}
@@ -329,7 +542,7 @@ void blitSource(TEXFBO &source, int scaleIsSpecial)
 #ifdef MKXPZ_SSL
 		case xBRZ:
 		{
-			XbrzShader &shader = shState->shaders().xbrz;
+			XbrzShader &shader = shState->shaders().xbrz();
 			shader.bind();
 			shader.setTexSize(Vec2i(blitSrcWidthHires, blitSrcHeightHires));
 		}
@@ -373,7 +586,7 @@ void blitRectangle(const IntRect &src, const IntRect &dst, bool smooth)
 	int scaledSrcHeight = src.h * blitSrcHeightHires / blitSrcHeightLores;
 	IntRect srcScaled(scaledSrcX, scaledSrcY, scaledSrcWidth, scaledSrcHeight);
 
-	if (HAVE_NATIVE_BLIT)
+	if (blitNative)
 	{
 		gl.BlitFramebuffer(srcScaled.x, srcScaled.y, srcScaled.x+srcScaled.w, srcScaled.y+srcScaled.h,
 		                   dstScaled.x, dstScaled.y, dstScaled.x+dstScaled.w, dstScaled.y+dstScaled.h,
@@ -384,7 +597,7 @@ void blitRectangle(const IntRect &src, const IntRect &dst, bool smooth)
 #ifdef MKXPZ_SSL
 		if (shState->config().smoothScaling == xBRZ)
 		{
-			XbrzShader &shader = shState->shaders().xbrz;
+			XbrzShader &shader = shState->shaders().xbrz();
 			shader.setTargetScale(Vec2((float)(shState->config().xbrzScalingFactor), (float)(shState->config().xbrzScalingFactor)));
 		}
 #endif
@@ -414,7 +627,7 @@ void blitEnd()
 	blitSrcHeightLores = 1;
 	blitSrcHeightHires = 1;
 
-	if (!HAVE_NATIVE_BLIT) {
+	if (!blitNative) {
 		glState.viewport.pop();
 	}
 }
@@ -37,6 +37,21 @@ void subRectImageUpload(GLint srcW, GLint srcX, GLint srcY,
                         SDL_Surface *src, GLenum format);
 void subRectImageEnd();
 
+/* Full-size texture upload through the unpack staging ring
+ * (plain client-memory upload without PBO support) */
+void stagedTexImage(GLsizei width, GLsizei height, const void *data, GLenum format);
+
+/* Same, for a tightly packed single-channel (luminance) plane;
+ * used by the movie path's YCbCr uploads */
+void stagedPlaneImage(GLsizei width, GLsizei height, const void *data);
+
+/* Upload three tightly packed YCbCr 4:2:0 planes through the staging
+ * ring and convert them into 'target' with the YUV shader (movie and
+ * streamed video frames). Caller taints/flags the target bitmap. */
+void blitYUVPlanes(TEXFBO &target, const TEX::ID planeTex[3],
+                   int width, int height,
+                   const void *yp, const void *up, const void *vp);
+
 /* ARB_vertex_array_object */
 struct VAO
 {
@@ -63,6 +78,9 @@ void vaoInit(VAO &vao, bool keepBound = false);
 void vaoFini(VAO &vao);
 void vaoBind(VAO &vao);
 void vaoUnbind(VAO &vao);
+/* Really unbinds the lazily kept VAO binding; required before
+ * touching GL_ELEMENT_ARRAY_BUFFER state outside a VAO */
+void vaoFlushUnbind();
 
 /* EXT_framebuffer_blit */
 int blitScaleIsSpecial(TEXFBO &target, bool targetPreferHires, const IntRect &targetRect, TEXFBO &source, const IntRect &sourceRect);
@@ -23,6 +23,8 @@
 #define GLUTIL_H
 
 #include "gl-fun.h"
+#include "vramstats.h"
+#include "glstate.h"
 #include "etc-internal.h"
 #include "sharedstate.h"
 #include "config.h"
@@ -55,6 +57,10 @@ namespace TEX
 {
 	DEF_GL_ID
 
+	/* 2D binding on texture unit 0, for redundant bind elision.
+	 * Everything that binds on unit 0 keeps this current */
+	extern ID bound2D;
+
 	inline ID gen()
 	{
 		ID id;
@@ -65,11 +71,25 @@ namespace TEX
 
 	static inline void del(ID id)
 	{
+		VramStats::onFree(id.gl);
+		/* The GL name can be recycled by a later gen() */
+		if (bound2D == id)
+			bound2D = ID(0);
+
 		gl.DeleteTextures(1, &id.gl);
 	}
 
 	static inline void bind(ID id)
 	{
+		++glStateStats.texBinds;
+
+		if (bound2D == id)
+		{
+			++glStateStats.texBindsElided;
+			return;
+		}
+
+		bound2D = id;
 		gl.BindTexture(GL_TEXTURE_2D, id.gl);
 	}
 
@@ -91,6 +111,7 @@ namespace TEX
 	static inline void allocEmpty(GLsizei width, GLsizei height)
 	{
 		gl.TexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+		VramStats::onAlloc(bound2D.gl, (size_t) width * height * 4);
 	}
 
 	static inline void setRepeat(bool mode)
@@ -23,26 +23,46 @@
 #define GLOBALIBO_H
 
 #include "gl-util.h"
+#include "gl-meta.h"
 
 #include <vector>
 #include <limits>
+#include <algorithm>
 #include <assert.h>
 #include <stdint.h>
 
+/* Desktop GL always has 32-bit indices; plain GLES2 only has
+ * them behind OES_element_index_uint, so that build keeps the
+ * 16-bit type (and its ~10900 quad ceiling per array) */
+#ifdef GLES2_HEADER
 typedef uint16_t index_t;
-#define INDEX_T_MAX std::numeric_limits<index_t>::max()
 #define _GL_INDEX_TYPE GL_UNSIGNED_SHORT
+#else
+typedef uint32_t index_t;
+#define _GL_INDEX_TYPE GL_UNSIGNED_INT
+#endif
+#define INDEX_T_MAX std::numeric_limits<index_t>::max()
 
 struct GlobalIBO
 {
 	IBO::ID ibo;
 	std::vector<index_t> buffer;
 
+	/* Diagnostics */
+	uint64_t uploads;
+
 	GlobalIBO()
+	    : uploads(0)
 	{
 		ibo = IBO::gen();
 	}
 
+	/* Current capacity, in quads */
+	size_t quadCapacity() const
+	{
+		return buffer.size() / 6;
+	}
+
 	~GlobalIBO()
 	{
 		IBO::del(ibo);
@@ -55,7 +75,16 @@ struct GlobalIBO
 		if (buffer.size() >= quadCount*6)
 			return;
 
-		size_t startInd = buffer.size() / 6;
+		/* Grow geometrically: repeated small increases then
+		 * amortize to O(log n) uploads, and existing indices
+		 * are only ever appended to, never rewritten */
+		size_t curQuads = buffer.size() / 6;
+		quadCount = std::max(quadCount, curQuads * 2);
+
+		if (quadCount*6 >= INDEX_T_MAX)
+			quadCount = (INDEX_T_MAX - 1) / 6;
+
+		size_t startInd = curQuads;
 		buffer.reserve(quadCount*6);
 
 		for (size_t i = startInd; i < quadCount; ++i)
@@ -66,8 +95,12 @@ struct GlobalIBO
 				buffer.push_back(i * 4 + indTemp[j]);
 		}
 
+		/* A lazily bound VAO would capture this binding */
+		GLMeta::vaoFlushUnbind();
+
 		IBO::bind(ibo);
 		IBO::uploadData(buffer.size() * sizeof(index_t), dataPtr(buffer));
+		++uploads;
 		IBO::unbind();
 	}
 };
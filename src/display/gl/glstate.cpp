@@ -101,7 +101,12 @@ void GLViewport::apply(const IntRect &value) {
   gl.Viewport(value.x, value.y, value.w, value.h);
 }
 
-void GLProgram::apply(const unsigned int &value) { gl.UseProgram(value); }
+void GLProgram::apply(const unsigned int &value) {
+  ++glStateStats.programSwitches;
+  gl.UseProgram(value);
+}
+
+GLStateStats glStateStats;
 
 GLState::Caps::Caps() { gl.GetIntegerv(GL_MAX_TEXTURE_SIZE, &maxTexSize); }
 
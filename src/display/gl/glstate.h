@@ -26,9 +26,25 @@
 
 #include <stack>
 #include <assert.h>
+#include <stdint.h>
 
 struct Config;
 
+/* Counters for how much redundant state traffic the GLState
+ * setters and the texture bind cache actually elide */
+struct GLStateStats
+{
+	uint64_t setCalls;
+	uint64_t setElided;
+	uint64_t texBinds;
+	uint64_t texBindsElided;
+	uint64_t uniformSets;
+	uint64_t uniformElided;
+	uint64_t programSwitches;
+};
+
+extern GLStateStats glStateStats;
+
 template<typename T>
 struct GLProperty
 {
@@ -49,8 +65,13 @@ struct GLProperty
 	const T &get()    { return current; }
 	void set(const T &value)
 	{
+		++glStateStats.setCalls;
+
 		if (value == current)
+		{
+			++glStateStats.setElided;
 			return;
+		}
 
 		init(value);
 	}
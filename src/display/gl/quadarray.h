@@ -37,29 +37,60 @@ struct QuadArray
 {
 	std::vector<VertexType> vertices;
 
-	VBO::ID vbo;
-	GLMeta::VAO vao;
+	/* With ARB_buffer_storage available, vertex data streams
+	 * through a ring of persistently mapped buffers guarded by
+	 * fences, so a commit never rewrites storage the GPU might
+	 * still be reading (a guaranteed stall on some drivers).
+	 * Without it, the classic BufferData/BufferSubData path
+	 * with orphaning on growth is used. */
+	enum { streamBufs = 3 };
+
+	VBO::ID vbo[streamBufs];
+	GLMeta::VAO vao[streamBufs];
+	void *mapped[streamBufs];
+	GLsync fences[streamBufs];
+	int bufIdx;
+	bool streaming;
 
 	size_t quadCount;
 	GLsizeiptr vboSize;
 
 	QuadArray()
-	    : quadCount(0),
+	    : bufIdx(0),
+	      streaming(gl.buffer_storage),
+	      quadCount(0),
 	      vboSize(-1)
 	{
-		vbo = VBO::gen();
+		const int bufCount = streaming ? streamBufs : 1;
 
-		GLMeta::vaoFillInVertexData<VertexType>(vao);
-		vao.vbo = vbo;
-		vao.ibo = shState->globalIBO().ibo;
+		for (int i = 0; i < bufCount; ++i)
+		{
+			mapped[i] = 0;
+			fences[i] = 0;
+
+			vbo[i] = VBO::gen();
+
+			GLMeta::vaoFillInVertexData<VertexType>(vao[i]);
+			vao[i].vbo = vbo[i];
+			vao[i].ibo = shState->globalIBO().ibo;
 
-		GLMeta::vaoInit(vao);
+			GLMeta::vaoInit(vao[i]);
+		}
 	}
 
 	~QuadArray()
 	{
-		GLMeta::vaoFini(vao);
-		VBO::del(vbo);
+		const int bufCount = streaming ? streamBufs : 1;
+
+		for (int i = 0; i < bufCount; ++i)
+		{
+			if (fences[i])
+				gl.DeleteSync(fences[i]);
+
+			/* Deleting the buffer implicitly unmaps it */
+			GLMeta::vaoFini(vao[i]);
+			VBO::del(vbo[i]);
+		}
 	}
 
 	void resize(size_t size)
@@ -78,10 +109,69 @@ struct QuadArray
 	 * and previous to the first 'draw()' call. */
 	void commit()
 	{
-		VBO::bind(vbo);
-
 		GLsizeiptr size = vertices.size() * sizeof(VertexType);
 
+		if (streaming)
+		{
+			if (size == 0)
+				return;
+
+			bufIdx = (bufIdx + 1) % streamBufs;
+
+			if (size > vboSize)
+			{
+				/* Immutable storage cannot grow; recreate all
+				 * ring buffers with headroom */
+				GLsizeiptr newSize = size + size / 2;
+
+				for (int i = 0; i < streamBufs; ++i)
+				{
+					if (fences[i])
+					{
+						gl.ClientWaitSync(fences[i], GL_SYNC_FLUSH_COMMANDS_BIT,
+						                  (GLuint64) -1);
+						gl.DeleteSync(fences[i]);
+						fences[i] = 0;
+					}
+
+					GLMeta::vaoFini(vao[i]);
+					VBO::del(vbo[i]);
+
+					vbo[i] = VBO::gen();
+					vao[i].vbo = vbo[i];
+					GLMeta::vaoInit(vao[i]);
+
+					VBO::bind(vbo[i]);
+					gl.BufferStorage(GL_ARRAY_BUFFER, newSize, 0,
+					                 GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT);
+					mapped[i] = gl.MapBufferRange(GL_ARRAY_BUFFER, 0, newSize,
+					                              GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT);
+					VBO::unbind();
+				}
+
+				vboSize = newSize;
+
+				shState->ensureQuadIBO(quadCount);
+			}
+			else if (fences[bufIdx])
+			{
+				/* The GPU had two whole frames worth of work
+				 * since this section was last written; in the
+				 * common case the fence has long signalled */
+				gl.ClientWaitSync(fences[bufIdx], GL_SYNC_FLUSH_COMMANDS_BIT,
+				                  (GLuint64) -1);
+				gl.DeleteSync(fences[bufIdx]);
+				fences[bufIdx] = 0;
+			}
+
+			if (mapped[bufIdx] && size > 0)
+				memcpy(mapped[bufIdx], dataPtr(vertices), size);
+
+			return;
+		}
+
+		VBO::bind(vbo[0]);
+
 		if (size > vboSize)
 		{
 			/* New data exceeds already allocated size.
@@ -102,12 +192,22 @@ struct QuadArray
 
 	void draw(size_t offset, size_t count)
 	{
-		GLMeta::vaoBind(vao);
+		const int i = streaming ? bufIdx : 0;
+
+		GLMeta::vaoBind(vao[i]);
 
 		const char *_offset = (const char*) 0 + offset * 6 * sizeof(index_t);
 		gl.DrawElements(GL_TRIANGLES, count * 6, _GL_INDEX_TYPE, _offset);
 
-		GLMeta::vaoUnbind(vao);
+		GLMeta::vaoUnbind(vao[i]);
+
+		if (streaming)
+		{
+			if (fences[i])
+				gl.DeleteSync(fences[i]);
+
+			fences[i] = gl.FenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		}
 	}
 
 	void draw()
@@ -21,8 +21,12 @@
 
 #include "scene.h"
 #include "sharedstate.h"
+#include "quadarray.h"
+#include "shader.h"
+#include "glstate.h"
 
 Scene::Scene()
+    : drawOrderDirty(true)
 {}
 
 Scene::~Scene()
@@ -47,11 +51,13 @@ void Scene::insert(SceneElement &element)
 		if (element < *e)
 		{
 			elements.insertBefore(element.link, *iter);
+			drawOrderDirty = true;
 			return;
 		}
 	}
 
 	elements.append(element.link);
+	drawOrderDirty = true;
 }
 
 void Scene::insertAfter(SceneElement &element, SceneElement &after)
@@ -65,17 +71,73 @@ void Scene::insertAfter(SceneElement &element, SceneElement &after)
 		if (element < *e)
 		{
 			elements.insertBefore(element.link, *iter);
+			drawOrderDirty = true;
 			return;
 		}
 	}
 
 	elements.append(element.link);
+	drawOrderDirty = true;
 }
 
+/* Counters to verify how local reordering actually is */
+SceneReorderStats sceneReorderStats;
+uint64_t sceneCulledCount = 0;
+
 void Scene::reinsert(SceneElement &element)
 {
+	++sceneReorderStats.ops;
+
+	drawOrderDirty = true;
+
+	/* Z/Y changes (per-step Y sorting in particular) usually
+	 * move an element only a few places, so search from its
+	 * current position instead of rescanning from the head */
+	IntruListLink<SceneElement> *prev = element.link.prev;
+	IntruListLink<SceneElement> *next = element.link.next;
+
+	if (!prev || !next)
+	{
+		/* Not linked; plain ordered insert */
+		insert(element);
+		return;
+	}
+
 	elements.remove(element.link);
-	insert(element);
+
+	/* Needs to move backward? */
+	if (prev->data && element < *prev->data)
+	{
+		IntruListLink<SceneElement> *iter = prev;
+
+		while (iter->data && element < *iter->data)
+		{
+			iter = iter->prev;
+			++sceneReorderStats.hops;
+		}
+
+		/* iter is now the last node ordered before us */
+		elements.insertBefore(element.link, *iter->next);
+		return;
+	}
+
+	/* Needs to move forward? */
+	if (next->data && *next->data < element)
+	{
+		IntruListLink<SceneElement> *iter = next;
+
+		while (iter->data && *iter->data < element)
+		{
+			iter = iter->next;
+			++sceneReorderStats.hops;
+		}
+
+		elements.insertBefore(element.link, *iter);
+		return;
+	}
+
+	/* Order relative to the old neighbours is unchanged */
+	elements.insertBefore(element.link, *next);
 }
 
 void Scene::notifyGeometryChange()
@@ -88,17 +150,147 @@ void Scene::notifyGeometryChange()
 	}
 }
 
+/* Counters for the most recent composite pass (deltas of the
+ * cumulative state/batch counters across one Scene::composite):
+ * the feedback loop for batching and for A/B-ing script changes
+ * by draw-call count instead of eyeballing fps */
+SceneCompositeStats sceneCompositeStats;
+
+bool sceneCompositing = false;
+
 void Scene::composite()
 {
-	IntruListLink<SceneElement> *iter;
+	SceneQuadBatch &batch = SceneQuadBatch::instance();
 
-	for (iter = elements.begin(); iter != elements.end(); iter = iter->next)
+	sceneCompositing = true;
+
+	const uint64_t draws0 = batch.stats().batches;
+	const uint64_t quads0 = batch.stats().quads;
+	const uint64_t binds0 = glStateStats.texBinds;
+	const uint64_t progs0 = glStateStats.programSwitches;
+	uint64_t drawn = 0;
+
+	/* One pointer-chase when the order changed, then the walk
+	 * below touches contiguous memory. Nothing mutates the
+	 * element list inside a draw cycle */
+	if (drawOrderDirty)
 	{
-		SceneElement *e = iter->data;
+		drawOrder.clear();
+
+		IntruListLink<SceneElement> *iter;
 
-		if (e->visible)
-			e->draw();
+		for (iter = elements.begin(); iter != elements.end();
+		     iter = iter->next)
+			drawOrder.push_back(iter->data);
+
+		drawOrderDirty = false;
+		++sceneCompositeStats.orderRebuilds;
 	}
+
+	for (size_t i = 0; i < drawOrder.size(); ++i)
+	{
+		SceneElement *e = drawOrder[i];
+
+		if (!e->visible)
+			continue;
+
+		drawn++;
+
+		/* Anything that renders on its own terms must come
+		 * after everything batched so far */
+		if (!e->batchable())
+			batch.flush();
+
+		e->draw();
+	}
+
+	batch.flush();
+
+	sceneCompositeStats.drawCalls = batch.stats().batches - draws0;
+	sceneCompositeStats.quads = batch.stats().quads - quads0;
+	sceneCompositeStats.vertices = sceneCompositeStats.quads * 4;
+	sceneCompositeStats.texBinds = glStateStats.texBinds - binds0;
+	sceneCompositeStats.programSwitches =
+	        glStateStats.programSwitches - progs0;
+	sceneCompositeStats.elements = drawn;
+
+	sceneCompositing = false;
+}
+
+SceneQuadBatch &SceneQuadBatch::instance()
+{
+	static SceneQuadBatch *b = new SceneQuadBatch;
+	return *b;
+}
+
+SceneQuadBatch::SceneQuadBatch()
+    : qArray(0),
+      keyTex(0),
+      keyBlend(BlendNormal),
+      keyMode(Plain)
+{
+	st.batches = 0;
+	st.quads = 0;
+	st.maxBatch = 0;
+}
+
+void SceneQuadBatch::append(const Vertex *verts, size_t quadCount,
+                            TEX::ID tex, const Vec2i &texSize, BlendType blend,
+                            Mode mode)
+{
+	if (!pending.empty() &&
+	    (!(tex == keyTex) || blend != keyBlend || mode != keyMode))
+		flush();
+
+	keyTex = tex;
+	keyTexSize = texSize;
+	keyBlend = blend;
+	keyMode = mode;
+
+	pending.insert(pending.end(), verts, verts + quadCount * 4);
+}
+
+void SceneQuadBatch::flush()
+{
+	if (pending.empty())
+		return;
+
+	if (!qArray)
+		qArray = new ColorQuadArray;
+
+	const size_t quadCount = pending.size() / 4;
+
+	qArray->resize(quadCount);
+	std::copy(pending.begin(), pending.end(), qArray->vertices.begin());
+	qArray->commit();
+
+	ShaderBase *shader;
+
+	if (keyMode == Flash)
+		shader = &shState->shaders().flashTint;
+	else
+		shader = &shState->shaders().simple;
+
+	shader->bind();
+	shader->setTexSize(keyTexSize);
+	shader->setTranslation(Vec2i());
+	shader->applyViewportProj();
+
+	glState.blendMode.pushSet(keyBlend);
+
+	TEX::bind(keyTex);
+	TEX::setSmooth(false);
+
+	qArray->draw();
+
+	glState.blendMode.pop();
+
+	pending.clear();
+
+	++st.batches;
+	st.quads += quadCount;
+	if (quadCount > st.maxBatch)
+		st.maxBatch = (uint32_t) quadCount;
 }
 
 
@@ -198,5 +390,8 @@ void SceneElement::setSpriteY(int value)
 void SceneElement::unlink()
 {
 	if (scene)
+	{
 		scene->elements.remove(link);
+		scene->drawOrderDirty = true;
+	}
 }
@@ -26,6 +26,13 @@
 #include "intrulist.h"
 #include "etc.h"
 #include "etc-internal.h"
+#include "gl-util.h"
+#include "vertex.h"
+
+struct TEXFBO;
+
+#include <stdint.h>
+#include <vector>
 
 class SceneElement;
 class Viewport;
@@ -59,6 +66,10 @@ public:
 	                                   const Vec4& /* flash */,
 	                                   const Vec4& /* tone */) {}
 
+	/* The buffer currently being composited into, if the scene
+	 * renders to one (used for viewport region caching) */
+	virtual TEXFBO *renderTarget() { return 0; }
+
 	const Geometry &getGeometry() const { return geometry; }
 
 protected:
@@ -70,6 +81,13 @@ protected:
 	void notifyGeometryChange();
 
 	IntruList<SceneElement> elements;
+
+	/* Flat draw-order mirror of 'elements', rebuilt lazily when
+	 * the list mutates; composite() walks these contiguous
+	 * pointers instead of chasing list links across the heap */
+	std::vector<SceneElement*> drawOrder;
+	bool drawOrderDirty;
+
 	Geometry geometry;
 
 	friend class SceneElement;
@@ -91,6 +109,12 @@ public:
 
 	virtual void aboutToAccess() const = 0;
 
+	/* Elements whose draw only appends pre-transformed quads to
+	 * the shared scene batch return true here; anything else
+	 * makes the composite loop flush the batch first, so draw
+	 * order is always preserved */
+	virtual bool batchable() const { return false; }
+
 protected:
 	/* A bit about OpenGL state:
 	 *
@@ -152,4 +176,88 @@ private:
 #define ABOUT_TO_ACCESS_DISP \
 	void aboutToAccess() const { guardDisposed(); }
 
+/* Reorder instrumentation for z/y-sort churn */
+struct SceneReorderStats
+{
+	uint64_t ops;
+	uint64_t hops;
+};
+
+extern SceneReorderStats sceneReorderStats;
+
+/* Most recent composite pass, as deltas over one Scene::composite
+ * (see scene.cpp); surfaced through Graphics.composite_stats */
+struct SceneCompositeStats
+{
+	uint64_t drawCalls;
+	uint64_t quads;
+	uint64_t vertices;
+	uint64_t texBinds;
+	uint64_t programSwitches;
+	uint64_t elements;
+
+	/* Draw-order snapshot rebuilds caused by list mutation;
+	 * ~0 in steady state, spikes flag scenes that reorder
+	 * every frame */
+	uint64_t orderRebuilds;
+};
+
+extern SceneCompositeStats sceneCompositeStats;
+
+/* True while a scene composite pass is running; work that must
+ * not disturb the active render target (e.g. texture residency
+ * loads) defers itself to the next prepare phase */
+extern bool sceneCompositing;
+
+/* Elements skipped because their bounds fell outside the
+ * visible scene region */
+extern uint64_t sceneCulledCount;
+
+template<class VertexType> struct QuadArray;
+
+/* Accumulates consecutive plain textured quads that share
+ * texture and blend mode, and draws them with a single call.
+ * 200 pictures sharing one texture then cost one draw */
+class SceneQuadBatch
+{
+public:
+	struct Stats
+	{
+		uint64_t batches;
+		uint64_t quads;
+		uint32_t maxBatch;
+	};
+
+	static SceneQuadBatch &instance();
+
+	enum Mode
+	{
+		Plain = 0,  /* plain textured quads */
+		Flash       /* flash color in the vertex color */
+	};
+
+	/* Quads are pre-transformed into scene space; a key
+	 * mismatch flushes the previous batch */
+	void append(const Vertex *verts, size_t quadCount,
+	            TEX::ID tex, const Vec2i &texSize, BlendType blend,
+	            Mode mode);
+
+	void flush();
+
+	const Stats &stats() const { return st; }
+
+private:
+	SceneQuadBatch();
+
+	std::vector<Vertex> pending;
+	QuadArray<Vertex> *qArray;
+
+	TEX::ID keyTex;
+	Vec2i keyTexSize;
+	BlendType keyBlend;
+	Mode keyMode;
+
+	Stats st;
+};
+
 #endif // SCENE_H
@@ -28,6 +28,10 @@
 
 #include <assert.h>
 #include <string.h>
+#include <stdio.h>
+#include <ctype.h>
+#include <vector>
+#include <SDL_rwops.h>
 #include <iostream>
 
 #ifndef MKXPZ_BUILD_XCODE
@@ -43,6 +47,10 @@
 #include "simple.frag.xxd"
 #include "simpleColor.frag.xxd"
 #include "simpleAlpha.frag.xxd"
+#include "glyph.frag.xxd"
+#include "sdfGlyph.frag.xxd"
+#include "yuv.frag.xxd"
+#include "flashTint.frag.xxd"
 #include "simpleAlphaUni.frag.xxd"
 #include "tilemap.frag.xxd"
 #include "flashMap.frag.xxd"
@@ -57,6 +65,7 @@
 #include "sprite.vert.xxd"
 #include "tilemap.vert.xxd"
 #include "blur.frag.xxd"
+#include "blurHue.frag.xxd"
 #include "simpleMatrix.vert.xxd"
 #include "blurH.vert.xxd"
 #include "blurV.vert.xxd"
@@ -71,12 +80,23 @@
     std::string f = mkxp_fs::contentsOfAssetAsString("Shaders/" #frag, "frag"); \
     Shader::init((const unsigned char*)v.c_str(), v.length(), (const unsigned char*)f.c_str(), f.length(), #vert, #frag, #name); \
 }
+#define INIT_SHADER_DEF(vert, frag, name, defs) \
+{ \
+    std::string v = mkxp_fs::contentsOfAssetAsString("Shaders/" #vert, "vert"); \
+    std::string f = mkxp_fs::contentsOfAssetAsString("Shaders/" #frag, "frag"); \
+    Shader::init((const unsigned char*)v.c_str(), v.length(), (const unsigned char*)f.c_str(), f.length(), #vert, #frag, #name, defs); \
+}
 #else
 #define INIT_SHADER(vert, frag, name) \
 { \
 	Shader::init(___shader_##vert##_vert, ___shader_##vert##_vert_len, ___shader_##frag##_frag, ___shader_##frag##_frag_len, \
 	#vert, #frag, #name); \
 }
+#define INIT_SHADER_DEF(vert, frag, name, defs) \
+{ \
+	Shader::init(___shader_##vert##_vert, ___shader_##vert##_vert_len, ___shader_##frag##_frag, ___shader_##frag##_frag_len, \
+	#vert, #frag, #name, defs); \
+}
 #endif
 
 #define GET_U(name) u_##name = gl.GetUniformLocation(program, #name)
@@ -85,6 +105,90 @@
     std::string Shader::shaderCommon = "";
 #endif
 
+std::string Shader::binaryCacheDir;
+
+void Shader::setBinaryCacheDir(const std::string &dir)
+{
+	binaryCacheDir = dir;
+}
+
+/* FNV-1a, used to key cached program binaries on both the
+ * shader sources and the driver identity */
+static uint32_t fnv1a(uint32_t hash, const void *data, size_t len)
+{
+	const unsigned char *bytes = (const unsigned char*) data;
+
+	for (size_t i = 0; i < len; ++i)
+	{
+		hash ^= bytes[i];
+		hash *= 16777619u;
+	}
+
+	return hash;
+}
+
+static uint32_t fnv1aStr(uint32_t hash, const char *str)
+{
+	return str ? fnv1a(hash, str, strlen(str)) : hash;
+}
+
+bool Shader::tryLoadBinary(const std::string &path)
+{
+	SDL_RWops *ops = SDL_RWFromFile(path.c_str(), "rb");
+
+	if (!ops)
+		return false;
+
+	Sint64 size = SDL_RWsize(ops);
+
+	if (size <= (Sint64) sizeof(uint32_t))
+	{
+		SDL_RWclose(ops);
+		return false;
+	}
+
+	uint32_t format = SDL_ReadLE32(ops);
+	std::vector<char> blob(size - sizeof(uint32_t));
+	size_t read = SDL_RWread(ops, blob.data(), 1, blob.size());
+	SDL_RWclose(ops);
+
+	if (read != blob.size())
+		return false;
+
+	gl.ProgramBinary(program, (GLenum) format, blob.data(), (GLsizei) blob.size());
+
+	GLint success = 0;
+	gl.GetProgramiv(program, GL_LINK_STATUS, &success);
+
+	return success == GL_TRUE;
+}
+
+void Shader::storeBinary(const std::string &path)
+{
+	GLint length = 0;
+	gl.GetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+
+	if (length <= 0)
+		return;
+
+	std::vector<char> blob(length);
+	GLenum format = 0;
+	GLsizei written = 0;
+	gl.GetProgramBinary(program, length, &written, &format, blob.data());
+
+	if (written <= 0)
+		return;
+
+	SDL_RWops *ops = SDL_RWFromFile(path.c_str(), "wb");
+
+	if (!ops)
+		return;
+
+	SDL_WriteLE32(ops, (uint32_t) format);
+	SDL_RWwrite(ops, blob.data(), 1, written);
+	SDL_RWclose(ops);
+}
+
 static void printShaderLog(GLuint shader)
 {
 	GLint logLength;
@@ -144,13 +248,14 @@ std::string &Shader::commonHeader() {
 #endif
 
 static void setupShaderSource(GLuint shader, GLenum type,
-                              const unsigned char *body, int bodySize)
+                              const unsigned char *body, int bodySize,
+                              const char *defines = 0)
 {
 	static const char glesDefine[] = "#define GLSLES\n";
 	static const char fragDefine[] = "#define FRAGMENT_SHADER\n";
 
-	const GLchar *shaderSrc[4];
-	GLint shaderSrcSize[4];
+	const GLchar *shaderSrc[5];
+	GLint shaderSrcSize[5];
 	size_t i = 0;
 
 	if (gl.glsles)
@@ -167,6 +272,15 @@ static void setupShaderSource(GLuint shader, GLenum type,
 		++i;
 	}
 
+	/* Per-program variant defines (compile-time effect
+	 * stripping) */
+	if (defines)
+	{
+		shaderSrc[i] = defines;
+		shaderSrcSize[i] = strlen(defines);
+		++i;
+	}
+
 #ifndef MKXPZ_BUILD_XCODE
 	shaderSrc[i] = (const GLchar*) ___shader_common_h;
 	shaderSrcSize[i] = ___shader_common_h_len;
@@ -186,12 +300,50 @@ static void setupShaderSource(GLuint shader, GLenum type,
 void Shader::init(const unsigned char *vert, int vertSize,
                   const unsigned char *frag, int fragSize,
                   const char *vertName, const char *fragName,
-                  const char *programName)
+                  const char *programName,
+                  const char *defines)
 {
 	GLint success;
 
+	/* With driver support, linked program binaries are cached
+	 * on disk keyed by shader sources and driver identity, so
+	 * later launches skip source compilation entirely */
+	std::string cachePath;
+
+	if (gl.program_binary && !binaryCacheDir.empty())
+	{
+		uint32_t hash = 2166136261u;
+		hash = fnv1aStr(hash, (const char*) gl.GetString(GL_VENDOR));
+		hash = fnv1aStr(hash, (const char*) gl.GetString(GL_RENDERER));
+		hash = fnv1aStr(hash, (const char*) gl.GetString(GL_VERSION));
+#ifndef MKXPZ_BUILD_XCODE
+		hash = fnv1a(hash, ___shader_common_h, ___shader_common_h_len);
+#else
+		hash = fnv1a(hash, commonHeader().c_str(), commonHeader().size());
+#endif
+		hash = fnv1a(hash, vert, vertSize);
+		hash = fnv1a(hash, frag, fragSize);
+		hash = fnv1aStr(hash, defines);
+
+		/* Program names contain '::'; keep filenames portable */
+		std::string name(programName);
+		for (size_t i = 0; i < name.size(); ++i)
+			if (!isalnum((unsigned char) name[i]))
+				name[i] = '_';
+
+		char hex[16];
+		snprintf(hex, sizeof(hex), "%08x", hash);
+
+		cachePath = binaryCacheDir + "/shadercache-" + name + "-" + hex + ".bin";
+
+		if (tryLoadBinary(cachePath))
+			return;
+
+		gl.ProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	}
+
 	/* Compile vertex shader */
-	setupShaderSource(vertShader, GL_VERTEX_SHADER, vert, vertSize);
+	setupShaderSource(vertShader, GL_VERTEX_SHADER, vert, vertSize, defines);
 	gl.CompileShader(vertShader);
 
 	gl.GetShaderiv(vertShader, GL_COMPILE_STATUS, &success);
@@ -205,7 +357,7 @@ void Shader::init(const unsigned char *vert, int vertSize,
 	}
 
 	/* Compile fragment shader */
-	setupShaderSource(fragShader, GL_FRAGMENT_SHADER, frag, fragSize);
+	setupShaderSource(fragShader, GL_FRAGMENT_SHADER, frag, fragSize, defines);
 	gl.CompileShader(fragShader);
 
 	gl.GetShaderiv(fragShader, GL_COMPILE_STATUS, &success);
@@ -237,6 +389,9 @@ void Shader::init(const unsigned char *vert, int vertSize,
 	                    "GLSL: An error occured while linking program '%s' (vertex '%s', fragment '%s')",
 	                    programName, vertName, fragName);
 	}
+
+	if (!cachePath.empty())
+		storeBinary(cachePath);
 }
 
 void Shader::initFromFile(const char *_vertFile, const char *_fragFile,
@@ -265,6 +420,10 @@ void Shader::setTexUniform(GLint location, unsigned unitIndex, TEX::ID texture)
 {
 	GLenum texUnit = GL_TEXTURE0 + unitIndex;
 
+	/* Keep the unit 0 bind cache current */
+	if (unitIndex == 0)
+		TEX::bound2D = texture;
+
 	gl.ActiveTexture(texUnit);
 	gl.BindTexture(GL_TEXTURE_2D, texture.gl);
 	gl.Uniform1i(location, unitIndex);
@@ -316,11 +475,33 @@ bool ShaderBase::framebufferScalingAllowed()
 
 void ShaderBase::setTexSize(const Vec2i &value)
 {
+	++glStateStats.uniformSets;
+
+	if (texSizeValid && value == curTexSize)
+	{
+		++glStateStats.uniformElided;
+		return;
+	}
+
+	curTexSize = value;
+	texSizeValid = true;
+
 	gl.Uniform2f(u_texSizeInv, 1.f / value.x, 1.f / value.y);
 }
 
 void ShaderBase::setTranslation(const Vec2i &value)
 {
+	++glStateStats.uniformSets;
+
+	if (translationValid && value == curTranslation)
+	{
+		++glStateStats.uniformElided;
+		return;
+	}
+
+	curTranslation = value;
+	translationValid = true;
+
 	gl.Uniform2f(u_translation, value.x, value.y);
 }
 
@@ -347,6 +528,7 @@ SimpleShader::SimpleShader()
 	ShaderBase::init();
 
 	GET_U(texOffsetX);
+	GET_U(texOffset);
 }
 
 void SimpleShader::setTexOffsetX(int value)
@@ -354,6 +536,11 @@ void SimpleShader::setTexOffsetX(int value)
 	gl.Uniform1f(u_texOffsetX, value);
 }
 
+void SimpleShader::setTexOffset(const Vec2 &value)
+{
+	setVec2Uniform(u_texOffset, value);
+}
+
 
 SimpleColorShader::SimpleColorShader()
 {
@@ -370,6 +557,34 @@ SimpleAlphaShader::SimpleAlphaShader()
 	ShaderBase::init();
 }
 
+GlyphShader::GlyphShader()
+{
+	INIT_SHADER(simpleColor, glyph, GlyphShader);
+
+	ShaderBase::init();
+}
+
+SDFGlyphShader::SDFGlyphShader()
+{
+	INIT_SHADER(simpleColor, sdfGlyph, SDFGlyphShader);
+
+	ShaderBase::init();
+
+	GET_U(smoothing);
+}
+
+void SDFGlyphShader::setSmoothing(float value)
+{
+	gl.Uniform1f(u_smoothing, value);
+}
+
+FlashTintShader::FlashTintShader()
+{
+	INIT_SHADER(simpleColor, flashTint, FlashTintShader);
+
+	ShaderBase::init();
+}
+
 
 SimpleSpriteShader::SimpleSpriteShader()
 {
@@ -378,8 +593,25 @@ SimpleSpriteShader::SimpleSpriteShader()
 	ShaderBase::init();
 
 	GET_U(spriteMat);
+	GET_U(waveActive);
+	GET_U(waveAmp);
+	GET_U(wavePhase);
+	GET_U(waveFreq);
 }
 
+void SimpleSpriteShader::setWave(bool active, float amp, float phase, float freq)
+{
+	gl.Uniform1i(u_waveActive, active);
+
+	if (!active)
+		return;
+
+	gl.Uniform1f(u_waveAmp, amp);
+	gl.Uniform1f(u_wavePhase, phase);
+	gl.Uniform1f(u_waveFreq, freq);
+}
+
+
 void SimpleSpriteShader::setSpriteMat(const float value[16])
 {
 	gl.UniformMatrix4fv(u_spriteMat, 1, GL_FALSE, value);
@@ -443,8 +675,25 @@ AlphaSpriteShader::AlphaSpriteShader()
 
 	GET_U(spriteMat);
 	GET_U(alpha);
+	GET_U(waveActive);
+	GET_U(waveAmp);
+	GET_U(wavePhase);
+	GET_U(waveFreq);
+}
+
+void AlphaSpriteShader::setWave(bool active, float amp, float phase, float freq)
+{
+	gl.Uniform1i(u_waveActive, active);
+
+	if (!active)
+		return;
+
+	gl.Uniform1f(u_waveAmp, amp);
+	gl.Uniform1f(u_wavePhase, phase);
+	gl.Uniform1f(u_waveFreq, freq);
 }
 
+
 void AlphaSpriteShader::setSpriteMat(const float value[16])
 {
 	gl.UniformMatrix4fv(u_spriteMat, 1, GL_FALSE, value);
@@ -529,6 +778,10 @@ SpriteShader::SpriteShader()
 	ShaderBase::init();
 
 	GET_U(spriteMat);
+	GET_U(waveActive);
+	GET_U(waveAmp);
+	GET_U(wavePhase);
+	GET_U(waveFreq);
 	GET_U(tone);
 	GET_U(color);
 	GET_U(opacity);
@@ -545,6 +798,18 @@ SpriteShader::SpriteShader()
     GET_U(invert);
 }
 
+void SpriteShader::setWave(bool active, float amp, float phase, float freq)
+{
+	gl.Uniform1i(u_waveActive, active);
+
+	if (!active)
+		return;
+
+	gl.Uniform1f(u_waveAmp, amp);
+	gl.Uniform1f(u_wavePhase, phase);
+	gl.Uniform1f(u_waveFreq, freq);
+}
+
 void SpriteShader::setSpriteMat(const float value[16])
 {
 	gl.UniformMatrix4fv(u_spriteMat, 1, GL_FALSE, value);
@@ -617,6 +882,54 @@ void SpriteShader::setInvert(bool value)
 }
 
 
+LiteSpriteShader::LiteSpriteShader()
+{
+	INIT_SHADER_DEF(sprite, sprite, LiteSpriteShader, "#define SPRITE_LITE\n");
+
+	ShaderBase::init();
+
+	GET_U(spriteMat);
+	GET_U(tone);
+	GET_U(color);
+	GET_U(opacity);
+	GET_U(waveActive);
+	GET_U(waveAmp);
+	GET_U(wavePhase);
+	GET_U(waveFreq);
+}
+
+void LiteSpriteShader::setSpriteMat(const float value[16])
+{
+	gl.UniformMatrix4fv(u_spriteMat, 1, GL_FALSE, value);
+}
+
+void LiteSpriteShader::setWave(bool active, float amp, float phase, float freq)
+{
+	gl.Uniform1i(u_waveActive, active);
+
+	if (!active)
+		return;
+
+	gl.Uniform1f(u_waveAmp, amp);
+	gl.Uniform1f(u_wavePhase, phase);
+	gl.Uniform1f(u_waveFreq, freq);
+}
+
+void LiteSpriteShader::setTone(const Vec4 &value)
+{
+	setVec4Uniform(u_tone, value);
+}
+
+void LiteSpriteShader::setColor(const Vec4 &value)
+{
+	setVec4Uniform(u_color, value);
+}
+
+void LiteSpriteShader::setOpacity(float value)
+{
+	gl.Uniform1f(u_opacity, value);
+}
+
 PlaneShader::PlaneShader()
 {
 	INIT_SHADER(simple, plane, PlaneShader);
@@ -627,6 +940,12 @@ PlaneShader::PlaneShader()
 	GET_U(color);
 	GET_U(flash);
 	GET_U(opacity);
+	GET_U(texOffset);
+}
+
+void PlaneShader::setTexOffset(const Vec2 &value)
+{
+	setVec2Uniform(u_texOffset, value);
 }
 
 void PlaneShader::setTone(const Vec4 &tone)
@@ -772,6 +1091,38 @@ BlurShader::VPass::VPass()
 	ShaderBase::init();
 }
 
+YUVShader::YUVShader()
+{
+	INIT_SHADER(simple, yuv, YUVShader);
+
+	ShaderBase::init();
+
+	GET_U(yPlane);
+	GET_U(uPlane);
+	GET_U(vPlane);
+}
+
+void YUVShader::setPlanes(TEX::ID y, TEX::ID u, TEX::ID v)
+{
+	setTexUniform(u_yPlane, 0, y);
+	setTexUniform(u_uPlane, 1, u);
+	setTexUniform(u_vPlane, 2, v);
+}
+
+BlurShader::HuePass::HuePass()
+{
+	INIT_SHADER(blurH, blurHue, BlurShader::HuePass);
+
+	ShaderBase::init();
+
+	GET_U(hueAdjust);
+}
+
+void BlurShader::HuePass::setHueAdjust(float value)
+{
+	gl.Uniform1f(u_hueAdjust, value);
+}
+
 
 TilemapVXShader::TilemapVXShader()
 {
@@ -869,3 +1220,66 @@ void XbrzShader::setTargetScale(const Vec2 &value)
 	gl.Uniform2f(u_targetScale, value.x, value.y);
 }
 #endif
+
+
+/* ---- Lazy shader construction ---- */
+
+struct ShaderSet::LazyShaders
+{
+	SDFGlyphShader *sdfGlyph = 0;
+	YUVShader *yuv = 0;
+	BicubicShader *bicubic = 0;
+	Lanczos3Shader *lanczos3 = 0;
+#ifdef MKXPZ_SSL
+	XbrzShader *xbrz = 0;
+#endif
+	Lanczos3SpriteShader *lanczos3Sprite = 0;
+	BicubicSpriteShader *bicubicSprite = 0;
+#ifdef MKXPZ_SSL
+	XbrzSpriteShader *xbrzSprite = 0;
+#endif
+};
+
+template<class S>
+static S &lazyGet(S *&slot)
+{
+	if (!slot)
+		slot = new S;
+
+	return *slot;
+}
+
+ShaderSet::ShaderSet()
+{
+	lz = new LazyShaders;
+}
+
+ShaderSet::~ShaderSet()
+{
+	delete lz->sdfGlyph;
+	delete lz->yuv;
+	delete lz->bicubic;
+	delete lz->lanczos3;
+#ifdef MKXPZ_SSL
+	delete lz->xbrz;
+#endif
+	delete lz->lanczos3Sprite;
+	delete lz->bicubicSprite;
+#ifdef MKXPZ_SSL
+	delete lz->xbrzSprite;
+#endif
+	delete lz;
+}
+
+SDFGlyphShader &ShaderSet::sdfGlyph() { return lazyGet(lz->sdfGlyph); }
+YUVShader &ShaderSet::yuv() { return lazyGet(lz->yuv); }
+BicubicShader &ShaderSet::bicubic() { return lazyGet(lz->bicubic); }
+Lanczos3Shader &ShaderSet::lanczos3() { return lazyGet(lz->lanczos3); }
+#ifdef MKXPZ_SSL
+XbrzShader &ShaderSet::xbrz() { return lazyGet(lz->xbrz); }
+#endif
+Lanczos3SpriteShader &ShaderSet::lanczos3Sprite() { return lazyGet(lz->lanczos3Sprite); }
+BicubicSpriteShader &ShaderSet::bicubicSprite() { return lazyGet(lz->bicubicSprite); }
+#ifdef MKXPZ_SSL
+XbrzSpriteShader &ShaderSet::xbrzSprite() { return lazyGet(lz->xbrzSprite); }
+#endif
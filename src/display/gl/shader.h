@@ -41,6 +41,11 @@ public:
     
     static std::string &commonHeader();
 
+	/* Directory the on-disk program binary cache lives in;
+	 * empty disables the cache. Must be set before the shader
+	 * set is constructed */
+	static void setBinaryCacheDir(const std::string &dir);
+
 protected:
 	Shader();
 	~Shader();
@@ -48,7 +53,8 @@ protected:
     void init(const unsigned char *vert, int vertSize,
               const unsigned char *frag, int fragSize,
 	          const char *vertName, const char *fragName,
-	          const char *programName);
+	          const char *programName,
+	          const char *defines = 0);
 	void initFromFile(const char *vertFile, const char *fragFile,
 	                  const char *programName);
 
@@ -60,6 +66,11 @@ protected:
 	GLuint program;
     
 private:
+	bool tryLoadBinary(const std::string &path);
+	void storeBinary(const std::string &path);
+
+	static std::string binaryCacheDir;
+
 #ifdef MKXPZ_BUILD_XCODE
     static std::string shaderCommon;
 #endif
@@ -89,6 +100,15 @@ public:
 	void setTexSize(const Vec2i &value);
 	void setTranslation(const Vec2i &value);
 
+private:
+	/* Uniform values are program state in GL; caching them per
+	 * shader object elides the redundant re-sends that happen
+	 * on every single draw */
+	Vec2i curTexSize;
+	Vec2i curTranslation;
+	bool texSizeValid = false;
+	bool translationValid = false;
+
 protected:
 	void init();
 	virtual bool framebufferScalingAllowed();
@@ -113,9 +133,10 @@ public:
 	SimpleShader();
 
 	void setTexOffsetX(int value);
+	void setTexOffset(const Vec2 &value);
 
 protected:
-	GLint u_texOffsetX;
+	GLint u_texOffsetX, u_texOffset;
 };
 
 class SimpleColorShader : public ShaderBase
@@ -130,15 +151,44 @@ public:
 	SimpleAlphaShader();
 };
 
+/* Draws atlas glyphs: coverage from the texture,
+ * text color from the vertex color */
+class GlyphShader : public ShaderBase
+{
+public:
+	GlyphShader();
+};
+
+/* Signed-distance-field text (Font#sdf); see sdfGlyph.frag */
+class SDFGlyphShader : public ShaderBase
+{
+public:
+	SDFGlyphShader();
+
+	void setSmoothing(float value);
+
+private:
+	GLint u_smoothing;
+};
+
+/* Batched sprite flash: flash color in the vertex color */
+class FlashTintShader : public ShaderBase
+{
+public:
+	FlashTintShader();
+};
+
 class SimpleSpriteShader : public ShaderBase
 {
 public:
 	SimpleSpriteShader();
 
 	void setSpriteMat(const float value[16]);
+	void setWave(bool active, float amp, float phase, float freq);
 
 protected:
 	GLint u_spriteMat;
+	GLint u_waveActive, u_waveAmp, u_wavePhase, u_waveFreq;
 };
 
 class AlphaSpriteShader : public ShaderBase
@@ -148,9 +198,11 @@ public:
 
 	void setSpriteMat(const float value[16]);
 	void setAlpha(float value);
+	void setWave(bool active, float amp, float phase, float freq);
 
 private:
 	GLint u_spriteMat, u_alpha;
+	GLint u_waveActive, u_waveAmp, u_wavePhase, u_waveFreq;
 };
 
 class TransShader : public ShaderBase
@@ -200,10 +252,31 @@ public:
     void setPatternScroll(const Vec2 &scroll);
     void setPatternZoom(const Vec2 &zoom);
     void setInvert(bool value);
+	void setWave(bool active, float amp, float phase, float freq);
 
 private:
 	GLint u_spriteMat, u_tone, u_opacity, u_color, u_bushDepth, u_bushOpacity, u_pattern, u_renderPattern,
     u_patternBlendType, u_patternSizeInv, u_patternTile, u_patternOpacity, u_patternScroll, u_patternZoom, u_invert;
+	GLint u_waveActive, u_waveAmp, u_wavePhase, u_waveFreq;
+};
+
+/* sprite.frag compiled with SPRITE_LITE: the pattern, invert
+ * and bush paths are stripped at compile time; for the common
+ * tone/color/opacity-only effect sprites */
+class LiteSpriteShader : public ShaderBase
+{
+public:
+	LiteSpriteShader();
+
+	void setSpriteMat(const float value[16]);
+	void setWave(bool active, float amp, float phase, float freq);
+	void setTone(const Vec4 &value);
+	void setColor(const Vec4 &value);
+	void setOpacity(float value);
+
+private:
+	GLint u_spriteMat, u_tone, u_color, u_opacity;
+	GLint u_waveActive, u_waveAmp, u_wavePhase, u_waveFreq;
 };
 
 class PlaneShader : public ShaderBase
@@ -215,9 +288,10 @@ public:
 	void setColor(const Vec4 &value);
 	void setFlash(const Vec4 &value);
 	void setOpacity(float value);
+	void setTexOffset(const Vec2 &value);
 
 private:
-	GLint u_tone, u_color, u_flash, u_opacity;
+	GLint u_tone, u_color, u_flash, u_opacity, u_texOffset;
 };
 
 class GrayShader : public ShaderBase
@@ -284,6 +358,18 @@ private:
 	GLint u_matrix;
 };
 
+/* Planar YCbCr to RGB conversion (movie playback) */
+class YUVShader : public ShaderBase
+{
+public:
+	YUVShader();
+
+	void setPlanes(TEX::ID y, TEX::ID u, TEX::ID v);
+
+private:
+	GLint u_yPlane, u_uPlane, u_vPlane;
+};
+
 /* Gaussian blur */
 struct BlurShader
 {
@@ -299,8 +385,23 @@ struct BlurShader
 		VPass();
 	};
 
+	/* Horizontal pass with a fused hue rotation, so a
+	 * hueChange directly followed by a blur costs no
+	 * extra fullscreen pass */
+	class HuePass : public ShaderBase
+	{
+	public:
+		HuePass();
+
+		void setHueAdjust(float value);
+
+	private:
+		GLint u_hueAdjust;
+	};
+
 	HPass pass1;
 	VPass pass2;
+	HuePass huePass;
 };
 
 class TilemapVXShader : public ShaderBase
@@ -408,6 +509,7 @@ struct ShaderSet
 	SimpleSpriteShader simpleSprite;
 	AlphaSpriteShader alphaSprite;
 	SpriteShader sprite;
+	LiteSpriteShader liteSprite;
 	PlaneShader plane;
 	GrayShader gray;
 	TilemapShader tilemap;
@@ -416,19 +518,34 @@ struct ShaderSet
 	SimpleTransShader simpleTrans;
 	HueShader hue;
 	BltShader blt;
+	GlyphShader glyph;
+	FlashTintShader flashTint;
 	SimpleMatrixShader simpleMatrix;
 	BlurShader blur;
 	TilemapVXShader tilemapVX;
-	BicubicShader bicubic;
-	Lanczos3Shader lanczos3;
+
+	/* Rarely used programs (movie/YUV, SDF text, the smooth-scale
+	 * filters - the big ones to compile) build on first use instead
+	 * of on the boot path */
+	SDFGlyphShader &sdfGlyph();
+	YUVShader &yuv();
+	BicubicShader &bicubic();
+	Lanczos3Shader &lanczos3();
 #ifdef MKXPZ_SSL
-	XbrzShader xbrz;
+	XbrzShader &xbrz();
 #endif
-	Lanczos3SpriteShader lanczos3Sprite;
-	BicubicSpriteShader bicubicSprite;
+	Lanczos3SpriteShader &lanczos3Sprite();
+	BicubicSpriteShader &bicubicSprite();
 #ifdef MKXPZ_SSL
-	XbrzSpriteShader xbrzSprite;
+	XbrzSpriteShader &xbrzSprite();
 #endif
+
+	ShaderSet();
+	~ShaderSet();
+
+private:
+	struct LazyShaders;
+	LazyShaders *lz;
 };
 
 #endif // SHADER_H
@@ -71,11 +71,19 @@ struct TexPoolPrivate
 	/* Has this pool been disabled? */
 	bool disabled;
 
+	/* Cache effectiveness counters */
+	uint64_t hits;
+	uint64_t misses;
+	uint64_t evictions;
+
 	TexPoolPrivate(uint32_t maxMemSize)
 	    : maxMemSize(maxMemSize),
 	      memSize(0),
 	      objCount(0),
-	      disabled(false)
+	      disabled(false),
+	      hits(0),
+	      misses(0),
+	      evictions(0)
 	{}
 };
 
@@ -120,12 +128,15 @@ TEXFBO TexPool::request(int width, int height)
 
 		p->memSize -= byteCount(size);
 		--p->objCount;
+		++p->hits;
 
 //		Debug() << "TexPool: <?+> (" << width << height << ")";
 
 		return cnode.obj;
 	}
 
+	++p->misses;
+
 	int maxSize = glState.caps.maxTexSize;
 	if (width > maxSize || height > maxSize)
 		throw Exception(Exception::MKXPError,
@@ -142,6 +153,50 @@ TEXFBO TexPool::request(int width, int height)
 	return cnode.obj;
 }
 
+void TexPool::purge()
+{
+	std::list<TEXFBO>::iterator iter;
+
+	for (iter = p->priorityQueue.begin();
+	     iter != p->priorityQueue.end();
+	     ++iter)
+	{
+		TEXFBO obj = *iter;
+		TEXFBO::fini(obj);
+		--p->objCount;
+		++p->evictions;
+	}
+
+	p->priorityQueue.clear();
+	p->poolHash.clear();
+	p->memSize = 0;
+}
+
+void TexPool::shrink(uint32_t targetBytes)
+{
+	while (p->memSize > targetBytes && p->objCount > 0)
+	{
+		CacheNode last;
+		last.obj = p->priorityQueue.back();
+		Size removedSize(last.obj.width, last.obj.height);
+
+		CNodeList &bucket = p->poolHash[removedSize];
+
+		std::list<CacheNode>::iterator toRemove =
+		        std::find(bucket.begin(), bucket.end(), last);
+		assert(toRemove != bucket.end());
+		bucket.erase(toRemove);
+
+		p->priorityQueue.pop_back();
+
+		TEXFBO::fini(last.obj);
+
+		p->memSize -= byteCount(removedSize);
+		--p->objCount;
+		++p->evictions;
+	}
+}
+
 void TexPool::release(TEXFBO &obj)
 {
 	if (obj.tex == TEX::ID(0) || obj.fbo == FBO::ID(0))
@@ -189,6 +244,7 @@ void TexPool::release(TEXFBO &obj)
 
 		newMemSize -= byteCount(removedSize);
 		--p->objCount;
+		++p->evictions;
 
 //		Debug() << "TexPool: <!-> (" << last.obj.width << last.obj.height << ")";
 	}
@@ -213,4 +269,16 @@ void TexPool::disable()
 	p->disabled = true;
 }
 
+TexPool::Stats TexPool::stats() const
+{
+	Stats s;
+	s.hits = p->hits;
+	s.misses = p->misses;
+	s.evictions = p->evictions;
+	s.cachedBytes = p->memSize;
+	s.budgetBytes = p->maxMemSize;
+
+	return s;
+}
+
 
@@ -24,19 +24,41 @@
 
 #include "gl-util.h"
 
+#include <stdint.h>
+
 struct TexPoolPrivate;
 
 class TexPool
 {
 public:
+	struct Stats
+	{
+		uint64_t hits;
+		uint64_t misses;
+		uint64_t evictions;
+		uint32_t cachedBytes;
+		uint32_t budgetBytes;
+	};
+
 	TexPool(uint32_t maxMemSize = 20000000 /* 20 MB */);
 	~TexPool();
 
 	TEXFBO request(int width, int height);
 	void release(TEXFBO &obj);
 
+	/* Frees every cached object (eg. when throttled into
+	 * the background); in-use objects are unaffected since
+	 * the pool only ever holds idle ones */
+	void purge();
+
+	/* Evict lowest-priority entries until the cached size is at
+	 * most 'targetBytes' (memory pressure; see MemoryBudget) */
+	void shrink(uint32_t targetBytes);
+
 	void disable();
 
+	Stats stats() const;
+
 private:
 	TexPoolPrivate *p;
 };
@@ -0,0 +1,67 @@
+/*
+** vramstats.cpp
+**
+** This file is part of mkxp.
+**
+** Copyright (C) 2013 - 2021 Amaryllis Kulla <ancurio@mapleshrine.eu>
+**
+** mkxp is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 2 of the License, or
+** (at your option) any later version.
+**
+** mkxp is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with mkxp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "vramstats.h"
+
+#include <map>
+
+/* All GL work happens on the render thread (under the GFX lock),
+ * so plain containers suffice */
+
+namespace VramStats
+{
+
+static std::map<uint32_t, size_t> sizes;
+static size_t total = 0;
+
+void onAlloc(uint32_t texId, size_t bytes)
+{
+	if (texId == 0)
+		return;
+
+	size_t &slot = sizes[texId];
+	total -= slot;
+	slot = bytes;
+	total += bytes;
+}
+
+void onFree(uint32_t texId)
+{
+	std::map<uint32_t, size_t>::iterator it = sizes.find(texId);
+
+	if (it == sizes.end())
+		return;
+
+	total -= it->second;
+	sizes.erase(it);
+}
+
+size_t totalBytes()
+{
+	return total;
+}
+
+unsigned textureCount()
+{
+	return (unsigned) sizes.size();
+}
+
+}
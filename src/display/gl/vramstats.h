@@ -0,0 +1,46 @@
+/*
+** vramstats.h
+**
+** This file is part of mkxp.
+**
+** Copyright (C) 2013 - 2021 Amaryllis Kulla <ancurio@mapleshrine.eu>
+**
+** mkxp is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 2 of the License, or
+** (at your option) any later version.
+**
+** mkxp is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with mkxp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef VRAMSTATS_H
+#define VRAMSTATS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* GPU texture allocation accounting (Graphics.vram_stats): every
+ * sized texture allocation registers its bytes against its GL id,
+ * deletes subtract, so total VRAM footprint and texture count are
+ * always known. Per-category numbers come from the owners that
+ * already track themselves (texture pool, glyph atlases); the
+ * remainder is bitmap/framebuffer storage */
+namespace VramStats
+{
+
+/* Re-allocating a live id replaces its old size */
+void onAlloc(uint32_t texId, size_t bytes);
+void onFree(uint32_t texId);
+
+size_t totalBytes();
+unsigned textureCount();
+
+}
+
+#endif // VRAMSTATS_H
@@ -0,0 +1,440 @@
+/*
+** glyphatlas.cpp
+**
+** This file is part of mkxp.
+**
+** Copyright (C) 2013 - 2021 Amaryllis Kulla <ancurio@mapleshrine.eu>
+**
+** mkxp is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 2 of the License, or
+** (at your option) any later version.
+**
+** mkxp is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with mkxp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "glyphatlas.h"
+
+#include <SDL_ttf.h>
+#include <SDL_surface.h>
+#include <SDL_pixels.h>
+
+#include "gl-fun.h"
+#include "gl-meta.h"
+#include "glstate.h"
+#include "config.h"
+#include "font.h"
+#include "sharedstate.h"
+#include "textshaper.h"
+
+#include <algorithm>
+
+/* Gap between packed glyphs so neighbouring entries can
+ * never bleed into each other */
+#define GLYPH_PAD 1
+
+/* Layout cache bounds: lines longer than this aren't cached, and
+ * the whole cache resets when it fills (glyphs themselves stay) */
+#define LAYOUT_MAX_STRLEN 256
+#define LAYOUT_MAX_ENTRIES 2048
+
+GlyphAtlas::GlyphAtlas()
+{
+	pgSize = std::min(1024, glState.caps.maxTexSize);
+	curPage = 0;
+	frameStamp = 1;
+	evictions = 0;
+
+	/* RGBA pages; the MB budget translates into whole pages */
+	int budgetMB = shState->config().glyphAtlasBudget;
+	if (budgetMB < 1)
+		budgetMB = 1;
+
+	const size_t pageBytes = (size_t) pgSize * pgSize * 4;
+	maxPages = (int) (((size_t) budgetMB * 1024 * 1024) / pageBytes);
+	if (maxPages < 1)
+		maxPages = 1;
+}
+
+void GlyphAtlas::nextFrame()
+{
+	frameStamp++;
+}
+
+GlyphAtlas::Stats GlyphAtlas::stats() const
+{
+	Stats st;
+	st.pages = (int) pages.size();
+	st.bytes = pages.size() * (size_t) pgSize * pgSize * 4;
+	st.glyphs = (unsigned) glyphs.size();
+	st.evictions = evictions;
+	return st;
+}
+
+void GlyphAtlas::recyclePage(int idx)
+{
+	/* Forget every glyph on the page, and every cached layout
+	 * (any of them might reference an erased entry) */
+	BoostHash<Key, Glyph>::const_iterator it = glyphs.cbegin();
+	while (it != glyphs.cend())
+	{
+		if (it->second.page == idx)
+			it = glyphs.erase(it);
+		else
+			++it;
+	}
+
+	layouts.clear();
+
+	Page &pg = pages[idx];
+	pg.shelfX = 0;
+	pg.shelfY = 0;
+	pg.shelfH = 0;
+	pg.lastUse = frameStamp;
+
+	evictions++;
+}
+
+int GlyphAtlas::packTargetPage(int needW, int needH)
+{
+	if (pages.empty())
+	{
+		allocPage();
+		curPage = 0;
+	}
+
+	Page *pg = &pages[curPage];
+
+	if (pg->shelfX + needW + GLYPH_PAD > pgSize)
+	{
+		pg->shelfY += pg->shelfH;
+		pg->shelfX = 0;
+		pg->shelfH = 0;
+	}
+
+	if (pg->shelfY + needH + GLYPH_PAD <= pgSize)
+		return curPage;
+
+	/* Page full: grow while the budget allows */
+	if ((int) pages.size() < maxPages)
+	{
+		allocPage();
+		curPage = (int) pages.size() - 1;
+		return curPage;
+	}
+
+	/* Recycle the least-recently-used page not touched this frame;
+	 * if every page is hot, grow past the budget rather than pull
+	 * texels out from under an in-flight run */
+	int lru = -1;
+	for (int i = 0; i < (int) pages.size(); ++i)
+	{
+		if (pages[i].lastUse == frameStamp)
+			continue;
+		if (lru < 0 || pages[i].lastUse < pages[lru].lastUse)
+			lru = i;
+	}
+
+	if (lru < 0)
+	{
+		allocPage();
+		curPage = (int) pages.size() - 1;
+		return curPage;
+	}
+
+	recyclePage(lru);
+	curPage = lru;
+	return curPage;
+}
+
+GlyphAtlas::~GlyphAtlas()
+{
+	for (size_t i = 0; i < pages.size(); ++i)
+		TEX::del(pages[i].tex);
+}
+
+TEX::ID GlyphAtlas::pageTex(int page) const
+{
+	return pages[page].tex;
+}
+
+int GlyphAtlas::pageSize() const
+{
+	return pgSize;
+}
+
+GlyphAtlas::Page &GlyphAtlas::allocPage()
+{
+	Page pg;
+	pg.tex = TEX::gen();
+	pg.shelfX = 0;
+	pg.shelfY = 0;
+	pg.shelfH = 0;
+	pg.lastUse = frameStamp;
+
+	TEX::bind(pg.tex);
+	TEX::allocEmpty(pgSize, pgSize);
+	TEX::setRepeat(false);
+	TEX::setSmooth(false);
+
+	pages.push_back(pg);
+
+	return pages.back();
+}
+
+const GlyphAtlas::Glyph *GlyphAtlas::request(TTF_Font *font, uint8_t style, uint16_t cp,
+                                             uint8_t outline)
+{
+	Key key = { font, cp, style, outline };
+
+	if (const Glyph *hit = glyphs.valuePtr(key))
+	{
+		pages[hit->page].lastUse = frameStamp;
+		return hit;
+	}
+
+	int minX, maxX, minY, maxY, advance;
+	if (TTF_GlyphMetrics(font, cp, &minX, &maxX, &minY, &maxY, &advance) != 0)
+		return 0;
+
+	/* Coverage-only rasterization; tinting happens per-quad */
+	SDL_Color white = { 255, 255, 255, 255 };
+
+	if (outline > 0)
+		TTF_SetFontOutline(font, outline);
+
+	SDL_Surface *surf = TTF_RenderGlyph_Blended(font, cp, white);
+
+	if (outline > 0)
+		TTF_SetFontOutline(font, 0);
+
+	if (!surf)
+		return 0;
+
+	if (surf->format->format != SDL_PIXELFORMAT_ABGR8888)
+	{
+		SDL_Surface *conv = SDL_ConvertSurfaceFormat(surf, SDL_PIXELFORMAT_ABGR8888, 0);
+		SDL_FreeSurface(surf);
+
+		if (!conv)
+			return 0;
+
+		surf = conv;
+	}
+
+	if (surf->w > pgSize || surf->h > pgSize)
+	{
+		SDL_FreeSurface(surf);
+		return 0;
+	}
+
+	/* Shelf packing into the current page, growing or recycling
+	 * within the budget as needed */
+	const int pageIdx = packTargetPage(surf->w, surf->h);
+	Page *pg = &pages[pageIdx];
+	pg->lastUse = frameStamp;
+
+	Glyph g;
+	g.page = pageIdx;
+	g.rect = IntRect(pg->shelfX, pg->shelfY, surf->w, surf->h);
+	g.minX = minX;
+	g.advance = advance;
+
+	TEX::bind(pg->tex);
+	GLMeta::subRectImageUpload(surf->pitch / 4, 0, 0, g.rect.x, g.rect.y,
+	                           surf->w, surf->h, surf, GL_RGBA);
+	GLMeta::subRectImageEnd();
+
+	pg->shelfX += surf->w + GLYPH_PAD;
+	pg->shelfH = std::max(pg->shelfH, surf->h + GLYPH_PAD);
+
+	SDL_FreeSurface(surf);
+
+	glyphs.insert(key, g);
+
+	return &glyphs[key];
+}
+
+int GlyphAtlas::advanceOf(TTF_Font *font, uint8_t style, uint16_t cp)
+{
+	Key key = { font, cp, style, 0 };
+
+	/* Rendered entries already know */
+	if (glyphs.contains(key))
+		return glyphs[key].advance;
+
+	if (const int *cached = advances.valuePtr(key))
+		return *cached;
+
+	int minX, maxX, minY, maxY, advance;
+	if (TTF_GlyphMetrics(font, cp, &minX, &maxX, &minY, &maxY, &advance) != 0)
+		return -1;
+
+	advances.insert(key, advance);
+
+	return advance;
+}
+
+const GlyphAtlas::LineLayout *GlyphAtlas::findLayout(TTF_Font *font,
+                                                     uint8_t style,
+                                                     uint8_t outline,
+                                                     const char *str)
+{
+	LayoutRef ref;
+	ref.font = font;
+	ref.style = style;
+	ref.outline = outline;
+	ref.str = str;
+
+	const LineLayout *layout = layouts.valuePtr(ref);
+
+	/* A cached line in steady use never calls request(), so keep
+	 * its pages warm here or the LRU would recycle them */
+	if (layout)
+	{
+		for (size_t i = 0; i < layout->run.size(); ++i)
+			pages[layout->run[i]->page].lastUse = frameStamp;
+		for (size_t i = 0; i < layout->runOutline.size(); ++i)
+			pages[layout->runOutline[i]->page].lastUse = frameStamp;
+	}
+
+	return layout;
+}
+
+void GlyphAtlas::storeLayout(TTF_Font *font, uint8_t style,
+                             uint8_t outline, const char *str,
+                             const LineLayout &layout)
+{
+	LayoutKey key;
+	key.font = font;
+	key.style = style;
+	key.outline = outline;
+	key.str = str;
+
+	if (key.str.size() > LAYOUT_MAX_STRLEN)
+		return;
+
+	/* Crude but sufficient: a full cache just starts over. The
+	 * glyphs it pointed at live on in the atlas, so refilling is
+	 * lookup work only */
+	if (layouts.size() >= LAYOUT_MAX_ENTRIES)
+		layouts.clear();
+
+	layouts.insert(key, layout);
+}
+
+
+/* ---- ShapedAtlas ---- */
+
+ShapedAtlas::ShapedAtlas()
+{
+	pgSize = std::min(1024, glState.caps.maxTexSize);
+}
+
+ShapedAtlas::~ShapedAtlas()
+{
+	for (size_t i = 0; i < pages.size(); ++i)
+		TEX::del(pages[i].tex);
+}
+
+TEX::ID ShapedAtlas::pageTex(int page) const
+{
+	return pages[page].tex;
+}
+
+int ShapedAtlas::pageSize() const
+{
+	return pgSize;
+}
+
+ShapedAtlas::Page &ShapedAtlas::allocPage()
+{
+	Page pg;
+	pg.tex = TEX::gen();
+	pg.shelfX = 0;
+	pg.shelfY = 0;
+	pg.shelfH = 0;
+
+	TEX::bind(pg.tex);
+	gl.TexImage2D(GL_TEXTURE_2D, 0, GL_ALPHA, pgSize, pgSize, 0,
+	              GL_ALPHA, GL_UNSIGNED_BYTE, 0);
+	VramStats::onAlloc(pg.tex.gl, (size_t) pgSize * pgSize);
+	TEX::setRepeat(false);
+	TEX::setSmooth(false);
+
+	pages.push_back(pg);
+
+	return pages.back();
+}
+
+const ShapedAtlas::Glyph *ShapedAtlas::request(const std::string &family,
+                                               int sizePx, uint32_t glyphId)
+{
+	Key key;
+	key.size = sizePx;
+	key.glyphId = glyphId;
+	key.family = family;
+
+	if (glyphs.contains(key))
+		return &glyphs[key];
+
+	TextShaper::GlyphBitmap bm;
+	if (!shState->fontState().textShaper().rasterize(family, sizePx,
+	                                                 glyphId, bm))
+		return 0;
+
+	if (bm.w + GLYPH_PAD > pgSize || bm.h + GLYPH_PAD > pgSize)
+		return 0;
+
+	Glyph g;
+	g.left = bm.left;
+	g.top = bm.top;
+
+	if (bm.w == 0 || bm.h == 0)
+	{
+		/* Whitespace: a real entry, nothing to pack */
+		g.page = 0;
+		g.rect = IntRect(0, 0, 0, 0);
+		if (pages.empty())
+			allocPage();
+	}
+	else
+	{
+		if (pages.empty())
+			allocPage();
+
+		Page *pg = &pages.back();
+
+		if (pg->shelfX + bm.w + GLYPH_PAD > pgSize)
+		{
+			pg->shelfY += pg->shelfH;
+			pg->shelfX = 0;
+			pg->shelfH = 0;
+		}
+
+		if (pg->shelfY + bm.h + GLYPH_PAD > pgSize)
+			pg = &allocPage();
+
+		g.page = (int) pages.size() - 1;
+		g.rect = IntRect(pg->shelfX, pg->shelfY, bm.w, bm.h);
+
+		TEX::bind(pg->tex);
+		gl.PixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		gl.TexSubImage2D(GL_TEXTURE_2D, 0, g.rect.x, g.rect.y, bm.w, bm.h,
+		                 GL_ALPHA, GL_UNSIGNED_BYTE, bm.pixels.data());
+		gl.PixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+		pg->shelfX += bm.w + GLYPH_PAD;
+		pg->shelfH = std::max(pg->shelfH, bm.h + GLYPH_PAD);
+	}
+
+	glyphs.insert(key, g);
+
+	return &glyphs[key];
+}
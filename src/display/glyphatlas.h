@@ -0,0 +1,253 @@
+/*
+** glyphatlas.h
+**
+** This file is part of mkxp.
+**
+** Copyright (C) 2013 - 2021 Amaryllis Kulla <ancurio@mapleshrine.eu>
+**
+** mkxp is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 2 of the License, or
+** (at your option) any later version.
+**
+** mkxp is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with mkxp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef GLYPHATLAS_H
+#define GLYPHATLAS_H
+
+#include "etc-internal.h"
+#include "gl-util.h"
+#include "boost-hash.h"
+
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+typedef struct _TTF_Font TTF_Font;
+
+/* Shared cache of rasterized glyphs. Each glyph is rendered once
+ * per font/size/style, packed into shelf-allocated texture pages
+ * and afterwards drawn as a textured quad, so repeated drawText
+ * calls stop paying for string rasterization and texture upload.
+ * Pages are capped by the glyphAtlasBudget config: past it, the
+ * least-recently-used page (never one touched this frame) gets
+ * recycled, so thousands of distinct kanji stay inside a
+ * predictable VRAM envelope instead of growing without bound */
+class GlyphAtlas
+{
+public:
+	GlyphAtlas();
+	~GlyphAtlas();
+
+	struct Glyph
+	{
+		int page;       /* atlas page index */
+		IntRect rect;   /* pixel rect inside the page */
+		int minX;       /* horizontal bearing */
+		int advance;
+	};
+
+	/* Returns 0 if the glyph cannot be rasterized, in which
+	 * case the caller falls back to whole-string rendering.
+	 * 'outline' > 0 caches the stroked variant (TTF_SetFontOutline)
+	 * of that thickness, so outlined text needs no second
+	 * rasterization after the first sighting either */
+	const Glyph *request(TTF_Font *font, uint8_t style, uint16_t cp,
+	                     uint8_t outline = 0);
+
+	/* Shaped-line layout cache: once a line rendered, redrawing it
+	 * skips UTF-8 iteration, per-glyph lookups and TTF metrics and
+	 * goes straight to quad emission. Glyph pointers stay valid for
+	 * the atlas' lifetime (entries are never evicted) */
+	struct LineLayout
+	{
+		std::vector<const Glyph*> run;
+		/* Stroked variants when the line is outlined (same cps) */
+		std::vector<const Glyph*> runOutline;
+		int sizeW, sizeH;
+	};
+
+	/* Cached advance of a single glyph, for measurement-only
+	 * callers (no rasterization or upload); -1 when the glyph
+	 * has no metrics */
+	int advanceOf(TTF_Font *font, uint8_t style, uint16_t cp);
+
+	const LineLayout *findLayout(TTF_Font *font, uint8_t style,
+	                             uint8_t outline, const char *str);
+	void storeLayout(TTF_Font *font, uint8_t style, uint8_t outline,
+	                 const char *str, const LineLayout &layout);
+
+	TEX::ID pageTex(int page) const;
+	int pageSize() const;
+
+	/* Advance the LRU clock; called once per rendered frame */
+	void nextFrame();
+
+	struct Stats
+	{
+		int pages;
+		size_t bytes;
+		unsigned glyphs;
+		unsigned evictions;
+	};
+
+	Stats stats() const;
+
+private:
+	struct Key
+	{
+		TTF_Font *font;
+		uint16_t cp;
+		uint8_t style;
+		uint8_t outline;
+
+		bool operator<(const Key &o) const
+		{
+			if (font != o.font)
+				return font < o.font;
+			if (cp != o.cp)
+				return cp < o.cp;
+			if (style != o.style)
+				return style < o.style;
+			return outline < o.outline;
+		}
+	};
+
+	struct Page
+	{
+		TEX::ID tex;
+		int shelfX, shelfY, shelfH;
+		uint32_t lastUse;
+	};
+
+	struct LayoutKey
+	{
+		TTF_Font *font;
+		uint8_t style;
+		uint8_t outline;
+		std::string str;
+
+		bool operator<(const LayoutKey &o) const
+		{
+			if (font != o.font)
+				return font < o.font;
+			if (style != o.style)
+				return style < o.style;
+			if (outline != o.outline)
+				return outline < o.outline;
+			return str < o.str;
+		}
+	};
+
+	/* Heterogeneous probe: lookups compare against the raw C
+	 * string, so a cache hit never allocates */
+	struct LayoutRef
+	{
+		TTF_Font *font;
+		uint8_t style;
+		uint8_t outline;
+		const char *str;
+	};
+
+	friend bool operator<(const LayoutKey &a, const LayoutRef &b)
+	{
+		if (a.font != b.font)
+			return a.font < b.font;
+		if (a.style != b.style)
+			return a.style < b.style;
+		if (a.outline != b.outline)
+			return a.outline < b.outline;
+		return strcmp(a.str.c_str(), b.str) < 0;
+	}
+
+	friend bool operator<(const LayoutRef &a, const LayoutKey &b)
+	{
+		if (a.font != b.font)
+			return a.font < b.font;
+		if (a.style != b.style)
+			return a.style < b.style;
+		if (a.outline != b.outline)
+			return a.outline < b.outline;
+		return strcmp(a.str, b.str.c_str()) < 0;
+	}
+
+	Page &allocPage();
+
+	/* A page to pack into: the current one, a fresh one while the
+	 * budget allows, or the recycled LRU page */
+	int packTargetPage(int needW, int needH);
+	void recyclePage(int idx);
+
+	BoostHash<Key, Glyph> glyphs;
+	BoostHash<Key, int> advances;
+	BoostHash<LayoutKey, LineLayout> layouts;
+	std::vector<Page> pages;
+	int pgSize;
+	int curPage;
+	int maxPages;
+	uint32_t frameStamp;
+	unsigned evictions;
+};
+
+/* Atlas of shaped glyphs keyed by (family, size, glyph id), filled
+ * from TextShaper::rasterize (Font#shaped); alpha-channel pages,
+ * same shelf scheme as the coverage atlas */
+class ShapedAtlas
+{
+public:
+	ShapedAtlas();
+	~ShapedAtlas();
+
+	struct Glyph
+	{
+		int page;
+		IntRect rect;
+		int left, top;  /* FT bearing (top counts upwards) */
+	};
+
+	/* 0 when the glyph can't be rasterized */
+	const Glyph *request(const std::string &family, int sizePx,
+	                     uint32_t glyphId);
+
+	TEX::ID pageTex(int page) const;
+	int pageSize() const;
+
+private:
+	struct Key
+	{
+		int size;
+		uint32_t glyphId;
+		std::string family;
+
+		bool operator<(const Key &o) const
+		{
+			if (size != o.size)
+				return size < o.size;
+			if (glyphId != o.glyphId)
+				return glyphId < o.glyphId;
+			return family < o.family;
+		}
+	};
+
+	struct Page
+	{
+		TEX::ID tex;
+		int shelfX, shelfY, shelfH;
+	};
+
+	Page &allocPage();
+
+	BoostHash<Key, Glyph> glyphs;
+	std::vector<Page> pages;
+	int pgSize;
+};
+
+#endif // GLYPHATLAS_H
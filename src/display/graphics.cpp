@@ -32,7 +32,12 @@
 #include "etc-internal.h"
 #include "eventthread.h"
 #include "filesystem.h"
+#include "font.h"
+#include "arena.h"
+#include "zonetrace.h"
+#include "glyphatlas.h"
 #include "gl-fun.h"
+#include "gl-debug.h"
 #include "gl-util.h"
 #include "glstate.h"
 #include "intrulist.h"
@@ -42,6 +47,7 @@
 #include "sharedstate.h"
 #include "texpool.h"
 #include "theoraplay/theoraplay.h"
+#include "audioconvert.h"
 #include "util.h"
 #include "input.h"
 #include "sprite.h"
@@ -49,6 +55,7 @@
 #include <SDL.h>
 #include <SDL_image.h>
 #include <SDL_timer.h>
+#include <SDL_ttf.h>
 #include <SDL_video.h>
 #include <SDL_mutex.h>
 #include <SDL_thread.h>
@@ -59,6 +66,8 @@
 
 #include <algorithm>
 #include <errno.h>
+#include <stdio.h>
+#include <string.h>
 #include <sys/time.h>
 #include <unistd.h>
 #include <time.h>
@@ -91,6 +100,12 @@ static long readMovie(THEORAPLAY_Io *io, void *buf, long buflen)
 } // IoFopenRead
 
 
+static int seekMovie(THEORAPLAY_Io *io, long offset)
+{
+    SDL_RWops *f = (SDL_RWops *) io->userdata;
+    return (SDL_RWseek(f, offset, RW_SEEK_SET) < 0) ? -1 : 0;
+} // seekMovie
+
 static void closeMovie(THEORAPLAY_Io *io)
 {
     SDL_RWops *f = (SDL_RWops *) io->userdata;
@@ -98,6 +113,328 @@ static void closeMovie(THEORAPLAY_Io *io)
     free(io);
 } // IoFopenClose
 
+/* Movie keyframe index cache: the index theoraplay builds while
+ * demuxing is persisted under customDataPath (games usually live in
+ * read-only archives), keyed by a hash of the movie path, and fed
+ * back on the next open so chapter jumps are fast before the file
+ * ever played through once */
+static std::string movieIndexCachePath(const char *filename)
+{
+    const std::string &base = shState->config().customDataPath;
+
+    if (base.empty())
+        return std::string();
+
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (const char *p = filename; *p; ++p) {
+        hash ^= (uint8_t) *p;
+        hash *= 0x100000001b3ull;
+    }
+
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx", (unsigned long long) hash);
+
+    return base + "/movie-" + name + ".idx";
+}
+
+
+/* ---- Movie subtitles ----
+ * A timed-text sidecar next to the movie ("<path>.srt", SubRip
+ * format) is parsed up front; the active cue is drawn straight onto
+ * the video bitmap after each frame upload, riding the glyph-atlas
+ * text path and the existing present - no extra bitmaps or passes */
+struct SubtitleCue
+{
+    unsigned int startMs, endMs;
+    std::string text;
+};
+
+static bool subtitleCueOrder(const SubtitleCue &a, const SubtitleCue &b)
+{
+    return a.startMs < b.startMs;
+}
+
+static void parseSrtCues(const std::string &data, std::vector<SubtitleCue> &out)
+{
+    SubtitleCue cue = SubtitleCue();
+    bool inCue = false;
+    size_t pos = 0;
+
+    while (pos <= data.size())
+    {
+        size_t eol = data.find('\n', pos);
+        size_t end = (eol == std::string::npos) ? data.size() : eol;
+        std::string line = data.substr(pos, end - pos);
+        pos = end + 1;
+
+        if (!line.empty() && line[line.size() - 1] == '\r')
+            line.resize(line.size() - 1);
+
+        if (!inCue)
+        {
+            int h1, m1, s1, ms1, h2, m2, s2, ms2;
+            if (sscanf(line.c_str(),
+                       "%d:%d:%d%*1[,.]%d --> %d:%d:%d%*1[,.]%d",
+                       &h1, &m1, &s1, &ms1, &h2, &m2, &s2, &ms2) == 8)
+            {
+                cue.startMs = (((unsigned) h1 * 60 + m1) * 60 + s1) * 1000 + ms1;
+                cue.endMs = (((unsigned) h2 * 60 + m2) * 60 + s2) * 1000 + ms2;
+                cue.text.clear();
+                inCue = true;
+            }
+        }
+        else if (line.empty())
+        {
+            if (!cue.text.empty() && cue.endMs > cue.startMs)
+                out.push_back(cue);
+            inCue = false;
+        }
+        else
+        {
+            if (!cue.text.empty())
+                cue.text += '\n';
+            cue.text += line;
+        }
+    }
+
+    if (inCue && !cue.text.empty() && cue.endMs > cue.startMs)
+        out.push_back(cue);
+
+    std::stable_sort(out.begin(), out.end(), subtitleCueOrder);
+}
+
+/* ---- Flight recorder ----
+ *
+ * A crash-safe ring file of compact perf records (flightRecorder
+ * config): every few seconds one fixed-size slot is written and
+ * flushed, then the header's cursor advances - a crash loses at
+ * most the slot being written, and its per-record magic + sequence
+ * let readers skip a torn one. The file holds the last hour at the
+ * default cadence. */
+
+#define FREC_MAGIC      0x43455246u  /* 'FREC' */
+#define FREC_HDR_MAGIC  "MKXPFREC"
+#define FREC_VERSION    1u
+#define FREC_SLOTS      720u
+#define FREC_SLOT_SIZE  128u
+#define FREC_PERIOD_MS  5000
+
+struct FlightRecord
+{
+    uint32_t magic;
+    uint32_t seq;
+    uint64_t wallSec;
+
+    float avgFrameMs;
+    float maxFrameMs;
+    uint32_t frames;
+
+    /* Frame time histogram: <=8.4, 16.8, 20, 25, 33.4, 50, 100, inf */
+    uint32_t histo[8];
+
+    uint32_t texPoolBytes;
+    uint64_t texPoolEvict;
+    uint32_t seBytes;
+    uint32_t prefetchBytes;
+    uint32_t glyphPages;
+    uint32_t glyphEvict;
+
+    uint64_t batchDraws;
+    uint64_t batchQuads;
+
+    uint8_t pad[FREC_SLOT_SIZE - 104];
+};
+
+static_assert(sizeof(FlightRecord) == FREC_SLOT_SIZE,
+              "flight record must fill its slot exactly");
+
+struct FlightRecorder
+{
+    FILE *f;
+    uint32_t nextSlot;
+    uint32_t seq;
+
+    /* Accumulation window */
+    uint32_t histo[8];
+    double frameMsSum, frameMsMax;
+    uint32_t frames;
+    double lastFlushSec;
+    double lastFrameSec;
+
+    FlightRecorder()
+        : f(0), nextSlot(0), seq(0), frameMsSum(0), frameMsMax(0),
+          frames(0), lastFlushSec(0), lastFrameSec(0)
+    {
+        memset(histo, 0, sizeof(histo));
+    }
+
+    ~FlightRecorder()
+    {
+        if (f)
+            fclose(f);
+    }
+
+    static int bucketFor(double ms)
+    {
+        static const double edges[7] =
+                { 8.4, 16.8, 20.0, 25.0, 33.4, 50.0, 100.0 };
+
+        for (int i = 0; i < 7; ++i)
+            if (ms <= edges[i])
+                return i;
+
+        return 7;
+    }
+
+    void open(const std::string &path)
+    {
+        /* Continue an existing ring if the header checks out,
+         * otherwise start it over */
+        f = fopen(path.c_str(), "r+b");
+
+        if (f)
+        {
+            char magic[8];
+            uint32_t version, slots, slotSize, cursor;
+
+            if (fread(magic, 1, 8, f) == 8 &&
+                memcmp(magic, FREC_HDR_MAGIC, 8) == 0 &&
+                fread(&version, 1, 4, f) == 4 && version == FREC_VERSION &&
+                fread(&slots, 1, 4, f) == 4 && slots == FREC_SLOTS &&
+                fread(&slotSize, 1, 4, f) == 4 && slotSize == FREC_SLOT_SIZE &&
+                fread(&cursor, 1, 4, f) == 4 && cursor < FREC_SLOTS)
+            {
+                nextSlot = cursor;
+                seq = cursor;
+                return;
+            }
+
+            fclose(f);
+        }
+
+        f = fopen(path.c_str(), "w+b");
+
+        if (!f)
+            return;
+
+        const uint32_t version = FREC_VERSION;
+        const uint32_t slots = FREC_SLOTS;
+        const uint32_t slotSize = FREC_SLOT_SIZE;
+        const uint32_t cursor = 0;
+
+        fwrite(FREC_HDR_MAGIC, 1, 8, f);
+        fwrite(&version, 1, 4, f);
+        fwrite(&slots, 1, 4, f);
+        fwrite(&slotSize, 1, 4, f);
+        fwrite(&cursor, 1, 4, f);
+        fflush(f);
+    }
+
+    void frame(double nowSec)
+    {
+        if (!f)
+            return;
+
+        if (lastFrameSec > 0)
+        {
+            const double dtMs = (nowSec - lastFrameSec) * 1000.0;
+
+            histo[bucketFor(dtMs)]++;
+            frameMsSum += dtMs;
+            if (dtMs > frameMsMax)
+                frameMsMax = dtMs;
+            frames++;
+        }
+
+        lastFrameSec = nowSec;
+
+        if (lastFlushSec == 0)
+            lastFlushSec = nowSec;
+
+        if ((nowSec - lastFlushSec) * 1000.0 >= FREC_PERIOD_MS)
+        {
+            writeRecord();
+            lastFlushSec = nowSec;
+        }
+    }
+
+    void writeRecord()
+    {
+        FlightRecord rec;
+        memset(&rec, 0, sizeof(rec));
+
+        rec.magic = FREC_MAGIC;
+        rec.seq = ++seq;
+        rec.wallSec = (uint64_t) time(0);
+
+        rec.frames = frames;
+        rec.avgFrameMs = frames ? (float) (frameMsSum / frames) : 0.0f;
+        rec.maxFrameMs = (float) frameMsMax;
+        memcpy(rec.histo, histo, sizeof(histo));
+
+        TexPool::Stats tp = shState->texPool().stats();
+        rec.texPoolBytes = tp.cachedBytes;
+        rec.texPoolEvict = tp.evictions;
+        rec.seBytes = shState->audio().seBytes();
+        rec.prefetchBytes = (uint32_t) shState->fileSystem().prefetchUsage();
+
+        GlyphAtlas::Stats ga = shState->fontState().glyphAtlas().stats();
+        rec.glyphPages = (uint32_t) ga.pages;
+        rec.glyphEvict = ga.evictions;
+
+        const SceneQuadBatch::Stats &bs = SceneQuadBatch::instance().stats();
+        rec.batchDraws = bs.batches;
+        rec.batchQuads = bs.quads;
+
+        /* Slot first, flushed; then the cursor. A crash in between
+         * leaves a readable file either way */
+        const long slotOff = 24 + (long) nextSlot * FREC_SLOT_SIZE;
+
+        if (fseek(f, slotOff, SEEK_SET) != 0)
+            return;
+
+        fwrite(&rec, 1, sizeof(rec), f);
+        fflush(f);
+
+        nextSlot = (nextSlot + 1) % FREC_SLOTS;
+
+        if (fseek(f, 20, SEEK_SET) == 0)
+        {
+            fwrite(&nextSlot, 1, 4, f);
+            fflush(f);
+        }
+
+        memset(histo, 0, sizeof(histo));
+        frameMsSum = 0;
+        frameMsMax = 0;
+        frames = 0;
+    }
+};
+
+/* What a finished (or aborted) playback leaves behind for
+ * Graphics.movie_stats */
+struct MovieStats
+{
+    bool valid;
+    int presented;       /* frames that reached the screen */
+    int dropped;         /* decoded but skipped to catch up */
+    int repeated;        /* presents that held > 1.5 frame periods */
+    unsigned int decodedFrames;
+    double decodeAvgMs, decodeMaxMs;
+    double uploadAvgMs, uploadMaxMs;
+    double presentAvgMs, presentMaxMs;
+
+    MovieStats() { reset(); }
+    void reset()
+    {
+        valid = false;
+        presented = dropped = repeated = 0;
+        decodedFrames = 0;
+        decodeAvgMs = decodeMaxMs = 0;
+        uploadAvgMs = uploadMaxMs = 0;
+        presentAvgMs = presentMaxMs = 0;
+    }
+};
 
 struct Movie
 {
@@ -117,10 +454,128 @@ struct Movie
     ALuint alBuffers[STREAM_BUFS];
     ALshort audioBuffer[MOVIE_AUDIO_BUFFER_SIZE];
     SDL_mutex *audioMutex;
-    
+
+    /* Audio playback clock: the audio thread counts sample frames
+     * that have fully left the AL source and publishes the track
+     * position in ms, which play() paces video frames against.
+     * Wall time drifts from the DAC over a long cutscene; this
+     * doesn't */
+    SDL_atomic_t audioClockMs;
+    Uint64 audioPlayedFrames;
+    ALuint bufIds[STREAM_BUFS];
+    ALuint bufFrames[STREAM_BUFS];
+    
+    /* Planar YCbCr upload targets; conversion to RGB happens
+     * in a fragment shader instead of on the CPU */
+    TEX::ID yuvTex[3];
+    bool yuvTexInit;
+
+    /* Where playback starts (Graphics.play_movie start argument);
+     * resumes decode at the nearest earlier keyframe */
+    unsigned int startOffsetMs;
+
+    /* Keyframe index cache bookkeeping (see movieIndexCachePath) */
+    std::string indexCachePath;
+    long importedIndexLen;
+
+    /* Timed-text track (see parseSrtCues); subIdx advances with
+     * playback, subFont is the bitmap's drawing font while subs
+     * are active */
+    std::vector<SubtitleCue> subCues;
+    size_t subIdx;
+    Font *subFont;
+
+    /* Filled by play(); decode numbers are added by playMovie
+     * before the decoder is torn down */
+    MovieStats stats;
+
     Movie(bool skippable_)
-    : decoder(0), audio(0), video(0), skippable(skippable_), videoBitmap(0), audioThread(0)
+    : decoder(0), audio(0), video(0), hasVideo(false), hasAudio(false),
+      skippable(skippable_), videoBitmap(0), audioThread(0),
+      audioQueueHead(0), audioQueueTail(0), audioMutex(0),
+      audioPlayedFrames(0), yuvTexInit(false), startOffsetMs(0), importedIndexLen(0),
+      subIdx(0), subFont(0)
+    {
+    }
+
+    /* Pick up "<path>.srt" (or the extension-stripped variant)
+     * from the game's filesystem, if the movie has one */
+    void loadSubtitles(const char *filename)
+    {
+        std::string path(filename);
+        std::string cands[2];
+        cands[0] = path + ".srt";
+
+        size_t dot = path.find_last_of('.');
+        if (dot != std::string::npos && path.find('/', dot) == std::string::npos)
+            cands[1] = path.substr(0, dot) + ".srt";
+
+        for (int i = 0; i < 2; ++i)
+        {
+            if (cands[i].empty() || !shState->fileSystem().exists(cands[i].c_str()))
+                continue;
+
+            SDL_RWops ops;
+            try {
+                shState->fileSystem().openReadRaw(ops, cands[i].c_str());
+            } catch (...) {
+                continue;
+            }
+
+            Sint64 size = SDL_RWsize(&ops);
+            if (size > 0 && size <= (1 << 20))
+            {
+                std::string data((size_t) size, '\0');
+                if (SDL_RWread(&ops, &data[0], 1, (size_t) size) == (size_t) size)
+                    parseSrtCues(data, subCues);
+            }
+            SDL_RWclose(&ops);
+            break;
+        }
+    }
+
+    /* Redrawn after every frame upload (the blit wipes the target);
+     * cue changes between frames land with the next one */
+    void drawSubtitle(Uint32 now)
     {
+        if (subCues.empty() || !subFont)
+            return;
+
+        while (subIdx < subCues.size() && subCues[subIdx].endMs <= now)
+            subIdx++;
+
+        if (subIdx >= subCues.size() || subCues[subIdx].startMs > now)
+            return;
+
+        const std::string &text = subCues[subIdx].text;
+        const int w = videoBitmap->width();
+        const int h = videoBitmap->height();
+        const int lineH = subFont->getSize() + subFont->getSize() / 4;
+
+        /* Count lines, anchor the block above the bottom margin */
+        int lines = 1;
+        for (size_t i = 0; i < text.size(); ++i)
+            if (text[i] == '\n')
+                lines++;
+
+        int y = h - h / 20 - lines * lineH;
+
+        size_t pos = 0;
+        while (pos <= text.size())
+        {
+            size_t eol = text.find('\n', pos);
+            size_t end = (eol == std::string::npos) ? text.size() : eol;
+            std::string line = text.substr(pos, end - pos);
+            pos = end + 1;
+
+            if (!line.empty())
+                videoBitmap->drawText(IntRect(0, y, w, lineH),
+                                      line.c_str(), 1 /* center */);
+            y += lineH;
+
+            if (eol == std::string::npos)
+                break;
+        }
     }
     bool preparePlayback()
     {
@@ -134,23 +589,49 @@ struct Movie
         }
         
         io->read = readMovie;
+        io->seek = seekMovie;
         io->close = closeMovie;
         io->userdata = &srcOps;
-        decoder = THEORAPLAY_startDecode(io, DEF_MAX_VIDEO_FRAMES, THEORAPLAY_VIDFMT_RGBA);
+        decoder = THEORAPLAY_startDecode(io, DEF_MAX_VIDEO_FRAMES, THEORAPLAY_VIDFMT_IYUV);
         if (!decoder) {
             SDL_RWclose(&srcOps);
             return false;
         }
-        
+
+        // Feed the cached keyframe index back in, if we have one.
+        if (!indexCachePath.empty()) {
+            FILE *f = fopen(indexCachePath.c_str(), "rb");
+            if (f) {
+                long len = 0;
+                if (fseek(f, 0, SEEK_END) == 0 && (len = ftell(f)) > 0 &&
+                    len <= (1 << 24) && fseek(f, 0, SEEK_SET) == 0)
+                {
+                    void *blob = malloc(len);
+                    if (blob) {
+                        if (fread(blob, 1, len, f) == (size_t) len) {
+                            THEORAPLAY_importIndex(decoder, blob, len);
+                            importedIndexLen = len;
+                        }
+                        free(blob);
+                    }
+                }
+                fclose(f);
+            }
+        }
+
         // Wait until the decoder has parsed out some basic truths from the file.
         while (!THEORAPLAY_isInitialized(decoder)) {
             SDL_Delay(VIDEO_DELAY);
         }
-        
+
         // Once we're initialized, we can tell if this file has audio and/or video.
         hasAudio = THEORAPLAY_hasAudioStream(decoder);
         hasVideo = THEORAPLAY_hasVideoStream(decoder);
-        
+
+        // Jump ahead before prebuffering if a start offset was asked for.
+        if (startOffsetMs && hasVideo)
+            THEORAPLAY_seek(decoder, startOffsetMs);
+
         // Queue up the audio
         if (hasAudio) {
             while ((audio = THEORAPLAY_getAudio(decoder)) == NULL) {
@@ -167,15 +648,23 @@ struct Movie
             return false;
         }
         
-        // Wait until we have video
+        // Wait until we have video. A decode that runs dry without
+        // producing any (e.g. a start offset past the end) is a bust.
         while ((video = THEORAPLAY_getVideo(decoder)) == NULL) {
+            if (!THEORAPLAY_isDecoding(decoder)) {
+                THEORAPLAY_stopDecode(decoder);
+                decoder = NULL;
+                return false;
+            }
             SDL_Delay(VIDEO_DELAY);
         }
-        
+
         // Wait until we have audio, if applicable
         audio = NULL;
         if (hasAudio) {
             while ((audio = THEORAPLAY_getAudio(decoder)) == NULL && THEORAPLAY_availableVideo(decoder) < DEF_MAX_VIDEO_FRAMES) {
+                if (!THEORAPLAY_isDecoding(decoder))
+                    break;
                 SDL_Delay(VIDEO_DELAY);
             }
         }
@@ -184,10 +673,59 @@ struct Movie
         videoBitmap = new Bitmap(video->width, video->height, true);
         audioQueueHead = NULL;
         audioQueueTail = NULL;
-        
+
+        /* Subtitle text draws with its own font: sized against the
+         * video, white on a black outline regardless of what the
+         * game did to the font defaults */
+        if (!subCues.empty()) {
+            subFont = new Font();
+            int size = (int) video->height / 14;
+            if (size < 16)
+                size = 16;
+            subFont->setSize(size, false);
+            subFont->setBold(true);
+            subFont->setOutline(true);
+            Color white(255, 255, 255, 255);
+            subFont->setColor(white);
+            Color black(0, 0, 0, 255);
+            subFont->setOutColor(black);
+            videoBitmap->setInitFont(subFont);
+        }
+
         return true;
     }
     
+    /* Uploads the decoder's planar YCbCr frame as three
+     * single-channel textures and converts it to RGB on the
+     * GPU, straight into the video bitmap - the per-frame CPU
+     * colorspace conversion is gone entirely */
+    void uploadYUVFrame()
+    {
+        const int w = video->width, h = video->height;
+        const int cw = w / 2, ch = h / 2;
+
+        if (!yuvTexInit) {
+            for (int i = 0; i < 3; ++i) {
+                yuvTex[i] = TEX::gen();
+                TEX::bind(yuvTex[i]);
+                TEX::setRepeat(false);
+                TEX::setSmooth(true);
+            }
+            yuvTexInit = true;
+        }
+
+        const uint8_t *yP = (const uint8_t*) video->pixels;
+        const uint8_t *uP = yP + w * h;
+        const uint8_t *vP = uP + cw * ch;
+
+        GLMeta::blitYUVPlanes(videoBitmap->getGLTypes(), yuvTex, w, h,
+                              yP, uP, vP);
+
+        videoBitmap->taintArea(IntRect(0, 0, w, h));
+        videoBitmap->modified();
+        shState->graphics().markSceneDirty();
+    }
+
     void queueAudioPacket(const THEORAPLAY_AudioPacket *audio) {
         AudioQueue *item = NULL;
         
@@ -225,12 +763,48 @@ struct Movie
         }
     }
 
+    void rememberBufFrames(ALuint id, ALuint frames)
+    {
+        for (int i = 0; i < STREAM_BUFS; ++i)
+            if (bufIds[i] == id) { bufFrames[i] = frames; return; }
+    }
+
+    ALuint takeBufFrames(ALuint id)
+    {
+        for (int i = 0; i < STREAM_BUFS; ++i) {
+            if (bufIds[i] == id) {
+                const ALuint frames = bufFrames[i];
+                bufFrames[i] = 0;
+                return frames;
+            }
+        }
+        return 0;
+    }
+
+    /* Audio thread only. AL_SAMPLE_OFFSET covers the buffers still
+     * queued; frames of retired buffers are credited on unqueue, so
+     * the sum tracks the track position. The max() keeps the clock
+     * monotonic across the retire/offset-reset boundary */
+    void updateAudioClock(int sampleRate)
+    {
+        ALint offset = 0;
+
+        if (sampleRate <= 0)
+            return;
+
+        alGetSourcei(audioSource, AL_SAMPLE_OFFSET, &offset);
+        const Uint32 ms = (Uint32) (((audioPlayedFrames + offset) * 1000) / (Uint64) sampleRate);
+
+        if (ms > (Uint32) SDL_AtomicGet(&audioClockMs))
+            SDL_AtomicSet(&audioClockMs, (int) ms);
+    }
+
     void streamMovieAudio(){
         ALint state = 0;
-        ALint procBufs = STREAM_BUFS;	    
+        ALint procBufs = STREAM_BUFS;
         volatile AudioQueue *audioPacketAndOffset;
-        int channels;
-        int sampleRate;
+        int channels = 2;
+        int sampleRate = 0;
         float *sourceSamples;
         ALuint samplesToProcess;
         ALshort *sampleBuffer;
@@ -254,16 +828,9 @@ struct Movie
 
                     if (samplesToProcess > remainingSamples) samplesToProcess = remainingSamples;
 
-                    for (ALuint i = 0; i < samplesToProcess; i++) {
-                        const float val = (*(sourceSamples++));
-                        if (val < -1.0f) {
-                            *(sampleBuffer++) = SHRT_MIN;
-                        } else if (val > 1.0f) {
-                            *(sampleBuffer++) = SHRT_MAX;
-                        } else {
-                            *(sampleBuffer++) = (ALshort) (val * SHRT_MAX);
-                        }
-                    }
+                    audioFloatToS16(sampleBuffer, sourceSamples, samplesToProcess);
+                    sampleBuffer += samplesToProcess;
+                    sourceSamples += samplesToProcess;
 
                     // Necessary to remember position between repeated iterations
                     audioPacketAndOffset->offset += (samplesToProcess / channels);
@@ -283,7 +850,9 @@ struct Movie
 
                 alBufferData(alBuffers[procBufs], channels == 1 ? AL_FORMAT_MONO16 : AL_FORMAT_STEREO16, audioBuffer,
                     (MOVIE_AUDIO_BUFFER_SIZE - remainingSamples) * sizeof(ALshort), sampleRate);
-                alSourceQueueBuffers(audioSource, 1, &alBuffers[procBufs]);     
+                alSourceQueueBuffers(audioSource, 1, &alBuffers[procBufs]);
+                rememberBufFrames(alBuffers[procBufs],
+                    (MOVIE_AUDIO_BUFFER_SIZE - remainingSamples) / channels);
                 alGetSourcei(audioSource, AL_SOURCE_STATE, &state);
                 if(state != AL_PLAYING) alSourcePlay(audioSource);
             }
@@ -293,11 +862,15 @@ struct Movie
                 // Quit if audio thread terminate request has been made
                 if (audioThreadTermReq) return;
 
+                updateAudioClock(sampleRate);
+
                 alGetSourcei(audioSource, AL_BUFFERS_PROCESSED, &procBufs);
                 if(procBufs > 0) break;
                 SDL_Delay(AUDIO_SLEEP);
             }
             alSourceUnqueueBuffers(audioSource, procBufs, alBuffers);
+            for (ALint i = 0; i < procBufs; ++i)
+                audioPlayedFrames += takeBufFrames(alBuffers[i]);
         }
     }
     
@@ -307,6 +880,13 @@ struct Movie
         alGenBuffers(STREAM_BUFS, alBuffers);
         alSourcef(audioSource, AL_GAIN, volume);
 
+        audioPlayedFrames = 0;
+        SDL_AtomicSet(&audioClockMs, 0);
+        for (int i = 0; i < STREAM_BUFS; ++i) {
+            bufIds[i] = alBuffers[i];
+            bufFrames[i] = 0;
+        }
+
         audioThreadTermReq.clear();
         audioMutex = SDL_CreateMutex();
         queueAudioPacket(audio);
@@ -320,8 +900,22 @@ struct Movie
     void play(float volume)
     {
         Uint32 frameMs = 0;
-        Uint32 baseTicks = SDL_GetTicks();
+        /* The pacing position is biased by the start offset: both
+         * wall time and the audio clock count from the seek target */
+        Uint32 baseTicks = SDL_GetTicks() - startOffsetMs;
+        /* Once audio starts, the stream position comes from the audio
+         * clock; between its updates (and past the end of a track
+         * shorter than the video) it extrapolates on wall time from
+         * the last advance, so pacing stays smooth across underruns */
+        Uint32 lastAudioMs = 0;
+        Uint32 lastAudioWall = 0;
         bool openedAudio = false;
+
+        /* Per-frame timing (see MovieStats) */
+        const double perfToMs = 1000.0 / SDL_GetPerformanceFrequency();
+        double upTotalMs = 0, prTotalMs = 0;
+        Uint32 lastPresentWall = 0;
+
         while (THEORAPLAY_isDecoding(decoder)) {
             // Check for reset/shutdown input
             if(shState->graphics().updateMovieInput(this)) break;
@@ -332,8 +926,18 @@ struct Movie
                 if  (shState->input().isTriggered(Input::C) || shState->input().isTriggered(Input::B)) break;
             }
             
-            const Uint32 now = SDL_GetTicks() - baseTicks;
-            
+            const Uint32 wallTicks = SDL_GetTicks();
+            Uint32 now = wallTicks - baseTicks;
+
+            if (openedAudio) {
+                const Uint32 audioMs = (Uint32) SDL_AtomicGet(&audioClockMs);
+                if (audioMs != lastAudioMs || lastAudioWall == 0) {
+                    lastAudioMs = audioMs;
+                    lastAudioWall = wallTicks;
+                }
+                now = startOffsetMs + lastAudioMs + (wallTicks - lastAudioWall);
+            }
+
             if (!video) {
                 video = THEORAPLAY_getVideo(decoder);
             }
@@ -362,10 +966,11 @@ struct Movie
                     while ((video = THEORAPLAY_getVideo(decoder)) != NULL)
                     {
                         THEORAPLAY_freeVideo(last);
+                        stats.dropped++;
                         last = video;
                         if ((now - video->playms) < frameMs)
                             break;
-                    } 
+                    }
 
                     if (!video)
                         video = last;
@@ -378,8 +983,30 @@ struct Movie
                 }
 
                 // Got a video frame, now draw it
-                videoBitmap->replaceRaw(video->pixels, video->width * video->height * 4);
+                Uint64 t0 = SDL_GetPerformanceCounter();
+                uploadYUVFrame();
+                drawSubtitle(now);
+                Uint64 t1 = SDL_GetPerformanceCounter();
                 shState->graphics().update(false);
+                Uint64 t2 = SDL_GetPerformanceCounter();
+
+                const double upMs = (t1 - t0) * perfToMs;
+                const double prMs = (t2 - t1) * perfToMs;
+                upTotalMs += upMs;
+                prTotalMs += prMs;
+                if (upMs > stats.uploadMaxMs)
+                    stats.uploadMaxMs = upMs;
+                if (prMs > stats.presentMaxMs)
+                    stats.presentMaxMs = prMs;
+
+                /* A frame that stayed up much longer than one period
+                 * means pacing starved (decode or IO behind) */
+                if (stats.presented > 0 && frameMs &&
+                    (wallTicks - lastPresentWall) > frameMs + frameMs / 2)
+                    stats.repeated++;
+                lastPresentWall = wallTicks;
+                stats.presented++;
+
                 THEORAPLAY_freeVideo(video);
                 video = NULL;
 
@@ -392,11 +1019,19 @@ struct Movie
                 bufferMovieAudio(decoder, now);
             }
         }
+
+        if (stats.presented > 0) {
+            stats.uploadAvgMs = upTotalMs / stats.presented;
+            stats.presentAvgMs = prTotalMs / stats.presented;
+        }
+        stats.valid = true;
     }
     
     ~Movie()
     {
-        if (hasAudio) {
+        /* audioMutex doubles as "startAudio ran": before that, none
+         * of the audio machinery below exists */
+        if (hasAudio && audioMutex) {
             if (audioQueueTail) {
                 THEORAPLAY_freeAudio(audioQueueTail->audio);
             }
@@ -418,8 +1053,34 @@ struct Movie
         }
         if (video) THEORAPLAY_freeVideo(video);
         if (audio) THEORAPLAY_freeAudio(audio);
+
+        // Persist the keyframe index if it grew past what we loaded.
+        if (decoder && !indexCachePath.empty()) {
+            long len = 0;
+            void *blob = THEORAPLAY_exportIndex(decoder, &len);
+            if (blob) {
+                if (len > importedIndexLen) {
+                    std::string tmp = indexCachePath + ".tmp";
+                    FILE *f = fopen(tmp.c_str(), "wb");
+                    if (f) {
+                        const bool ok = (fwrite(blob, 1, len, f) == (size_t) len);
+                        fclose(f);
+                        if (ok)
+                            rename(tmp.c_str(), indexCachePath.c_str());
+                        else
+                            remove(tmp.c_str());
+                    }
+                }
+                free(blob);
+            }
+        }
+
         if (decoder) THEORAPLAY_stopDecode(decoder);
+        if (yuvTexInit)
+            for (int i = 0; i < 3; ++i)
+                TEX::del(yuvTex[i]);
         delete videoBitmap;
+        delete subFont;
     }
 };
 
@@ -653,6 +1314,8 @@ public:
     }
     
     PingPong &getPP() { return pp; }
+
+    TEXFBO *renderTarget() { return &pp.frontBuffer(); }
     
 private:
     PingPong pp;
@@ -682,6 +1345,15 @@ struct FPSLimiter {
     
     bool disabled;
     
+    /* Adaptive pacing: the coarse OS sleep is cut short by a
+     * margin and the precise remainder is busy-waited. The
+     * margin tracks the oversleep the OS sleep actually
+     * exhibits, so timer granularity stops showing up as
+     * frame jitter. 'spinMaxTicks' bounds the busy-wait
+     * (0 = plain sleep, the old behavior) */
+    int64_t spinMaxTicks;
+    int64_t spinMarginTicks;
+    
     /* Data for frame timing adjustment */
     struct {
         /* Last tick count */
@@ -693,12 +1365,15 @@ struct FPSLimiter {
         bool resetFlag;
     } adj;
     
-    FPSLimiter(uint16_t desiredFPS)
+    FPSLimiter(uint16_t desiredFPS, int spinUS = 0)
     : lastTickCount(SDL_GetPerformanceCounter()),
     tickFreq(SDL_GetPerformanceFrequency()), tickFreqMS(tickFreq / 1000),
     tickFreqNS((double)tickFreq / NS_PER_S), disabled(false) {
         setDesiredFPS(desiredFPS);
         
+        spinMaxTicks = (int64_t) ((tickFreq / 1000000.0) * spinUS);
+        spinMarginTicks = spinMaxTicks / 2;
+        
         adj.last = SDL_GetPerformanceCounter();
         adj.idealDiff = 0;
         adj.resetFlag = false;
@@ -751,6 +1426,43 @@ struct FPSLimiter {
     
 private:
     void delayTicks(uint64_t ticks) {
+        if (spinMaxTicks > 0)
+        {
+            const uint64_t target = SDL_GetPerformanceCounter() + ticks;
+            
+            int64_t coarse = (int64_t) ticks - spinMarginTicks;
+            
+            if (coarse > 0)
+            {
+                const uint64_t before = SDL_GetPerformanceCounter();
+                sleepTicks(coarse);
+                const uint64_t after = SDL_GetPerformanceCounter();
+                
+                /* Track the observed oversleep and adapt the
+                 * margin toward it (plus a small cushion),
+                 * bounded by the configured window */
+                int64_t overslept = (int64_t) (after - before) - coarse;
+                if (overslept < 0)
+                    overslept = 0;
+                
+                int64_t desired = overslept + (int64_t) tickFreqMS / 4;
+                spinMarginTicks = (spinMarginTicks * 7 + desired) / 8;
+                
+                if (spinMarginTicks > spinMaxTicks)
+                    spinMarginTicks = spinMaxTicks;
+            }
+            
+            /* Fine spin up to the precise target */
+            while (SDL_GetPerformanceCounter() < target)
+                ;
+            
+            return;
+        }
+        
+        sleepTicks(ticks);
+    }
+    
+    void sleepTicks(uint64_t ticks) {
 #if defined(HAVE_NANOSLEEP)
         struct timespec req;
         uint64_t nsec = ticks / tickFreqNS;
@@ -816,6 +1528,11 @@ struct GraphicsPrivate {
     
     bool frozen;
     TEXFBO frozenScene;
+    /* The freeze capture is lazy: freeze() only composites into
+     * the ping-pong front buffer (which stays untouched while
+     * frozen), and the copy into frozenScene happens on first
+     * actual use. An instant transition never pays for it */
+    bool frozenSceneValid;
     Quad screenQuad;
     
     float backingScaleFactor;
@@ -835,7 +1552,20 @@ struct GraphicsPrivate {
     /* Global list of all live Disposables
      * (disposed on reset) */
     IntruList<Disposable> dispList;
-    
+
+    /* Movie readied by Graphics.preload_movie: opened, demuxed
+     * and prebuffered; consumed by the next playMovie call with
+     * a matching path */
+    Movie *preloadedMovie;
+    std::string preloadedMovieName;
+
+    /* Last playMovie's numbers (Graphics.movie_stats) */
+    MovieStats movieStats;
+
+    /* Crash-safe perf ring (flightRecorder config) */
+    FlightRecorder flightRec;
+    bool flightRecInit;
+
     GraphicsPrivate(RGSSThreadData *rtData)
     : scResLores(DEF_SCREEN_W, DEF_SCREEN_H),
     scRes(rtData->config.enableHires ? (int)lround(rtData->config.framebufferScalingFactor * DEF_SCREEN_W) : DEF_SCREEN_W,
@@ -845,10 +1575,13 @@ struct GraphicsPrivate {
     screen(scRes.x, scRes.y), threadData(rtData),
     glCtx(SDL_GL_GetCurrentContext()), multithreadedMode(true),
     frameRate(DEF_FRAMERATE), frameCount(0), brightness(255),
-    fpsLimiter(frameRate), useFrameSkip(rtData->config.frameSkip), frozen(false),
+    fpsLimiter(frameRate, rtData->config.powerSaver ? 0 : rtData->config.framePacingSpin),
+    useFrameSkip(rtData->config.frameSkip), frozen(false), frozenSceneValid(false),
     last_update(0), last_avg_update(0), backingScaleFactor(1), integerScaleFactor(0, 0),
     integerScaleActive(rtData->config.integerScaling.active),
-    integerLastMileScaling(rtData->config.integerScaling.lastMileScaling) {
+    integerLastMileScaling(rtData->config.integerScaling.lastMileScaling),
+    preloadedMovie(0), flightRecInit(false) {
+        hudEnabled = rtData->config.perfHud;
         avgFPSData = std::vector<double>();
         avgFPSLock = SDL_CreateMutex();
         glResourceLock = SDL_CreateMutex();
@@ -860,6 +1593,7 @@ struct GraphicsPrivate {
         
         recalculateScreenSize(rtData->config.fixedAspectRatio);
         updateScreenResoRatio(rtData);
+        recalcSubFrames();
         
         TEXFBO::init(frozenScene);
         TEXFBO::allocEmpty(frozenScene, scRes.x, scRes.y);
@@ -872,8 +1606,23 @@ struct GraphicsPrivate {
     }
     
     ~GraphicsPrivate() {
+        /* The cached transition bitmaps are deliberately NOT
+         * deleted here: TexPool is declared after Graphics in
+         * SharedStatePrivate and thus destroyed first, so their
+         * release would touch a dead pool. We only get here at
+         * process exit, where the context goes away anyway */
+
+        delete preloadedMovie;
+
+        if (frameLog)
+            fclose(frameLog);
+
+        if (hudTexInit)
+            TEXFBO::fini(hudTex);
+
         TEXFBO::fini(frozenScene);
         TEXFBO::fini(integerScaleBuffer);
+        TEXFBO::fini(presentCache);
         SDL_DestroyMutex(avgFPSLock);
         SDL_DestroyMutex(glResourceLock);
     }
@@ -981,6 +1730,7 @@ struct GraphicsPrivate {
             
             /* some GL drivers change the viewport on window resize */
             glState.viewport.refresh();
+            presentCacheValid = false;
             recalculateScreenSize(threadData->config.fixedAspectRatio);
             updateScreenResoRatio(threadData);
             
@@ -1001,29 +1751,398 @@ struct GraphicsPrivate {
         scriptBinding->terminate();
     }
     
-    void swapGLBuffer() {
-        fpsLimiter.delay();
-        SDL_GL_SwapWindow(threadData->window);
-        
-        ++frameCount;
-        
-        threadData->ethread->notifyFrame();
-    }
-    
-    void compositeToBuffer(TEXFBO &buffer) {
-        compositeToBufferScaled(buffer, scRes.x, scRes.y);
-    }
+    /* The pacing delay is not taken right before the swap, but
+     * deferred to the start of the next frame's rendering. The
+     * script logic for frame N+1 thus runs while the GPU still
+     * churns on frame N, and only the remaining time to the
+     * frame target is slept - for CPU-bound games the sleep
+     * shrinks to nothing instead of serializing script
+     * execution and GPU submission */
+    bool delayPending = false;
+
+    /* Damage tracking: composite only when something might
+     * have changed since the last drawn frame. Mutating script
+     * operations (via the GFX lock), bitmap modifications and
+     * playing bitmap animations all mark the scene dirty */
+    bool sceneDirty = true;
+    int skippedPresents = 0;
+
+    /* ---- Perf HUD overlay (Graphics.perf_hud) ----
+     * A tiny text panel rebuilt ~4x a second into its own texture
+     * and blended over the final frame just before the swap */
+    bool hudEnabled = false;
+    TEXFBO hudTex;
+    bool hudTexInit = false;
+    double hudBuiltAt = 0;
+    double scriptMs = 0;
+    double updateEndAt = 0;
+    uint64_t hudPrevDraws = 0, hudPrevQuads = 0;
+    int hudPrevFrames = 0;
+    double frameMs = 0;
+
+    /* Frame time log sink (frameTimeLog config); stdio buffering
+     * keeps the per-frame cost to a formatted append */
+    FILE *frameLog = 0;
+    bool frameLogTried = false;
+    unsigned frameLogLines = 0;
+
+    /* Budget alert throttle (at most ~2 alerts a second) */
+    double lastAlertAt = 0;
+    int animatedPlayingCount = 0;
+
+    /* GPU phase timing via double-buffered GL timer queries:
+     * one set is written this frame while last frame's set is
+     * harvested, so reading back never stalls. Cheap enough
+     * to stay on permanently where the driver supports it */
+    struct GpuTimers {
+        enum Phase { PhComposite = 0, PhPresent, PhTransition, PhCount };
+
+        GLuint queries[2][PhCount];
+        bool used[2][PhCount];
+        int parity = 0;
+        double resultMs[PhCount] = { 0, 0, 0 };
+        bool inited = false;
+
+        void ensureInit() {
+            if (inited || !gl.timer_query)
+                return;
 
-    void compositeToBufferScaled(TEXFBO &buffer, int destWidth, int destHeight) {
-        screen.composite();
-        
-        int scaleIsSpecial = GLMeta::blitScaleIsSpecial(buffer, false, IntRect(0, 0, destWidth, destHeight), screen.getPP().frontBuffer(), IntRect(0, 0, scRes.x, scRes.y));
+            gl.GenQueries(2 * PhCount, &queries[0][0]);
+            memset(used, 0, sizeof(used));
+            inited = true;
+        }
 
-        GLMeta::blitBegin(buffer, false, scaleIsSpecial);
-        GLMeta::blitSource(screen.getPP().frontBuffer(), scaleIsSpecial);
-        GLMeta::blitRectangle(IntRect(0, 0, scRes.x, scRes.y), IntRect(0, 0, destWidth, destHeight));
-        GLMeta::blitEnd();
-    }
+        void beginFrame() {
+            if (!gl.timer_query)
+                return;
+
+            ensureInit();
+            parity ^= 1;
+
+            /* Harvest the set written last frame */
+            const int read = parity;
+
+            for (int i = 0; i < PhCount; ++i) {
+                if (!used[read][i])
+                    continue;
+
+                GLint avail = 0;
+                gl.GetQueryObjectiv(queries[read][i], GL_QUERY_RESULT_AVAILABLE, &avail);
+
+                if (avail) {
+                    GLuint64 ns = 0;
+                    gl.GetQueryObjectui64v(queries[read][i], GL_QUERY_RESULT, &ns);
+                    resultMs[i] = ns / 1000000.0;
+                    used[read][i] = false;
+                }
+            }
+        }
+
+        void begin(Phase ph) {
+            if (!inited)
+                return;
+
+            gl.BeginQuery(GL_TIME_ELAPSED, queries[parity][ph]);
+        }
+
+        void end(Phase ph) {
+            if (!inited)
+                return;
+
+            gl.EndQuery(GL_TIME_ELAPSED);
+            used[parity][ph] = true;
+        }
+    } gpuTimers;
+
+    /* Transition graphics cache: decoding and uploading the
+     * transition bitmap at transition start was a visible
+     * hitch, and games reuse a small set of them */
+    enum { transMapCacheCap = 4 };
+    struct CachedTransMap {
+        std::string name;
+        Bitmap *bmp;
+        uint64_t stamp;
+    };
+    std::vector<CachedTransMap> transMapCache;
+    uint64_t transMapCacheClock = 0;
+
+    /* Cached result of the last-mile scaling chain: while the
+     * internal frame is unchanged, expensive filters (bicubic,
+     * lanczos3, xBRZ) re-present this copy instead of
+     * re-filtering the full window every present */
+    TEXFBO presentCache;
+    Vec2i presentCacheSize;
+    bool presentCacheValid = false;
+
+    void ensurePresentCache() {
+        if (presentCacheSize == winSize)
+            return;
+
+        TEXFBO::fini(presentCache);
+        TEXFBO::init(presentCache);
+        TEXFBO::allocEmpty(presentCache, winSize.x, winSize.y);
+        TEXFBO::linkFBO(presentCache);
+
+        presentCacheSize = winSize;
+    }
+
+    Bitmap *requestTransMap(const char *filename)
+    {
+        for (size_t i = 0; i < transMapCache.size(); ++i)
+        {
+            CachedTransMap &c = transMapCache[i];
+
+            if (c.name != filename)
+                continue;
+
+            /* A reset disposes all live Disposables, including
+             * our cached bitmaps; reload in that case */
+            if (nullOrDisposed(c.bmp))
+            {
+                delete c.bmp;
+                transMapCache.erase(transMapCache.begin() + i);
+                break;
+            }
+
+            c.stamp = ++transMapCacheClock;
+            return c.bmp;
+        }
+
+        Bitmap *bmp = new Bitmap(filename);
+
+        if (transMapCache.size() >= transMapCacheCap)
+        {
+            size_t coldest = 0;
+
+            for (size_t i = 1; i < transMapCache.size(); ++i)
+                if (transMapCache[i].stamp < transMapCache[coldest].stamp)
+                    coldest = i;
+
+            delete transMapCache[coldest].bmp;
+            transMapCache.erase(transMapCache.begin() + coldest);
+        }
+
+        CachedTransMap entry = { filename, bmp, ++transMapCacheClock };
+        transMapCache.push_back(entry);
+
+        return bmp;
+    }
+
+    void frameDelay() {
+        if (!delayPending)
+            return;
+
+        delayPending = false;
+        fpsLimiter.delay();
+    }
+
+    /* Fixed-timestep decoupling: number of interpolated
+     * presents per logic tick; the limiter then paces each
+     * present at (frameRate * subFrames) ~ the display rate
+     * while logic stays at frameRate */
+    int interpSubFrames = 1;
+
+    /* Whether the background throttle was active last frame
+     * (edge-detects entry for the one-shot cache purge) */
+    bool wasThrottled = false;
+
+    void recalcSubFrames() {
+        interpSubFrames = 1;
+
+        if (threadData->config.decoupledRender
+        &&  !threadData->config.syncToRefreshrate
+        &&  threadData->config.fixedFramerate <= 0
+        &&  threadData->refreshRate > frameRate)
+            interpSubFrames = clamp(
+                (int) lround((double) threadData->refreshRate / frameRate),
+                1, 8);
+
+        fpsLimiter.setDesiredFPS(frameRate * interpSubFrames);
+    }
+
+    /* One line of HUD text straight from the glyph atlas */
+    void hudDrawLine(TTF_Font *font, GlyphAtlas &atlas,
+                     const char *text, int x, int y)
+    {
+        GlyphShader &shader = shState->shaders().glyph;
+        shader.bind();
+        shader.setTexSize(Vec2i(atlas.pageSize(), atlas.pageSize()));
+        shader.setTranslation(Vec2i());
+        shader.applyViewportProj();
+
+        Quad &quad = shState->gpQuad();
+        int penX = x;
+
+        for (const char *ptr = text; *ptr; ++ptr)
+        {
+            const GlyphAtlas::Glyph *g =
+                    atlas.request(font, TTF_STYLE_NORMAL, (uint16_t) *ptr);
+
+            if (!g)
+                continue;
+
+            TEX::bind(atlas.pageTex(g->page));
+            quad.setTexPosRect(FloatRect(g->rect.x, g->rect.y,
+                                         g->rect.w, g->rect.h),
+                               FloatRect(penX + g->minX, y,
+                                         g->rect.w, g->rect.h));
+            quad.setColor(Vec4(1, 1, 1, 1));
+            quad.draw();
+
+            penX += g->advance;
+        }
+    }
+
+    void hudRebuild(double now)
+    {
+        TTF_Font *font;
+
+        try {
+            font = shState->fontState().getFont("", 14);
+        } catch (...) {
+            return;
+        }
+
+        TTF_SetFontStyle(font, TTF_STYLE_NORMAL);
+
+        if (!hudTexInit)
+        {
+            TEXFBO::init(hudTex);
+            TEXFBO::allocEmpty(hudTex, 340, 66);
+            TEXFBO::linkFBO(hudTex);
+            hudTexInit = true;
+        }
+
+        /* Per-frame batch averages over the rebuild window */
+        const SceneQuadBatch::Stats &bs = SceneQuadBatch::instance().stats();
+        const int frames = std::max(1, frameCount - hudPrevFrames);
+        const uint64_t draws = (bs.batches - hudPrevDraws) / frames;
+        const uint64_t quads = (bs.quads - hudPrevQuads) / frames;
+        hudPrevDraws = bs.batches;
+        hudPrevQuads = bs.quads;
+        hudPrevFrames = frameCount;
+
+        char l1[96], l2[96], l3[96];
+        snprintf(l1, sizeof(l1), "fps %5.1f  frame %5.2fms  script %5.2fms",
+                 averageFPS(), frameMs, scriptMs);
+        snprintf(l2, sizeof(l2), "gpu: comp %4.2f  present %4.2f  trans %4.2f",
+                 gpuTimers.resultMs[GpuTimers::PhComposite],
+                 gpuTimers.resultMs[GpuTimers::PhPresent],
+                 gpuTimers.resultMs[GpuTimers::PhTransition]);
+        snprintf(l3, sizeof(l3), "draws %llu  quads %llu",
+                 (unsigned long long) draws, (unsigned long long) quads);
+
+        FBO::bind(hudTex.fbo);
+        glState.viewport.pushSet(IntRect(0, 0, hudTex.width, hudTex.height));
+        glState.blend.pushSet(true);
+        glState.blendMode.pushSet(BlendNormal);
+        glState.clearColor.pushSet(Vec4(0, 0, 0, 0.6f));
+        FBO::clear();
+        glState.clearColor.pop();
+
+        GlyphAtlas &atlas = shState->fontState().glyphAtlas();
+        hudDrawLine(font, atlas, l1, 6, 2);
+        hudDrawLine(font, atlas, l2, 6, 23);
+        hudDrawLine(font, atlas, l3, 6, 44);
+
+        glState.blendMode.pop();
+        glState.blend.pop();
+        glState.viewport.pop();
+
+        hudBuiltAt = now;
+    }
+
+    void drawHudOverlay()
+    {
+        if (!hudEnabled || threadData->config.headless)
+            return;
+
+        const double now = shState->runTime();
+
+        if (!hudTexInit || now - hudBuiltAt >= 0.25)
+            hudRebuild(now);
+
+        if (!hudTexInit)
+            return;
+
+        FBO::unbind();
+        glState.viewport.pushSet(IntRect(0, 0, winSize.x, winSize.y));
+        glState.blend.pushSet(true);
+        glState.blendMode.pushSet(BlendNormal);
+
+        SimpleAlphaShader &shader = shState->shaders().simpleAlpha;
+        shader.bind();
+        shader.setTexSize(Vec2i(hudTex.width, hudTex.height));
+        shader.applyViewportProj();
+        shader.setTranslation(Vec2i());
+
+        TEX::bind(hudTex.tex);
+        Quad &quad = shState->gpQuad();
+        /* The default framebuffer is y-up; flip the quad */
+        quad.setTexPosRect(FloatRect(0, 0, hudTex.width, hudTex.height),
+                           FloatRect(8, winSize.y - 8,
+                                     hudTex.width, -hudTex.height));
+        quad.setColor(Vec4(1, 1, 1, 1));
+        quad.draw();
+
+        glState.blendMode.pop();
+        glState.blend.pop();
+        glState.viewport.pop();
+    }
+
+    void swapGLBuffer() {
+        GLDebugLogger::frameTick();
+
+        drawHudOverlay();
+
+        /* Headless runs measure raw engine throughput: the
+         * composed frame stays in the offscreen buffers and
+         * neither present nor pacing happens */
+        if (!threadData->config.headless)
+        {
+            SDL_GL_SwapWindow(threadData->window);
+            delayPending = true;
+
+            /* Overlays (Steam etc.) may rebind textures during
+             * the swap; don't trust the bind cache across it */
+            TEX::bound2D = TEX::ID(0xFFFFFFFFu);
+        }
+        
+        ++frameCount;
+        
+        threadData->ethread->notifyFrame();
+    }
+    
+    void compositeToBuffer(TEXFBO &buffer) {
+        compositeToBufferScaled(buffer, scRes.x, scRes.y);
+    }
+
+    /* Materializes the frozen screen copy from the preserved
+     * front buffer; no recomposite involved */
+    void ensureFrozenScene() {
+        if (frozenSceneValid)
+            return;
+
+        int scaleIsSpecial = GLMeta::blitScaleIsSpecial(frozenScene, false, IntRect(0, 0, scRes.x, scRes.y), screen.getPP().frontBuffer(), IntRect(0, 0, scRes.x, scRes.y));
+
+        GLMeta::blitBegin(frozenScene, false, scaleIsSpecial);
+        GLMeta::blitSource(screen.getPP().frontBuffer(), scaleIsSpecial);
+        GLMeta::blitRectangle(IntRect(0, 0, scRes.x, scRes.y), IntRect(0, 0, scRes.x, scRes.y));
+        GLMeta::blitEnd();
+
+        frozenSceneValid = true;
+    }
+
+    void compositeToBufferScaled(TEXFBO &buffer, int destWidth, int destHeight) {
+        screen.composite();
+        
+        int scaleIsSpecial = GLMeta::blitScaleIsSpecial(buffer, false, IntRect(0, 0, destWidth, destHeight), screen.getPP().frontBuffer(), IntRect(0, 0, scRes.x, scRes.y));
+
+        GLMeta::blitBegin(buffer, false, scaleIsSpecial);
+        GLMeta::blitSource(screen.getPP().frontBuffer(), scaleIsSpecial);
+        GLMeta::blitRectangle(IntRect(0, 0, scRes.x, scRes.y), IntRect(0, 0, destWidth, destHeight));
+        GLMeta::blitEnd();
+    }
     
     void metaBlitBufferFlippedScaled(int scaleIsSpecial) {
         metaBlitBufferFlippedScaled(scRes, scaleIsSpecial);
@@ -1043,8 +2162,57 @@ struct GraphicsPrivate {
     }
     
     void redrawScreen() {
-        screen.composite();
+        frameDelay();
+        
+        /* Graphics.wait while frozen still repaints; rescue the
+         * frozen image before the front buffer is overwritten */
+        if (frozen)
+            ensureFrozenScene();
         
+        gpuTimers.beginFrame();
+
+        ZONE_SCOPED("redraw");
+
+        bool composited = false;
+
+        if (sceneDirty || animatedPlayingCount > 0)
+        {
+            GL_MARKER("scene composite");
+            gpuTimers.begin(GpuTimers::PhComposite);
+            screen.composite();
+            gpuTimers.end(GpuTimers::PhComposite);
+            sceneDirty = false;
+            composited = true;
+            presentCacheValid = false;
+        }
+        /* Otherwise the PP front buffer still holds the last
+         * composed frame, and the present path below re-blits
+         * it to the screen as-is */
+        
+        /* Null present: the frame ends in the offscreen buffers */
+        if (threadData->config.headless)
+        {
+            swapGLBuffer();
+            updateAvgFPS();
+            return;
+        }
+
+        /* Power profile: an unchanged scene doesn't need to hit the
+         * swapchain at all - the display keeps showing the last
+         * frame. Re-present periodically anyway so exposure after
+         * minimize/uncover never shows stale garbage */
+        if (threadData->config.powerSaver && !composited &&
+            !hudEnabled && skippedPresents < 30)
+        {
+            skippedPresents++;
+            updateAvgFPS();
+            return;
+        }
+        skippedPresents = 0;
+
+        GL_MARKER("present");
+        gpuTimers.begin(GpuTimers::PhPresent);
+
         // maybe unspaghetti this later
         if (integerScaleStepApplicable() && !integerLastMileScaling)
         {
@@ -1057,6 +2225,8 @@ struct GraphicsPrivate {
             metaBlitBufferFlippedScaled(scRes, scaleIsSpecial, true);
             GLMeta::blitEnd();
             
+            gpuTimers.end(GpuTimers::PhPresent);
+            
             swapGLBuffer();
             return;
         }
@@ -1090,6 +2260,42 @@ struct GraphicsPrivate {
 
         int scaleIsSpecial = GLMeta::blitScaleIsSpecial(integerScaleBuffer, false, IntRect(0, 0, scSize.x, scSize.y), integerScaleActive ? integerScaleBuffer : screen.getPP().frontBuffer(), IntRect(0, 0, sourceSize.x, sourceSize.y));
 
+        /* Unchanged frame + expensive filter: (re)use the
+         * cached scaled output and skip the filter chain */
+        if (!composited && !integerScaleActive &&
+            GLMeta::smoothScalingMethod(scaleIsSpecial) > Bilinear)
+        {
+            if (!presentCacheValid)
+            {
+                ensurePresentCache();
+
+                FBO::bind(presentCache.fbo);
+                FBO::clear();
+
+                GLMeta::blitBegin(presentCache, false, scaleIsSpecial);
+                GLMeta::blitSource(screen.getPP().frontBuffer(), scaleIsSpecial);
+                metaBlitBufferFlippedScaled(sourceSize, scaleIsSpecial);
+                GLMeta::blitEnd();
+
+                presentCacheValid = true;
+            }
+
+            GLMeta::blitBeginScreen(winSize, 0);
+            GLMeta::blitSource(presentCache, 0);
+
+            FBO::clear();
+            GLMeta::blitRectangle(IntRect(0, 0, winSize.x, winSize.y),
+                                  IntRect(0, 0, winSize.x, winSize.y), false);
+            GLMeta::blitEnd();
+
+            gpuTimers.end(GpuTimers::PhPresent);
+
+            swapGLBuffer();
+
+            updateAvgFPS();
+            return;
+        }
+
         GLMeta::blitBeginScreen(winSize, scaleIsSpecial);
         //GLMeta::blitSource(screen.getPP().frontBuffer(), scaleIsSpecial);
 
@@ -1107,6 +2313,8 @@ struct GraphicsPrivate {
         
         GLMeta::blitEnd();
         
+        gpuTimers.end(GpuTimers::PhPresent);
+        
         swapGLBuffer();
         
         updateAvgFPS();
@@ -1164,7 +2372,9 @@ struct GraphicsPrivate {
 
 Graphics::Graphics(RGSSThreadData *data) {
     p = new GraphicsPrivate(data);
-    if (data->config.syncToRefreshrate) {
+    if (data->config.headless) {
+        p->fpsLimiter.disabled = true;
+    } else if (data->config.syncToRefreshrate) {
         p->frameRate = data->refreshRate;
         p->fpsLimiter.disabled = true;
     } else if (data->config.fixedFramerate > 0) {
@@ -1185,18 +2395,119 @@ double Graphics::lastUpdate() {
 }
 
 void Graphics::update(bool checkForShutdown) {
+    ZONE_SCOPED("Graphics::update");
+
+    /* Per-frame scratch rewinds here; nothing from last frame may
+     * still reference it */
+    frameArena().reset();
+
     p->threadData->rqWindowAdjust.wait();
-    p->last_update = shState->runTime();
-    
-    // update Input.repeat timing, rounding the framerate to the nearest 2
+
     {
-        static const double mult = 2.0;
-        double afr = std::abs(averageFrameRate()); // abs shouldn't be necessary but that's ok
-        afr += mult / 2;
-        afr -= std::fmod(afr, mult);
-        shState->input().recalcRepeat(std::floor(afr));
+        const double prev = p->last_update;
+        p->last_update = shState->runTime();
+
+        /* HUD inputs: whole-frame time, and the stretch spent
+         * outside update() (scripts, input, audio calls) */
+        if (prev > 0)
+            p->frameMs = (p->last_update - prev) * 1000.0;
+        if (p->updateEndAt > 0)
+            p->scriptMs = (p->last_update - p->updateEndAt) * 1000.0;
+
+        /* Frame budget alert: a frame far past its period gets one
+         * structured, attributed line - the spikes the averaged fps
+         * hides. GPU numbers are the last measured frame's */
+        {
+            const double budgetMs = 1500.0 / p->frameRate;
+
+            if (p->frameMs > budgetMs &&
+                !p->threadData->throttleBackground &&
+                p->last_update - p->lastAlertAt > 0.5)
+            {
+                p->lastAlertAt = p->last_update;
+
+                const double comp =
+                        p->gpuTimers.resultMs[GraphicsPrivate::GpuTimers::PhComposite];
+                const double pres =
+                        p->gpuTimers.resultMs[GraphicsPrivate::GpuTimers::PhPresent];
+                const double gpuSum = comp + pres;
+                const double other = p->frameMs - p->scriptMs - gpuSum;
+
+                const char *worst = "script";
+                double worstMs = p->scriptMs;
+                if (comp > worstMs) { worst = "gpu-composite"; worstMs = comp; }
+                if (pres > worstMs) { worst = "gpu-present"; worstMs = pres; }
+                if (other > worstMs) { worst = "engine"; worstMs = other; }
+
+                char buf[384];
+                snprintf(buf, sizeof(buf),
+                         "frame-budget {\"ms\":%.2f,\"budget\":%.2f,"
+                         "\"worst\":\"%s\",\"worst_ms\":%.2f,"
+                         "\"script_ms\":%.2f,\"gpu_composite_ms\":%.2f,"
+                         "\"gpu_present_ms\":%.2f,\"elements\":%llu,"
+                         "\"draws\":%llu,\"quads\":%llu,\"tex_binds\":%llu}",
+                         p->frameMs, budgetMs, worst, worstMs,
+                         p->scriptMs, comp, pres,
+                         (unsigned long long) sceneCompositeStats.elements,
+                         (unsigned long long) sceneCompositeStats.drawCalls,
+                         (unsigned long long) sceneCompositeStats.quads,
+                         (unsigned long long) sceneCompositeStats.texBinds);
+                Debug() << buf;
+            }
+        }
+
+        /* Per-frame time log for the replay perf harness */
+        if (!p->frameLogTried && !shState->config().frameTimeLog.empty())
+        {
+            p->frameLogTried = true;
+            p->frameLog =
+                    fopen(shState->config().frameTimeLog.c_str(), "wb");
+        }
+        if (p->frameLog && prev > 0)
+        {
+            fprintf(p->frameLog, "%.3f\n", p->frameMs);
+
+            /* The harness ends the run with a signal; don't let the
+             * tail sit in stdio buffers */
+            if ((++p->frameLogLines & 63) == 0)
+                fflush(p->frameLog);
+        }
     }
-    
+
+    /* Development file watcher; no-op unless enabled */
+    if (shState->config().devFileWatch)
+        shState->fileSystem().processFileChanges();
+
+    /* Deliver coalesced Tone/Rect change signals; no-op
+     * unless deferred notification is configured */
+    ChangeNotify::flushDeferred();
+
+    /* Title-screen glyph warmup; no-op once drained */
+    shState->fontState().glyphWarmupStep();
+
+    /* Advance the glyph atlas LRU clock */
+    shState->fontState().glyphAtlas().nextFrame();
+
+    /* Coordinated cache pressure, throttled to ~once a second */
+    if ((p->frameCount & 63) == 0)
+        shState->checkMemoryPressure();
+
+    /* Flight recorder tick (no-op unless configured) */
+    if (shState->config().flightRecorder)
+    {
+        if (!p->flightRecInit)
+        {
+            p->flightRecInit = true;
+            if (!shState->config().customDataPath.empty())
+                p->flightRec.open(shState->config().customDataPath +
+                                  "/flightrec.bin");
+        }
+        p->flightRec.frame(shState->runTime());
+    }
+
+    /* Input repeat is time based now; no more per-frame
+     * framerate estimation to feed it */
+
     if (checkForShutdown)
         p->checkShutDownReset();
     
@@ -1213,7 +2524,9 @@ void Graphics::update(bool checkForShutdown) {
     
     if (p->fpsLimiter.frameSkipRequired()) {
         if (p->useFrameSkip) {
-            /* Skip frame */
+            /* Skip frame; the limiter's adaptive math folds any
+             * still-pending pacing delay into this one */
+            p->delayPending = false;
             p->fpsLimiter.delay();
             ++p->frameCount;
             p->threadData->ethread->notifyFrame();
@@ -1226,7 +2539,51 @@ void Graphics::update(bool checkForShutdown) {
     }
     
     p->checkResize();
-    p->redrawScreen();
+
+    if (p->interpSubFrames > 1)
+    {
+        /* Fixed timestep: one logic tick, several presents
+         * with sprite transforms blended between the
+         * previous and the current tick */
+        for (int k = 1; k <= p->interpSubFrames; ++k)
+        {
+            Sprite::applyInterp((float) k / p->interpSubFrames);
+            p->sceneDirty = true;
+            p->redrawScreen();
+        }
+
+        /* frame_count is a logic-tick counter for scripts;
+         * undo the per-present increments beyond the first */
+        p->frameCount -= p->interpSubFrames - 1;
+
+        Sprite::captureInterp();
+    }
+    else
+    {
+        p->redrawScreen();
+    }
+
+    /* Background throttle: hold around 5fps, sleeping in
+     * small slices so regaining focus wakes the loop within
+     * ten milliseconds. The texture cache is dropped on the
+     * way into the background */
+    if (p->threadData->throttleBackground)
+    {
+        if (!p->wasThrottled)
+        {
+            shState->texPool().purge();
+            p->wasThrottled = true;
+        }
+
+        for (int i = 0; i < 20 && p->threadData->throttleBackground; ++i)
+            SDL_Delay(10);
+    }
+    else
+    {
+        p->wasThrottled = false;
+    }
+
+    p->updateEndAt = shState->runTime();
 }
 
 void Graphics::freeze() {
@@ -1235,21 +2592,34 @@ void Graphics::freeze() {
     p->checkShutDownReset();
     p->checkResize();
     
-    /* Capture scene into frozen buffer */
-    p->compositeToBuffer(p->frozenScene);
+    /* Compose the current scene into the front buffer; the
+     * actual copy into the frozen buffer is deferred until the
+     * frozen image is really sampled */
+    p->screen.composite();
+    p->frozenSceneValid = false;
 }
 
 void Graphics::transition(int duration, const char *filename, int vague) {
     p->checkSyncLock();
-    
+
     if (!p->frozen)
         return;
+
+    /* The new scene is composited below without passing
+     * through update(); deliver pending change signals so
+     * its consumers aren't stale */
+    ChangeNotify::flushDeferred();
     
     vague = clamp(vague, 1, 256);
-    Bitmap *transMap = *filename ? new Bitmap(filename) : 0;
+    /* Cached across transitions; owned by the cache */
+    Bitmap *transMap = *filename ? p->requestTransMap(filename) : 0;
     
     setBrightness(255);
     
+    /* Materialize the frozen image before the new scene
+     * overwrites the front buffer */
+    p->ensureFrozenScene();
+    
     /* Capture new scene */
     p->screen.composite();
     
@@ -1297,19 +2667,18 @@ void Graphics::transition(int duration, const char *filename, int vague) {
          * shutdown/reset here */
         if (p->threadData->rqTerm) {
             glState.blend.pop();
-            delete transMap;
             p->shutdown();
             return;
         }
         
         if (p->threadData->rqReset) {
             glState.blend.pop();
-            delete transMap;
             scriptBinding->reset();
             return;
         }
         
         p->checkSyncLock();
+        p->frameDelay();
         
         const float prog = i * (1.0f / duration);
         
@@ -1321,6 +2690,9 @@ void Graphics::transition(int duration, const char *filename, int vague) {
             simpleShader.setProg(prog);
         }
         
+        p->gpuTimers.beginFrame();
+        p->gpuTimers.begin(GraphicsPrivate::GpuTimers::PhTransition);
+        
         /* Draw the composed frame to a buffer first
          * (we need this because we're skipping PingPong) */
         FBO::bind(transBuffer.fbo);
@@ -1340,6 +2712,8 @@ void Graphics::transition(int duration, const char *filename, int vague) {
         p->metaBlitBufferFlippedScaled(scaleIsSpecial);
         GLMeta::blitEnd();
         
+        p->gpuTimers.end(GraphicsPrivate::GpuTimers::PhTransition);
+        
         p->swapGLBuffer();
         /* Call this manually, as redrawScreen() is not called during this loop. */
         p->updateAvgFPS();
@@ -1347,9 +2721,8 @@ void Graphics::transition(int duration, const char *filename, int vague) {
     
     glState.blend.pop();
     
-    delete transMap;
-    
     p->frozen = false;
+    p->sceneDirty = true;
 }
 
 void Graphics::frameReset() {p->fpsLimiter.resetFrameAdjust();}
@@ -1368,15 +2741,26 @@ void Graphics::setFrameRate(int value) {
     
     if (p->threadData->config.fixedFramerate > 0)
         return;
-    
-    p->fpsLimiter.setDesiredFPS(p->frameRate);
-    //shState->input().recalcRepeat((unsigned int)p->frameRate);
+
+    p->recalcSubFrames();
 }
 
 double Graphics::averageFrameRate() {
     return p->averageFPS();
 }
 
+bool Graphics::gpuStats(double &compositeMs, double &presentMs,
+                        double &transitionMs) {
+    if (!gl.timer_query)
+        return false;
+
+    compositeMs = p->gpuTimers.resultMs[GraphicsPrivate::GpuTimers::PhComposite];
+    presentMs = p->gpuTimers.resultMs[GraphicsPrivate::GpuTimers::PhPresent];
+    transitionMs = p->gpuTimers.resultMs[GraphicsPrivate::GpuTimers::PhTransition];
+
+    return true;
+}
+
 void Graphics::wait(int duration) {
     for (int i = 0; i < duration; ++i) {
         p->checkShutDownReset();
@@ -1394,6 +2778,9 @@ void Graphics::fadeout(int duration) {
         setBrightness(diff + (curr / duration) * i);
         
         if (p->frozen) {
+            p->frameDelay();
+            p->ensureFrozenScene();
+            
             int scaleIsSpecial = GLMeta::blitScaleIsSpecial(p->integerScaleBuffer, false, IntRect(0, 0, p->scSize.x, p->scSize.y), p->frozenScene, IntRect(0, 0, p->scRes.x, p->scRes.y));
 
             GLMeta::blitBeginScreen(p->scSize, scaleIsSpecial);
@@ -1421,6 +2808,9 @@ void Graphics::fadein(int duration) {
         setBrightness(curr + (diff / duration) * i);
         
         if (p->frozen) {
+            p->frameDelay();
+            p->ensureFrozenScene();
+            
             int scaleIsSpecial = GLMeta::blitScaleIsSpecial(p->integerScaleBuffer, false, IntRect(0, 0, p->scSize.x, p->scSize.y), p->frozenScene, IntRect(0, 0, p->scRes.x, p->scRes.y));
 
             GLMeta::blitBeginScreen(p->scSize, scaleIsSpecial);
@@ -1439,6 +2829,9 @@ void Graphics::fadein(int duration) {
 }
 
 Bitmap *Graphics::snapToBitmap() {
+    if (p->frozen)
+        p->ensureFrozenScene();
+
     p->screen.composite();
 
     if (shState->config().enableHires) {
@@ -1505,6 +2898,7 @@ void Graphics::resizeScreen(int width, int height) {
     
     p->scRes = size;
     p->scResLores = sizeLores;
+    p->sceneDirty = true;
     
     p->screen.setResolution(width, height);
     
@@ -1539,17 +2933,95 @@ bool Graphics::updateMovieInput(Movie *movie) {
     return  p->threadData->rqTerm || p->threadData->rqReset;
 }
 
-void Graphics::playMovie(const char *filename, int volume_, bool skippable) {
+void Graphics::preloadMovie(const char *filename) {
+    /* A preload that never got played is stale */
+    delete p->preloadedMovie;
+    p->preloadedMovie = 0;
+
+    /* Warm the IO layer too, so playback reads past the
+     * prebuffered window don't hit a cold archive */
+    shState->fileSystem().prefetch(filename);
+
+    Movie *movie = new Movie(false);
+    movie->indexCachePath = movieIndexCachePath(filename);
+    movie->loadSubtitles(filename);
+    MovieOpenHandler handler(movie->srcOps);
+
+    try {
+        shState->fileSystem().openRead(handler, filename);
+    } catch (...) {
+        delete movie;
+        throw;
+    }
+
+    /* This opens the decoder and blocks until the first frames
+     * are buffered; the decode threads then fill up to the frame
+     * cap and hold there until play() starts draining */
+    if (!movie->preparePlayback()) {
+        delete movie;
+        return;
+    }
+
+    p->preloadedMovie = movie;
+    p->preloadedMovieName = filename;
+}
+
+void Graphics::playMovie(const char *filename, int volume_, bool skippable,
+                         unsigned int startMs) {
     if (shState->config().enableHires) {
         Debug() << "BUG: High-res Graphics playMovie not implemented";
     }
 
-    Movie *movie = new Movie(skippable);
-    MovieOpenHandler handler(movie->srcOps);
-    shState->fileSystem().openRead(handler, filename);
+    Movie *movie = 0;
+
+    if (p->preloadedMovie && p->preloadedMovieName == filename) {
+        /* Already open and prebuffered; playback can start on the
+         * next frame */
+        movie = p->preloadedMovie;
+        p->preloadedMovie = 0;
+        movie->skippable = skippable;
+
+        /* The preload buffered from the beginning; jump it to the
+         * requested chapter (the cached index makes this cheap) and
+         * drop the pre-seek frames it was holding */
+        if (startMs) {
+            movie->startOffsetMs = startMs;
+            if (movie->video) {
+                THEORAPLAY_freeVideo(movie->video);
+                movie->video = NULL;
+            }
+            if (movie->audio) {
+                THEORAPLAY_freeAudio(movie->audio);
+                movie->audio = NULL;
+            }
+            THEORAPLAY_seek(movie->decoder, startMs);
+        }
+    } else {
+        delete p->preloadedMovie;
+        p->preloadedMovie = 0;
+
+        movie = new Movie(skippable);
+        movie->indexCachePath = movieIndexCachePath(filename);
+        movie->loadSubtitles(filename);
+        movie->startOffsetMs = startMs;
+        MovieOpenHandler handler(movie->srcOps);
+
+        try {
+            shState->fileSystem().openRead(handler, filename);
+        } catch (...) {
+            delete movie;
+            throw;
+        }
+
+        if (!movie->preparePlayback()) {
+            delete movie;
+            return;
+        }
+    }
+
     float volume = volume_ * 0.01f;
-    
-    if (movie->preparePlayback()) {        
+
+    {
         Sprite movieSprite;
         
         // Currently this stretches to fit the screen. VX Ace behavior is to center it and let the edges run off
@@ -1570,14 +3042,84 @@ void Graphics::playMovie(const char *filename, int volume_, bool skippable) {
         
         movie->play(volume);
     }
-    
+
+    /* Fold in the decoder-side numbers and publish the run */
+    {
+        THEORAPLAY_VideoStats ds;
+        THEORAPLAY_videoStats(movie->decoder, &ds);
+        movie->stats.decodedFrames = ds.frames;
+        if (ds.frames > 0)
+            movie->stats.decodeAvgMs = ds.decodeMsTotal / ds.frames;
+        movie->stats.decodeMaxMs = ds.decodeMsMax;
+        p->movieStats = movie->stats;
+        p->movieStats.valid = true;
+    }
+
     delete movie;
 }
 
+void Graphics::frameTimes(double &frameMs, double &scriptMs)
+{
+    frameMs = p->frameMs;
+    scriptMs = p->scriptMs;
+}
+
+void Graphics::vramStats(size_t &totalBytes, unsigned &textures,
+                         size_t &texPoolBytes, size_t &glyphBytes,
+                         size_t &bitmapBytes)
+{
+    totalBytes = VramStats::totalBytes();
+    textures = VramStats::textureCount();
+    texPoolBytes = shState->texPool().stats().cachedBytes;
+    glyphBytes = shState->fontState().glyphAtlas().stats().bytes;
+
+    const size_t managed = texPoolBytes + glyphBytes;
+    bitmapBytes = totalBytes > managed ? totalBytes - managed : 0;
+}
+
+void Graphics::setPerfHud(bool enabled)
+{
+    p->hudEnabled = enabled;
+}
+
+bool Graphics::getPerfHud() const
+{
+    return p->hudEnabled;
+}
+
+bool Graphics::movieStats(int &presented, int &dropped, int &repeated,
+                          int &decoded,
+                          double &decodeAvgMs, double &decodeMaxMs,
+                          double &uploadAvgMs, double &uploadMaxMs,
+                          double &presentAvgMs, double &presentMaxMs)
+{
+    const MovieStats &s = p->movieStats;
+
+    if (!s.valid)
+        return false;
+
+    presented = s.presented;
+    dropped = s.dropped;
+    repeated = s.repeated;
+    decoded = (int) s.decodedFrames;
+    decodeAvgMs = s.decodeAvgMs;
+    decodeMaxMs = s.decodeMaxMs;
+    uploadAvgMs = s.uploadAvgMs;
+    uploadMaxMs = s.uploadMaxMs;
+    presentAvgMs = s.presentAvgMs;
+    presentMaxMs = s.presentMaxMs;
+
+    return true;
+}
+
 void Graphics::screenshot(const char *filename) {
     p->threadData->rqWindowAdjust.wait();
     Bitmap *ss = snapToBitmap();
-    ss->saveToFile(filename);
+    /* Kick off the GPU->PBO copy first, then hand encoding and
+     * disk I/O to the background save worker; only the readback
+     * completion is waited for here, not the encode */
+    ss->queueRawReadback();
+    ss->saveToFileAsync(filename);
     ss->dispose();
     delete ss;
 }
@@ -1592,6 +3134,7 @@ void Graphics::setBrightness(int value) {
     
     p->brightness = value;
     p->screen.setBrightness(value / 255.0);
+    p->sceneDirty = true;
 }
 
 void Graphics::reset() {
@@ -1602,9 +3145,17 @@ void Graphics::reset() {
          iter = iter->next) {
         iter->data->dispose();
     }
-    
-    p->dispList.clear();
-    
+
+    /* The objects themselves are still alive (disposed, not
+     * destroyed) and unregister one by one from their dtors;
+     * clearing here would orphan their links and skew the
+     * registered count negative */
+
+    /* A preloaded movie's bitmap was just disposed with the
+     * rest, so the preload can't be played anymore */
+    delete p->preloadedMovie;
+    p->preloadedMovie = 0;
+
     /* Reset attributes (frame count not included) */
     p->fpsLimiter.resetFrameAdjust();
     p->frozen = false;
@@ -1670,6 +3221,7 @@ int Graphics::getSmoothScaling() const
 void Graphics::setSmoothScaling(int value)
 {
     shState->config().smoothScaling = value;
+    p->presentCacheValid = false;
 }
 
 bool Graphics::getIntegerScaling() const
@@ -1737,7 +3289,11 @@ Scene *Graphics::getScreen() const { return &p->screen; }
 void Graphics::repaintWait(const AtomicFlag &exitCond, bool checkReset) {
     if (exitCond)
         return;
-    
+
+    /* This loop paces itself; a deferred delay from the last
+     * regular frame must not fire after we leave it */
+    p->delayPending = false;
+
     /* Repaint the screen with the last good frame we drew */
     TEXFBO &lastFrame = p->screen.getPP().frontBuffer();
 
@@ -1764,15 +3320,43 @@ void Graphics::repaintWait(const AtomicFlag &exitCond, bool checkReset) {
 }
 
 void Graphics::lock(bool force) {
+    /* Every mutating binding operation passes through here;
+     * treat it as potential scene damage */
+    p->sceneDirty = true;
+
     p->setLock(force);
 }
 
+/* The update call itself is not damage: a frame where only
+ * Graphics.update ran keeps the previous composition, letting
+ * the skip/present-cache paths actually fire on idle scenes */
+void Graphics::lockClean(bool force) {
+    p->setLock(force);
+}
+
+void Graphics::markSceneDirty() {
+    p->sceneDirty = true;
+}
+
+void Graphics::animatedPlaying(int delta) {
+    p->animatedPlayingCount += delta;
+
+    if (p->animatedPlayingCount < 0)
+        p->animatedPlayingCount = 0;
+}
+
 void Graphics::unlock(bool force) {
     p->releaseLock(force);
 }
 
+/* The registry is an intrusive list confined to the script
+ * thread: Disposables are Ruby-object backed, so creation,
+ * destruction and the reset() scan all run there. O(1) link
+ * splicing with no lock to contend on */
 void Graphics::addDisposable(Disposable *d) { p->dispList.append(d->link); }
 
 void Graphics::remDisposable(Disposable *d) { p->dispList.remove(d->link); }
 
+int Graphics::disposableCount() const { return p->dispList.getSize(); }
+
 #undef GRAPHICS_THREAD_LOCK
@@ -69,7 +69,11 @@ public:
     void resizeWindow(int width, int height, bool center=false);
 	void drawMovieFrame(const THEORAPLAY_VideoFrame* video, Bitmap *videoBitmap);
 	bool updateMovieInput(Movie *movie);
-	void playMovie(const char *filename, int volume, bool skippable);
+	void playMovie(const char *filename, int volume, bool skippable,
+	               unsigned int startMs = 0);
+	/* Opens and prebuffers a movie ahead of time, so the next
+	 * playMovie call with the same path starts instantly */
+	void preloadMovie(const char *filename);
 	void screenshot(const char *filename);
 
 	void reset();
@@ -87,6 +91,36 @@ public:
     DECL_ATTR( Threadsafe, bool )
     double averageFrameRate();
 
+	/* Last frame's whole-frame and outside-update (script) times,
+	 * as measured for the perf HUD */
+	void frameTimes(double &frameMs, double &scriptMs);
+
+	/* GPU texture accounting (Graphics.vram_stats) */
+	void vramStats(size_t &totalBytes, unsigned &textures,
+	               size_t &texPoolBytes, size_t &glyphBytes,
+	               size_t &bitmapBytes);
+
+	/* Live (not yet destroyed) disposables
+	 * (Graphics.disposable_count); script thread only */
+	int disposableCount() const;
+
+	/* Perf HUD overlay toggle (Graphics.perf_hud) */
+	void setPerfHud(bool enabled);
+	bool getPerfHud() const;
+
+	/* Numbers from the last playMovie run (Graphics.movie_stats);
+	 * false while no movie has played yet */
+	bool movieStats(int &presented, int &dropped, int &repeated,
+	                int &decoded,
+	                double &decodeAvgMs, double &decodeMaxMs,
+	                double &uploadAvgMs, double &uploadMaxMs,
+	                double &presentAvgMs, double &presentMaxMs);
+
+    /* GPU time of the last measured frame, per phase, in
+     * milliseconds. Returns false without timer query support */
+    bool gpuStats(double &compositeMs, double &presentMs,
+                  double &transitionMs);
+
 	/* <internal> */
 	Scene *getScreen() const;
 	/* Repaint screen with static image until exitCond
@@ -94,10 +128,24 @@ public:
 	 * if "checkReset" */
 	void repaintWait(const AtomicFlag &exitCond,
 	                 bool checkReset = true);
+
+	/* Damage tracking: anything that might change the composed
+	 * scene marks it dirty; unchanged frames re-present the
+	 * previous screen buffer instead of recompositing */
+	void markSceneDirty();
+
+	/* Bitmaps with a playing frame animation force continuous
+	 * redraws while any of them is live */
+	void animatedPlaying(int delta);
     
     void lock(bool force = false);
     void unlock(bool force = false);
 
+    /* lock() flags potential scene damage; the per-frame update
+     * entry point uses this variant so a mutation-free frame can
+     * skip recomposition */
+    void lockClean(bool force = false);
+
 private:
 	Graphics(RGSSThreadData *data);
 	~Graphics();
@@ -112,6 +160,7 @@ private:
 };
 
 #define GFX_LOCK shState->graphics().lock()
+#define GFX_LOCK_CLEAN shState->graphics().lockClean()
 #define GFX_UNLOCK shState->graphics().unlock()
 
 #endif // GRAPHICS_H
@@ -34,7 +34,7 @@
 #include "shader.h"
 #include "glstate.h"
 
-#include "sigslot/signal.hpp"
+#include "flatsignal.h"
 
 static float fwrap(float value, float range)
 {
@@ -46,7 +46,7 @@ struct PlanePrivate
 {
 	Bitmap *bitmap;
 
-	sigslot::connection bitmapDispCon;
+	FlatConnection bitmapDispCon;
 
 	NormValue opacity;
 	BlendType blendType;
@@ -64,7 +64,7 @@ struct PlanePrivate
 
 	EtcTemps tmp;
 
-	sigslot::connection prepareCon;
+	FlatConnection prepareCon;
 
 	PlanePrivate()
 	    : bitmap(0),
@@ -99,9 +99,11 @@ struct PlanePrivate
 	{
 		if (gl.npot_repeat)
 		{
+			/* The scroll offset rides on a shader uniform; the
+			 * quad only depends on viewport size and zoom */
 			FloatRect srcRect;
-			srcRect.x = (sceneGeo.orig.x + ox) / zoomX;
-			srcRect.y = (sceneGeo.orig.y + oy) / zoomY;
+			srcRect.x = 0;
+			srcRect.y = 0;
 			srcRect.w = sceneGeo.rect.w / zoomX;
 			srcRect.h = sceneGeo.rect.h / zoomY;
 
@@ -210,7 +212,10 @@ void Plane::setOX(int value)
 	        return;
 
 	p->ox = value;
-	p->quadSourceDirty = true;
+
+	/* With repeat sampling the scroll is a uniform, not geometry */
+	if (!gl.npot_repeat)
+		p->quadSourceDirty = true;
 }
 
 void Plane::setOY(int value)
@@ -221,7 +226,9 @@ void Plane::setOY(int value)
 	        return;
 
 	p->oy = value;
-	p->quadSourceDirty = true;
+
+	if (!gl.npot_repeat)
+		p->quadSourceDirty = true;
 }
 
 void Plane::setZoomX(float value)
@@ -281,6 +288,12 @@ void Plane::draw()
 
 	ShaderBase *base;
 
+	const Vec2 scrollOffset(
+		(p->sceneGeo.orig.x + p->ox) / p->zoomX,
+		(p->sceneGeo.orig.y + p->oy) / p->zoomY);
+
+	bool simpleUsed = false;
+
 	if (p->color->hasEffect() || p->tone->hasEffect() || p->opacity != 255)
 	{
 		PlaneShader &shader = shState->shaders().plane;
@@ -292,6 +305,9 @@ void Plane::draw()
 		shader.setFlash(Vec4());
 		shader.setOpacity(p->opacity.norm);
 
+		if (gl.npot_repeat)
+			shader.setTexOffset(scrollOffset);
+
 		base = &shader;
 	}
 	else
@@ -302,6 +318,12 @@ void Plane::draw()
 		shader.applyViewportProj();
 		shader.setTranslation(Vec2i());
 
+		if (gl.npot_repeat)
+		{
+			shader.setTexOffset(scrollOffset);
+			simpleUsed = true;
+		}
+
 		base = &shader;
 	}
 
@@ -317,6 +339,11 @@ void Plane::draw()
 	if (gl.npot_repeat)
 		TEX::setRepeat(false);
 
+	/* The simple shader is shared engine-wide; leave its
+	 * sampling offset zeroed for the next caller */
+	if (simpleUsed)
+		shState->shaders().simple.setTexOffset(Vec2());
+
 	glState.blendMode.pop();
 }
 
@@ -0,0 +1,222 @@
+/*
+** sdfatlas.cpp
+**
+** This file is part of mkxp.
+**
+** Copyright (C) 2013 - 2021 Amaryllis Kulla <ancurio@mapleshrine.eu>
+**
+** mkxp is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 2 of the License, or
+** (at your option) any later version.
+**
+** mkxp is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with mkxp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "sdfatlas.h"
+
+#include <SDL_ttf.h>
+#include <SDL_surface.h>
+
+#include "gl-fun.h"
+#include "glstate.h"
+
+#include <algorithm>
+#include <math.h>
+
+/* Gap between packed fields so sampling never bleeds across */
+#define SDF_PAD 1
+
+void sdfBuildDistanceField(const uint8_t *mask, int w, int h,
+                           int spread, uint8_t *out)
+{
+	const int pw = w + 2 * spread;
+	const int ph = h + 2 * spread;
+
+	for (int py = 0; py < ph; py++)
+	{
+		for (int px = 0; px < pw; px++)
+		{
+			const int gx = px - spread;
+			const int gy = py - spread;
+			const bool inside = (gx >= 0 && gy >= 0 && gx < w && gy < h &&
+			                     mask[gy * w + gx] != 0);
+
+			/* Nearest opposite-state texel inside the spread
+			 * window; everything farther clamps to the radius */
+			int best = spread * spread + 1;
+
+			for (int oy = -spread; oy <= spread; oy++)
+			{
+				for (int ox = -spread; ox <= spread; ox++)
+				{
+					const int nx = gx + ox;
+					const int ny = gy + oy;
+					const bool nin = (nx >= 0 && ny >= 0 &&
+					                  nx < w && ny < h &&
+					                  mask[ny * w + nx] != 0);
+
+					if (nin == inside)
+						continue;
+
+					const int d2 = ox * ox + oy * oy;
+					if (d2 < best)
+						best = d2;
+				}
+			}
+
+			float dist = sqrtf((float) best);
+			if (dist > spread)
+				dist = (float) spread;
+
+			const float signd = inside ? dist : -dist;
+			/* [-spread, spread] onto [0, 1], edge at 0.5 */
+			const float norm = 0.5f + signd / (2.0f * spread);
+
+			int v = (int) (norm * 255.0f + 0.5f);
+			if (v < 0) v = 0;
+			if (v > 255) v = 255;
+
+			out[py * pw + px] = (uint8_t) v;
+		}
+	}
+} // sdfBuildDistanceField
+
+SDFAtlas::SDFAtlas()
+{
+	pgSize = std::min(1024, glState.caps.maxTexSize);
+}
+
+SDFAtlas::~SDFAtlas()
+{
+	for (size_t i = 0; i < pages.size(); ++i)
+		TEX::del(pages[i].tex);
+}
+
+TEX::ID SDFAtlas::pageTex(int page) const
+{
+	return pages[page].tex;
+}
+
+int SDFAtlas::pageSize() const
+{
+	return pgSize;
+}
+
+SDFAtlas::Page &SDFAtlas::allocPage()
+{
+	Page pg;
+	pg.tex = TEX::gen();
+	pg.shelfX = 0;
+	pg.shelfY = 0;
+	pg.shelfH = 0;
+
+	TEX::bind(pg.tex);
+	gl.TexImage2D(GL_TEXTURE_2D, 0, GL_LUMINANCE, pgSize, pgSize, 0,
+	              GL_LUMINANCE, GL_UNSIGNED_BYTE, 0);
+	VramStats::onAlloc(pg.tex.gl, (size_t) pgSize * pgSize);
+	TEX::setRepeat(false);
+	/* Bilinear sampling is what makes one field serve all scales */
+	TEX::setSmooth(true);
+
+	pages.push_back(pg);
+
+	return pages.back();
+}
+
+const SDFAtlas::Glyph *SDFAtlas::request(TTF_Font *font, uint8_t style,
+                                         uint16_t cp)
+{
+	Key key = { font, cp, style };
+
+	if (glyphs.contains(key))
+		return &glyphs[key];
+
+	int minX, maxX, minY, maxY, advance;
+	if (TTF_GlyphMetrics(font, cp, &minX, &maxX, &minY, &maxY, &advance) != 0)
+		return 0;
+
+	SDL_Color white = { 255, 255, 255, 255 };
+	SDL_Surface *surf = TTF_RenderGlyph_Blended(font, cp, white);
+
+	if (!surf)
+		return 0;
+
+	if (surf->format->format != SDL_PIXELFORMAT_ABGR8888)
+	{
+		SDL_Surface *conv = SDL_ConvertSurfaceFormat(surf, SDL_PIXELFORMAT_ABGR8888, 0);
+		SDL_FreeSurface(surf);
+
+		if (!conv)
+			return 0;
+
+		surf = conv;
+	}
+
+	const int w = surf->w;
+	const int h = surf->h;
+	const int pw = w + 2 * Spread;
+	const int ph = h + 2 * Spread;
+
+	if (pw > pgSize || ph > pgSize)
+	{
+		SDL_FreeSurface(surf);
+		return 0;
+	}
+
+	/* Coverage mask from the alpha channel */
+	std::vector<uint8_t> mask((size_t) w * h);
+	for (int y = 0; y < h; y++)
+	{
+		const uint32_t *row = (const uint32_t *)
+		        ((const uint8_t *) surf->pixels + y * surf->pitch);
+		for (int x = 0; x < w; x++)
+			mask[(size_t) y * w + x] = ((row[x] >> 24) >= 128) ? 1 : 0;
+	}
+
+	SDL_FreeSurface(surf);
+
+	std::vector<uint8_t> field((size_t) pw * ph);
+	sdfBuildDistanceField(mask.data(), w, h, Spread, field.data());
+
+	/* Shelf packing, same scheme as the coverage atlas */
+	if (pages.empty())
+		allocPage();
+
+	Page *pg = &pages.back();
+
+	if (pg->shelfX + pw + SDF_PAD > pgSize)
+	{
+		pg->shelfY += pg->shelfH;
+		pg->shelfX = 0;
+		pg->shelfH = 0;
+	}
+
+	if (pg->shelfY + ph + SDF_PAD > pgSize)
+		pg = &allocPage();
+
+	Glyph g;
+	g.page = (int) pages.size() - 1;
+	g.rect = IntRect(pg->shelfX, pg->shelfY, pw, ph);
+	g.minX = minX;
+	g.advance = advance;
+
+	TEX::bind(pg->tex);
+	gl.PixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	gl.TexSubImage2D(GL_TEXTURE_2D, 0, g.rect.x, g.rect.y, pw, ph,
+	                 GL_LUMINANCE, GL_UNSIGNED_BYTE, field.data());
+	gl.PixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+	pg->shelfX += pw + SDF_PAD;
+	pg->shelfH = std::max(pg->shelfH, ph + SDF_PAD);
+
+	glyphs.insert(key, g);
+
+	return &glyphs[key];
+}
@@ -0,0 +1,102 @@
+/*
+** sdfatlas.h
+**
+** This file is part of mkxp.
+**
+** Copyright (C) 2013 - 2021 Amaryllis Kulla <ancurio@mapleshrine.eu>
+**
+** mkxp is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 2 of the License, or
+** (at your option) any later version.
+**
+** mkxp is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with mkxp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SDFATLAS_H
+#define SDFATLAS_H
+
+#include "etc-internal.h"
+#include "gl-util.h"
+#include "boost-hash.h"
+
+#include <stdint.h>
+#include <vector>
+
+typedef struct _TTF_Font TTF_Font;
+
+/* Signed-distance-field glyph cache (Font#sdf). Each glyph is
+ * rasterized once per face/style at a fixed base size, converted to
+ * a distance field and shelf-packed into single-channel pages; the
+ * SDF text path then serves every requested font size from the same
+ * texels, with the edge reconstructed in the fragment shader
+ * (sdfGlyph.frag) - so resizes never re-rasterize */
+class SDFAtlas
+{
+public:
+	/* Base rasterization size and field spread, in pixels */
+	enum { BasePx = 48, Spread = 6 };
+
+	SDFAtlas();
+	~SDFAtlas();
+
+	struct Glyph
+	{
+		int page;
+		IntRect rect;   /* padded by Spread on every side */
+		int minX;       /* base-size horizontal bearing */
+		int advance;    /* base-size advance */
+	};
+
+	/* 'font' must be the face opened at BasePx with the style
+	 * already applied (Font::getSdlFontAt). Returns 0 when the
+	 * glyph cannot be rasterized */
+	const Glyph *request(TTF_Font *font, uint8_t style, uint16_t cp);
+
+	TEX::ID pageTex(int page) const;
+	int pageSize() const;
+
+private:
+	struct Key
+	{
+		TTF_Font *font;
+		uint16_t cp;
+		uint8_t style;
+
+		bool operator<(const Key &o) const
+		{
+			if (font != o.font)
+				return font < o.font;
+			if (cp != o.cp)
+				return cp < o.cp;
+			return style < o.style;
+		}
+	};
+
+	struct Page
+	{
+		TEX::ID tex;
+		int shelfX, shelfY, shelfH;
+	};
+
+	Page &allocPage();
+
+	BoostHash<Key, Glyph> glyphs;
+	std::vector<Page> pages;
+	int pgSize;
+};
+
+/* The distance math itself, kept free-standing: 'mask' is w*h
+ * coverage (nonzero = inside), 'out' receives (w + 2*spread) x
+ * (h + 2*spread) texels with the edge at 128, inside above it,
+ * saturating at the spread radius */
+void sdfBuildDistanceField(const uint8_t *mask, int w, int h,
+                           int spread, uint8_t *out);
+
+#endif // SDFATLAS_H
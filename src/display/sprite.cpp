@@ -37,25 +37,37 @@
 #include "quadarray.h"
 
 #include <math.h>
+#include <algorithm>
 #ifndef M_PI
 # define M_PI 3.14159265358979323846
 #endif
 
 #include <SDL_rect.h>
 
-#include "sigslot/signal.hpp"
+#include "flatsignal.h"
+
+/* ---- Decoupled render interpolation ----
+ *
+ * In fixed-timestep mode the screen presents several times
+ * per logic tick; sprites keep the previous tick's transform
+ * and blend towards the live one for the in-between frames.
+ * Graphics drives both signals: apply per sub-frame, capture
+ * once at the end of each logic tick */
+static FlatSignal spriteInterpApplySig;
+static FlatSignal spriteInterpCaptureSig;
+static float spriteInterpAlpha = 1.0f;
 
 struct SpritePrivate
 {
     Bitmap *bitmap;
     
-    sigslot::connection bitmapDispCon;
+    FlatConnection bitmapDispCon;
     
     Quad quad;
     Transform trans;
     
     Rect *srcRect;
-    sigslot::connection srcRectCon;
+    FlatConnection srcRectCon;
     
     bool mirrored;
     int bushDepth;
@@ -98,8 +110,18 @@ struct SpritePrivate
     } wave;
     
     EtcTemps tmp;
-    
-    sigslot::connection prepareCon;
+
+    FlatConnection prepareCon;
+
+    /* Decoupled render interpolation state */
+    FlatConnection interpApplyCon;
+    FlatConnection interpCaptureCon;
+    Vec2 prevPos, prevScale;
+    float prevRot;
+    Vec2 heldPos, heldScale;
+    float heldRot;
+    bool interpValid;
+    bool interpHeld;
     
     SpritePrivate()
     : bitmap(0),
@@ -134,15 +156,73 @@ struct SpritePrivate
         wave.speed = 360;
         wave.phase = 0.0f;
         wave.dirty = false;
+
+        prevRot = heldRot = 0;
+        interpValid = false;
+        interpHeld = false;
+
+        interpApplyCon = spriteInterpApplySig.connect
+        (&SpritePrivate::interpApply, this);
+        interpCaptureCon = spriteInterpCaptureSig.connect
+        (&SpritePrivate::interpCapture, this);
     }
-    
+
     ~SpritePrivate()
     {
         srcRectCon.disconnect();
         prepareCon.disconnect();
-        
+        interpApplyCon.disconnect();
+        interpCaptureCon.disconnect();
+
         bitmapDisposal();
     }
+
+    /* Blend the transform towards the live values for a
+     * sub-frame; the live state is held aside and restored
+     * exactly by the final alpha = 1 application */
+    void interpApply()
+    {
+        float alpha = spriteInterpAlpha;
+
+        if (!interpHeld)
+        {
+            heldPos = trans.getPosition();
+            heldScale = trans.getScale();
+            heldRot = trans.getRotation();
+            interpHeld = true;
+        }
+
+        if (!interpValid)
+            return;
+
+        if (alpha >= 1.0f)
+        {
+            trans.setPosition(heldPos);
+            trans.setScale(heldScale);
+            trans.setRotation(heldRot);
+            interpHeld = false;
+            return;
+        }
+
+        Vec2 pos(prevPos.x + (heldPos.x - prevPos.x) * alpha,
+                 prevPos.y + (heldPos.y - prevPos.y) * alpha);
+        Vec2 scale(prevScale.x + (heldScale.x - prevScale.x) * alpha,
+                   prevScale.y + (heldScale.y - prevScale.y) * alpha);
+
+        trans.setPosition(pos);
+        trans.setScale(scale);
+        trans.setRotation(prevRot + (heldRot - prevRot) * alpha);
+    }
+
+    /* End of logic tick: live state becomes 'previous' */
+    void interpCapture()
+    {
+        prevPos = trans.getPosition();
+        prevScale = trans.getScale();
+        prevRot = trans.getRotation();
+        interpValid = true;
+        interpHeld = false;
+    }
     
     void bitmapDisposal()
     {
@@ -231,12 +311,29 @@ struct SpritePrivate
         
         /* Compare sprite bounding box against the scene */
         
-        /* If sprite is zoomed/rotated, just opt out for now
-         * for simplicity's sake */
         const Vec2 &scale = trans.getScale();
+
         if (scale.x != 1 || scale.y != 1 || trans.getRotation() != 0)
         {
-            isVisible = true;
+            /* Conservative bound for transformed sprites: a
+             * box covering the rotation circle around the
+             * origin point */
+            float dx = std::max<float>(trans.getOriginI().x,
+                                       bitmap->width() - trans.getOriginI().x) * fabs(scale.x);
+            float dy = std::max<float>(trans.getOriginI().y,
+                                       bitmap->height() - trans.getOriginI().y) * fabs(scale.y);
+            int radius = (int) sqrt(dx*dx + dy*dy) + 1;
+
+            const Vec2i pos = trans.getPositionI() - sceneOrig;
+
+            IntRect self(pos.x - radius, pos.y - radius,
+                         radius * 2, radius * 2);
+
+            isVisible = SDL_HasIntersection(&self, &sceneRect);
+
+            if (!isVisible)
+                ++sceneCulledCount;
+
             return;
         }
         
@@ -246,17 +343,19 @@ struct SpritePrivate
         self.h = bitmap->height();
         
         isVisible = SDL_HasIntersection(&self, &sceneRect);
+
+        if (!isVisible)
+            ++sceneCulledCount;
     }
     
-    void emitWaveChunk(SVertex *&vert, float phase, int width,
+    void emitWaveChunk(SVertex *&vert, int width,
                        float zoomY, int chunkY, int chunkLength)
     {
-        float wavePos = phase + (chunkY / (float) wave.length) * (float) (M_PI * 2);
-        float chunkX = sin(wavePos) * wave.amp;
-        
+        /* The strips are static; the actual sine displacement
+         * happens in sprite.vert, driven off the strip's texel
+         * row, so phase animation never re-chops or re-uploads */
         FloatRect tex(0, chunkY / zoomY, width, chunkLength / zoomY);
         FloatRect pos = tex;
-        pos.x = chunkX;
         
         Quad::setTexPosRect(vert, mirrored ? tex.hFlipped() : tex, pos);
         vert += 4;
@@ -318,16 +417,14 @@ struct SpritePrivate
         wave.qArray.resize(!!firstLength + chunks + !!lastLength);
         SVertex *vert = &wave.qArray.vertices[0];
         
-        float phase = (wave.phase * (float) M_PI) / 180.0f;
-        
         if (firstLength > 0)
-            emitWaveChunk(vert, phase, width, zoomY, 0, firstLength);
+            emitWaveChunk(vert, width, zoomY, 0, firstLength);
         
         for (int i = 0; i < chunks; ++i)
-            emitWaveChunk(vert, phase, width, zoomY, firstLength + i * 8, 8);
+            emitWaveChunk(vert, width, zoomY, firstLength + i * 8, 8);
         
         if (lastLength > 0)
-            emitWaveChunk(vert, phase, width, zoomY, firstLength + chunks * 8, lastLength);
+            emitWaveChunk(vert, width, zoomY, firstLength + chunks * 8, lastLength);
         
         wave.qArray.commit();
     }
@@ -483,6 +580,9 @@ void Sprite::setZoomY(float value)
     p->trans.setScale(Vec2(getZoomX(), value));
     p->recomputeBushDepth();
     
+    /* The wave strip extent spans height * zoomY */
+    p->wave.dirty = true;
+    
     if (rgssVer >= 2)
         p->wave.dirty = true;
 }
@@ -570,23 +670,37 @@ void Sprite::setPatternBlendType(int type)
     }
 }
 
-#define DEF_WAVE_SETTER(Name, name, type) \
+/* Only the amplitude shapes the strip geometry; length, speed
+ * and phase feed the vertex shader directly */
+#define DEF_WAVE_SETTER(Name, name, type, dirties) \
 void Sprite::setWave##Name(type value) \
 { \
 guardDisposed(); \
 if (p->wave.name == value) \
 return; \
 p->wave.name = value; \
+if (dirties) \
 p->wave.dirty = true; \
 }
 
-DEF_WAVE_SETTER(Amp,    amp,    int)
-DEF_WAVE_SETTER(Length, length, int)
-DEF_WAVE_SETTER(Speed,  speed,  int)
-DEF_WAVE_SETTER(Phase,  phase,  float)
+DEF_WAVE_SETTER(Amp,    amp,    int,   true)
+DEF_WAVE_SETTER(Length, length, int,   false)
+DEF_WAVE_SETTER(Speed,  speed,  int,   false)
+DEF_WAVE_SETTER(Phase,  phase,  float, false)
 
 #undef DEF_WAVE_SETTER
 
+void Sprite::applyInterp(float alpha)
+{
+    spriteInterpAlpha = alpha;
+    spriteInterpApplySig();
+}
+
+void Sprite::captureInterp()
+{
+    spriteInterpCaptureSig();
+}
+
 void Sprite::initDynAttribs()
 {
     p->srcRect = new Rect;
@@ -603,28 +717,19 @@ void Sprite::update()
     
     Flashable::update();
     
+    /* Phase animation rides on a shader uniform; only the
+     * strip geometry (amp etc.) needs a rebuild */
     p->wave.phase += p->wave.speed / 180;
-    p->wave.dirty = true;
 }
 
-/* SceneElement */
-void Sprite::draw()
+/* A sprite qualifies for the shared scene quad batch when its
+ * draw is a plain textured quad: no effects, full opacity,
+ * untransformed apart from translation, nearest filtering.
+ * batchable() and draw() must agree on this */
+/* Mirrors the scaling method selection at the top of draw();
+ * both must agree so batchable() predicts the draw path */
+int Sprite::computeScalingMethod() const
 {
-    if (!p->isVisible)
-        return;
-    
-    if (emptyFlashFlag)
-        return;
-    
-    ShaderBase *base;
-    
-    bool renderEffect = p->color->hasEffect() ||
-    p->tone->hasEffect()  ||
-    flashing              ||
-    p->bushDepth != 0     ||
-    p->invert             ||
-    (p->pattern && !p->pattern->isDisposed());
-    
     int scalingMethod = NearestNeighbor;
 
     int sourceWidthHires = p->bitmap->hasHires() ? p->bitmap->getHires()->width() : p->bitmap->width();
@@ -638,14 +743,10 @@ void Sprite::draw()
     int scaleIsSpecial = UpScale;
 
     if (targetWidthHires == sourceWidthHires && targetHeightHires == sourceHeightHires)
-    {
         scaleIsSpecial = SameScale;
-    }
 
     if (targetWidthHires < sourceWidthHires && targetHeightHires < sourceHeightHires)
-    {
         scaleIsSpecial = DownScale;
-    }
 
     switch (scaleIsSpecial)
     {
@@ -660,9 +761,104 @@ void Sprite::draw()
     }
 
     if (p->trans.getRotation() != 0.0)
-    {
         scalingMethod = shState->config().bitmapSmoothScaling;
+
+    return scalingMethod;
+}
+
+bool Sprite::batchable() const
+{
+    if (!p->isVisible || emptyFlashFlag)
+        return true; /* draws nothing; no need to flush */
+
+    if (p->wave.active)
+        return false;
+
+    if (p->opacity != 255)
+        return false;
+
+    /* A flash on its own batches too: the flash color rides
+     * the vertex color through the flash tint shader */
+    if (p->color->hasEffect() || p->tone->hasEffect() ||
+        p->bushDepth != 0 || p->invert ||
+        (p->pattern && !p->pattern->isDisposed()))
+        return false;
+
+    if (nullOrDisposed(p->bitmap) || p->bitmap->hasHires() ||
+        p->bitmap->megaSurface())
+        return false;
+
+    /* Rotation and zoom are fine - the transform is baked into
+     * the batched vertices - as long as the resulting filter
+     * selection stays nearest neighbor */
+    if (computeScalingMethod() != NearestNeighbor)
+        return false;
+
+    return true;
+}
+
+/* SceneElement */
+void Sprite::draw()
+{
+    if (!p->isVisible)
+        return;
+    
+    if (emptyFlashFlag)
+        return;
+    
+    if (batchable())
+    {
+        /* Bake the transform into scene space vertices and
+         * hand them to the shared batch */
+        const float *mat = p->trans.getMatrix();
+
+        const Vec4 color = flashing ? flashColor : Vec4(1, 1, 1, 1);
+
+        Vertex verts[4];
+
+        for (int i = 0; i < 4; ++i)
+        {
+            const Vertex &in = p->quad.vert[i];
+
+            verts[i].pos.x = mat[0]*in.pos.x + mat[4]*in.pos.y + mat[12];
+            verts[i].pos.y = mat[1]*in.pos.x + mat[5]*in.pos.y + mat[13];
+            verts[i].texPos = in.texPos;
+            verts[i].color = color;
+        }
+
+        /* Sampling the bitmap: pending deferred work lands */
+        TEXFBO &tf = p->bitmap->getGLTypes();
+
+        SceneQuadBatch::instance().append(
+            verts, 1, tf.tex,
+            Vec2i(p->bitmap->width(), p->bitmap->height()),
+            p->blendType,
+            flashing ? SceneQuadBatch::Flash : SceneQuadBatch::Plain);
+
+        return;
     }
+    
+    ShaderBase *base;
+    
+    bool renderEffect = p->color->hasEffect() ||
+    p->tone->hasEffect()  ||
+    flashing              ||
+    p->bushDepth != 0     ||
+    p->invert             ||
+    (p->pattern && !p->pattern->isDisposed());
+    
+    int scalingMethod = computeScalingMethod();
+
+    /* Wave displacement parameters for sprite.vert; always set,
+     * so a previous waving sprite can't leak its state into the
+     * next draw from the same program */
+    const bool waveOn = p->wave.active && p->wave.amp > 0;
+    const float wavePhaseRad = (p->wave.phase * (float) M_PI) / 180.0f;
+    const float waveFreq = (waveOn && p->wave.length != 0)
+        ? (float) (M_PI * 2) * p->trans.getScale().y / p->wave.length : 0.0f;
+
+    int sourceWidthHires = p->bitmap->hasHires() ? p->bitmap->getHires()->width() : p->bitmap->width();
+    int sourceHeightHires = p->bitmap->hasHires() ? p->bitmap->getHires()->height() : p->bitmap->height();
 
     if (renderEffect)
     {
@@ -672,11 +868,39 @@ void Sprite::draw()
             scalingMethod = NearestNeighbor;
         }
 
+        /* Only tone/color/opacity active: use the variant with
+         * the pattern, invert and bush paths compiled out */
+        bool heavyEffect = p->bushDepth != 0 || p->invert ||
+            (p->pattern && !p->pattern->isDisposed());
+
+        if (!heavyEffect)
+        {
+            LiteSpriteShader &shader = shState->shaders().liteSprite;
+
+            shader.bind();
+            shader.applyViewportProj();
+            shader.setSpriteMat(p->trans.getMatrix());
+            shader.setWave(waveOn, p->wave.amp, wavePhaseRad, waveFreq);
+
+            shader.setTone(p->tone->norm);
+            shader.setOpacity(p->opacity.norm);
+
+            const Vec4 *blend = (flashing && flashColor.w > p->color->norm.w) ?
+            &flashColor : &p->color->norm;
+
+            shader.setColor(*blend);
+
+            base = &shader;
+        }
+        else
+        {
+
         SpriteShader &shader = shState->shaders().sprite;
         
         shader.bind();
         shader.applyViewportProj();
         shader.setSpriteMat(p->trans.getMatrix());
+        shader.setWave(waveOn, p->wave.amp, wavePhaseRad, waveFreq);
         
         shader.setTone(p->tone->norm);
         shader.setOpacity(p->opacity.norm);
@@ -710,6 +934,8 @@ void Sprite::draw()
         shader.setColor(*blend);
         
         base = &shader;
+
+        }
     }
     else if (p->opacity != 255)
     {
@@ -723,6 +949,7 @@ void Sprite::draw()
         shader.bind();
         
         shader.setSpriteMat(p->trans.getMatrix());
+        shader.setWave(waveOn, p->wave.amp, wavePhaseRad, waveFreq);
         shader.setAlpha(p->opacity.norm);
         shader.applyViewportProj();
         base = &shader;
@@ -733,23 +960,25 @@ void Sprite::draw()
         {
         case Bicubic:
         {
-            BicubicSpriteShader &shader = shState->shaders().bicubicSprite;
+            BicubicSpriteShader &shader = shState->shaders().bicubicSprite();
             shader.bind();
 
             shader.setTexSize(Vec2i(sourceWidthHires, sourceHeightHires));
             shader.setSharpness(shState->config().bicubicSharpness);
             shader.setSpriteMat(p->trans.getMatrix());
+            shader.setWave(waveOn, p->wave.amp, wavePhaseRad, waveFreq);
             shader.applyViewportProj();
             base = &shader;
         }
             break;
         case Lanczos3:
         {
-            Lanczos3SpriteShader &shader = shState->shaders().lanczos3Sprite;
+            Lanczos3SpriteShader &shader = shState->shaders().lanczos3Sprite();
             shader.bind();
             
             shader.setTexSize(Vec2i(sourceWidthHires, sourceHeightHires));
             shader.setSpriteMat(p->trans.getMatrix());
+            shader.setWave(waveOn, p->wave.amp, wavePhaseRad, waveFreq);
             shader.applyViewportProj();
             base = &shader;
         }
@@ -757,12 +986,13 @@ void Sprite::draw()
 #ifdef MKXPZ_SSL
         case xBRZ:
         {
-            XbrzSpriteShader &shader = shState->shaders().xbrzSprite;
+            XbrzSpriteShader &shader = shState->shaders().xbrzSprite();
             shader.bind();
 
             shader.setTexSize(Vec2i(sourceWidthHires, sourceHeightHires));
             shader.setTargetScale(Vec2((float)(shState->config().xbrzScalingFactor), (float)(shState->config().xbrzScalingFactor)));
             shader.setSpriteMat(p->trans.getMatrix());
+            shader.setWave(waveOn, p->wave.amp, wavePhaseRad, waveFreq);
             shader.applyViewportProj();
             base = &shader;
         }
@@ -774,6 +1004,7 @@ void Sprite::draw()
             shader.bind();
 
             shader.setSpriteMat(p->trans.getMatrix());
+            shader.setWave(waveOn, p->wave.amp, wavePhaseRad, waveFreq);
             shader.applyViewportProj();
             base = &shader;
         }
@@ -787,7 +1018,7 @@ void Sprite::draw()
 #ifdef MKXPZ_SSL
     if (scalingMethod == xBRZ)
     {
-        XbrzShader &shader = shState->shaders().xbrz;
+        XbrzShader &shader = shState->shaders().xbrz();
         shader.setTargetScale(Vec2((float)(shState->config().xbrzScalingFactor), (float)(shState->config().xbrzScalingFactor)));
     }
 #endif
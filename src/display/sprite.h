@@ -41,6 +41,13 @@ public:
 	Sprite(Viewport *viewport = 0);
 	~Sprite();
 
+	/* Decoupled render interpolation, driven by Graphics:
+	 * applyInterp blends all sprite transforms towards the
+	 * live values for a sub-frame (1.0 restores them),
+	 * captureInterp marks the end of a logic tick */
+	static void applyInterp(float alpha);
+	static void captureInterp();
+
 	int getWidth()  const;
 	int getHeight() const;
 
@@ -82,6 +89,8 @@ private:
 	SpritePrivate *p;
 
 	void draw();
+	bool batchable() const;
+	int computeScalingMethod() const;
 	void onGeometryChange(const Scene::Geometry &);
 
 	void releaseResources();
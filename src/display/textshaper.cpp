@@ -0,0 +1,297 @@
+/*
+** textshaper.cpp
+**
+** This file is part of mkxp.
+**
+** Copyright (C) 2013 - 2021 Amaryllis Kulla <ancurio@mapleshrine.eu>
+**
+** mkxp is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 2 of the License, or
+** (at your option) any later version.
+**
+** mkxp is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with mkxp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "textshaper.h"
+
+#ifdef MKXPZ_HARFBUZZ
+
+#include <hb.h>
+#include <hb-ft.h>
+
+#include <ft2build.h>
+#include FT_FREETYPE_H
+
+#include "boost-hash.h"
+#include "font.h"
+#include "sharedstate.h"
+
+#include <string.h>
+
+/* Shaped runs longer than this aren't cached; the cache resets
+ * when it fills, like the atlas layout cache */
+#define SHAPE_MAX_STRLEN 256
+#define SHAPE_MAX_ENTRIES 1024
+
+struct FaceRec
+{
+	FT_Face face;
+	hb_font_t *hbFont;
+	int curSize;
+};
+
+struct RunKey
+{
+	std::string family;
+	int size;
+	std::string str;
+
+	bool operator<(const RunKey &o) const
+	{
+		if (size != o.size)
+			return size < o.size;
+		if (family != o.family)
+			return family < o.family;
+		return str < o.str;
+	}
+};
+
+/* Allocation-free probe for the hot lookup */
+struct RunRef
+{
+	const std::string *family;
+	int size;
+	const char *str;
+};
+
+static bool operator<(const RunKey &a, const RunRef &b)
+{
+	if (a.size != b.size)
+		return a.size < b.size;
+	int c = a.family.compare(*b.family);
+	if (c != 0)
+		return c < 0;
+	return strcmp(a.str.c_str(), b.str) < 0;
+}
+
+static bool operator<(const RunRef &a, const RunKey &b)
+{
+	if (a.size != b.size)
+		return a.size < b.size;
+	int c = b.family.compare(*a.family);
+	if (c != 0)
+		return c > 0;
+	return strcmp(a.str, b.str.c_str()) < 0;
+}
+
+struct TextShaper::Priv
+{
+	FT_Library lib;
+	bool libInit;
+
+	BoostHash<std::string, FaceRec> faces;
+	BoostHash<RunKey, ShapedRun> runs;
+
+	Priv() : libInit(false)
+	{
+		libInit = (FT_Init_FreeType(&lib) == 0);
+	}
+
+	~Priv()
+	{
+		BoostHash<std::string, FaceRec>::const_iterator it;
+		for (it = faces.cbegin(); it != faces.cend(); ++it)
+		{
+			hb_font_destroy(it->second.hbFont);
+			FT_Done_Face(it->second.face);
+		}
+
+		if (libInit)
+			FT_Done_FreeType(lib);
+	}
+
+	/* Face + hb_font for a family, opened once from the same file
+	 * bytes SDL_ttf uses (they live for the program's lifetime) */
+	FaceRec *getFace(const std::string &family)
+	{
+		if (FaceRec *rec = const_cast<FaceRec *>(faces.valuePtr(family)))
+			return rec->face ? rec : 0;
+
+		FaceRec rec = { 0, 0, 0 };
+
+		const std::vector<uint8_t> *data =
+		        shState->fontState().fontFileData(family);
+
+		if (libInit && data && !data->empty() &&
+		    FT_New_Memory_Face(lib, data->data(), (FT_Long) data->size(),
+		                       0, &rec.face) == 0)
+		{
+			rec.hbFont = hb_ft_font_create_referenced(rec.face);
+		}
+
+		if (rec.face && !rec.hbFont)
+		{
+			FT_Done_Face(rec.face);
+			rec.face = 0;
+		}
+
+		/* Negative results cache too */
+		faces.insert(family, rec);
+		return rec.face ? const_cast<FaceRec *>(faces.valuePtr(family)) : 0;
+	}
+
+	bool ensureSize(FaceRec *rec, int sizePx)
+	{
+		if (rec->curSize == sizePx)
+			return true;
+
+		if (FT_Set_Pixel_Sizes(rec->face, 0, sizePx) != 0)
+			return false;
+
+		hb_ft_font_changed(rec->hbFont);
+		rec->curSize = sizePx;
+		return true;
+	}
+};
+
+TextShaper::TextShaper()
+{
+	p = new Priv;
+}
+
+TextShaper::~TextShaper()
+{
+	delete p;
+}
+
+bool TextShaper::available()
+{
+	return true;
+}
+
+const TextShaper::ShapedRun *TextShaper::shape(const std::string &family,
+                                               int sizePx, const char *str)
+{
+	RunRef ref = { &family, sizePx, str };
+
+	if (const ShapedRun *run = p->runs.valuePtr(ref))
+		return run->glyphs.empty() ? 0 : run;
+
+	FaceRec *rec = p->getFace(family);
+
+	if (!rec || !p->ensureSize(rec, sizePx))
+		return 0;
+
+	hb_buffer_t *buf = hb_buffer_create();
+	hb_buffer_add_utf8(buf, str, -1, 0, -1);
+	/* Direction, script and language from the content itself;
+	 * RTL output arrives in visual order and is placed as-is */
+	hb_buffer_guess_segment_properties(buf);
+
+	hb_shape(rec->hbFont, buf, 0, 0);
+
+	const unsigned count = hb_buffer_get_length(buf);
+	hb_glyph_info_t *info = hb_buffer_get_glyph_infos(buf, 0);
+	hb_glyph_position_t *pos = hb_buffer_get_glyph_positions(buf, 0);
+
+	ShapedRun run;
+	run.width = 0;
+	run.ascent = (int) (rec->face->size->metrics.ascender >> 6);
+	run.height = (int) (rec->face->size->metrics.height >> 6);
+
+	for (unsigned i = 0; i < count; ++i)
+	{
+		ShapedGlyph g;
+		g.glyphId = info[i].codepoint;
+		g.xAdvance = (pos[i].x_advance + 32) >> 6;
+		g.xOffset = (pos[i].x_offset + 32) >> 6;
+		g.yOffset = (pos[i].y_offset + 32) >> 6;
+		run.glyphs.push_back(g);
+		run.width += g.xAdvance;
+	}
+
+	hb_buffer_destroy(buf);
+
+	if (run.glyphs.empty() || run.width <= 0)
+		return 0;
+
+	if (strlen(str) <= SHAPE_MAX_STRLEN)
+	{
+		if (p->runs.size() >= SHAPE_MAX_ENTRIES)
+			p->runs.clear();
+
+		RunKey key;
+		key.family = family;
+		key.size = sizePx;
+		key.str = str;
+		p->runs.insert(key, run);
+
+		return p->runs.valuePtr(ref);
+	}
+
+	/* Too long to cache: hand back a one-slot scratch */
+	static ShapedRun scratch;
+	scratch = run;
+	return &scratch;
+}
+
+bool TextShaper::rasterize(const std::string &family, int sizePx,
+                           uint32_t glyphId, GlyphBitmap &out)
+{
+	FaceRec *rec = p->getFace(family);
+
+	if (!rec || !p->ensureSize(rec, sizePx))
+		return false;
+
+	if (FT_Load_Glyph(rec->face, glyphId, FT_LOAD_RENDER) != 0)
+		return false;
+
+	const FT_GlyphSlot slot = rec->face->glyph;
+	const FT_Bitmap &bm = slot->bitmap;
+
+	if (bm.pixel_mode != FT_PIXEL_MODE_GRAY)
+		return false;
+
+	out.w = (int) bm.width;
+	out.h = (int) bm.rows;
+	out.left = slot->bitmap_left;
+	out.top = slot->bitmap_top;
+	out.pixels.resize((size_t) out.w * out.h);
+
+	for (int y = 0; y < out.h; ++y)
+		memcpy(&out.pixels[(size_t) y * out.w],
+		       bm.buffer + (ptrdiff_t) y * bm.pitch, out.w);
+
+	return true;
+}
+
+#else /* !MKXPZ_HARFBUZZ */
+
+TextShaper::TextShaper() : p(0) {}
+TextShaper::~TextShaper() {}
+
+bool TextShaper::available()
+{
+	return false;
+}
+
+const TextShaper::ShapedRun *TextShaper::shape(const std::string &,
+                                               int, const char *)
+{
+	return 0;
+}
+
+bool TextShaper::rasterize(const std::string &, int, uint32_t,
+                           GlyphBitmap &)
+{
+	return false;
+}
+
+#endif /* MKXPZ_HARFBUZZ */
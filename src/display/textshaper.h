@@ -0,0 +1,82 @@
+/*
+** textshaper.h
+**
+** This file is part of mkxp.
+**
+** Copyright (C) 2013 - 2021 Amaryllis Kulla <ancurio@mapleshrine.eu>
+**
+** mkxp is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 2 of the License, or
+** (at your option) any later version.
+**
+** mkxp is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with mkxp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef TEXTSHAPER_H
+#define TEXTSHAPER_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+/* HarfBuzz-backed text shaping (build with -Denable-harfbuzz=true).
+ * Turns a UTF-8 string into positioned glyph ids for a face/size -
+ * proper kerning and complex-script (Arabic etc.) forms - with
+ * shaped-run caching so the cost is paid once per unique string.
+ * The shaped glyph ids rasterize through FreeType here too, feeding
+ * the shaped atlas in bitmap.cpp. Built without HarfBuzz, available()
+ * is false and the classic SDL_ttf paths run unchanged */
+class TextShaper
+{
+public:
+	struct ShapedGlyph
+	{
+		uint32_t glyphId;
+		/* 26.6 fixed point already rounded to integer pixels */
+		int xAdvance;
+		int xOffset, yOffset;
+	};
+
+	struct ShapedRun
+	{
+		std::vector<ShapedGlyph> glyphs;
+		int width;    /* sum of advances */
+		int ascent;   /* baseline from the top of the cell */
+		int height;   /* line cell height */
+	};
+
+	struct GlyphBitmap
+	{
+		std::vector<uint8_t> pixels;  /* 8-bit coverage, w*h */
+		int w, h;
+		int left, top;  /* FT bearing (top counts upwards) */
+	};
+
+	TextShaper();
+	~TextShaper();
+
+	static bool available();
+
+	/* 0 when shaping is unavailable or fails. Cached per unique
+	 * string, but the pointer is only guaranteed until the NEXT
+	 * shape() call (the cache resets when it fills): consume the
+	 * run before shaping again */
+	const ShapedRun *shape(const std::string &family, int sizePx,
+	                       const char *str);
+
+	bool rasterize(const std::string &family, int sizePx,
+	               uint32_t glyphId, GlyphBitmap &out);
+
+private:
+	struct Priv;
+	Priv *p;
+};
+
+#endif // TEXTSHAPER_H
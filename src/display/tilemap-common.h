@@ -37,7 +37,7 @@
 #include <assert.h>
 #include <vector>
 
-#include "sigslot/signal.hpp"
+#include "flatsignal.h"
 
 static inline int
 wrap(int value, int range)
@@ -114,8 +114,10 @@ struct FlashMap
 {
 	FlashMap()
 		: dirty(false),
+	      layoutDirty(false),
 	      data(0),
-	      allocQuads(0)
+	      allocQuads(0),
+	      nonzeroCount(0)
 	{
 		vao.vbo = VBO::gen();
 		vao.ibo = shState->globalIBO().ibo;
@@ -143,36 +145,40 @@ struct FlashMap
 
 		data = value;
 		dataCon.disconnect();
-		dirty = true;
+		layoutDirty = true;
 
 		if (!data)
 			return;
 
-        
-        
-        dataCon = data->modified.connect(&FlashMap::setDirty, this);
+		dataCon = data->modified.connect(&FlashMap::setDirty, this);
 	}
 
 	void setViewport(const IntRect &value)
 	{
 		viewp = value;
-		dirty = true;
+		layoutDirty = true;
 	}
 
 	void prepare()
 	{
-		if (!dirty)
-			return;
-
-		rebuildBuffer();
-		dirty = false;
+		if (layoutDirty)
+		{
+			rebuildBuffer();
+			layoutDirty = false;
+			dirty = false;
+		}
+		else if (dirty)
+		{
+			updateColors();
+			dirty = false;
+		}
 	}
 
 	void draw(float alpha, const Vec2i &trans)
 	{
 		const size_t count = quadCount();
 
-		if (count == 0)
+		if (count == 0 || nonzeroCount == 0)
 			return;
 
 		GLMeta::vaoBind(vao);
@@ -202,12 +208,21 @@ private:
 		return vertices.size() / 4;
 	}
 
-	bool sampleFlashColor(Vec4 &out, int x, int y) const
+	/* Every viewport tile owns a fixed quad slot in the buffer.
+	 * Tiles that don't flash hold a degenerate (zero area) quad,
+	 * so flash data changes only rewrite the affected slots
+	 * instead of regenerating and re-uploading all quads */
+	void writeSlot(size_t slot, int x, int y, int16_t packed)
 	{
-		int16_t packed = tableGetWrapped(*data, x, y);
+		CVertex *v = &vertices[slot * 4];
 
 		if (packed == 0)
-			return false;
+		{
+			for (size_t i = 0; i < 4; ++i)
+				v[i] = CVertex();
+
+			return;
+		}
 
 		const float max = 0xF;
 
@@ -215,38 +230,39 @@ private:
 		float g = ((packed & 0x00F0) >> 4) / max;
 		float r = ((packed & 0x0F00) >> 8) / max;
 
-		out = Vec4(r, g, b, 1);
+		FloatRect posRect(x*32, y*32, 32, 32);
 
-		return true;
+		Quad::setPosRect(v, posRect);
+		Quad::setColor(v, Vec4(r, g, b, 1));
 	}
 
 	void rebuildBuffer()
 	{
 		vertices.clear();
+		packedCache.clear();
+		nonzeroCount = 0;
 
 		if (!data)
 			return;
 
-		for (int x = 0; x < viewp.w; ++x)
-			for (int y = 0; y < viewp.h; ++y)
-			{
-				Vec4 color;
+		size_t slots = viewp.w * viewp.h;
 
-				if (!sampleFlashColor(color, x+viewp.x, y+viewp.y))
-					continue;
+		vertices.resize(slots * 4);
+		packedCache.resize(slots);
 
-				FloatRect posRect(x*32, y*32, 32, 32);
+		for (int y = 0; y < viewp.h; ++y)
+			for (int x = 0; x < viewp.w; ++x)
+			{
+				size_t slot = y * viewp.w + x;
+				int16_t packed = tableGetWrapped(*data, x+viewp.x, y+viewp.y);
 
-				CVertex v[4];
-				Quad::setPosRect(v, posRect);
-				Quad::setColor(v, color);
+				packedCache[slot] = packed;
 
-				for (size_t i = 0; i < 4; ++i)
-					vertices.push_back(v[i]);
-			}
+				if (packed != 0)
+					++nonzeroCount;
 
-		if (vertices.size() == 0)
-			return;
+				writeSlot(slot, x, y, packed);
+			}
 
 		VBO::bind(vao.vbo);
 
@@ -264,16 +280,59 @@ private:
 		shState->ensureQuadIBO(quadCount());
 	}
 
+	/* Rewrites only the slots whose packed flash value changed,
+	 * and uploads the covering span in a single buffer write */
+	void updateColors()
+	{
+		if (!data || vertices.empty())
+			return;
+
+		long firstDirty = -1, lastDirty = -1;
+		nonzeroCount = 0;
+
+		for (int y = 0; y < viewp.h; ++y)
+			for (int x = 0; x < viewp.w; ++x)
+			{
+				size_t slot = y * viewp.w + x;
+				int16_t packed = tableGetWrapped(*data, x+viewp.x, y+viewp.y);
+
+				if (packed != 0)
+					++nonzeroCount;
+
+				if (packed == packedCache[slot])
+					continue;
+
+				packedCache[slot] = packed;
+				writeSlot(slot, x, y, packed);
+
+				if (firstDirty < 0)
+					firstDirty = slot;
+				lastDirty = slot;
+			}
+
+		if (firstDirty < 0)
+			return;
+
+		VBO::bind(vao.vbo);
+		VBO::uploadSubData(firstDirty * 4 * sizeof(CVertex),
+		                   (lastDirty - firstDirty + 1) * 4 * sizeof(CVertex),
+		                   &vertices[firstDirty * 4]);
+		VBO::unbind();
+	}
+
 	bool dirty;
+	bool layoutDirty;
 
 	Table *data;
-	sigslot::connection dataCon;
+	FlatConnection dataCon;
 
 	IntRect viewp;
 
 	GLMeta::VAO vao;
 	size_t allocQuads;
+	size_t nonzeroCount;
 	std::vector<CVertex> vertices;
+	std::vector<int16_t> packedCache;
 };
 
 #endif // TILEMAPCOMMON_H
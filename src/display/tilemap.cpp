@@ -21,6 +21,9 @@
 
 #include "tilemap.h"
 
+#include "arena.h"
+#include "jobpool.h"
+
 #include "viewport.h"
 #include "bitmap.h"
 #include "table.h"
@@ -39,8 +42,9 @@
 #include "vertex.h"
 #include "tileatlas.h"
 #include "tilemap-common.h"
+#include "sdl-util.h"
 
-#include "sigslot/signal.hpp"
+#include "flatsignal.h"
 
 #include <string.h>
 #include <stdint.h>
@@ -232,6 +236,24 @@ struct ZLayer : public ViewportElement
 	ABOUT_TO_ACCESS_NOOP
 };
 
+struct TilemapPrivate;
+
+/* One column band of the map viewport, generated on its own
+ * thread during parallel buffer rebuilds. Bands are merged back
+ * in column order, which reproduces the serial emission order
+ * exactly (the serial walk is column-major) */
+struct TilemapBand
+{
+	TilemapPrivate *p;
+	int x0, x1; /* inclusive column range */
+	int y0, y1;
+
+	SVVector ground;
+	SVVector zlayers[zlayersMax];
+
+	void generate();
+};
+
 struct TilemapPrivate
 {
 	Viewport *viewport;
@@ -280,6 +302,27 @@ struct TilemapPrivate
 	/* ZLayer vertices */
 	SVVector zlayerVert[zlayersMax];
 
+	/* Cache of generated map windows, keyed by viewport
+	 * position. Scrolling back over recently visited regions
+	 * reuses the generated arrays instead of re-walking the
+	 * map Table; distant windows are evicted LRU */
+	enum { windowCacheCap = 8 };
+	struct CachedWindow
+	{
+		Vec2i pos;
+		SVVector ground;
+		SVVector zlayers[zlayersMax];
+		uint64_t stamp;
+	};
+	std::vector<CachedWindow> windowCache;
+	uint64_t windowCacheClock;
+
+	/* Per-tile-id layer lookup, resolved once from the
+	 * priorities Table instead of per tile per rebuild.
+	 * -1 marks faulty (> 5) priority values */
+	std::vector<int16_t> prioCache;
+	bool prioCacheDirty;
+
 	/* Base quad indices of each zlayer
 	 * in the shared buffer */
 	size_t zlayerBases[zlayersMax+1];
@@ -309,6 +352,11 @@ struct TilemapPrivate
 	bool atlasSizeDirty;
 	/* Affected by: autotiles(.changed), tileset(.changed), allocateAtlas */
 	bool atlasDirty;
+	/* Per-autotile strip dirty flags; allow re-blitting just
+	 * the changed strip instead of the whole atlas */
+	bool atDirty[autotileCount];
+	/* Tileset contents changed but atlas layout did not */
+	bool tilesetDirty;
 	/* Affected by: mapData(.changed), priorities(.changed) */
 	bool buffersDirty;
 	/* Affected by: ox, oy */
@@ -320,18 +368,18 @@ struct TilemapPrivate
 	bool tilemapReady;
 
 	/* Change watches */
-	sigslot::connection tilesetCon;
-	sigslot::connection autotilesCon[autotileCount];
-	sigslot::connection mapDataCon;
-	sigslot::connection prioritiesCon;
+	FlatConnection tilesetCon;
+	FlatConnection autotilesCon[autotileCount];
+	FlatConnection mapDataCon;
+	FlatConnection prioritiesCon;
 
 	/* Dispose watches */
-	sigslot::connection autotilesDispCon[autotileCount];
+	FlatConnection autotilesDispCon[autotileCount];
 
-	sigslot::connection tilesetDispCon;
+	FlatConnection tilesetDispCon;
 
 	/* Draw prepare call */
-	sigslot::connection prepareCon;
+	FlatConnection prepareCon;
 
 	NormValue opacity;
 	BlendType blendType;
@@ -349,10 +397,13 @@ struct TilemapPrivate
 	      flashAlphaIdx(0),
 	      atlasSizeDirty(false),
 	      atlasDirty(false),
+	      tilesetDirty(false),
 	      buffersDirty(false),
 	      mapViewportDirty(false),
 	      zOrderDirty(false),
 	      tilemapReady(false),
+	      windowCacheClock(0),
+	      prioCacheDirty(true),
 
 		  opacity(255),
 	      blendType(BlendNormal),
@@ -360,6 +411,7 @@ struct TilemapPrivate
 	      tone(&tmp.tone)
 	{
 		memset(autotiles, 0, sizeof(autotiles));
+		memset(atDirty, 0, sizeof(atDirty));
 
 		atlas.animatedATs.reserve(autotileCount);
 		atlas.efTilesetH = 0;
@@ -484,17 +536,17 @@ struct TilemapPrivate
 		atlasSizeDirty = true;
 	}
 
-	void invalidateAtlasContents()
-	{
-		atlasDirty = true;
-	}
-
 	void atlasContentsDisposal(int i)
 	{
 		// Guard against deleted bitmaps
 		autotiles[i] = 0;
 		
-		invalidateAtlasContents();
+		invalidateAutotile(i);
+	}
+
+	void invalidateAutotile(int i)
+	{
+		atDirty[i] = true;
 	}
 
 	void tilesetDisposal()
@@ -505,9 +557,35 @@ struct TilemapPrivate
 
 	void invalidateBuffers()
 	{
+		/* Map data or priorities changed: every cached window
+		 * is stale */
+		windowCache.clear();
 		buffersDirty = true;
 	}
 
+	void invalidatePriorities()
+	{
+		prioCacheDirty = true;
+		invalidateBuffers();
+	}
+
+	void rebuildPrioCache()
+	{
+		prioCache.clear();
+
+		if (!priorities)
+			return;
+
+		int count = priorities->xSize();
+		prioCache.resize(count);
+
+		for (int i = 0; i < count; ++i)
+		{
+			int value = priorities->at(i);
+			prioCache[i] = (value > 5) ? -1 : value;
+		}
+	}
+
 	/* Checks for the minimum amount of data needed to display */
 	bool verifyResources()
 	{
@@ -520,11 +598,10 @@ struct TilemapPrivate
 		return true;
 	}
 
-	/* Allocates correctly sized TexFBO for atlas */
+	/* Allocates correctly sized TexFBO for atlas.
+	 * Callers run updateAtlasInfo beforehand */
 	void allocateAtlas()
 	{
-		updateAtlasInfo();
-
 		/* Aquire atlas tex */
 		shState->releaseAtlasTex(atlas.gl);
 		shState->requestAtlasTex(atlas.size.x, atlas.size.y, atlas.gl);
@@ -532,14 +609,68 @@ struct TilemapPrivate
 		atlasDirty = true;
 	}
 
+	/* Clears one autotile strip in the atlas, so a smaller
+	 * replacement autotile cannot leave stale pixels behind */
+	void clearAtlasStrip(int atInd)
+	{
+		FBO::bind(atlas.gl.fbo);
+		glState.scissorTest.pushSet(true);
+		glState.scissorBox.pushSet(IntRect(0, atInd*autotileH, atAreaW, autotileH));
+		glState.clearColor.pushSet(Vec4());
+
+		FBO::clear();
+
+		glState.clearColor.pop();
+		glState.scissorBox.pop();
+		glState.scissorTest.pop();
+	}
+
+	/* Blits one autotile into its strip; caller is inside a
+	 * blitBegin(atlas.gl) bracket */
+	void blitAutotileInt(uint8_t atInd)
+	{
+		Bitmap *autotile = autotiles[atInd];
+		autotile->ensureNonAnimated();
+
+		int atW = autotile->width();
+		int atH = autotile->height();
+		int blitW = std::min(atW, atAreaW);
+		int blitH = std::min(atH, autotileH);
+
+		if (autotile->hasHires()) {
+			Debug() << "BUG: High-res Tilemap blit autotiles not implemented";
+		}
+
+		GLMeta::blitSource(autotile->getGLTypes());
+
+		/* Each animation frame is blitted exactly once; frame
+		 * selection happens entirely in tilemap.vert, which
+		 * offsets autotile texcoords by (aniIndex mod the
+		 * per-autotile frame count) at the 96px frame stride.
+		 * Static autotiles (frame count 1) thus never need to
+		 * be replicated across the animation columns */
+		if (atlas.smallATs[atInd])
+		{
+			/* 32px autotile: one 32x32 cell per frame, laid out
+			 * in the shader's column/row order (8 per row) */
+			int frames = std::min(atW/32, atFrames*autotileH/32);
+
+			for (int j = 0; j < frames; ++j)
+				GLMeta::blitRectangle(IntRect(32*j, 0, 32, 32),
+				                      Vec2i(autotileW*(j % atFrames), atInd*autotileH + 32*(j / atFrames)));
+		}
+		else
+			GLMeta::blitRectangle(IntRect(0, 0, blitW, blitH),
+			                      Vec2i(0, atInd*autotileH));
+	}
+
 	/* Assembles atlas from tileset and autotile bitmaps */
 	void buildAtlas()
 	{
+        windowCache.clear();
         updateAutotileInfo();
         tileset->ensureNonAnimated();
 
-		TileAtlas::BlitVec blits = TileAtlas::calcBlits(atlas.efTilesetH, atlas.size);
-
 		/* Clear atlas */
 		FBO::bind(atlas.gl.fbo);
 		glState.clearColor.pushSet(Vec4());
@@ -554,50 +685,55 @@ struct TilemapPrivate
 
 		/* Blit autotiles */
 		for (size_t i = 0; i < atlas.usableATs.size(); ++i)
-		{
-			const uint8_t atInd = atlas.usableATs[i];
-			Bitmap *autotile = autotiles[atInd];
-            autotile->ensureNonAnimated();
+			blitAutotileInt(atlas.usableATs[i]);
 
-			int atW = autotile->width();
-			int atH = autotile->height();
-			int blitW = std::min(atW, atAreaW);
-			int blitH = std::min(atH, autotileH);
+		GLMeta::blitEnd();
 
-			if (autotile->hasHires()) {
-				Debug() << "BUG: High-res Tilemap blit autotiles not implemented";
-			}
+		blitTilesetInt();
+	}
 
-			GLMeta::blitSource(autotile->getGLTypes());
+	/* Re-blits only the dirty autotile strips (and, if flagged,
+	 * the tileset lanes) instead of rebuilding the whole atlas */
+	void updateAtlasPartial()
+	{
+		windowCache.clear();
+		updateAutotileInfo();
+		tileset->ensureNonAnimated();
 
-			if (atW <= autotileW && tiles.animated && !atlas.smallATs[atInd])
+		bool anyATDirty = false;
+		for (int i = 0; i < autotileCount; ++i)
+		{
+			if (atDirty[i])
 			{
-				/* Static autotile */
-				for (int j = 0; j < atFrames; ++j)
-					GLMeta::blitRectangle(IntRect(0, 0, blitW, blitH),
-					                      Vec2i(autotileW*j, atInd*autotileH));
+				clearAtlasStrip(i);
+				anyATDirty = true;
 			}
-			else
+		}
+
+		if (anyATDirty)
+		{
+			GLMeta::blitBegin(atlas.gl);
+
+			for (size_t i = 0; i < atlas.usableATs.size(); ++i)
 			{
-				/* Animated autotile */
-				if (atlas.smallATs[atInd])
-				{
-					int frames = atW/32;
-					for (int j = 0; j < atFrames*autotileH/32; ++j)
-					{
-						GLMeta::blitRectangle(IntRect(32*(j % frames), 0, 32, 32),
-						                      Vec2i(autotileW*(j % atFrames), atInd*autotileH + 32*(j / atFrames)));
-					}
-				}
-				else
-					GLMeta::blitRectangle(IntRect(0, 0, blitW, blitH),
-					                      Vec2i(0, atInd*autotileH));
+				const uint8_t atInd = atlas.usableATs[i];
+
+				if (atDirty[atInd])
+					blitAutotileInt(atInd);
 			}
+
+			GLMeta::blitEnd();
 		}
 
-		GLMeta::blitEnd();
+		if (tilesetDirty)
+			blitTilesetInt();
+	}
+
+	/* Blits the tileset lanes into the atlas */
+	void blitTilesetInt()
+	{
+		TileAtlas::BlitVec blits = TileAtlas::calcBlits(atlas.efTilesetH, atlas.size);
 
-		/* Blit tileset */
 		if (tileset->megaSurface())
 		{
 			/* Mega surface tileset */
@@ -679,18 +815,10 @@ struct TilemapPrivate
 
 	int samplePriority(int tileInd)
 	{
-		if (!priorities)
-			return 0;
-
-		if (tileInd > priorities->xSize()-1)
+		if (tileInd >= (int) prioCache.size())
 			return 0;
 
-		int value = priorities->at(tileInd);
-
-		if (value > 5)
-			return -1;
-
-		return value;
+		return prioCache[tileInd];
 	}
 
 	void handleAutotile(int x, int y, int tileInd, SVVector *array)
@@ -736,7 +864,8 @@ struct TilemapPrivate
 		}
 	}
 
-	void handleTile(int x, int y, int z)
+	void handleTile(int x, int y, int z,
+	                SVVector *ground, SVVector *zlayers)
 	{
 		int tileInd =
 			tableGetWrapped(*mapData, x + viewpPos.x, y + viewpPos.y, z);
@@ -756,14 +885,14 @@ struct TilemapPrivate
 		/* Prio 0 tiles are all part of the same ground layer */
 		if (prio == 0)
 		{
-			targetArray = &groundVert;
+			targetArray = ground;
 		}
 		else
 		{
 			int layerInd = y + prio;
 			if ((size_t)layerInd >= zlayersMax)
 				return;
-			targetArray = &zlayerVert[layerInd];
+			targetArray = &zlayers[layerInd];
 		}
 
 		/* Check for autotile */
@@ -800,6 +929,29 @@ struct TilemapPrivate
 	{
 		clearQuadArrays();
 
+		if (prioCacheDirty)
+		{
+			rebuildPrioCache();
+			prioCacheDirty = false;
+		}
+
+		/* Serve from the window cache when possible */
+		for (size_t i = 0; i < windowCache.size(); ++i)
+		{
+			CachedWindow &cw = windowCache[i];
+
+			if (cw.pos != viewpPos)
+				continue;
+
+			cw.stamp = ++windowCacheClock;
+
+			groundVert = cw.ground;
+			for (size_t j = 0; j < zlayersMax; ++j)
+				zlayerVert[j] = cw.zlayers[j];
+
+			return;
+		}
+
 		int ox = viewpPos.x;
 		int oy = viewpPos.y;
 		int mapW = mapData->xSize();
@@ -822,10 +974,86 @@ struct TilemapPrivate
 
 		if ((minX > maxX) || (minY > maxY))
 			return;
-		for (int x = minX; x <= maxX; ++x)
-			for (int y = minY; y <= maxY; ++y)
-				for (int z = 0; z < mapData->zSize(); ++z)
-					handleTile(x, y, z);
+
+		int cols = maxX - minX + 1;
+		int rows = maxY - minY + 1;
+		int tileCount = cols * rows * mapData->zSize();
+
+		int threads = clamp(SDL_GetCPUCount() - 1, 0, 4);
+
+		/* The standard 21x16 viewport is far too small for
+		 * threading to pay off; only oversized z counts get
+		 * split into column bands processed in parallel */
+		if (threads < 2 || tileCount < 4096 || cols < threads)
+		{
+			for (int x = minX; x <= maxX; ++x)
+				for (int y = minY; y <= maxY; ++y)
+					for (int z = 0; z < mapData->zSize(); ++z)
+						handleTile(x, y, z, &groundVert, zlayerVert);
+
+			cacheCurrentWindow();
+			return;
+		}
+
+		ArenaVector<TilemapBand> bands
+		        (threads, TilemapBand(), ArenaAlloc<TilemapBand>(&frameArena()));
+
+		for (int i = 0; i < threads; ++i)
+		{
+			TilemapBand &band = bands[i];
+			band.p = this;
+			band.x0 = minX + (cols * i) / threads;
+			band.x1 = minX + (cols * (i+1)) / threads - 1;
+			band.y0 = minY;
+			band.y1 = maxY;
+		}
+
+		/* Bands run on the shared pool: no thread spawn per
+		 * rebuild, and the calling thread chews its share */
+		JobPool::instance().parallelFor(threads,
+			[](void *arg, int i) {
+				(*static_cast<ArenaVector<TilemapBand>*>(arg))[i].generate();
+			}, &bands);
+
+		/* Merge in column order for the single VBO upload */
+		for (int i = 0; i < threads; ++i)
+		{
+			groundVert.insert(groundVert.end(),
+			                  bands[i].ground.begin(), bands[i].ground.end());
+
+			for (size_t j = 0; j < zlayersMax; ++j)
+				zlayerVert[j].insert(zlayerVert[j].end(),
+				                     bands[i].zlayers[j].begin(), bands[i].zlayers[j].end());
+		}
+
+		cacheCurrentWindow();
+	}
+
+	void cacheCurrentWindow()
+	{
+		CachedWindow *slot = 0;
+
+		if (windowCache.size() < windowCacheCap)
+		{
+			windowCache.push_back(CachedWindow());
+			slot = &windowCache.back();
+		}
+		else
+		{
+			/* Evict the least recently used window */
+			slot = &windowCache[0];
+
+			for (size_t i = 1; i < windowCache.size(); ++i)
+				if (windowCache[i].stamp < slot->stamp)
+					slot = &windowCache[i];
+		}
+
+		slot->pos = viewpPos;
+		slot->stamp = ++windowCacheClock;
+		slot->ground = groundVert;
+
+		for (size_t j = 0; j < zlayersMax; ++j)
+			slot->zlayers[j] = zlayerVert[j];
 	}
 
 	static size_t quadDataSize(size_t quadCount)
@@ -1031,7 +1259,21 @@ struct TilemapPrivate
 
 		if (atlasSizeDirty)
 		{
-			allocateAtlas();
+			/* If the layout is unchanged, a tileset lane re-blit
+			 * is enough; only realloc when the size really moved */
+			Vec2i oldSize = atlas.size;
+			updateAtlasInfo();
+
+			if (atlas.size != oldSize ||
+			    atlas.gl.width != atlas.size.x || atlas.gl.height != atlas.size.y)
+			{
+				allocateAtlas();
+			}
+			else
+			{
+				tilesetDirty = true;
+			}
+
 			atlasSizeDirty = false;
 		}
 
@@ -1039,6 +1281,23 @@ struct TilemapPrivate
 		{
 			buildAtlas();
 			atlasDirty = false;
+
+			memset(atDirty, 0, sizeof(atDirty));
+			tilesetDirty = false;
+		}
+		else
+		{
+			bool anyATDirty = false;
+			for (int i = 0; i < autotileCount; ++i)
+				anyATDirty |= atDirty[i];
+
+			if (anyATDirty || tilesetDirty)
+			{
+				updateAtlasPartial();
+
+				memset(atDirty, 0, sizeof(atDirty));
+				tilesetDirty = false;
+			}
 		}
 
 		if (mapViewportDirty)
@@ -1069,6 +1328,14 @@ struct TilemapPrivate
 	}
 };
 
+void TilemapBand::generate()
+{
+	for (int x = x0; x <= x1; ++x)
+		for (int y = y0; y <= y1; ++y)
+			for (int z = 0; z < p->mapData->zSize(); ++z)
+				p->handleTile(x, y, z, &ground, zlayers);
+}
+
 int TilemapUtils::autotileAniIdx = 0;
 
 GroundLayer::GroundLayer(TilemapPrivate *p, Viewport *viewport)
@@ -1201,7 +1468,7 @@ void Tilemap::Autotiles::set(int i, Bitmap *bitmap)
 
 	p->autotiles[i] = bitmap;
 
-	p->invalidateAtlasContents();
+	p->invalidateAutotile(i);
 
 	p->autotilesCon[i].disconnect();
 	p->autotilesDispCon[i].disconnect();
@@ -1212,8 +1479,7 @@ void Tilemap::Autotiles::set(int i, Bitmap *bitmap)
 		return;
 	}
 
-	p->autotilesCon[i] = bitmap->modified.connect
-	        (&TilemapPrivate::invalidateAtlasContents, p);
+	p->autotilesCon[i] = bitmap->modified.connect( [i, this] { p->invalidateAutotile(i); } );
 
 	p->autotilesDispCon[i] = bitmap->wasDisposed.connect( [i, this] { p->atlasContentsDisposal(i); } );
 
@@ -1343,12 +1609,16 @@ void Tilemap::setPriorities(Table *value)
 	p->priorities = value;
 
 	if (!value)
+	{
+		/* The cached layer lookup must not outlive the table */
+		p->prioCacheDirty = true;
 		return;
+	}
 
-	p->invalidateBuffers();
+	p->invalidatePriorities();
 	p->prioritiesCon.disconnect();
 	p->prioritiesCon = value->modified.connect
-	        (&TilemapPrivate::invalidateBuffers, p);
+	        (&TilemapPrivate::invalidatePriorities, p);
 }
 
 void Tilemap::setVisible(bool value)
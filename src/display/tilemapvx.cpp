@@ -38,7 +38,7 @@
 #include "tilemap-common.h"
 
 #include <vector>
-#include "sigslot/signal.hpp"
+#include "flatsignal.h"
 
 /* Flash tiles pulsing opacity */
 static const uint8_t flashAlpha[] =
@@ -75,6 +75,7 @@ struct TilemapVXPrivate : public ViewportElement, TileAtlasVX::Reader
 	GLMeta::VAO vao;
 
 	TEXFBO atlasHires;
+	bool hiresAtlasAllocated;
 
 	size_t allocQuads;
 
@@ -89,14 +90,20 @@ struct TilemapVXPrivate : public ViewportElement, TileAtlasVX::Reader
 
 	bool atlasDirty;
 	bool buffersDirty;
+	/* Map data signalled a change; verify against the cached
+	 * window before paying for a real rebuild */
+	bool buffersCheckPending;
 	bool mapViewportDirty;
 
-	sigslot::connection mapDataCon;
-	sigslot::connection flagsCon;
+	/* Tile ids of the currently built map window */
+	std::vector<int16_t> windowCache;
 
-	sigslot::connection prepareCon;
-	sigslot::connection bmChangedCons[BM_COUNT];
-	sigslot::connection bmDisposedCons[BM_COUNT];
+	FlatConnection mapDataCon;
+	FlatConnection flagsCon;
+
+	FlatConnection prepareCon;
+	FlatConnection bmChangedCons[BM_COUNT];
+	FlatConnection bmDisposedCons[BM_COUNT];
 
 	struct AboveLayer : public ViewportElement
 	{
@@ -125,10 +132,12 @@ struct TilemapVXPrivate : public ViewportElement, TileAtlasVX::Reader
 	      allocQuads(0),
 	      groundQuads(0),
 	      aboveQuads(0),
+	      hiresAtlasAllocated(false),
 	      frameIdx(0),
 	      flashAlphaIdx(0),
 	      atlasDirty(true),
 	      buffersDirty(false),
+	      buffersCheckPending(false),
 	      mapViewportDirty(false),
 	      above(this, viewport)
 	{
@@ -136,13 +145,9 @@ struct TilemapVXPrivate : public ViewportElement, TileAtlasVX::Reader
 
 		shState->requestAtlasTex(ATLASVX_W, ATLASVX_H, atlas);
 
-		if (shState->config().enableHires) {
-			double scalingFactor = shState->config().atlasScalingFactor;
-			int hiresWidth = (int)lround(scalingFactor * ATLASVX_W);
-			int hiresHeight = (int)lround(scalingFactor * ATLASVX_H);
-			shState->requestAtlasTex(hiresWidth, hiresHeight, atlasHires);
-			atlas.selfHires = &atlasHires;
-		}
+		/* The (scaled, so typically several times larger) hires
+		 * atlas is only allocated once a tileset bitmap with a
+		 * hires counterpart is actually assigned */
 
 		vbo = VBO::gen();
 
@@ -163,9 +168,8 @@ struct TilemapVXPrivate : public ViewportElement, TileAtlasVX::Reader
 		VBO::del(vbo);
 
 		shState->releaseAtlasTex(atlas);
-		if (shState->config().enableHires) {
+		if (hiresAtlasAllocated)
 			shState->releaseAtlasTex(atlasHires);
-		}
 
 		prepareCon.disconnect();
 
@@ -184,6 +188,39 @@ struct TilemapVXPrivate : public ViewportElement, TileAtlasVX::Reader
 		atlasDirty = true;
 	}
 
+	/* Allocates or drops the hires atlas depending on whether
+	 * any assigned tileset bitmap actually carries a hires
+	 * counterpart; games without hires tilesets then never pay
+	 * the scaled atlas' VRAM cost */
+	void updateHiresAtlas()
+	{
+		if (!shState->config().enableHires)
+			return;
+
+		bool needHires = false;
+
+		for (size_t i = 0; i < BM_COUNT; ++i)
+			if (!nullOrDisposed(bitmaps[i]) && bitmaps[i]->hasHires())
+				needHires = true;
+
+		if (needHires && !hiresAtlasAllocated)
+		{
+			double scalingFactor = shState->config().atlasScalingFactor;
+			int hiresWidth = (int)lround(scalingFactor * ATLASVX_W);
+			int hiresHeight = (int)lround(scalingFactor * ATLASVX_H);
+			shState->requestAtlasTex(hiresWidth, hiresHeight, atlasHires);
+			atlas.selfHires = &atlasHires;
+			hiresAtlasAllocated = true;
+		}
+		else if (!needHires && hiresAtlasAllocated)
+		{
+			shState->releaseAtlasTex(atlasHires);
+			atlasHires = TEXFBO();
+			atlas.selfHires = 0;
+			hiresAtlasAllocated = false;
+		}
+	}
+
 	void atlasDisposal(int i)
 	{
 		// Guard against deleted bitmaps
@@ -197,8 +234,58 @@ struct TilemapVXPrivate : public ViewportElement, TileAtlasVX::Reader
 		buffersDirty = true;
 	}
 
+	void scheduleBufferCheck()
+	{
+		buffersCheckPending = true;
+	}
+
+	/* Re-reads the map window and compares against the cache;
+	 * edits outside the visible window compare equal and skip
+	 * the rebuild entirely */
+	bool windowChanged() const
+	{
+		if (!mapData)
+			return false;
+
+		const int zs = mapData->zSize();
+		const size_t count = (size_t) mapViewp.w * mapViewp.h * zs;
+
+		if (windowCache.size() != count)
+			return true;
+
+		size_t i = 0;
+
+		for (int z = 0; z < zs; ++z)
+			for (int y = 0; y < mapViewp.h; ++y)
+				for (int x = 0; x < mapViewp.w; ++x)
+					if (windowCache[i++] !=
+					    tableGetWrapped(*mapData, mapViewp.x+x, mapViewp.y+y, z))
+						return true;
+
+		return false;
+	}
+
+	void snapshotWindow()
+	{
+		windowCache.clear();
+
+		if (!mapData)
+			return;
+
+		const int zs = mapData->zSize();
+		windowCache.reserve((size_t) mapViewp.w * mapViewp.h * zs);
+
+		for (int z = 0; z < zs; ++z)
+			for (int y = 0; y < mapViewp.h; ++y)
+				for (int x = 0; x < mapViewp.w; ++x)
+					windowCache.push_back(
+						tableGetWrapped(*mapData, mapViewp.x+x, mapViewp.y+y, z));
+	}
+
 	void rebuildAtlas()
 	{
+		updateHiresAtlas();
+
 		TileAtlasVX::build(atlas, bitmaps);
 
 		if (shState->config().dumpAtlas)
@@ -280,6 +367,8 @@ struct TilemapVXPrivate : public ViewportElement, TileAtlasVX::Reader
 		VBO::unbind();
 
 		shState->ensureQuadIBO(totalQuads);
+
+		snapshotWindow();
 	}
 
 	void prepare()
@@ -299,6 +388,14 @@ struct TilemapVXPrivate : public ViewportElement, TileAtlasVX::Reader
 			mapViewportDirty = false;
 		}
 
+		if (buffersCheckPending)
+		{
+			if (!buffersDirty && windowChanged())
+				buffersDirty = true;
+
+			buffersCheckPending = false;
+		}
+
 		if (buffersDirty)
 		{
 			rebuildBuffers();
@@ -538,7 +635,7 @@ void TilemapVX::setMapData(Table *value)
 
 	p->mapDataCon.disconnect();
 	p->mapDataCon = value->modified.connect
-		(&TilemapVXPrivate::invalidateBuffers, p);
+		(&TilemapVXPrivate::scheduleBufferCheck, p);
 }
 
 void TilemapVX::setFlashData(Table *value)
@@ -0,0 +1,512 @@
+/*
+** video.cpp
+**
+** This file is part of mkxp.
+**
+** Copyright (C) 2013 - 2021 Amaryllis Kulla <ancurio@mapleshrine.eu>
+**
+** mkxp is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 2 of the License, or
+** (at your option) any later version.
+**
+** mkxp is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with mkxp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "video.h"
+
+#include "bitmap.h"
+#include "exception.h"
+#include "filesystem.h"
+#include "gl-meta.h"
+#include "gl-util.h"
+#include "sharedstate.h"
+#include "theoraplay/theoraplay.h"
+
+#include <SDL_rwops.h>
+#include <SDL_timer.h>
+
+#include <stdlib.h>
+
+#include <vector>
+
+/* How many frames the decoder keeps ahead of presentation. A scene
+ * background doesn't need the modal player's deep prebuffer, but the
+ * buffer is also what lets the demuxer linger at end-of-stream long
+ * enough for the loop wrap to be seamless */
+#define VIDEO_DECODE_AHEAD 8
+
+/* A held lookahead frame this far past the position can only be
+ * stale output from before a seek was serviced; drop it */
+#define VIDEO_STALE_AHEAD_MS 2000.0
+
+static long videoRead(THEORAPLAY_Io *io, void *buf, long buflen)
+{
+    SDL_RWops *f = (SDL_RWops *) io->userdata;
+    return (long) SDL_RWread(f, buf, 1, buflen);
+}
+
+static int videoSeek(THEORAPLAY_Io *io, long offset)
+{
+    SDL_RWops *f = (SDL_RWops *) io->userdata;
+    return (SDL_RWseek(f, offset, RW_SEEK_SET) < 0) ? -1 : 0;
+}
+
+static void videoClose(THEORAPLAY_Io *io)
+{
+    SDL_RWops *f = (SDL_RWops *) io->userdata;
+    SDL_RWclose(f);
+    free(io);
+}
+
+struct VideoOpenHandler : FileSystem::OpenHandler
+{
+    SDL_RWops *srcOps;
+
+    VideoOpenHandler(SDL_RWops &srcOps)
+    : srcOps(&srcOps)
+    {}
+
+    bool tryRead(SDL_RWops &ops, const char *ext)
+    {
+        *srcOps = ops;
+        return true;
+    }
+};
+
+struct VideoPrivate
+{
+    THEORAPLAY_Decoder *decoder;
+    SDL_RWops srcOps;
+    std::string filename;
+
+    /* Borrowed upload target (the binding owns it) */
+    Bitmap *bitmap;
+
+    TEX::ID yuvTex[3];
+    bool texInit;
+
+    /* Lookahead frame not yet due for display */
+    const THEORAPLAY_VideoFrame *pending;
+
+    /* Tail of the previous loop iteration: the wrap seek flushes
+     * whatever the decoder still holds, so those frames are pulled
+     * over here first and played out while the next generation
+     * decodes behind them (at most VIDEO_DECODE_AHEAD frames) */
+    std::vector<const THEORAPLAY_VideoFrame *> holdover;
+    size_t holdoverIdx;
+
+    int width, height;
+
+    /* Stream position, advanced by wall time */
+    double posMs;
+    Uint32 lastTicks;
+
+    bool looping;
+    bool paused;
+    bool ended;
+
+    /* A wrap seek was issued; the clock re-anchors when the first
+     * post-wrap frame shows up */
+    bool wrapArmed;
+
+    /* Timestamp of the last frame pulled off the decoder; a frame
+     * arriving below it is the post-wrap generation */
+    double lastStreamMs;
+
+    VideoPrivate()
+        : decoder(0), bitmap(0), texInit(false), pending(0),
+          holdoverIdx(0), width(0), height(0), posMs(0), lastTicks(0),
+          looping(false), paused(false), ended(false), wrapArmed(false),
+          lastStreamMs(0)
+    {}
+
+    void clearHoldover()
+    {
+        for (size_t i = holdoverIdx; i < holdover.size(); ++i)
+            THEORAPLAY_freeVideo(holdover[i]);
+        holdover.clear();
+        holdoverIdx = 0;
+    }
+
+    /* The wrap seek can race the worker's natural shutdown (it exits
+     * once everything is drained, and the rescue drains everything);
+     * when that happens, reopen the stream from the top. Rare, and
+     * the OS cache makes it quick */
+    bool reopenAtStart()
+    {
+        if (decoder) {
+            THEORAPLAY_stopDecode(decoder);
+            decoder = NULL;
+        }
+
+        VideoOpenHandler handler(srcOps);
+        try {
+            shState->fileSystem().openRead(handler, filename.c_str());
+        } catch (...) {
+            return false;
+        }
+
+        THEORAPLAY_Io *io = (THEORAPLAY_Io *) malloc(sizeof (THEORAPLAY_Io));
+        if (!io) {
+            SDL_RWclose(&srcOps);
+            return false;
+        }
+
+        io->read = videoRead;
+        io->seek = videoSeek;
+        io->close = videoClose;
+        io->userdata = &srcOps;
+
+        decoder = THEORAPLAY_startDecode(io, VIDEO_DECODE_AHEAD,
+                                         THEORAPLAY_VIDFMT_IYUV);
+        if (!decoder) {
+            SDL_RWclose(&srcOps);
+            return false;
+        }
+
+        return true;
+    }
+
+    void uploadFrame(const THEORAPLAY_VideoFrame *frame)
+    {
+        if (nullOrDisposed(bitmap))
+            return;
+
+        if (!texInit) {
+            for (int i = 0; i < 3; ++i) {
+                yuvTex[i] = TEX::gen();
+                TEX::bind(yuvTex[i]);
+                TEX::setRepeat(false);
+                TEX::setSmooth(true);
+            }
+            texInit = true;
+        }
+
+        const int w = width, h = height;
+        const uint8_t *yP = (const uint8_t *) frame->pixels;
+        const uint8_t *uP = yP + w * h;
+        const uint8_t *vP = uP + (w / 2) * (h / 2);
+
+        GLMeta::blitYUVPlanes(bitmap->getGLTypes(), yuvTex, w, h,
+                              yP, uP, vP);
+
+        bitmap->taintArea(IntRect(0, 0, w, h));
+        bitmap->modified();
+        shState->graphics().markSceneDirty();
+    }
+};
+
+Video::Video(const char *filename, bool looping)
+{
+    p = new VideoPrivate;
+    p->looping = looping;
+    p->filename = filename;
+
+    VideoOpenHandler handler(p->srcOps);
+    try {
+        shState->fileSystem().openRead(handler, filename);
+    } catch (...) {
+        delete p;
+        throw;
+    }
+
+    THEORAPLAY_Io *io = (THEORAPLAY_Io *) malloc(sizeof (THEORAPLAY_Io));
+    if (!io) {
+        SDL_RWclose(&p->srcOps);
+        delete p;
+        throw Exception(Exception::MKXPError, "out of memory");
+    }
+
+    io->read = videoRead;
+    io->seek = videoSeek;
+    io->close = videoClose;
+    io->userdata = &p->srcOps;
+
+    p->decoder = THEORAPLAY_startDecode(io, VIDEO_DECODE_AHEAD,
+                                        THEORAPLAY_VIDFMT_IYUV);
+    if (!p->decoder) {
+        SDL_RWclose(&p->srcOps);
+        delete p;
+        throw Exception(Exception::MKXPError,
+                        "failed to start video decode: %s", filename);
+    }
+
+    /* Wait for the headers, then the first frame; a stream that dies
+     * before either is unusable */
+    while (!THEORAPLAY_isInitialized(p->decoder)) {
+        if (!THEORAPLAY_isDecoding(p->decoder))
+            break;
+        SDL_Delay(5);
+    }
+
+    if (!THEORAPLAY_hasVideoStream(p->decoder)) {
+        THEORAPLAY_stopDecode(p->decoder);
+        delete p;
+        throw Exception(Exception::MKXPError,
+                        "no video stream in %s", filename);
+    }
+
+    while ((p->pending = THEORAPLAY_getVideo(p->decoder)) == NULL) {
+        if (!THEORAPLAY_isDecoding(p->decoder)) {
+            THEORAPLAY_stopDecode(p->decoder);
+            delete p;
+            throw Exception(Exception::MKXPError,
+                            "video decode failed: %s", filename);
+        }
+        SDL_Delay(5);
+    }
+
+    p->width = p->pending->width;
+    p->height = p->pending->height;
+
+    /* Show the first frame on the first update */
+    p->posMs = p->pending->playms;
+    p->lastTicks = SDL_GetTicks();
+}
+
+Video::~Video()
+{
+    dispose();
+    delete p;
+}
+
+int Video::getWidth() const
+{
+    return p->width;
+}
+
+int Video::getHeight() const
+{
+    return p->height;
+}
+
+void Video::setBitmap(Bitmap *value)
+{
+    guardDisposed();
+
+    p->bitmap = value;
+
+    /* Put the first frame up right away */
+    if (p->pending) {
+        GFX_LOCK;
+        p->uploadFrame(p->pending);
+        GFX_UNLOCK;
+    }
+}
+
+Bitmap *Video::getBitmap() const
+{
+    return p->bitmap;
+}
+
+void Video::update()
+{
+    guardDisposed();
+
+    if (!p->decoder)
+        return;
+
+    const Uint32 now = SDL_GetTicks();
+
+    if (p->paused) {
+        p->lastTicks = now;
+        return;
+    }
+
+    p->posMs += now - p->lastTicks;
+    p->lastTicks = now;
+
+    /* We only ever use the video track */
+    const THEORAPLAY_AudioPacket *ap;
+    while ((ap = THEORAPLAY_getAudio(p->decoder)) != NULL)
+        THEORAPLAY_freeAudio(ap);
+
+    /* The file is fully decoded: rescue the buffered tail (the wrap
+     * seek flushes the delivery lists), then send the demuxer back to
+     * the start. The rescued tail plays out while the next generation
+     * decodes behind it, so the loop is seamless */
+    if (p->looping && !p->wrapArmed && THEORAPLAY_decodeDone(p->decoder)) {
+        if (p->pending) {
+            p->holdover.push_back(p->pending);
+            p->pending = NULL;
+        }
+
+        const THEORAPLAY_VideoFrame *vf;
+        while ((vf = THEORAPLAY_getVideo(p->decoder)) != NULL)
+            p->holdover.push_back(vf);
+
+        if (THEORAPLAY_seek(p->decoder, 0))
+            p->wrapArmed = true;
+    }
+
+    /* The wrap seek raced the worker's exit: restart from the top */
+    if (p->wrapArmed && !p->pending &&
+        p->holdoverIdx >= p->holdover.size() &&
+        !THEORAPLAY_isDecoding(p->decoder))
+    {
+        if (!p->reopenAtStart()) {
+            p->wrapArmed = false;
+            p->ended = true;
+            return;
+        }
+        /* lastStreamMs is still at the old tail; the first fresh
+         * frame re-anchors the clock like a normal wrap */
+    }
+
+    GFX_LOCK;
+
+    const THEORAPLAY_VideoFrame *due = NULL;
+
+    /* Play the rescued previous-loop tail first */
+    while (p->holdoverIdx < p->holdover.size()) {
+        const THEORAPLAY_VideoFrame *vf = p->holdover[p->holdoverIdx];
+        p->lastStreamMs = vf->playms;
+        if ((double) vf->playms > p->posMs)
+            break;
+        if (due)
+            THEORAPLAY_freeVideo(due);
+        due = vf;
+        p->holdoverIdx++;
+    }
+
+    if (p->holdoverIdx >= p->holdover.size()) {
+        p->holdover.clear();
+        p->holdoverIdx = 0;
+
+        for (;;) {
+            if (!p->pending)
+                p->pending = THEORAPLAY_getVideo(p->decoder);
+            if (!p->pending)
+                break;
+
+            /* Stream time running backwards marks the first
+             * post-wrap frame: re-anchor the clock at the loop start */
+            if (p->wrapArmed && (double) p->pending->playms < p->lastStreamMs) {
+                p->posMs = p->pending->playms;
+                p->wrapArmed = false;
+            }
+            p->lastStreamMs = p->pending->playms;
+
+            /* Leftover pre-seek lookahead, far ahead of the new position */
+            if ((double) p->pending->playms > p->posMs + VIDEO_STALE_AHEAD_MS) {
+                THEORAPLAY_freeVideo(p->pending);
+                p->pending = NULL;
+                continue;
+            }
+
+            if ((double) p->pending->playms > p->posMs)
+                break;
+
+            if (due)
+                THEORAPLAY_freeVideo(due);
+            due = p->pending;
+            p->pending = NULL;
+        }
+    }
+
+    if (due) {
+        p->uploadFrame(due);
+        THEORAPLAY_freeVideo(due);
+    } else if (!p->pending && p->holdover.empty() && !p->looping &&
+               !THEORAPLAY_isDecoding(p->decoder)) {
+        p->ended = true;
+    }
+
+    GFX_UNLOCK;
+}
+
+bool Video::getLooping() const
+{
+    return p->looping;
+}
+
+void Video::setLooping(bool value)
+{
+    guardDisposed();
+
+    p->looping = value;
+    if (value)
+        p->ended = false;
+}
+
+bool Video::getPaused() const
+{
+    return p->paused;
+}
+
+void Video::setPaused(bool value)
+{
+    guardDisposed();
+
+    p->paused = value;
+}
+
+unsigned int Video::getPosition() const
+{
+    return (unsigned int) p->posMs;
+}
+
+void Video::seek(unsigned int ms)
+{
+    guardDisposed();
+
+    if (!p->decoder)
+        return;
+
+    /* A seek on a run-out stream restarts it first */
+    if (!THEORAPLAY_isDecoding(p->decoder)) {
+        if (!p->reopenAtStart())
+            return;
+        while (!THEORAPLAY_isInitialized(p->decoder)) {
+            if (!THEORAPLAY_isDecoding(p->decoder))
+                return;
+            SDL_Delay(5);
+        }
+    }
+
+    if (!THEORAPLAY_seek(p->decoder, ms))
+        return;
+
+    if (p->pending) {
+        THEORAPLAY_freeVideo(p->pending);
+        p->pending = NULL;
+    }
+    p->clearHoldover();
+
+    p->posMs = ms;
+    p->lastTicks = SDL_GetTicks();
+    p->ended = false;
+    p->wrapArmed = false;
+}
+
+bool Video::atEnd() const
+{
+    return p->ended;
+}
+
+void Video::releaseResources()
+{
+    if (p->pending) {
+        THEORAPLAY_freeVideo(p->pending);
+        p->pending = NULL;
+    }
+    p->clearHoldover();
+
+    if (p->decoder) {
+        THEORAPLAY_stopDecode(p->decoder);
+        p->decoder = NULL;
+    }
+
+    if (p->texInit) {
+        for (int i = 0; i < 3; ++i)
+            TEX::del(p->yuvTex[i]);
+        p->texInit = false;
+    }
+}
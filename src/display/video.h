@@ -0,0 +1,76 @@
+/*
+** video.h
+**
+** This file is part of mkxp.
+**
+** Copyright (C) 2013 - 2021 Amaryllis Kulla <ancurio@mapleshrine.eu>
+**
+** mkxp is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 2 of the License, or
+** (at your option) any later version.
+**
+** mkxp is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with mkxp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef VIDEO_H
+#define VIDEO_H
+
+#include "disposable.h"
+
+class Bitmap;
+struct VideoPrivate;
+
+/* A non-modal streamed video decode feeding a Bitmap: unlike
+ * Graphics.play_movie, frames advance one update() at a time, so the
+ * stream can back an ordinary Sprite or Plane composited through the
+ * normal scene path (animated map backgrounds and the like), with
+ * optional seamless looping. Only the video track is used; audio
+ * streams are drained and discarded. */
+class Video : public Disposable
+{
+public:
+	Video(const char *filename, bool looping);
+	~Video();
+
+	int getWidth() const;
+	int getHeight() const;
+
+	/* The upload target; sized width x height. Owned by the caller
+	 * (the binding wraps it as a plain Bitmap), borrowed here */
+	void setBitmap(Bitmap *value);
+	Bitmap *getBitmap() const;
+
+	/* Advance against real time and upload the frame that's due;
+	 * call once per logical frame */
+	void update();
+
+	bool getLooping() const;
+	void setLooping(bool value);
+
+	bool getPaused() const;
+	void setPaused(bool value);
+
+	/* Current stream position in milliseconds */
+	unsigned int getPosition() const;
+
+	/* Jump to 'ms' (lands on the nearest earlier keyframe) */
+	void seek(unsigned int ms);
+
+	/* Playback ran off the end; never true while looping */
+	bool atEnd() const;
+
+private:
+	void releaseResources();
+	const char *klassName() const { return "video"; }
+
+	VideoPrivate *p;
+};
+
+#endif // VIDEO_H
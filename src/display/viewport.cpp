@@ -22,15 +22,18 @@
 #include "viewport.h"
 
 #include "sharedstate.h"
+#include "config.h"
 #include "etc.h"
 #include "util.h"
 #include "quad.h"
 #include "glstate.h"
+#include "gl-meta.h"
+#include "texpool.h"
 #include "graphics.h"
 
 #include <SDL_rect.h>
 
-#include "sigslot/signal.hpp"
+#include "flatsignal.h"
 
 struct ViewportPrivate
 {
@@ -38,7 +41,7 @@ struct ViewportPrivate
 	Viewport *self;
 
 	Rect *rect;
-	sigslot::connection rectCon;
+	FlatConnection rectCon;
 
 	Color *color;
 	Tone *tone;
@@ -46,6 +49,15 @@ struct ViewportPrivate
 	IntRect screenRect;
 	int isOnScreen;
 
+	/* Opt-in render cache: the composited viewport region is
+	 * captured into a texture and re-presented until the cache
+	 * is explicitly refreshed or the viewport itself changes.
+	 * Child mutations are the script's contract to refresh */
+	bool cacheEnabled;
+	bool cacheValid;
+	TEXFBO cacheTex;
+	Vec2i cacheSize;
+
 	EtcTemps tmp;
 
 	ViewportPrivate(int x, int y, int width, int height, Viewport *self)
@@ -53,7 +65,9 @@ struct ViewportPrivate
 	      rect(&tmp.rect),
 	      color(&tmp.color),
 	      tone(&tmp.tone),
-	      isOnScreen(false)
+	      isOnScreen(false),
+	      cacheEnabled(false),
+	      cacheValid(false)
 	{
 		rect->set(x, y, width, height);
 		updateRectCon();
@@ -62,6 +76,23 @@ struct ViewportPrivate
 	~ViewportPrivate()
 	{
 		rectCon.disconnect();
+
+		shState->texPool().release(cacheTex);
+	}
+
+	void invalidateCache()
+	{
+		cacheValid = false;
+	}
+
+	void ensureCacheTex(const Vec2i &size)
+	{
+		if (cacheSize == size && cacheTex.tex != TEX::ID(0))
+			return;
+
+		shState->texPool().release(cacheTex);
+		cacheTex = shState->texPool().request(size.x, size.y);
+		cacheSize = size;
 	}
 
 	void onRectChange()
@@ -69,6 +100,7 @@ struct ViewportPrivate
 		self->geometry.rect = rect->toIntRect();
 		self->notifyGeometryChange();
 		recomputeOnScreen();
+		invalidateCache();
 	}
 
 	void updateRectCon()
@@ -160,6 +192,7 @@ void Viewport::setOX(int value)
 
 	geometry.orig.x = value;
 	notifyGeometryChange();
+	p->invalidateCache();
 }
 
 void Viewport::setOY(int value)
@@ -171,6 +204,7 @@ void Viewport::setOY(int value)
 
 	geometry.orig.y = value;
 	notifyGeometryChange();
+	p->invalidateCache();
 }
 
 void Viewport::initDynAttribs()
@@ -193,9 +227,31 @@ void Viewport::composite()
 	if (elements.getSize() == 0 && !renderEffect)
 		return;
 
+	const IntRect vpRect = p->rect->toIntRect();
+
+	/* Opt-in cache: a clean, effect-free viewport re-presents
+	 * its captured region as a single blit */
+	/* With hires rendering the composite buffer is scaled while
+	 * viewport rects stay in lores coordinates; the plain region
+	 * blit below would grab the wrong pixels, so skip caching */
+	TEXFBO *target = (p->cacheEnabled && !renderEffect && scene &&
+	                  vpRect.w > 0 && vpRect.h > 0 &&
+	                  !shState->config().enableHires)
+	                 ? scene->renderTarget() : 0;
+
+	if (target && p->cacheValid && p->cacheSize == Vec2i(vpRect.w, vpRect.h))
+	{
+		GLMeta::blitBegin(*target);
+		GLMeta::blitSource(p->cacheTex);
+		GLMeta::blitRectangle(IntRect(0, 0, vpRect.w, vpRect.h), vpRect, false);
+		GLMeta::blitEnd();
+
+		return;
+	}
+
 	/* Setup scissor */
 	glState.scissorTest.pushSet(true);
-	glState.scissorBox.pushSet(p->rect->toIntRect());
+	glState.scissorBox.pushSet(vpRect);
 
 	Scene::composite();
 
@@ -207,6 +263,23 @@ void Viewport::composite()
 
 	glState.scissorBox.pop();
 	glState.scissorTest.pop();
+
+	if (target)
+	{
+		/* Capture the freshly composited region */
+		p->ensureCacheTex(Vec2i(vpRect.w, vpRect.h));
+
+		GLMeta::blitBegin(p->cacheTex);
+		GLMeta::blitSource(*target);
+		GLMeta::blitRectangle(vpRect, IntRect(0, 0, vpRect.w, vpRect.h), false);
+		GLMeta::blitEnd();
+
+		p->cacheValid = true;
+	}
+	else
+	{
+		p->cacheValid = false;
+	}
 }
 
 /* SceneElement */
@@ -221,6 +294,31 @@ void Viewport::onGeometryChange(const Geometry &geo)
 	p->recomputeOnScreen();
 }
 
+void Viewport::setCacheStatic(bool value)
+{
+	guardDisposed();
+
+	if (p->cacheEnabled == value)
+		return;
+
+	p->cacheEnabled = value;
+	p->cacheValid = false;
+}
+
+bool Viewport::getCacheStatic() const
+{
+	guardDisposed();
+
+	return p->cacheEnabled;
+}
+
+void Viewport::refreshCache()
+{
+	guardDisposed();
+
+	p->invalidateCache();
+}
+
 void Viewport::releaseResources()
 {
 	unlink();
@@ -53,6 +53,13 @@ private:
 
 	void composite();
 	void draw();
+
+	/* Opt-in render cache: while enabled, the composited
+	 * viewport region is re-presented until refreshCache is
+	 * called (or the viewport itself changes). The script owns
+	 * refreshing after child mutations */
+	DECL_ATTR( CacheStatic, bool )
+	void refreshCache();
 	void onGeometryChange(const Geometry &);
 	bool isEffectiveViewport(Rect *&, Color *&, Tone *&) const;
 
@@ -80,8 +87,8 @@ protected:
 
 private:
 	Viewport *m_viewport;
-	sigslot::connection viewportDispCon;
-	sigslot::connection viewportElementDispCon;
+	FlatConnection viewportDispCon;
+	FlatConnection viewportElementDispCon;
 	void viewportElementDisposal();
 };
 
@@ -34,7 +34,9 @@
 #include "texpool.h"
 #include "glstate.h"
 
-#include "sigslot/signal.hpp"
+#include <SDL_rect.h>
+
+#include "flatsignal.h"
 
 template<typename T>
 struct Sides
@@ -172,15 +174,15 @@ struct WindowPrivate
 
 	Bitmap *contents;
 
-	sigslot::connection windowskinDispCon;
-	sigslot::connection contentsDispCon;
+	FlatConnection windowskinDispCon;
+	FlatConnection contentsDispCon;
 
 	bool bgStretch;
 	Rect *cursorRect;
 	bool active;
 	bool pause;
 
-	sigslot::connection cursorRectCon;
+	FlatConnection cursorRectCon;
 
 	Vec2i sceneOffset;
 
@@ -228,6 +230,11 @@ struct WindowPrivate
 			unlink();
 		}
 
+		Scene *getScene() const
+		{
+			return scene;
+		}
+
 		ABOUT_TO_ACCESS_NOOP
 	};
 
@@ -247,9 +254,16 @@ struct WindowPrivate
 
 	bool controlsVertDirty;
 
+	/* Cursor frame and pause sprite live in their own tiny
+	 * array, so blink/pause animation re-uploads only those
+	 * quads and scroll arrow changes never rebuild them */
+	ColorQuadArray animQuadArray;
+	size_t animQuadCount;
+	bool animVertDirty;
+
 	EtcTemps tmp;
 
-	sigslot::connection prepareCon;
+	FlatConnection prepareCon;
 
 	WindowPrivate(Viewport *viewport = 0)
 	    : windowskin(0),
@@ -268,11 +282,16 @@ struct WindowPrivate
 	      cursorAniAlphaIdx(0),
 	      pauseAniAlphaIdx(0),
 	      pauseAniQuadIdx(0),
-	      controlsVertDirty(true)
+	      controlsVertDirty(true),
+	      animQuadCount(0),
+	      animVertDirty(true)
 	{
 		refreshCursorRectCon();
 
-		controlsQuadArray.resize(14);
+		/* 4 scroll arrows */
+		controlsQuadArray.resize(4);
+		/* cursor frame + pause sprite */
+		animQuadArray.resize(9 + 1);
 		cursorVert.count = 9;
 		pauseAniVert.count = 1;
 
@@ -307,11 +326,16 @@ struct WindowPrivate
 		controlsVertDirty = true;
 	}
 
+	void markAnimVertDirty()
+	{
+		animVertDirty = true;
+	}
+
 	void refreshCursorRectCon()
 	{
 		cursorRectCon.disconnect();
 		cursorRectCon = cursorRect->valueChanged.connect
-		        (&WindowPrivate::markControlVertDirty, this);
+		        (&WindowPrivate::markAnimVertDirty, this);
 	}
 
 	void buildBaseVert()
@@ -478,17 +502,6 @@ struct WindowPrivate
 		int i = 0;
 		Vertex *vert = controlsQuadArray.vertices.data();
 
-		/* Cursor */
-		if (!cursorRect->isEmpty())
-		{
-			/* Effective cursor rect has 16 xy offset to window */
-			IntRect effectRect(cursorRect->x+16, cursorRect->y+16,
-			                   cursorRect->width, cursorRect->height);
-			cursorVert.vert = &vert[i*4];
-			TileQuads::buildFrameSource(cursorSrc, cursorVert.vert);
-			i += TileQuads::buildFrame(effectRect, cursorVert.vert);
-		}
-
 		/* Scroll arrow position: Top Bottom X, Left Right Y */
 		const Vec2i scroll = (size - Vec2i(16)) / 2;
 
@@ -514,6 +527,29 @@ struct WindowPrivate
 				i += Quad::setTexPosRect(&vert[i*4], scrollArrowSrc.b, scrollArrows.b);
 		}
 
+		controlsQuadArray.commit();
+		controlsQuadCount = i;
+	}
+
+	void buildAnimVert()
+	{
+		int i = 0;
+		Vertex *vert = animQuadArray.vertices.data();
+
+		cursorVert.vert = 0;
+		pauseAniVert.vert = 0;
+
+		/* Cursor */
+		if (!cursorRect->isEmpty())
+		{
+			/* Effective cursor rect has 16 xy offset to window */
+			IntRect effectRect(cursorRect->x+16, cursorRect->y+16,
+			                   cursorRect->width, cursorRect->height);
+			cursorVert.vert = &vert[i*4];
+			TileQuads::buildFrameSource(cursorSrc, cursorVert.vert);
+			i += TileQuads::buildFrame(effectRect, cursorVert.vert);
+		}
+
 		/* Pause animation */
 		if (pause)
 		{
@@ -522,8 +558,8 @@ struct WindowPrivate
 			                         FloatRect((size.x - 16) / 2, size.y - 16, 16, 16));
 		}
 
-		controlsQuadArray.commit();
-		controlsQuadCount = i;
+		animQuadArray.commit();
+		animQuadCount = i;
 	}
 
 	void prepare()
@@ -566,6 +602,23 @@ struct WindowPrivate
 		}
 	}
 
+	/* Whole window outside the visible scene region? */
+	bool isOffScreen() const
+	{
+		const Scene *scn = controlsElement.getScene();
+
+		if (!scn)
+			return false;
+
+		const IntRect &sr = scn->getGeometry().rect;
+
+		SDL_Rect a = { position.x + sceneOffset.x,
+		               position.y + sceneOffset.y, size.x, size.y };
+		SDL_Rect b = { sr.x, sr.y, sr.w, sr.h };
+
+		return !SDL_HasIntersection(&a, &b);
+	}
+
 	void drawBase()
 	{
 		if (nullOrDisposed(windowskin))
@@ -574,6 +627,12 @@ struct WindowPrivate
 		if (size == Vec2i(0, 0))
 			return;
 
+		if (isOffScreen())
+		{
+			++sceneCulledCount;
+			return;
+		}
+
 		SimpleAlphaShader &shader = shState->shaders().simpleAlpha;
 		shader.bind();
 		shader.applyViewportProj();
@@ -605,13 +664,25 @@ struct WindowPrivate
 		if (size == Vec2i(0, 0))
 			return;
 
+		if (isOffScreen())
+		{
+			++sceneCulledCount;
+			return;
+		}
+
 		if (controlsVertDirty)
 		{
 			buildControlsVert();
-			updateControls();
 			controlsVertDirty = false;
 		}
 
+		if (animVertDirty)
+		{
+			buildAnimVert();
+			updateControls();
+			animVertDirty = false;
+		}
+
 		/* Effective on screen coordinates */
 		const Vec2i efPos = position + sceneOffset;
 
@@ -635,6 +706,7 @@ struct WindowPrivate
 			TEX::setSmooth(true);
 
 			controlsQuadArray.draw(0, controlsQuadCount);
+			animQuadArray.draw(0, animQuadCount);
 
 			TEX::setSmooth(false);
 		}
@@ -679,7 +751,7 @@ struct WindowPrivate
 		}
 
 		if (updateArray)
-			controlsQuadArray.commit();
+			animQuadArray.commit();
 	}
 
 	void stepAnimations()
@@ -808,7 +880,7 @@ void Window::setPause(bool value)
 	p->pause = value;
 	p->pauseAniAlphaIdx = 0;
 	p->pauseAniQuadIdx = 0;
-	p->controlsVertDirty = true;
+	p->animVertDirty = true;
 }
 
 void Window::setWidth(int value)
@@ -34,7 +34,9 @@
 
 #include <limits>
 #include <algorithm>
-#include "sigslot/signal.hpp"
+#include <SDL_rect.h>
+
+#include "flatsignal.h"
 
 #define DEF_Z         (rgssVer >= 3 ? 100 :   0)
 #define DEF_PADDING   (rgssVer >= 3 ?  12 :  16)
@@ -154,8 +156,8 @@ struct WindowVXPrivate
 
 	Bitmap *contents;
 	
-	sigslot::connection windowskinDispCon;
-	sigslot::connection contentsDispCon;
+	FlatConnection windowskinDispCon;
+	FlatConnection contentsDispCon;
 
 	Rect *cursorRect;
 	bool active;
@@ -182,9 +184,9 @@ struct WindowVXPrivate
 	NormValue openness;
 	Tone *tone;
 
-	sigslot::connection cursorRectCon;
-	sigslot::connection toneCon;
-	sigslot::connection prepareCon;
+	FlatConnection cursorRectCon;
+	FlatConnection toneCon;
+	FlatConnection prepareCon;
 
 	EtcTemps tmp;
 
@@ -669,6 +671,21 @@ struct WindowVXPrivate
 		cursorVertArrayDirty = true;
 	}
 
+	/* Whole window outside the visible scene region? */
+	bool isOffScreen(const Scene *scn) const
+	{
+		if (!scn)
+			return false;
+
+		const IntRect &sr = scn->getGeometry().rect;
+
+		SDL_Rect a = { geo.x + sceneOffset.x, geo.y + sceneOffset.y,
+		               geo.w, geo.h };
+		SDL_Rect b = { sr.x, sr.y, sr.w, sr.h };
+
+		return !SDL_HasIntersection(&a, &b);
+	}
+
 	void stepAnimations()
 	{
 		if (active)
@@ -855,10 +872,20 @@ void WindowVX::update()
 {
 	guardDisposed();
 
+	/* Only touch (and re-upload) the animated quads whose
+	 * animation state actually advanced; an inactive window's
+	 * update then costs nothing */
+	uint8_t prevCursorAlpha = p->cursorAlphaIdx;
+	uint8_t prevPauseAlpha = p->pauseAlphaIdx;
+	uint8_t prevPauseQuad = p->pauseQuadIdx;
+
 	p->stepAnimations();
 
-	p->updatePauseQuad();
-	p->updateCursorAlpha();
+	if (p->pauseAlphaIdx != prevPauseAlpha || p->pauseQuadIdx != prevPauseQuad)
+		p->updatePauseQuad();
+
+	if (p->cursorAlphaIdx != prevCursorAlpha)
+		p->updateCursorAlpha();
 }
 
 void WindowVX::move(int x, int y, int width, int height)
@@ -1133,6 +1160,12 @@ void WindowVX::initDynAttribs()
 
 void WindowVX::draw()
 {
+	if (p->isOffScreen(scene))
+	{
+		++sceneCulledCount;
+		return;
+	}
+
 	p->draw();
 }
 
@@ -294,4 +294,162 @@ struct NormValue
 	}
 };
 
+/* Vectorized tone application over RGBA8 rows, for the CPU
+ * surface paths (mega surface pixels, cached bitmap
+ * surfaces). Mirrors the fragment shader math in fixed
+ * point with /256 denominators (within one step of the
+ * float shader):
+ *
+ *   luma = (77r + 150g + 29b) >> 8
+ *   c    = c + ((luma - c) * gray') >> 8
+ *   c    = clamp(c + tone_c, 0, 255)
+ *
+ * where gray' is 256 at full gray so the mix lands exactly
+ * on luma. Alpha is untouched. SSE2 is baseline on x86-64
+ * and NEON on aarch64, scalar elsewhere. */
+
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MKXPZ_ETC_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__aarch64__)
+#define MKXPZ_ETC_NEON
+#include <arm_neon.h>
+#endif
+
+/* Tone channels are in [-255, 255], gray in [0, 255] */
+static inline void
+applyToneRGBA8(uint8_t *pixels, size_t count,
+               int toneR, int toneG, int toneB, int gray)
+{
+	int grayW = (gray >= 255) ? 256 : clamp(gray, 0, 255);
+
+	size_t i = 0;
+
+#if defined(MKXPZ_ETC_SSE2)
+	if (count >= 4)
+	{
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i lumaCo = _mm_set_epi16(0, 29, 150, 77,
+		                                     0, 29, 150, 77);
+		const __m128i toneV = _mm_set_epi16(0, (int16_t) toneB,
+		                                    (int16_t) toneG, (int16_t) toneR,
+		                                    0, (int16_t) toneB,
+		                                    (int16_t) toneG, (int16_t) toneR);
+		/* Zero weight in the alpha lane keeps it fixed */
+		const __m128i grayV = _mm_set_epi16(0, (int16_t) grayW,
+		                                    (int16_t) grayW, (int16_t) grayW,
+		                                    0, (int16_t) grayW,
+		                                    (int16_t) grayW, (int16_t) grayW);
+
+		for (; i + 4 <= count; i += 4)
+		{
+			__m128i px = _mm_loadu_si128(
+				reinterpret_cast<__m128i*>(pixels + i*4));
+
+			__m128i half[2];
+			half[0] = _mm_unpacklo_epi8(px, zero);
+			half[1] = _mm_unpackhi_epi8(px, zero);
+
+			for (int n = 0; n < 2; ++n)
+			{
+				__m128i v = half[n];
+
+				/* madd pairs the channels as
+				 * [77r+150g, 29b+0] per pixel; folding the
+				 * pairs gives luma*256 in both dwords */
+				__m128i m = _mm_madd_epi16(v, lumaCo);
+				__m128i luma32 = _mm_srli_epi32(
+					_mm_add_epi32(m, _mm_shuffle_epi32(
+						m, _MM_SHUFFLE(2, 3, 0, 1))), 8);
+
+				/* Broadcast each pixel's luma over its
+				 * four u16 lanes */
+				__m128i l16 = _mm_packs_epi32(luma32, luma32);
+				l16 = _mm_shufflelo_epi16(l16, _MM_SHUFFLE(0, 0, 0, 0));
+				l16 = _mm_shufflehi_epi16(l16, _MM_SHUFFLE(2, 2, 2, 2));
+
+				/* c += (luma - c) * gray' >> 8; the 24 bit
+				 * product is pieced together from the
+				 * low/high 16 bit halves */
+				__m128i diff = _mm_sub_epi16(l16, v);
+				__m128i lo = _mm_mullo_epi16(diff, grayV);
+				__m128i hi = _mm_mulhi_epi16(diff, grayV);
+				__m128i mix = _mm_add_epi16(_mm_slli_epi16(hi, 8),
+				                            _mm_srli_epi16(lo, 8));
+
+				v = _mm_add_epi16(v, mix);
+				v = _mm_add_epi16(v, toneV);
+
+				half[n] = v;
+			}
+
+			/* packus saturates to [0, 255] */
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(pixels + i*4),
+			                 _mm_packus_epi16(half[0], half[1]));
+		}
+	}
+#elif defined(MKXPZ_ETC_NEON)
+	if (count >= 8)
+	{
+		const uint8x8_t coR = vdup_n_u8(77);
+		const uint8x8_t coG = vdup_n_u8(150);
+		const uint8x8_t coB = vdup_n_u8(29);
+		const int16x8_t grayV = vdupq_n_s16((int16_t) grayW);
+		const int16x8_t toneRv = vdupq_n_s16((int16_t) toneR);
+		const int16x8_t toneGv = vdupq_n_s16((int16_t) toneG);
+		const int16x8_t toneBv = vdupq_n_s16((int16_t) toneB);
+
+		for (; i + 8 <= count; i += 8)
+		{
+			uint8x8x4_t px = vld4_u8(pixels + i*4);
+
+			uint16x8_t sum = vmull_u8(px.val[0], coR);
+			sum = vmlal_u8(sum, px.val[1], coG);
+			sum = vmlal_u8(sum, px.val[2], coB);
+
+			int16x8_t luma = vreinterpretq_s16_u16(vshrq_n_u16(sum, 8));
+
+			for (int c = 0; c < 3; ++c)
+			{
+				int16x8_t v = vreinterpretq_s16_u16(vmovl_u8(px.val[c]));
+				int16x8_t diff = vsubq_s16(luma, v);
+
+				/* Widening multiply; the product doesn't
+				 * fit 16 bits at full gray */
+				int32x4_t pLo = vmull_s16(vget_low_s16(diff),
+				                          vget_low_s16(grayV));
+				int32x4_t pHi = vmull_s16(vget_high_s16(diff),
+				                          vget_high_s16(grayV));
+				int16x8_t mix = vcombine_s16(vshrn_n_s32(pLo, 8),
+				                             vshrn_n_s32(pHi, 8));
+
+				v = vaddq_s16(v, mix);
+				v = vaddq_s16(v, c == 0 ? toneRv
+				                 : c == 1 ? toneGv : toneBv);
+
+				px.val[c] = vqmovun_s16(v);
+			}
+
+			vst4_u8(pixels + i*4, px);
+		}
+	}
+#endif
+
+	for (; i < count; ++i)
+	{
+		uint8_t *px = pixels + i*4;
+
+		int luma = (77*px[0] + 150*px[1] + 29*px[2]) >> 8;
+
+		int r = px[0] + (((luma - px[0]) * grayW) >> 8) + toneR;
+		int g = px[1] + (((luma - px[1]) * grayW) >> 8) + toneG;
+		int b = px[2] + (((luma - px[2]) * grayW) >> 8) + toneB;
+
+		px[0] = clamp(r, 0, 255);
+		px[1] = clamp(g, 0, 255);
+		px[2] = clamp(b, 0, 255);
+	}
+}
+
 #endif // ETC_TYPES_H
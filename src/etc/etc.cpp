@@ -23,10 +23,83 @@
 
 #include "serial-util.h"
 #include "exception.h"
+#include "sharedstate.h"
+#include "graphics.h"
 
 #include <SDL_types.h>
 #include <SDL_pixels.h>
 
+#include <algorithm>
+#include <vector>
+
+/* Color/Tone/Rect mutations reach the screen without passing
+ * through the graphics lock, so damage tracking hooks in here */
+static inline void notifySceneDamage()
+{
+	if (shState)
+		shState->graphics().markSceneDirty();
+}
+
+/* Deferred change notification. The queue only ever grows
+ * from the script thread (setters) and drains at
+ * Graphics::update; dying objects unqueue themselves */
+static bool notifyDeferred = false;
+static std::vector<ChangeNotify*> notifyQueue;
+
+ChangeNotify::~ChangeNotify()
+{
+	if (!notifyQueued)
+		return;
+
+	std::vector<ChangeNotify*>::iterator pos =
+		std::find(notifyQueue.begin(), notifyQueue.end(), this);
+
+	if (pos != notifyQueue.end())
+		notifyQueue.erase(pos);
+}
+
+void ChangeNotify::notifyChanged()
+{
+	if (!notifyDeferred)
+	{
+		valueChanged();
+		return;
+	}
+
+	if (notifyQueued)
+		return;
+
+	notifyQueued = true;
+	notifyQueue.push_back(this);
+}
+
+void ChangeNotify::setDeferred(bool mode)
+{
+	/* Leaving deferred mode delivers what's still pending */
+	if (!mode)
+		flushDeferred();
+
+	notifyDeferred = mode;
+}
+
+void ChangeNotify::flushDeferred()
+{
+	/* Popping from the live queue keeps unqueue-on-destroy
+	 * working even for objects torn down by a slot */
+	while (!notifyQueue.empty())
+	{
+		ChangeNotify *obj = notifyQueue.back();
+		notifyQueue.pop_back();
+
+		obj->notifyQueued = false;
+		obj->valueChanged();
+	}
+}
+
+DEF_POOL_ALLOC(Color)
+DEF_POOL_ALLOC(Tone)
+DEF_POOL_ALLOC(Rect)
+
 Color::Color(double red, double green, double blue, double alpha)
 	: red(red), green(green), blue(blue), alpha(alpha)
 {
@@ -182,7 +255,8 @@ void Tone::set(double red, double green, double blue, double gray)
 	this->gray  = gray;
 
 	updateInternal();
-	valueChanged();
+	notifyChanged();
+	notifySceneDamage();
 }
 
 const Tone& Tone::operator=(const Tone &o)
@@ -193,7 +267,8 @@ const Tone& Tone::operator=(const Tone &o)
 	gray  = o.gray;
 	norm  = o.norm;
 
-	valueChanged();
+	notifyChanged();
+	notifySceneDamage();
 
 	return o;
 }
@@ -203,7 +278,8 @@ void Tone::setRed(double value)
 	red = value;
 	norm.x = (float) clamp<double>(value, -255, 255) / 255;
 
-	valueChanged();
+	notifyChanged();
+	notifySceneDamage();
 }
 
 void Tone::setGreen(double value)
@@ -211,7 +287,8 @@ void Tone::setGreen(double value)
 	green = value;
 	norm.y = (float) clamp<double>(value, -255, 255) / 255;
 
-	valueChanged();
+	notifyChanged();
+	notifySceneDamage();
 }
 
 void Tone::setBlue(double value)
@@ -219,7 +296,8 @@ void Tone::setBlue(double value)
 	blue = value;
 	norm.z = (float) clamp<double>(value, -255, 255) / 255;
 
-	valueChanged();
+	notifyChanged();
+	notifySceneDamage();
 }
 
 void Tone::setGray(double value)
@@ -227,7 +305,8 @@ void Tone::setGray(double value)
 	gray = value;
 	norm.w = (float) clamp<double>(value, 0, 255) / 255;
 
-	valueChanged();
+	notifyChanged();
+	notifySceneDamage();
 }
 
 /* Serializable */
@@ -312,7 +391,8 @@ void Rect::set(int x, int y, int w, int h)
 	this->y = y;
 	width = w;
 	height = h;
-	valueChanged();
+	notifyChanged();
+	notifySceneDamage();
 }
 
 const Rect &Rect::operator=(const Rect &o)
@@ -322,7 +402,8 @@ const Rect &Rect::operator=(const Rect &o)
 	width  = o.width;
 	height = o.height;
 
-	valueChanged();
+	notifyChanged();
+	notifySceneDamage();
 
 	return o;
 }
@@ -333,7 +414,8 @@ void Rect::empty()
 		return;
 
 	x = y = width = height = 0;
-	valueChanged();
+	notifyChanged();
+	notifySceneDamage();
 }
 
 bool Rect::isEmpty() const
@@ -347,7 +429,8 @@ void Rect::setX(int value)
 		return;
 
 	x = value;
-	valueChanged();
+	notifyChanged();
+	notifySceneDamage();
 }
 
 void Rect::setY(int value)
@@ -356,7 +439,8 @@ void Rect::setY(int value)
 		return;
 
 	y = value;
-	valueChanged();
+	notifyChanged();
+	notifySceneDamage();
 }
 
 void Rect::setWidth(int value)
@@ -365,7 +449,8 @@ void Rect::setWidth(int value)
 		return;
 
 	width = value;
-	valueChanged();
+	notifyChanged();
+	notifySceneDamage();
 }
 
 void Rect::setHeight(int value)
@@ -374,7 +459,8 @@ void Rect::setHeight(int value)
 		return;
 
 	height = value;
-	valueChanged();
+	notifyChanged();
+	notifySceneDamage();
 }
 
 int Rect::serialSize() const
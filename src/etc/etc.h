@@ -22,7 +22,8 @@
 #ifndef ETC_H
 #define ETC_H
 
-#include "sigslot/signal.hpp"
+#include "flatsignal.h"
+#include "poolalloc.h"
 
 #include "serializable.h"
 #include "etc-internal.h"
@@ -40,6 +41,8 @@ enum BlendType
 
 struct Color : public Serializable
 {
+	DECL_POOL_ALLOC()
+
 	Color()
 	    : red(0), green(0), blue(0), alpha(0)
 	{}
@@ -91,8 +94,35 @@ struct Color : public Serializable
 	Vec4 norm;
 };
 
-struct Tone : public Serializable
+/* Base for the shared value types that feed display objects
+ * through 'valueChanged'. In deferred mode setters enqueue
+ * their object once instead of signalling on every call;
+ * Graphics::update() then flushes one coalesced signal per
+ * dirty object and frame. (Color carries no signal at all -
+ * its normalized values are read at render time) */
+struct ChangeNotify
+{
+	FlatSignal valueChanged;
+
+	ChangeNotify()
+	    : notifyQueued(false)
+	{}
+
+	virtual ~ChangeNotify();
+
+	/* Called by setters in place of firing directly */
+	void notifyChanged();
+
+	bool notifyQueued;
+
+	static void setDeferred(bool mode);
+	static void flushDeferred();
+};
+
+struct Tone : public Serializable, public ChangeNotify
 {
+	DECL_POOL_ALLOC()
+
 	Tone()
 	    : red(0), green(0), blue(0), gray(0)
 	{}
@@ -142,12 +172,12 @@ struct Tone : public Serializable
 
 	/* Normalized (-1.0 ~ 1.0) */
 	Vec4 norm;
-
-    sigslot::signal<> valueChanged;
 };
 
-struct Rect : public Serializable
+struct Rect : public Serializable, public ChangeNotify
 {
+	DECL_POOL_ALLOC()
+
 	Rect()
 	    : x(0), y(0), width(0), height(0)
 	{}
@@ -196,8 +226,6 @@ struct Rect : public Serializable
 	int y;
 	int width;
 	int height;
-
-	sigslot::signal<> valueChanged;
 };
 
 enum InterpolationMethod
@@ -27,21 +27,46 @@
 #include "serial-util.h"
 #include "exception.h"
 #include "util.h"
+#include "sharedstate.h"
+#include "graphics.h"
+
+/* Tables feed tilemaps; their edits must count as scene damage */
+static inline void notifySceneDamage()
+{
+	if (shState)
+		shState->graphics().markSceneDirty();
+}
 
 /* Init normally */
 Table::Table(int x, int y /*= 1*/, int z /*= 1*/)
     : xs(x), ys(y), zs(z),
-      data(x*y*z)
+      data(makeStorage(new std::vector<int16_t>((size_t) x*y*z))),
+      cells(data->data())
 {}
 
+/* Copy on write: the cell buffer is shared with the source
+ * until either side mutates */
 Table::Table(const Table &other)
     : xs(other.xs), ys(other.ys), zs(other.zs),
-      data(other.data)
+      data(other.data),
+      cells(other.cells)
 {}
 
+/* The use count can only shrink concurrently (a snapshot
+ * being released after a background serialize); reading a
+ * stale higher count just costs one superfluous copy */
+void Table::detach()
+{
+	if (data.use_count() == 1)
+		return;
+
+	data = makeStorage(new std::vector<int16_t>(*data));
+	cells = data->data();
+}
+
 int16_t Table::get(int x, int y, int z) const
 {
-	return data[xs*ys*z + xs*y + x];
+	return cells[xs*ys*z + xs*y + x];
 }
 
 void Table::set(int16_t value, int x, int y, int z)
@@ -53,9 +78,12 @@ void Table::set(int16_t value, int x, int y, int z)
 		return;
 	}
 
-	data[xs*ys*z + xs*y + x] = value;
+	detach();
+
+	cells[xs*ys*z + xs*y + x] = value;
 
 	modified();
+	notifySceneDamage();
 }
 
 void Table::resize(int x, int y, int z)
@@ -63,14 +91,54 @@ void Table::resize(int x, int y, int z)
 	if (x == xs && y == ys && z == zs)
 		return;
 
-	std::vector<int16_t> newData(x*y*z);
+	size_t needed = (size_t) x * y * z;
+
+	/* Cells are laid out plane by plane, row by row, so as
+	 * long as the existing index mapping stays intact the
+	 * storage can resize in place: appending/truncating
+	 * planes (x/y fixed), or rows of the only plane (x
+	 * fixed, single plane that stays single or only grows).
+	 * Scripts growing a table step by step hit this path,
+	 * so capacity is grown geometrically to keep the
+	 * reallocation cost amortized */
+	if (x == xs && (y == ys || (zs == 1 && (y >= ys || z == 1))))
+	{
+		detach();
+
+		if (needed > data->capacity())
+		{
+			/* Keep the storage tally in step with in-place
+			 * growth; the deleter releases final capacity */
+			const size_t before = data->capacity();
+			data->reserve(std::max(needed, data->capacity() * 2));
+			tableBytes += (data->capacity() - before) * sizeof(int16_t);
+		}
+
+		data->resize(needed);
+	}
+	else
+	{
+		/* The rebuild only reads the old buffer, so a
+		 * shared one needs no detach copy first; snapshots
+		 * simply keep the old cells */
+		std::vector<int16_t> newData(needed);
+
+		/* Row-wise copy of the overlapping region */
+		int copyX = std::min(x, xs);
+		int copyY = std::min(y, ys);
+		int copyZ = std::min(z, zs);
+
+		if (copyX > 0)
+			for (int k = 0; k < copyZ; ++k)
+				for (int j = 0; j < copyY; ++j)
+					memcpy(newData.data() + (size_t) x*y*k + (size_t) x*j,
+					       data->data() + (size_t) xs*ys*k + (size_t) xs*j,
+					       copyX * sizeof(int16_t));
 
-	for (int k = 0; k < std::min(z, zs); ++k)
-		for (int j = 0; j < std::min(y, ys); ++j)
-			for (int i = 0; i < std::min(x, xs); ++i)
-				newData[x*y*k + x*j + i] = at(i, j, k);
+		data = makeStorage(new std::vector<int16_t>(std::move(newData)));
+	}
 
-	data.swap(newData);
+	cells = data->data();
 
 	xs = x;
 	ys = y;
@@ -79,6 +147,101 @@ void Table::resize(int x, int y, int z)
 	return;
 }
 
+void Table::fillRect(int x, int y, int w, int h, int16_t value, int z)
+{
+	if (z < 0 || z >= zs)
+		return;
+
+	/* Clamp the rect to the table (wide-typed so absurd
+	 * extents can't wrap) */
+	int x0 = clamp<int64_t>(x, 0, xs);
+	int y0 = clamp<int64_t>(y, 0, ys);
+	int x1 = clamp<int64_t>((int64_t) x + w, 0, xs);
+	int y1 = clamp<int64_t>((int64_t) y + h, 0, ys);
+
+	if (x0 >= x1 || y0 >= y1)
+		return;
+
+	detach();
+
+	for (int j = y0; j < y1; ++j)
+		std::fill_n(cells + (size_t) xs*ys*z + (size_t) xs*j + x0,
+		            x1 - x0, value);
+
+	modified();
+	notifySceneDamage();
+}
+
+void Table::copyRegion(const Table &src, int sx, int sy,
+                       int sw, int sh, int dx, int dy,
+                       int srcZ, int dstZ)
+{
+	if (srcZ < 0 || srcZ >= src.zs || dstZ < 0 || dstZ >= zs)
+		return;
+
+	/* Clamp against both tables, shifting source and
+	 * destination in lockstep */
+	if (sx < 0) { sw += sx; dx -= sx; sx = 0; }
+	if (sy < 0) { sh += sy; dy -= sy; sy = 0; }
+	if (dx < 0) { sw += dx; sx -= dx; dx = 0; }
+	if (dy < 0) { sh += dy; sy -= dy; dy = 0; }
+
+	sw = std::min(sw, std::min(src.xs - sx, xs - dx));
+	sh = std::min(sh, std::min(src.ys - sy, ys - dy));
+
+	if (sw <= 0 || sh <= 0)
+		return;
+
+	detach();
+
+	/* memmove per row handles horizontal overlap; for a
+	 * downward copy within one plane the rows must be
+	 * walked bottom-up so they aren't clobbered first.
+	 * (A snapshot sibling detaches above, so "same buffer"
+	 * can only mean 'src == this') */
+	bool backwards = (&src == this && dstZ == srcZ && dy > sy);
+
+	for (int n = 0; n < sh; ++n)
+	{
+		int j = backwards ? (sh - 1 - n) : n;
+
+		memmove(cells + (size_t) xs*ys*dstZ + (size_t) xs*(dy + j) + dx,
+		        &src.at(sx, sy + j, srcZ),
+		        sw * sizeof(int16_t));
+	}
+
+	modified();
+	notifySceneDamage();
+}
+
+void Table::transform(int x, int y, int w, int h, int delta,
+                      int min, int max, int z)
+{
+	if (z < 0 || z >= zs || min > max)
+		return;
+
+	int x0 = clamp<int64_t>(x, 0, xs);
+	int y0 = clamp<int64_t>(y, 0, ys);
+	int x1 = clamp<int64_t>((int64_t) x + w, 0, xs);
+	int y1 = clamp<int64_t>((int64_t) y + h, 0, ys);
+
+	if (x0 >= x1 || y0 >= y1)
+		return;
+
+	detach();
+
+	for (int j = y0; j < y1; ++j)
+	{
+		int16_t *row = cells + (size_t) xs*ys*z + (size_t) xs*j + x0;
+
+		for (int i = 0; i < x1 - x0; ++i)
+			row[i] = (int16_t) clamp<int>(row[i] + delta, min, max);
+	}
+
+	modified();
+	notifySceneDamage();
+}
+
 void Table::resize(int x, int y)
 {
 	resize(x, y, zs);
@@ -115,7 +278,8 @@ void Table::serialize(char *buffer) const
 	writeInt32(&buffer, zs);
 	writeInt32(&buffer, size);
 
-	memcpy(buffer, dataPtr(data), sizeof(int16_t)*size);
+	/* Whole cell array in one go */
+	writeData(&buffer, cells, sizeof(int16_t)*size);
 }
 
 
@@ -130,14 +294,26 @@ Table *Table::deserialize(const char *data, int len)
 	int z = readInt32(&data);
 	int size = readInt32(&data);
 
-	if (size != x*y*z)
+	/* Wide-typed so crafted dimensions can't wrap the checks */
+	if (x < 0 || y < 0 || z < 0 || (int64_t) x * y * z != size)
 		throw Exception(Exception::RGSSError, "Marshal: Table: bad file format");
 
-	if (len != 20 + x*y*z*2)
+	if ((int64_t) len != 20 + (int64_t) size * 2)
 		throw Exception(Exception::RGSSError, "Marshal: Table: bad file format");
 
-	Table *t = new Table(x, y, z);
-	memcpy(dataPtr(t->data), data, sizeof(int16_t)*size);
+	/* Single pass: assigning straight from the blob avoids
+	 * first zero-filling megabytes of cells only to
+	 * overwrite them right after */
+	const int16_t *cells = reinterpret_cast<const int16_t*>(data);
+
+	Table *t = new Table(0, 0, 0);
+	t->xs = x;
+	t->ys = y;
+	t->zs = z;
+	/* Fresh counted storage; assigning into the zero-cell one
+	 * would grow it behind the accounting */
+	t->data = makeStorage(new std::vector<int16_t>(cells, cells + size));
+	t->cells = t->data->data();
 
 	return t;
 }
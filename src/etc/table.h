@@ -25,7 +25,8 @@
 #include "serializable.h"
 
 #include <stdint.h>
-#include "sigslot/signal.hpp"
+#include "flatsignal.h"
+#include <memory>
 #include <vector>
 
 class Table : public Serializable
@@ -37,6 +38,10 @@ public:
 	virtual ~Table() {}
 
 	int xSize() const { return xs; }
+
+	/* Live cell storage across every table (memory report) */
+	static uint64_t totalBytes();
+
 	int ySize() const { return ys; }
 	int zSize() const { return zs; }
 
@@ -47,26 +52,57 @@ public:
 	void resize(int x, int y);
 	void resize(int x);
 
+	/* O(1) copy-on-write snapshot (clone via Ruby behaves
+	 * the same way): the cell buffer is shared until either
+	 * table mutates. A snapshot that is never written to
+	 * may be serialized from another thread while the
+	 * original keeps changing */
+	Table *snapshot() const
+	{
+		return new Table(*this);
+	}
+
+	/* Bulk region operations; rects are clamped to the
+	 * table, so loose coordinates are fine */
+	void fillRect(int x, int y, int w, int h,
+	              int16_t value, int z = 0);
+
+	/* Copies a region out of 'src' (which may be this
+	 * table; overlap is handled) */
+	void copyRegion(const Table &src, int sx, int sy,
+	                int sw, int sh, int dx, int dy,
+	                int srcZ = 0, int dstZ = 0);
+
+	/* Adds 'delta' to every cell in the region, clamping
+	 * the result to [min, max] */
+	void transform(int x, int y, int w, int h, int delta,
+	               int min, int max, int z = 0);
+
 	int serialSize() const;
 	void serialize(char *buffer) const;
 	static Table *deserialize(const char *data, int len);
 
-	/* <internal */
-	inline int16_t &at(int x, int y = 0, int z = 0)
-	{
-		return data[xs*ys*z + xs*y + x];
-	}
-
+	/* <internal; read-only access: the buffer may be shared
+	 * with snapshots, all writes must go through the
+	 * mutating members (which detach it first) */
 	inline const int16_t &at(int x, int y = 0, int z = 0) const
 	{
-		return data[xs*ys*z + xs*y + x];
+		return cells[xs*ys*z + xs*y + x];
 	}
 
-    sigslot::signal<> modified;
+    FlatSignal modified;
 
 private:
+	/* Copies the shared cell buffer before a mutation
+	 * if any snapshot still references it */
+	void detach();
+
 	int xs, ys, zs;
-	std::vector<int16_t> data;
+
+	std::shared_ptr<std::vector<int16_t> > data;
+
+	/* Cached data->data(), so reads pay no indirection */
+	int16_t *cells;
 };
 
 #endif // TABLE_H
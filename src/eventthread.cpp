@@ -20,6 +20,7 @@
  */
 
 #include "eventthread.h"
+#include "zonetrace.h"
 
 #include <SDL_events.h>
 #include <SDL_messagebox.h>
@@ -47,6 +48,10 @@
 
 #include "al-util.h"
 #include "debugwriter.h"
+#include "exception.h"
+#include "util.h"
+
+#include <algorithm>
 
 #ifndef __APPLE__
 #include "util/string-util.h"
@@ -84,11 +89,176 @@ initALCFunctions(ALCdevice *alcDev)
 #define HAVE_ALC_DEVICE_PAUSE alc.DevicePause
 
 uint8_t EventThread::keyStates[];
+
+static SDL_atomic_t inputStateVersion;
+
+void EventThread::beginStateWrite()
+{
+    SDL_AtomicAdd(&inputStateVersion, 1);
+}
+
+void EventThread::endStateWrite()
+{
+    SDL_AtomicAdd(&inputStateVersion, 1);
+}
+
+static EventThread::CompositionState compositionState;
+
+void EventThread::snapshotComposition(CompositionState &out)
+{
+    while (true)
+    {
+        int v1 = SDL_AtomicGet(&inputStateVersion);
+
+        if (v1 & 1)
+            continue;
+
+        out = compositionState;
+
+        if (SDL_AtomicGet(&inputStateVersion) == v1)
+            return;
+    }
+}
+
+void EventThread::snapshotStates(uint8_t *keys,
+                                 ControllerState &ctrl,
+                                 MouseState &mouse)
+{
+    while (true)
+    {
+        int v1 = SDL_AtomicGet(&inputStateVersion);
+
+        if (v1 & 1)
+            continue;
+
+        memcpy(keys, keyStates, sizeof(keyStates));
+        ctrl = controllerState;
+        mouse = mouseState;
+
+        if (SDL_AtomicGet(&inputStateVersion) == v1)
+            return;
+    }
+}
 EventThread::ControllerState EventThread::controllerState;
 EventThread::MouseState EventThread::mouseState;
 EventThread::TouchState EventThread::touchState;
 SDL_atomic_t EventThread::verticalScrollDistance;
 
+/* ---- Stall watchdog ---- */
+
+#define STALL_THRESHOLD_MS 50.0
+#define STALL_LOG_SIZE 32
+
+static struct StallStats
+{
+    SDL_mutex *mutex;
+    EventThread::StallRecord log[STALL_LOG_SIZE];
+    int count;
+    int head;
+    double maxMs;
+
+    StallStats()
+        : count(0),
+          head(0),
+          maxMs(0)
+    {
+        mutex = SDL_CreateMutex();
+    }
+} stallStats;
+
+/* Times one pump iteration; the destructor runs on every
+ * exit path of the loop body (continues included) */
+struct StallTimer
+{
+    uint64_t t0;
+    uint32_t eventType;
+
+    explicit StallTimer(uint32_t eventType)
+        : t0(SDL_GetPerformanceCounter()),
+          eventType(eventType)
+    {}
+
+    ~StallTimer()
+    {
+        double ms = (SDL_GetPerformanceCounter() - t0) * 1000.0
+                    / SDL_GetPerformanceFrequency();
+
+        /* Unlocked peek; only the slow path locks */
+        if (ms <= STALL_THRESHOLD_MS && ms <= stallStats.maxMs)
+            return;
+
+        SDL_LockMutex(stallStats.mutex);
+
+        if (ms > stallStats.maxMs)
+            stallStats.maxMs = ms;
+
+        if (ms > STALL_THRESHOLD_MS)
+        {
+            EventThread::StallRecord &rec = stallStats.log[stallStats.head];
+            rec.atSeconds = SDL_GetTicks() / 1000.0;
+            rec.durationMs = ms;
+            rec.eventType = eventType;
+
+            stallStats.head = (stallStats.head + 1) % STALL_LOG_SIZE;
+
+            if (stallStats.count < STALL_LOG_SIZE)
+                ++stallStats.count;
+        }
+
+        SDL_UnlockMutex(stallStats.mutex);
+    }
+};
+
+double EventThread::maxStallMs()
+{
+    SDL_LockMutex(stallStats.mutex);
+    double ret = stallStats.maxMs;
+    SDL_UnlockMutex(stallStats.mutex);
+
+    return ret;
+}
+
+int EventThread::stallLog(StallRecord *out, int max)
+{
+    SDL_LockMutex(stallStats.mutex);
+
+    int n = std::min(max, stallStats.count);
+
+    for (int i = 0; i < n; ++i)
+    {
+        int idx = (stallStats.head - 1 - i + 2 * STALL_LOG_SIZE)
+                  % STALL_LOG_SIZE;
+        out[i] = stallStats.log[idx];
+    }
+
+    SDL_UnlockMutex(stallStats.mutex);
+
+    return n;
+}
+
+/* Modal dialogs live on their own thread so the event pump
+ * stays responsive while one is open */
+struct MsgBoxJob
+{
+    std::string title;
+    std::string body;
+    int flags;
+    AtomicFlag *done;
+};
+
+static int msgBoxWorkerFun(void *ptr)
+{
+    MsgBoxJob *job = static_cast<MsgBoxJob*>(ptr);
+
+    SDL_ShowSimpleMessageBox(job->flags, job->title.c_str(),
+                             job->body.c_str(), 0);
+
+    job->done->set();
+    delete job;
+
+    return 0;
+}
+
 /* User event codes */
 enum
 {
@@ -103,7 +273,12 @@ enum
     REQUEST_TEXTMODE,
     
     REQUEST_SETTINGS,
-    
+
+    REQUEST_RUMBLE,
+
+    REQUEST_CLIPBOARD_GET,
+    REQUEST_CLIPBOARD_SET,
+
     UPDATE_FPS,
     UPDATE_SCREEN_RECT,
     
@@ -126,14 +301,10 @@ EventThread::EventThread()
 : ctrl(0),
 fullscreen(false),
 showCursor(false)
-{
-    textInputLock = SDL_CreateMutex();
-}
+{}
 
 EventThread::~EventThread()
-{
-    SDL_DestroyMutex(textInputLock);
-}
+{}
 
 SDL_TimerID hideCursorTimerID = 0;
 Uint32 cursorTimerCallback(Uint32 interval, void* param)
@@ -211,7 +382,7 @@ void EventThread::process(RGSSThreadData &rtData)
     // for some dumb reason
     SDL_StopTextInput();
     
-    textInputBuffer.clear();
+    resetTextInput();
 #ifndef MKXPZ_BUILD_XCODE
     SettingsMenu *sMenu = 0;
 #else
@@ -226,6 +397,11 @@ void EventThread::process(RGSSThreadData &rtData)
             Debug() << "EventThread: Event error";
             break;
         }
+
+        /* Handling time for this event; waiting idle in
+         * SDL_WaitEvent doesn't count as a stall */
+        StallTimer stallTimer(event.type);
+        ZONE_SCOPED("event-handle");
 #ifndef MKXPZ_BUILD_XCODE
         if (sMenu && sMenu->onEvent(event))
         {
@@ -279,14 +455,18 @@ void EventThread::process(RGSSThreadData &rtData)
                         
                     case SDL_WINDOWEVENT_ENTER :
                         cursorInWindow = true;
+                        beginStateWrite();
                         mouseState.inWindow = true;
+                        endStateWrite();
                         updateCursorState(cursorInWindow && windowFocused && !sMenu, gameScreen);
                         
                         break;
                         
                     case SDL_WINDOWEVENT_LEAVE :
                         cursorInWindow = false;
+                        beginStateWrite();
                         mouseState.inWindow = false;
+                        endStateWrite();
                         updateCursorState(cursorInWindow && windowFocused && !sMenu, gameScreen);
                         
                         break;
@@ -299,24 +479,57 @@ void EventThread::process(RGSSThreadData &rtData)
                     case SDL_WINDOWEVENT_FOCUS_GAINED :
                         windowFocused = true;
                         updateCursorState(cursorInWindow && windowFocused && !sMenu, gameScreen);
-                        
+
+                        /* Instant wake from the background
+                         * throttle: the game thread polls the
+                         * flag mid-sleep */
+                        if (rtData.throttleBackground)
+                        {
+                            rtData.throttleBackground.clear();
+
+                            if (HAVE_ALC_DEVICE_PAUSE)
+                                alc.DeviceResume(rtData.alcDev);
+                        }
+
                         break;
-                        
+
                     case SDL_WINDOWEVENT_FOCUS_LOST :
                         windowFocused = false;
                         updateCursorState(cursorInWindow && windowFocused && !sMenu, gameScreen);
                         resetInputStates();
-                        
+
+                        if (rtData.config.backgroundThrottle)
+                        {
+                            rtData.throttleBackground.set();
+
+                            /* Stops the mixer and with it the
+                             * decode refills */
+                            if (HAVE_ALC_DEVICE_PAUSE)
+                                alc.DevicePause(rtData.alcDev);
+                        }
+
                         break;
                 }
                 break;
                 
             case SDL_TEXTINPUT :
-                lockText(true);
-                if (textInputBuffer.size() < 512) {
-                    textInputBuffer += event.text.text;
-                }
-                lockText(false);
+                pushTextInput(event.text.text);
+
+                /* Committed text ends the composition */
+                beginStateWrite();
+                memset(&compositionState, 0, sizeof(compositionState));
+                endStateWrite();
+
+                break;
+
+            case SDL_TEXTEDITING :
+                beginStateWrite();
+                snprintf(compositionState.text,
+                         sizeof(compositionState.text), "%s",
+                         event.edit.text);
+                compositionState.start = event.edit.start;
+                compositionState.length = event.edit.length;
+                endStateWrite();
                 break;
                 
             case SDL_QUIT :
@@ -407,7 +620,9 @@ void EventThread::process(RGSSThreadData &rtData)
                     break;
                 }
                 
+                beginStateWrite();
                 keyStates[event.key.keysym.scancode] = true;
+                endStateWrite();
                 break;
                 
             case SDL_KEYUP :
@@ -421,7 +636,9 @@ void EventThread::process(RGSSThreadData &rtData)
                     break;
                 }
                 
+                beginStateWrite();
                 keyStates[event.key.keysym.scancode] = false;
+                endStateWrite();
                 break;
                 
             case SDL_CONTROLLERBUTTONDOWN:
@@ -439,7 +656,9 @@ void EventThread::process(RGSSThreadData &rtData)
                     break;
                 }
 
+                beginStateWrite();
                 controllerState.buttons[event.cbutton.button] = true;
+                endStateWrite();
                 break;
                 
             case SDL_CONTROLLERBUTTONUP:
@@ -453,11 +672,15 @@ void EventThread::process(RGSSThreadData &rtData)
                     break;
                 }
 
+                beginStateWrite();
                 controllerState.buttons[event.cbutton.button] = false;
+                endStateWrite();
                 break;
                 
             case SDL_CONTROLLERAXISMOTION:
+                beginStateWrite();
                 controllerState.axes[event.caxis.axis] = event.caxis.value;
+                endStateWrite();
                 break;
                 
             case SDL_CONTROLLERDEVICEADDED:
@@ -473,16 +696,22 @@ void EventThread::process(RGSSThreadData &rtData)
                 break;
                 
             case SDL_MOUSEBUTTONDOWN :
+                beginStateWrite();
                 mouseState.buttons[event.button.button] = true;
+                endStateWrite();
                 break;
                 
             case SDL_MOUSEBUTTONUP :
+                beginStateWrite();
                 mouseState.buttons[event.button.button] = false;
+                endStateWrite();
                 break;
                 
             case SDL_MOUSEMOTION :
+                beginStateWrite();
                 mouseState.x = event.motion.x;
                 mouseState.y = event.motion.y;
+                endStateWrite();
                 cursorTimer();
                 updateCursorState(cursorInWindow, gameScreen);
                 break;
@@ -542,42 +771,99 @@ void EventThread::process(RGSSThreadData &rtData)
                         if (event.user.code)
                         {
                             SDL_StartTextInput();
-                            lockText(true);
-                            textInputBuffer.clear();
-                            lockText(false);
+                            resetTextInput();
                         }
                         else
                         {
                             SDL_StopTextInput();
-                            lockText(true);
-                            textInputBuffer.clear();
-                            lockText(false);
+                            resetTextInput();
                         }
                         break;
                         
                     case REQUEST_MESSAGEBOX :
                     {
+                        /* The dialog runs on a detached worker so
+                         * the pump keeps servicing events while it
+                         * is open; completion comes back through
+                         * the msgBoxDone flag like before. Without
+                         * a parent window the box can live on any
+                         * thread */
+                        MsgBoxJob *job = new MsgBoxJob;
 #ifndef __APPLE__
                         // Try to format the message with additional newlines
-                        std::string message = copyWithNewlines((const char*) event.user.data1,
-                                                               70);
-                        SDL_ShowSimpleMessageBox(event.user.code,
-                                                 rtData.config.windowTitle.c_str(),
-                                                 message.c_str(), win);
+                        job->body = copyWithNewlines((const char*) event.user.data1,
+                                                     70);
 #else
-                        SDL_ShowSimpleMessageBox(event.user.code,
-                                                 rtData.config.windowTitle.c_str(),
-                                                 (const char*)event.user.data1, win);
+                        job->body = (const char*) event.user.data1;
 #endif
+                        job->title = rtData.config.windowTitle;
+                        job->flags = event.user.code;
+                        job->done = &msgBoxDone;
+
                         free(event.user.data1);
-                        msgBoxDone.set();
+
+                        SDL_Thread *worker =
+                            SDL_CreateThread(msgBoxWorkerFun, "msgbox", job);
+
+                        if (worker)
+                        {
+                            SDL_DetachThread(worker);
+                        }
+                        else
+                        {
+                            /* No thread, no choice: show it here */
+                            SDL_ShowSimpleMessageBox(job->flags,
+                                                     job->title.c_str(),
+                                                     job->body.c_str(), win);
+                            msgBoxDone.set();
+                            delete job;
+                        }
+                        break;
+                    }
+
+                    case REQUEST_CLIPBOARD_GET :
+                    {
+                        char *tx = SDL_GetClipboardText();
+
+                        clipboardError.clear();
+
+                        if (tx)
+                        {
+                            clipboardText = tx;
+                            SDL_free(tx);
+                        }
+                        else
+                        {
+                            clipboardText.clear();
+                            clipboardError = SDL_GetError();
+                        }
+
+                        clipboardDone.set();
                         break;
                     }
+
+                    case REQUEST_CLIPBOARD_SET :
+                        if (SDL_SetClipboardText((const char*) event.user.data1) < 0)
+                            Debug() << "Failed to set clipboard text:"
+                                    << SDL_GetError();
+
+                        free(event.user.data1);
+                        break;
                     case REQUEST_SETCURSORVISIBLE :
                         showCursor = event.user.code;
                         updateCursorState(cursorInWindow, gameScreen);
                         break;
                         
+                    case REQUEST_RUMBLE :
+                        /* low/high frequency magnitudes are
+                         * packed 16+16 into the code field */
+                        if (ctrl)
+                            SDL_GameControllerRumble(ctrl,
+                                (uint16_t) ((uint32_t) event.user.code >> 16),
+                                (uint16_t) ((uint32_t) event.user.code & 0xFFFF),
+                                (uint32_t) (intptr_t) event.user.data1);
+                        break;
+
                     case REQUEST_SETTINGS :
 #ifndef MKXPZ_BUILD_XCODE
                         if (!sMenu)
@@ -706,10 +992,14 @@ void EventThread::cleanup()
 
 void EventThread::resetInputStates()
 {
+    beginStateWrite();
+
     memset(&keyStates, 0, sizeof(keyStates));
     memset(&controllerState, 0, sizeof(controllerState));
     memset(&mouseState.buttons, 0, sizeof(mouseState.buttons));
     memset(&touchState, 0, sizeof(touchState));
+
+    endStateWrite();
 }
 
 void EventThread::setFullscreen(SDL_Window *win, bool mode)
@@ -793,6 +1083,123 @@ void EventThread::requestShowCursor(bool mode)
     SDL_PushEvent(&event);
 }
 
+/* ---- Async haptics ----
+ *
+ * Rumble always executes on the event thread (which owns the
+ * controller handle); scripts never wait. Single pulses post
+ * straight as user events; patterns go to a tiny scheduler
+ * thread that sleeps out the step timing and posts one pulse
+ * per step. A new pulse or pattern supersedes the running
+ * pattern via a generation counter */
+
+static void postRumble(uint16_t low, uint16_t high, uint32_t durationMs)
+{
+    SDL_Event event;
+    event.type = usrIdStart + REQUEST_RUMBLE;
+    event.user.code = (Sint32) (((uint32_t) low << 16) | high);
+    event.user.data1 = reinterpret_cast<void*>((intptr_t) durationMs);
+    SDL_PushEvent(&event);
+}
+
+static struct RumbleScheduler
+{
+    SDL_mutex *mutex;
+    SDL_cond *cond;
+    SDL_Thread *thread;
+    std::vector<EventThread::RumbleStep> pattern;
+    int generation;
+
+    RumbleScheduler()
+        : thread(0),
+          generation(0)
+    {
+        mutex = SDL_CreateMutex();
+        cond = SDL_CreateCond();
+    }
+
+    void submit(const std::vector<EventThread::RumbleStep> &steps)
+    {
+        SDL_LockMutex(mutex);
+
+        pattern = steps;
+        ++generation;
+
+        if (!thread)
+            thread = createSDLThread
+                <RumbleScheduler, &RumbleScheduler::workerFun>(this, "haptics");
+
+        SDL_CondBroadcast(cond);
+        SDL_UnlockMutex(mutex);
+    }
+
+    void workerFun()
+    {
+        SDL_LockMutex(mutex);
+
+        while (true)
+        {
+            while (pattern.empty())
+                SDL_CondWait(cond, mutex);
+
+            std::vector<EventThread::RumbleStep> steps;
+            steps.swap(pattern);
+            int gen = generation;
+
+            SDL_UnlockMutex(mutex);
+
+            for (size_t i = 0; i < steps.size(); ++i)
+            {
+                postRumble(steps[i].low, steps[i].high, steps[i].durationMs);
+
+                /* Sleep out the step, but yield early if a
+                 * newer submission superseded this pattern */
+                uint32_t slept = 0;
+
+                while (slept < steps[i].durationMs)
+                {
+                    uint32_t slice =
+                        std::min<uint32_t>(10, steps[i].durationMs - slept);
+                    SDL_Delay(slice);
+                    slept += slice;
+
+                    SDL_LockMutex(mutex);
+                    bool superseded = (generation != gen);
+                    SDL_UnlockMutex(mutex);
+
+                    if (superseded)
+                        break;
+                }
+
+                SDL_LockMutex(mutex);
+                bool superseded = (generation != gen);
+                SDL_UnlockMutex(mutex);
+
+                if (superseded)
+                    break;
+            }
+
+            SDL_LockMutex(mutex);
+        }
+    }
+} rumbleScheduler;
+
+void EventThread::requestRumble(float low, float high, int durationMs)
+{
+    RumbleStep step;
+    step.low = (uint16_t) (clamp(low, 0.0f, 1.0f) * 0xFFFF);
+    step.high = (uint16_t) (clamp(high, 0.0f, 1.0f) * 0xFFFF);
+    step.durationMs = std::max(durationMs, 0);
+
+    /* Supersede any running pattern, then pulse directly */
+    std::vector<RumbleStep> one(1, step);
+    rumbleScheduler.submit(one);
+}
+
+void EventThread::requestRumblePattern(const std::vector<RumbleStep> &steps)
+{
+    rumbleScheduler.submit(steps);
+}
+
 void EventThread::requestTextInputMode(bool mode)
 {
     SDL_Event event;
@@ -831,6 +1238,39 @@ void EventThread::showMessageBox(const char *body, int flags)
     resetInputStates();
 }
 
+/* Fire and forget; the event thread owns the actual SDL call,
+ * which must run on the video thread anyway */
+void EventThread::requestClipboardSet(const char *text)
+{
+    SDL_Event event;
+    event.type = usrIdStart + REQUEST_CLIPBOARD_SET;
+    event.user.data1 = strdup(text);
+    SDL_PushEvent(&event);
+}
+
+std::string EventThread::requestClipboardGet()
+{
+    clipboardDone.clear();
+
+    if (shState->rtData().rqTerm)
+        return std::string();
+
+    SDL_Event event;
+    event.type = usrIdStart + REQUEST_CLIPBOARD_GET;
+    SDL_PushEvent(&event);
+
+    /* Keep presenting frames while the selection owner is
+     * negotiated with (X11 can take a while here) */
+    shState->graphics().repaintWait(clipboardDone);
+
+    if (!clipboardError.empty())
+        throw Exception(Exception::SDLError,
+                        "Failed to get clipboard text: %s",
+                        clipboardError.c_str());
+
+    return clipboardText;
+}
+
 bool EventThread::getFullscreen() const
 {
     return fullscreen;
@@ -883,9 +1323,56 @@ void EventThread::notifyGameScreenChange(const SDL_Rect &screen)
     SDL_PushEvent(&event);
 }
 
-void EventThread::lockText(bool lock)
+void EventThread::pushTextInput(const char *text)
+{
+    /* Bounded; when the game thread stops draining (512+
+     * bytes pending), further input drops like the old
+     * fixed-size buffer did */
+    textRing.push(text, strlen(text));
+}
+
+void EventThread::resetTextInput()
+{
+    /* In-band marker; the consumer resets its accumulation
+     * when it drains past it */
+    const uint8_t marker = 0;
+
+    textRing.push(&marker, 1);
+
+    beginStateWrite();
+    memset(&compositionState, 0, sizeof(compositionState));
+    endStateWrite();
+}
+
+void EventThread::pumpTextInput()
+{
+    uint8_t chunk[512];
+    size_t n;
+
+    while ((n = textRing.pop(chunk, sizeof(chunk))) > 0)
+    {
+        for (size_t i = 0; i < n; ++i)
+        {
+            if (chunk[i] == 0)
+            {
+                textInputOut.clear();
+                continue;
+            }
+
+            if (textInputOut.size() < 512)
+                textInputOut.push_back((char) chunk[i]);
+        }
+    }
+}
+
+const char *EventThread::fetchTextInput()
+{
+    return textInputOut.c_str();
+}
+
+void EventThread::discardTextInput()
 {
-    lock ? SDL_LockMutex(textInputLock) : SDL_UnlockMutex(textInputLock);
+    textInputOut.clear();
 }
 
 void SyncPoint::haltThreads()
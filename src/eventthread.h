@@ -25,10 +25,13 @@
 #include <SDL_scancode.h>
 #include <SDL_mouse.h>
 #include <SDL_mutex.h>
+
+#include "spscring.h"
 #include <SDL_atomic.h>
 #include <SDL_gamecontroller.h>
 
 #include <string>
+#include <vector>
 
 #include <stdint.h>
 
@@ -75,11 +78,48 @@ public:
     static ControllerState controllerState;
 	static MouseState mouseState;
 	static TouchState touchState;
+
+	/* Seqlock over the shared input state: the event thread
+	 * brackets each write with begin/endStateWrite (odd
+	 * version = write in flight), and readers copy a
+	 * coherent snapshot with snapshotStates, retrying when
+	 * the version moved under them. Neither side ever
+	 * blocks the other */
+	static void beginStateWrite();
+	static void endStateWrite();
+	static void snapshotStates(uint8_t *keys,
+	                           ControllerState &ctrl,
+	                           MouseState &mouse);
     static SDL_atomic_t verticalScrollDistance;
-    
-    std::string textInputBuffer;
-    void lockText(bool lock);
-    
+
+	/* Text input travels through a lock-free SPSC ring:
+	 * the event thread produces batched UTF-8 records, the
+	 * game thread drains them once per fetch. An in-band
+	 * NUL marker (never part of UTF-8 text) requests a
+	 * buffer reset from the producer side */
+
+	/* Event thread side */
+	void pushTextInput(const char *text);
+	void resetTextInput();
+
+	/* Game thread side. Records are pumped out of the ring
+	 * once per frame (Input::update), so a burst of IME
+	 * events coalesces into a single delivery; fetch and
+	 * discard then work on the frame's accumulation */
+	void pumpTextInput();
+	const char *fetchTextInput();
+	void discardTextInput();
+
+	/* Live IME composition (SDL_TEXTEDITING), published by
+	 * the event thread under the input state seqlock */
+	struct CompositionState
+	{
+		char text[32];
+		int start;
+		int length;
+	};
+
+	static void snapshotComposition(CompositionState &out);
 
 	static bool allocUserEvents();
 
@@ -98,6 +138,20 @@ public:
 	void requestShowCursor(bool mode);
     
     void requestTextInputMode(bool mode);
+
+	/* Async haptics: pulses/patterns execute on the event
+	 * thread (which owns the controller handle) with step
+	 * timing on a scheduler thread; the caller never waits.
+	 * A new submission supersedes a running pattern */
+	struct RumbleStep
+	{
+		uint16_t low;
+		uint16_t high;
+		uint32_t durationMs;
+	};
+
+	void requestRumble(float low, float high, int durationMs);
+	void requestRumblePattern(const std::vector<RumbleStep> &steps);
     
     void requestSettingsMenu();
 
@@ -111,6 +165,32 @@ public:
 
 	void showMessageBox(const char *body, int flags = 0);
 
+	/* Clipboard access runs on the event thread (SDL wants the
+	 * video thread for it); set is fire-and-forget, get waits
+	 * while frames keep presenting and throws on failure */
+	void requestClipboardSet(const char *text);
+	std::string requestClipboardGet();
+
+	/* ---- Stall watchdog ----
+	 *
+	 * Every event-pump iteration is timed; handling that
+	 * overruns the threshold lands in a small log so
+	 * production hitches can be attributed to the event
+	 * thread (driver dialogs, slow clipboard) vs GL vs
+	 * scripts. Queryable from any thread */
+	struct StallRecord
+	{
+		double atSeconds;
+		double durationMs;
+		uint32_t eventType;
+	};
+
+	static double maxStallMs();
+
+	/* Copies up to 'max' records, newest first; returns
+	 * the number written */
+	static int stallLog(StallRecord *out, int max);
+
 	/* RGSS thread calls this once per frame */
 	void notifyFrame();
 
@@ -132,8 +212,16 @@ private:
     SDL_GameController *ctrl;
     
 	AtomicFlag msgBoxDone;
-    
-    SDL_mutex *textInputLock;
+
+	AtomicFlag clipboardDone;
+	std::string clipboardText;
+	std::string clipboardError;
+
+	SpscByteRing<4096> textRing;
+
+	/* Consumer-owned accumulation; only the game thread
+	 * touches it */
+	std::string textInputOut;
 
 	struct
 	{
@@ -234,6 +322,11 @@ struct RGSSThreadData
 {
 	/* Main thread sets this to request RGSS thread to terminate */
 	AtomicFlag rqTerm;
+
+	/* Focus-loss throttle (see backgroundThrottle config):
+	 * set/cleared by the event thread, observed by the game
+	 * thread's pacing for instant wake on focus gain */
+	AtomicFlag throttleBackground;
 	/* In response, RGSS thread sets this to confirm
 	 * that it received the request and isn't stuck */
 	AtomicFlag rqTermAck;
@@ -27,15 +27,25 @@
 #include "util/util.h"
 #include "display/font.h"
 #include "crypto/rgssad.h"
+#ifdef MKXPZ_ZSTD
+#include "crypto/mkxpack.h"
+#endif
 
 #include "eventthread.h"
 #include "sharedstate.h"
+#include "system/system.h"
+#include "util/sdl-util.h"
+#include "util/jobpool.h"
 
 #include <physfs.h>
 
+#include <SDL_cpuinfo.h>
+
 #include <algorithm>
 #include <stack>
 #include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
 #include <string.h>
 #include <unistd.h>
 #include <vector>
@@ -278,6 +288,414 @@ struct FileSystemPrivate {
   /* This is for compatibility with games that take Windows'
    * case insensitivity for granted */
   bool havePathCache;
+
+  /* Read ahead block size for PhysFS handles; 0 = unbuffered */
+  int ioBufSize;
+
+  /* Where the path cache snapshot lives; empty = disabled */
+  std::string snapshotDir;
+
+  /* A file slurped into memory by the prefetch worker.
+   * Evicted entries a reader still holds become zombies
+   * and are freed on the last close */
+  struct PrefetchedFile {
+    FileSystemPrivate *owner;
+    std::vector<uint8_t> data;
+    std::string ext;
+    int refs;
+    bool zombie;
+
+    PrefetchedFile(FileSystemPrivate *owner)
+        : owner(owner), refs(0), zombie(false) {}
+  };
+
+  /* Maps: requested filename (normalized, lower case),
+   * To:   fully decoded file contents */
+  BoostHash<std::string, PrefetchedFile *> prefetchCache;
+
+  /* Insertion order, for budget eviction */
+  std::vector<std::string> prefetchOrder;
+  uint32_t prefetchBytes;
+
+  /* Back pointer for running the regular openRead
+   * machinery on the worker */
+  FileSystem *self;
+
+  SDL_mutex *prefetchMutex;
+  SDL_cond *prefetchCond;
+  std::vector<std::string> prefetchQueue;
+  SDL_Thread *prefetchThread;
+  AtomicFlag prefetchTermReq;
+
+  void prefetchFun();
+
+  /* Development file watching */
+  std::vector<FileSystem::ChangeObserver*> changeObservers;
+
+  /* Drops one prefetch cache entry by key, if present;
+   * called with prefetchMutex held */
+  void dropPrefetched(const std::string &key) {
+    PrefetchedFile *file = prefetchCache.value(key, 0);
+
+    if (!file)
+      return;
+
+    prefetchCache.remove(key);
+    prefetchBytes -= file->data.size();
+
+    std::vector<std::string>::iterator pos =
+        std::find(prefetchOrder.begin(), prefetchOrder.end(), key);
+
+    if (pos != prefetchOrder.end())
+      prefetchOrder.erase(pos);
+
+    if (file->refs > 0)
+      file->zombie = true;
+    else
+      delete file;
+  }
+};
+
+/* Total prefetch cache budget */
+#define PREFETCH_BUDGET (64 * 1024 * 1024)
+
+static std::string prefetchKey(FileSystem *fs, const char *filename) {
+  std::string key = fs->normalize(filename, false, false);
+
+  for (size_t i = 0; i < key.size(); ++i)
+    key[i] = tolower(key[i]);
+
+  return key;
+}
+
+/* RWops serving a prefetched buffer; data1 is the cache
+ * entry, data2 the read offset */
+static FileSystemPrivate::PrefetchedFile *prefetchFile(SDL_RWops *ops) {
+  return static_cast<FileSystemPrivate::PrefetchedFile *>(
+      ops->hidden.unknown.data1);
+}
+
+static Sint64 prefetchRWSize(SDL_RWops *ops) {
+  return prefetchFile(ops)->data.size();
+}
+
+static Sint64 prefetchRWSeek(SDL_RWops *ops, int64_t offset, int whence) {
+  FileSystemPrivate::PrefetchedFile *file = prefetchFile(ops);
+
+  if (!file)
+    return -1;
+
+  int64_t base;
+
+  switch (whence) {
+  default:
+  case RW_SEEK_SET:
+    base = 0;
+    break;
+  case RW_SEEK_CUR:
+    base = (intptr_t) ops->hidden.unknown.data2;
+    break;
+  case RW_SEEK_END:
+    base = file->data.size();
+    break;
+  }
+
+  int64_t pos = base + offset;
+
+  if (pos < 0 || pos > (int64_t) file->data.size())
+    return -1;
+
+  ops->hidden.unknown.data2 = (void *) (intptr_t) pos;
+
+  return pos;
+}
+
+static size_t prefetchRWRead(SDL_RWops *ops, void *buffer, size_t size,
+                             size_t maxnum) {
+  FileSystemPrivate::PrefetchedFile *file = prefetchFile(ops);
+
+  if (!file || size == 0)
+    return 0;
+
+  int64_t pos = (intptr_t) ops->hidden.unknown.data2;
+  size_t avail = file->data.size() - pos;
+  size_t num = std::min(avail / size, maxnum);
+
+  if (num == 0)
+    return 0;
+
+  memcpy(buffer, &file->data[pos], num * size);
+  ops->hidden.unknown.data2 = (void *) (intptr_t) (pos + num * size);
+
+  return num;
+}
+
+static size_t prefetchRWWrite(SDL_RWops *, const void *, size_t, size_t) {
+  return 0;
+}
+
+static int prefetchRWClose(SDL_RWops *ops) {
+  FileSystemPrivate::PrefetchedFile *file = prefetchFile(ops);
+
+  if (!file)
+    return -1;
+
+  FileSystemPrivate *p = file->owner;
+
+  SDL_LockMutex(p->prefetchMutex);
+
+  if (--file->refs == 0 && file->zombie)
+    delete file;
+
+  SDL_UnlockMutex(p->prefetchMutex);
+
+  ops->hidden.unknown.data1 = 0;
+
+  return 0;
+}
+
+static void initPrefetchOps(FileSystemPrivate::PrefetchedFile *file,
+                            SDL_RWops &ops) {
+  memset(&ops, 0, sizeof(ops));
+
+  ops.size = prefetchRWSize;
+  ops.seek = prefetchRWSeek;
+  ops.read = prefetchRWRead;
+  ops.write = prefetchRWWrite;
+  ops.close = prefetchRWClose;
+
+  ops.type = SDL_RWOPS_UNKNOWN;
+  ops.hidden.unknown.data1 = file;
+  ops.hidden.unknown.data2 = 0;
+}
+
+bool FileSystem::rwopsDirectView(const SDL_RWops &ops,
+                                 const uint8_t **data, size_t *len) {
+  if (ops.read != prefetchRWRead)
+    return false;
+
+  const FileSystemPrivate::PrefetchedFile *file =
+      static_cast<FileSystemPrivate::PrefetchedFile *>(
+          ops.hidden.unknown.data1);
+
+  if (!file)
+    return false;
+
+  *data = file->data.data();
+  *len = file->data.size();
+
+  return true;
+}
+
+/* Slurps the first matching file into memory */
+struct PrefetchOpenHandler : FileSystem::OpenHandler {
+  std::vector<uint8_t> data;
+  std::string ext;
+  bool success;
+
+  PrefetchOpenHandler() : success(false) {}
+
+  bool tryRead(SDL_RWops &ops, const char *ext) {
+    Sint64 size = SDL_RWsize(&ops);
+
+    if (size > 0) {
+      data.resize(size);
+      success = (SDL_RWread(&ops, data.data(), 1, size) == (size_t) size);
+    }
+
+    this->ext = ext ? ext : "";
+    SDL_RWclose(&ops);
+
+    return success;
+  }
+};
+
+void FileSystemPrivate::prefetchFun() {
+  SDL_LockMutex(prefetchMutex);
+
+  while (true) {
+    while (prefetchQueue.empty() && !prefetchTermReq)
+      SDL_CondWait(prefetchCond, prefetchMutex);
+
+    if (prefetchTermReq)
+      break;
+
+    std::string filename = prefetchQueue.front();
+    prefetchQueue.erase(prefetchQueue.begin());
+
+    std::string key = prefetchKey(self, filename.c_str());
+
+    if (prefetchCache.contains(key)) {
+      /* Already warm */
+      continue;
+    }
+
+    SDL_UnlockMutex(prefetchMutex);
+
+    PrefetchOpenHandler handler;
+
+    try {
+      self->openRead(handler, filename.c_str());
+    } catch (const Exception &) {
+      /* Missing file; the real open reports it */
+    }
+
+    SDL_LockMutex(prefetchMutex);
+
+    if (!handler.success || prefetchCache.contains(key))
+      continue;
+
+    PrefetchedFile *file = new PrefetchedFile(this);
+    file->data.swap(handler.data);
+    file->ext = handler.ext;
+
+    prefetchBytes += file->data.size();
+    prefetchCache.insert(key, file);
+    prefetchOrder.push_back(key);
+
+    /* Evict oldest entries once over budget */
+    while (prefetchBytes > PREFETCH_BUDGET && prefetchOrder.size() > 1) {
+      std::string oldest = prefetchOrder.front();
+      prefetchOrder.erase(prefetchOrder.begin());
+
+      PrefetchedFile *old = prefetchCache.value(oldest, 0);
+
+      if (!old)
+        continue;
+
+      prefetchCache.remove(oldest);
+      prefetchBytes -= old->data.size();
+
+      if (old->refs > 0)
+        old->zombie = true;
+      else
+        delete old;
+    }
+  }
+
+  SDL_UnlockMutex(prefetchMutex);
+}
+
+/* Pooling allocator handed to PhysFS: every open/read/close
+ * cycle allocates a file handle struct, an io struct and (with
+ * read ahead) a 64k buffer, which made the save/load path with
+ * its hundreds of small opens malloc-heavy. Blocks are recycled
+ * through thread local free lists in power-of-two size classes,
+ * so repeat opens on the same thread are allocation-free. Blocks
+ * freed on a different thread than they were allocated on simply
+ * land in that thread's list */
+
+#define POOL_MIN_SHIFT 5                      /* 32 bytes */
+#define POOL_MAX_SHIFT 16                     /* 64 kbytes */
+#define POOL_CLASS_COUNT (POOL_MAX_SHIFT - POOL_MIN_SHIFT + 1)
+
+/* Blocks cached per class and thread */
+#define POOL_CLASS_DEPTH 8
+
+struct PoolBlockHeader {
+  uint64_t capacity;
+  int32_t sizeClass; /* -1 = above the largest class, unpooled */
+  uint32_t pad;
+};
+
+struct PoolCache {
+  PoolBlockHeader *freeList[POOL_CLASS_COUNT];
+  int freeCount[POOL_CLASS_COUNT];
+
+  PoolCache() {
+    memset(freeList, 0, sizeof(freeList));
+    memset(freeCount, 0, sizeof(freeCount));
+  }
+
+  ~PoolCache() {
+    /* Drain on thread exit */
+    for (int i = 0; i < POOL_CLASS_COUNT; ++i)
+      while (freeList[i]) {
+        PoolBlockHeader *block = freeList[i];
+        freeList[i] = *reinterpret_cast<PoolBlockHeader**>(block + 1);
+        free(block);
+      }
+  }
+};
+
+static thread_local PoolCache poolCache;
+
+static void *poolMalloc(PHYSFS_uint64 size) {
+  int sizeClass = -1;
+  uint64_t capacity = size;
+
+  for (int i = POOL_MIN_SHIFT; i <= POOL_MAX_SHIFT; ++i)
+    if (size <= (1ull << i)) {
+      sizeClass = i - POOL_MIN_SHIFT;
+      capacity = 1ull << i;
+      break;
+    }
+
+  if (sizeClass >= 0 && poolCache.freeList[sizeClass]) {
+    PoolBlockHeader *block = poolCache.freeList[sizeClass];
+    poolCache.freeList[sizeClass] =
+        *reinterpret_cast<PoolBlockHeader**>(block + 1);
+    --poolCache.freeCount[sizeClass];
+
+    return block + 1;
+  }
+
+  PoolBlockHeader *block = static_cast<PoolBlockHeader*>(
+      malloc(sizeof(PoolBlockHeader) + capacity));
+
+  if (!block)
+    return 0;
+
+  block->capacity = capacity;
+  block->sizeClass = sizeClass;
+
+  return block + 1;
+}
+
+static void poolFree(void *ptr) {
+  if (!ptr)
+    return;
+
+  PoolBlockHeader *block = static_cast<PoolBlockHeader*>(ptr) - 1;
+  int sizeClass = block->sizeClass;
+
+  if (sizeClass < 0 || poolCache.freeCount[sizeClass] >= POOL_CLASS_DEPTH) {
+    free(block);
+    return;
+  }
+
+  *reinterpret_cast<PoolBlockHeader**>(block + 1) =
+      poolCache.freeList[sizeClass];
+  poolCache.freeList[sizeClass] = block;
+  ++poolCache.freeCount[sizeClass];
+}
+
+static void *poolRealloc(void *ptr, PHYSFS_uint64 size) {
+  if (!ptr)
+    return poolMalloc(size);
+
+  PoolBlockHeader *block = static_cast<PoolBlockHeader*>(ptr) - 1;
+
+  if (size <= block->capacity)
+    return ptr;
+
+  void *grown = poolMalloc(size);
+
+  if (!grown)
+    return 0;
+
+  memcpy(grown, ptr, block->capacity);
+  poolFree(ptr);
+
+  return grown;
+}
+
+static PHYSFS_Allocator poolAllocator = {
+    0, /* Init */
+    0, /* Deinit */
+    poolMalloc,
+    poolRealloc,
+    poolFree,
 };
 
 static void throwPhysfsError(const char *desc) {
@@ -294,7 +712,11 @@ static void throwPhysfsError(const char *desc) {
   throw Exception(Exception::PHYSFSError, "%s: %s", desc, englishStr);
 }
 
-FileSystem::FileSystem(const char *argv0, bool allowSymlinks) {
+FileSystem::FileSystem(const char *argv0, bool allowSymlinks,
+                       int ioBufSize) {
+  /* Must precede init */
+  PHYSFS_setAllocator(&poolAllocator);
+
   if (PHYSFS_init(argv0) == 0)
     throwPhysfsError("Error initializing PhysFS");
 
@@ -305,18 +727,46 @@ FileSystem::FileSystem(const char *argv0, bool allowSymlinks) {
   er *= PHYSFS_registerArchiver(&RGSS1_Archiver);
   er *= PHYSFS_registerArchiver(&RGSS2_Archiver);
   er *= PHYSFS_registerArchiver(&RGSS3_Archiver);
+#ifdef MKXPZ_ZSTD
+  er *= PHYSFS_registerArchiver(&MKXPACK_Archiver);
+#endif
 
   if (er == 0)
     throwPhysfsError("Error registering PhysFS RGSS archiver");
 
   p = new FileSystemPrivate;
   p->havePathCache = false;
+  p->ioBufSize = std::max(ioBufSize, 0);
+
+  p->self = this;
+  p->prefetchBytes = 0;
+  p->prefetchThread = 0;
+  p->prefetchMutex = SDL_CreateMutex();
+  p->prefetchCond = SDL_CreateCond();
 
   if (allowSymlinks)
     PHYSFS_permitSymbolicLinks(1);
 }
 
 FileSystem::~FileSystem() {
+  if (p->prefetchThread) {
+    p->prefetchTermReq.set();
+    SDL_LockMutex(p->prefetchMutex);
+    SDL_CondBroadcast(p->prefetchCond);
+    SDL_UnlockMutex(p->prefetchMutex);
+    SDL_WaitThread(p->prefetchThread, 0);
+  }
+
+  for (size_t i = 0; i < p->prefetchOrder.size(); ++i) {
+    FileSystemPrivate::PrefetchedFile *file =
+        p->prefetchCache.value(p->prefetchOrder[i], 0);
+
+    delete file;
+  }
+
+  SDL_DestroyMutex(p->prefetchMutex);
+  SDL_DestroyCond(p->prefetchCond);
+
   delete p;
 
   if (PHYSFS_deinit() == 0)
@@ -355,15 +805,20 @@ void FileSystem::removePath(const char *path, bool reload) {
 }
 
 struct CacheEnumData {
-  FileSystemPrivate *p;
-  std::stack<std::vector<std::string> *> fileLists;
+  /* Local destination maps: workers traverse disjoint
+   * subtrees into their own maps in parallel, which are
+   * merged into the shared cache afterwards */
+  BoostHash<std::string, std::string> pathCache;
+  BoostHash<std::string, std::vector<std::string>> fileLists;
+
+  std::stack<std::vector<std::string> *> listStack;
 
 #ifdef __APPLE__
   iconv_t nfd2nfc;
   char buf[512];
 #endif
 
-  CacheEnumData(FileSystemPrivate *p) : p(p) {
+  CacheEnumData() {
 #ifdef __APPLE__
     nfd2nfc = iconv_open("utf-8", "utf-8-mac");
 #endif
@@ -421,48 +876,510 @@ static PHYSFS_EnumerateCallbackResult cacheEnumCB(void *d, const char *origdir,
 
   if (stat.filetype == PHYSFS_FILETYPE_DIRECTORY) {
     /* Create a new list for this directory */
-    std::vector<std::string> &list = data.p->fileLists[lowerCase];
+    std::vector<std::string> &list = data.fileLists[lowerCase];
 
     /* Iterate over its contents */
-    data.fileLists.push(&list);
+    data.listStack.push(&list);
     PHYSFS_enumerate(fullPath, cacheEnumCB, d);
-    data.fileLists.pop();
+    data.listStack.pop();
   } else {
     /* Get the file list for the directory we're currently
      * traversing and append this filename to it */
-    std::vector<std::string> &list = *data.fileLists.top();
+    std::vector<std::string> &list = *data.listStack.top();
 
     std::string lowerFilename(fname);
     strTolower(lowerFilename);
     list.push_back(lowerFilename);
 
     /* Add the lower -> mixed mapping of the file's full path */
-    data.p->pathCache.insert(lowerCase, mixedCase);
+    data.pathCache.insert(lowerCase, mixedCase);
   }
 
   return PHYSFS_ENUM_OK;
 }
 
-void FileSystem::createPathCache() {
+/* Folds worker-local results into the shared cache. Lists are
+ * appended rather than replaced: sibling workers share the root
+ * list, and case variant directory names fold onto one key */
+static void mergeCacheData(FileSystemPrivate *p, CacheEnumData &data,
+                           bool dedup) {
+  BoostHash<std::string, std::string>::const_iterator pit;
+
+  for (pit = data.pathCache.cbegin(); pit != data.pathCache.cend(); ++pit)
+    p->pathCache.insert(pit->first, pit->second);
+
+  BoostHash<std::string, std::vector<std::string>>::const_iterator lit;
+
+  for (lit = data.fileLists.cbegin(); lit != data.fileLists.cend(); ++lit) {
+    std::vector<std::string> &dst = p->fileLists[lit->first];
+    const std::vector<std::string> &src = lit->second;
+
+    for (size_t i = 0; i < src.size(); ++i) {
+      if (dedup && std::find(dst.begin(), dst.end(), src[i]) != dst.end())
+        continue;
+
+      dst.push_back(src[i]);
+    }
+  }
+}
+
+/* Traverses a share of the top level entries into local maps */
+struct CacheWorker {
+  std::vector<std::string> entries;
+  CacheEnumData data;
+  bool aborted;
+
+  CacheWorker() : aborted(false) {}
+
+  void workerFun() {
+    data.listStack.push(&data.fileLists[""]);
+
+    try {
+      for (size_t i = 0; i < entries.size(); ++i)
+        cacheEnumCB(&data, "", entries[i].c_str());
+    } catch (const Exception &) {
+      /* Game close requested; rethrown on the main
+       * thread after all workers joined */
+      aborted = true;
+    }
+
+    data.listStack.pop();
+  }
+};
+
+/* ---- Path cache snapshot ----
+ *
+ * Serialized copy of the completed path cache, so an
+ * unchanged install boots with one read instead of a full
+ * tree enumeration. Keyed by a fingerprint over the mount
+ * sources (path, mtime, size); any mismatch falls back to a
+ * regular build. All little endian:
+ *
+ *   char magic[8] "MKXPCACH", u32 version, u32 reserved,
+ *   u32 fingerprint bytes + blob,
+ *   u32 pathCache count, per entry: str key, str value,
+ *   u32 fileLists count, per entry: str key,
+ *       u32 item count, str items
+ *   (str = u16 length + bytes) */
+
+#define SNAPSHOT_MAGIC "MKXPCACH"
+#define SNAPSHOT_VERSION 1
+#define SNAPSHOT_NAME "pathcache.snapshot"
+
+static void snapPut16(std::string &out, uint16_t v) {
+  out.push_back((char) (v & 0xFF));
+  out.push_back((char) (v >> 8));
+}
+
+static void snapPut32(std::string &out, uint32_t v) {
+  for (int i = 0; i < 4; ++i)
+    out.push_back((char) ((v >> (8 * i)) & 0xFF));
+}
+
+static void snapPutStr(std::string &out, const std::string &str) {
+  snapPut16(out, (uint16_t) str.size());
+  out.append(str);
+}
+
+static bool snapGet16(const uint8_t *&ptr, const uint8_t *end, uint16_t &v) {
+  if (end - ptr < 2)
+    return false;
+
+  v = ptr[0] | (ptr[1] << 8);
+  ptr += 2;
+
+  return true;
+}
+
+static bool snapGet32(const uint8_t *&ptr, const uint8_t *end, uint32_t &v) {
+  if (end - ptr < 4)
+    return false;
+
+  v = (uint32_t) ptr[0] | ((uint32_t) ptr[1] << 8) |
+      ((uint32_t) ptr[2] << 16) | ((uint32_t) ptr[3] << 24);
+  ptr += 4;
+
+  return true;
+}
+
+static bool snapGetStr(const uint8_t *&ptr, const uint8_t *end,
+                       std::string &str) {
+  uint16_t len;
+
+  if (!snapGet16(ptr, end, len) || end - ptr < len)
+    return false;
+
+  str.assign(reinterpret_cast<const char*>(ptr), len);
+  ptr += len;
+
+  return true;
+}
+
+/* Identifies the current mount set: any archive swap, file
+ * size change or remount invalidates the snapshot. Oversized
+ * entry names never truncate silently; they just make the
+ * fingerprint (and thus the snapshot) unusable */
+static void computeMountFingerprint(std::string &out) {
+  char **paths = PHYSFS_getSearchPath();
+
+  for (char **path = paths; path && *path; ++path) {
+    snapPutStr(out, *path);
+
+    struct stat st;
+
+    if (stat(*path, &st) != 0)
+      memset(&st, 0, sizeof(st));
+
+    /* st_size is only 32 bits wide on some targets */
+    uint64_t size = (uint64_t) st.st_size;
+
+    snapPut32(out, (uint32_t) st.st_mtime);
+    snapPut32(out, (uint32_t) (size & 0xFFFFFFFF));
+    snapPut32(out, (uint32_t) (size >> 32));
+  }
+
+  PHYSFS_freeList(paths);
+}
+
+static bool loadPathCacheSnapshot(FileSystemPrivate *p,
+                                  const std::string &dir) {
+  std::string path = dir + "/" SNAPSHOT_NAME;
+
+  FILE *f = fopen(path.c_str(), "rb");
+
+  if (!f)
+    return false;
+
+  std::vector<uint8_t> blob;
+
+  fseek(f, 0, SEEK_END);
+  long size = ftell(f);
+  fseek(f, 0, SEEK_SET);
+
+  if (size <= 0) {
+    fclose(f);
+    return false;
+  }
+
+  blob.resize(size);
+  bool readOk = (fread(blob.data(), 1, size, f) == (size_t) size);
+  fclose(f);
+
+  if (!readOk)
+    return false;
+
+  const uint8_t *ptr = blob.data();
+  const uint8_t *end = ptr + blob.size();
+
+  uint32_t version, reserved, fpLen;
+
+  if (end - ptr < 8 || memcmp(ptr, SNAPSHOT_MAGIC, 8))
+    return false;
+
+  ptr += 8;
+
+  if (!snapGet32(ptr, end, version) || version != SNAPSHOT_VERSION
+  ||  !snapGet32(ptr, end, reserved)
+  ||  !snapGet32(ptr, end, fpLen) || end - ptr < fpLen)
+    return false;
+
+  std::string current;
+  computeMountFingerprint(current);
+
+  if (current.size() != fpLen
+  ||  memcmp(ptr, current.data(), fpLen))
+    return false;
+
+  ptr += fpLen;
+
+  uint32_t count;
+
+  if (!snapGet32(ptr, end, count))
+    return false;
+
+  std::string key, value;
+
+  for (uint32_t i = 0; i < count; ++i) {
+    if (!snapGetStr(ptr, end, key) || !snapGetStr(ptr, end, value))
+      goto error;
+
+    p->pathCache.insert(key, value);
+  }
+
+  if (!snapGet32(ptr, end, count))
+    goto error;
+
+  for (uint32_t i = 0; i < count; ++i) {
+    uint32_t items;
+
+    if (!snapGetStr(ptr, end, key) || !snapGet32(ptr, end, items))
+      goto error;
+
+    /* Every item takes at least its length field; a count
+     * beyond that is corruption and would over-reserve */
+    if (items > (uint32_t) (end - ptr) / 2)
+      goto error;
+
+    std::vector<std::string> &list = p->fileLists[key];
+    list.reserve(items);
+
+    for (uint32_t n = 0; n < items; ++n) {
+      if (!snapGetStr(ptr, end, value))
+        goto error;
+
+      list.push_back(value);
+    }
+  }
+
+  return true;
+
+error:
+  p->pathCache.clear();
+  p->fileLists.clear();
+  return false;
+}
+
+static void savePathCacheSnapshot(FileSystemPrivate *p,
+                                  const std::string &dir) {
+  std::string out;
+
+  out.append(SNAPSHOT_MAGIC);
+  snapPut32(out, SNAPSHOT_VERSION);
+  snapPut32(out, 0);
+
+  std::string fingerprint;
+  computeMountFingerprint(fingerprint);
+
+  snapPut32(out, (uint32_t) fingerprint.size());
+  out.append(fingerprint);
+
+  /* Entry names beyond the str length field would round-trip
+   * truncated; skip writing a snapshot in that (absurd) case */
+  BoostHash<std::string, std::string>::const_iterator pit;
+  BoostHash<std::string, std::vector<std::string>>::const_iterator lit;
+
+  uint32_t count = 0;
+
+  for (pit = p->pathCache.cbegin(); pit != p->pathCache.cend(); ++pit) {
+    if (pit->first.size() > 0xFFFF || pit->second.size() > 0xFFFF)
+      return;
+
+    ++count;
+  }
+
+  snapPut32(out, count);
+
+  for (pit = p->pathCache.cbegin(); pit != p->pathCache.cend(); ++pit) {
+    snapPutStr(out, pit->first);
+    snapPutStr(out, pit->second);
+  }
+
+  count = 0;
+
+  for (lit = p->fileLists.cbegin(); lit != p->fileLists.cend(); ++lit) {
+    if (lit->first.size() > 0xFFFF)
+      return;
+
+    for (size_t i = 0; i < lit->second.size(); ++i)
+      if (lit->second[i].size() > 0xFFFF)
+        return;
+
+    ++count;
+  }
+
+  snapPut32(out, count);
+
+  for (lit = p->fileLists.cbegin(); lit != p->fileLists.cend(); ++lit) {
+    snapPutStr(out, lit->first);
+    snapPut32(out, (uint32_t) lit->second.size());
+
+    for (size_t i = 0; i < lit->second.size(); ++i)
+      snapPutStr(out, lit->second[i]);
+  }
+
+  /* Write to a temp name first so a crash can't leave a
+   * torn snapshot behind */
+  std::string path = dir + "/" SNAPSHOT_NAME;
+  std::string tmp = path + ".tmp";
+
+  FILE *f = fopen(tmp.c_str(), "wb");
+
+  if (!f)
+    return;
+
+  bool ok = (fwrite(out.data(), 1, out.size(), f) == out.size());
+  fclose(f);
+
+  if (!ok) {
+    remove(tmp.c_str());
+    return;
+  }
+
+  remove(path.c_str());
+  rename(tmp.c_str(), path.c_str());
+}
+
+void FileSystem::createPathCache(const char *snapshotDir) {
+  if (snapshotDir && *snapshotDir)
+    p->snapshotDir = snapshotDir;
+
+  if (!p->snapshotDir.empty()
+  &&  loadPathCacheSnapshot(p, p->snapshotDir)) {
+    Debug() << "Path cache loaded from snapshot.";
+
+    p->havePathCache = true;
+    return;
+  }
+
   Debug() << "Loading path cache...";
 
-  CacheEnumData data(p);
-  data.fileLists.push(&p->fileLists[""]);
-  PHYSFS_enumerate("", cacheEnumCB, &data);
+  /* Gather top level entries */
+  std::vector<std::string> topLevel;
+
+  char **names = PHYSFS_enumerateFiles("");
+
+  for (char **name = names; *name; ++name)
+    topLevel.push_back(*name);
+
+  PHYSFS_freeList(names);
+
+  /* Traversal is split over the top level entries, one
+   * worker per core; each collects into local maps so the
+   * hot path stays lock-free, merged once at the end */
+  size_t workerCount = clamp<size_t>(SDL_GetCPUCount(), 1, 8);
+  workerCount = std::min(workerCount, std::max<size_t>(topLevel.size(), 1));
+
+  std::vector<CacheWorker*> workers(workerCount);
+
+  for (size_t i = 0; i < workerCount; ++i)
+    workers[i] = new CacheWorker;
+
+  /* Contiguous blocks, so merging workers in order keeps
+   * the exact sequential enumeration order */
+  size_t perWorker = (topLevel.size() + workerCount - 1) / workerCount;
+
+  for (size_t i = 0; i < topLevel.size(); ++i)
+    workers[i / perWorker]->entries.push_back(topLevel[i]);
+
+  /* Workers run on the shared pool; the caller chews its share,
+   * so a single-worker split degenerates to the plain loop */
+  JobPool::instance().parallelFor((int) workerCount,
+    [](void *arg, int i) {
+      (*static_cast<std::vector<CacheWorker*>*>(arg))[i]->workerFun();
+    }, &workers);
+
+  bool aborted = false;
+
+  for (size_t i = 0; i < workerCount; ++i) {
+    aborted |= workers[i]->aborted;
+    mergeCacheData(p, workers[i]->data, false);
+    delete workers[i];
+  }
+
+  if (aborted)
+    throw Exception(Exception::MKXPError,
+                    "Game close requested. Aborting path cache enumeration.");
 
   p->havePathCache = true;
 
+  if (!p->snapshotDir.empty())
+    savePathCacheSnapshot(p, p->snapshotDir);
+
   Debug() << "Path cache completed.";
 }
 
 void FileSystem::reloadPathCache() {
     if (!p->havePathCache) return;
-    
+
     p->fileLists.clear();
     p->pathCache.clear();
     createPathCache();
 }
 
+/* True when 'key' equals 'prefix' or lies below it */
+static bool underSubtree(const std::string &key, const std::string &prefix) {
+  if (key.size() < prefix.size() || key.compare(0, prefix.size(), prefix) != 0)
+    return false;
+
+  return key.size() == prefix.size() || key[prefix.size()] == '/';
+}
+
+void FileSystem::reloadPathCache(const char *subtree) {
+  if (!p->havePathCache)
+    return;
+
+  std::string path(subtree ? subtree : "");
+
+  /* Strip trailing slashes */
+  while (!path.empty() && path[path.size()-1] == '/')
+    path.resize(path.size()-1);
+
+  if (path.empty()) {
+    reloadPathCache();
+    return;
+  }
+
+  std::string lower = path;
+  strTolower(lower);
+
+  /* Drop every cached entry at or below the subtree */
+  std::vector<std::string> stale;
+
+  BoostHash<std::string, std::string>::const_iterator pit;
+
+  for (pit = p->pathCache.cbegin(); pit != p->pathCache.cend(); ++pit)
+    if (underSubtree(pit->first, lower))
+      stale.push_back(pit->first);
+
+  for (size_t i = 0; i < stale.size(); ++i)
+    p->pathCache.remove(stale[i]);
+
+  stale.clear();
+
+  BoostHash<std::string, std::vector<std::string>>::const_iterator lit;
+
+  for (lit = p->fileLists.cbegin(); lit != p->fileLists.cend(); ++lit)
+    if (underSubtree(lit->first, lower))
+      stale.push_back(lit->first);
+
+  for (size_t i = 0; i < stale.size(); ++i)
+    p->fileLists.remove(stale[i]);
+
+  /* Split into parent dir and entry name; if the subtree
+   * names a plain file, its parent list entry must go too
+   * or re-adding it below would duplicate it */
+  size_t delim = path.rfind('/');
+
+  std::string parent = (delim == std::string::npos)
+      ? std::string() : path.substr(0, delim);
+  std::string base = (delim == std::string::npos)
+      ? path : path.substr(delim + 1);
+
+  std::string parentLower = parent;
+  strTolower(parentLower);
+
+  std::string baseLower = base;
+  strTolower(baseLower);
+
+  std::vector<std::string> &parentList = p->fileLists[parentLower];
+  parentList.erase(std::remove(parentList.begin(), parentList.end(), baseLower),
+                   parentList.end());
+
+  /* Subtree is gone entirely (unmounted mod):
+   * dropping the stale entries was all there is to do */
+  if (!PHYSFS_exists(path.c_str()))
+    return;
+
+  /* Re-enumerate just this subtree */
+  CacheEnumData data;
+
+  data.listStack.push(&data.fileLists[parentLower]);
+  cacheEnumCB(&data, parent.c_str(), base.c_str());
+  data.listStack.pop();
+
+  mergeCacheData(p, data, true);
+}
+
 struct FontSetsCBData {
   FileSystemPrivate *p;
   SharedFontState *sfs;
@@ -543,6 +1460,9 @@ struct OpenReadEnumData {
    * (used with path cache) */
   BoostHash<std::string, std::string> *pathTrans;
 
+  /* Read ahead block size for opened handles */
+  int ioBufSize;
+
   /* Number of files we've attempted to read and parse */
   size_t matchCount;
   bool stopSearching;
@@ -553,10 +1473,11 @@ struct OpenReadEnumData {
 
   OpenReadEnumData(FileSystem::OpenHandler &handler, const char *filename,
                    size_t filenameN,
-                   BoostHash<std::string, std::string> *pathTrans)
+                   BoostHash<std::string, std::string> *pathTrans,
+                   int ioBufSize)
       : handler(handler), filename(filename), filenameN(filenameN),
-        pathTrans(pathTrans), matchCount(0), stopSearching(false),
-        physfsError(0) {}
+        pathTrans(pathTrans), ioBufSize(ioBufSize), matchCount(0),
+        stopSearching(false), physfsError(0) {}
 };
 
 static PHYSFS_EnumerateCallbackResult
@@ -587,9 +1508,14 @@ openReadEnumCB(void *d, const char *dirpath, const char *filename) {
     return PHYSFS_ENUM_OK;
 
   /* If the path cache is active, translate from lower case
-   * to mixed case path */
-  if (data.pathTrans)
-    fullPath = (*data.pathTrans)[fullPath].c_str();
+   * to mixed case path. (A miss keeps the name as-is; the
+   * old [] access inserted an empty translation instead) */
+  if (data.pathTrans) {
+    const std::string *trans = data.pathTrans->valuePtr(fullPath);
+
+    if (trans)
+      fullPath = trans->c_str();
+  }
 
   PHYSFS_File *phys = PHYSFS_openRead(fullPath);
 
@@ -602,6 +1528,12 @@ openReadEnumCB(void *d, const char *dirpath, const char *filename) {
 
     return PHYSFS_ENUM_ERROR;
   }
+
+  /* Sequential consumers (marshal, streaming decoders) issue
+   * lots of small reads; let PhysFS read ahead in big blocks */
+  if (data.ioBufSize > 0)
+    PHYSFS_setBuffer(phys, data.ioBufSize);
+
   initReadOps(phys, data.ops, false);
 
   const char *ext = findExt(filename);
@@ -613,7 +1545,124 @@ openReadEnumCB(void *d, const char *dirpath, const char *filename) {
   return PHYSFS_ENUM_OK;
 }
 
+void FileSystem::addChangeObserver(ChangeObserver *obs) {
+  p->changeObservers.push_back(obs);
+}
+
+void FileSystem::startWatch() {
+  if (!mkxp_sys::startFileWatch("."))
+    Debug() << "File watching not available on this platform";
+}
+
+void FileSystem::processFileChanges() {
+  std::vector<std::string> changed;
+  mkxp_sys::pollFileChanges(changed);
+
+  for (size_t i = 0; i < changed.size(); ++i) {
+    const std::string &path = changed[i];
+
+    Debug() << "Asset changed:" << path;
+
+    if (p->havePathCache)
+      reloadPathCache(path.c_str());
+
+    /* Drop any prefetched copy; the cache is keyed by the
+     * requested name, which comes with or without the
+     * extension */
+    std::string key = prefetchKey(this, path.c_str());
+
+    SDL_LockMutex(p->prefetchMutex);
+
+    p->dropPrefetched(key);
+
+    size_t dot = key.find_last_of('.');
+
+    if (dot != std::string::npos && key.find('/', dot) == std::string::npos)
+      p->dropPrefetched(key.substr(0, dot));
+
+    SDL_UnlockMutex(p->prefetchMutex);
+
+    for (size_t j = 0; j < p->changeObservers.size(); ++j)
+      p->changeObservers[j]->fileChanged(path.c_str());
+  }
+}
+
+void FileSystem::prefetch(const char *filename) {
+  SDL_LockMutex(p->prefetchMutex);
+
+  if (!p->prefetchThread)
+    p->prefetchThread =
+        createSDLThread<FileSystemPrivate, &FileSystemPrivate::prefetchFun>(
+            p, "fs_prefetch");
+
+  p->prefetchQueue.push_back(filename);
+
+  SDL_CondBroadcast(p->prefetchCond);
+  SDL_UnlockMutex(p->prefetchMutex);
+}
+
+size_t FileSystem::prefetchUsage()
+{
+  SDL_LockMutex(p->prefetchMutex);
+  size_t bytes = p->prefetchBytes;
+  SDL_UnlockMutex(p->prefetchMutex);
+
+  return bytes;
+}
+
+void FileSystem::prefetchShrink(size_t targetBytes)
+{
+  SDL_LockMutex(p->prefetchMutex);
+
+  /* Same oldest-first scheme as the budget eviction */
+  while (p->prefetchBytes > targetBytes && !p->prefetchOrder.empty()) {
+    std::string oldest = p->prefetchOrder.front();
+    p->prefetchOrder.erase(p->prefetchOrder.begin());
+
+    FileSystemPrivate::PrefetchedFile *old = p->prefetchCache.value(oldest, 0);
+
+    if (!old)
+      continue;
+
+    p->prefetchCache.remove(oldest);
+    p->prefetchBytes -= old->data.size();
+
+    if (old->refs > 0)
+      old->zombie = true;
+    else
+      delete old;
+  }
+
+  SDL_UnlockMutex(p->prefetchMutex);
+}
+
+
 void FileSystem::openRead(OpenHandler &handler, const char *filename) {
+  /* Serve from the prefetch cache when the worker already
+   * slurped this file */
+  {
+    SDL_LockMutex(p->prefetchMutex);
+
+    FileSystemPrivate::PrefetchedFile *file =
+        p->prefetchCache.value(prefetchKey(this, filename), 0);
+
+    if (file)
+      ++file->refs;
+
+    SDL_UnlockMutex(p->prefetchMutex);
+
+    if (file) {
+      SDL_RWops ops;
+      initPrefetchOps(file, ops);
+
+      if (handler.tryRead(ops, file->ext.empty() ? 0 : file->ext.c_str()))
+        return;
+
+      /* Handler rejected the cached contents;
+       * fall through to the regular search */
+    }
+  }
+
   std::string filename_nm = normalize(filename, false, false);
   char buffer[512];
   size_t len = strcpySafe(buffer, filename_nm.c_str(), sizeof(buffer), -1);
@@ -641,7 +1690,8 @@ void FileSystem::openRead(OpenHandler &handler, const char *filename) {
     dir = buffer;
   }
   OpenReadEnumData data(handler, file, len + buffer - delim - !root,
-                        p->havePathCache ? &p->pathCache : 0);
+                        p->havePathCache ? &p->pathCache : 0,
+                        p->ioBufSize);
 
   if (p->havePathCache) {
     /* Get the list of files contained in this directory
@@ -661,6 +1711,69 @@ void FileSystem::openRead(OpenHandler &handler, const char *filename) {
     throw Exception(Exception::NoFileError, "%s", filename);
 }
 
+struct ExistsEnumData {
+  const char *filename;
+  size_t filenameN;
+  bool found;
+};
+
+static PHYSFS_EnumerateCallbackResult
+existsEnumCB(void *d, const char *, const char *filename) {
+  ExistsEnumData &data = *static_cast<ExistsEnumData *>(d);
+
+  if (strncmp(filename, data.filename, data.filenameN) != 0)
+    return PHYSFS_ENUM_OK;
+
+  char last = filename[data.filenameN];
+
+  if (last != '.' && last != '\0')
+    return PHYSFS_ENUM_OK;
+
+  data.found = true;
+  return PHYSFS_ENUM_STOP;
+}
+
+bool FileSystem::existsSupplemented(const char *filename) {
+  std::string filename_nm = normalize(filename, false, false);
+  char buffer[512];
+  size_t len = strcpySafe(buffer, filename_nm.c_str(), sizeof(buffer), -1);
+  char *delim;
+
+  if (p->havePathCache)
+    for (size_t i = 0; i < len; ++i)
+      buffer[i] = tolower(buffer[i]);
+
+  for (delim = buffer + len; delim > buffer; --delim)
+    if (*delim == '/')
+      break;
+
+  const bool root = (delim == buffer);
+
+  const char *file = buffer;
+  const char *dir = "";
+
+  if (!root) {
+    *delim = '\0';
+    file = delim + 1;
+    dir = buffer;
+  }
+
+  ExistsEnumData data = { file,
+                          (size_t) (len + buffer - delim - !root),
+                          false };
+
+  if (p->havePathCache) {
+    const std::vector<std::string> &fileList = p->fileLists[dir];
+
+    for (size_t i = 0; i < fileList.size() && !data.found; ++i)
+      existsEnumCB(&data, dir, fileList[i].c_str());
+  } else {
+    PHYSFS_enumerate(dir, existsEnumCB, &data);
+  }
+
+  return data.found;
+}
+
 void FileSystem::openReadRaw(SDL_RWops &ops, const char *filename,
                              bool freeOnClose) {
 
@@ -669,6 +1782,11 @@ void FileSystem::openReadRaw(SDL_RWops &ops, const char *filename,
   if (!handle)
     throw Exception(Exception::NoFileError, "%s", filename);
 
+  /* Buffer raw opens too; ini parsing and the script side's
+   * line readers issue byte-sized reads */
+  if (p->ioBufSize > 0)
+    PHYSFS_setBuffer(handle, p->ioBufSize);
+
   initReadOps(handle, ops, freeOnClose);
     return;
 }
@@ -683,12 +1801,18 @@ bool FileSystem::exists(const char *filename) {
 }
 
 const char *FileSystem::desensitize(const char *filename) {
-  std::string fn_lower(filename);
-    
-  std::transform(fn_lower.begin(), fn_lower.end(), fn_lower.begin(), [](unsigned char c){
-      return std::tolower(c);
-  });
-  if (p->havePathCache && p->pathCache.contains(fn_lower))
-    return p->pathCache[fn_lower].c_str();
-  return filename;
+  if (!p->havePathCache)
+    return filename;
+
+  /* Lower case into a stack buffer; the lookup itself is
+   * heterogeneous and never allocates */
+  char lower[512];
+  size_t len = strcpySafe(lower, filename, sizeof(lower), -1);
+
+  for (size_t i = 0; i < len; ++i)
+    lower[i] = tolower(lower[i]);
+
+  const std::string *hit = p->pathCache.valuePtr((const char *) lower);
+
+  return hit ? hit->c_str() : filename;
 }
@@ -35,18 +35,30 @@ class SharedFontState;
 class FileSystem
 {
 public:
+	/* 'ioBufSize' is the read ahead block size handed to
+	 * PhysFS on every read handle; 0 disables buffering */
 	FileSystem(const char *argv0,
-	           bool allowSymlinks);
+	           bool allowSymlinks,
+	           int ioBufSize = 64 * 1024);
 	~FileSystem();
 
 	void addPath(const char *path, const char *mountpoint = 0, bool reload = false);
     void removePath(const char *path, bool reload = false);
 
-	/* Call these after the last 'addPath()' */
-	void createPathCache();
-    
+	/* Call these after the last 'addPath()'. When
+	 * 'snapshotDir' is given, a serialized snapshot keyed
+	 * by the mount sources' mtimes is loaded from there
+	 * instead of re-enumerating an unchanged install, and
+	 * written back after a full build */
+	void createPathCache(const char *snapshotDir = 0);
+
     void reloadPathCache();
 
+    /* Re-enumerates only the given subtree (e.g. when a
+     * mod is toggled at runtime); much cheaper than a
+     * full cache rebuild */
+    void reloadPathCache(const char *subtree);
+
 	/* Scans "Fonts/" and creates inventory of
 	 * available font assets */
 	void initFontSets(SharedFontState &sfs);
@@ -67,16 +79,56 @@ public:
 	void openRead(OpenHandler &handler,
 	              const char *filename);
 
+	/* Queues a background read of the file (with the usual
+	 * extension supplementing) into an in-memory cache that
+	 * subsequent 'openRead()' calls are served from, so
+	 * loading screens can warm up bulk transfers ahead of
+	 * the actual opens */
+	void prefetch(const char *filename);
+
+	/* Prefetch cache footprint / pressure shedding (oldest first) */
+	size_t prefetchUsage();
+	void prefetchShrink(size_t targetBytes);
+
+	/* Borrowed view of the bytes backing 'ops' when it is served
+	 * straight from the prefetch cache; stays valid until this
+	 * ops copy is closed. Lets whole-file consumers parse in
+	 * place instead of copying through SDL_RWread */
+	static bool rwopsDirectView(const SDL_RWops &ops,
+	                            const uint8_t **data, size_t *len);
+
 	/* Circumvents extension supplementing */
 	void openReadRaw(SDL_RWops &ops,
 	                 const char *filename,
 	                 bool freeOnClose = false);
 
+	/* Development file watching: registered caches are told
+	 * which file changed so they can drop just that entry */
+	struct ChangeObserver
+	{
+		virtual void fileChanged(const char *path) = 0;
+	};
+
+	void addChangeObserver(ChangeObserver *obs);
+
+	/* Starts the platform watcher on the game directory;
+	 * no-op when no backend is available */
+	void startWatch();
+
+	/* Drains watcher events and invalidates the touched
+	 * path cache / prefetch entries, then notifies the
+	 * observers. Called once per frame */
+	void processFileChanges();
+
 	std::string normalize(const char *pathname, bool preferred, bool absolute);
 
 	/* Does not perform extension supplementing */
 	bool exists(const char *filename);
 
+	/* Existence check with the usual extension supplementing,
+	 * without opening the file */
+	bool existsSupplemented(const char *filename);
+
 	const char *desensitize(const char *filename);
 
 private:
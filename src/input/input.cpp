@@ -33,8 +33,10 @@
 #include <SDL_clipboard.h>
 
 #include <vector>
+#include <algorithm>
 #include <cmath>
 #include <unordered_map>
+#include <stdio.h>
 #include <string.h>
 #include <assert.h>
 
@@ -502,6 +504,452 @@ struct Binding
 };
 
 /* Keyboard binding */
+/* One coherent copy of the event thread's shared input
+ * state, refreshed at the top of Input::update through the
+ * seqlock: every query in the frame reads this, so aliased
+ * sources can't disagree mid-frame and neither thread ever
+ * blocks the other */
+static uint8_t snapKeyStates[SDL_NUM_SCANCODES];
+static EventThread::ControllerState snapControllerState;
+static EventThread::MouseState snapMouseState;
+static EventThread::CompositionState snapComposition;
+
+/* ---- Axis response ----
+ *
+ * Dead zone and response curve are precomputed into a 256
+ * entry magnitude table whenever the bindings are (re)built,
+ * so shaping an analog read is a single index; the binary
+ * direction checks in the bindings compare against the
+ * cached threshold directly */
+
+static int16_t axisResponseTable[256];
+static int axisThreshold = JAXIS_THRESHOLD;
+
+/* Analog reads keep their legacy raw values until either
+ * knob moves off its default; then both the digital
+ * threshold and the shaped output follow the config */
+static bool axisShapingActive = false;
+
+static void buildAxisResponse(int deadzone, double curve)
+{
+	axisThreshold = clamp(deadzone, 0, 32766);
+	axisShapingActive = (deadzone != JAXIS_THRESHOLD || curve != 1.0);
+
+	if (curve <= 0.0)
+		curve = 1.0;
+
+	for (int i = 0; i < 256; ++i)
+	{
+		double mag = i * 32767.0 / 255.0;
+		double out = 0.0;
+
+		if (mag > axisThreshold)
+			out = pow((mag - axisThreshold) / (32767.0 - axisThreshold),
+			          curve);
+
+		axisResponseTable[i] = (int16_t) (out * 32767.0 + 0.5);
+	}
+}
+
+static inline int16_t applyAxisResponse(int raw)
+{
+	if (!axisShapingActive)
+		return (int16_t) clamp(raw, -32767, 32767);
+
+	int mag = raw < 0 ? -raw : raw;
+
+	if (mag > 32767)
+		mag = 32767;
+
+	int16_t out = axisResponseTable[mag >> 7];
+
+	return raw < 0 ? (int16_t) -out : out;
+}
+
+/* ---- Deterministic record / replay ----
+ *
+ * Hooks at the exact points input crosses into game logic:
+ * the per-frame snapshot, the scroll consumption and every
+ * text fetch. Recording writes delta-encoded frame records
+ * (plus tagged scroll/text records in consumption order),
+ * replay feeds them back over the live state bit-exactly -
+ * given identical recorded inputs the script-side control
+ * flow reproduces, so the tagged records line up again.
+ * Replay falls back to live input at end of stream or on
+ * any mismatch */
+
+#define INPUT_REC_MAGIC "MKXPREPL"
+#define INPUT_REC_VERSION 2
+
+#define REC_TAG_FRAME  1
+#define REC_TAG_SCROLL 2
+#define REC_TAG_TEXT   3
+
+struct InputRecorder
+{
+	FILE *file;
+	bool recording;
+	bool replaying;
+
+	/* The reconstructed / last written state */
+	uint8_t keys[SDL_NUM_SCANCODES];
+	EventThread::ControllerState ctrl;
+	EventThread::MouseState mouse;
+
+	std::string replayText;
+
+	InputRecorder()
+	    : file(0), recording(false), replaying(false)
+	{
+		memset(keys, 0, sizeof(keys));
+		memset(&ctrl, 0, sizeof(ctrl));
+		memset(&mouse, 0, sizeof(mouse));
+	}
+
+	bool active() const { return recording || replaying; }
+
+	void open(const std::string &recordPath,
+	          const std::string &replayPath)
+	{
+		if (!replayPath.empty())
+		{
+			file = fopen(replayPath.c_str(), "rb");
+
+			char magic[8];
+			uint32_t version = 0;
+
+			if (file
+			&&  fread(magic, 1, 8, file) == 8
+			&&  !memcmp(magic, INPUT_REC_MAGIC, 8)
+			&&  fread(&version, 4, 1, file) == 1
+			&&  version == INPUT_REC_VERSION)
+			{
+				replaying = true;
+				return;
+			}
+
+			if (file)
+			{
+				fclose(file);
+				file = 0;
+			}
+
+			return;
+		}
+
+		if (recordPath.empty())
+			return;
+
+		file = fopen(recordPath.c_str(), "wb");
+
+		if (!file)
+			return;
+
+		uint32_t version = INPUT_REC_VERSION;
+		fwrite(INPUT_REC_MAGIC, 1, 8, file);
+		fwrite(&version, 4, 1, file);
+
+		recording = true;
+	}
+
+	void stop()
+	{
+		if (file)
+		{
+			fclose(file);
+			file = 0;
+		}
+
+		recording = replaying = false;
+	}
+
+	void put8(uint8_t v)   { fwrite(&v, 1, 1, file); }
+	void put16(uint16_t v) { fwrite(&v, 2, 1, file); }
+	void put32(int32_t v)  { fwrite(&v, 4, 1, file); }
+
+	void putD(double v)    { fwrite(&v, 8, 1, file); }
+
+	bool get8(uint8_t &v)   { return fread(&v, 1, 1, file) == 1; }
+	bool getD(double &v)    { return fread(&v, 8, 1, file) == 1; }
+	bool get16(uint16_t &v) { return fread(&v, 2, 1, file) == 1; }
+	bool get32(int32_t &v)  { return fread(&v, 4, 1, file) == 1; }
+
+	/* Called once per Input::update with the live snapshot;
+	 * overwrites it during replay */
+	/* 'now' is the frame's monotonic timestamp: recorded so
+	 * the time-based repeat logic replays deterministically,
+	 * overridden from the stream during playback */
+	void frameBoundary(uint8_t *liveKeys,
+	                   EventThread::ControllerState &liveCtrl,
+	                   EventThread::MouseState &liveMouse,
+	                   EventThread::CompositionState &liveComp,
+	                   double &now)
+	{
+		if (recording)
+		{
+			put8(REC_TAG_FRAME);
+			putD(now);
+
+			/* IME composition, full state (tiny and rare) */
+			uint8_t compLen = (uint8_t) strlen(liveComp.text);
+			put8(compLen);
+			fwrite(liveComp.text, 1, compLen, file);
+			put32(liveComp.start);
+			put32(liveComp.length);
+
+			/* Key deltas */
+			uint16_t count = 0;
+			for (int i = 0; i < SDL_NUM_SCANCODES; ++i)
+				if (liveKeys[i] != keys[i])
+					++count;
+
+			put16(count);
+			for (int i = 0; i < SDL_NUM_SCANCODES; ++i)
+				if (liveKeys[i] != keys[i])
+				{
+					put16((uint16_t) i);
+					put8(liveKeys[i]);
+				}
+
+			/* Controller button deltas */
+			count = 0;
+			for (int i = 0; i < 32; ++i)
+				if (liveCtrl.buttons[i] != ctrl.buttons[i])
+					++count;
+
+			put8((uint8_t) count);
+			for (int i = 0; i < 32; ++i)
+				if (liveCtrl.buttons[i] != ctrl.buttons[i])
+				{
+					put8((uint8_t) i);
+					put8(liveCtrl.buttons[i]);
+				}
+
+			/* Axis deltas */
+			count = 0;
+			for (int i = 0; i < SDL_CONTROLLER_AXIS_MAX; ++i)
+				if (liveCtrl.axes[i] != ctrl.axes[i])
+					++count;
+
+			put8((uint8_t) count);
+			for (int i = 0; i < SDL_CONTROLLER_AXIS_MAX; ++i)
+				if (liveCtrl.axes[i] != ctrl.axes[i])
+				{
+					put8((uint8_t) i);
+					put16((uint16_t) liveCtrl.axes[i]);
+				}
+
+			/* Mouse */
+			uint8_t flags = 0;
+			if (liveMouse.x != mouse.x || liveMouse.y != mouse.y)
+				flags |= 1;
+			if (liveMouse.inWindow != mouse.inWindow)
+				flags |= 2;
+
+			count = 0;
+			for (int i = 0; i < 32; ++i)
+				if (liveMouse.buttons[i] != mouse.buttons[i])
+					++count;
+
+			if (count)
+				flags |= 4;
+
+			put8(flags);
+
+			if (flags & 1)
+			{
+				put32(liveMouse.x);
+				put32(liveMouse.y);
+			}
+
+			if (flags & 2)
+				put8(liveMouse.inWindow);
+
+			if (flags & 4)
+			{
+				put8((uint8_t) count);
+				for (int i = 0; i < 32; ++i)
+					if (liveMouse.buttons[i] != mouse.buttons[i])
+					{
+						put8((uint8_t) i);
+						put8(liveMouse.buttons[i]);
+					}
+			}
+
+			memcpy(keys, liveKeys, sizeof(keys));
+			ctrl = liveCtrl;
+			mouse = liveMouse;
+
+			return;
+		}
+
+		/* Replay */
+		uint8_t tag;
+
+		if (!get8(tag) || tag != REC_TAG_FRAME || !getD(now))
+		{
+			stop();
+			return;
+		}
+
+		{
+			uint8_t compLen;
+			int32_t cs, cl;
+
+			if (!get8(compLen) || compLen >= sizeof(liveComp.text)
+			||  fread(liveComp.text, 1, compLen, file) != compLen
+			||  !get32(cs) || !get32(cl))
+			{
+				stop();
+				return;
+			}
+
+			liveComp.text[compLen] = '\0';
+			liveComp.start = cs;
+			liveComp.length = cl;
+		}
+
+		uint16_t keyCount;
+		if (!get16(keyCount)) { stop(); return; }
+
+		for (uint16_t n = 0; n < keyCount; ++n)
+		{
+			uint16_t sc; uint8_t val;
+			if (!get16(sc) || !get8(val) || sc >= SDL_NUM_SCANCODES)
+			{ stop(); return; }
+			keys[sc] = val;
+		}
+
+		uint8_t count;
+		if (!get8(count)) { stop(); return; }
+
+		for (uint8_t n = 0; n < count; ++n)
+		{
+			uint8_t idx, val;
+			if (!get8(idx) || !get8(val) || idx >= 32) { stop(); return; }
+			ctrl.buttons[idx] = val;
+		}
+
+		if (!get8(count)) { stop(); return; }
+
+		for (uint8_t n = 0; n < count; ++n)
+		{
+			uint8_t idx; uint16_t val;
+			if (!get8(idx) || !get16(val)
+			||  idx >= SDL_CONTROLLER_AXIS_MAX) { stop(); return; }
+			ctrl.axes[idx] = (int16_t) val;
+		}
+
+		uint8_t flags;
+		if (!get8(flags)) { stop(); return; }
+
+		if (flags & 1)
+		{
+			int32_t x, y;
+			if (!get32(x) || !get32(y)) { stop(); return; }
+			mouse.x = x;
+			mouse.y = y;
+		}
+
+		if (flags & 2)
+		{
+			uint8_t in;
+			if (!get8(in)) { stop(); return; }
+			mouse.inWindow = in;
+		}
+
+		if (flags & 4)
+		{
+			if (!get8(count)) { stop(); return; }
+
+			for (uint8_t n = 0; n < count; ++n)
+			{
+				uint8_t idx, val;
+				if (!get8(idx) || !get8(val) || idx >= 32)
+				{ stop(); return; }
+				mouse.buttons[idx] = val;
+			}
+		}
+
+		memcpy(liveKeys, keys, sizeof(keys));
+		liveCtrl = ctrl;
+		liveMouse = mouse;
+	}
+
+	/* Wraps the scroll consumption */
+	int filterScroll(int live)
+	{
+		if (recording)
+		{
+			put8(REC_TAG_SCROLL);
+			put32(live);
+
+			return live;
+		}
+
+		if (replaying)
+		{
+			uint8_t tag;
+			int32_t val;
+
+			if (!get8(tag) || tag != REC_TAG_SCROLL || !get32(val))
+			{
+				stop();
+				return live;
+			}
+
+			return val;
+		}
+
+		return live;
+	}
+
+	/* Wraps every text fetch */
+	const char *filterText(const char *live)
+	{
+		if (recording)
+		{
+			uint16_t len = (uint16_t) strlen(live);
+
+			put8(REC_TAG_TEXT);
+			put16(len);
+			fwrite(live, 1, len, file);
+
+			return live;
+		}
+
+		if (replaying)
+		{
+			uint8_t tag;
+			uint16_t len;
+
+			if (!get8(tag) || tag != REC_TAG_TEXT || !get16(len))
+			{
+				stop();
+				return live;
+			}
+
+			replayText.resize(len);
+
+			if (len && fread(&replayText[0], 1, len, file) != len)
+			{
+				stop();
+				return live;
+			}
+
+			return replayText.c_str();
+		}
+
+		return live;
+	}
+};
+
+static InputRecorder inputRecorder;
+
+/* The frame's timestamp, set once per Input::update (and
+ * overridden by replay); all repeat timing reads this */
+static double inputFrameNow;
+
 struct KbBinding : public Binding
 {
     KbBinding() {}
@@ -515,14 +963,14 @@ struct KbBinding : public Binding
     {
         /* Special case aliases */
         if (source == SDL_SCANCODE_LSHIFT)
-            return EventThread::keyStates[source]
-            || EventThread::keyStates[SDL_SCANCODE_RSHIFT];
+            return snapKeyStates[source]
+            || snapKeyStates[SDL_SCANCODE_RSHIFT];
         
         if (source == SDL_SCANCODE_RETURN)
-            return EventThread::keyStates[source]
-            || EventThread::keyStates[SDL_SCANCODE_KP_ENTER];
+            return snapKeyStates[source]
+            || snapKeyStates[SDL_SCANCODE_KP_ENTER];
         
-        return EventThread::keyStates[source];
+        return snapKeyStates[source];
     }
     
     bool sourceRepeatable() const
@@ -544,7 +992,7 @@ struct CtrlButtonBinding : public Binding
     
     bool sourceActive() const
     {
-        return EventThread::controllerState.buttons[source];
+        return snapControllerState.buttons[source];
     }
     
     bool sourceRepeatable() const
@@ -564,12 +1012,12 @@ struct CtrlAxisBinding : public Binding
     
     bool sourceActive() const
     {
-        float val = EventThread::controllerState.axes[source];
-        
+        float val = snapControllerState.axes[source];
+
         if (dir == Negative)
-            return val < -JAXIS_THRESHOLD;
+            return val < -axisThreshold;
         else
-            return val > JAXIS_THRESHOLD;
+            return val > axisThreshold;
     }
     
     bool sourceRepeatable() const {
@@ -593,7 +1041,7 @@ struct MsBinding : public Binding
     
     bool sourceActive() const
     {
-        return EventThread::mouseState.buttons[index];
+        return snapMouseState.buttons[index];
     }
     
     bool sourceRepeatable() const
@@ -711,8 +1159,16 @@ struct InputPrivate
     
     double repeatTime, rawRepeatTime, buttonRepeatTime;
     
-    unsigned int repeatStart;
-    unsigned int repeatDelay;
+    /* Repeat timing in seconds of monotonic runtime */
+    double repeatStartSec;
+    double repeatIntervalSec;
+
+    /* Last time each repeat domain fired */
+    double repeatLastFire, rawRepeatLastFire, buttonRepeatLastFire;
+
+    /* Whether the raw/button repeat fired this frame
+     * (queries must agree within one frame) */
+    bool rawRepeatFired, buttonRepeatFired;
     
     double last_update;
 
@@ -730,30 +1186,25 @@ struct InputPrivate
     } dir8Data;
     
     void recalcRepeatTime(unsigned int fps, double start, double delay) {
-        // 0 fps would cause a divide by zero segfault later.
-        // Bail in that case.
-        if (fps == 0)
-        {
-            return;
-        }
+        /* Repeat is rebased on monotonic time, so the frame
+         * rate no longer factors in; fps stays in the
+         * signature for the per-frame recalc callers */
+        (void) fps;
 
-        double framems = 1.f / fps;
-        
-        // Approximate time in milliseconds
-//        double start = (rgssVer >= 2) ? 0.375 : 0.400;
-//        double delay = 0.100;
-        
-        repeatStart = ceil(start / framems);
-        repeatDelay = ceil(delay / framems);
+        repeatStartSec = start;
+        repeatIntervalSec = std::max(delay, 0.001);
     }
     
     InputPrivate(const RGSSThreadData &rtData)
     {
         last_update = 0;
-        
+
+        buildAxisResponse(rtData.config.joystickDeadzone,
+                          rtData.config.axisResponseCurve);
+
         initStaticKbBindings();
         initMsBindings();
-        
+
         /* Main thread should have these posted by now */
         checkBindingChange(rtData);
         
@@ -777,7 +1228,11 @@ struct InputPrivate
         
         repeating = Input::None;
         repeatCount = 0;
-        
+
+        repeatTime = rawRepeatTime = buttonRepeatTime = 0;
+        repeatLastFire = rawRepeatLastFire = buttonRepeatLastFire = 0;
+        rawRepeatFired = buttonRepeatFired = false;
+
         dir4Data.active = 0;
         dir4Data.previous = Input::None;
         
@@ -856,7 +1311,7 @@ struct InputPrivate
         b.triggered = (rawStates[scancode] && !rawStatesOld[scancode]);
         b.released = (!rawStates[scancode] && rawStatesOld[scancode]);
         
-        b.repeated = (rawRepeating == scancode) && (rawRepeatCount >= repeatStart && ((rawRepeatCount+1) % repeatDelay) == 0);
+        b.repeated = (rawRepeating == scancode) && rawRepeatFired;
         
         return b;
     }
@@ -868,7 +1323,7 @@ struct InputPrivate
         b.triggered = (rawButtonStates[button] && !rawButtonStatesOld[button]);
         b.released = (!rawButtonStates[button] && rawButtonStatesOld[button]);
         
-        b.repeated = (buttonRepeating == button) && (buttonRepeatCount >= repeatStart && ((buttonRepeatCount+1) % repeatDelay) == 0);
+        b.repeated = (buttonRepeating == button) && buttonRepeatFired;
         
         return b;
     }
@@ -1052,7 +1507,7 @@ struct InputPrivate
     void updateRaw()
     {
         
-        memcpy(rawStates, shState->eThread().keyStates, SDL_NUM_SCANCODES);
+        memcpy(rawStates, snapKeyStates, SDL_NUM_SCANCODES);
         
         for (int i = 0; i < SDL_NUM_SCANCODES; i++)
         {
@@ -1061,11 +1516,21 @@ struct InputPrivate
                 if (rawRepeating == i)
                 {
                     rawRepeatCount++;
+
+                    double now = inputFrameNow;
+                    rawRepeatFired =
+                        (now - rawRepeatTime) >= repeatStartSec
+                     && (now - rawRepeatLastFire) >= repeatIntervalSec;
+
+                    if (rawRepeatFired)
+                        rawRepeatLastFire = now;
                 }
                 else
                 {
                     rawRepeatCount = 0;
-                    rawRepeatTime = shState->runTime();
+                    rawRepeatTime = inputFrameNow;
+                    rawRepeatLastFire = rawRepeatTime;
+                    rawRepeatFired = false;
                     rawRepeating = i;
                 }
                 
@@ -1074,26 +1539,39 @@ struct InputPrivate
         }
         
         rawRepeating = -1;
+        rawRepeatFired = false;
         
     }
     
     void updateControllerRaw()
     {
         for (int i = 0; i < SDL_CONTROLLER_AXIS_MAX; i++)
-            axisStateArray[i] = shState->eThread().controllerState.axes[i];
+            axisStateArray[i] = snapControllerState.axes[i];
         
-        memcpy(rawButtonStates, shState->eThread().controllerState.buttons, SDL_CONTROLLER_BUTTON_MAX);
+        memcpy(rawButtonStates, snapControllerState.buttons, SDL_CONTROLLER_BUTTON_MAX);
         
         for (int i = 0; i < SDL_CONTROLLER_BUTTON_MAX; i++)
         {
             if (rawButtonStates[i] && rawButtonStatesOld[i])
             {
                 if (buttonRepeating == i)
+                {
                     buttonRepeatCount++;
+
+                    double now = inputFrameNow;
+                    buttonRepeatFired =
+                        (now - buttonRepeatTime) >= repeatStartSec
+                     && (now - buttonRepeatLastFire) >= repeatIntervalSec;
+
+                    if (buttonRepeatFired)
+                        buttonRepeatLastFire = now;
+                }
                 else
                 {
                     buttonRepeatCount = 0;
-                    buttonRepeatTime = shState->runTime();
+                    buttonRepeatTime = inputFrameNow;
+                    buttonRepeatLastFire = buttonRepeatTime;
+                    buttonRepeatFired = false;
                     buttonRepeating = i;
                 }
                 
@@ -1190,6 +1668,9 @@ struct InputPrivate
 Input::Input(const RGSSThreadData &rtData)
 {
     p = new InputPrivate(rtData);
+
+    inputRecorder.open(rtData.config.recordInput,
+                       rtData.config.replayInput);
 }
 
 double Input::getDelta() {
@@ -1204,7 +1685,21 @@ void Input::update()
 {
     shState->checkShutdown();
     p->checkBindingChange(shState->rtData());
-    
+
+    EventThread::snapshotStates(snapKeyStates, snapControllerState,
+                                snapMouseState);
+
+    inputFrameNow = shState->runTime();
+
+    /* Coalesce the frame's text/IME events into one delivery */
+    shState->eThread().pumpTextInput();
+    EventThread::snapshotComposition(snapComposition);
+
+    if (inputRecorder.active())
+        inputRecorder.frameBoundary(snapKeyStates, snapControllerState,
+                                    snapMouseState, snapComposition,
+                                    inputFrameNow);
+
     p->swapBuffers();
     p->clearBuffer();
     
@@ -1218,9 +1713,9 @@ void Input::update()
     p->updateControllerRaw();
     
     // Record mouse positions
-    p->mousePos[0] = shState->eThread().mouseState.x;
-    p->mousePos[1] = shState->eThread().mouseState.y;
-    p->mouseInWindow = shState->eThread().mouseState.inWindow;
+    p->mousePos[0] = snapMouseState.x;
+    p->mousePos[1] = snapMouseState.y;
+    p->mouseInWindow = snapMouseState.inWindow;
     
     
     /* Check for new repeating key */
@@ -1228,9 +1723,10 @@ void Input::update()
     {
         p->repeating = repeatCand;
         p->repeatCount = 0;
-        p->repeatTime = shState->runTime();
+        p->repeatTime = inputFrameNow;
+        p->repeatLastFire = p->repeatTime;
         p->getState(repeatCand).repeated = true;
-        
+
         p->last_update = p->repeatTime;
         return;
     }
@@ -1239,25 +1735,30 @@ void Input::update()
     if (p->getState(p->repeating).pressed)
     {
         p->repeatCount++;
-        
-        /*
-         bool repeated;
-         if (rgssVer >= 2)
-         repeated = p->repeatCount >= 23 && ((p->repeatCount+1) % 6) == 0;
-         else
-         repeated = p->repeatCount >= 15 && ((p->repeatCount+1) % 4) == 0;
-         */
-        bool repeated = p->repeatCount >= p->repeatStart && ((p->repeatCount+1) % p->repeatDelay) == 0;
+
+        /* Time based: a repeat fires once the start delay has
+         * elapsed since the press and the interval since the
+         * last fire, regardless of how many frames that took */
+        double now = inputFrameNow;
+        bool repeated = (now - p->repeatTime) >= p->repeatStartSec
+                     && (now - p->repeatLastFire) >= p->repeatIntervalSec;
+
+        if (repeated)
+            p->repeatLastFire = now;
+
         p->getState(p->repeating).repeated |= repeated;
-        
-        p->last_update = shState->runTime();
+
+        p->last_update = now;
         return;
     }
     
     p->repeating = None;
     
     /* Fetch new cumulative scroll distance and reset counter */
-    p->vScrollDistance = SDL_AtomicSet(&EventThread::verticalScrollDistance, 0);
+    p->vScrollDistance = inputRecorder.active()
+        ? inputRecorder.filterScroll(
+              SDL_AtomicSet(&EventThread::verticalScrollDistance, 0))
+        : SDL_AtomicSet(&EventThread::verticalScrollDistance, 0);
     
     p->last_update = shState->runTime();
 }
@@ -1421,8 +1922,10 @@ unsigned int Input::rawAxesLength() {
 short Input::getControllerAxisValue(SDL_GameControllerAxis axis) {
     if (axis < 0 || (uint32_t)axis >= rawAxesLength())
         return 0;
-    
-    return rawAxes()[axis];
+
+    /* Shaped by the configured dead zone / response curve;
+     * raw_axes stays raw */
+    return applyAxisResponse(rawAxes()[axis]);
 }
 
 bool Input::mouseInWindow() {
@@ -1505,26 +2008,44 @@ void Input::setTextInputMode(bool mode)
 
 const char *Input::getText()
 {
-    return shState->eThread().textInputBuffer.c_str();
+    const char *live = shState->eThread().fetchTextInput();
+
+    if (inputRecorder.active())
+        return inputRecorder.filterText(live);
+
+    return live;
+}
+
+const char *Input::compositionText()
+{
+    return snapComposition.text;
+}
+
+int Input::compositionStart()
+{
+    return snapComposition.start;
+}
+
+int Input::compositionLength()
+{
+    return snapComposition.length;
 }
 
 void Input::clearText()
 {
-    shState->eThread().textInputBuffer.clear();
+    shState->eThread().discardTextInput();
 }
 
-char *Input::getClipboardText()
+std::string Input::getClipboardText()
 {
-    char *tx = SDL_GetClipboardText();
-    if (!tx)
-        throw Exception(Exception::SDLError, "Failed to get clipboard text: %s", SDL_GetError());
-    return tx;
+    /* Serviced by the event thread; frames keep presenting
+     * while the platform clipboard is negotiated with */
+    return shState->eThread().requestClipboardGet();
 }
 
-void Input::setClipboardText(char *text)
+void Input::setClipboardText(const char *text)
 {
-    if (SDL_SetClipboardText(text) < 0)
-        throw Exception(Exception::SDLError, "Failed to set clipboard text: %s", SDL_GetError());
+    shState->eThread().requestClipboardSet(text);
 }
 
 const char *Input::getAxisName(SDL_GameControllerAxis axis) {
@@ -1543,5 +2064,8 @@ const char *Input::getButtonName(SDL_GameControllerButton button) {
 
 Input::~Input()
 {
+    /* Flushes a recording in progress */
+    inputRecorder.stop();
+
     delete p;
 }
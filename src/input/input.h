@@ -110,9 +110,14 @@ public:
     void setTextInputMode(bool mode);
     const char *getText();
     void clearText();
+
+    /* Live IME composition, snapshotted per update */
+    const char *compositionText();
+    int compositionStart();
+    int compositionLength();
     
-    char *getClipboardText();
-    void setClipboardText(char *text);
+    std::string getClipboardText();
+    void setClipboardText(const char *text);
     
     const char *getAxisName(SDL_GameControllerAxis axis);
     const char *getButtonName(SDL_GameControllerButton button);
@@ -39,6 +39,7 @@
 #include "binding.h"
 #include "sharedstate.h"
 #include "eventthread.h"
+#include "util/boottrace.h"
 #include "util/debugwriter.h"
 #include "util/exception.h"
 #include "display/gl/gl-debug.h"
@@ -202,6 +203,7 @@ static void setupWindowIcon(const Config &conf, SDL_Window *win) {
 }
 
 int main(int argc, char *argv[]) {
+    BootTrace::begin("boot");
     SDL_SetHint(SDL_HINT_VIDEO_MINIMIZE_ON_FOCUS_LOSS, "0");
     SDL_SetHint(SDL_HINT_ACCELEROMETER_AS_JOYSTICK, "0");
 
@@ -210,11 +212,14 @@ int main(int argc, char *argv[]) {
 #endif
 
     /* initialize SDL first */
+    BootTrace::begin("sdl-init");
     if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_GAMECONTROLLER | SDL_INIT_TIMER) < 0) {
       showInitError(std::string("Error initializing SDL: ") + SDL_GetError());
       return 0;
     }
 
+    BootTrace::end();
+
     if (!EventThread::allocUserEvents()) {
       showInitError("Error allocating SDL user events");
       return 0;
@@ -236,8 +241,10 @@ int main(int argc, char *argv[]) {
 #endif
     
     /* now we load the config */
+    BootTrace::begin("config-read");
     Config conf;
     conf.read(argc, argv);
+    BootTrace::end();
 
 #if defined(__WIN32__)
     // Create a debug console in debug mode
@@ -268,6 +275,7 @@ int main(int argc, char *argv[]) {
     assert(conf.rgssVersion >= 1 && conf.rgssVersion <= 3);
     printRgssVersion(conf.rgssVersion);
 
+    BootTrace::begin("media-init");
     int imgFlags = IMG_INIT_PNG | IMG_INIT_JPG;
     if (IMG_Init(imgFlags) != imgFlags) {
       showInitError(std::string("Error initializing SDL_image: ") +
@@ -307,6 +315,27 @@ int main(int argc, char *argv[]) {
 
       return 0;
     }
+    /* Audio device discovery can block for a surprisingly long time
+     * on some backends; it needs nothing from the window, so it runs
+     * on a worker overlapping window + GL creation, and joins right
+     * before the device is first needed */
+    struct ALCOpenState
+    {
+        ALCdevice *dev;
+
+        static int fun(void *ptr)
+        {
+            static_cast<ALCOpenState *>(ptr)->dev = alcOpenDevice(0);
+            return 0;
+        }
+    };
+
+    BootTrace::end();
+
+    ALCOpenState alcOpen = { 0 };
+    SDL_Thread *alcThread =
+            SDL_CreateThread(ALCOpenState::fun, "alcopen", &alcOpen);
+
 #if defined(__WIN32__)
     WSAData wsadata = {0};
     if (WSAStartup(0x101, &wsadata) || wsadata.wVersion != 0x101) {
@@ -325,6 +354,8 @@ int main(int argc, char *argv[]) {
       winFlags |= SDL_WINDOW_RESIZABLE;
     if (conf.fullscreen)
       winFlags |= SDL_WINDOW_FULLSCREEN_DESKTOP;
+    if (conf.headless)
+      winFlags |= SDL_WINDOW_HIDDEN;
     
 #ifdef GLES2_HEADER
   SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_ES);
@@ -339,13 +370,23 @@ int main(int argc, char *argv[]) {
 #endif
 #endif
     
+    BootTrace::begin("create-window");
     win = SDL_CreateWindow(conf.windowTitle.c_str(), SDL_WINDOWPOS_UNDEFINED,
                            SDL_WINDOWPOS_UNDEFINED, conf.defScreenW,
                            conf.defScreenH, winFlags);
 
+    BootTrace::end();
+
     if (!win) {
       showInitError(std::string("Error creating window: ") + SDL_GetError());
 
+      /* Reel the audio worker back in before bailing */
+      if (alcThread) {
+        SDL_WaitThread(alcThread, 0);
+        if (alcOpen.dev)
+          alcCloseDevice(alcOpen.dev);
+      }
+
 #ifdef MKXPZ_STEAM
       STEAMSHIM_deinit();
 #endif
@@ -361,6 +402,11 @@ int main(int argc, char *argv[]) {
                           " cannot run from the Downloads directory.\n\n" +
                           "Please move the application to the Applications folder (or anywhere else) " +
                           "and try again.");
+            if (alcThread) {
+              SDL_WaitThread(alcThread, 0);
+              if (alcOpen.dev)
+                alcCloseDevice(alcOpen.dev);
+            }
 #ifdef MKXPZ_STEAM
             STEAMSHIM_deinit();
 #endif
@@ -392,7 +438,21 @@ int main(int argc, char *argv[]) {
     (void)setupWindowIcon;
 #endif
 
-    ALCdevice *alcDev = alcOpenDevice(0);
+    ALCdevice *alcDev;
+
+    BootTrace::begin("alc-open-wait");
+    if (alcThread)
+    {
+        SDL_WaitThread(alcThread, 0);
+        alcDev = alcOpen.dev;
+    }
+    else
+    {
+        /* Worker never spawned; open it here after all */
+        alcDev = alcOpenDevice(0);
+    }
+
+    BootTrace::end();
 
     if (!alcDev) {
       showInitError("Could not detect an available audio device.");
@@ -417,7 +477,9 @@ int main(int argc, char *argv[]) {
     EventThread eventThread;
 
 #ifndef MKXPZ_INIT_GL_LATER
+    BootTrace::begin("init-gl");
     SDL_GLContext glCtx = initGL(win, conf, 0);
+    BootTrace::end();
 #else
     SDL_GLContext glCtx = NULL;
 #endif
@@ -542,6 +604,12 @@ static SDL_GLContext initGL(SDL_Window *win, Config &conf,
   bool vsync = conf.vsync || conf.syncToRefreshrate;
   SDL_GL_SetSwapInterval(vsync ? 1 : 0);
 
-  // GLDebugLogger dLogger;
+  /* Full logging in debug mode; cheap sampled capture when
+   * configured for live builds */
+  if (conf.editor.debug || conf.debugMode)
+    new GLDebugLogger();
+  else if (conf.glDebugSample > 0)
+    new GLDebugLogger(0, conf.glDebugSample);
+
   return glCtx;
 }
@@ -80,6 +80,91 @@ std::string getPath(LUrlParser::ParseURL url) {
 
 using namespace mkxp_net;
 
+/* ---- Keep-alive connection pool ----
+ *
+ * Every request used to construct (and tear down) a fresh
+ * client, paying connect/TLS setup each time. Idle clients
+ * are now parked per host and handed out exclusively; a
+ * client is only shared sequentially, never concurrently */
+class ClientPool {
+public:
+    httplib::Client *acquire(const std::string &host) {
+        {
+            std::lock_guard<std::mutex> lock(mut);
+
+            std::vector<httplib::Client *> &list = idle[host];
+
+            if (!list.empty()) {
+                httplib::Client *client = list.back();
+                list.pop_back();
+
+                return client;
+            }
+        }
+
+        httplib::Client *client = new httplib::Client(host.c_str());
+
+        // Seems to need to be disabled for now, at least on macOS
+#ifdef MKXPZ_SSL
+        client->enable_server_certificate_verification(false);
+#endif
+        client->set_keep_alive(true);
+
+        return client;
+    }
+
+    void release(const std::string &host, httplib::Client *client) {
+        std::lock_guard<std::mutex> lock(mut);
+
+        std::vector<httplib::Client *> &list = idle[host];
+
+        /* A handful of parked connections per host is plenty */
+        if (list.size() >= 4) {
+            delete client;
+            return;
+        }
+
+        list.push_back(client);
+    }
+
+    static ClientPool &instance() {
+        /* Intentionally leaked; lives for the process */
+        static ClientPool *p = new ClientPool;
+        return *p;
+    }
+
+private:
+    std::mutex mut;
+    std::unordered_map<std::string, std::vector<httplib::Client *> > idle;
+};
+
+/* Checkout helper so error paths can't leak or strand a client */
+struct PooledClient {
+    std::string host;
+    httplib::Client *client;
+    bool poisoned;
+
+    explicit PooledClient(const std::string &host)
+        : host(host),
+          client(ClientPool::instance().acquire(host)),
+          poisoned(false)
+    {}
+
+    /* A transfer that stopped mid-body leaves unread response
+     * bytes on the wire; parking that connection would poison
+     * the next request on this host */
+    void poison() { poisoned = true; }
+
+    ~PooledClient() {
+        if (poisoned)
+            delete client;
+        else
+            ClientPool::instance().release(host, client);
+    }
+
+    httplib::Client *operator->() { return client; }
+};
+
 HTTPResponse::HTTPResponse() :
     _headers(StringMap()),
     _status(0),
@@ -115,113 +200,74 @@ StringMap &HTTPRequest::headers() {
 HTTPResponse HTTPRequest::get() {
     HTTPResponse ret;
     auto target = readURL(destination.c_str());
-    
-    httplib::Client *client = nullptr;
-    try {
-        client = new httplib::Client(getHost(target).c_str());
-    }
-    catch (std::exception &e) {
-        delete client;
-        throw Exception(Exception::MKXPError, "Failed to create HTTP client (%s)", e.what());
-    }
-    
-    httplib::Headers head;
-    
-    // Seems to need to be disabled for now, at least on macOS
-#ifdef MKXPZ_SSL
-    client->enable_server_certificate_verification(false);
-#endif
+
+    PooledClient client(getHost(target));
     client->set_follow_location(follow_location);
-    
+
+    httplib::Headers head;
+
     for (auto const &h : _headers)
         head.emplace(h.first, h.second);
-        
+
     if (auto result = client->Get(getPath(target).c_str(), head)) {
         auto response = result.value();
         ret._status = response.status;
         ret._body = response.body;
-        
+
         for (auto const &h : response.headers)
             ret._headers.emplace(h.first, h.second);
     }
     else {
         auto err = result.error();
         std::string errname = httplib::to_string(err);
-        delete client;
         throw Exception(Exception::MKXPError, "Failed to GET %s (%i: %s)", destination.c_str(), err, errname.c_str());
     }
-    
-    delete client;
+
     return ret;
 }
 
 HTTPResponse HTTPRequest::post(StringMap &postData) {
     HTTPResponse ret;
     auto target = readURL(destination.c_str());
-    
-    httplib::Client *client = nullptr;
-    try {
-        client = new httplib::Client(getHost(target).c_str());
-    }
-    catch (std::exception &e) {
-        delete client;
-        throw Exception(Exception::MKXPError, "Failed to create HTTP client (%s)", e.what());
-    }
-    
+
+    PooledClient client(getHost(target));
+    client->set_follow_location(follow_location);
+
     httplib::Headers head;
     httplib::Params params;
-    
-    // Seems to need to be disabled for now, at least on macOS
-#ifdef MKXPZ_SSL
-    client->enable_server_certificate_verification(false);
-#endif
-    client->set_follow_location(follow_location);
-    
+
     for (auto const &h : _headers)
         head.emplace(h.first, h.second);
-    
+
     for (auto const &p : postData)
         params.emplace(p.first, p.second);
-    
+
     if (auto result = client->Post(getPath(target).c_str(), head, params)) {
         auto response = result.value();
         ret._status = response.status;
         ret._body = response.body;
-        
+
         for (auto h : response.headers)
             ret._headers.emplace(h.first, h.second);
     }
     else {
         auto err = result.error();
         std::string errname = httplib::to_string(err);
-        delete client;
         throw Exception(Exception::MKXPError, "Failed to POST %s (%i: %s)", destination.c_str(), err, errname.c_str());
     }
-    delete client;
+
     return ret;
 }
 
 HTTPResponse HTTPRequest::post(const char *body, const char *content_type) {
     HTTPResponse ret;
     auto target = readURL(destination.c_str());
-    
-    httplib::Client *client = nullptr;
-    try {
-        client = new httplib::Client(getHost(target).c_str());
-    }
-    catch (std::exception &e) {
-        delete client;
-        throw Exception(Exception::MKXPError, "Failed to create HTTP client (%s)", e.what());
-    }
-    
-    httplib::Headers head;
-    
-    // Seems to need to be disabled for now, at least on macOS
-#ifdef MKXPZ_SSL
-    client->enable_server_certificate_verification(false);
-#endif
+
+    PooledClient client(getHost(target));
     client->set_follow_location(true);
-    
+
+    httplib::Headers head;
+
     for (auto const &h : _headers)
         head.emplace(h.first, h.second);
 
@@ -229,16 +275,682 @@ HTTPResponse HTTPRequest::post(const char *body, const char *content_type) {
         auto response = result.value();
         ret._status = response.status;
         ret._body = response.body;
-        
+
         for (auto const &h : response.headers)
             ret._headers.emplace(h.first, h.second);
     }
     else {
         auto err = result.error();
         std::string errname = httplib::to_string(err);
-        delete client;
         throw Exception(Exception::MKXPError, "Failed to POST %s (%i: %s)", destination.c_str(), err, errname.c_str());
     }
-    delete client;
+
     return ret;
 }
+
+/* ---- Async requests ---- */
+
+#include <deque>
+#include <thread>
+
+namespace mkxp_net {
+
+/* Small shared pool; telemetry + cloud save sync rarely
+ * need more than a couple of transfers in flight */
+class HTTPWorkerPool {
+public:
+    static HTTPWorkerPool &instance() {
+        /* Intentionally leaked; lives for the process */
+        static HTTPWorkerPool *p = new HTTPWorkerPool;
+        return *p;
+    }
+
+    void enqueue(std::shared_ptr<HTTPAsync> job) {
+        std::lock_guard<std::mutex> lock(mut);
+
+        queue.push_back(job);
+
+        if (workers < 4 && (int) queue.size() > idle) {
+            ++workers;
+            std::thread(&HTTPWorkerPool::workerFun, this).detach();
+        }
+
+        cond.notify_one();
+    }
+
+private:
+    HTTPWorkerPool()
+        : workers(0),
+          idle(0)
+    {}
+
+    void workerFun() {
+        std::unique_lock<std::mutex> lock(mut);
+
+        while (true) {
+            while (queue.empty()) {
+                ++idle;
+                cond.wait(lock);
+                --idle;
+            }
+
+            std::shared_ptr<HTTPAsync> job = queue.front();
+            queue.pop_front();
+
+            lock.unlock();
+            job->run();
+            lock.lock();
+        }
+    }
+
+    std::mutex mut;
+    std::condition_variable cond;
+    std::deque<std::shared_ptr<HTTPAsync> > queue;
+    int workers;
+    int idle;
+};
+
+}
+
+HTTPAsync::HTTPAsync()
+    : kind(Get),
+      followRedirects(true),
+      finished(false),
+      canceled(false),
+      respStatus(0)
+{}
+
+std::shared_ptr<HTTPAsync> HTTPAsync::enqueue(std::shared_ptr<HTTPAsync> job) {
+    HTTPWorkerPool::instance().enqueue(job);
+
+    return job;
+}
+
+std::shared_ptr<HTTPAsync> HTTPAsync::get(const char *url,
+                                          const StringMap &headers,
+                                          bool followRedirects) {
+    std::shared_ptr<HTTPAsync> job(new HTTPAsync);
+    job->kind = Get;
+    job->url = url;
+    job->reqHeaders = headers;
+    job->followRedirects = followRedirects;
+
+    return enqueue(job);
+}
+
+std::shared_ptr<HTTPAsync> HTTPAsync::postForm(const char *url,
+                                               const StringMap &headers,
+                                               const StringMap &form,
+                                               bool followRedirects) {
+    std::shared_ptr<HTTPAsync> job(new HTTPAsync);
+    job->kind = PostForm;
+    job->url = url;
+    job->reqHeaders = headers;
+    job->form = form;
+    job->followRedirects = followRedirects;
+
+    return enqueue(job);
+}
+
+std::shared_ptr<HTTPAsync> HTTPAsync::postBody(const char *url,
+                                               const StringMap &headers,
+                                               const char *body,
+                                               const char *contentType) {
+    std::shared_ptr<HTTPAsync> job(new HTTPAsync);
+    job->kind = PostBody;
+    job->url = url;
+    job->reqHeaders = headers;
+    job->body = body;
+    job->contentType = contentType;
+
+    return enqueue(job);
+}
+
+void HTTPAsync::run() {
+    try {
+        auto target = readURL(url.c_str());
+
+        PooledClient client(getHost(target));
+        client->set_follow_location(followRedirects);
+
+        httplib::Headers head;
+
+        for (auto const &h : reqHeaders)
+            head.emplace(h.first, h.second);
+
+        /* GET bodies stream chunk-wise into the drain buffer;
+         * the POST variants buffer their (typically small)
+         * responses whole */
+        httplib::Result result;
+
+        switch (kind) {
+        case Get:
+            result = client->Get(getPath(target).c_str(), head,
+                [this](const httplib::Response &response) {
+                    std::lock_guard<std::mutex> lock(mut);
+
+                    respStatus = response.status;
+
+                    for (auto const &h : response.headers)
+                        respHeaders.emplace(h.first, h.second);
+
+                    return true;
+                },
+                [this](const char *chunk, size_t len) {
+                    std::lock_guard<std::mutex> lock(mut);
+
+                    if (canceled)
+                        return false;
+
+                    data.append(chunk, len);
+                    cond.notify_all();
+
+                    return true;
+                });
+            break;
+
+        case PostForm: {
+            httplib::Params params;
+
+            for (auto const &p : form)
+                params.emplace(p.first, p.second);
+
+            result = client->Post(getPath(target).c_str(), head, params);
+            break;
+        }
+
+        case PostBody:
+            result = client->Post(getPath(target).c_str(), head,
+                                  body.c_str(), contentType.c_str());
+            break;
+        }
+
+        if (!result)
+            client.poison();
+
+        std::lock_guard<std::mutex> lock(mut);
+
+        if (result) {
+            auto response = result.value();
+
+            respStatus = response.status;
+
+            if (respHeaders.empty())
+                for (auto const &h : response.headers)
+                    respHeaders.emplace(h.first, h.second);
+
+            if (kind != Get)
+                data.append(response.body);
+        }
+        else if (canceled) {
+            errorMsg = "canceled";
+        }
+        else {
+            auto err = result.error();
+            errorMsg = "Failed to fetch " + url + " (" +
+                       std::to_string((int) err) + ": " +
+                       httplib::to_string(err) + ")";
+        }
+    }
+    catch (const Exception &e) {
+        std::lock_guard<std::mutex> lock(mut);
+        errorMsg = e.msg;
+    }
+    catch (const std::exception &e) {
+        std::lock_guard<std::mutex> lock(mut);
+        errorMsg = e.what();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mut);
+        finished = true;
+    }
+
+    cond.notify_all();
+}
+
+bool HTTPAsync::done() {
+    std::lock_guard<std::mutex> lock(mut);
+
+    return finished;
+}
+
+void HTTPAsync::wait(int ms) {
+    std::unique_lock<std::mutex> lock(mut);
+
+    if (finished || !data.empty())
+        return;
+
+    cond.wait_for(lock, std::chrono::milliseconds(ms));
+}
+
+int HTTPAsync::status() {
+    std::lock_guard<std::mutex> lock(mut);
+
+    return respStatus;
+}
+
+StringMap HTTPAsync::headersCopy() {
+    std::lock_guard<std::mutex> lock(mut);
+
+    return respHeaders;
+}
+
+std::string HTTPAsync::error() {
+    std::lock_guard<std::mutex> lock(mut);
+
+    return errorMsg;
+}
+
+std::string HTTPAsync::takeData() {
+    std::lock_guard<std::mutex> lock(mut);
+
+    std::string out;
+    out.swap(data);
+
+    return out;
+}
+
+void HTTPAsync::cancel() {
+    std::lock_guard<std::mutex> lock(mut);
+
+    canceled = true;
+    cond.notify_all();
+}
+
+/* ---- Segmented downloads ---- */
+
+/* 500MB patches don't fit in a 32-bit file offset */
+static int seek64(FILE *f, int64_t offset) {
+#ifdef _WIN32
+    return _fseeki64(f, offset, SEEK_SET);
+#else
+    return fseeko(f, (off_t) offset, SEEK_SET);
+#endif
+}
+
+HTTPDownload::HTTPDownload()
+    : segments(1),
+      finished(false),
+      canceled(false),
+      total(-1),
+      received(0),
+      activeSegs(0)
+{}
+
+std::shared_ptr<HTTPDownload> HTTPDownload::start(const char *url,
+                                                  const char *path,
+                                                  const StringMap &headers,
+                                                  int segments) {
+    std::shared_ptr<HTTPDownload> job(new HTTPDownload);
+    job->url = url;
+    job->path = path;
+    job->reqHeaders = headers;
+    job->segments = segments < 1 ? 1 : (segments > 8 ? 8 : segments);
+
+    /* The coordinator blocks on its segment threads, so it gets
+     * its own thread instead of hogging the request pool */
+    std::thread([job]() { job->run(); }).detach();
+
+    return job;
+}
+
+void HTTPDownload::failLocked(const std::string &msg) {
+    if (errorMsg.empty())
+        errorMsg = msg;
+
+    canceled = true;
+}
+
+/* Sidecar format, one value per line:
+ * MKXPDL1 / url / total / segment count / one received-count
+ * per segment */
+void HTTPDownload::writeMeta() {
+    FILE *f = fopen((path + ".part.meta").c_str(), "wb");
+
+    if (!f)
+        return;
+
+    fprintf(f, "MKXPDL1\n%s\n%lld\n%d\n", url.c_str(),
+            (long long) total, segments);
+
+    for (int i = 0; i < segments; ++i)
+        fprintf(f, "%lld\n", (long long) segRecv[i]);
+
+    fclose(f);
+}
+
+bool HTTPDownload::readMeta() {
+    FILE *f = fopen((path + ".part.meta").c_str(), "rb");
+
+    if (!f)
+        return false;
+
+    char magic[16] = { 0 };
+    char metaUrl[2048] = { 0 };
+    long long metaTotal = 0;
+    int metaSegs = 0;
+    bool ok = fscanf(f, "%15s\n", magic) == 1
+           && fscanf(f, "%2047[^\n]\n", metaUrl) == 1
+           && fscanf(f, "%lld\n", &metaTotal) == 1
+           && fscanf(f, "%d\n", &metaSegs) == 1
+           && !strcmp(magic, "MKXPDL1")
+           && url == metaUrl
+           && metaTotal == total
+           && metaSegs == segments;
+
+    /* A count past its segment span would seek resumes out of
+     * bounds (and wedge the transfer permanently short) */
+    const long long span = ok ? (metaTotal + metaSegs - 1) / metaSegs : 0;
+
+    for (int i = 0; ok && i < segments; ++i) {
+        long long recv = 0;
+        ok = fscanf(f, "%lld\n", &recv) == 1 && recv >= 0 && recv <= span;
+
+        if (ok)
+            segRecv[i] = recv;
+    }
+
+    fclose(f);
+
+    if (!ok)
+        for (int i = 0; i < segments; ++i)
+            segRecv[i] = 0;
+
+    return ok;
+}
+
+void HTTPDownload::segmentFun(int index, int64_t begin, int64_t end) {
+    struct ActiveGuard {
+        HTTPDownload *dl;
+        ~ActiveGuard() {
+            std::lock_guard<std::mutex> lock(dl->mut);
+            --dl->activeSegs;
+            dl->cond.notify_all();
+        }
+    } guard = { this };
+
+    try {
+        auto target = readURL(url.c_str());
+
+        PooledClient client(getHost(target));
+        client->set_follow_location(true);
+
+        FILE *f = fopen((path + ".part").c_str(), "r+b");
+
+        if (!f) {
+            std::lock_guard<std::mutex> lock(mut);
+            failLocked("Cannot open " + path + ".part for writing");
+            return;
+        }
+
+        int64_t from;
+        {
+            std::lock_guard<std::mutex> lock(mut);
+            from = begin + segRecv[index];
+        }
+
+        if (seek64(f, from) != 0) {
+            fclose(f);
+            std::lock_guard<std::mutex> lock(mut);
+            failLocked("Seek failed in " + path + ".part");
+            return;
+        }
+
+        httplib::Headers head;
+
+        for (auto const &h : reqHeaders)
+            head.emplace(h.first, h.second);
+
+        /* end < 0 marks the single-stream fallback: no Range
+         * header, whatever the server sends */
+        const bool ranged = end >= 0;
+
+        if (ranged) {
+            if (from > end)
+                { fclose(f); return; }  /* segment already complete */
+
+            char range[64];
+            snprintf(range, sizeof(range), "bytes=%lld-%lld",
+                     (long long) from, (long long) end);
+            head.emplace("Range", range);
+        }
+
+        auto result = client->Get(getPath(target).c_str(), head,
+            [&](const httplib::Response &response) {
+                /* A ranged request answered with the whole file
+                 * would silently corrupt the segment layout */
+                if (ranged && response.status != 206)
+                    return false;
+
+                return true;
+            },
+            [&](const char *chunk, size_t len) {
+                {
+                    std::lock_guard<std::mutex> lock(mut);
+
+                    if (canceled)
+                        return false;
+                }
+
+                if (fwrite(chunk, 1, len, f) != len) {
+                    std::lock_guard<std::mutex> lock(mut);
+                    failLocked("Write failed in " + path + ".part");
+                    return false;
+                }
+
+                std::lock_guard<std::mutex> lock(mut);
+                segRecv[index] += len;
+                received += len;
+                cond.notify_all();
+
+                return true;
+            });
+
+        fclose(f);
+
+        if (!result) {
+            client.poison();
+
+            std::lock_guard<std::mutex> lock(mut);
+
+            if (!canceled) {
+                auto err = result.error();
+                failLocked("Failed to fetch " + url + " (" +
+                           std::to_string((int) err) + ": " +
+                           httplib::to_string(err) + ")");
+            }
+        }
+    }
+    catch (const Exception &e) {
+        std::lock_guard<std::mutex> lock(mut);
+        failLocked(e.msg);
+    }
+    catch (const std::exception &e) {
+        std::lock_guard<std::mutex> lock(mut);
+        failLocked(e.what());
+    }
+}
+
+void HTTPDownload::run() {
+    try {
+        auto target = readURL(url.c_str());
+
+        bool ranged = false;
+
+        {
+            PooledClient client(getHost(target));
+            client->set_follow_location(true);
+
+            httplib::Headers head;
+
+            for (auto const &h : reqHeaders)
+                head.emplace(h.first, h.second);
+
+            if (auto probe = client->Head(getPath(target).c_str(), head)) {
+                auto response = probe.value();
+
+                if (response.has_header("Content-Length"))
+                    total = strtoll(
+                        response.get_header_value("Content-Length").c_str(),
+                        0, 10);
+
+                ranged = total > 0 &&
+                         response.get_header_value("Accept-Ranges") == "bytes";
+            }
+        }
+
+        if (!ranged)
+            segments = 1;
+
+        segRecv.assign(segments, 0);
+
+        /* Resume only works with a known, range-addressable
+         * layout; the fallback stream always restarts */
+        const bool resumed = ranged && readMeta();
+
+        if (resumed) {
+            std::lock_guard<std::mutex> lock(mut);
+
+            received = 0;
+            for (int i = 0; i < segments; ++i)
+                received += segRecv[i];
+        }
+
+        {
+            /* Make sure the .part exists without clobbering
+             * resumable bytes */
+            FILE *f = fopen((path + ".part").c_str(), resumed ? "r+b" : "wb");
+
+            if (!f)
+                throw Exception(Exception::MKXPError,
+                                "Cannot create %s.part", path.c_str());
+
+            fclose(f);
+        }
+
+        const int64_t chunk =
+            ranged ? (total + segments - 1) / segments : 0;
+
+        std::vector<std::thread> threads;
+
+        {
+            std::lock_guard<std::mutex> lock(mut);
+            activeSegs = segments;
+        }
+
+        for (int i = 0; i < segments; ++i) {
+            int64_t begin = ranged ? chunk * i : 0;
+            int64_t end = ranged
+                ? std::min<int64_t>(chunk * (i + 1), total) - 1
+                : -1;
+
+            threads.push_back(std::thread(
+                [this, i, begin, end]() { segmentFun(i, begin, end); }));
+        }
+
+        /* Flush resume metadata while the segments work, so a
+         * killed process can pick the transfer back up */
+        {
+            std::unique_lock<std::mutex> lock(mut);
+            int64_t lastFlushed = -1;
+
+            while (activeSegs > 0) {
+                cond.wait_for(lock, std::chrono::milliseconds(500));
+
+                /* Written with the lock held, so the per-segment
+                 * counters can't tear mid-snapshot */
+                if (ranged && received != lastFlushed) {
+                    lastFlushed = received;
+                    writeMeta();
+                }
+            }
+        }
+
+        for (size_t i = 0; i < threads.size(); ++i)
+            threads[i].join();
+
+        std::lock_guard<std::mutex> lock(mut);
+
+        if (errorMsg.empty() && !canceled &&
+            (total < 0 || received == total)) {
+            /* Unknown-length fallback: whatever arrived is the
+             * full body once the stream closed cleanly */
+            if (total < 0)
+                total = received;
+
+            remove((path + ".part.meta").c_str());
+            remove(path.c_str());
+
+            if (rename((path + ".part").c_str(), path.c_str()) != 0)
+                errorMsg = "Cannot move " + path + ".part into place";
+        }
+        else {
+            if (ranged)
+                writeMeta();
+
+            if (errorMsg.empty() && !canceled)
+                errorMsg = "Transfer ended short of " +
+                           std::to_string((long long) total) + " bytes";
+        }
+    }
+    catch (const Exception &e) {
+        std::lock_guard<std::mutex> lock(mut);
+        failLocked(e.msg);
+    }
+    catch (const std::exception &e) {
+        std::lock_guard<std::mutex> lock(mut);
+        failLocked(e.what());
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mut);
+
+        if (canceled && errorMsg.empty())
+            errorMsg = "canceled";
+
+        finished = true;
+    }
+
+    cond.notify_all();
+}
+
+bool HTTPDownload::done() {
+    std::lock_guard<std::mutex> lock(mut);
+
+    return finished;
+}
+
+void HTTPDownload::wait(int ms) {
+    std::unique_lock<std::mutex> lock(mut);
+
+    if (finished)
+        return;
+
+    cond.wait_for(lock, std::chrono::milliseconds(ms));
+}
+
+int64_t HTTPDownload::totalBytes() {
+    std::lock_guard<std::mutex> lock(mut);
+
+    return total;
+}
+
+int64_t HTTPDownload::receivedBytes() {
+    std::lock_guard<std::mutex> lock(mut);
+
+    return received;
+}
+
+std::string HTTPDownload::error() {
+    std::lock_guard<std::mutex> lock(mut);
+
+    return errorMsg;
+}
+
+void HTTPDownload::cancel() {
+    std::lock_guard<std::mutex> lock(mut);
+
+    canceled = true;
+    cond.notify_all();
+}
@@ -8,8 +8,14 @@
 #ifndef net_h
 #define net_h
 
-#include <unordered_map>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <stdint.h>
+
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 namespace mkxp_net {
 
@@ -47,6 +53,131 @@ private:
     StringMap _headers;
     bool follow_location;
 };
+
+/* Asynchronous request serviced by a shared worker pool.
+ * Connections come from the per-host keep-alive pool (the
+ * blocking API reuses them too). Response data streams into
+ * an internal buffer that the owner drains with takeData(),
+ * so bodies can be consumed chunk-wise while the transfer
+ * is still running */
+class HTTPAsync {
+public:
+    static std::shared_ptr<HTTPAsync> get(const char *url,
+                                          const StringMap &headers,
+                                          bool followRedirects);
+    static std::shared_ptr<HTTPAsync> postForm(const char *url,
+                                               const StringMap &headers,
+                                               const StringMap &form,
+                                               bool followRedirects);
+    static std::shared_ptr<HTTPAsync> postBody(const char *url,
+                                               const StringMap &headers,
+                                               const char *body,
+                                               const char *contentType);
+
+    bool done();
+
+    /* Blocks up to 'ms' for completion or fresh data */
+    void wait(int ms);
+
+    /* Valid once done() */
+    int status();
+    StringMap headersCopy();
+
+    /* Empty while no error occurred */
+    std::string error();
+
+    /* Drains the body bytes received since the last call */
+    std::string takeData();
+
+    /* Makes the transfer abort at the next received chunk */
+    void cancel();
+
+private:
+    HTTPAsync();
+
+    enum Kind { Get, PostForm, PostBody };
+
+    Kind kind;
+    std::string url;
+    std::string body;
+    std::string contentType;
+    StringMap reqHeaders;
+    StringMap form;
+    bool followRedirects;
+
+    std::mutex mut;
+    std::condition_variable cond;
+
+    bool finished;
+    bool canceled;
+    int respStatus;
+    StringMap respHeaders;
+    std::string data;
+    std::string errorMsg;
+
+    void run();
+
+    static std::shared_ptr<HTTPAsync> enqueue(std::shared_ptr<HTTPAsync> job);
+
+    friend class HTTPWorkerPool;
+};
+
+/* Segmented ranged download straight to disk. The target size is
+ * probed first; servers honoring byte ranges get 'segments'
+ * parallel range streams, anything else falls back to a single
+ * stream. Bytes land in '<path>.part' (with a small .meta sidecar
+ * recording per-segment progress), so an interrupted transfer
+ * resumes where it stopped, and the finished file is renamed into
+ * place. Bodies are never buffered in memory */
+class HTTPDownload {
+public:
+    static std::shared_ptr<HTTPDownload> start(const char *url,
+                                               const char *path,
+                                               const StringMap &headers,
+                                               int segments);
+
+    bool done();
+
+    /* Blocks up to 'ms' for completion or progress */
+    void wait(int ms);
+
+    /* -1 while the total size is still unknown */
+    int64_t totalBytes();
+    int64_t receivedBytes();
+
+    /* Empty while no error occurred */
+    std::string error();
+
+    /* Aborts every segment at its next received chunk; progress
+     * stays on disk for a later resume */
+    void cancel();
+
+private:
+    HTTPDownload();
+
+    std::string url;
+    std::string path;
+    StringMap reqHeaders;
+    int segments;
+
+    std::mutex mut;
+    std::condition_variable cond;
+
+    bool finished;
+    bool canceled;
+    int64_t total;
+    int64_t received;
+    int activeSegs;
+    std::string errorMsg;
+
+    std::vector<int64_t> segRecv;
+
+    void run();
+    void segmentFun(int index, int64_t begin, int64_t end);
+    void failLocked(const std::string &msg);
+    void writeMeta();
+    bool readMeta();
+};
 }
 
 #endif /* net_h */
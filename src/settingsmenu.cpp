@@ -130,6 +130,7 @@ struct Widget
 	 * window coordinates */
 	bool hit(int x, int y);
 	void draw(SDL_Surface *surf);
+	const IntRect &getRect() const { return rect; }
 	void motion(int x, int y);
 	void leave();
 	void click(int x, int y, uint8_t button);
@@ -548,6 +549,28 @@ struct SettingsMenuPrivate
 		SDL_UpdateWindowSurface(window);
 	}
 
+	/* Partial repaint: one widget's rect only. Hover churn while
+	 * the menu sits open used to repaint and upload the whole
+	 * surface per mouse move */
+	void redrawWidget(Widget *w)
+	{
+		if (state == AwaitingInput)
+		{
+			/* The capture overlay darkens everything; the full
+			 * repaint keeps it correct */
+			redraw();
+			return;
+		}
+
+		const IntRect &r = w->getRect();
+
+		fillRect(winSurf, cBgNorm, r.x, r.y, r.w, r.h);
+		w->draw(winSurf);
+
+		SDL_Rect ur = { r.x, r.y, r.w, r.h };
+		SDL_UpdateWindowSurfaceRects(window, &ur, 1);
+	}
+
 	Widget *findWidget(int x, int y)
 	{
 		Widget *w = 0;
@@ -799,7 +822,7 @@ void BindingWidget::setHoveredCell(int cell)
 		return;
 
 	hoveredCell = cell;
-	p->redraw();
+	p->redrawWidget(this);
 }
 
 void BindingWidget::motionHandler(int x, int y)
@@ -867,7 +890,7 @@ void Button::setHovered(bool val)
 		return;
 
 	hovered = val;
-	p->redraw();
+	p->redrawWidget(this);
 }
 
 void Button::drawHandler(SDL_Surface *surf)
@@ -903,7 +926,7 @@ void Label::setVisible(bool val)
 		return;
 
 	visible = val;
-	p->redraw();
+	p->redrawWidget(this);
 }
 
 void Label::drawHandler(SDL_Surface *surf)
@@ -22,6 +22,7 @@
 #include "sharedstate.h"
 
 #include "util.h"
+#include "etc.h"
 #include "filesystem.h"
 #include "graphics.h"
 #include "input.h"
@@ -29,7 +30,9 @@
 #include "glstate.h"
 #include "shader.h"
 #include "texpool.h"
+#include "bitmap.h"
 #include "font.h"
+#include "sdl-util.h"
 #include "eventthread.h"
 #include "gl-util.h"
 #include "global-ibo.h"
@@ -37,6 +40,8 @@
 #include "binding.h"
 #include "exception.h"
 #include "sharedmidistate.h"
+#include "boottrace.h"
+#include "zonetrace.h"
 
 #include <unistd.h>
 #include <stdio.h>
@@ -84,6 +89,7 @@ struct SharedStatePrivate
 
 	TexPool texPool;
 
+
 	SharedFontState fontState;
 	Font *defaultFont;
 
@@ -101,10 +107,17 @@ struct SharedStatePrivate
     
     std::chrono::time_point<std::chrono::steady_clock> startupTime;
 
+	/* Worker entry: font set discovery (see init) */
+	void fontScanFun()
+	{
+		fileSystem.initFontSets(fontState);
+	}
+
 	SharedStatePrivate(RGSSThreadData *threadData)
 	    : bindingData(0),
 	      sdlWindow(threadData->window),
-	      fileSystem(threadData->argv0, threadData->config.allowSymlinks),
+	      fileSystem(threadData->argv0, threadData->config.allowSymlinks,
+	                 threadData->config.ioBufSize),
 	      eThread(*threadData->ethread),
 	      rtData(*threadData),
 	      config(threadData->config),
@@ -113,6 +126,9 @@ struct SharedStatePrivate
 	      input(*threadData),
 	      audio(*threadData),
 	      _glState(threadData->config),
+	      texPool(threadData->config.texPoolBudget > 0
+	              ? (uint32_t) threadData->config.texPoolBudget * 1024 * 1024
+	              : 20000000),
 	      fontState(threadData->config),
 	      stampCounter(0)
 	{}
@@ -145,9 +161,31 @@ struct SharedStatePrivate
 			fileSystem.addPath(config.rtps[i].c_str());
 
 		if (config.pathCache)
-			fileSystem.createPathCache();
+		{
+			BootTrace::Scope sp("path-cache");
+			fileSystem.createPathCache(config.customDataPath.c_str());
+		}
 
-		fileSystem.initFontSets(fontState);
+		/* Font set discovery only needs the mounts: scan on a
+		 * worker while this thread runs the GL-side setup below.
+		 * PhysFS reads are safe concurrently (the prefetcher
+		 * already relies on that), and the scan's TTF_OpenFontRW
+		 * calls are the sole TTF use until the join - nothing
+		 * else touches fonts before Font::initDefaults */
+		SDL_Thread *fontScan =
+		        createSDLThread<SharedStatePrivate,
+		                        &SharedStatePrivate::fontScanFun>(this, "fontsets");
+
+		if (config.devFileWatch)
+		{
+			fileSystem.startWatch();
+			audio.watchFileChanges(fileSystem);
+		}
+
+		ChangeNotify::setDeferred(config.deferredEtcNotify);
+
+		if (!config.customDataPath.empty())
+			ZONE_SET_OUTPUT(config.customDataPath + "/mkxp-trace.json");
 
 		globalTexW = 128;
 		globalTexH = 64;
@@ -164,6 +202,35 @@ struct SharedStatePrivate
 		TEXFBO::allocEmpty(gpTexFBO, globalTexW, globalTexH);
 		TEXFBO::linkFBO(gpTexFBO);
 
+		/* Join point: fontState is fair game again after this */
+		{
+			BootTrace::Scope sp("font-sets-join");
+			if (fontScan)
+				SDL_WaitThread(fontScan, 0);
+			else
+				fileSystem.initFontSets(fontState);
+		}
+
+		/* Kick the configured asset preloads (the "preload" array in
+		 * mkxp.json): the async loaders chew through them during the
+		 * title screen instead of the first map entry. SEs decode
+		 * into the SE cache, other audio prefetches its file bytes,
+		 * everything else queues a background bitmap decode */
+		for (size_t i = 0; i < config.preload.size(); ++i)
+		{
+			const std::string &path = config.preload[i];
+
+			if (path.empty())
+				continue;
+
+			if (SDL_strncasecmp(path.c_str(), "Audio/SE", 8) == 0)
+				audio.sePreload(path.c_str());
+			else if (SDL_strncasecmp(path.c_str(), "Audio/", 6) == 0)
+				fileSystem.prefetch(path.c_str());
+			else
+				Bitmap::preload(path.c_str());
+		}
+
 		/* RGSS3 games will call setup_midi, so there's
 		 * no need to do it on startup */
 		if (rgssVer <= 2)
@@ -192,11 +259,27 @@ void SharedState::initInstance(RGSSThreadData *threadData)
 	SharedState::instance = 0;
 	Font *defaultFont = 0;
 
+	/* Enable the on-disk shader binary cache before the shader
+	 * set is built during SharedState construction */
+	Shader::setBinaryCacheDir(threadData->config.customDataPath);
+
 	try
 	{
-		SharedState::instance = new SharedState(threadData);
+		{
+			BootTrace::Scope sp("shared-state");
+			SharedState::instance = new SharedState(threadData);
+		}
 		Font::initDefaults(instance->p->fontState);
 		defaultFont = new Font();
+
+		/* Warm configured fonts in the background; needs the
+		 * instance pointer set, since getFont goes through it */
+		instance->p->fontState.preloadFonts(threadData->config);
+
+		/* And queue their common glyphs for incremental atlas
+		 * warmup (rasterized a slice per frame from
+		 * Graphics::update, so the title screen absorbs it) */
+		instance->p->fontState.queueGlyphWarmup(threadData->config);
 	}
 	catch (const Exception &exc)
 	{
@@ -345,6 +428,86 @@ void SharedState::releaseAtlasTex(TEXFBO &tex)
 	p->atlasTex = tex;
 }
 
+/* ---- Coordinated memory pressure ----
+ *
+ * Each participating cache exposes usage and a shed-to-target
+ * operation; when their sum exceeds the configured budget, the
+ * overshoot is distributed proportionally to how far each cache
+ * sits above its floor. Floors are honored absolutely: a cache at
+ * or below its floor is never touched */
+struct BudgetClient
+{
+	size_t usage;
+	size_t floor;
+	size_t target;  /* out */
+};
+
+static void distributePressure(BudgetClient *clients, size_t count,
+                               size_t budget)
+{
+	size_t total = 0, shrinkable = 0;
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		clients[i].target = clients[i].usage;
+		total += clients[i].usage;
+		if (clients[i].usage > clients[i].floor)
+			shrinkable += clients[i].usage - clients[i].floor;
+	}
+
+	if (total <= budget || shrinkable == 0)
+		return;
+
+	size_t overshoot = total - budget;
+	if (overshoot > shrinkable)
+		overshoot = shrinkable;
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		if (clients[i].usage <= clients[i].floor)
+			continue;
+
+		const size_t above = clients[i].usage - clients[i].floor;
+		const size_t shed = (size_t)
+		        (((uint64_t) overshoot * above) / shrinkable);
+
+		clients[i].target = clients[i].usage - shed;
+		if (clients[i].target < clients[i].floor)
+			clients[i].target = clients[i].floor;
+	}
+}
+
+void SharedState::checkMemoryPressure()
+{
+	const Config &conf = p->config;
+
+	if (conf.memoryBudget <= 0)
+		return;
+
+	const size_t MB = 1024 * 1024;
+
+	BudgetClient clients[4];
+	clients[0].usage = p->texPool.stats().cachedBytes;
+	clients[0].floor = (size_t) (conf.texPoolFloor > 0 ? conf.texPoolFloor : 0) * MB;
+	clients[1].usage = p->audio.seBytes();
+	clients[1].floor = (size_t) (conf.seCacheFloor > 0 ? conf.seCacheFloor : 0) * MB;
+	clients[2].usage = p->fileSystem.prefetchUsage();
+	clients[2].floor = (size_t) (conf.prefetchFloor > 0 ? conf.prefetchFloor : 0) * MB;
+	clients[3].usage = Bitmap::hiresUsage();
+	clients[3].floor = (size_t) (conf.hiresFloor > 0 ? conf.hiresFloor : 0) * MB;
+
+	distributePressure(clients, 4, (size_t) conf.memoryBudget * MB);
+
+	if (clients[0].target < clients[0].usage)
+		p->texPool.shrink((uint32_t) clients[0].target);
+	if (clients[1].target < clients[1].usage)
+		p->audio.seShrink((uint32_t) clients[1].target);
+	if (clients[2].target < clients[2].usage)
+		p->fileSystem.prefetchShrink(clients[2].target);
+	if (clients[3].target < clients[3].usage)
+		Bitmap::hiresShrink(clients[3].target);
+}
+
 void SharedState::checkShutdown()
 {
 	if (!p->rtData.rqTerm)
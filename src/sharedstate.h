@@ -22,7 +22,7 @@
 #ifndef SHAREDSTATE_H
 #define SHAREDSTATE_H
 
-#include "sigslot/signal.hpp"
+#include "flatsignal.h"
 
 #define shState SharedState::instance
 #define glState shState->_glState()
@@ -81,7 +81,7 @@ struct SharedState
 	Font &defaultFont() const;
 	SharedMidiState &midiState() const;
 
-	sigslot::signal<> prepareDraw;
+	FlatSignal prepareDraw;
 
 	unsigned int genTimeStamp();
     
@@ -113,6 +113,12 @@ struct SharedState
 
 	void checkReset();
 
+	/* Coordinated memory pressure (memoryBudget config): sums the
+	 * registered caches and sheds them proportionally above their
+	 * floors when the total exceeds the budget. Driven from the
+	 * render loop; no-op while under budget or unconfigured */
+	void checkMemoryPressure();
+
 	static SharedState *instance;
 	static int rgssVersion;
 
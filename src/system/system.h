@@ -24,6 +24,8 @@
 #error "Can't identify platform."
 #endif
 
+#include <vector>
+
 namespace systemImpl {
 enum WineHostType {
     Windows,
@@ -37,6 +39,15 @@ int getScalingFactor();
 bool isWine();
 bool isRosetta();
 WineHostType getRealHostType();
+
+/* Development file watcher. Starts watching 'root'
+ * recursively; returns false when no platform backend is
+ * available. Changed paths (relative to root, '/'
+ * separated) are drained with pollFileChanges, which is
+ * non-blocking and meant to be called once per frame */
+bool startFileWatch(const std::string &root);
+void pollFileChanges(std::vector<std::string> &out);
+void stopFileWatch();
 }
 
 #ifdef MKXPZ_BUILD_XCODE
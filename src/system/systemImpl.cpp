@@ -97,3 +97,238 @@ systemImpl::WineHostType systemImpl::getRealHostType() {
 int systemImpl::getScalingFactor() {
     return 1;
 }
+
+/* ---- Development file watcher ---- */
+
+#if MKXPZ_PLATFORM == MKXPZ_PLATFORM_LINUX
+
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <dirent.h>
+#include <unistd.h>
+
+#include <map>
+#include <vector>
+
+static struct FileWatchState {
+    int fd = -1;
+    std::string root;
+
+    /* Maps: watch descriptor, to: dir path relative
+     * to the root ("" for the root itself) */
+    std::map<int, std::string> wds;
+} fw;
+
+/* 'reportFiles' collects files already present below a newly
+ * watched directory: they may have been written before the
+ * directory's own watch existed and would be missed otherwise */
+static void fwAddWatchRecursive(const std::string &rel,
+                                std::vector<std::string> *reportFiles) {
+    std::string abs = fw.root + (rel.empty() ? "" : "/" + rel);
+
+    int wd = inotify_add_watch(fw.fd, abs.c_str(),
+                               IN_CLOSE_WRITE | IN_CREATE | IN_DELETE |
+                               IN_MOVED_FROM | IN_MOVED_TO);
+
+    if (wd < 0)
+        return;
+
+    fw.wds[wd] = rel;
+
+    DIR *dir = opendir(abs.c_str());
+
+    if (!dir)
+        return;
+
+    while (struct dirent *ent = readdir(dir)) {
+        if (ent->d_name[0] == '.')
+            continue;
+
+        bool isDir = (ent->d_type == DT_DIR);
+
+        /* Some filesystems don't fill d_type */
+        if (ent->d_type == DT_UNKNOWN) {
+            struct stat st;
+            std::string full = abs + "/" + ent->d_name;
+
+            isDir = (stat(full.c_str(), &st) == 0 && S_ISDIR(st.st_mode));
+        }
+
+        std::string entRel = rel.empty() ? ent->d_name
+                                         : rel + "/" + ent->d_name;
+
+        if (isDir)
+            fwAddWatchRecursive(entRel, reportFiles);
+        else if (reportFiles)
+            reportFiles->push_back(entRel);
+    }
+
+    closedir(dir);
+}
+
+bool systemImpl::startFileWatch(const std::string &root) {
+    if (fw.fd >= 0)
+        return true;
+
+    fw.fd = inotify_init1(IN_NONBLOCK);
+
+    if (fw.fd < 0)
+        return false;
+
+    fw.root = root;
+    fwAddWatchRecursive("", 0);
+
+    return true;
+}
+
+void systemImpl::pollFileChanges(std::vector<std::string> &out) {
+    if (fw.fd < 0)
+        return;
+
+    char buf[4096] __attribute__((aligned(8)));
+
+    while (true) {
+        ssize_t len = read(fw.fd, buf, sizeof(buf));
+
+        if (len <= 0)
+            break;
+
+        for (char *ptr = buf; ptr < buf + len;) {
+            struct inotify_event *ev = (struct inotify_event *) ptr;
+            ptr += sizeof(struct inotify_event) + ev->len;
+
+            if (ev->len == 0 || !fw.wds.count(ev->wd))
+                continue;
+
+            const std::string &dir = fw.wds[ev->wd];
+            std::string rel = dir.empty() ? ev->name : dir + "/" + ev->name;
+
+            /* Newly created subtrees need their own watches;
+             * files written into them before the watch took
+             * effect are reported from the scan */
+            if ((ev->mask & IN_ISDIR)
+            &&  (ev->mask & (IN_CREATE | IN_MOVED_TO)))
+                fwAddWatchRecursive(rel, &out);
+
+            out.push_back(rel);
+        }
+    }
+}
+
+void systemImpl::stopFileWatch() {
+    if (fw.fd < 0)
+        return;
+
+    close(fw.fd);
+    fw.fd = -1;
+    fw.wds.clear();
+}
+
+#elif MKXPZ_PLATFORM == MKXPZ_PLATFORM_WINDOWS
+
+static struct FileWatchState {
+    HANDLE dir = INVALID_HANDLE_VALUE;
+    OVERLAPPED ov;
+
+    /* Must stay valid while a read is pending */
+    alignas(DWORD) char buf[64 * 1024];
+} fw;
+
+static bool fwIssueRead() {
+    return ReadDirectoryChangesW(fw.dir, fw.buf, sizeof(fw.buf), TRUE,
+                                 FILE_NOTIFY_CHANGE_FILE_NAME |
+                                 FILE_NOTIFY_CHANGE_DIR_NAME |
+                                 FILE_NOTIFY_CHANGE_LAST_WRITE,
+                                 0, &fw.ov, 0);
+}
+
+bool systemImpl::startFileWatch(const std::string &root) {
+    if (fw.dir != INVALID_HANDLE_VALUE)
+        return true;
+
+    fw.dir = CreateFileA(root.c_str(), FILE_LIST_DIRECTORY,
+                         FILE_SHARE_READ | FILE_SHARE_WRITE |
+                         FILE_SHARE_DELETE,
+                         0, OPEN_EXISTING,
+                         FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED,
+                         0);
+
+    if (fw.dir == INVALID_HANDLE_VALUE)
+        return false;
+
+    memset(&fw.ov, 0, sizeof(fw.ov));
+    fw.ov.hEvent = CreateEvent(0, TRUE, FALSE, 0);
+
+    if (!fwIssueRead()) {
+        CloseHandle(fw.ov.hEvent);
+        CloseHandle(fw.dir);
+        fw.dir = INVALID_HANDLE_VALUE;
+
+        return false;
+    }
+
+    return true;
+}
+
+void systemImpl::pollFileChanges(std::vector<std::string> &out) {
+    if (fw.dir == INVALID_HANDLE_VALUE)
+        return;
+
+    DWORD bytes = 0;
+
+    if (!GetOverlappedResult(fw.dir, &fw.ov, &bytes, FALSE))
+        return;
+
+    char *ptr = fw.buf;
+
+    while (bytes > 0) {
+        FILE_NOTIFY_INFORMATION *info = (FILE_NOTIFY_INFORMATION *) ptr;
+
+        char name[1024];
+        int len = WideCharToMultiByte(CP_UTF8, 0, info->FileName,
+                                      info->FileNameLength / sizeof(WCHAR),
+                                      name, sizeof(name) - 1, 0, 0);
+
+        if (len > 0) {
+            name[len] = '\0';
+
+            for (int i = 0; i < len; ++i)
+                if (name[i] == '\\')
+                    name[i] = '/';
+
+            out.push_back(name);
+        }
+
+        if (info->NextEntryOffset == 0)
+            break;
+
+        ptr += info->NextEntryOffset;
+    }
+
+    ResetEvent(fw.ov.hEvent);
+    fwIssueRead();
+}
+
+void systemImpl::stopFileWatch() {
+    if (fw.dir == INVALID_HANDLE_VALUE)
+        return;
+
+    CancelIo(fw.dir);
+    CloseHandle(fw.ov.hEvent);
+    CloseHandle(fw.dir);
+    fw.dir = INVALID_HANDLE_VALUE;
+}
+
+#else
+
+/* No backend on this platform (yet) */
+
+bool systemImpl::startFileWatch(const std::string &) {
+    return false;
+}
+
+void systemImpl::pollFileChanges(std::vector<std::string> &) {}
+
+void systemImpl::stopFileWatch() {}
+
+#endif
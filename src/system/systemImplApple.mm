@@ -76,3 +76,13 @@ std::string getPlistValue(const char *key) {
         return "";
     }
 }
+
+/* Development file watcher: no FSEvents backend yet */
+
+bool systemImpl::startFileWatch(const std::string &) {
+    return false;
+}
+
+void systemImpl::pollFileChanges(std::vector<std::string> &) {}
+
+void systemImpl::stopFileWatch() {}
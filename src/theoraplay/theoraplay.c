@@ -22,10 +22,11 @@
 #define sleepms(x) Sleep(x)
 #else
 #include <pthread.h>
+#include <time.h>
 #include <unistd.h>
 #define sleepms(x) usleep((x) * 1000)
 #define THEORAPLAY_THREAD_T    pthread_t
-#define THEORAPLAY_MUTEX_T     pthread_mutex_t
+#define THEORAPLAY_MUTEX_T     pthread_mutex_t *
 #endif
 
 #include "theoraplay.h"
@@ -103,6 +104,16 @@ static unsigned char *ConvertVideoFrame420ToIYUV(const th_info *tinfo,
 #undef THEORAPLAY_CVT_FNNAME_420
 
 
+// One keyframe index entry: a page at (conservative) byte offset
+//  'offset' whose granulepos maps to keyframe number 'frame'. Both
+//  sequences are monotonic, so a backwards scan finds the landing spot
+//  for any target frame.
+typedef struct IndexEntry
+{
+    ogg_int64_t frame;
+    ogg_int64_t offset;
+} IndexEntry;
+
 typedef struct TheoraDecoder
 {
     // Thread wrangling...
@@ -130,31 +141,63 @@ typedef struct TheoraDecoder
 
     AudioPacket *audiolist;
     AudioPacket *audiolisttail;
+
+    // Seeking (all gen/ms fields are written under 'lock')...
+    int ioseekable;
+    volatile int seekgen;               // bumped by THEORAPLAY_seek
+    volatile unsigned int seekms;
+    volatile int flushgen;              // stages drop older-gen packets
+    volatile unsigned int dropbeforems; // decoded output before this is discarded
+    volatile int ateos;                 // demuxer read past the end
+    volatile int decodedone;            // ...and the stages finished too
+
+    // Keyframe index, built while demuxing (guarded by 'lock')...
+    IndexEntry *index;
+    int indexlen;
+    int indexcap;
+
+    // Video decode timing (guarded by 'lock')...
+    unsigned int statframes;
+    double statmstotal;
+    double statmsmax;
 } TheoraDecoder;
 
 
+static double nowMs(void)
+{
 #ifdef _WIN32
-static inline int Thread_Create(TheoraDecoder *ctx, void *(*routine) (void*))
+    return (double) GetTickCount64();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1.0e6;
+#endif
+} // nowMs
+
+
+#ifdef _WIN32
+static inline int Thread_Create(THEORAPLAY_THREAD_T *thread,
+                                void *(*routine) (void*), void *arg)
 {
-    ctx->worker = CreateThread(
+    *thread = CreateThread(
         NULL,
         0,
         (LPTHREAD_START_ROUTINE) routine,
-        (LPVOID) ctx,
+        (LPVOID) arg,
         0,
         NULL
     );
-    return (ctx->worker == NULL);
+    return (*thread == NULL);
 }
 static inline void Thread_Join(THEORAPLAY_THREAD_T thread)
 {
     WaitForSingleObject(thread, INFINITE);
     CloseHandle(thread);
 }
-static inline int Mutex_Create(TheoraDecoder *ctx)
+static inline int Mutex_Create(THEORAPLAY_MUTEX_T *mutex)
 {
-    ctx->lock = CreateMutex(NULL, FALSE, NULL);
-    return (ctx->lock == NULL);
+    *mutex = CreateMutex(NULL, FALSE, NULL);
+    return (*mutex == NULL);
 }
 static inline void Mutex_Destroy(THEORAPLAY_MUTEX_T mutex)
 {
@@ -169,29 +212,44 @@ static inline void Mutex_Unlock(THEORAPLAY_MUTEX_T mutex)
     ReleaseMutex(mutex);
 }
 #else
-static inline int Thread_Create(TheoraDecoder *ctx, void *(*routine) (void*))
+static inline int Thread_Create(THEORAPLAY_THREAD_T *thread,
+                                void *(*routine) (void*), void *arg)
 {
-    return pthread_create(&ctx->worker, NULL, routine, ctx);
+    return pthread_create(thread, NULL, routine, arg);
 }
 static inline void Thread_Join(THEORAPLAY_THREAD_T thread)
 {
     pthread_join(thread, NULL);
 }
-static inline int Mutex_Create(TheoraDecoder *ctx)
+static inline int Mutex_Create(THEORAPLAY_MUTEX_T *mutex)
 {
-    return pthread_mutex_init(&ctx->lock, NULL);
+    // pthread_mutex_t is a struct; lock through a stable allocation so
+    //  every caller hits the same mutex, not a by-value copy of it.
+    *mutex = (pthread_mutex_t *) malloc(sizeof (pthread_mutex_t));
+    if (*mutex == NULL)
+        return -1;
+    if (pthread_mutex_init(*mutex, NULL) != 0)
+    {
+        free(*mutex);
+        *mutex = NULL;
+        return -1;
+    } // if
+    return 0;
 }
 static inline void Mutex_Destroy(THEORAPLAY_MUTEX_T mutex)
 {
-    pthread_mutex_destroy(&mutex);
+    if (mutex == NULL)
+        return;
+    pthread_mutex_destroy(mutex);
+    free(mutex);
 }
 static inline void Mutex_Lock(THEORAPLAY_MUTEX_T mutex)
 {
-    pthread_mutex_lock(&mutex);
+    pthread_mutex_lock(mutex);
 }
 static inline void Mutex_Unlock(THEORAPLAY_MUTEX_T mutex)
 {
-    pthread_mutex_unlock(&mutex);
+    pthread_mutex_unlock(mutex);
 }
 #endif
 
@@ -211,6 +269,514 @@ static int FeedMoreOggData(THEORAPLAY_Io *io, ogg_sync_state *sync)
 } // FeedMoreOggData
 
 
+// The decode pipeline: one thread demuxes Ogg pages, and the video and
+//  audio streams each decode on a thread of their own, fed through
+//  bounded packet queues. On single-core systems this degrades to the
+//  old interleaved behavior (everyone just takes turns); on multicore
+//  handhelds it keeps 1080p Theora decode off the demux/audio path.
+
+// Max undecoded packets buffered per stream before the demuxer waits.
+#define THEORAPLAY_PACKET_BUFFER 64
+
+// A demuxed compressed packet. ogg_packet points into libogg's stream
+//  buffers, which the next packetout invalidates, so the payload is
+//  deep-copied into the same allocation as the node. 'gen' is the seek
+//  generation the packet was demuxed under; stages discard packets
+//  from before the latest flush.
+typedef struct OggPacketNode
+{
+    ogg_packet packet;
+    int gen;
+    struct OggPacketNode *next;
+} OggPacketNode;
+
+typedef struct PacketQueue
+{
+    THEORAPLAY_MUTEX_T lock;
+    OggPacketNode *head;
+    OggPacketNode *tail;
+    unsigned int count;
+    int closed;  // demuxer is done with this stream; drain and quit.
+} PacketQueue;
+
+
+static int PacketQueue_init(PacketQueue *q)
+{
+    memset(q, '\0', sizeof (PacketQueue));
+    return (Mutex_Create(&q->lock) == 0);
+} // PacketQueue_init
+
+
+static int PacketQueue_put(PacketQueue *q, const ogg_packet *packet, int gen)
+{
+    OggPacketNode *node = (OggPacketNode *) malloc(sizeof (OggPacketNode) + packet->bytes);
+    if (node == NULL)
+        return 0;
+
+    node->packet = *packet;
+    node->packet.packet = (unsigned char *) (node + 1);
+    if (packet->bytes > 0)
+        memcpy(node->packet.packet, packet->packet, packet->bytes);
+    node->gen = gen;
+    node->next = NULL;
+
+    Mutex_Lock(q->lock);
+    if (q->tail)
+        q->tail->next = node;
+    else
+        q->head = node;
+    q->tail = node;
+    q->count++;
+    Mutex_Unlock(q->lock);
+
+    return 1;
+} // PacketQueue_put
+
+
+static OggPacketNode *PacketQueue_get(PacketQueue *q)
+{
+    OggPacketNode *node;
+    Mutex_Lock(q->lock);
+    node = q->head;
+    if (node)
+    {
+        q->head = node->next;
+        node->next = NULL;
+        if (q->head == NULL)
+            q->tail = NULL;
+        q->count--;
+    } // if
+    Mutex_Unlock(q->lock);
+    return node;
+} // PacketQueue_get
+
+
+static unsigned int PacketQueue_count(PacketQueue *q)
+{
+    unsigned int count;
+    Mutex_Lock(q->lock);
+    count = q->count;
+    Mutex_Unlock(q->lock);
+    return count;
+} // PacketQueue_count
+
+
+static void PacketQueue_close(PacketQueue *q)
+{
+    Mutex_Lock(q->lock);
+    q->closed = 1;
+    Mutex_Unlock(q->lock);
+} // PacketQueue_close
+
+
+// "there's nothing left and never will be."
+static int PacketQueue_drained(PacketQueue *q)
+{
+    int drained;
+    Mutex_Lock(q->lock);
+    drained = (q->closed && (q->head == NULL));
+    Mutex_Unlock(q->lock);
+    return drained;
+} // PacketQueue_drained
+
+
+static void PacketQueue_deinit(PacketQueue *q)
+{
+    OggPacketNode *node = q->head;
+    while (node)
+    {
+        OggPacketNode *next = node->next;
+        free(node);
+        node = next;
+    } // while
+    q->head = q->tail = NULL;
+    q->count = 0;
+    Mutex_Destroy(q->lock);
+} // PacketQueue_deinit
+
+
+// Append a keyframe index entry; 'lock' must NOT be held. Entries out
+//  of (monotonic) order - a backwards seek replaying indexed ground -
+//  are dropped, as are OOM failures: the index is an accelerator, not
+//  correctness-critical.
+static void indexAppend(TheoraDecoder *ctx, ogg_int64_t frame, ogg_int64_t offset)
+{
+    Mutex_Lock(ctx->lock);
+
+    if (ctx->indexlen > 0 &&
+        (frame <= ctx->index[ctx->indexlen - 1].frame ||
+         offset <= ctx->index[ctx->indexlen - 1].offset))
+    {
+        Mutex_Unlock(ctx->lock);
+        return;
+    } // if
+
+    if (ctx->indexlen == ctx->indexcap)
+    {
+        const int newcap = (ctx->indexcap == 0) ? 64 : ctx->indexcap * 2;
+        IndexEntry *grown = (IndexEntry *) realloc(ctx->index, newcap * sizeof (IndexEntry));
+        if (grown == NULL)
+        {
+            Mutex_Unlock(ctx->lock);
+            return;
+        } // if
+        ctx->index = grown;
+        ctx->indexcap = newcap;
+    } // if
+
+    ctx->index[ctx->indexlen].frame = frame;
+    ctx->index[ctx->indexlen].offset = offset;
+    ctx->indexlen++;
+
+    Mutex_Unlock(ctx->lock);
+} // indexAppend
+
+
+// Has a seek request the demuxer hasn't acted on yet come in?
+static int seekPending(TheoraDecoder *ctx, int servedgen)
+{
+    int pending;
+    Mutex_Lock(ctx->lock);
+    pending = (ctx->seekgen != servedgen);
+    Mutex_Unlock(ctx->lock);
+    return pending;
+} // seekPending
+
+
+// Pick the byte offset to land on for a jump to 'targetframe':
+//  the page before the latest keyframe <= target, so the forward scan
+//  passes over that keyframe's packet. 'lock' must be held.
+static ogg_int64_t indexLookup(TheoraDecoder *ctx, ogg_int64_t targetframe)
+{
+    ogg_int64_t key = -1;
+    int i;
+
+    for (i = ctx->indexlen - 1; i >= 0; i--)
+    {
+        if (ctx->index[i].frame <= targetframe)
+        {
+            key = ctx->index[i].frame;
+            break;
+        } // if
+    } // for
+
+    for (; i >= 0; i--)
+    {
+        if (ctx->index[i].frame < key)
+            return ctx->index[i].offset;
+    } // for
+
+    return 0;
+} // indexLookup
+
+
+// Everything the decode stage threads share with the demuxer. The codec
+//  states are set up by the demuxer during header parsing and then owned
+//  exclusively by their stage thread until it's joined.
+typedef struct DecodeStages
+{
+    TheoraDecoder *ctx;
+
+    PacketQueue vidpackets;
+    PacketQueue audpackets;
+
+    // video stage...
+    th_dec_ctx *tdec;
+    const th_info *tinfo;
+    double fps;
+    volatile int vidfailed;
+
+    // audio stage...
+    vorbis_dsp_state *vdsp;
+    vorbis_block *vblock;
+    const vorbis_info *vinfo;
+    volatile int audfailed;
+} DecodeStages;
+
+
+static void VideoDecodeThread(DecodeStages *stages)
+{
+    TheoraDecoder *ctx = stages->ctx;
+    th_dec_ctx *tdec = stages->tdec;
+    const th_info *tinfo = stages->tinfo;
+    int gen = 0;
+    int needkey = 0;
+
+    while (!ctx->halt)
+    {
+        ogg_int64_t granulepos = 0;
+        OggPacketNode *node = PacketQueue_get(&stages->vidpackets);
+        if (node == NULL)
+        {
+            if (PacketQueue_drained(&stages->vidpackets))
+                break;
+            sleepms(1);
+            continue;
+        } // if
+
+        // packets demuxed before the latest seek flush are stale.
+        if (node->gen != ctx->flushgen)
+        {
+            free(node);
+            continue;
+        } // if
+
+        if (node->gen != gen)
+        {
+            // first packet after a seek: don't touch the decoder until
+            //  a keyframe arrives, everything before it is undecodable.
+            gen = node->gen;
+            needkey = 1;
+        } // if
+
+        if (needkey)
+        {
+            if (!th_packet_iskeyframe(&node->packet))
+            {
+                free(node);
+                continue;
+            } // if
+            needkey = 0;
+        } // if
+
+        const double decstart = nowMs();
+
+        // you have to guide the Theora decoder to get meaningful timestamps, apparently.  :/
+        if (node->packet.granulepos >= 0)
+            th_decode_ctl(tdec, TH_DECCTL_SET_GRANPOS, &node->packet.granulepos, sizeof(node->packet.granulepos));
+
+        if (th_decode_packetin(tdec, &node->packet, &granulepos) == 0)  // new frame!
+        {
+            th_ycbcr_buffer ycbcr;
+            if (th_decode_ycbcr_out(tdec, ycbcr) == 0)
+            {
+                const double videotime = th_granule_time(tdec, granulepos);
+                VideoFrame *item;
+
+                // roll forward silently up to the seek target.
+                if ((unsigned int) (videotime * 1000.0) < ctx->dropbeforems)
+                {
+                    free(node);
+                    continue;
+                } // if
+
+                item = (VideoFrame *) malloc(sizeof (VideoFrame));
+                if (item == NULL)
+                {
+                    free(node);
+                    stages->vidfailed = 1;
+                    return;
+                } // if
+                item->playms = (unsigned int) (videotime * 1000.0);
+                item->fps = stages->fps;
+                item->width = tinfo->pic_width;
+                item->height = tinfo->pic_height;
+                item->format = ctx->vidfmt;
+                item->pixels = ctx->vidcvt(tinfo, ycbcr);
+                item->next = NULL;
+
+                if (item->pixels == NULL)
+                {
+                    free(item);
+                    free(node);
+                    stages->vidfailed = 1;
+                    return;
+                } // if
+
+                //printf("Decoded another video frame.\n");
+                const double decms = nowMs() - decstart;
+
+                Mutex_Lock(ctx->lock);
+                ctx->statframes++;
+                ctx->statmstotal += decms;
+                if (decms > ctx->statmsmax)
+                    ctx->statmsmax = decms;
+                if (ctx->videolisttail)
+                {
+                    assert(ctx->videolist);
+                    ctx->videolisttail->next = item;
+                } // if
+                else
+                {
+                    assert(!ctx->videolist);
+                    ctx->videolist = item;
+                } // else
+                ctx->videolisttail = item;
+                ctx->videocount++;
+                Mutex_Unlock(ctx->lock);
+
+                // Sleep this stage until the consumer makes space; the
+                //  demuxer and the audio stage keep running.
+                while (!ctx->halt)
+                {
+                    int go_on;
+                    // !!! FIXME: This is stupid. I should use a semaphore for this.
+                    Mutex_Lock(ctx->lock);
+                    go_on = (ctx->videocount >= ctx->maxframes);
+                    Mutex_Unlock(ctx->lock);
+                    if (!go_on)
+                        break;
+                    sleepms(10);
+                } // while
+            } // if
+        } // if
+
+        free(node);
+    } // while
+} // VideoDecodeThread
+
+
+static void *VideoDecodeThreadEntry(void *_this)
+{
+    VideoDecodeThread((DecodeStages *) _this);
+    return NULL;
+} // VideoDecodeThreadEntry
+
+
+static void AudioDecodeThread(DecodeStages *stages)
+{
+    TheoraDecoder *ctx = stages->ctx;
+    vorbis_dsp_state *vdsp = stages->vdsp;
+    const vorbis_info *vinfo = stages->vinfo;
+    unsigned long audioframes = 0;
+    int gen = 0;
+    int synced = 1;  // position known; cleared by a seek flush
+
+    while (!ctx->halt)
+    {
+        OggPacketNode *node;
+
+        // Eat all the decoded audio the synthesis state has for us.
+        while (!ctx->halt)
+        {
+            float **pcm = NULL;
+            const int frames = vorbis_synthesis_pcmout(vdsp, &pcm);
+            const int channels = vinfo->channels;
+            int chanidx, frameidx;
+            unsigned long playms;
+            float *samples;
+            AudioPacket *item;
+
+            if (frames <= 0)
+                break;
+
+            // until a granulepos pins down where the seek landed,
+            //  the decoded audio has no usable timestamp.
+            if (!synced)
+            {
+                vorbis_synthesis_read(vdsp, frames);
+                continue;
+            } // if
+
+            playms = (unsigned long) ((((double) audioframes) / ((double) vinfo->rate)) * 1000.0);
+
+            // roll forward silently up to the seek target.
+            if (playms < ctx->dropbeforems)
+            {
+                vorbis_synthesis_read(vdsp, frames);
+                audioframes += frames;
+                continue;
+            } // if
+
+            item = (AudioPacket *) malloc(sizeof (AudioPacket));
+            if (item == NULL)
+            {
+                stages->audfailed = 1;
+                return;
+            } // if
+            item->playms = playms;
+            item->channels = channels;
+            item->freq = vinfo->rate;
+            item->frames = frames;
+            item->samples = (float *) malloc(sizeof (float) * frames * channels);
+            item->next = NULL;
+
+            if (item->samples == NULL)
+            {
+                free(item);
+                stages->audfailed = 1;
+                return;
+            } // if
+
+            // I bet this beats the crap out of the CPU cache...
+            samples = item->samples;
+            for (frameidx = 0; frameidx < frames; frameidx++)
+            {
+                for (chanidx = 0; chanidx < channels; chanidx++)
+                    *(samples++) = pcm[chanidx][frameidx];
+            } // for
+
+            vorbis_synthesis_read(vdsp, frames);  // we ate everything.
+            audioframes += frames;
+
+            //printf("Decoded %d frames of audio.\n", (int) frames);
+            Mutex_Lock(ctx->lock);
+            ctx->audioms += item->playms;
+            if (ctx->audiolisttail)
+            {
+                assert(ctx->audiolist);
+                ctx->audiolisttail->next = item;
+            } // if
+            else
+            {
+                assert(!ctx->audiolist);
+                ctx->audiolist = item;
+            } // else
+            ctx->audiolisttail = item;
+            Mutex_Unlock(ctx->lock);
+        } // while
+
+        // try to feed another packet to the Vorbis stream...
+        node = PacketQueue_get(&stages->audpackets);
+        if (node == NULL)
+        {
+            if (PacketQueue_drained(&stages->audpackets))
+                break;
+            sleepms(1);
+            continue;
+        } // if
+
+        // packets demuxed before the latest seek flush are stale.
+        if (node->gen != ctx->flushgen)
+        {
+            free(node);
+            continue;
+        } // if
+
+        if (node->gen != gen)
+        {
+            gen = node->gen;
+            vorbis_synthesis_restart(vdsp);
+            synced = 0;
+        } // if
+
+        if (vorbis_synthesis(stages->vblock, &node->packet) == 0)
+            vorbis_synthesis_blockin(vdsp, stages->vblock);
+
+        // a granulepos names the absolute sample index at this
+        //  packet's end: flush its output and re-anchor the position.
+        if (!synced && node->packet.granulepos >= 0)
+        {
+            float **pcm = NULL;
+            int frames;
+            while ((frames = vorbis_synthesis_pcmout(vdsp, &pcm)) > 0)
+                vorbis_synthesis_read(vdsp, frames);
+            audioframes = (unsigned long) node->packet.granulepos;
+            synced = 1;
+        } // if
+
+        free(node);
+    } // while
+} // AudioDecodeThread
+
+
+static void *AudioDecodeThreadEntry(void *_this)
+{
+    AudioDecodeThread((DecodeStages *) _this);
+    return NULL;
+} // AudioDecodeThreadEntry
+
+
 // This massive function is where all the effort happens.
 static void WorkerThread(TheoraDecoder *ctx)
 {
@@ -221,11 +787,25 @@ static void WorkerThread(TheoraDecoder *ctx)
         if (vpackets) ogg_stream_pagein(&vstream, &page); \
     } while (0)
 
-    unsigned long audioframes = 0;
     double fps = 0.0;
     int was_error = 1;  // resets to 0 at the end.
     int eos = 0;  // end of stream flag.
 
+    // Page byte accounting & seek state. Offsets only ever
+    //  undercount (resync garbage after a jump isn't measured),
+    //  which keeps index landings conservative.
+    ogg_int64_t pagebytes = 0;
+    int tserial = 0;
+    int curgen = 0;    // generation stamped onto queued packets
+    int servedgen = 0; // last seek request we acted on
+
+    // Decode stage threads...
+    DecodeStages stages;
+    THEORAPLAY_THREAD_T vidthread;
+    THEORAPLAY_THREAD_T audthread;
+    int vidthread_created = 0;
+    int audthread_created = 0;
+
     // Too much Ogg/Vorbis/Theora state...
     ogg_packet packet;
     ogg_sync_state sync;
@@ -262,6 +842,8 @@ static void WorkerThread(TheoraDecoder *ctx)
         {
             ogg_stream_state test;
 
+            pagebytes += page.header_len + page.body_len;
+
             if (!ogg_page_bos(&page))  // not a header.
             {
                 queue_ogg_page(ctx);
@@ -276,6 +858,7 @@ static void WorkerThread(TheoraDecoder *ctx)
             if (!tpackets && (th_decode_headerin(&tinfo, &tcomment, &tsetup, &packet) >= 0))
             {
                 memcpy(&tstream, &test, sizeof (test));
+                tserial = ogg_page_serialno(&page);
                 tpackets = 1;
             } // if
             else if (!vpackets && (vorbis_synthesis_headerin(&vinfo, &vcomment, &packet) >= 0))
@@ -318,7 +901,10 @@ static void WorkerThread(TheoraDecoder *ctx)
 
         // get another page, try again?
         if (ogg_sync_pageout(&sync, &page) > 0)
+        {
+            pagebytes += page.header_len + page.body_len;
             queue_ogg_page(ctx);
+        } // if
         else if (FeedMoreOggData(ctx->io, &sync) <= 0)
             goto cleanup;
     } // while
@@ -375,182 +961,230 @@ static void WorkerThread(TheoraDecoder *ctx)
     // Now we can start the actual decoding!
     // Note that audio and video don't _HAVE_ to start simultaneously.
 
+    // Hand the codec states to their stage threads; from here on this
+    //  thread only demuxes.
+    memset(&stages, '\0', sizeof (DecodeStages));
+    stages.ctx = ctx;
+    if (!PacketQueue_init(&stages.vidpackets))
+        goto cleanup;
+    if (!PacketQueue_init(&stages.audpackets))
+    {
+        PacketQueue_deinit(&stages.vidpackets);
+        goto cleanup;
+    } // if
+
+    if (!ctx->halt && tpackets)
+    {
+        stages.tdec = tdec;
+        stages.tinfo = &tinfo;
+        stages.fps = fps;
+        vidthread_created = (Thread_Create(&vidthread, VideoDecodeThreadEntry, &stages) == 0);
+        if (!vidthread_created)
+            goto stages_done;
+    } // if
+
+    if (!ctx->halt && vpackets)
+    {
+        stages.vdsp = &vdsp;
+        stages.vblock = &vblock;
+        stages.vinfo = &vinfo;
+        audthread_created = (Thread_Create(&audthread, AudioDecodeThreadEntry, &stages) == 0);
+        if (!audthread_created)
+            goto stages_done;
+    } // if
+
     Mutex_Lock(ctx->lock);
     ctx->prepped = 1;
     ctx->hasvideo = (tpackets != 0);
     ctx->hasaudio = (vpackets != 0);
     Mutex_Unlock(ctx->lock);
 
-    while (!ctx->halt && !eos)
+    while (!ctx->halt)
     {
-        int need_pages = 0;  // need more Ogg pages?
-        int saw_video_frame = 0;
+        int rc;
 
-        // Try to read as much audio as we can at once. We limit the outer
-        //  loop to one video frame and as much audio as we can eat.
-        while (!ctx->halt && vpackets)
+        // Service a pending seek before demuxing further.
+        if (ctx->ioseekable && tpackets && seekPending(ctx, servedgen))
         {
-            float **pcm = NULL;
-            const int frames = vorbis_synthesis_pcmout(&vdsp, &pcm);
-            if (frames > 0)
-            {
-                const int channels = vinfo.channels;
-                int chanidx, frameidx;
-                float *samples;
-                AudioPacket *item = (AudioPacket *) malloc(sizeof (AudioPacket));
-                if (item == NULL) goto cleanup;
-                item->playms = (unsigned long) ((((double) audioframes) / ((double) vinfo.rate)) * 1000.0);
-                item->channels = channels;
-                item->freq = vinfo.rate;
-                item->frames = frames;
-                item->samples = (float *) malloc(sizeof (float) * frames * channels);
-                item->next = NULL;
+            int wantgen;
+            unsigned int wantms;
+            ogg_int64_t landing, targetframe;
 
-                if (item->samples == NULL)
-                {
-                    free(item);
-                    goto cleanup;
-                } // if
+            Mutex_Lock(ctx->lock);
+            wantgen = ctx->seekgen;
+            wantms = ctx->seekms;
+            targetframe = (ogg_int64_t) ((wantms / 1000.0) * fps);
+            landing = indexLookup(ctx, targetframe);
+            Mutex_Unlock(ctx->lock);
 
-                // I bet this beats the crap out of the CPU cache...
-                samples = item->samples;
-                for (frameidx = 0; frameidx < frames; frameidx++)
-                {
-                    for (chanidx = 0; chanidx < channels; chanidx++)
-                        *(samples++) = pcm[chanidx][frameidx];
-                } // for
-
-                vorbis_synthesis_read(&vdsp, frames);  // we ate everything.
-                audioframes += frames;
+            servedgen = wantgen;
 
-                //printf("Decoded %d frames of audio.\n", (int) frames);
+            if (ctx->io->seek(ctx->io, (long) landing) == 0)
+            {
+                VideoFrame *vf;
+                AudioPacket *ap;
+
+                ogg_sync_reset(&sync);
+                ogg_stream_reset(&tstream);
+                if (vpackets)
+                    ogg_stream_reset(&vstream);
+                pagebytes = landing;
+                curgen = wantgen;
+                eos = 0;
+
+                // Flush decoded-but-unconsumed output and arm the
+                //  stages to drop everything from before the jump.
                 Mutex_Lock(ctx->lock);
-                ctx->audioms += item->playms;
-                if (ctx->audiolisttail)
+                ctx->dropbeforems = wantms;
+                ctx->flushgen = wantgen;
+                ctx->ateos = 0;
+                ctx->decodedone = 0;
+                vf = ctx->videolist;
+                ctx->videolist = ctx->videolisttail = NULL;
+                ctx->videocount = 0;
+                ap = ctx->audiolist;
+                ctx->audiolist = ctx->audiolisttail = NULL;
+                ctx->audioms = 0;
+                Mutex_Unlock(ctx->lock);
+
+                while (vf)
                 {
-                    assert(ctx->audiolist);
-                    ctx->audiolisttail->next = item;
-                } // if
-                else
+                    VideoFrame *next = vf->next;
+                    free(vf->pixels);
+                    free(vf);
+                    vf = next;
+                } // while
+
+                while (ap)
                 {
-                    assert(!ctx->audiolist);
-                    ctx->audiolist = item;
-                } // else
-                ctx->audiolisttail = item;
-                Mutex_Unlock(ctx->lock);
+                    AudioPacket *next = ap->next;
+                    free(ap->samples);
+                    free(ap);
+                    ap = next;
+                } // while
             } // if
+        } // if
+
+        // At end-of-stream a seekable file isn't done: the consumer
+        //  may still jump back (chapter replay). Linger until all the
+        //  output is drained or a new seek request arrives.
+        if (eos)
+        {
+            int drained;
 
-            else  // no audio available left in current packet?
+            if (!ctx->ioseekable || !tpackets)
+                break;
+            if (seekPending(ctx, servedgen))
+                continue;
+
+            Mutex_Lock(ctx->lock);
+            drained = (ctx->videolist == NULL && ctx->audiolist == NULL);
+            Mutex_Unlock(ctx->lock);
+
+            if ((PacketQueue_count(&stages.vidpackets) == 0) &&
+                (!vpackets || (PacketQueue_count(&stages.audpackets) == 0)))
             {
-                // try to feed another packet to the Vorbis stream...
-                if (ogg_stream_packetout(&vstream, &packet) <= 0)
+                // every demuxed packet has been decoded; a loop wrap
+                //  issued from here on flushes nothing undelivered.
+                if (!ctx->decodedone)
                 {
-                    if (!tpackets)
-                        need_pages = 1; // no video, get more pages now.
-                    break;  // we'll get more pages when the video catches up.
+                    Mutex_Lock(ctx->lock);
+                    ctx->decodedone = 1;
+                    Mutex_Unlock(ctx->lock);
                 } // if
-                else
-                {
-                    if (vorbis_synthesis(&vblock, &packet) == 0)
-                        vorbis_synthesis_blockin(&vdsp, &vblock);
-                } // else
-            } // else
+
+                if (drained)
+                    break;
+            } // if
+
+            sleepms(10);
+            continue;
+        } // if
+
+        // Drain every complete packet out of the streams into the stage
+        //  queues before pulling more pages. A full queue means that
+        //  stage is far enough ahead; wait for it to chew through some.
+        while (!ctx->halt && tpackets && (ogg_stream_packetout(&tstream, &packet) == 1))
+        {
+            while (!ctx->halt && !stages.vidfailed && !seekPending(ctx, servedgen) &&
+                   (PacketQueue_count(&stages.vidpackets) >= THEORAPLAY_PACKET_BUFFER))
+                sleepms(10);
+            if (ctx->halt || stages.vidfailed || seekPending(ctx, servedgen))
+                break;
+            if (!PacketQueue_put(&stages.vidpackets, &packet, curgen))
+                goto stages_done;
         } // while
 
-        if (!ctx->halt && tpackets)
+        while (!ctx->halt && vpackets && (ogg_stream_packetout(&vstream, &packet) == 1))
         {
-            // Theora, according to example_player.c, is
-            //  "one [packet] in, one [frame] out."
-            if (ogg_stream_packetout(&tstream, &packet) <= 0)
-                need_pages = 1;
-            else
-            {
-                ogg_int64_t granulepos = 0;
+            while (!ctx->halt && !stages.audfailed && !seekPending(ctx, servedgen) &&
+                   (PacketQueue_count(&stages.audpackets) >= THEORAPLAY_PACKET_BUFFER))
+                sleepms(10);
+            if (ctx->halt || stages.audfailed || seekPending(ctx, servedgen))
+                break;
+            if (!PacketQueue_put(&stages.audpackets, &packet, curgen))
+                goto stages_done;
+        } // while
 
-                // you have to guide the Theora decoder to get meaningful timestamps, apparently.  :/
-                if (packet.granulepos >= 0)
-                    th_decode_ctl(tdec, TH_DECCTL_SET_GRANPOS, &packet.granulepos, sizeof(packet.granulepos));
+        if (stages.vidfailed || stages.audfailed)
+            goto stages_done;
 
-                if (th_decode_packetin(tdec, &packet, &granulepos) == 0)  // new frame!
-                {
-                    th_ycbcr_buffer ycbcr;
-                    if (th_decode_ycbcr_out(tdec, ycbcr) == 0)
-                    {
-                        const double videotime = th_granule_time(tdec, granulepos);
-                        VideoFrame *item = (VideoFrame *) malloc(sizeof (VideoFrame));
-                        if (item == NULL) goto cleanup;
-                        item->playms = (unsigned int) (videotime * 1000.0);
-                        item->fps = fps;
-                        item->width = tinfo.pic_width;
-                        item->height = tinfo.pic_height;
-                        item->format = ctx->vidfmt;
-                        item->pixels = ctx->vidcvt(&tinfo, ycbcr);
-                        item->next = NULL;
-
-                        if (item->pixels == NULL)
-                        {
-                            free(item);
-                            goto cleanup;
-                        } // if
-
-                        //printf("Decoded another video frame.\n");
-                        Mutex_Lock(ctx->lock);
-                        if (ctx->videolisttail)
-                        {
-                            assert(ctx->videolist);
-                            ctx->videolisttail->next = item;
-                        } // if
-                        else
-                        {
-                            assert(!ctx->videolist);
-                            ctx->videolist = item;
-                        } // else
-                        ctx->videolisttail = item;
-                        ctx->videocount++;
-                        Mutex_Unlock(ctx->lock);
-
-                        saw_video_frame = 1;
-                    } // if
-                } // if
-            } // else
-        } // if
+        if (ctx->halt)
+            break;
+
+        // A fresh seek request: don't pull more pages, service it first.
+        if (ctx->ioseekable && seekPending(ctx, servedgen))
+            continue;
 
-        if (!ctx->halt && need_pages)
+        rc = FeedMoreOggData(ctx->io, &sync);
+        if (rc == 0)
         {
-            const int rc = FeedMoreOggData(ctx->io, &sync);
-            if (rc == 0)
-                eos = 1;  // end of stream
-            else if (rc < 0)
-                goto cleanup;  // i/o error, etc.
-            else
-            {
-                while (!ctx->halt && (ogg_sync_pageout(&sync, &page) > 0))
-                    queue_ogg_page(ctx);
-            } // else
+            eos = 1;  // end of stream
+            Mutex_Lock(ctx->lock);
+            ctx->ateos = 1;
+            Mutex_Unlock(ctx->lock);
         } // if
-
-        // Sleep the process until we have space for more frames.
-        if (saw_video_frame)
+        else if (rc < 0)
+            goto stages_done;  // i/o error, etc.
+        else
         {
-            int go_on = !ctx->halt;
-            //printf("Sleeping.\n");
-            while (go_on)
+            while (!ctx->halt && (ogg_sync_pageout(&sync, &page) > 0))
             {
-                // !!! FIXME: This is stupid. I should use a semaphore for this.
-                Mutex_Lock(ctx->lock);
-                go_on = !ctx->halt && (ctx->videocount >= ctx->maxframes);
-                Mutex_Unlock(ctx->lock);
-                if (go_on)
-                    sleepms(10);
+                const ogg_int64_t pageoffset = pagebytes;
+                pagebytes += page.header_len + page.body_len;
+
+                // Remember where keyframes live as they stream past.
+                if (tpackets && (ogg_page_serialno(&page) == tserial) &&
+                    (ogg_page_granulepos(&page) >= 0))
+                    indexAppend(ctx,
+                                ogg_page_granulepos(&page) >> tinfo.keyframe_granule_shift,
+                                pageoffset);
+
+                queue_ogg_page(ctx);
             } // while
-            //printf("Awake!\n");
-        } // if
+        } // else
     } // while
 
     was_error = 0;
 
+stages_done:
+    // Close the queues so the stages drain what's left and exit, then
+    //  reel the threads back in before tearing down the codec states.
+    PacketQueue_close(&stages.vidpackets);
+    PacketQueue_close(&stages.audpackets);
+    if (vidthread_created)
+        Thread_Join(vidthread);
+    if (audthread_created)
+        Thread_Join(audthread);
+    if (stages.vidfailed || stages.audfailed)
+        was_error = 1;
+    PacketQueue_deinit(&stages.vidpackets);
+    PacketQueue_deinit(&stages.audpackets);
+
 cleanup:
+    Mutex_Lock(ctx->lock);
     ctx->decode_error = (!ctx->halt && was_error);
+    Mutex_Unlock(ctx->lock);
     if (tdec != NULL) th_decode_free(tdec);
     if (tsetup != NULL) th_setup_free(tsetup);
     if (vblock_init) vorbis_block_clear(&vblock);
@@ -563,7 +1197,9 @@ cleanup:
     vorbis_info_clear(&vinfo);
     ogg_sync_clear(&sync);
     ctx->io->close(ctx->io);
+    Mutex_Lock(ctx->lock);
     ctx->thread_done = 1;
+    Mutex_Unlock(ctx->lock);
 } // WorkerThread
 
 
@@ -586,6 +1222,13 @@ static long IoFopenRead(THEORAPLAY_Io *io, void *buf, long buflen)
 } // IoFopenRead
 
 
+static int IoFopenSeek(THEORAPLAY_Io *io, long offset)
+{
+    FILE *f = (FILE *) io->userdata;
+    return (fseek(f, offset, SEEK_SET) == 0) ? 0 : -1;
+} // IoFopenSeek
+
+
 static void IoFopenClose(THEORAPLAY_Io *io)
 {
     FILE *f = (FILE *) io->userdata;
@@ -610,6 +1253,7 @@ THEORAPLAY_Decoder *THEORAPLAY_startDecodeFile(const char *fname,
     } // if
 
     io->read = IoFopenRead;
+    io->seek = IoFopenSeek;
     io->close = IoFopenClose;
     io->userdata = f;
     return THEORAPLAY_startDecode(io, maxframes, vidfmt);
@@ -644,10 +1288,11 @@ THEORAPLAY_Decoder *THEORAPLAY_startDecode(THEORAPLAY_Io *io,
     ctx->vidfmt = vidfmt;
     ctx->vidcvt = vidcvt;
     ctx->io = io;
+    ctx->ioseekable = (io->seek != NULL);
 
-    if (Mutex_Create(ctx) == 0)
+    if (Mutex_Create(&ctx->lock) == 0)
     {
-        ctx->thread_created = (Thread_Create(ctx, WorkerThreadEntry) == 0);
+        ctx->thread_created = (Thread_Create(&ctx->worker, WorkerThreadEntry, ctx) == 0);
         if (ctx->thread_created)
             return (THEORAPLAY_Decoder *) ctx;
     } // if
@@ -692,6 +1337,7 @@ void THEORAPLAY_stopDecode(THEORAPLAY_Decoder *decoder)
         audiolist = next;
     } // while
 
+    free(ctx->index);
     free(ctx);
 } // THEORAPLAY_stopDecode
 
@@ -757,6 +1403,35 @@ int THEORAPLAY_decodingError(THEORAPLAY_Decoder *decoder)
 } // THEORAPLAY_decodingError
 
 
+int THEORAPLAY_atEnd(THEORAPLAY_Decoder *decoder)
+{
+    GET_SYNCED_VALUE(int, 0, decoder, ateos);
+} // THEORAPLAY_atEnd
+
+
+int THEORAPLAY_decodeDone(THEORAPLAY_Decoder *decoder)
+{
+    GET_SYNCED_VALUE(int, 0, decoder, decodedone);
+} // THEORAPLAY_decodeDone
+
+
+void THEORAPLAY_videoStats(THEORAPLAY_Decoder *decoder,
+                           THEORAPLAY_VideoStats *stats)
+{
+    TheoraDecoder *ctx = (TheoraDecoder *) decoder;
+
+    memset(stats, '\0', sizeof (*stats));
+    if (!ctx)
+        return;
+
+    Mutex_Lock(ctx->lock);
+    stats->frames = ctx->statframes;
+    stats->decodeMsTotal = ctx->statmstotal;
+    stats->decodeMsMax = ctx->statmsmax;
+    Mutex_Unlock(ctx->lock);
+} // THEORAPLAY_videoStats
+
+
 const THEORAPLAY_AudioPacket *THEORAPLAY_getAudio(THEORAPLAY_Decoder *decoder)
 {
     TheoraDecoder *ctx = (TheoraDecoder *) decoder;
@@ -812,6 +1487,107 @@ const THEORAPLAY_VideoFrame *THEORAPLAY_getVideo(THEORAPLAY_Decoder *decoder)
 } // THEORAPLAY_getVideo
 
 
+int THEORAPLAY_seek(THEORAPLAY_Decoder *decoder, unsigned int ms)
+{
+    TheoraDecoder *ctx = (TheoraDecoder *) decoder;
+
+    if (!ctx || !ctx->thread_created || !ctx->ioseekable || !ctx->hasvideo)
+        return 0;
+
+    Mutex_Lock(ctx->lock);
+    ctx->seekms = ms;
+    ctx->seekgen++;
+    Mutex_Unlock(ctx->lock);
+
+    return 1;
+} // THEORAPLAY_seek
+
+
+#define THEORAPLAY_INDEX_MAGIC "OGVIDX01"
+
+void *THEORAPLAY_exportIndex(THEORAPLAY_Decoder *decoder, long *len)
+{
+    TheoraDecoder *ctx = (TheoraDecoder *) decoder;
+    unsigned char *blob = NULL;
+
+    if (len)
+        *len = 0;
+    if (!ctx)
+        return NULL;
+
+    Mutex_Lock(ctx->lock);
+    if (ctx->indexlen > 0)
+    {
+        const ogg_int64_t count = ctx->indexlen;
+        const long size = 8 + (long) sizeof (count) +
+                          ctx->indexlen * (long) sizeof (IndexEntry);
+        blob = (unsigned char *) malloc(size);
+        if (blob)
+        {
+            memcpy(blob, THEORAPLAY_INDEX_MAGIC, 8);
+            memcpy(blob + 8, &count, sizeof (count));
+            memcpy(blob + 8 + sizeof (count), ctx->index,
+                   ctx->indexlen * sizeof (IndexEntry));
+            if (len)
+                *len = size;
+        } // if
+    } // if
+    Mutex_Unlock(ctx->lock);
+
+    return blob;
+} // THEORAPLAY_exportIndex
+
+
+void THEORAPLAY_importIndex(THEORAPLAY_Decoder *decoder,
+                            const void *data, long len)
+{
+    TheoraDecoder *ctx = (TheoraDecoder *) decoder;
+    const unsigned char *blob = (const unsigned char *) data;
+    IndexEntry *entries;
+    ogg_int64_t count, i;
+
+    if (!ctx || !blob || len < (long) (8 + sizeof (count)))
+        return;
+    if (memcmp(blob, THEORAPLAY_INDEX_MAGIC, 8) != 0)
+        return;
+
+    memcpy(&count, blob + 8, sizeof (count));
+    if (count <= 0 || count > (1 << 20))
+        return;
+    if (len != (long) (8 + sizeof (count) + count * sizeof (IndexEntry)))
+        return;
+
+    entries = (IndexEntry *) malloc(count * sizeof (IndexEntry));
+    if (entries == NULL)
+        return;
+    memcpy(entries, blob + 8 + sizeof (count), count * sizeof (IndexEntry));
+
+    // both sequences must be strictly increasing and non-negative.
+    for (i = 0; i < count; i++)
+    {
+        if (entries[i].frame < 0 || entries[i].offset < 0 ||
+            (i > 0 && (entries[i].frame <= entries[i - 1].frame ||
+                       entries[i].offset <= entries[i - 1].offset)))
+        {
+            free(entries);
+            return;
+        } // if
+    } // for
+
+    Mutex_Lock(ctx->lock);
+    if ((int) count > ctx->indexlen)
+    {
+        free(ctx->index);
+        ctx->index = entries;
+        ctx->indexlen = ctx->indexcap = (int) count;
+        entries = NULL;
+    } // if
+    Mutex_Unlock(ctx->lock);
+
+    free(entries);
+} // THEORAPLAY_importIndex
+
+
 void THEORAPLAY_freeVideo(const THEORAPLAY_VideoFrame *_item)
 {
     THEORAPLAY_VideoFrame *item = (THEORAPLAY_VideoFrame *) _item;
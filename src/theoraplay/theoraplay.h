@@ -17,6 +17,9 @@ typedef struct THEORAPLAY_Io THEORAPLAY_Io;
 struct THEORAPLAY_Io
 {
     long (*read)(THEORAPLAY_Io *io, void *buf, long buflen);
+    /* Optional (may be NULL): reposition to an absolute byte offset,
+     * returning 0 on success. Required for THEORAPLAY_seek. */
+    int (*seek)(THEORAPLAY_Io *io, long offset);
     void (*close)(THEORAPLAY_Io *io);
     void *userdata;
 };
@@ -75,6 +78,47 @@ void THEORAPLAY_freeAudio(const THEORAPLAY_AudioPacket *item);
 const THEORAPLAY_VideoFrame *THEORAPLAY_getVideo(THEORAPLAY_Decoder *decoder);
 void THEORAPLAY_freeVideo(const THEORAPLAY_VideoFrame *item);
 
+/* Request an async jump to 'ms'. Decode restarts at the nearest
+ * earlier keyframe (found through the index built while demuxing)
+ * and output before 'ms' is dropped, so the next frames handed out
+ * begin at the target. Returns 0 if the decoder can't seek
+ * (io->seek missing or no video); the request is serviced by the
+ * demux thread otherwise. */
+int THEORAPLAY_seek(THEORAPLAY_Decoder *decoder, unsigned int ms);
+
+/* Nonzero once the demuxer has read past the end of the file; a
+ * seek resets it. Frames may still be buffered for delivery when
+ * this starts reporting true. */
+int THEORAPLAY_atEnd(THEORAPLAY_Decoder *decoder);
+
+/* Nonzero once the file is fully decoded: the demuxer is at the end
+ * AND the decode stages have chewed through every packet, so all
+ * remaining output sits in the delivery lists. The safe moment for a
+ * loop wrap: a seek issued now flushes nothing that wasn't already
+ * fetchable. Reset by a seek. */
+int THEORAPLAY_decodeDone(THEORAPLAY_Decoder *decoder);
+
+/* Video decode timing, measured inside the video stage thread
+ * around packet-in + ycbcr-out + pixel conversion. */
+typedef struct THEORAPLAY_VideoStats
+{
+    unsigned int frames;     /* frames decoded so far */
+    double decodeMsTotal;
+    double decodeMsMax;
+} THEORAPLAY_VideoStats;
+
+void THEORAPLAY_videoStats(THEORAPLAY_Decoder *decoder,
+                           THEORAPLAY_VideoStats *stats);
+
+/* The keyframe index as a flat blob (native endianness, meant for a
+ * same-machine cache). Export returns a malloc'd buffer the caller
+ * frees, or NULL if nothing is indexed yet; importing a previously
+ * exported blob right after startDecode makes the whole file
+ * seekable before it ever played through once. */
+void *THEORAPLAY_exportIndex(THEORAPLAY_Decoder *decoder, long *len);
+void THEORAPLAY_importIndex(THEORAPLAY_Decoder *decoder,
+                            const void *data, long len);
+
 #ifdef __cplusplus
 }
 #endif
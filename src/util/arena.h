@@ -0,0 +1,163 @@
+/*
+** arena.h
+**
+** This file is part of mkxp.
+**
+** Copyright (C) 2013 - 2021 Amaryllis Kulla <ancurio@mapleshrine.eu>
+**
+** mkxp is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 2 of the License, or
+** (at your option) any later version.
+**
+** mkxp is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with mkxp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <new>
+#include <vector>
+
+/* Bump allocator for transient per-frame data: allocations are one
+ * pointer bump, reset() rewinds everything at a frame boundary while
+ * keeping the blocks, so steady state performs zero heap traffic.
+ * Strictly thread-confined, and nothing allocated from an arena may
+ * outlive its reset. bytesServed() counts what would otherwise have
+ * been heap allocations */
+class ScratchArena
+{
+public:
+	explicit ScratchArena(size_t blockSize = 64 * 1024)
+	    : blkSize(blockSize), curBlock(0), curOff(0), served(0)
+	{}
+
+	~ScratchArena()
+	{
+		for (size_t i = 0; i < blocks.size(); ++i)
+			free(blocks[i].mem);
+	}
+
+	void *alloc(size_t bytes, size_t align = 16)
+	{
+		if (bytes == 0)
+			bytes = 1;
+
+		/* Oversize requests get a dedicated block */
+		const size_t want = (bytes > blkSize) ? bytes : blkSize;
+
+		for (;;)
+		{
+			if (curBlock == blocks.size())
+			{
+				Block b;
+				b.mem = (char *) malloc(want);
+				b.size = want;
+
+				if (!b.mem)
+					return 0;
+
+				blocks.push_back(b);
+			}
+
+			Block &b = blocks[curBlock];
+
+			size_t off = (curOff + (align - 1)) & ~(align - 1);
+
+			if (off + bytes <= b.size)
+			{
+				curOff = off + bytes;
+				served += bytes;
+				return b.mem + off;
+			}
+
+			curBlock++;
+			curOff = 0;
+		}
+	}
+
+	/* Frame boundary: everything handed out becomes invalid */
+	void reset()
+	{
+		curBlock = 0;
+		curOff = 0;
+	}
+
+	uint64_t bytesServed() const { return served; }
+
+	size_t capacity() const
+	{
+		size_t sum = 0;
+		for (size_t i = 0; i < blocks.size(); ++i)
+			sum += blocks[i].size;
+		return sum;
+	}
+
+private:
+	struct Block
+	{
+		char *mem;
+		size_t size;
+	};
+
+	std::vector<Block> blocks;
+	size_t blkSize;
+	size_t curBlock;
+	size_t curOff;
+	uint64_t served;
+
+	ScratchArena(const ScratchArena &);
+	void operator=(const ScratchArena &);
+};
+
+/* std allocator over an arena; deallocation is a no-op (reset()
+ * reclaims). Containers built with it must die before the reset */
+template<typename T>
+class ArenaAlloc
+{
+public:
+	typedef T value_type;
+
+	explicit ArenaAlloc(ScratchArena *arena) : arena(arena) {}
+
+	template<typename U>
+	ArenaAlloc(const ArenaAlloc<U> &o) : arena(o.arena) {}
+
+	T *allocate(size_t n)
+	{
+		void *p = arena->alloc(n * sizeof(T), alignof(T) > 16 ? alignof(T) : 16);
+
+		if (!p)
+			throw std::bad_alloc();
+
+		return (T *) p;
+	}
+
+	void deallocate(T *, size_t) {}
+
+	template<typename U>
+	bool operator==(const ArenaAlloc<U> &o) const { return arena == o.arena; }
+	template<typename U>
+	bool operator!=(const ArenaAlloc<U> &o) const { return arena != o.arena; }
+
+	ScratchArena *arena;
+};
+
+template<typename T>
+using ArenaVector = std::vector<T, ArenaAlloc<T> >;
+
+/* The render thread's per-frame scratch; reset at the top of
+ * Graphics::update. Never touch it from another thread */
+ScratchArena &frameArena();
+
+#endif // ARENA_H
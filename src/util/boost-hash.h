@@ -32,16 +32,22 @@
 /* Wrappers around the boost unordered template classes,
  * exposing an interface similar to Qt's QHash/QSet */
 
+/* The transparent comparator lets the lookup members take
+ * any key-comparable type (eg. a plain char pointer against
+ * std::string keys) without materializing a temporary K,
+ * which kept showing up in profiles on the hot path cache
+ * and font pool queries */
 template<typename K, typename V>
 class BoostHash
 {
 private:
-    std::map<K, V> p = {};
+    std::map<K, V, std::less<> > p = {};
 
 public:
-	typedef typename std::map<K, V>::const_iterator const_iterator;
+	typedef typename std::map<K, V, std::less<> >::const_iterator const_iterator;
 
-	inline bool contains(const K &key) const
+	template<typename KX>
+	inline bool contains(const KX &key) const
 	{
 		const_iterator iter = p.find(key);
 
@@ -59,7 +65,8 @@ public:
 		p.erase(key);
 	}
 
-	inline const V value(const K &key) const
+	template<typename KX>
+	inline const V value(const KX &key) const
 	{
 		const_iterator iter = p.find(key);
 
@@ -69,7 +76,8 @@ public:
 		return iter->second;
 	}
 
-	inline const V value(const K &key, const V &defaultValue) const
+	template<typename KX>
+	inline const V value(const KX &key, const V &defaultValue) const
 	{
 		const_iterator iter = p.find(key);
 
@@ -79,6 +87,19 @@ public:
 		return iter->second;
 	}
 
+	/* Heterogeneous find without copying out the value;
+	 * null when absent, valid until the entry is removed */
+	template<typename KX>
+	inline const V *valuePtr(const KX &key) const
+	{
+		const_iterator iter = p.find(key);
+
+		if (iter == p.cend())
+			return 0;
+
+		return &iter->second;
+	}
+
 	inline V &operator[](const K &key)
 	{
 		return p[key];
@@ -93,7 +114,17 @@ public:
 	{
 		return p.cend();
 	}
-    
+
+	inline size_t size() const
+	{
+		return p.size();
+	}
+
+	inline const_iterator erase(const_iterator iter)
+	{
+		return p.erase(iter);
+	}
+
     inline void clear()
     {
         p.clear();
@@ -105,12 +136,13 @@ class BoostSet
 {
 private:
 	//typedef std::unordered_set<K> BoostType;
-	std::set<K> p;
+	std::set<K, std::less<> > p;
 
 public:
-	typedef typename std::set<K>::const_iterator const_iterator;
+	typedef typename std::set<K, std::less<> >::const_iterator const_iterator;
 
-	inline bool contains(const K &key)
+	template<typename KX>
+	inline bool contains(const KX &key)
 	{
 		const_iterator iter = p.find(key);
 
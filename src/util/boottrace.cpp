@@ -0,0 +1,179 @@
+/*
+** boottrace.cpp
+**
+** This file is part of mkxp.
+**
+** Copyright (C) 2013 - 2021 Amaryllis Kulla <ancurio@mapleshrine.eu>
+**
+** mkxp is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 2 of the License, or
+** (at your option) any later version.
+**
+** mkxp is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with mkxp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "boottrace.h"
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace BootTrace
+{
+
+struct Span
+{
+	const char *name;
+	uint64_t tid;
+	uint64_t startUs;
+	uint64_t endUs;   /* 0 while open */
+};
+
+struct State
+{
+	std::mutex lock;
+	std::vector<Span> spans;
+	std::chrono::steady_clock::time_point epoch;
+	bool epochSet = false;
+	bool done = false;
+
+	/* Open span indices per thread (spans nest) */
+	struct ThreadStack
+	{
+		uint64_t tid;
+		std::vector<size_t> open;
+	};
+	std::vector<ThreadStack> stacks;
+
+	std::vector<size_t> &stackFor(uint64_t tid)
+	{
+		for (size_t i = 0; i < stacks.size(); ++i)
+			if (stacks[i].tid == tid)
+				return stacks[i].open;
+
+		stacks.push_back(ThreadStack());
+		stacks.back().tid = tid;
+		return stacks.back().open;
+	}
+};
+
+static State &state()
+{
+	static State st;
+	return st;
+}
+
+static uint64_t threadId()
+{
+	return (uint64_t) std::hash<std::thread::id>()(std::this_thread::get_id());
+}
+
+static uint64_t nowUs(State &st)
+{
+	if (!st.epochSet)
+	{
+		st.epoch = std::chrono::steady_clock::now();
+		st.epochSet = true;
+	}
+
+	return (uint64_t) std::chrono::duration_cast<std::chrono::microseconds>(
+	        std::chrono::steady_clock::now() - st.epoch).count();
+}
+
+void begin(const char *name)
+{
+	State &st = state();
+	std::lock_guard<std::mutex> guard(st.lock);
+
+	if (st.done)
+		return;
+
+	const uint64_t tid = threadId();
+
+	Span span;
+	span.name = name;
+	span.tid = tid;
+	span.startUs = nowUs(st);
+	span.endUs = 0;
+
+	st.stackFor(tid).push_back(st.spans.size());
+	st.spans.push_back(span);
+}
+
+void end()
+{
+	State &st = state();
+	std::lock_guard<std::mutex> guard(st.lock);
+
+	if (st.done)
+		return;
+
+	std::vector<size_t> &stack = st.stackFor(threadId());
+
+	if (stack.empty())
+		return;
+
+	st.spans[stack.back()].endUs = nowUs(st);
+	stack.pop_back();
+}
+
+void finish(bool enabled, const std::string &path)
+{
+	State &st = state();
+	std::lock_guard<std::mutex> guard(st.lock);
+
+	if (st.done)
+		return;
+
+	st.done = true;
+
+	if (!enabled || path.empty())
+	{
+		st.spans.clear();
+		st.stacks.clear();
+		return;
+	}
+
+	/* Close anything still open at the cut */
+	const uint64_t cut = nowUs(st);
+
+	FILE *f = fopen(path.c_str(), "wb");
+	if (!f)
+		return;
+
+	fputs("{\"traceEvents\":[", f);
+
+	for (size_t i = 0; i < st.spans.size(); ++i)
+	{
+		const Span &s = st.spans[i];
+		const uint64_t endUs = s.endUs ? s.endUs : cut;
+
+		fprintf(f,
+		        "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,"
+		        "\"tid\":%llu,\"ts\":%llu,\"dur\":%llu}",
+		        i ? "," : "",
+		        s.name,
+		        (unsigned long long) (s.tid % 100000),
+		        (unsigned long long) s.startUs,
+		        (unsigned long long) (endUs - s.startUs));
+	}
+
+	fputs("]}\n", f);
+	fclose(f);
+
+	st.spans.clear();
+	st.stacks.clear();
+}
+
+}
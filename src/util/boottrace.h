@@ -0,0 +1,50 @@
+/*
+** boottrace.h
+**
+** This file is part of mkxp.
+**
+** Copyright (C) 2013 - 2021 Amaryllis Kulla <ancurio@mapleshrine.eu>
+**
+** mkxp is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 2 of the License, or
+** (at your option) any later version.
+**
+** mkxp is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with mkxp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef BOOTTRACE_H
+#define BOOTTRACE_H
+
+#include <string>
+
+/* Startup timeline spans. Collection is always on (a few dozen tiny
+ * records) because the config gate itself is only known mid-boot;
+ * finish() either writes a chrome://tracing JSON ("Load profile" in
+ * the tracing UI / Perfetto) or drops the buffer. Spans may nest and
+ * may come from any thread */
+namespace BootTrace
+{
+
+void begin(const char *name);
+void end();
+
+/* Write (or discard) and stop collecting; later spans are ignored */
+void finish(bool enabled, const std::string &path);
+
+class Scope
+{
+public:
+	Scope(const char *name) { begin(name); }
+	~Scope() { end(); }
+};
+
+}
+
+#endif // BOOTTRACE_H
@@ -0,0 +1,242 @@
+/*
+** debuglog.cpp
+**
+** This file is part of mkxp.
+**
+** Copyright (C) 2013 - 2021 Amaryllis Kulla <ancurio@mapleshrine.eu>
+**
+** mkxp is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 2 of the License, or
+** (at your option) any later version.
+**
+** mkxp is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with mkxp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "debuglog.h"
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/* Pending lines before producers start dropping */
+#define LOG_QUEUE_CAP 1024
+
+/* A line repeating within this window gets suppressed */
+#define LOG_REPEAT_WINDOW_MS 200
+
+namespace DebugLog
+{
+
+typedef std::chrono::steady_clock Clock;
+
+struct RepeatState
+{
+	Clock::time_point lastEmit;
+	uint64_t suppressed;
+};
+
+struct Sink
+{
+	std::mutex lock;
+	std::condition_variable cv;
+	std::vector<std::string> queue;
+	uint64_t dropped = 0;
+	bool started = false;
+	bool term = false;
+	/* One drainer at a time: serializes the worker against
+	 * explicit flush() callers (the repeat map and the stream
+	 * are drainer-owned) */
+	bool draining = false;
+	std::thread worker;
+
+	/* Worker-only */
+	std::map<uint64_t, RepeatState> repeats;
+};
+
+/* Intentionally leaked: logging must work during static
+ * destruction of other translation units */
+static Sink *sink()
+{
+	static Sink *s = new Sink;
+	return s;
+}
+
+static uint64_t lineHash(const std::string &line)
+{
+	uint64_t hash = 0xcbf29ce484222325ull;
+
+	for (size_t i = 0; i < line.size(); ++i)
+	{
+		hash ^= (uint8_t) line[i];
+		hash *= 0x100000001b3ull;
+	}
+
+	return hash;
+}
+
+/* Worker-side: apply repeat suppression, write what passes.
+ * Returns whether anything reached the stream */
+static bool writeLine(Sink &s, const std::string &line)
+{
+	const uint64_t hash = lineHash(line);
+	const Clock::time_point now = Clock::now();
+
+	RepeatState &st = s.repeats[hash];
+
+	if (st.lastEmit != Clock::time_point() &&
+	    std::chrono::duration_cast<std::chrono::milliseconds>(
+	            now - st.lastEmit).count() < LOG_REPEAT_WINDOW_MS)
+	{
+		st.suppressed++;
+		return false;
+	}
+
+	if (st.suppressed > 0)
+	{
+		fprintf(stderr, "%s [repeated %llu times]\n", line.c_str(),
+		        (unsigned long long) (st.suppressed + 1));
+		st.suppressed = 0;
+	}
+	else
+	{
+		fprintf(stderr, "%s\n", line.c_str());
+	}
+
+	st.lastEmit = now;
+
+	/* The map only ever holds recently-noisy lines */
+	if (s.repeats.size() > 256)
+		s.repeats.clear();
+
+	return true;
+}
+
+static void drainLocked(Sink &s, std::unique_lock<std::mutex> &guard)
+{
+	for (;;)
+	{
+		if (s.draining)
+		{
+			/* Another drainer is writing; a flush caller still
+			 * has to see its lines land, so wait it out */
+			s.cv.wait(guard);
+			continue;
+		}
+
+		if (s.queue.empty() && s.dropped == 0)
+			return;
+
+		s.draining = true;
+
+		std::vector<std::string> batch;
+		batch.swap(s.queue);
+
+		const uint64_t dropped = s.dropped;
+		s.dropped = 0;
+
+		guard.unlock();
+
+		for (size_t i = 0; i < batch.size(); ++i)
+			writeLine(s, batch[i]);
+
+		if (dropped > 0)
+			fprintf(stderr, "[debug log: %llu lines dropped]\n",
+			        (unsigned long long) dropped);
+
+		fflush(stderr);
+
+		guard.lock();
+		s.draining = false;
+		s.cv.notify_all();
+	}
+}
+
+static void workerFun()
+{
+	Sink &s = *sink();
+	std::unique_lock<std::mutex> guard(s.lock);
+
+	while (!s.term)
+	{
+		if (s.queue.empty() && s.dropped == 0)
+			s.cv.wait_for(guard, std::chrono::milliseconds(100));
+
+		drainLocked(s, guard);
+	}
+}
+
+static void shutdown()
+{
+	Sink &s = *sink();
+
+	{
+		std::lock_guard<std::mutex> guard(s.lock);
+
+		if (!s.started)
+			return;
+
+		s.term = true;
+	}
+
+	s.cv.notify_one();
+	s.worker.join();
+
+	flush();
+}
+
+void submit(const std::string &line)
+{
+	Sink &s = *sink();
+
+	{
+		std::lock_guard<std::mutex> guard(s.lock);
+
+		if (s.term)
+		{
+			/* Shutting down (or already shut): write through */
+			fprintf(stderr, "%s\n", line.c_str());
+			return;
+		}
+
+		if (s.queue.size() >= LOG_QUEUE_CAP)
+		{
+			s.dropped++;
+			return;
+		}
+
+		s.queue.push_back(line);
+
+		if (!s.started)
+		{
+			s.started = true;
+			s.worker = std::thread(workerFun);
+			atexit(shutdown);
+		}
+	}
+
+	s.cv.notify_one();
+}
+
+void flush()
+{
+	Sink &s = *sink();
+	std::unique_lock<std::mutex> guard(s.lock);
+
+	drainLocked(s, guard);
+}
+
+}
@@ -0,0 +1,44 @@
+/*
+** debuglog.h
+**
+** This file is part of mkxp.
+**
+** Copyright (C) 2013 - 2021 Amaryllis Kulla <ancurio@mapleshrine.eu>
+**
+** mkxp is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 2 of the License, or
+** (at your option) any later version.
+**
+** mkxp is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with mkxp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef DEBUGLOG_H
+#define DEBUGLOG_H
+
+#include <string>
+
+/* Buffered sink behind Debug(): lines queue in memory and a
+ * background worker writes them out in batches, so verbose script
+ * logging stops stalling the game on consoles where writes are
+ * expensive (Windows especially). A line repeating within a short
+ * window is suppressed and summarized as "[repeated N times]", and
+ * the queue is bounded - overflow drops with a count instead of
+ * blocking the producer */
+namespace DebugLog
+{
+
+void submit(const std::string &line);
+
+/* Synchronous drain (atexit does this automatically) */
+void flush();
+
+}
+
+#endif // DEBUGLOG_H
@@ -26,6 +26,8 @@
 #include <sstream>
 #include <vector>
 
+#include "debuglog.h"
+
 #ifdef __ANDROID__
 #include <android/log.h>
 #endif
@@ -64,7 +66,9 @@ public:
 #ifdef __ANDROID__
 		__android_log_write(ANDROID_LOG_DEBUG, "mkxp", buf.str().c_str());
 #else
-		std::cerr << buf.str() << std::endl;
+		/* Queued to the buffered sink; a background worker
+		 * batches the actual (possibly expensive) writes */
+		DebugLog::submit(buf.str());
 #endif
 	}
 
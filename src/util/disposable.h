@@ -28,7 +28,7 @@
 #include "graphics.h"
 
 #include <assert.h>
-#include "sigslot/signal.hpp"
+#include "flatsignal.h"
 
 class Disposable
 {
@@ -67,7 +67,7 @@ public:
 		return disposed;
 	}
 
-    sigslot::signal<> wasDisposed;
+    FlatSignal wasDisposed;
 
 protected:
 	void guardDisposed() const
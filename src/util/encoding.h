@@ -12,6 +12,7 @@
 #include <string.h>
 
 #include "util/encoding.h"
+#include "util/boost-hash.h"
 #include <iconv.h>
 #include <uchardet.h>
 #include <errno.h>
@@ -31,37 +32,69 @@ static std::string getCharset(std::string &str) {
     return ret;
 }
 
+/* Detection + iconv run for every call, but the same filenames
+ * and dialogue lines cross the binding thousands of times per
+ * session, so identical inputs are served from a small interning
+ * cache. Oversized inputs (whole config/script blobs) bypass it.
+ * All converting call paths run on the script thread (the config
+ * loader finishes before it starts), so no locking */
+enum {
+    convertCacheMaxStrlen = 1024,
+    convertCacheMaxEntries = 512
+};
+
 static std::string convertString(std::string &str) {
+    static BoostHash<std::string, std::string> cache;
     
-    std::string charset = getCharset(str);
+    const bool cacheable = str.size() <= convertCacheMaxStrlen;
     
-    // Conversion doesn't need to happen if it's already UTF-8
-    if (!strcmp(charset.c_str(), "UTF-8") || !strcmp(charset.c_str(), "ASCII")) {
-        return std::string(str);
+    if (cacheable) {
+        if (const std::string *hit = cache.valuePtr(str))
+            return *hit;
     }
     
-    iconv_t cd = iconv_open("UTF-8", charset.c_str());
-    
-    size_t inLen = str.size();
-    size_t outLen = inLen * 4;
-    std::string buf(outLen, '\0');
-    char *inPtr = const_cast<char*>(str.c_str());
-    char *outPtr = const_cast<char*>(buf.c_str());
-    
-    errno = 0;
-    size_t result = iconv(cd, &inPtr, &inLen, &outPtr, &outLen);
-    
-    iconv_close(cd);
+    std::string charset = getCharset(str);
+    std::string out;
     
-    if (result != (size_t)-1 && errno == 0)
-    {
-        buf.resize(buf.size()-outLen);
+    // Conversion doesn't need to happen if it's already UTF-8
+    if (!strcmp(charset.c_str(), "UTF-8") || !strcmp(charset.c_str(), "ASCII")) {
+        out = str;
     }
     else {
-        throw Exception(Exception::MKXPError, "Unable to convert string (Guessed encoding: %s)", charset.c_str());
+        iconv_t cd = iconv_open("UTF-8", charset.c_str());
+        
+        size_t inLen = str.size();
+        size_t outLen = inLen * 4;
+        std::string buf(outLen, '\0');
+        char *inPtr = const_cast<char*>(str.c_str());
+        char *outPtr = const_cast<char*>(buf.c_str());
+        
+        errno = 0;
+        size_t result = iconv(cd, &inPtr, &inLen, &outPtr, &outLen);
+        
+        iconv_close(cd);
+        
+        if (result != (size_t)-1 && errno == 0)
+        {
+            buf.resize(buf.size()-outLen);
+        }
+        else {
+            throw Exception(Exception::MKXPError, "Unable to convert string (Guessed encoding: %s)", charset.c_str());
+        }
+        
+        out = buf;
+    }
+    
+    if (cacheable) {
+        /* Same clear-on-full scheme as the glyph layout cache;
+         * the working set of a session fits comfortably */
+        if (cache.size() >= convertCacheMaxEntries)
+            cache.clear();
+        
+        cache.insert(str, out);
     }
     
-    return buf;
+    return out;
 }
 }
 
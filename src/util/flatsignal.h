@@ -0,0 +1,145 @@
+/*
+** flatsignal.h
+**
+** This file is part of mkxp.
+**
+** Copyright (C) 2013 - 2021 Amaryllis Kulla <ancurio@mapleshrine.eu>
+**
+** mkxp is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 2 of the License, or
+** (at your option) any later version.
+**
+** mkxp is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with mkxp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef FLATSIGNAL_H
+#define FLATSIGNAL_H
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+/* Single threaded stand-in for sigslot on the per-frame hot
+ * signals (prepareDraw, modified, valueChanged, wasDisposed):
+ * firing iterates a flat callback array with none of the
+ * mutexed connection list machinery. The connect forms mirror
+ * the sigslot subset the engine uses - callables, and pointer
+ * to member with instance. Only for signals that fire and
+ * (dis)connect on the same thread.
+ *
+ * Slots disconnected mid-fire are skipped and compacted out
+ * after delivery; connections stay valid (and disconnect
+ * stays a no-op) past the death of their signal. */
+
+struct FlatSlotState
+{
+	std::function<void()> fn;
+	bool connected;
+
+	FlatSlotState()
+	    : connected(true)
+	{}
+};
+
+class FlatConnection
+{
+public:
+	FlatConnection() {}
+
+	explicit FlatConnection(const std::shared_ptr<FlatSlotState> &state)
+	    : state(state)
+	{}
+
+	void disconnect()
+	{
+		if (!state)
+			return;
+
+		state->connected = false;
+		state->fn = nullptr;
+		state.reset();
+	}
+
+private:
+	std::shared_ptr<FlatSlotState> state;
+};
+
+class FlatSignal
+{
+public:
+	FlatSignal() {}
+
+	/* Like sigslot's, not copyable; a copy would alias
+	 * the slot states */
+	FlatSignal(const FlatSignal &) = delete;
+	FlatSignal &operator=(const FlatSignal &) = delete;
+
+	FlatConnection connect(std::function<void()> fn)
+	{
+		std::shared_ptr<FlatSlotState> state =
+			std::make_shared<FlatSlotState>();
+		state->fn = std::move(fn);
+
+		slots.push_back(state);
+
+		return FlatConnection(state);
+	}
+
+	template<class C>
+	FlatConnection connect(void (C::*fn)(), C *obj)
+	{
+		return connect([obj, fn] { (obj->*fn)(); });
+	}
+
+	void operator()()
+	{
+		bool anyDead = false;
+
+		/* Indexed so slots connected by a callback (appended
+		 * at the end) don't invalidate the walk; they fire
+		 * from the next emission on */
+		size_t count = slots.size();
+
+		for (size_t i = 0; i < count; ++i)
+		{
+			if (slots[i]->connected)
+				slots[i]->fn();
+			else
+				anyDead = true;
+		}
+
+		if (anyDead)
+			compact();
+	}
+
+	~FlatSignal()
+	{
+		/* Outstanding connections see a dead slot and
+		 * their disconnect() stays a no-op */
+		for (size_t i = 0; i < slots.size(); ++i)
+			slots[i]->connected = false;
+	}
+
+private:
+	void compact()
+	{
+		size_t out = 0;
+
+		for (size_t i = 0; i < slots.size(); ++i)
+			if (slots[i]->connected)
+				slots[out++] = slots[i];
+
+		slots.resize(out);
+	}
+
+	std::vector<std::shared_ptr<FlatSlotState> > slots;
+};
+
+#endif // FLATSIGNAL_H
@@ -0,0 +1,185 @@
+/*
+** jobpool.cpp
+**
+** This file is part of mkxp.
+**
+** Copyright (C) 2013 - 2021 Amaryllis Kulla <ancurio@mapleshrine.eu>
+**
+** mkxp is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 2 of the License, or
+** (at your option) any later version.
+**
+** mkxp is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with mkxp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "jobpool.h"
+
+#include <SDL_atomic.h>
+#include <SDL_cpuinfo.h>
+#include <SDL_mutex.h>
+#include <SDL_thread.h>
+
+#include <vector>
+
+struct JobPool::Priv
+{
+	SDL_mutex *lock;
+	SDL_cond *workCond;   /* workers wait here for a batch */
+	SDL_cond *doneCond;   /* the submitter waits here */
+	SDL_mutex *submitLock;
+
+	/* Active batch */
+	void (*fn)(void *, int);
+	void *arg;
+	int count;
+	SDL_atomic_t nextIndex;
+	int remaining;
+	int chewers;
+	unsigned batchId;
+
+	std::vector<SDL_Thread *> workers;
+
+	Priv()
+	    : fn(0), arg(0), count(0), remaining(0), chewers(0), batchId(0)
+	{
+		lock = SDL_CreateMutex();
+		workCond = SDL_CreateCond();
+		doneCond = SDL_CreateCond();
+		submitLock = SDL_CreateMutex();
+		SDL_AtomicSet(&nextIndex, 0);
+	}
+
+	/* Chew indices of the current batch; call with 'lock' held,
+	 * returns with it held. The chewer count keeps the batch
+	 * alive until every participant has left its loop: a
+	 * straggler here must not see nextIndex reset for the
+	 * following batch */
+	void chewBatch()
+	{
+		void (*bfn)(void *, int) = fn;
+		void *barg = arg;
+		const int bcount = count;
+
+		chewers++;
+
+		SDL_UnlockMutex(lock);
+
+		for (;;)
+		{
+			const int idx = SDL_AtomicAdd(&nextIndex, 1);
+
+			if (idx >= bcount)
+				break;
+
+			bfn(barg, idx);
+
+			SDL_LockMutex(lock);
+			if (--remaining == 0)
+				SDL_CondBroadcast(doneCond);
+			SDL_UnlockMutex(lock);
+		}
+
+		SDL_LockMutex(lock);
+
+		if (--chewers == 0)
+			SDL_CondBroadcast(doneCond);
+	}
+
+	void workerFun()
+	{
+		SDL_LockMutex(lock);
+
+		unsigned seen = 0;
+
+		for (;;)
+		{
+			while (batchId == seen)
+				SDL_CondWait(workCond, lock);
+
+			seen = batchId;
+
+			if (fn)
+				chewBatch();
+		}
+	}
+};
+
+static int workerEntry(void *ptr)
+{
+	static_cast<JobPool::Priv *>(ptr)->workerFun();
+	return 0;
+}
+
+JobPool::JobPool()
+{
+	p = new Priv;
+
+	int workers = SDL_GetCPUCount() - 1;
+	if (workers < 0)
+		workers = 0;
+	if (workers > 8)
+		workers = 8;
+
+	for (int i = 0; i < workers; ++i)
+	{
+		SDL_Thread *t = SDL_CreateThread(workerEntry, "jobpool", p);
+
+		if (t)
+			p->workers.push_back(t);
+	}
+}
+
+JobPool::~JobPool()
+{
+	/* Never runs (leaked singleton); workers die with the process */
+}
+
+JobPool &JobPool::instance()
+{
+	static JobPool *pool = new JobPool;
+	return *pool;
+}
+
+int JobPool::workerCount() const
+{
+	return (int) p->workers.size();
+}
+
+void JobPool::parallelFor(int count, void (*fn)(void *, int), void *arg)
+{
+	if (count <= 0)
+		return;
+
+	/* One batch at a time */
+	SDL_LockMutex(p->submitLock);
+
+	SDL_LockMutex(p->lock);
+	p->fn = fn;
+	p->arg = arg;
+	p->count = count;
+	p->remaining = count;
+	SDL_AtomicSet(&p->nextIndex, 0);
+	p->batchId++;
+	SDL_CondBroadcast(p->workCond);
+
+	/* The caller works too; with zero workers this alone
+	 * completes the batch */
+	p->chewBatch();
+
+	/* Wait for completion AND for every straggling chewer to
+	 * leave the batch, so the next one may reuse the state */
+	while (p->remaining > 0 || p->chewers > 0)
+		SDL_CondWait(p->doneCond, p->lock);
+
+	p->fn = 0;
+	SDL_UnlockMutex(p->lock);
+
+	SDL_UnlockMutex(p->submitLock);
+}
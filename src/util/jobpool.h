@@ -0,0 +1,56 @@
+/*
+** jobpool.h
+**
+** This file is part of mkxp.
+**
+** Copyright (C) 2013 - 2021 Amaryllis Kulla <ancurio@mapleshrine.eu>
+**
+** mkxp is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 2 of the License, or
+** (at your option) any later version.
+**
+** mkxp is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with mkxp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef JOBPOOL_H
+#define JOBPOOL_H
+
+/* One shared worker pool for burst parallelism (tilemap band
+ * rebuilds, path cache construction): cores-1 persistent workers
+ * instead of a fresh thread spawn per burst. parallelFor blocks the
+ * caller, which also chews indices itself, so a pool of any size -
+ * including zero workers on a single core - always completes.
+ * Continuous services (audio streaming, movie decode) keep their
+ * own threads; they are services, not jobs */
+class JobPool
+{
+public:
+	/* Process-lifetime singleton (intentionally leaked) */
+	static JobPool &instance();
+
+	/* Invoke fn(arg, index) for every index in [0, count), spread
+	 * over the workers plus the calling thread; returns when all
+	 * indices completed. One batch runs at a time; nested calls
+	 * from inside a job are not supported */
+	void parallelFor(int count, void (*fn)(void *arg, int index),
+	                 void *arg);
+
+	int workerCount() const;
+
+	struct Priv;
+
+private:
+	JobPool();
+	~JobPool();
+
+	Priv *p;
+};
+
+#endif // JOBPOOL_H
@@ -0,0 +1,129 @@
+/*
+** poolalloc.h
+**
+** This file is part of mkxp.
+**
+** Copyright (C) 2013 - 2021 Amaryllis Kulla <ancurio@mapleshrine.eu>
+**
+** mkxp is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 2 of the License, or
+** (at your option) any later version.
+**
+** mkxp is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with mkxp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef POOLALLOC_H
+#define POOLALLOC_H
+
+#include <stddef.h>
+#include <new>
+
+/* Free-list pool for small high-churn value types vended to
+ * scripts (Rect/Color/Tone): allocation pops a node and GC
+ * driven frees push one back, both O(1), with slabs of 256
+ * objects carved at a time. Deliberately unsynchronized -
+ * these objects are only created and destroyed on the
+ * script thread, GC finalizers included. Slabs are never
+ * returned; the pools live for the process */
+class ObjectPool
+{
+public:
+	explicit ObjectPool(size_t objSize)
+	    : objSize(align(objSize)),
+	      freeList(0)
+	{}
+
+	void *alloc()
+	{
+		if (!freeList)
+			grow();
+
+		Node *node = freeList;
+		freeList = node->next;
+
+		return node;
+	}
+
+	void release(void *ptr)
+	{
+		Node *node = static_cast<Node*>(ptr);
+
+		node->next = freeList;
+		freeList = node;
+	}
+
+private:
+	struct Node { Node *next; };
+
+	enum { slabObjects = 256 };
+
+	static size_t align(size_t size)
+	{
+		/* Keep every slot fit for anything malloc
+		 * would hand out */
+		const size_t alignment = 16;
+
+		if (size < sizeof(Node))
+			size = sizeof(Node);
+
+		return (size + alignment - 1) & ~(alignment - 1);
+	}
+
+	void grow()
+	{
+		char *slab = static_cast<char*>
+			(::operator new(objSize * slabObjects));
+
+		for (size_t i = 0; i < slabObjects; ++i)
+			release(slab + i * objSize);
+	}
+
+	size_t objSize;
+	Node *freeList;
+};
+
+/* Class-level hookup. Sized deallocation (C++14) routes
+ * exact-size frees back to the pool; anything else (a
+ * hypothetical derived class) falls through to the global
+ * allocator */
+#define DECL_POOL_ALLOC() \
+	static void *operator new(size_t size); \
+	static void operator delete(void *ptr, size_t size); \
+	static void operator delete(void *ptr);
+
+#define DEF_POOL_ALLOC(Klass) \
+	/* Lazy local static dodges any init order issues */ \
+	static ObjectPool &Klass##Pool() \
+	{ \
+		static ObjectPool pool(sizeof(Klass)); \
+		return pool; \
+	} \
+	void *Klass::operator new(size_t size) \
+	{ \
+		if (size != sizeof(Klass)) \
+			return ::operator new(size); \
+		return Klass##Pool().alloc(); \
+	} \
+	void Klass::operator delete(void *ptr, size_t size) \
+	{ \
+		if (size != sizeof(Klass)) \
+		{ \
+			::operator delete(ptr); \
+			return; \
+		} \
+		Klass##Pool().release(ptr); \
+	} \
+	void Klass::operator delete(void *ptr) \
+	{ \
+		/* Unsized fallback; only exact instances exist */ \
+		Klass##Pool().release(ptr); \
+	}
+
+#endif // POOLALLOC_H
@@ -67,4 +67,20 @@ writeDouble(char **dataP, double value)
 	*dataP += 8;
 }
 
+/* Bulk blob transfer, for types whose payload is one
+ * contiguous native-endian array (Table cell data) */
+static inline void
+readData(const char **dataP, void *dest, size_t bytes)
+{
+	memcpy(dest, *dataP, bytes);
+	*dataP += bytes;
+}
+
+static inline void
+writeData(char **dataP, const void *src, size_t bytes)
+{
+	memcpy(*dataP, src, bytes);
+	*dataP += bytes;
+}
+
 #endif // SERIALUTIL_H
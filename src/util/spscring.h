@@ -0,0 +1,93 @@
+/*
+** spscring.h
+**
+** This file is part of mkxp.
+**
+** Copyright (C) 2013 - 2021 Amaryllis Kulla <ancurio@mapleshrine.eu>
+**
+** mkxp is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 2 of the License, or
+** (at your option) any later version.
+**
+** mkxp is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with mkxp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SPSCRING_H
+#define SPSCRING_H
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/* Lock-free single-producer / single-consumer byte ring for
+ * the event thread -> game thread channels: the producer
+ * appends batched records, the consumer drains them once per
+ * frame. Exactly one thread may push and exactly one may pop.
+ * Capacity must be a power of two; one slot stays unused to
+ * tell full from empty */
+template<size_t Capacity>
+class SpscByteRing
+{
+	static_assert((Capacity & (Capacity - 1)) == 0,
+	              "capacity must be a power of two");
+
+public:
+	SpscByteRing()
+	    : head(0),
+	      tail(0)
+	{}
+
+	/* Producer side; all-or-nothing */
+	bool push(const void *data, size_t len)
+	{
+		size_t h = head.load(std::memory_order_relaxed);
+		size_t t = tail.load(std::memory_order_acquire);
+
+		if (Capacity - (h - t) <= len)
+			return false;
+
+		const uint8_t *src = static_cast<const uint8_t*>(data);
+
+		for (size_t i = 0; i < len; ++i)
+			buf[(h + i) & (Capacity - 1)] = src[i];
+
+		head.store(h + len, std::memory_order_release);
+
+		return true;
+	}
+
+	/* Consumer side; returns the number of bytes drained */
+	size_t pop(void *out, size_t max)
+	{
+		size_t t = tail.load(std::memory_order_relaxed);
+		size_t h = head.load(std::memory_order_acquire);
+
+		size_t avail = h - t;
+		size_t n = avail < max ? avail : max;
+
+		uint8_t *dst = static_cast<uint8_t*>(out);
+
+		for (size_t i = 0; i < n; ++i)
+			dst[i] = buf[(t + i) & (Capacity - 1)];
+
+		tail.store(t + n, std::memory_order_release);
+
+		return n;
+	}
+
+private:
+	std::atomic<size_t> head;
+	std::atomic<size_t> tail;
+
+	uint8_t buf[Capacity];
+};
+
+#endif // SPSCRING_H
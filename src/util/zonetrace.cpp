@@ -0,0 +1,210 @@
+/*
+** zonetrace.cpp
+**
+** This file is part of mkxp.
+**
+** Copyright (C) 2013 - 2021 Amaryllis Kulla <ancurio@mapleshrine.eu>
+**
+** mkxp is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 2 of the License, or
+** (at your option) any later version.
+**
+** mkxp is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with mkxp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifdef MKXPZ_TRACE
+
+#include "zonetrace.h"
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/* Retained zone window (per-thread open stacks live separately) */
+#define ZONE_RING 65536
+
+namespace ZoneTrace
+{
+
+typedef std::chrono::steady_clock Clock;
+
+struct Zone
+{
+	const char *name;
+	uint64_t tid;
+	uint64_t startUs;
+	uint64_t endUs;
+};
+
+struct State
+{
+	std::mutex lock;
+	std::vector<Zone> ring;
+	size_t next = 0;
+	uint64_t total = 0;
+	Clock::time_point epoch = Clock::now();
+	std::string outPath = "mkxp-trace.json";
+	bool atexitSet = false;
+
+	struct ThreadStack
+	{
+		uint64_t tid;
+		std::vector<Zone> open;
+	};
+	std::vector<ThreadStack> stacks;
+
+	std::vector<Zone> &stackFor(uint64_t tid)
+	{
+		for (size_t i = 0; i < stacks.size(); ++i)
+			if (stacks[i].tid == tid)
+				return stacks[i].open;
+
+		stacks.push_back(ThreadStack());
+		stacks.back().tid = tid;
+		return stacks.back().open;
+	}
+};
+
+/* Leaked on purpose; zones may fire during static destruction */
+static State &state()
+{
+	static State *st = new State;
+	return *st;
+}
+
+static uint64_t threadId()
+{
+	return (uint64_t) std::hash<std::thread::id>()(std::this_thread::get_id());
+}
+
+static uint64_t nowUs(State &st)
+{
+	return (uint64_t) std::chrono::duration_cast<std::chrono::microseconds>(
+	        Clock::now() - st.epoch).count();
+}
+
+static void dump();
+
+void enter(const char *name)
+{
+	State &st = state();
+	std::lock_guard<std::mutex> guard(st.lock);
+
+	if (!st.atexitSet)
+	{
+		st.atexitSet = true;
+		atexit(dump);
+	}
+
+	Zone z;
+	z.name = name;
+	z.tid = threadId();
+	z.startUs = nowUs(st);
+	z.endUs = 0;
+
+	st.stackFor(z.tid).push_back(z);
+}
+
+void leave()
+{
+	State &st = state();
+	std::lock_guard<std::mutex> guard(st.lock);
+
+	std::vector<Zone> &stack = st.stackFor(threadId());
+
+	if (stack.empty())
+		return;
+
+	Zone z = stack.back();
+	stack.pop_back();
+	z.endUs = nowUs(st);
+
+	if (st.ring.size() < ZONE_RING)
+		st.ring.push_back(z);
+	else
+		st.ring[st.next] = z;
+
+	st.next = (st.next + 1) % ZONE_RING;
+	st.total++;
+}
+
+void setOutputPath(const std::string &path)
+{
+	State &st = state();
+	std::lock_guard<std::mutex> guard(st.lock);
+
+	st.outPath = path;
+}
+
+static void dump()
+{
+	State &st = state();
+	std::lock_guard<std::mutex> guard(st.lock);
+
+	/* Zones still open (a blocking script eval, a stuck worker)
+	 * close at the cut so they appear on the timeline */
+	const uint64_t cut = nowUs(st);
+
+	for (size_t t = 0; t < st.stacks.size(); ++t)
+	{
+		std::vector<Zone> &open = st.stacks[t].open;
+
+		for (size_t i = 0; i < open.size(); ++i)
+		{
+			Zone z = open[i];
+			z.endUs = cut;
+
+			if (st.ring.size() < ZONE_RING)
+				st.ring.push_back(z);
+			else
+			{
+				st.ring[st.next] = z;
+				st.next = (st.next + 1) % ZONE_RING;
+			}
+		}
+
+		open.clear();
+	}
+
+	if (st.ring.empty())
+		return;
+
+	FILE *f = fopen(st.outPath.c_str(), "wb");
+	if (!f)
+		return;
+
+	fputs("{\"traceEvents\":[", f);
+
+	for (size_t i = 0; i < st.ring.size(); ++i)
+	{
+		const Zone &z = st.ring[i];
+
+		fprintf(f,
+		        "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,"
+		        "\"tid\":%llu,\"ts\":%llu,\"dur\":%llu}",
+		        i ? "," : "",
+		        z.name,
+		        (unsigned long long) (z.tid % 100000),
+		        (unsigned long long) z.startUs,
+		        (unsigned long long) (z.endUs - z.startUs));
+	}
+
+	fputs("]}\n", f);
+	fclose(f);
+}
+
+}
+
+#endif /* MKXPZ_TRACE */
@@ -0,0 +1,68 @@
+/*
+** zonetrace.h
+**
+** This file is part of mkxp.
+**
+** Copyright (C) 2013 - 2021 Amaryllis Kulla <ancurio@mapleshrine.eu>
+**
+** mkxp is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 2 of the License, or
+** (at your option) any later version.
+**
+** mkxp is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with mkxp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef ZONETRACE_H
+#define ZONETRACE_H
+
+/* Cross-thread runtime zones (-Denable-trace=true builds only;
+ * ZONE_SCOPED compiles to nothing otherwise). Zones from every
+ * thread land in one in-memory ring; the last window is written as
+ * chrome://tracing JSON at exit, so cross-thread hitches - a decode
+ * worker stealing the render core, an event-pump stall under a
+ * script spike - show on one timeline. Zone names must be string
+ * literals (they're kept by pointer). */
+
+#ifdef MKXPZ_TRACE
+
+#include <string>
+
+namespace ZoneTrace
+{
+
+void enter(const char *name);
+void leave();
+
+/* Where the exit dump goes; customDataPath-based when available */
+void setOutputPath(const std::string &path);
+
+class Scope
+{
+public:
+	Scope(const char *name) { enter(name); }
+	~Scope() { leave(); }
+};
+
+}
+
+#define ZT_CONCAT2(a, b) a##b
+#define ZT_CONCAT(a, b) ZT_CONCAT2(a, b)
+#define ZONE_SCOPED(name) \
+	ZoneTrace::Scope ZT_CONCAT(_zt_scope_, __LINE__)(name)
+#define ZONE_SET_OUTPUT(path) ZoneTrace::setOutputPath(path)
+
+#else
+
+#define ZONE_SCOPED(name) do {} while (0)
+#define ZONE_SET_OUTPUT(path) do {} while (0)
+
+#endif /* MKXPZ_TRACE */
+
+#endif // ZONETRACE_H
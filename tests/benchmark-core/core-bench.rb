@@ -0,0 +1,123 @@
+# Core operation benchmark suite for mkxp-z.
+# License GPLv2+.
+#
+# Microbenchmarks for the hot Bitmap / Table / file-open paths over
+# generated fixtures. Run the suite via the "customScript" field in
+# mkxp.json, like the tilemap benchmark; each case prints one JSON
+# line, machine-readable for regression tracking:
+#   {"bench":"bitmap_blt","n":2000,"total_s":0.123456,"ms_per_op":0.062}
+
+def bench(name, n)
+	# Let pending GL work land so it doesn't bleed between cases
+	Graphics.update
+	start = System.uptime
+	yield
+	# Drain the submitted GL work inside the timed region, so
+	# GPU-bound cases measure more than command submission
+	Graphics.update
+	total = System.uptime - start
+	System::puts('{"bench":"%s","n":%d,"total_s":%.6f,"ms_per_op":%.5f}' %
+		[name, n, total, (total / n) * 1000.0])
+end
+
+# ---- fixtures ----
+
+src = Bitmap.new(256, 256)
+16.times do |y|
+	16.times do |x|
+		src.fill_rect(x * 16, y * 16, 16, 16,
+			Color.new((x * 16) % 256, (y * 16) % 256, 128))
+	end
+end
+
+dst = Bitmap.new(640, 480)
+full = Rect.new(0, 0, 256, 256)
+
+# A file fixture for the open/decode path
+fixture_path = "bench-fixture.png"
+src.to_file(fixture_path)
+
+# ---- Bitmap ----
+
+N_BLT = 2000
+bench("bitmap_blt", N_BLT) do
+	N_BLT.times do |i|
+		dst.blt((i * 7) % 384, (i * 13) % 224, src, full)
+	end
+end
+
+N_SBLT = 1000
+bench("bitmap_stretch_blt", N_SBLT) do
+	N_SBLT.times do |i|
+		dst.stretch_blt(Rect.new((i * 11) % 300, (i * 3) % 200, 340, 280),
+			src, full)
+	end
+end
+
+N_FILL = 5000
+bench("bitmap_fill_rect", N_FILL) do
+	c = Color.new(200, 100, 50)
+	N_FILL.times do |i|
+		dst.fill_rect((i * 5) % 600, (i * 9) % 440, 40, 40, c)
+	end
+end
+
+# Repeated line: the shaped-layout cache hit path
+N_TEXT = 1000
+bench("bitmap_draw_text_repeat", N_TEXT) do
+	N_TEXT.times do
+		dst.draw_text(10, 10, 400, 32, "The quick brown fox, 1234567890")
+	end
+end
+
+# Unique lines: full shaping every call
+N_TEXTU = 300
+bench("bitmap_draw_text_unique", N_TEXTU) do
+	N_TEXTU.times do |i|
+		dst.draw_text(10, 48, 400, 32, "unique line number #{i} of text")
+	end
+end
+
+# ---- Table ----
+
+tbl = Table.new(200, 200, 3)
+200.times do |x|
+	200.times { |y| tbl[x, y, 0] = (x * y) % 384 }
+end
+
+N_AT = 1_000_000
+bench("table_at", N_AT) do
+	sum = 0
+	i = 0
+	while i < N_AT
+		sum += tbl[i % 200, (i / 200) % 200, 0]
+		i += 1
+	end
+end
+
+N_RESIZE = 200
+bench("table_resize", N_RESIZE) do
+	N_RESIZE.times do |i|
+		tbl.resize(200 + (i % 3) * 25, 200, 3)
+	end
+end
+
+# ---- file open + decode ----
+
+N_OPEN = 100
+bench("file_open_bitmap", N_OPEN) do
+	N_OPEN.times do
+		b = Bitmap.new(fixture_path)
+		b.dispose
+	end
+end
+
+N_LOAD = 300
+bench("file_exists", N_LOAD) do
+	N_LOAD.times { System.file_exist?(fixture_path) }
+end
+
+File.delete(fixture_path) if File.exist?(fixture_path)
+
+System::puts('{"bench":"done"}')
+exit
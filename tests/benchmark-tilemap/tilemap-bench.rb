@@ -0,0 +1,119 @@
+# Tilemap benchmark suite for mkxp-z.
+# License GPLv2+.
+#
+# Constructs Tilemap instances against synthetic Table data of varying
+# sizes and measures rebuild and per-frame draw cost through the real
+# scene composite path (each Graphics.wait(1) runs a full composite).
+#
+# Run the suite via the "customScript" field in mkxp.json.
+# Results are printed one per line, machine-readable:
+#   tilemap-bench,<case>,<map_size>,<frames>,<total_s>,<ms_per_frame>
+
+FRAMES = 120
+
+def report(kase, size, frames, total)
+	System::puts("tilemap-bench,%s,%d,%d,%.6f,%.3f" %
+		[kase, size, frames, total, (total / frames) * 1000.0])
+end
+
+def make_tileset
+	# Synthetic 8x50 tile tileset
+	bmp = Bitmap.new(256, 1600)
+	50.times do |ty|
+		8.times do |tx|
+			c = Color.new((tx * 32) % 256, (ty * 5) % 256, 128)
+			bmp.fill_rect(tx * 32, ty * 32, 32, 32, c)
+		end
+	end
+	bmp
+end
+
+def make_map_data(size)
+	data = Table.new(size, size, 3)
+	size.times do |x|
+		size.times do |y|
+			# Ground layer: plain tileset tiles
+			data[x, y, 0] = 384 + ((x + y * 7) % 300)
+			# Sparse detail layer with prioritized tiles
+			data[x, y, 1] = 384 + 300 + (x % 8) if (x + y) % 11 == 0
+		end
+	end
+	data
+end
+
+def make_priorities
+	prio = Table.new(384 + 400)
+	400.times { |i| prio[384 + i] = i % 6 }
+	prio
+end
+
+tileset = make_tileset
+prio = make_priorities
+
+[100, 300, 500].each do |size|
+	data = make_map_data(size)
+
+	tm = Tilemap.new
+	tm.tileset = tileset
+	tm.priorities = prio
+
+	# Initial build cost (assignment plus first composite)
+	start = System.uptime
+	tm.map_data = data
+	Graphics.wait(1)
+	report("initial-build", size, 1, System.uptime - start)
+
+	# Steady-state draw with no invalidations
+	start = System.uptime
+	FRAMES.times { Graphics.wait(1) }
+	report("steady-draw", size, FRAMES, System.uptime - start)
+
+	# Scrolling: every frame moves the map viewport by a full
+	# tile, forcing a window regeneration (or cache hit)
+	start = System.uptime
+	FRAMES.times do |i|
+		tm.ox = i * 32
+		tm.oy = (i / 2) * 32
+		tm.update
+		Graphics.wait(1)
+	end
+	report("scroll-rebuild", size, FRAMES, System.uptime - start)
+
+	# Scrolling back and forth over two windows
+	start = System.uptime
+	FRAMES.times do |i|
+		tm.ox = (i % 2) * 32
+		tm.update
+		Graphics.wait(1)
+	end
+	report("scroll-pingpong", size, FRAMES, System.uptime - start)
+
+	# Map data edits: one visible tile per frame
+	start = System.uptime
+	FRAMES.times do |i|
+		data[i % 20, i % 15, 0] = 384 + (i % 300)
+		Graphics.wait(1)
+	end
+	report("data-edit", size, FRAMES, System.uptime - start)
+
+	# Flash data churn
+	flash = Table.new(size, size)
+	tm.flash_data = flash if tm.respond_to?(:flash_data=)
+	start = System.uptime
+	FRAMES.times do |i|
+		flash[i % 20, i % 15] = 0x0F00 | (i % 16)
+		tm.update
+		Graphics.wait(1)
+	end
+	report("flash-edit", size, FRAMES, System.uptime - start)
+
+	tm.dispose
+	data = nil
+	GC.start
+end
+
+tileset.dispose
+
+System::puts("tilemap-bench,done,0,0,0,0")
+
+exit